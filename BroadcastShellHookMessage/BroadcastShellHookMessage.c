@@ -1,3 +1,9 @@
+#include "../common/allocation.h"
+#include "../common/clock.h"
+#include "../common/message_script.h"
+#include "../common/periodic_timer.h"
+#include "../common/text_file.h"
+
 #include <Windows.h>
 
 #include <stdio.h>
@@ -5,13 +11,118 @@
 
 static __declspec(noreturn) void BroadcastShellHookMessage_Usage() {
 	fprintf(stderr, "usage: BroadcastShellHookMessage <WPARAM> <LPARAM>\n");
+	fprintf(stderr, "       BroadcastShellHookMessage --script <SCRIPT> [<LOG>]\n");
 	fprintf(stderr, "e.g. BroadcastShellHookMessage 0x35 0x4242\n");
+	fprintf(stderr, "See common/message_script.h for the script format. LOG is a CSV file that receives the actual send time of every message.\n");
 	exit(EXIT_FAILURE);
 }
 
+static UINT BroadcastShellHookMessage_RegisterMessage(void) {
+	const UINT shellhookMessage = RegisterWindowMessageW(L"SHELLHOOK");
+	if (shellhookMessage == 0) {
+		fprintf(stderr, "RegisterWindowMessageW(\"SHELLHOOK\") failed [0x%x]\n", GetLastError());
+		exit(EXIT_FAILURE);
+	}
+	return shellhookMessage;
+}
+
+static bool BroadcastShellHookMessage_Broadcast(UINT shellhookMessage, WPARAM wParam, LPARAM lParam) {
+	DWORD recipients = BSM_APPLICATIONS;
+	return BroadcastSystemMessage(BSF_POSTMESSAGE, &recipients, shellhookMessage, wParam, lParam) >= 0;
+}
+
+static bool BroadcastShellHookMessage_LoadScript(WindowInvestigator_MessageScript* script, const wchar_t* path) {
+	FILE* file;
+	if (_wfopen_s(&file, path, L"rb") != 0) {
+		fprintf(stderr, "Unable to open script \"%ls\"\n", path);
+		return false;
+	}
+	char* const text = WindowInvestigator_ReadTextFile(file);
+	fclose(file);
+	if (text == NULL) {
+		fprintf(stderr, "Unable to read script \"%ls\"\n", path);
+		return false;
+	}
+
+	size_t errorLine;
+	const bool parsed = WindowInvestigator_MessageScript_Parse(script, text, &errorLine);
+	WindowInvestigator_Free(text);
+	if (!parsed) fprintf(stderr, "Invalid script \"%ls\" at line %zu\n", path, errorLine);
+	return parsed;
+}
+
+// Sends every message of the script at its due time, and logs when each one was actually sent. Timestamps in the log are
+// based on the same clock as WindowMonitor's (see WindowInvestigator_GetTimeNanoseconds()), so that they can be correlated.
+static int BroadcastShellHookMessage_RunScript(const wchar_t* scriptPath, const wchar_t* logPath) {
+	WindowInvestigator_MessageScript script;
+	WindowInvestigator_MessageScript_Init(&script);
+	if (!BroadcastShellHookMessage_LoadScript(&script, scriptPath)) return EXIT_FAILURE;
+
+	FILE* log = NULL;
+	if (logPath != NULL) {
+		if (_wfopen_s(&log, logPath, L"w") != 0) {
+			fprintf(stderr, "Unable to open log \"%ls\"\n", logPath);
+			WindowInvestigator_MessageScript_Destroy(&script);
+			return EXIT_FAILURE;
+		}
+		fprintf(log, "index,line,wParam,lParam,scheduledTimestamp,sendTimestamp,latenessNanoseconds,sendDurationNanoseconds,succeeded\n");
+	}
+
+	const UINT shellhookMessage = BroadcastShellHookMessage_RegisterMessage();
+
+	// Pacing relies on the same sleep-then-spin approach as WindowMonitor's sampling timer; it works best with a fine scheduler
+	// tick and without being preempted while spinning.
+	const MMRESULT timeBeginPeriodResult = timeBeginPeriod(1);
+	if (timeBeginPeriodResult != TIMERR_NOERROR)
+		fprintf(stderr, "timeBeginPeriod() returned error %u\n", timeBeginPeriodResult);
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+		fprintf(stderr, "Unable to set thread priority [0x%lx]\n", GetLastError());
+
+	WindowInvestigator_PeriodicTimerOptions timerOptions;
+	WindowInvestigator_PeriodicTimer_GetDefaultOptions(&timerOptions);
+	WindowInvestigator_PeriodicTimer timer;
+	WindowInvestigator_PeriodicTimer_Init(&timer, &timerOptions);
+
+	const uint64_t messageCount = WindowInvestigator_MessageScript_GetMessageCount(&script);
+	uint64_t failureCount = 0;
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t index = 0; index < messageCount; ++index) {
+		WindowInvestigator_ScriptedMessage message;
+		WindowInvestigator_MessageScript_GetMessage(&script, index, &message);
+		const uint64_t scheduledTime = startTime + message.offsetNanoseconds;
+		const uint64_t sendTime = WindowInvestigator_PeriodicTimer_WaitUntil(&timer, scheduledTime);
+		const bool succeeded = BroadcastShellHookMessage_Broadcast(shellhookMessage, (WPARAM)message.wParam, (LPARAM)message.lParam);
+		const uint64_t sendDuration = WindowInvestigator_GetTimeNanoseconds() - sendTime;
+		if (!succeeded) {
+			fprintf(stderr, "BroadcastSystemMessage() failed for line %zu [0x%x]\n", message.line, GetLastError());
+			++failureCount;
+		}
+		if (log != NULL)
+			fprintf(log, "%" PRIu64 ",%zu,0x%" PRIx64 ",0x%" PRIx64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%d\n",
+				index, message.line, message.wParam, message.lParam, scheduledTime, sendTime, sendTime - scheduledTime, sendDuration, succeeded);
+	}
+
+	printf("Sent %" PRIu64 " messages in %.3f s, %" PRIu64 " failed\n", messageCount, (double)(WindowInvestigator_GetTimeNanoseconds() - startTime) / 1e9, failureCount);
+	const char* const names[] = { "Lateness (ns)" };
+	const WindowInvestigator_Histogram* const histograms[] = { timer.lateness };
+	WindowInvestigator_Histogram_PrintPercentileTable(stdout, names, histograms, 1);
+
+	WindowInvestigator_PeriodicTimer_Destroy(&timer);
+	timeEndPeriod(1);
+	WindowInvestigator_MessageScript_Destroy(&script);
+	if (log != NULL && fclose(log) != 0) {
+		fprintf(stderr, "Unable to write log \"%ls\"\n", logPath);
+		return EXIT_FAILURE;
+	}
+	return failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int wmain(int argc, const wchar_t* const* const argv, const wchar_t* const* const envp) {
 	UNREFERENCED_PARAMETER(envp);
 
+	if ((argc == 3 || argc == 4) && wcscmp(argv[1], L"--script") == 0)
+		return BroadcastShellHookMessage_RunScript(argv[2], argc == 4 ? argv[3] : NULL);
+
 	if (argc != 3) BroadcastShellHookMessage_Usage();
 
 	WPARAM wParam;
@@ -19,14 +130,8 @@ int wmain(int argc, const wchar_t* const* const argv, const wchar_t* const* cons
 	LPARAM lParam;
 	if (swscanf_s(argv[2], L"0x%" SCNxPTR, &lParam) != 1) BroadcastShellHookMessage_Usage();
 
-	const UINT shellhookMessage = RegisterWindowMessageW(L"SHELLHOOK");
-	if (shellhookMessage == 0) {
-		fprintf(stderr, "RegisterWindowMessageW(\"SHELLHOOK\") failed [0x%x]\n", GetLastError());
-		return EXIT_FAILURE;
-	}
-
-	DWORD recipients = BSM_APPLICATIONS;
-	if (BroadcastSystemMessage(BSF_POSTMESSAGE, &recipients, shellhookMessage, wParam, lParam) < 0) {
+	const UINT shellhookMessage = BroadcastShellHookMessage_RegisterMessage();
+	if (!BroadcastShellHookMessage_Broadcast(shellhookMessage, wParam, lParam)) {
 		fprintf(stderr, "BroadcastSystemMessage() failed [0x%x]\n", GetLastError());
 		return EXIT_FAILURE;
 	}
@@ -0,0 +1,851 @@
+#include "../common/capture_file.h"
+#include "../common/capture_index.h"
+#include "../common/clock.h"
+#include "../common/event_queue.h"
+#include "../common/histogram.h"
+#include "../common/replay.h"
+#include "../common/rude_window.h"
+#include "../common/structured_output.h"
+#include "../common/tick_cadence.h"
+#include "../common/timeline.h"
+
+#include <inttypes.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void CaptureTool_Usage(void) {
+	fprintf(stderr, "usage:\n");
+	fprintf(stderr, "  CaptureTool index CAPTURE [INDEX]\n");
+	fprintf(stderr, "  CaptureTool state CAPTURE TIME [INDEX]\n");
+	fprintf(stderr, "  CaptureTool verify CAPTURE\n");
+	fprintf(stderr, "  CaptureTool seek-benchmark CAPTURE COUNT [INDEX]\n");
+	fprintf(stderr, "  CaptureTool timeline CAPTURE OUTPUT [START END [WIDTH]]\n");
+	fprintf(stderr, "  CaptureTool rude CAPTURE [MONITOR...]\n");
+	fprintf(stderr, "  CaptureTool replay CAPTURE OUTPUT [MONITOR...]\n");
+	fprintf(stderr, "  CaptureTool cadence CAPTURE QUIET_PASSES SLOW_PERIOD [FAST_PERIOD]\n");
+	fprintf(stderr, "  CaptureTool export CAPTURE jsonl|csv [OUTPUT]\n");
+	fprintf(stderr, "INDEX defaults to CAPTURE.idx. TIME, START and END are in seconds since the start of the capture, or @ followed by seconds since the UNIX epoch.\n");
+	fprintf(stderr, "OUTPUT is an SVG file, or an HTML file if its name ends with .html. WIDTH is in pixels.\n");
+	fprintf(stderr, "MONITOR is LEFT,TOP,RIGHT,BOTTOM in screen coordinates.\n");
+	fprintf(stderr, "OUTPUT is a capture file for the replayed events, or - to discard them.\n");
+	fprintf(stderr, "SLOW_PERIOD and FAST_PERIOD are in milliseconds; FAST_PERIOD defaults to 10.\n");
+	fprintf(stderr, "OUTPUT is a JSON Lines or CSV file for the exported events (see common/structured_output.h), or the standard output if not specified.\n");
+	exit(EXIT_FAILURE);
+}
+
+static FILE* CaptureTool_OpenFile(const char* path, const char* mode) {
+#ifdef _MSC_VER
+	FILE* file;
+	return fopen_s(&file, path, mode) == 0 ? file : NULL;
+#else
+	return fopen(path, mode);
+#endif
+}
+
+static uint64_t CaptureTool_ParseUInt64(const char* string) {
+	char* end;
+	const unsigned long long value = strtoull(string, &end, 10);
+	if (*string == '\0' || *end != '\0') CaptureTool_Usage();
+	return value;
+}
+
+static double CaptureTool_ParseDouble(const char* string) {
+	char* end;
+	const double value = strtod(string, &end);
+	if (*string == '\0' || *end != '\0' || value < 0) CaptureTool_Usage();
+	return value;
+}
+
+static void CaptureTool_OpenCapture(WindowInvestigator_CaptureReader* reader, const char* path) {
+	FILE* const file = CaptureTool_OpenFile(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to open capture file \"%s\"\n", path);
+		exit(EXIT_FAILURE);
+	}
+	if (!WindowInvestigator_CaptureReader_Init(reader, file)) {
+		fprintf(stderr, "\"%s\" is not a valid capture file\n", path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void CaptureTool_CloseCapture(WindowInvestigator_CaptureReader* reader) {
+	FILE* const file = reader->file;
+	WindowInvestigator_CaptureReader_Destroy(reader);
+	fclose(file);
+}
+
+static void CaptureTool_BuildIndex(WindowInvestigator_CaptureIndex* index, WindowInvestigator_CaptureReader* reader) {
+	if (!WindowInvestigator_CaptureIndex_Build(index, reader)) {
+		fprintf(stderr, "Unable to read capture file\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Reads the index at indexPath if there is one and it matches the capture; otherwise, builds the index from scratch.
+static void CaptureTool_LoadIndex(WindowInvestigator_CaptureIndex* index, WindowInvestigator_CaptureReader* reader, const char* indexPath) {
+	FILE* const file = CaptureTool_OpenFile(indexPath, "rb");
+	if (file != NULL) {
+		const bool indexRead = WindowInvestigator_CaptureIndex_Read(index, file);
+		fclose(file);
+		if (indexRead && WindowInvestigator_CaptureIndex_Matches(index, reader)) return;
+		fprintf(stderr, "Ignoring invalid or mismatched index file \"%s\"\n", indexPath);
+	}
+	CaptureTool_BuildIndex(index, reader);
+}
+
+static char* CaptureTool_GetDefaultIndexPath(const char* capturePath) {
+	const size_t length = strlen(capturePath);
+	char* const indexPath = malloc(length + sizeof(".idx"));
+	if (indexPath == NULL) abort();
+	memcpy(indexPath, capturePath, length);
+	memcpy(indexPath + length, ".idx", sizeof(".idx"));
+	return indexPath;
+}
+
+static int CaptureTool_Index(const char* capturePath, const char* indexPath) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+	WindowInvestigator_CaptureIndex index;
+	WindowInvestigator_CaptureIndex_Init(&index);
+
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	CaptureTool_BuildIndex(&index, &reader);
+	const uint64_t duration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+
+	FILE* const file = CaptureTool_OpenFile(indexPath, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to create index file \"%s\"\n", indexPath);
+		return EXIT_FAILURE;
+	}
+	const bool indexWritten = WindowInvestigator_CaptureIndex_Write(&index, file);
+	if (fclose(file) != 0 || !indexWritten) {
+		fprintf(stderr, "Unable to write index file \"%s\"\n", indexPath);
+		return EXIT_FAILURE;
+	}
+	printf("Indexed %zu keyframes in %" PRIu64 " bytes of capture (%.1f MB/s)\n", index.entryCount, index.captureSize, (double)index.captureSize * 1e3 / (double)duration);
+
+	WindowInvestigator_CaptureIndex_Destroy(&index);
+	CaptureTool_CloseCapture(&reader);
+	return EXIT_SUCCESS;
+}
+
+static uint64_t CaptureTool_ParseTime(const WindowInvestigator_CaptureReader* reader, const char* string) {
+	if (string[0] != '@') return reader->header.startTimestamp + (uint64_t)(CaptureTool_ParseDouble(string) * 1e9);
+	const uint64_t unixTimeNanoseconds = (uint64_t)(CaptureTool_ParseDouble(string + 1) * 1e9);
+	if (unixTimeNanoseconds < reader->header.startUnixTimeNanoseconds) return reader->header.startTimestamp;
+	return reader->header.startTimestamp + (unixTimeNanoseconds - reader->header.startUnixTimeNanoseconds);
+}
+
+static void CaptureTool_PrintRect(const WindowInvestigator_Rect* rect) {
+	printf("(%" PRId32 ", %" PRId32 ")-(%" PRId32 ", %" PRId32 ")", rect->left, rect->top, rect->right, rect->bottom);
+}
+
+static void CaptureTool_PrintState(const WindowInvestigator_CaptureState* state) {
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(&state->windows);
+	for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(&state->windows, zOrder);
+		const WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(&state->windows, slot);
+		printf("%zu: window 0x%" PRIxPTR " PID %" PRIu32 " TID %" PRIu32 " class \"%ls\" text \"%ls\" styles 0x%08" PRIx32 " extended styles 0x%08" PRIx32 " rect ",
+			zOrder, WindowInvestigator_WindowTable_GetWindow(&state->windows, slot), windowInfo->processId, windowInfo->threadId,
+			WindowInvestigator_StringPool_Get(&state->strings, windowInfo->className), WindowInvestigator_StringPool_Get(&state->strings, windowInfo->text),
+			windowInfo->styles, windowInfo->extendedStyles);
+		CaptureTool_PrintRect(&windowInfo->windowRect);
+		printf(" band %" PRIu32 " cloaked %" PRIu32 "%s%s\n", windowInfo->band, windowInfo->dwmIsCloaked, windowInfo->isVisible ? " visible" : "", windowInfo->isIconic ? " iconic" : "");
+	}
+}
+
+static int CaptureTool_State(const char* capturePath, const char* time, const char* indexPath) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+	WindowInvestigator_CaptureIndex index;
+	WindowInvestigator_CaptureIndex_Init(&index);
+	CaptureTool_LoadIndex(&index, &reader, indexPath);
+	const uint64_t timestamp = CaptureTool_ParseTime(&reader, time);
+
+	WindowInvestigator_CaptureState state;
+	WindowInvestigator_CaptureState_Init(&state);
+	uint64_t recordsApplied;
+	if (!WindowInvestigator_CaptureState_Load(&state, &reader, &index, timestamp, &recordsApplied)) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	printf("State at %.6f s (%" PRIu64 " records applied", (double)(timestamp - reader.header.startTimestamp) / 1e9, recordsApplied);
+	if (recordsApplied != 0) printf(", last one at %.6f s", (double)(state.timestamp - reader.header.startTimestamp) / 1e9);
+	if (state.eventsDropped) printf(") (UNCERTAIN: %" PRIu64 " events dropped so far; state uncertain until next complete keyframe):\n", state.droppedEventCount);
+	else printf(")%s:\n", state.inconsistent ? " (INCONSISTENT: some events are missing from the capture)" : "");
+	CaptureTool_PrintState(&state);
+
+	WindowInvestigator_CaptureState_Destroy(&state);
+	WindowInvestigator_CaptureIndex_Destroy(&index);
+	CaptureTool_CloseCapture(&reader);
+	return EXIT_SUCCESS;
+}
+
+// Replays the whole capture, checking that the state rebuilt from changes matches every keyframe.
+static int CaptureTool_Verify(const char* capturePath) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+	WindowInvestigator_CaptureState state;
+	WindowInvestigator_CaptureState_Init(&state);
+	state.inconsistent = false;
+
+	uint64_t recordCount = 0;
+	uint64_t keyframeCount = 0;
+	uint64_t checkedKeyframeCount = 0;
+	uint64_t mismatchedKeyframeCount = 0;
+	uint64_t droppedRecordCount = 0;
+	bool checkingKeyframe = false;
+	WindowInvestigator_CaptureReader_Result result;
+	for (;;) {
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		result = WindowInvestigator_CaptureReader_ReadRecord(&reader, &header, &payload);
+		if (result != WindowInvestigator_CaptureReader_RECORD) break;
+		if (header.type == WindowInvestigator_MonitorEvent_KEYFRAME) {
+			++keyframeCount;
+			checkingKeyframe = !state.inconsistent;
+		}
+		// Some of the snapshots may be missing, so the keyframe cannot be checked.
+		if (header.type == WindowInvestigator_MonitorEvent_EVENTS_DROPPED) checkingKeyframe = false;
+		if (!WindowInvestigator_CaptureState_Apply(&state, &header, payload)) {
+			fprintf(stderr, "Malformed record at offset %" PRIu64 "\n", reader.offset - reader.header.recordHeaderSize - header.payloadSize);
+			return EXIT_FAILURE;
+		}
+		++recordCount;
+		if (header.type == WindowInvestigator_MonitorEvent_EVENTS_DROPPED) {
+			++droppedRecordCount;
+			printf("%.6f s: events dropped (%" PRIu64 " so far), state uncertain until next complete keyframe\n",
+				(double)(header.timestamp - reader.header.startTimestamp) / 1e9, state.droppedEventCount);
+		}
+		if (checkingKeyframe && state.pendingSnapshots == 0) {
+			checkingKeyframe = false;
+			++checkedKeyframeCount;
+			if (state.keyframeMismatches != 0 || state.inconsistent) {
+				++mismatchedKeyframeCount;
+				fprintf(stderr, "Keyframe at %.6f s: %zu windows out of %zu do not match the replayed state\n",
+					(double)(header.timestamp - reader.header.startTimestamp) / 1e9, state.keyframeMismatches, state.keyframeWindowCount);
+			}
+		}
+	}
+	if (result == WindowInvestigator_CaptureReader_ERROR) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	printf("%" PRIu64 " records, %" PRIu64 " keyframes, %" PRIu64 " checked against replayed state, %" PRIu64 " mismatched%s\n",
+		recordCount, keyframeCount, checkedKeyframeCount, mismatchedKeyframeCount, result == WindowInvestigator_CaptureReader_TRUNCATED ? " (capture is truncated)" : "");
+	if (droppedRecordCount != 0)
+		printf("%" PRIu64 " events dropped, reported %" PRIu64 " times; state uncertain until next complete keyframe after each%s\n",
+			state.droppedEventCount, droppedRecordCount, state.eventsDropped ? " (still uncertain at the end of the capture)" : "");
+
+	WindowInvestigator_CaptureState_Destroy(&state);
+	CaptureTool_CloseCapture(&reader);
+	return mismatchedKeyframeCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int CaptureTool_CompareUInt64(const void* left, const void* right) {
+	const uint64_t leftValue = *(const uint64_t*)left;
+	const uint64_t rightValue = *(const uint64_t*)right;
+	return (leftValue > rightValue) - (leftValue < rightValue);
+}
+
+// Measures how long it takes to get the state at random points in time.
+static int CaptureTool_SeekBenchmark(const char* capturePath, size_t queryCount, const char* indexPath) {
+	if (queryCount == 0) CaptureTool_Usage();
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+	WindowInvestigator_CaptureIndex index;
+	WindowInvestigator_CaptureIndex_Init(&index);
+	CaptureTool_LoadIndex(&index, &reader, indexPath);
+	if (index.entryCount == 0) {
+		fprintf(stderr, "The capture has no keyframes\n");
+		WindowInvestigator_CaptureIndex_Destroy(&index);
+		CaptureTool_CloseCapture(&reader);
+		return EXIT_FAILURE;
+	}
+	const uint64_t firstTimestamp = index.entries[0].timestamp;
+	const uint64_t timeSpan = index.entries[index.entryCount - 1].timestamp - firstTimestamp + 1;
+
+	WindowInvestigator_CaptureState state;
+	WindowInvestigator_CaptureState_Init(&state);
+	uint64_t* const durations = malloc(queryCount * sizeof(*durations));
+	if (durations == NULL) abort();
+	uint64_t totalDuration = 0;
+	uint64_t totalRecordsApplied = 0;
+	uint64_t inconsistentCount = 0;
+	int result = EXIT_SUCCESS;
+	// xorshift64*, seeded with a constant so that runs are comparable.
+	uint64_t random = UINT64_C(0x9E3779B97F4A7C15);
+	for (size_t query = 0; query < queryCount; ++query) {
+		random ^= random >> 12;
+		random ^= random << 25;
+		random ^= random >> 27;
+		const uint64_t timestamp = firstTimestamp + (random * UINT64_C(0x2545F4914F6CDD1D)) % timeSpan;
+
+		const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+		uint64_t recordsApplied;
+		if (!WindowInvestigator_CaptureState_Load(&state, &reader, &index, timestamp, &recordsApplied)) {
+			fprintf(stderr, "Unable to read capture file\n");
+			result = EXIT_FAILURE;
+			break;
+		}
+		durations[query] = WindowInvestigator_GetTimeNanoseconds() - startTime;
+		totalDuration += durations[query];
+		totalRecordsApplied += recordsApplied;
+		if (state.inconsistent) ++inconsistentCount;
+	}
+	if (result == EXIT_SUCCESS) {
+		qsort(durations, queryCount, sizeof(*durations), CaptureTool_CompareUInt64);
+		printf("Capture: %" PRIu64 " bytes, %zu keyframes over %.1f s\n", index.captureSize, index.entryCount, (double)timeSpan / 1e9);
+		printf("Seek: %zu queries, mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us, %.0f records applied per query, %" PRIu64 " inconsistent\n",
+			queryCount, (double)totalDuration / 1e3 / (double)queryCount, (double)durations[queryCount / 2] / 1e3, (double)durations[queryCount * 99 / 100] / 1e3,
+			(double)durations[queryCount - 1] / 1e3, (double)totalRecordsApplied / (double)queryCount, inconsistentCount);
+	}
+
+	free(durations);
+	WindowInvestigator_CaptureState_Destroy(&state);
+	WindowInvestigator_CaptureIndex_Destroy(&index);
+	CaptureTool_CloseCapture(&reader);
+	return result;
+}
+
+// Returns the timestamp of the last record in the capture.
+static uint64_t CaptureTool_GetEndTimestamp(WindowInvestigator_CaptureReader* reader) {
+	uint64_t endTimestamp = reader->header.startTimestamp;
+	WindowInvestigator_CaptureRecordHeader header;
+	const unsigned char* payload;
+	WindowInvestigator_CaptureReader_Result result;
+	while ((result = WindowInvestigator_CaptureReader_ReadRecord(reader, &header, &payload)) == WindowInvestigator_CaptureReader_RECORD) endTimestamp = header.timestamp;
+	if (result == WindowInvestigator_CaptureReader_ERROR) {
+		fprintf(stderr, "Unable to read capture file\n");
+		exit(EXIT_FAILURE);
+	}
+	return endTimestamp;
+}
+
+static int CaptureTool_Timeline(const char* capturePath, const char* outputPath, const char* start, const char* end, size_t width, const char* indexPath) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+	WindowInvestigator_CaptureIndex index;
+	WindowInvestigator_CaptureIndex_Init(&index);
+	CaptureTool_LoadIndex(&index, &reader, indexPath);
+
+	WindowInvestigator_TimelineOptions options;
+	options.captureStartTimestamp = reader.header.startTimestamp;
+	options.startTimestamp = start == NULL ? reader.header.startTimestamp : CaptureTool_ParseTime(&reader, start);
+	if (end != NULL) options.endTimestamp = CaptureTool_ParseTime(&reader, end);
+	else if (!WindowInvestigator_CaptureReader_Seek(&reader, reader.header.headerSize)) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	else options.endTimestamp = CaptureTool_GetEndTimestamp(&reader);
+	if (options.endTimestamp <= options.startTimestamp) CaptureTool_Usage();
+	options.width = width;
+	const size_t outputPathLength = strlen(outputPath);
+	options.html = outputPathLength >= 5 && strcmp(outputPath + outputPathLength - 5, ".html") == 0;
+
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	// Only the part of the capture that is rendered is read, thanks to the index.
+	WindowInvestigator_CaptureState state;
+	WindowInvestigator_CaptureState_Init(&state);
+	if (!WindowInvestigator_CaptureState_Load(&state, &reader, &index, options.startTimestamp, NULL)) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE* const output = CaptureTool_OpenFile(outputPath, "wb");
+	if (output == NULL) {
+		fprintf(stderr, "Unable to create output file \"%s\"\n", outputPath);
+		return EXIT_FAILURE;
+	}
+	WindowInvestigator_Timeline timeline;
+	WindowInvestigator_Timeline_Init(&timeline, output, &options, &state);
+	uint64_t recordCount = 0;
+	WindowInvestigator_CaptureRecordHeader header;
+	const unsigned char* payload;
+	WindowInvestigator_CaptureReader_Result result;
+	while ((result = WindowInvestigator_CaptureReader_ReadRecord(&reader, &header, &payload)) == WindowInvestigator_CaptureReader_RECORD && header.timestamp <= options.endTimestamp) {
+		if (!WindowInvestigator_CaptureState_Apply(&state, &header, payload)) {
+			fprintf(stderr, "Malformed record in capture file\n");
+			return EXIT_FAILURE;
+		}
+		WindowInvestigator_Timeline_OnRecord(&timeline, &state, &header, payload);
+		++recordCount;
+	}
+	if (result == WindowInvestigator_CaptureReader_ERROR) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	const bool finished = WindowInvestigator_Timeline_Finish(&timeline);
+	if (fclose(output) != 0 || !finished) {
+		fprintf(stderr, "Unable to write output file \"%s\"\n", outputPath);
+		return EXIT_FAILURE;
+	}
+	const uint64_t duration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+	printf("Rendered %" PRIu64 " records in %.3f s: %" PRIu64 " windows in %zu lanes, %" PRIu64 " segments (plus %" PRIu64 " changes aggregated), %" PRIu64 " message markers (plus %" PRIu64 " messages aggregated)%s\n",
+		recordCount, (double)duration / 1e9, timeline.windowCount, timeline.laneCount, timeline.segmentCount, timeline.aggregatedChangeCount, timeline.markerCount, timeline.aggregatedMessageCount,
+		state.inconsistent ? " (INCONSISTENT: some events are missing from the capture)" : "");
+
+	WindowInvestigator_Timeline_Destroy(&timeline);
+	WindowInvestigator_CaptureState_Destroy(&state);
+	WindowInvestigator_CaptureIndex_Destroy(&index);
+	CaptureTool_CloseCapture(&reader);
+	return EXIT_SUCCESS;
+}
+
+static WindowInvestigator_Rect CaptureTool_ParseRect(const char* string) {
+	long coordinates[4];
+	for (int coordinateIndex = 0; coordinateIndex < 4; ++coordinateIndex) {
+		char* end;
+		coordinates[coordinateIndex] = strtol(string, &end, 10);
+		if (end == string || *end != (coordinateIndex == 3 ? '\0' : ',')) CaptureTool_Usage();
+		string = end + 1;
+	}
+	WindowInvestigator_Rect rect;
+	rect.left = (int32_t)coordinates[0];
+	rect.top = (int32_t)coordinates[1];
+	rect.right = (int32_t)coordinates[2];
+	rect.bottom = (int32_t)coordinates[3];
+	return rect;
+}
+
+typedef struct {
+	const WindowInvestigator_CaptureReader* reader;
+	const WindowInvestigator_CaptureState* state;
+} CaptureTool_RudeWindowContext;
+
+static void CaptureTool_PrintRudeWindowChange(const WindowInvestigator_CaptureReader* reader, uint64_t timestamp, size_t monitor, const WindowInvestigator_Rect* monitorRect, uint64_t previousWindow, uint64_t window) {
+	printf("%.6f s: monitor %zu ", (double)(timestamp - reader->header.startTimestamp) / 1e9, monitor);
+	CaptureTool_PrintRect(monitorRect);
+	printf(" rude window 0x%" PRIx64 " -> 0x%" PRIx64, previousWindow, window);
+}
+
+static void CaptureTool_OnRudeWindowChanged(void* context, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window) {
+	const CaptureTool_RudeWindowContext* const rudeWindowContext = context;
+	CaptureTool_PrintRudeWindowChange(rudeWindowContext->reader, rudeWindowContext->state->timestamp, monitor, monitorRect, previousWindow, window);
+	printf(" (computed%s)\n", rudeWindowContext->state->inconsistent ? ", INCONSISTENT: some events are missing from the capture" : "");
+}
+
+// Replays the whole capture, computing the rude window of each of the specified monitors, and lists the changes alongside the
+// ones WindowMonitor recorded and the ABN_FULLSCREENAPP notifications it received.
+//
+// The engine is evaluated at the end of every tick, as WindowMonitor does, i.e. at every TICK_FINISHED record. Version 1
+// captures have no such records, but records that WindowMonitor does not emit during a tick (received messages, rude window
+// changes and keyframes) are good enough, along with ZORDER_UPDATED.
+static int CaptureTool_Rude(const char* capturePath, const WindowInvestigator_Rect* monitors, size_t monitorCount) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+	WindowInvestigator_CaptureState state;
+	WindowInvestigator_CaptureState_Init(&state);
+	state.inconsistent = false;
+
+	CaptureTool_RudeWindowContext rudeWindowContext;
+	rudeWindowContext.reader = &reader;
+	rudeWindowContext.state = &state;
+	WindowInvestigator_RudeWindowSink sink;
+	sink.onRudeWindowChanged = CaptureTool_OnRudeWindowChanged;
+	sink.context = &rudeWindowContext;
+	WindowInvestigator_RudeWindowEngine engine;
+	WindowInvestigator_RudeWindowEngine_Init(&engine, &state.windows, &sink);
+	WindowInvestigator_RudeWindowEngine_SetMonitors(&engine, monitors, monitorCount);
+
+	const bool tickFinishedRecords = reader.header.version >= WindowInvestigator_CaptureFile_TICK_FINISHED_VERSION;
+	uint64_t recordedChangeCount = 0;
+	uint64_t mismatchCount = 0;
+	uint64_t fullscreenAppCount = 0;
+	WindowInvestigator_CaptureReader_Result result;
+	for (;;) {
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		result = WindowInvestigator_CaptureReader_ReadRecord(&reader, &header, &payload);
+		if (result != WindowInvestigator_CaptureReader_RECORD) break;
+
+		if (!tickFinishedRecords && (header.type == WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE || header.type == WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED || header.type == WindowInvestigator_MonitorEvent_KEYFRAME))
+			WindowInvestigator_RudeWindowEngine_Evaluate(&engine);
+		if (!WindowInvestigator_CaptureState_Apply(&state, &header, payload)) {
+			fprintf(stderr, "Malformed record at offset %" PRIu64 "\n", reader.offset - reader.header.recordHeaderSize - header.payloadSize);
+			return EXIT_FAILURE;
+		}
+
+		switch (header.type) {
+		case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+		case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+			WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&engine, (uintptr_t)header.window, WindowInvestigator_WindowField_ALL);
+			break;
+		case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+			WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(&engine);
+			if (!tickFinishedRecords) WindowInvestigator_RudeWindowEngine_Evaluate(&engine);
+			break;
+		case WindowInvestigator_MonitorEvent_TICK_FINISHED:
+			WindowInvestigator_RudeWindowEngine_Evaluate(&engine);
+			break;
+		case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT:
+			if (state.pendingSnapshots == 0) {
+				// The keyframe might have filled in changes that were lost.
+				WindowInvestigator_RudeWindowEngine_MarkAllWindowsChanged(&engine);
+				WindowInvestigator_RudeWindowEngine_Evaluate(&engine);
+			}
+			break;
+		case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE: {
+			uint64_t wParam = 0, lParam = 0;
+			// ABN_FULLSCREENAPP
+			if (header.previousZOrder != WindowInvestigator_ReceivedMessage_APPBAR || !WindowInvestigator_DecodeReceivedMessage(payload, header.payloadSize, &wParam, &lParam) || wParam != 2) break;
+			++fullscreenAppCount;
+			printf("%.6f s: ABN_FULLSCREENAPP %s\n", (double)(header.timestamp - reader.header.startTimestamp) / 1e9, lParam != 0 ? "open" : "close");
+			break;
+		}
+		case WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED: {
+			uint64_t previousWindow = 0;
+			WindowInvestigator_Rect monitorRect = { 0 };
+			if (!WindowInvestigator_DecodeRudeWindowChanged(payload, header.payloadSize, &previousWindow, &monitorRect)) break;
+			++recordedChangeCount;
+			CaptureTool_PrintRudeWindowChange(&reader, header.timestamp, header.zOrder, &monitorRect, previousWindow, header.window);
+			// If the same monitor is being computed, the verdicts should agree.
+			bool mismatch = false;
+			for (size_t monitor = 0; monitor < engine.monitorCount; ++monitor)
+				if (memcmp(&engine.monitors[monitor], &monitorRect, sizeof(monitorRect)) == 0 && engine.rudeWindows[monitor] != header.window && !state.inconsistent)
+					mismatch = true;
+			if (mismatch) ++mismatchCount;
+			printf(" (recorded%s)\n", mismatch ? ", MISMATCH" : "");
+			break;
+		}
+		}
+	}
+	if (result == WindowInvestigator_CaptureReader_ERROR) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	WindowInvestigator_RudeWindowEngine_Evaluate(&engine);
+	printf("%" PRIu64 " rude window changes computed, %" PRIu64 " recorded (%" PRIu64 " mismatched), %" PRIu64 " ABN_FULLSCREENAPP notifications%s\n",
+		engine.statistics.rudeWindowChanges, recordedChangeCount, mismatchCount, fullscreenAppCount, result == WindowInvestigator_CaptureReader_TRUNCATED ? " (capture is truncated)" : "");
+
+	WindowInvestigator_RudeWindowEngine_Destroy(&engine);
+	WindowInvestigator_CaptureState_Destroy(&state);
+	CaptureTool_CloseCapture(&reader);
+	return mismatchCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+typedef struct {
+	// NULL if the replayed events are discarded.
+	WindowInvestigator_CaptureWriter* writer;
+	// FNV-1a of the replayed events.
+	uint64_t digest;
+} CaptureTool_ReplayContext;
+
+static void CaptureTool_AddToDigest(uint64_t* digest, uint64_t value, int byteCount) {
+	for (int byteIndex = 0; byteIndex < byteCount; ++byteIndex) {
+		*digest ^= (unsigned char)(value >> (8 * byteIndex));
+		*digest *= UINT64_C(0x100000001b3);
+	}
+}
+
+static void CaptureTool_OnReplayedEvent(void* context, const WindowInvestigator_MonitorEvent* event) {
+	CaptureTool_ReplayContext* const replayContext = context;
+	if (replayContext->writer != NULL) WindowInvestigator_CaptureWriter_WriteEvent(replayContext->writer, event);
+	CaptureTool_AddToDigest(&replayContext->digest, event->timestamp, 8);
+	CaptureTool_AddToDigest(&replayContext->digest, event->window, 8);
+	CaptureTool_AddToDigest(&replayContext->digest, (uint64_t)event->type, 4);
+	CaptureTool_AddToDigest(&replayContext->digest, event->zOrder, 4);
+	CaptureTool_AddToDigest(&replayContext->digest, event->previousZOrder, 4);
+	CaptureTool_AddToDigest(&replayContext->digest, event->recordSize, 4);
+	for (uint32_t byteIndex = 0; byteIndex < event->recordSize; ++byteIndex) CaptureTool_AddToDigest(&replayContext->digest, event->record[byteIndex], 1);
+}
+
+// Replays the whole capture through the monitor engine as fast as possible (see replay.h), writes the replayed events to
+// outputPath unless it is "-", and reports throughput and how the replayed events compare to the recorded ones. The digest
+// only depends on the capture and on the code, so it can be compared across runs and versions.
+static int CaptureTool_Replay(const char* capturePath, const char* outputPath, const WindowInvestigator_Rect* monitors, size_t monitorCount) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+
+	CaptureTool_ReplayContext replayContext;
+	replayContext.writer = NULL;
+	replayContext.digest = UINT64_C(0xcbf29ce484222325);
+	WindowInvestigator_CaptureWriter writer;
+	FILE* outputFile = NULL;
+	if (strcmp(outputPath, "-") != 0) {
+		outputFile = CaptureTool_OpenFile(outputPath, "wb");
+		if (outputFile == NULL) {
+			fprintf(stderr, "Unable to open output file \"%s\"\n", outputPath);
+			return EXIT_FAILURE;
+		}
+		WindowInvestigator_CaptureWriter_InitWithStartTime(&writer, outputFile, reader.header.startTimestamp, reader.header.startUnixTimeNanoseconds);
+		replayContext.writer = &writer;
+	}
+
+	WindowInvestigator_ReplayOptions options;
+	WindowInvestigator_Replay_GetDefaultOptions(&options);
+	options.monitors = monitors;
+	options.monitorCount = monitorCount;
+	WindowInvestigator_ReplayStatistics statistics;
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	if (!WindowInvestigator_Replay(&reader, &options, CaptureTool_OnReplayedEvent, &replayContext, &statistics)) {
+		fprintf(stderr, "Unable to read capture file, or malformed record at offset %" PRIu64 "\n", reader.offset);
+		return EXIT_FAILURE;
+	}
+	const double seconds = (double)(WindowInvestigator_GetTimeNanoseconds() - startTime) / 1e9;
+	if (replayContext.writer != NULL) {
+		const bool written = WindowInvestigator_CaptureWriter_Flush(&writer);
+		WindowInvestigator_CaptureWriter_Destroy(&writer);
+		if (fclose(outputFile) != 0 || !written) {
+			fprintf(stderr, "Unable to write output file \"%s\"\n", outputPath);
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%" PRIu64 " records, %" PRIu64 " ticks, %" PRIu64 " events replayed in %.3f s (%.0f records/s, %.1f MB/s)%s\n",
+		statistics.recordsRead, statistics.ticks, statistics.eventsReplayed, seconds, (double)statistics.recordsRead / seconds, (double)reader.offset / 1e6 / seconds,
+		statistics.truncated ? " (capture is truncated)" : "");
+	printf("Digest: %016" PRIx64 "\n", replayContext.digest);
+	if (statistics.mismatchedEvents == 0) printf("Replayed events match the recorded ones%s\n", statistics.droppedEventCount != 0 ? " where the state is certain" : "");
+	else printf("%" PRIu64 " replayed events do not match the recorded ones, starting at %.6f s\n",
+		statistics.mismatchedEvents, (double)(statistics.firstMismatchTimestamp - reader.header.startTimestamp) / 1e9);
+	if (statistics.droppedEventCount != 0)
+		printf("%" PRIu64 " events dropped from the capture: state uncertain until next complete keyframe, %" PRIu64 " replayed events differ meanwhile\n",
+			statistics.droppedEventCount, statistics.uncertainEvents);
+
+	CaptureTool_CloseCapture(&reader);
+	return statistics.mismatchedEvents == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// The passes that WindowMonitor would run over the activity recorded in a capture with a given cadence, in simulated time.
+typedef struct {
+	WindowInvestigator_TickCadence cadence;
+	uint64_t nextTimerTime;
+	// When the changes that the next pass will detect were recorded.
+	uint64_t* pendingChanges;
+	size_t pendingChangeCount;
+	size_t pendingChangeCapacity;
+	uint64_t timerPasses;
+	uint64_t messagePasses;
+	// Time spent at the slow cadence, up to slowSince if the cadence is currently slow.
+	uint64_t slowNanoseconds;
+	uint64_t slowSince;
+	// Time between recording a change and the pass that detects it, in nanoseconds.
+	WindowInvestigator_Histogram* detectionDelays;
+} CaptureTool_CadenceSimulation;
+
+static void CaptureTool_CadenceSimulation_Init(CaptureTool_CadenceSimulation* simulation, const WindowInvestigator_TickCadenceOptions* options, uint64_t startTime) {
+	memset(simulation, 0, sizeof(*simulation));
+	WindowInvestigator_TickCadence_Init(&simulation->cadence, options);
+	simulation->nextTimerTime = startTime + simulation->cadence.periodNanoseconds;
+	simulation->detectionDelays = malloc(sizeof(*simulation->detectionDelays));
+	if (simulation->detectionDelays == NULL) abort();
+	WindowInvestigator_Histogram_Reset(simulation->detectionDelays);
+}
+
+static void CaptureTool_CadenceSimulation_Destroy(CaptureTool_CadenceSimulation* simulation) {
+	free(simulation->pendingChanges);
+	free(simulation->detectionDelays);
+}
+
+// Rearms the timer, as WindowMonitor does when the period changes.
+static void CaptureTool_CadenceSimulation_OnPeriodChanged(CaptureTool_CadenceSimulation* simulation, uint64_t time) {
+	if (simulation->cadence.level == WindowInvestigator_TickCadenceLevel_SLOW) simulation->slowSince = time;
+	else simulation->slowNanoseconds += time - simulation->slowSince;
+	simulation->nextTimerTime = time + simulation->cadence.periodNanoseconds;
+}
+
+static void CaptureTool_CadenceSimulation_Pass(CaptureTool_CadenceSimulation* simulation, uint64_t time) {
+	for (size_t change = 0; change < simulation->pendingChangeCount; ++change)
+		WindowInvestigator_Histogram_Record(simulation->detectionDelays, time - simulation->pendingChanges[change]);
+	const bool changed = simulation->pendingChangeCount != 0;
+	simulation->pendingChangeCount = 0;
+	if (WindowInvestigator_TickCadence_OnPass(&simulation->cadence, changed)) CaptureTool_CadenceSimulation_OnPeriodChanged(simulation, time);
+}
+
+// Runs the timer passes that are due before the specified time.
+static void CaptureTool_CadenceSimulation_RunTimer(CaptureTool_CadenceSimulation* simulation, uint64_t time) {
+	while (simulation->nextTimerTime < time) {
+		const uint64_t passTime = simulation->nextTimerTime;
+		simulation->nextTimerTime += simulation->cadence.periodNanoseconds;
+		++simulation->timerPasses;
+		CaptureTool_CadenceSimulation_Pass(simulation, passTime);
+	}
+}
+
+static void CaptureTool_CadenceSimulation_OnChange(CaptureTool_CadenceSimulation* simulation, uint64_t time) {
+	CaptureTool_CadenceSimulation_RunTimer(simulation, time);
+	if (simulation->pendingChangeCount == simulation->pendingChangeCapacity) {
+		simulation->pendingChangeCapacity = simulation->pendingChangeCapacity == 0 ? 256 : simulation->pendingChangeCapacity * 2;
+		uint64_t* const pendingChanges = realloc(simulation->pendingChanges, simulation->pendingChangeCapacity * sizeof(*pendingChanges));
+		if (pendingChanges == NULL) abort();
+		simulation->pendingChanges = pendingChanges;
+	}
+	simulation->pendingChanges[simulation->pendingChangeCount++] = time;
+}
+
+// Every message triggers a pass right away, regardless of the cadence.
+static void CaptureTool_CadenceSimulation_OnMessage(CaptureTool_CadenceSimulation* simulation, uint64_t time) {
+	CaptureTool_CadenceSimulation_RunTimer(simulation, time);
+	if (WindowInvestigator_TickCadence_OnActivity(&simulation->cadence)) CaptureTool_CadenceSimulation_OnPeriodChanged(simulation, time);
+	++simulation->messagePasses;
+	CaptureTool_CadenceSimulation_Pass(simulation, time);
+}
+
+// Runs the timer until every change has been detected, and stops counting time spent at the slow cadence at endTime.
+static void CaptureTool_CadenceSimulation_Finish(CaptureTool_CadenceSimulation* simulation, uint64_t endTime) {
+	while (simulation->pendingChangeCount != 0) CaptureTool_CadenceSimulation_RunTimer(simulation, simulation->nextTimerTime + 1);
+	if (simulation->cadence.level == WindowInvestigator_TickCadenceLevel_SLOW && endTime > simulation->slowSince)
+		simulation->slowNanoseconds += endTime - simulation->slowSince;
+}
+
+// Estimates what an adaptive cadence would have cost and saved over the activity recorded in a capture, compared to the fixed
+// fast cadence: the changes and messages in the capture are replayed in simulated time through two instances of the cadence
+// controller, one of which never slows down. Delays are measured from when WindowMonitor recorded each change, i.e. on top of
+// the resolution of the capture itself; the fixed cadence gives the baseline to compare against.
+static int CaptureTool_Cadence(const char* capturePath, const WindowInvestigator_TickCadenceOptions* options) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+
+	WindowInvestigator_TickCadenceOptions fixedOptions = *options;
+	fixedOptions.quietPassThreshold = 0;
+	CaptureTool_CadenceSimulation simulations[2];
+	CaptureTool_CadenceSimulation_Init(&simulations[0], &fixedOptions, reader.header.startTimestamp);
+	CaptureTool_CadenceSimulation_Init(&simulations[1], options, reader.header.startTimestamp);
+
+	uint64_t time = reader.header.startTimestamp;
+	uint64_t changeCount = 0;
+	uint64_t messageCount = 0;
+	WindowInvestigator_CaptureReader_Result result;
+	for (;;) {
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		result = WindowInvestigator_CaptureReader_ReadRecord(&reader, &header, &payload);
+		if (result != WindowInvestigator_CaptureReader_RECORD) break;
+		// Records are written in the order they are queued, which is not quite the order of their timestamps.
+		if (header.timestamp > time) time = header.timestamp;
+
+		switch (header.type) {
+		case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+		case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+		case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED:
+		case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+			++changeCount;
+			for (size_t simulation = 0; simulation < 2; ++simulation) CaptureTool_CadenceSimulation_OnChange(&simulations[simulation], time);
+			break;
+		case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE:
+			++messageCount;
+			for (size_t simulation = 0; simulation < 2; ++simulation) CaptureTool_CadenceSimulation_OnMessage(&simulations[simulation], time);
+			break;
+		}
+	}
+	if (result == WindowInvestigator_CaptureReader_ERROR) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	for (size_t simulation = 0; simulation < 2; ++simulation) CaptureTool_CadenceSimulation_Finish(&simulations[simulation], time);
+
+	const uint64_t duration = time - reader.header.startTimestamp;
+	const uint64_t fixedPasses = simulations[0].timerPasses + simulations[0].messagePasses;
+	const uint64_t adaptivePasses = simulations[1].timerPasses + simulations[1].messagePasses;
+	printf("%.3f s, %" PRIu64 " changes, %" PRIu64 " messages%s\n", (double)duration / 1e9, changeCount, messageCount, result == WindowInvestigator_CaptureReader_TRUNCATED ? " (capture is truncated)" : "");
+	printf("Fixed: every %.3f ms, %" PRIu64 " passes (%" PRIu64 " triggered by messages)\n", (double)options->fastPeriodNanoseconds / 1e6, fixedPasses, simulations[0].messagePasses);
+	printf("Adaptive: every %.3f ms, %.3f ms after %" PRIu64 " quiet passes, %" PRIu64 " passes (%" PRIu64 " triggered by messages), %" PRIu64 " slowdowns, slow %.1f%% of the time\n",
+		(double)options->fastPeriodNanoseconds / 1e6, (double)options->slowPeriodNanoseconds / 1e6, options->quietPassThreshold, adaptivePasses, simulations[1].messagePasses,
+		simulations[1].cadence.switches[WindowInvestigator_TickCadenceLevel_SLOW], duration == 0 ? 0 : (double)simulations[1].slowNanoseconds * 100 / (double)duration);
+	printf("Passes saved: %" PRId64 " (%.1f%%)\n", (int64_t)(fixedPasses - adaptivePasses), fixedPasses == 0 ? 0 : ((double)fixedPasses - (double)adaptivePasses) * 100 / (double)fixedPasses);
+	printf("Detection delay (ns):\n");
+	const char* const names[] = { "Fixed", "Adaptive" };
+	const WindowInvestigator_Histogram* const histograms[] = { simulations[0].detectionDelays, simulations[1].detectionDelays };
+	WindowInvestigator_Histogram_PrintPercentileTable(stdout, names, histograms, 2);
+
+	for (size_t simulation = 0; simulation < 2; ++simulation) CaptureTool_CadenceSimulation_Destroy(&simulations[simulation]);
+	CaptureTool_CloseCapture(&reader);
+	return EXIT_SUCCESS;
+}
+
+static int CaptureTool_Export(const char* capturePath, WindowInvestigator_StructuredFormat format, const char* outputPath) {
+	WindowInvestigator_CaptureReader reader;
+	CaptureTool_OpenCapture(&reader, capturePath);
+
+	FILE* const outputFile = outputPath == NULL ? stdout : CaptureTool_OpenFile(outputPath, "wb");
+	if (outputFile == NULL) {
+		fprintf(stderr, "Unable to open output file \"%s\"\n", outputPath);
+		return EXIT_FAILURE;
+	}
+	WindowInvestigator_StructuredWriter writer;
+	WindowInvestigator_StructuredWriter_Init(&writer, format, outputFile);
+
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	WindowInvestigator_CaptureReader_Result result;
+	for (;;) {
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		result = WindowInvestigator_CaptureReader_ReadRecord(&reader, &header, &payload);
+		if (result != WindowInvestigator_CaptureReader_RECORD) break;
+		if (!WindowInvestigator_StructuredWriter_WriteEvent(&writer, header.timestamp, header.window, (WindowInvestigator_MonitorEventType)header.type, header.zOrder, header.previousZOrder, payload, header.payloadSize)) {
+			fprintf(stderr, "Malformed record at offset %" PRIu64 "\n", reader.offset - reader.header.recordHeaderSize - header.payloadSize);
+			return EXIT_FAILURE;
+		}
+	}
+	if (result == WindowInvestigator_CaptureReader_ERROR) {
+		fprintf(stderr, "Unable to read capture file\n");
+		return EXIT_FAILURE;
+	}
+	const bool written = WindowInvestigator_StructuredWriter_Flush(&writer);
+	const double seconds = (double)(WindowInvestigator_GetTimeNanoseconds() - startTime) / 1e9;
+	if ((outputPath != NULL ? fclose(outputFile) : fflush(outputFile)) != 0 || !written) {
+		fprintf(stderr, "Unable to write output file \"%s\"\n", outputPath == NULL ? "-" : outputPath);
+		return EXIT_FAILURE;
+	}
+
+	// The standard output may be the exported events.
+	fprintf(stderr, "%" PRIu64 " records exported in %.3f s (%.0f records/s, %.1f MB/s of output)%s\n",
+		writer.linesWritten, seconds, (double)writer.linesWritten / seconds, (double)writer.bytesWritten / 1e6 / seconds, result == WindowInvestigator_CaptureReader_TRUNCATED ? " (capture is truncated)" : "");
+
+	WindowInvestigator_StructuredWriter_Destroy(&writer);
+	CaptureTool_CloseCapture(&reader);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	// So that window strings are printed correctly.
+	setlocale(LC_ALL, "");
+
+	if (argc < 3) CaptureTool_Usage();
+	const char* const command = argv[1];
+	const char* const capturePath = argv[2];
+	char* const defaultIndexPath = CaptureTool_GetDefaultIndexPath(capturePath);
+
+	int result = EXIT_FAILURE;
+	if (strcmp(command, "index") == 0 && argc <= 4) result = CaptureTool_Index(capturePath, argc == 4 ? argv[3] : defaultIndexPath);
+	else if (strcmp(command, "state") == 0 && (argc == 4 || argc == 5)) result = CaptureTool_State(capturePath, argv[3], argc == 5 ? argv[4] : defaultIndexPath);
+	else if (strcmp(command, "verify") == 0 && argc == 3) result = CaptureTool_Verify(capturePath);
+	else if (strcmp(command, "seek-benchmark") == 0 && (argc == 4 || argc == 5)) result = CaptureTool_SeekBenchmark(capturePath, (size_t)CaptureTool_ParseUInt64(argv[3]), argc == 5 ? argv[4] : defaultIndexPath);
+	else if (strcmp(command, "timeline") == 0 && (argc == 4 || argc == 6 || argc == 7))
+		result = CaptureTool_Timeline(capturePath, argv[3], argc >= 6 ? argv[4] : NULL, argc >= 6 ? argv[5] : NULL, argc == 7 ? (size_t)CaptureTool_ParseUInt64(argv[6]) : 2000, defaultIndexPath);
+	else if (strcmp(command, "rude") == 0) {
+		WindowInvestigator_Rect monitors[WindowInvestigator_RudeWindowEngine_MAX_MONITORS];
+		const size_t monitorCount = (size_t)(argc - 3);
+		if (monitorCount > WindowInvestigator_RudeWindowEngine_MAX_MONITORS) CaptureTool_Usage();
+		for (size_t monitor = 0; monitor < monitorCount; ++monitor) monitors[monitor] = CaptureTool_ParseRect(argv[3 + monitor]);
+		result = CaptureTool_Rude(capturePath, monitors, monitorCount);
+	}
+	else if (strcmp(command, "replay") == 0 && argc >= 4) {
+		WindowInvestigator_Rect monitors[WindowInvestigator_RudeWindowEngine_MAX_MONITORS];
+		const size_t monitorCount = (size_t)(argc - 4);
+		if (monitorCount > WindowInvestigator_RudeWindowEngine_MAX_MONITORS) CaptureTool_Usage();
+		for (size_t monitor = 0; monitor < monitorCount; ++monitor) monitors[monitor] = CaptureTool_ParseRect(argv[4 + monitor]);
+		result = CaptureTool_Replay(capturePath, argv[3], monitors, monitorCount);
+	}
+	else if (strcmp(command, "cadence") == 0 && (argc == 5 || argc == 6)) {
+		WindowInvestigator_TickCadenceOptions options;
+		WindowInvestigator_TickCadence_GetDefaultOptions(&options);
+		options.quietPassThreshold = CaptureTool_ParseUInt64(argv[3]);
+		options.slowPeriodNanoseconds = (uint64_t)(CaptureTool_ParseDouble(argv[4]) * 1e6);
+		if (argc == 6) options.fastPeriodNanoseconds = (uint64_t)(CaptureTool_ParseDouble(argv[5]) * 1e6);
+		if (options.fastPeriodNanoseconds == 0 || options.slowPeriodNanoseconds < options.fastPeriodNanoseconds) CaptureTool_Usage();
+		result = CaptureTool_Cadence(capturePath, &options);
+	}
+	else if (strcmp(command, "export") == 0 && (argc == 4 || argc == 5)) {
+		WindowInvestigator_StructuredFormat format;
+		if (!WindowInvestigator_StructuredFormat_Parse(argv[3], &format)) CaptureTool_Usage();
+		result = CaptureTool_Export(capturePath, format, argc == 5 ? argv[4] : NULL);
+	}
+	else CaptureTool_Usage();
+
+	free(defaultIndexPath);
+	return result;
+}
@@ -1,32 +1,66 @@
+#include "../common/allocation.h"
+#include "../common/clock.h"
+#include "../common/delay_profile.h"
+#include "../common/text_file.h"
 #include "../common/tracing.h"
 #include "../common/window_util.h"
 
 #include <Windows.h>
 #include <stdio.h>
 
+typedef struct {
+	WindowInvestigator_DelayProfile profile;
+	// Time 0 of the profile (see WindowInvestigator_GetTimeNanoseconds()).
+	uint64_t startTime;
+} DelayedPosWindow_State;
+
+// Sleeps for most of the delay, and spins for the last millisecond, as Sleep() is only precise to the scheduler tick.
+static void DelayedPosWindow_Delay(uint64_t delayNanoseconds) {
+	const uint64_t deadline = WindowInvestigator_GetTimeNanoseconds() + delayNanoseconds;
+	if (delayNanoseconds > 2000000) WindowInvestigator_SleepNanoseconds(delayNanoseconds - 2000000);
+	while (WindowInvestigator_GetTimeNanoseconds() < deadline) YieldProcessor();
+}
+
 static LRESULT CALLBACK DelayedPosWindow_WindowProcedure(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "ReceivedMessage", TraceLoggingHexUInt32(uMsg, "uMsg"), TraceLoggingHexUInt64(wParam, "wParam"), TraceLoggingHexUInt64(lParam, "lParam"));
 
-	if (uMsg == WM_CREATE) WindowInvestigator_SetWindowUserDataOnCreate(hWnd, lParam);
+	// Messages that come before WM_NCCREATE (e.g. WM_GETMINMAXINFO) cannot be delayed, as the state is not available yet.
+	if (uMsg == WM_NCCREATE) WindowInvestigator_SetWindowUserDataOnCreate(hWnd, lParam);
+	DelayedPosWindow_State* const state = (DelayedPosWindow_State*)WindowInvestigator_GetWindowUserData(hWnd);
+	if (state == NULL) return DefWindowProcW(hWnd, uMsg, wParam, lParam);
+
+	const uint64_t time = WindowInvestigator_GetTimeNanoseconds() - state->startTime;
+	uint64_t delayNanoseconds;
+	const WindowInvestigator_DelayRule* const rule = WindowInvestigator_DelayProfile_GetDelay(&state->profile, uMsg, time, &delayNanoseconds);
 
 	if (uMsg == WM_WINDOWPOSCHANGING) {
 		const WINDOWPOS* windowpos = (WINDOWPOS*)lParam;
-		const DWORD delayMilliseconds = *(DWORD*)WindowInvestigator_GetWindowUserData(hWnd);
+		const DWORD delayMilliseconds = (DWORD)((delayNanoseconds + 500000) / 1000000);
 		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowPosChanging",
 			TraceLoggingPointer(windowpos->hwnd, "hwnd"), TraceLoggingPointer(windowpos->hwndInsertAfter, "hwndInsertAfter"),
 			TraceLoggingInt32(windowpos->x, "x"), TraceLoggingInt32(windowpos->y, "y"), TraceLoggingInt32(windowpos->cx, "x"), TraceLoggingInt32(windowpos->cy, "cy"),
 			TraceLoggingHexUInt32(windowpos->flags, "flags"), TraceLoggingUInt32(delayMilliseconds, "delayMilliseconds"));
+	}
+
+	if (rule != NULL) {
+		const char* const messageName = WindowInvestigator_DelayProfile_GetMessageName(uMsg);
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "DelayInjected",
+			TraceLoggingHexUInt32(uMsg, "uMsg"), TraceLoggingString(messageName == NULL ? "" : messageName, "messageName"),
+			TraceLoggingString(WindowInvestigator_DelayRuleKind_GetName(rule->kind), "ruleKind"), TraceLoggingUInt64(rule->line, "ruleLine"),
+			TraceLoggingUInt64(time, "profileTimeNanoseconds"), TraceLoggingUInt64(delayNanoseconds, "delayNanoseconds"));
 
-		if (delayMilliseconds > 0)
-			Sleep(delayMilliseconds);
+		const uint64_t delayStartTime = WindowInvestigator_GetTimeNanoseconds();
+		if (delayNanoseconds > 0)
+			DelayedPosWindow_Delay(delayNanoseconds);
 
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "DelayElapsed");
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "DelayElapsed",
+			TraceLoggingHexUInt32(uMsg, "uMsg"), TraceLoggingUInt64(WindowInvestigator_GetTimeNanoseconds() - delayStartTime, "elapsedNanoseconds"));
 	}
 
 	return DefWindowProcW(hWnd, uMsg, wParam, lParam);
 }
 
-static int DelayedPosWindow(DWORD delayMilliseconds) {
+static int DelayedPosWindow(DelayedPosWindow_State* state) {
 	WNDCLASSEXW windowClass = { 0 };
 	windowClass.cbSize = sizeof(WNDCLASSEX);
 	windowClass.lpfnWndProc = DelayedPosWindow_WindowProcedure;
@@ -49,7 +83,7 @@ static int DelayedPosWindow(DWORD delayMilliseconds) {
 		/*hWndParent=*/NULL,
 		/*hMenu=*/NULL,
 		/*hInstance=*/NULL,
-		/*lpParam=*/&delayMilliseconds
+		/*lpParam=*/state
 	);
 	if (window == NULL) {
 		fprintf(stderr, "CreateWindowW failed [%x]\n", GetLastError());
@@ -72,6 +106,26 @@ static int DelayedPosWindow(DWORD delayMilliseconds) {
 	}
 }
 
+static bool DelayedPosWindow_LoadProfile(WindowInvestigator_DelayProfile* profile, const wchar_t* path) {
+	FILE* file;
+	if (_wfopen_s(&file, path, L"rb") != 0) {
+		fprintf(stderr, "Unable to open delay profile \"%ls\"\n", path);
+		return false;
+	}
+	char* const text = WindowInvestigator_ReadTextFile(file);
+	fclose(file);
+	if (text == NULL) {
+		fprintf(stderr, "Unable to read delay profile \"%ls\"\n", path);
+		return false;
+	}
+
+	size_t errorLine;
+	const bool parsed = WindowInvestigator_DelayProfile_Parse(profile, text, &errorLine);
+	WindowInvestigator_Free(text);
+	if (!parsed) fprintf(stderr, "Invalid delay profile \"%ls\" at line %zu\n", path, errorLine);
+	return parsed;
+}
+
 int wmain(int argc, const wchar_t* const* const argv, const wchar_t* const* const envp) {
 	UNREFERENCED_PARAMETER(envp);
 
@@ -82,10 +136,20 @@ int wmain(int argc, const wchar_t* const* const argv, const wchar_t* const* cons
 	}
 
 	if (argc == 2) {
+		DelayedPosWindow_State state;
+		WindowInvestigator_DelayProfile_Init(&state.profile);
 		DWORD delayMilliseconds;
-		if (swscanf_s(argv[1], L"%lu", &delayMilliseconds) == 1)
-			return DelayedPosWindow(delayMilliseconds);
+		wchar_t trailing;
+		if (swscanf_s(argv[1], L"%lu%lc", &delayMilliseconds, &trailing, 1) == 1)
+			WindowInvestigator_DelayProfile_SetFixed(&state.profile, WM_WINDOWPOSCHANGING, (uint64_t)delayMilliseconds * 1000000);
+		else if (!DelayedPosWindow_LoadProfile(&state.profile, argv[1]))
+			return EXIT_FAILURE;
+		state.startTime = WindowInvestigator_GetTimeNanoseconds();
+		return DelayedPosWindow(&state);
 	}
 
 	fprintf(stderr, "usage: DelayedPosWindow <delay in milliseconds>\n");
+	fprintf(stderr, "       DelayedPosWindow <delay profile file>\n");
+	fprintf(stderr, "See common/delay_profile.h for the delay profile format.\n");
+	return EXIT_FAILURE;
 }
@@ -1,475 +1,557 @@
+#include "../common/allocation.h"
+#include "../common/atomic.h"
+#include "../common/capture_file.h"
+#include "../common/clock.h"
+#include "../common/event_queue.h"
+#include "../common/monitor.h"
+#include "../common/periodic_timer.h"
+#include "../common/rude_window.h"
+#include "../common/structured_output.h"
+#include "../common/thread.h"
+#include "../common/tick_cadence.h"
 #include "../common/tracing.h"
 #include "../common/user32_private.h"
+#include "../common/window_filter.h"
+#include "../common/window_info.h"
 #include "../common/window_util.h"
 
 #include <Windows.h>
 #include <TraceLoggingProvider.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <stdlib.h>
 #include <dwmapi.h>
 #include <avrt.h>
 
-typedef struct {
-	DWORD processId;
-	DWORD threadId;
-
-	// RudeWindowWin32Functions::GetClassNameW()
-	wchar_t className[1024];
-
-	// RudeWindowWin32Functions::GetExStyleFromWindow()
-	DWORD extendedStyles;
-
-	// RudeWindowWin32Functions::GetStyleFromWindow()
-	DWORD styles;
-
-	// RudeWindowWin32Functions::GetWindowRectForFullscreenCheck()
-	RECT windowRect;
-	RECT clientRect;
-	RECT clientRectInScreenCoordinates;
-	// This one is not part of RudeWindowWin32Functions, but included nonetheless because its output might be interesting.
-	WINDOWPLACEMENT placement;
-
-	// RudeWindowWin32Functions::InternalGetWindowText()
-	wchar_t text[1024];
-
-	// RudeWindowWin32Functions::IsAppWindow()
-	BOOL isShellManagedWindow;
-	BOOL isShellFrameWindow;
-
-	// TODO: RudeWindowWin32Functions::IsHolographic() missing - the logic is not as trivial as the others
- 
-	// RudeWindowWin32Functions::IsOverpanning()
-	BOOL overpanning;
-
-	// RudeWindowWin32Functions::IsValidDesktopFullscreenWindow() (also isShellManagedWindow)
-	DWORD band;
-	BOOL hasNonRudeHWNDProperty;
-	BOOL hasNonRudeAddedByRudeWindowFixerProperty;
-	BOOL hasLivePreviewWindowProperty;
-	BOOL hasTreatAsDesktopFullscreenProperty;
-	
-	// RudeWindowWin32Functions::IsWindow()
-	BOOL isWindow;
-
-	//  RudeWindowWin32Functions::IsWindowAlwaysOnTopDesktop() uses GetStyleFromWindow() and GetWindowBand()
-
-	// RudeWindowWin32Functions::IsWindowCloaked()
-	DWORD dwmIsCloaked;
-
-	// RudeWindowWin32Functions::IsWindowMinimized()
-	BOOL isIconic;
-
-	// RudeWindowWin32Functions::IsWindowOnMonitor() missing as it's relative to a monitor - though windowRect might be enough to deduce its value
-
-	// RudeWindowWin32Functions::IsWindowRelatedForFullscreen() missing because it takes a pair of windows
-
-	// RudeWindowWin32Functions::IsWindowVisible()
-	BOOL isVisible;
-
-	// RudeWindowWin32Functions::MonitorFromWindow() missing
-} WindowMonitor_WindowInfo;
-
-static void WindowMonitor_DumpWindowInfo(const WindowMonitor_WindowInfo* windowInfo) {
-	printf("PID: %lu TID: %lu\n", windowInfo->processId, windowInfo->threadId);
-	printf("Class name: \"%S\"\n", windowInfo->className);
-	printf("Extended styles: 0x%08X\n", windowInfo->extendedStyles);
-	printf("Styles: 0x%08lX\n", windowInfo->styles);
-	printf("Window rect: (%ld, %ld, %ld, %ld)\n", windowInfo->windowRect.left, windowInfo->windowRect.top, windowInfo->windowRect.right, windowInfo->windowRect.bottom);
-	printf("Client rect: (%ld, %ld, %ld, %ld)\n", windowInfo->clientRect.left, windowInfo->clientRect.top, windowInfo->clientRect.right, windowInfo->clientRect.bottom);
-	printf("Client rect in screen coordinates: (%ld, %ld, %ld, %ld)\n", windowInfo->clientRectInScreenCoordinates.left, windowInfo->clientRectInScreenCoordinates.top, windowInfo->clientRectInScreenCoordinates.right, windowInfo->clientRectInScreenCoordinates.bottom);
-	printf("Placement: showCmd %u minPosition (%ld, %ld) maxPosition (%ld, %ld), normalPosition (%ld, %ld, %ld, %ld)\n",
+static void WindowMonitor_DumpWindowInfo(const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_StringPool* strings) {
+	printf("PID: %" PRIu32 " TID: %" PRIu32 "\n", windowInfo->processId, windowInfo->threadId);
+	printf("Class name: \"%S\"\n", WindowInvestigator_StringPool_Get(strings, windowInfo->className));
+	printf("Extended styles: 0x%08" PRIX32 "\n", windowInfo->extendedStyles);
+	printf("Styles: 0x%08" PRIX32 "\n", windowInfo->styles);
+	printf("Window rect: (%" PRId32 ", %" PRId32 ", %" PRId32 ", %" PRId32 ")\n", windowInfo->windowRect.left, windowInfo->windowRect.top, windowInfo->windowRect.right, windowInfo->windowRect.bottom);
+	printf("Client rect: (%" PRId32 ", %" PRId32 ", %" PRId32 ", %" PRId32 ")\n", windowInfo->clientRect.left, windowInfo->clientRect.top, windowInfo->clientRect.right, windowInfo->clientRect.bottom);
+	printf("Client rect in screen coordinates: (%" PRId32 ", %" PRId32 ", %" PRId32 ", %" PRId32 ")\n", windowInfo->clientRectInScreenCoordinates.left, windowInfo->clientRectInScreenCoordinates.top, windowInfo->clientRectInScreenCoordinates.right, windowInfo->clientRectInScreenCoordinates.bottom);
+	printf("Placement: showCmd %" PRIu32 " minPosition (%" PRId32 ", %" PRId32 ") maxPosition (%" PRId32 ", %" PRId32 "), normalPosition (%" PRId32 ", %" PRId32 ", %" PRId32 ", %" PRId32 ")\n",
 		windowInfo->placement.showCmd,
-		windowInfo->placement.ptMinPosition.x, windowInfo->placement.ptMinPosition.y,
-		windowInfo->placement.ptMaxPosition.x, windowInfo->placement.ptMaxPosition.y,
-		windowInfo->placement.rcNormalPosition.left, windowInfo->placement.rcNormalPosition.top, windowInfo->placement.rcNormalPosition.right, windowInfo->placement.rcNormalPosition.bottom);
-	printf("Text: \"%S\"\n", windowInfo->text);
+		windowInfo->placement.minPosition.x, windowInfo->placement.minPosition.y,
+		windowInfo->placement.maxPosition.x, windowInfo->placement.maxPosition.y,
+		windowInfo->placement.normalPosition.left, windowInfo->placement.normalPosition.top, windowInfo->placement.normalPosition.right, windowInfo->placement.normalPosition.bottom);
+	printf("Text: \"%S\"\n", WindowInvestigator_StringPool_Get(strings, windowInfo->text));
 	printf("Shell managed: %s\n", windowInfo->isShellManagedWindow ? "TRUE" : "FALSE");
 	printf("Shell frame: %s\n", windowInfo->isShellFrameWindow ? "TRUE" : "FALSE");
 	printf("Overpanning: %s\n", windowInfo->overpanning ? "TRUE" : "FALSE");
-	printf("Band: %lu\n", windowInfo->band);
+	printf("Band: %" PRIu32 "\n", windowInfo->band);
 	printf("Has \"NonRudeHWND\" property: %s\n", windowInfo->hasNonRudeHWNDProperty ? "TRUE" : "FALSE");
 	printf("Has non-rude added by RudeWindowFixer property: %s\n", windowInfo->hasNonRudeAddedByRudeWindowFixerProperty ? "TRUE" : "FALSE");
 	printf("Has \"LivePreviewWindow\" property: %s\n", windowInfo->hasLivePreviewWindowProperty ? "TRUE" : "FALSE");
 	printf("Has \"TreatAsDesktopFullscreen\" property: %s\n", windowInfo->hasTreatAsDesktopFullscreenProperty ? "TRUE" : "FALSE");
 	printf("Is window: %s\n", windowInfo->isWindow ? "TRUE" : "FALSE");
-	printf("DWM is cloaked: 0x%08lX\n", windowInfo->dwmIsCloaked);
+	printf("DWM is cloaked: 0x%08" PRIX32 "\n", windowInfo->dwmIsCloaked);
 	printf("Is iconic: %s\n", windowInfo->isIconic ? "TRUE" : "FALSE");
 	printf("Is visible: %s\n", windowInfo->isVisible ? "TRUE" : "FALSE");
 }
 
-static WindowMonitor_WindowInfo WindowMonitor_GetWindowInfo(HWND window) {
-	WindowMonitor_WindowInfo windowInfo;
-
-	windowInfo.threadId = GetWindowThreadProcessId(window, &windowInfo.processId);
-
-	SetLastError(NO_ERROR);
-	GetClassNameW(window, windowInfo.className, sizeof(windowInfo.className) / sizeof(*windowInfo.className));
-	const DWORD classNameError = GetLastError();
-	if (classNameError != NO_ERROR)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "classNameError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(classNameError, "ErrorCode"));
+static WindowInvestigator_Rect WindowMonitor_ConvertRect(const RECT* rect) {
+	WindowInvestigator_Rect result;
+	result.left = rect->left;
+	result.top = rect->top;
+	result.right = rect->right;
+	result.bottom = rect->bottom;
+	return result;
+}
 
-	SetLastError(NO_ERROR);
-	windowInfo.extendedStyles = (DWORD)GetWindowLongPtrW(window, GWL_EXSTYLE);
-	const DWORD extendedStylesError = GetLastError();
-	if (extendedStylesError != NO_ERROR)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "extendedStylesError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(extendedStylesError, "ErrorCode"));
+static bool WindowMonitor_HasField(uint32_t fields, WindowInvestigator_WindowField field) {
+	return (fields & WindowInvestigator_WindowField_BIT(field)) != 0;
+}
 
-	SetLastError(NO_ERROR);
-	windowInfo.styles = (DWORD)GetWindowLongPtrW(window, GWL_STYLE);
-	const DWORD stylesError = GetLastError();
-	if (stylesError != NO_ERROR)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "stylesError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(stylesError, "ErrorCode"));
+static bool WindowMonitor_HasAnyField(uint32_t fields, WindowInvestigator_WindowField firstField, WindowInvestigator_WindowField lastField) {
+	for (int field = firstField; field <= (int)lastField; ++field)
+		if (WindowMonitor_HasField(fields, field)) return true;
+	return false;
+}
 
-	if (!GetWindowRect(window, &windowInfo.windowRect))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "windowRectError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
+// Only queries what is needed to fill the requested fields (bitmask of WindowInvestigator_WindowField_BIT()); the other fields
+// are left untouched.
+static void WindowMonitor_GetWindowInfo(HWND window, uint32_t fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings) {
+	if (WindowMonitor_HasAnyField(fields, WindowInvestigator_WindowField_PROCESS_ID, WindowInvestigator_WindowField_THREAD_ID)) {
+		DWORD processId = 0;
+		const DWORD threadId = GetWindowThreadProcessId(window, &processId);
+		if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_PROCESS_ID)) windowInfo->processId = processId;
+		if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_THREAD_ID)) windowInfo->threadId = threadId;
+	}
 
-	if (!GetClientRect(window, &windowInfo.clientRect))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "clientRectError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
-	else {
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_CLASS_NAME)) {
 		SetLastError(NO_ERROR);
-		RECT rect = windowInfo.clientRect;
-		MapWindowPoints(window, NULL, (LPPOINT)&rect, 2);
-		const DWORD clientRectMapWindowPointsError = GetLastError();
-		if (clientRectMapWindowPointsError != NO_ERROR)
-			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "clientRectMapWindowPointsError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(clientRectMapWindowPointsError, "ErrorCode"));
-		else
-			windowInfo.clientRectInScreenCoordinates = rect;
+		const int classNameLength = GetClassNameW(window, windowStrings->className.string, sizeof(windowStrings->className.string) / sizeof(*windowStrings->className.string));
+		const DWORD classNameError = GetLastError();
+		if (classNameError != NO_ERROR)
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "classNameError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(classNameError, "ErrorCode"));
+		WindowInvestigator_FinishCapturedString(&windowStrings->className, classNameLength > 0 ? (size_t)classNameLength : 0);
 	}
 
-	windowInfo.placement.length = sizeof(windowInfo.placement);
-	if (!GetWindowPlacement(window, &windowInfo.placement))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "placementError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
-
-	SetLastError(NO_ERROR);
-	InternalGetWindowText(window, windowInfo.text, sizeof(windowInfo.text) / sizeof(*windowInfo.text));
-	const DWORD textError = GetLastError();
-	if (textError != NO_ERROR)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "textError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(textError, "ErrorCode"));
-
-	windowInfo.isShellManagedWindow = IsShellManagedWindow(window);
-
-	windowInfo.isShellFrameWindow = IsShellFrameWindow(window);
-
-	windowInfo.overpanning = GetPropW(window, (LPCWSTR) (intptr_t) ATOM_OVERPANNING) != NULL;
-
-	if (!GetWindowBand(window, &windowInfo.band))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "windowBandError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
-
-	windowInfo.hasNonRudeHWNDProperty = GetPropW(window, L"NonRudeHWND") != NULL;
-
-	windowInfo.hasNonRudeAddedByRudeWindowFixerProperty = GetPropW(window, L"NonRudeHWND was set by https://github.com/dechamps/RudeWindowFixer") != NULL;
-	
-	windowInfo.hasLivePreviewWindowProperty = GetPropW(window, L"LivePreviewWindow") != NULL;
-
-	windowInfo.hasTreatAsDesktopFullscreenProperty = GetPropW(window, L"TreatAsDesktopFullscreen") != NULL;
-
-	windowInfo.isWindow = IsWindow(window);
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_EXTENDED_STYLES)) {
+		SetLastError(NO_ERROR);
+		windowInfo->extendedStyles = (DWORD)GetWindowLongPtrW(window, GWL_EXSTYLE);
+		const DWORD extendedStylesError = GetLastError();
+		if (extendedStylesError != NO_ERROR)
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "extendedStylesError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(extendedStylesError, "ErrorCode"));
+	}
 
-	const HRESULT dwmIsCloakedResult = DwmGetWindowAttribute(window, DWMWA_CLOAKED, &windowInfo.dwmIsCloaked, sizeof(windowInfo.dwmIsCloaked));
-	if (!SUCCEEDED(dwmIsCloakedResult))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "dwmIsCloakedError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexLong(dwmIsCloakedResult, "HRESULT"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_STYLES)) {
+		SetLastError(NO_ERROR);
+		windowInfo->styles = (DWORD)GetWindowLongPtrW(window, GWL_STYLE);
+		const DWORD stylesError = GetLastError();
+		if (stylesError != NO_ERROR)
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "stylesError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(stylesError, "ErrorCode"));
+	}
 
-	windowInfo.isIconic = IsIconic(window);
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_WINDOW_RECT)) {
+		RECT windowRect;
+		if (!GetWindowRect(window, &windowRect))
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "windowRectError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
+		else
+			windowInfo->windowRect = WindowMonitor_ConvertRect(&windowRect);
+	}
 
-	windowInfo.isVisible = IsWindowVisible(window);
+	if (WindowMonitor_HasAnyField(fields, WindowInvestigator_WindowField_CLIENT_RECT, WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES)) {
+		RECT clientRect;
+		if (!GetClientRect(window, &clientRect))
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "clientRectError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
+		else {
+			if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_CLIENT_RECT))
+				windowInfo->clientRect = WindowMonitor_ConvertRect(&clientRect);
+
+			if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES)) {
+				SetLastError(NO_ERROR);
+				RECT rect = clientRect;
+				MapWindowPoints(window, NULL, (LPPOINT)&rect, 2);
+				const DWORD clientRectMapWindowPointsError = GetLastError();
+				if (clientRectMapWindowPointsError != NO_ERROR)
+					TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "clientRectMapWindowPointsError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(clientRectMapWindowPointsError, "ErrorCode"));
+				else
+					windowInfo->clientRectInScreenCoordinates = WindowMonitor_ConvertRect(&rect);
+			}
+		}
+	}
 
-	return windowInfo;
-}
+	if (WindowMonitor_HasAnyField(fields, WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD, WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION)) {
+		WINDOWPLACEMENT placement;
+		placement.length = sizeof(placement);
+		if (!GetWindowPlacement(window, &placement))
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "placementError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
+		else {
+			if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD))
+				windowInfo->placement.showCmd = placement.showCmd;
+			if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION)) {
+				windowInfo->placement.minPosition.x = placement.ptMinPosition.x;
+				windowInfo->placement.minPosition.y = placement.ptMinPosition.y;
+			}
+			if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION)) {
+				windowInfo->placement.maxPosition.x = placement.ptMaxPosition.x;
+				windowInfo->placement.maxPosition.y = placement.ptMaxPosition.y;
+			}
+			if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION))
+				windowInfo->placement.normalPosition = WindowMonitor_ConvertRect(&placement.rcNormalPosition);
+		}
+	}
 
-static void WindowMonitor_LogWindowInfo(HWND window, const WindowMonitor_WindowInfo* windowInfo) {
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowLogStart", TraceLoggingPointer(window, "HWND"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_TEXT)) {
+		SetLastError(NO_ERROR);
+		const int textLength = InternalGetWindowText(window, windowStrings->text.string, sizeof(windowStrings->text.string) / sizeof(*windowStrings->text.string));
+		const DWORD textError = GetLastError();
+		if (textError != NO_ERROR)
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "textError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(textError, "ErrorCode"));
+		WindowInvestigator_FinishCapturedString(&windowStrings->text, textLength > 0 ? (size_t)textLength : 0);
+	}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowProcessId", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingUInt32(windowInfo->processId, "ProcessId"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW))
+		windowInfo->isShellManagedWindow = IsShellManagedWindow(window);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowThreadId", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingUInt32(windowInfo->threadId, "ThreadId"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW))
+		windowInfo->isShellFrameWindow = IsShellFrameWindow(window);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowClassName", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingWideString(windowInfo->className, "ClassName"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_OVERPANNING))
+		windowInfo->overpanning = GetPropW(window, (LPCWSTR) (intptr_t) ATOM_OVERPANNING) != NULL;
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowExtendedStyles", TraceLoggingPointer(window, "HWND"),
-		 TraceLoggingHexUInt32(windowInfo->extendedStyles, "ExtendedStyles"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_BAND)) {
+		DWORD band;
+		if (!GetWindowBand(window, &band))
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "windowBandError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexUInt32(GetLastError(), "ErrorCode"));
+		else
+			windowInfo->band = band;
+	}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowStyles", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingHexUInt32(windowInfo->styles, "Styles"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY))
+		windowInfo->hasNonRudeHWNDProperty = GetPropW(window, L"NonRudeHWND") != NULL;
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowRect", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingLong(windowInfo->windowRect.left, "WindowRectLeft"), TraceLoggingLong(windowInfo->windowRect.top, "WindowRectTop"),
-		TraceLoggingLong(windowInfo->windowRect.right, "WindowRectRight"), TraceLoggingLong(windowInfo->windowRect.bottom, "WindowRectBottom"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY))
+		windowInfo->hasNonRudeAddedByRudeWindowFixerProperty = GetPropW(window, L"NonRudeHWND was set by https://github.com/dechamps/RudeWindowFixer") != NULL;
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowClientRect", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingLong(windowInfo->clientRect.left, "ClientRectLeft"), TraceLoggingLong(windowInfo->clientRect.top, "ClientRectTop"),
-		TraceLoggingLong(windowInfo->clientRect.right, "ClientRectRight"), TraceLoggingLong(windowInfo->clientRect.bottom, "ClientRectBottom"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY))
+		windowInfo->hasLivePreviewWindowProperty = GetPropW(window, L"LivePreviewWindow") != NULL;
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowClientRectInScreenCoordinates", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingLong(windowInfo->clientRectInScreenCoordinates.left, "ClientRectInScreenCoordinatesLeft"), TraceLoggingLong(windowInfo->clientRectInScreenCoordinates.top, "ClientRectInScreenCoordinatesTop"),
-		TraceLoggingLong(windowInfo->clientRectInScreenCoordinates.right, "ClientRectInScreenCoordinatesRight"), TraceLoggingLong(windowInfo->clientRectInScreenCoordinates.bottom, "ClientRectInScreenCoordinatesBottom"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY))
+		windowInfo->hasTreatAsDesktopFullscreenProperty = GetPropW(window, L"TreatAsDesktopFullscreen") != NULL;
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementShowCmd", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingUInt32(windowInfo->placement.showCmd, "ShowCmd"));
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementMinPosition", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingLong(windowInfo->placement.ptMinPosition.x, "MinPositionX"), TraceLoggingLong(windowInfo->placement.ptMinPosition.y, "MinPositionY"),
-		TraceLoggingLong(windowInfo->placement.ptMinPosition.x, "MinPositionX"), TraceLoggingLong(windowInfo->placement.ptMinPosition.y, "MinPositionY"));
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementMaxPosition", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingLong(windowInfo->placement.ptMaxPosition.x, "MaxPositionX"), TraceLoggingLong(windowInfo->placement.ptMaxPosition.y, "MaxPositionY"));
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementClientRect", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingLong(windowInfo->placement.rcNormalPosition.left, "ClientRectLeft"), TraceLoggingLong(windowInfo->placement.rcNormalPosition.top, "ClientRectTop"),
-		TraceLoggingLong(windowInfo->placement.rcNormalPosition.right, "ClientRectRight"), TraceLoggingLong(windowInfo->placement.rcNormalPosition.bottom, "ClientRectBottom"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_IS_WINDOW))
+		windowInfo->isWindow = IsWindow(window);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowText", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingWideString(windowInfo->text, "WindowText"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_DWM_IS_CLOAKED)) {
+		DWORD dwmIsCloaked;
+		const HRESULT dwmIsCloakedResult = DwmGetWindowAttribute(window, DWMWA_CLOAKED, &dwmIsCloaked, sizeof(dwmIsCloaked));
+		if (!SUCCEEDED(dwmIsCloakedResult))
+			TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "dwmIsCloakedError", TraceLoggingPointer(window, "HWND"), TraceLoggingHexLong(dwmIsCloakedResult, "HRESULT"));
+		else
+			windowInfo->dwmIsCloaked = dwmIsCloaked;
+	}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsShellManagedWindow", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->isShellManagedWindow, "IsShellManagedWindow"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_IS_ICONIC))
+		windowInfo->isIconic = IsIconic(window);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsShellFrameWindow", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->isShellFrameWindow, "IsShellFrameWindow"));
+	if (WindowMonitor_HasField(fields, WindowInvestigator_WindowField_IS_VISIBLE))
+		windowInfo->isVisible = IsWindowVisible(window);
+}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowOverpanning", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->overpanning, "Overpanning"));
+// Runs on the event queue writer thread. ETW timestamps reflect when the event is written, which can be some time after the
+// change was detected, so the time of detection is logged as well.
+//
+// The context is a WindowMonitor_EventOutput.
+typedef struct {
+	// NULL if there is no capture file.
+	WindowInvestigator_CaptureWriter* captureWriter;
+	// NULL if the output format is text.
+	WindowInvestigator_StructuredWriter* structuredWriter;
+} WindowMonitor_EventOutput;
+
+static void WindowMonitor_WriteEvent(void* context, const WindowInvestigator_MonitorEvent* event) {
+	const WindowMonitor_EventOutput* const output = context;
+	WindowInvestigator_CaptureWriter* const captureWriter = output->captureWriter;
+	if (captureWriter != NULL && !captureWriter->failed && !WindowInvestigator_CaptureWriter_WriteEvent(captureWriter, event))
+		fprintf(stderr, "Unable to write to capture file, capture stopped\n");
+	WindowInvestigator_StructuredWriter* const structuredWriter = output->structuredWriter;
+	if (structuredWriter != NULL && !structuredWriter->failed) {
+		WindowInvestigator_StructuredWriter_WriteEvent(structuredWriter, event->timestamp, event->window, event->type, event->zOrder, event->previousZOrder, event->record, event->recordSize);
+		// Events are few and far between, and whoever reads the output (e.g. a script at the other end of a pipe) wants them as
+		// they happen.
+		if (!WindowInvestigator_StructuredWriter_Flush(structuredWriter) || fflush(structuredWriter->file) != 0) {
+			structuredWriter->failed = true;
+			fprintf(stderr, "Unable to write output, output stopped\n");
+		}
+	}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowBand", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingUInt32(windowInfo->band, "Band"));
+	const HWND window = (HWND)(uintptr_t)event->window;
+	switch (event->type) {
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "NewWindow", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt64(event->timestamp, "Timestamp"),
+			TraceLoggingUInt32(event->zOrder, "newZOrder"), TraceLoggingBinary(event->record, (UINT16)event->recordSize, "Record"));
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowChanged", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt64(event->timestamp, "Timestamp"),
+			TraceLoggingHexUInt32(event->fields, "ChangedFields"), TraceLoggingBinary(event->record, (UINT16)event->recordSize, "Record"));
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowZOrderChanged", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt64(event->timestamp, "Timestamp"),
+			TraceLoggingUInt32(event->previousZOrder, "oldZOrder"), TraceLoggingUInt32(event->zOrder, "newZOrder"));
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowGone", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt64(event->timestamp, "Timestamp"));
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowSnapshot", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt64(event->timestamp, "Timestamp"),
+			TraceLoggingUInt32(event->zOrder, "ZOrder"), TraceLoggingBinary(event->record, (UINT16)event->recordSize, "Record"));
+		break;
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "ZOrderUpdated", TraceLoggingUInt64(event->timestamp, "Timestamp"), TraceLoggingUInt32(event->zOrder, "WindowCount"));
+		break;
+	case WindowInvestigator_MonitorEvent_KEYFRAME:
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Keyframe", TraceLoggingUInt64(event->timestamp, "Timestamp"), TraceLoggingUInt32(event->zOrder, "WindowCount"));
+		break;
+	case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE:
+		// Already logged as ReceivedMessage when the message was received; only queued for the capture file.
+		break;
+	case WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED: {
+		uint64_t previousWindow;
+		WindowInvestigator_Rect monitorRect;
+		if (!WindowInvestigator_DecodeRudeWindowChanged(event->record, event->recordSize, &previousWindow, &monitorRect)) break;
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "RudeWindowChanged", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt64(event->timestamp, "Timestamp"),
+			TraceLoggingUInt32(event->zOrder, "Monitor"), TraceLoggingInt32(monitorRect.left, "MonitorLeft"), TraceLoggingInt32(monitorRect.top, "MonitorTop"),
+			TraceLoggingInt32(monitorRect.right, "MonitorRight"), TraceLoggingInt32(monitorRect.bottom, "MonitorBottom"), TraceLoggingPointer((HWND)(uintptr_t)previousWindow, "PreviousHWND"));
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_EVENTS_DROPPED: {
+		uint64_t droppedCount;
+		if (!WindowInvestigator_DecodeEventsDropped(event->record, event->recordSize, &droppedCount)) break;
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "EventsDropped", TraceLoggingUInt64(event->timestamp, "Timestamp"), TraceLoggingUInt64(droppedCount, "DroppedCount"));
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_TICK_FINISHED:
+		// Only queued for the capture file, so that captures can be replayed tick by tick.
+		break;
+	}
+}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasNonRudeHWNDProperty", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->hasNonRudeHWNDProperty, "HasNonRudeHWNDProperty"));
+// Large enough to absorb a full snapshot of a busy desktop while the writer thread catches up.
+#define WindowMonitor_EVENT_QUEUE_CAPACITY 1024
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasNonRudeAddedByRudeWindowFixerProperty", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->hasNonRudeAddedByRudeWindowFixerProperty, "HasNonRudeAddedByRudeWindowFixerProperty"));
+static uintptr_t WindowMonitor_GetNextWindow(void* context, uintptr_t window) {
+	UNREFERENCED_PARAMETER(context);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasLivePreviewWindowProperty", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->hasLivePreviewWindowProperty, "HasLivePreviewWindowProperty"));
+	// Note: we don't use EnumWindows because that won't return windows with band != 1 (DESKTOP). See https://wj32.org/wp/2012/12/12/enumwindows-no-longer-finds-metromodern-ui-windows-a-workaround-2/
+	return (uintptr_t)FindWindowExW(NULL, (HWND)window, NULL, NULL);
+}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasTreatAsDesktopFullscreenProperty", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->hasTreatAsDesktopFullscreenProperty, "HasTreatAsDesktopFullscreenProperty"));
+static bool WindowMonitor_IsWindowVisible(void* context, uintptr_t window) {
+	UNREFERENCED_PARAMETER(context);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsWindow", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->isWindow, "IsWindow"));
+	return IsWindowVisible((HWND)window);
+}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowDwmIsCloaked", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingUInt32(windowInfo->dwmIsCloaked, "DwmIsCloaked"));
+static void WindowMonitor_GetBackendWindowInfo(void* context, uintptr_t window, uint32_t fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings) {
+	UNREFERENCED_PARAMETER(context);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsIconic", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->isIconic, "IsIconic"));
+	WindowMonitor_GetWindowInfo((HWND)window, fields, windowInfo, windowStrings);
+}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsVisible", TraceLoggingPointer(window, "HWND"),
-		TraceLoggingBool(windowInfo->isVisible, "IsVisible"));
+// Posted to the WindowMonitor window by the monitor workers once window properties have been collected.
+#define WindowMonitor_WM_TICK_READY (WM_APP + 0)
+// Posted to the WindowMonitor window by the ticker in filtered mode.
+#define WindowMonitor_WM_TICK_REQUESTED (WM_APP + 1)
+
+// Returns false if the image name could not be retrieved, e.g. because the process belongs to another user.
+static bool WindowMonitor_GetProcessImageName(DWORD processId, wchar_t* imageName, DWORD imageNameCapacity) {
+	const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+	if (process == NULL) return false;
+	const bool result = QueryFullProcessImageNameW(process, 0, imageName, &imageNameCapacity) != 0;
+	CloseHandle(process);
+	return result;
+}
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowLogEnd", TraceLoggingPointer(window, "HWND"));
+// Only called once for each window that appears, so the image name is not worth caching.
+static bool WindowMonitor_FilterWindow(void* context, uintptr_t window) {
+	const WindowInvestigator_WindowFilter* const filter = context;
+	const HWND windowHandle = (HWND)window;
+	DWORD processId = 0;
+	GetWindowThreadProcessId(windowHandle, &processId);
+	wchar_t className[256];
+	const bool hasClassName = WindowInvestigator_WindowFilter_UsesClassName(filter) && GetClassNameW(windowHandle, className, sizeof(className) / sizeof(*className)) > 0;
+	wchar_t imageName[MAX_PATH];
+	const bool hasImageName = WindowInvestigator_WindowFilter_UsesImageName(filter) && WindowMonitor_GetProcessImageName(processId, imageName, sizeof(imageName) / sizeof(*imageName));
+	return WindowInvestigator_WindowFilter_Matches(filter, window, processId, hasClassName ? className : NULL, hasImageName ? imageName : NULL);
 }
 
-static void WindowMonitor_DiffWindowInfo(HWND window, const WindowMonitor_WindowInfo* oldWindowInfo, const WindowMonitor_WindowInfo* newWindowInfo) {
-	if (oldWindowInfo->processId != newWindowInfo->processId)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowProcessIdChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingUInt32(oldWindowInfo->processId, "OldProcessId"), TraceLoggingUInt32(newWindowInfo->processId, "NewProcessId"));
-
-	if (oldWindowInfo->threadId != newWindowInfo->threadId)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowThreadIdChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingUInt32(oldWindowInfo->threadId, "OldThreadId"), TraceLoggingUInt32(newWindowInfo->threadId, "NewThreadId"));
-	
-	if (wcscmp(oldWindowInfo->className, newWindowInfo->className) != 0)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowClassNameChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingWideString(oldWindowInfo->className, "OldClassName"), TraceLoggingWideString(newWindowInfo->className, "NewClassName"));
-
-	if (oldWindowInfo->extendedStyles != newWindowInfo->extendedStyles)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowExtendedStylesChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingHexUInt32(oldWindowInfo->extendedStyles, "OldExtendedStyles"), TraceLoggingHexUInt32(newWindowInfo->extendedStyles, "NewExtendedStyles"));
-
-	if (oldWindowInfo->styles != newWindowInfo->styles)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowStylesChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingHexUInt32(oldWindowInfo->styles, "OldStyles"), TraceLoggingHexUInt32(newWindowInfo->styles, "NewStyles"));
-
-	if (!EqualRect(&oldWindowInfo->windowRect, &newWindowInfo->windowRect))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowRectChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingLong(oldWindowInfo->windowRect.left, "OldWindowRectLeft"), TraceLoggingLong(oldWindowInfo->windowRect.top, "OldWindowRectTop"),
-			TraceLoggingLong(oldWindowInfo->windowRect.right, "OldWindowRectRight"), TraceLoggingLong(oldWindowInfo->windowRect.bottom, "OldWindowRectBottom"),
-			TraceLoggingLong(newWindowInfo->windowRect.left, "NewWindowRectLeft"), TraceLoggingLong(newWindowInfo->windowRect.top, "NewWindowRectTop"),
-			TraceLoggingLong(newWindowInfo->windowRect.right, "NewWindowRectRight"), TraceLoggingLong(newWindowInfo->windowRect.bottom, "NewWindowRectBottom"));
-
-	if (!EqualRect(&oldWindowInfo->clientRect, &newWindowInfo->clientRect))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowClientRectChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingLong(oldWindowInfo->clientRect.left, "OldClientRectLeft"), TraceLoggingLong(oldWindowInfo->clientRect.top, "OldClientRectTop"),
-			TraceLoggingLong(oldWindowInfo->clientRect.right, "OldClientRectRight"), TraceLoggingLong(oldWindowInfo->clientRect.bottom, "OldClientRectBottom"),
-			TraceLoggingLong(newWindowInfo->clientRect.left, "NewClientRectLeft"), TraceLoggingLong(newWindowInfo->clientRect.top, "NewClientRectTop"),
-			TraceLoggingLong(newWindowInfo->clientRect.right, "NewClientRectRight"), TraceLoggingLong(newWindowInfo->clientRect.bottom, "NewClientRectBottom"));
-
-	if (!EqualRect(&oldWindowInfo->clientRectInScreenCoordinates, &newWindowInfo->clientRectInScreenCoordinates))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowClientRectInScreenCoordinatesChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingLong(oldWindowInfo->clientRectInScreenCoordinates.left, "OldClientRectInScreenCoordinatesLeft"), TraceLoggingLong(oldWindowInfo->clientRectInScreenCoordinates.top, "OldClientRectInScreenCoordinatesTop"),
-			TraceLoggingLong(oldWindowInfo->clientRectInScreenCoordinates.right, "OldClientRectInScreenCoordinatesRight"), TraceLoggingLong(oldWindowInfo->clientRectInScreenCoordinates.bottom, "OldClientRectInScreenCoordinatesBottom"),
-			TraceLoggingLong(newWindowInfo->clientRectInScreenCoordinates.left, "NewClientRectInScreenCoordinatesLeft"), TraceLoggingLong(newWindowInfo->clientRectInScreenCoordinates.top, "NewClientRectInScreenCoordinatesTop"),
-			TraceLoggingLong(newWindowInfo->clientRectInScreenCoordinates.right, "NewClientRectInScreenCoordinatesRight"), TraceLoggingLong(newWindowInfo->clientRectInScreenCoordinates.bottom, "NewClientRectInScreenCoordinatesBottom"));
-
-	if (oldWindowInfo->placement.showCmd != newWindowInfo->placement.showCmd)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementShowCmdChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingUInt32(oldWindowInfo->placement.showCmd, "OldShowCmd"), TraceLoggingUInt32(newWindowInfo->placement.showCmd, "NewShowCmd"));
-	if (oldWindowInfo->placement.ptMinPosition.x != newWindowInfo->placement.ptMinPosition.x ||
-		oldWindowInfo->placement.ptMinPosition.y != newWindowInfo->placement.ptMinPosition.y)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementMinPositionChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingLong(oldWindowInfo->placement.ptMinPosition.x, "OldMinPositionX"), TraceLoggingLong(oldWindowInfo->placement.ptMinPosition.y, "OldMinPositionY"),
-			TraceLoggingLong(newWindowInfo->placement.ptMinPosition.x, "NewMinPositionX"), TraceLoggingLong(newWindowInfo->placement.ptMinPosition.y, "NewMinPositionY"));
-	if (oldWindowInfo->placement.ptMaxPosition.x != newWindowInfo->placement.ptMaxPosition.x ||
-		oldWindowInfo->placement.ptMaxPosition.y != newWindowInfo->placement.ptMaxPosition.y)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementMaxPositionChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingLong(oldWindowInfo->placement.ptMaxPosition.x, "OldMaxPositionX"), TraceLoggingLong(oldWindowInfo->placement.ptMaxPosition.y, "OldMaxPositionY"),
-			TraceLoggingLong(newWindowInfo->placement.ptMaxPosition.x, "NewMaxPositionX"), TraceLoggingLong(newWindowInfo->placement.ptMaxPosition.y, "NewMaxPositionY"));
-	if (!EqualRect(&oldWindowInfo->placement.rcNormalPosition, &newWindowInfo->placement.rcNormalPosition))
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "PlacementClientRectChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingLong(oldWindowInfo->placement.rcNormalPosition.left, "OldClientRectLeft"), TraceLoggingLong(oldWindowInfo->placement.rcNormalPosition.top, "OldClientRectTop"),
-			TraceLoggingLong(oldWindowInfo->placement.rcNormalPosition.right, "OldClientRectRight"), TraceLoggingLong(oldWindowInfo->placement.rcNormalPosition.bottom, "OldClientRectBottom"),
-			TraceLoggingLong(newWindowInfo->placement.rcNormalPosition.left, "NewClientRectLeft"), TraceLoggingLong(newWindowInfo->placement.rcNormalPosition.top, "NewClientRectTop"),
-			TraceLoggingLong(newWindowInfo->placement.rcNormalPosition.right, "NewClientRectRight"), TraceLoggingLong(newWindowInfo->placement.rcNormalPosition.bottom, "NewClientRectBottom"));
-
-	if (wcscmp(oldWindowInfo->text, newWindowInfo->text) != 0)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowTextChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingWideString(oldWindowInfo->text, "OldWindowText"), TraceLoggingWideString(newWindowInfo->text, "NewWindowText"));
-
-	if (oldWindowInfo->isShellManagedWindow != newWindowInfo->isShellManagedWindow)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsShellManagedWindowChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->isShellManagedWindow, "OldIsShellManagedWindow"), TraceLoggingBool(newWindowInfo->isShellManagedWindow, "NewIsShellManagedWindow"));
-
-	if (oldWindowInfo->isShellFrameWindow != newWindowInfo->isShellFrameWindow)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsShellFrameWindowChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->isShellFrameWindow, "OldIsShellFrameWindow"), TraceLoggingBool(newWindowInfo->isShellFrameWindow, "NewIsShellFrameWindow"));
-
-	if (oldWindowInfo->overpanning != newWindowInfo->overpanning)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowOverpanningChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->overpanning, "OldOverpanning"), TraceLoggingBool(newWindowInfo->overpanning, "NewOverpanning"));
-
-	if (oldWindowInfo->band != newWindowInfo->band)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowBandChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingUInt32(oldWindowInfo->band, "OldBand"), TraceLoggingUInt32(newWindowInfo->band, "NewBand"));
-
-	if (oldWindowInfo->hasNonRudeHWNDProperty != newWindowInfo->hasNonRudeHWNDProperty)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasNonRudeHWNDPropertyChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->hasNonRudeHWNDProperty, "OldHasNonRudeHWNDProperty"), TraceLoggingBool(newWindowInfo->hasNonRudeHWNDProperty, "NewHasNonRudeHWNDProperty"));
-
-	if (oldWindowInfo->hasNonRudeAddedByRudeWindowFixerProperty != newWindowInfo->hasNonRudeAddedByRudeWindowFixerProperty)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasNonRudeAddedByRudeWindowFixerPropertyChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->hasNonRudeAddedByRudeWindowFixerProperty, "OldHasNonRudeAddedByRudeWindowFixerProperty"), TraceLoggingBool(newWindowInfo->hasNonRudeAddedByRudeWindowFixerProperty, "NewHasNonRudeAddedByRudeWindowFixerProperty"));
-
-	if (oldWindowInfo->hasLivePreviewWindowProperty != newWindowInfo->hasLivePreviewWindowProperty)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasLivePreviewWindowPropertyChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->hasLivePreviewWindowProperty, "OldHasLivePreviewWindowProperty"), TraceLoggingBool(newWindowInfo->hasLivePreviewWindowProperty, "NewHasLivePreviewWindowProperty"));
-
-	if (oldWindowInfo->hasTreatAsDesktopFullscreenProperty != newWindowInfo->hasTreatAsDesktopFullscreenProperty)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowHasTreatAsDesktopFullscreenPropertyChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->hasTreatAsDesktopFullscreenProperty, "OldHasTreatAsDesktopFullscreenProperty"), TraceLoggingBool(newWindowInfo->hasTreatAsDesktopFullscreenProperty, "NewHasTreatAsDesktopFullscreenProperty"));
-
-	if (oldWindowInfo->isWindow != newWindowInfo->isWindow)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsWindowChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->isWindow, "OldIsWindow"), TraceLoggingBool(newWindowInfo->isWindow, "NewIsWindow"));
-
-	if (oldWindowInfo->dwmIsCloaked != newWindowInfo->dwmIsCloaked)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowDwmIsCloakedChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingUInt32(oldWindowInfo->dwmIsCloaked, "OldDwmIsCloaked"), TraceLoggingUInt32(newWindowInfo->dwmIsCloaked, "NewDwmIsCloaked"));
-
-	if (oldWindowInfo->isIconic != newWindowInfo->isIconic)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsIconicChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->isIconic, "OldIsIconic"), TraceLoggingBool(newWindowInfo->isIconic, "NewIsIconic"));
-
-	if (oldWindowInfo->isVisible != newWindowInfo->isVisible)
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowIsVisibleChanged", TraceLoggingPointer(window, "HWND"),
-			TraceLoggingBool(oldWindowInfo->isVisible, "OldIsVisible"), TraceLoggingBool(newWindowInfo->isVisible, "NewIsVisible"));
-}
-
-struct WindowMonitor_Window_s {
+// In filtered mode, there are few enough windows to sample that ticks can be much more frequent than the messages that
+// normally trigger them. The ticker is a thread that requests a tick every period; ticks still happen on the thread that
+// receives messages, which stays available to timestamp them in between.
+typedef struct {
 	HWND window;
-	struct WindowMonitor_Window_s* next;
-	BOOL seen;
-	WindowMonitor_WindowInfo info;
-};
-typedef struct WindowMonitor_Window_s WindowMonitor_Window;
+	WindowInvestigator_PeriodicTimerOptions timerOptions;
+	volatile uint64_t stopping;
+	WindowInvestigator_Thread thread;
+} WindowMonitor_Ticker;
+
+static void WindowMonitor_RunTicker(void* context) {
+	WindowMonitor_Ticker* const ticker = context;
+	WindowInvestigator_PeriodicTimer timer;
+	WindowInvestigator_PeriodicTimer_Init(&timer, &ticker->timerOptions);
+	while (WindowInvestigator_Atomic_LoadAcquire(&ticker->stopping) == 0) {
+		WindowInvestigator_PeriodicTimer_Wait(&timer);
+		if (!PostMessageW(ticker->window, WindowMonitor_WM_TICK_REQUESTED, 0, 0)) {
+			fprintf(stderr, "PostMessageW() failed [0x%x]\n", GetLastError());
+			break;
+		}
+	}
+	WindowInvestigator_PeriodicTimer_Destroy(&timer);
+}
 
 typedef struct {
-	WindowMonitor_Window* foregroundWindow;
+	HWND window;
+	WindowInvestigator_Monitor monitor;
+	WindowInvestigator_EventQueue eventQueue;
+	WindowInvestigator_RudeWindowEngine rudeWindowEngine;
+	// Period of the timer that triggers passes.
+	WindowInvestigator_TickCadence cadence;
+	// 0 until registered.
+	UINT shellhookMessage;
 	time_t lastLog;
+	bool logWindowsAfterTick;
+	// Set if a message was received while a tick was in progress.
+	bool tickRequested;
+	// When the earliest message that the tick in progress accounts for was received, and the same for the next tick, or 0 if
+	// there is no such message.
+	uint64_t tickMessageTime;
+	uint64_t requestedTickMessageTime;
+	// Time between receiving a message and being done with the tick that accounts for it, in nanoseconds.
+	WindowInvestigator_Histogram* messageToDoneLatencies;
+	// Scratch space for WindowMonitor_GetLatencies().
+	WindowInvestigator_Histogram* latencies;
 } State;
 
+static void WindowMonitor_OnTickReady(void* context) {
+	const State* const state = context;
+	if (!PostMessageW(state->window, WindowMonitor_WM_TICK_READY, 0, 0)) {
+		fprintf(stderr, "PostMessageW() failed [0x%x]\n", GetLastError());
+		exit(EXIT_FAILURE);
+	}
+}
 
-static void WindowMonitor_LogTopLevelWindows(const WindowMonitor_Window* window) {
-	while (window != NULL) {
-		WindowMonitor_LogWindowInfo(window->window, &window->info);
-		window = window->next;
+static void WindowMonitor_LogSamplingCosts(const WindowInvestigator_Monitor* monitor) {
+	UINT64 sampleCounts[WindowInvestigator_WindowField_COUNT];
+	UINT64 nanoseconds[WindowInvestigator_WindowField_COUNT];
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field) {
+		sampleCounts[field] = monitor->sampling.costs[field].sampleCount;
+		nanoseconds[field] = monitor->sampling.costs[field].nanoseconds;
 	}
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "FieldSamplingCosts",
+		TraceLoggingUInt64(monitor->statistics.fieldsSampled, "FieldsSampled"),
+		TraceLoggingUInt64Array(sampleCounts, WindowInvestigator_WindowField_COUNT, "SampleCounts"),
+		TraceLoggingUInt64Array(nanoseconds, WindowInvestigator_WindowField_COUNT, "Nanoseconds"));
 }
 
-static WindowMonitor_Window** WindowMonitor_SearchWindow(WindowMonitor_Window** window, HWND match) {
-	for (; *window != NULL && (*window)->window != match; window = &(*window)->next);
-	return window;
+static void WindowMonitor_LogEventQueueStatistics(const WindowInvestigator_EventQueue* eventQueue) {
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "EventQueueStatistics",
+		TraceLoggingUInt64(WindowInvestigator_EventQueue_GetHighWaterMark(eventQueue), "HighWaterMark"),
+		TraceLoggingUInt64(WindowInvestigator_EventQueue_GetDroppedCount(eventQueue), "Dropped"));
 }
 
-static void WindowMonitor_MarkAllWindowsUnseen(WindowMonitor_Window* window) {
-	for (; window != NULL; window = window->next)
-		window->seen = FALSE;
+// The phases of a tick (see WindowInvestigator_MonitorPhase), followed by event emission (how long it takes to write one event
+// to ETW and the capture file) and the latency between receiving a message and being done with the corresponding tick.
+#define WindowMonitor_LATENCY_EMISSION WindowInvestigator_MonitorPhase_COUNT
+#define WindowMonitor_LATENCY_MESSAGE_TO_DONE (WindowInvestigator_MonitorPhase_COUNT + 1)
+#define WindowMonitor_LATENCY_COUNT (WindowInvestigator_MonitorPhase_COUNT + 2)
+
+static const char* WindowMonitor_GetLatencyName(size_t latency) {
+	if (latency < WindowInvestigator_MonitorPhase_COUNT) return WindowInvestigator_MonitorPhase_GetName((WindowInvestigator_MonitorPhase)latency);
+	return latency == WindowMonitor_LATENCY_EMISSION ? "Emission" : "MessageToDone";
 }
 
-static void WindowMonitor_RemoveUnseenWindows(WindowMonitor_Window** nextWindow) {
-	while (*nextWindow != NULL) {
-		WindowMonitor_Window* const window = *nextWindow;
-		if (window->seen) {
-			nextWindow = &window->next;
-			continue;
-		}
-		
-		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowGone", TraceLoggingPointer(window->window, "HWND"));
-		*nextWindow = window->next;
-		free(window);
+// Fills state->latencies with every latency recorded since startup. Must not be called while a tick is in progress.
+static void WindowMonitor_GetLatencies(State* state) {
+	for (size_t latency = 0; latency < WindowMonitor_LATENCY_COUNT; ++latency)
+		WindowInvestigator_Histogram_Reset(&state->latencies[latency]);
+	for (int phase = 0; phase < WindowInvestigator_MonitorPhase_COUNT; ++phase)
+		WindowInvestigator_Monitor_GetPhaseDurations(&state->monitor, (WindowInvestigator_MonitorPhase)phase, &state->latencies[phase]);
+	WindowInvestigator_EventQueue_GetEmissionDurations(&state->eventQueue, &state->latencies[WindowMonitor_LATENCY_EMISSION]);
+	WindowInvestigator_Histogram_Merge(&state->latencies[WindowMonitor_LATENCY_MESSAGE_TO_DONE], state->messageToDoneLatencies);
+}
+
+// Compact form of the latency histograms: each field is an array with one element per latency, in the order above.
+static void WindowMonitor_LogLatencies(State* state) {
+	WindowMonitor_GetLatencies(state);
+	UINT64 counts[WindowMonitor_LATENCY_COUNT];
+	UINT64 means[WindowMonitor_LATENCY_COUNT];
+	UINT64 p50s[WindowMonitor_LATENCY_COUNT];
+	UINT64 p90s[WindowMonitor_LATENCY_COUNT];
+	UINT64 p99s[WindowMonitor_LATENCY_COUNT];
+	UINT64 p999s[WindowMonitor_LATENCY_COUNT];
+	UINT64 maxs[WindowMonitor_LATENCY_COUNT];
+	for (size_t latency = 0; latency < WindowMonitor_LATENCY_COUNT; ++latency) {
+		const WindowInvestigator_Histogram* const histogram = &state->latencies[latency];
+		counts[latency] = histogram->count;
+		means[latency] = WindowInvestigator_Histogram_GetMean(histogram);
+		p50s[latency] = WindowInvestigator_Histogram_GetPercentile(histogram, 50);
+		p90s[latency] = WindowInvestigator_Histogram_GetPercentile(histogram, 90);
+		p99s[latency] = WindowInvestigator_Histogram_GetPercentile(histogram, 99);
+		p999s[latency] = WindowInvestigator_Histogram_GetPercentile(histogram, 99.9);
+		maxs[latency] = WindowInvestigator_Histogram_GetPercentile(histogram, 100);
 	}
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Latencies",
+		TraceLoggingUInt64Array(counts, WindowMonitor_LATENCY_COUNT, "Counts"),
+		TraceLoggingUInt64Array(means, WindowMonitor_LATENCY_COUNT, "MeanNanoseconds"),
+		TraceLoggingUInt64Array(p50s, WindowMonitor_LATENCY_COUNT, "P50Nanoseconds"),
+		TraceLoggingUInt64Array(p90s, WindowMonitor_LATENCY_COUNT, "P90Nanoseconds"),
+		TraceLoggingUInt64Array(p99s, WindowMonitor_LATENCY_COUNT, "P99Nanoseconds"),
+		TraceLoggingUInt64Array(p999s, WindowMonitor_LATENCY_COUNT, "P999Nanoseconds"),
+		TraceLoggingUInt64Array(maxs, WindowMonitor_LATENCY_COUNT, "MaxNanoseconds"));
 }
 
-static void WindowMonitor_DiffTopLevelWindows(State* const state) {
-	WindowMonitor_MarkAllWindowsUnseen(state->foregroundWindow);
+static void WindowMonitor_PrintLatencies(State* state, FILE* file) {
+	WindowMonitor_GetLatencies(state);
+	const char* names[WindowMonitor_LATENCY_COUNT];
+	const WindowInvestigator_Histogram* histograms[WindowMonitor_LATENCY_COUNT];
+	for (size_t latency = 0; latency < WindowMonitor_LATENCY_COUNT; ++latency) {
+		names[latency] = WindowMonitor_GetLatencyName(latency);
+		histograms[latency] = &state->latencies[latency];
+	}
+	fprintf(file, "Latencies (ns):\n");
+	WindowInvestigator_Histogram_PrintPercentileTable(file, names, histograms, WindowMonitor_LATENCY_COUNT);
+}
 
-	WindowMonitor_Window** currentWindowPtr = &state->foregroundWindow;
-	UINT32 zOrder = 0;
-	HWND window = NULL;
-	for (;;) {
-		// Note: we don't use EnumWindows because that won't return windows with band != 1 (DESKTOP). See https://wj32.org/wp/2012/12/12/enumwindows-no-longer-finds-metromodern-ui-windows-a-workaround-2/
-		window = FindWindowExW(NULL, window, NULL, NULL);
-		if (window == NULL) break;
+typedef struct {
+	WindowInvestigator_Rect monitors[WindowInvestigator_RudeWindowEngine_MAX_MONITORS];
+	size_t monitorCount;
+} WindowMonitor_MonitorLayout;
+
+static BOOL CALLBACK WindowMonitor_AddMonitor(HMONITOR monitor, HDC deviceContext, LPRECT rect, LPARAM context) {
+	UNREFERENCED_PARAMETER(monitor);
+	UNREFERENCED_PARAMETER(deviceContext);
+
+	WindowMonitor_MonitorLayout* const layout = (WindowMonitor_MonitorLayout*)context;
+	if (layout->monitorCount == WindowInvestigator_RudeWindowEngine_MAX_MONITORS) return FALSE;
+	layout->monitors[layout->monitorCount++] = WindowMonitor_ConvertRect(rect);
+	return TRUE;
+}
 
-		if (!IsWindowVisible(window)) continue;
+// There is no cheap way to get notified of display changes from a message-only window, so this is called periodically.
+static void WindowMonitor_UpdateMonitorLayout(State* state) {
+	WindowMonitor_MonitorLayout layout;
+	layout.monitorCount = 0;
+	if (!EnumDisplayMonitors(NULL, NULL, WindowMonitor_AddMonitor, (LPARAM)&layout) && layout.monitorCount != WindowInvestigator_RudeWindowEngine_MAX_MONITORS) {
+		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "enumDisplayMonitorsError");
+		return;
+	}
+	WindowInvestigator_RudeWindowEngine_SetMonitors(&state->rudeWindowEngine, layout.monitors, layout.monitorCount);
+}
 
-		BOOL isNewWindow = FALSE;
-		if (*currentWindowPtr == NULL || (*currentWindowPtr)->window != window) {
-			WindowMonitor_Window** const existingWindow = WindowMonitor_SearchWindow(currentWindowPtr, window);
-			WindowMonitor_Window* const previousWindow = *currentWindowPtr;
-			if (*existingWindow == NULL) {
-				TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "NewWindow", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt32(zOrder, "newZOrder"));
-				WindowMonitor_Window* const newWindow = *currentWindowPtr = malloc(sizeof(**currentWindowPtr));
-				if (newWindow == NULL) abort();
-				newWindow->window = window;
-				newWindow->seen = FALSE;
-				isNewWindow = TRUE;
-			}
-			else {
-				TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "WindowZOrderChanged", TraceLoggingPointer(window, "HWND"), TraceLoggingUInt32(zOrder, "newZOrder"));
-				*currentWindowPtr = *existingWindow;
-				*existingWindow = (*existingWindow)->next;
-			}
-			(*currentWindowPtr)->next = previousWindow;
-		}
+// messageTime is when the earliest message that the tick accounts for was received, or 0.
+static void WindowMonitor_BeginTick(State* state, uint64_t messageTime) {
+	state->tickMessageTime = messageTime;
+	const time_t now = time(NULL);
+	if (now > state->lastLog + 5) {
+		WindowMonitor_UpdateMonitorLayout(state);
+		// Make sure the snapshots we're about to log are fully up to date, regardless of the sampling policy.
+		WindowInvestigator_Monitor_SampleAllFieldsOnNextTick(&state->monitor);
+		state->logWindowsAfterTick = true;
+		state->lastLog = now;
+	}
+	WindowInvestigator_Monitor_BeginTick(&state->monitor);
+}
 
-		WindowMonitor_Window* currentWindow = *currentWindowPtr;
+// Arms the timer that triggers passes with the current period of the cadence, replacing the previous one if any.
+static void WindowMonitor_SetTimer(const State* state) {
+	const uint64_t periodMilliseconds = state->cadence.periodNanoseconds / 1000000;
+	if (SetTimer(state->window, 1, periodMilliseconds < USER_TIMER_MINIMUM ? USER_TIMER_MINIMUM : periodMilliseconds > USER_TIMER_MAXIMUM ? USER_TIMER_MAXIMUM : (UINT)periodMilliseconds, NULL) == 0) {
+		fprintf(stderr, "SetTimer failed() [0x%x]\n", GetLastError());
+		exit(EXIT_FAILURE);
+	}
+}
 
-		const WindowMonitor_WindowInfo windowInfo = WindowMonitor_GetWindowInfo(window);
-		if (isNewWindow) WindowMonitor_LogWindowInfo(window, &windowInfo);
-		else WindowMonitor_DiffWindowInfo(window, &currentWindow->info, &windowInfo);
-		currentWindow->info = windowInfo;
+// Logged every time the cadence changes, so that the effective time resolution of the capture is known at any point.
+static void WindowMonitor_OnCadenceChanged(const State* state, uint64_t timestamp) {
+	WindowMonitor_SetTimer(state);
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "TickCadenceChanged", TraceLoggingUInt64(timestamp, "Timestamp"),
+		TraceLoggingString(WindowInvestigator_TickCadenceLevel_GetName(state->cadence.level), "Cadence"),
+		TraceLoggingUInt64(state->cadence.periodNanoseconds, "PeriodNanoseconds"));
+}
 
-		if (currentWindow->seen) {
-			fprintf(stderr, "Window 0x%p already seen!", window);
-			exit(EXIT_FAILURE);
-		}
-		currentWindow->seen = TRUE;
-		currentWindowPtr = &(*currentWindowPtr)->next;
-		++zOrder;
-	}
+static void WindowMonitor_LogIncrementalStatistics(const WindowInvestigator_DirtySetStatistics* statistics) {
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "IncrementalStatistics",
+		TraceLoggingUInt64(statistics->notifications, "Notifications"),
+		TraceLoggingUInt64(statistics->duplicateNotifications, "DuplicateNotifications"),
+		TraceLoggingUInt64(statistics->staleNotifications, "StaleNotifications"),
+		TraceLoggingUInt64(statistics->passes, "Passes"),
+		TraceLoggingUInt64(statistics->enumerations, "Enumerations"),
+		TraceLoggingUInt64(statistics->sweptWindows, "SweptWindows"),
+		TraceLoggingUInt64(statistics->discardedWindows, "DiscardedWindows"));
+}
 
-	WindowMonitor_RemoveUnseenWindows(&state->foregroundWindow);
+static void WindowMonitor_LogCadenceStatistics(const WindowInvestigator_TickCadence* cadence) {
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "TickCadenceStatistics",
+		TraceLoggingUInt64(cadence->passes[WindowInvestigator_TickCadenceLevel_FAST], "FastPasses"),
+		TraceLoggingUInt64(cadence->passes[WindowInvestigator_TickCadenceLevel_SLOW], "SlowPasses"),
+		TraceLoggingUInt64(cadence->switches[WindowInvestigator_TickCadenceLevel_FAST], "SpeedUps"),
+		TraceLoggingUInt64(cadence->switches[WindowInvestigator_TickCadenceLevel_SLOW], "SlowDowns"));
 }
 
 static LRESULT CALLBACK WindowMonitor_WindowProcedure(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
@@ -477,29 +559,57 @@ static LRESULT CALLBACK WindowMonitor_WindowProcedure(HWND hWnd, UINT uMsg, WPAR
 
 	if (uMsg == WM_CREATE) {
 		WindowInvestigator_SetWindowUserDataOnCreate(hWnd, lParam);
-
-		if (SetTimer(hWnd, 1, USER_TIMER_MINIMUM, NULL) == 0) {
-			fprintf(stderr, "SetTimer failed() [0x%x]\n", GetLastError());
-			exit(EXIT_FAILURE);
-		}
+		((State*)WindowInvestigator_GetWindowUserData(hWnd))->window = hWnd;
+		WindowMonitor_SetTimer((State*)WindowInvestigator_GetWindowUserData(hWnd));
 	}
 
 	State* const state = (State*)WindowInvestigator_GetWindowUserData(hWnd);
 	if (state != NULL) {
-		WindowMonitor_DiffTopLevelWindows(state);
-
-		const time_t now = time(NULL);
-		if (now > state->lastLog + 5) {
-			WindowMonitor_LogTopLevelWindows(state->foregroundWindow);
-			state->lastLog = now;
+		const uint64_t messageTime = WindowInvestigator_GetTimeNanoseconds();
+		const bool isShellHookMessage = state->shellhookMessage != 0 && uMsg == state->shellhookMessage;
+		if (isShellHookMessage)
+			WindowInvestigator_EventQueue_PushReceivedMessage(&state->eventQueue, WindowInvestigator_ReceivedMessage_SHELL_HOOK, uMsg, wParam, (uint64_t)lParam);
+		else if (uMsg == WM_USER)
+			WindowInvestigator_EventQueue_PushReceivedMessage(&state->eventQueue, WindowInvestigator_ReceivedMessage_APPBAR, uMsg, wParam, (uint64_t)lParam);
+		if ((isShellHookMessage || uMsg == WM_USER) && WindowInvestigator_TickCadence_OnActivity(&state->cadence))
+			WindowMonitor_OnCadenceChanged(state, messageTime);
+
+		// Window properties are collected by the monitor workers, so that this thread stays available to receive (and
+		// timestamp) messages. Changes are reported once the workers are done.
+		if (uMsg == WindowMonitor_WM_TICK_READY) {
+			WindowInvestigator_Monitor_FinishTick(&state->monitor);
+			WindowInvestigator_RudeWindowEngine_Evaluate(&state->rudeWindowEngine);
+			if (WindowInvestigator_TickCadence_OnPass(&state->cadence, state->monitor.lastTickChanged))
+				WindowMonitor_OnCadenceChanged(state, WindowInvestigator_GetTimeNanoseconds());
+			if (state->logWindowsAfterTick) {
+				WindowInvestigator_Monitor_LogWindows(&state->monitor);
+				WindowMonitor_LogSamplingCosts(&state->monitor);
+				WindowMonitor_LogEventQueueStatistics(&state->eventQueue);
+				WindowMonitor_LogCadenceStatistics(&state->cadence);
+				if (state->monitor.options.incremental) WindowMonitor_LogIncrementalStatistics(&state->monitor.dirtySet.statistics);
+				WindowMonitor_LogLatencies(state);
+				state->logWindowsAfterTick = false;
+			}
+			if (state->tickMessageTime != 0)
+				WindowInvestigator_Histogram_Record(state->messageToDoneLatencies, WindowInvestigator_GetTimeNanoseconds() - state->tickMessageTime);
+			if (state->tickRequested) {
+				state->tickRequested = false;
+				WindowMonitor_BeginTick(state, state->requestedTickMessageTime);
+			}
+		}
+		else if (state->monitor.tickInProgress) {
+			if (!state->tickRequested) state->requestedTickMessageTime = messageTime;
+			state->tickRequested = true;
 		}
+		else
+			WindowMonitor_BeginTick(state, messageTime);
 	}
 	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Done");
 
 	return DefWindowProcW(hWnd, uMsg, wParam, lParam);
 }
 
-static void WindowMonitor_DumpWindow(HWND window, const WindowMonitor_WindowInfo* windowInfo) {
+static void WindowMonitor_DumpWindow(HWND window, const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_StringPool* strings) {
 	printf("HWND: 0x%p\n", window);
 
 	const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, windowInfo->processId);
@@ -515,13 +625,19 @@ static void WindowMonitor_DumpWindow(HWND window, const WindowMonitor_WindowInfo
 	}
 	printf("\n");
 
-	WindowMonitor_DumpWindowInfo(windowInfo);
+	WindowMonitor_DumpWindowInfo(windowInfo, strings);
 
 	printf("\n");
 }
 
-static void WindowMonitor_DumpTopLevelWindows(void) {
+// Writes WindowDump lines to structuredWriter instead of printing text if it is not NULL.
+static void WindowMonitor_DumpTopLevelWindows(WindowInvestigator_StructuredWriter* structuredWriter) {
+	WindowInvestigator_StringPool strings;
+	WindowInvestigator_StringPool_Init(&strings);
+	WindowInvestigator_WindowStrings windowStrings;
+
 	HWND window = NULL;
+	uint32_t zOrder = 0;
 	for (;;) {
 		// Note: we don't use EnumWindows because that won't return windows with band != 1 (DESKTOP). See https://wj32.org/wp/2012/12/12/enumwindows-no-longer-finds-metromodern-ui-windows-a-workaround-2/
 		window = FindWindowExW(NULL, window, NULL, NULL);
@@ -529,9 +645,20 @@ static void WindowMonitor_DumpTopLevelWindows(void) {
 
 		if (!IsWindowVisible(window)) continue;
 
-		const WindowMonitor_WindowInfo windowInfo = WindowMonitor_GetWindowInfo(window);
-		WindowMonitor_DumpWindow(window, &windowInfo);
+		WindowInvestigator_WindowInfo windowInfo;
+		WindowMonitor_GetWindowInfo(window, WindowInvestigator_WindowField_ALL, &windowInfo, &windowStrings);
+		if (structuredWriter != NULL) {
+			WindowInvestigator_StructuredWriter_WriteWindow(structuredWriter, "WindowDump", WindowInvestigator_GetTimeNanoseconds(), (uintptr_t)window, zOrder++, WindowInvestigator_WindowField_ALL, &windowInfo, &windowStrings);
+			continue;
+		}
+		WindowInvestigator_InternWindowStrings(&strings, NULL, WindowInvestigator_WindowField_ALL, &windowStrings, &windowInfo);
+		WindowMonitor_DumpWindow(window, &windowInfo, &strings);
+		WindowInvestigator_ReleaseWindowStrings(&strings, &windowInfo);
 	}
+
+	WindowInvestigator_StringPool_Destroy(&strings);
+	if (structuredWriter != NULL && !WindowInvestigator_StructuredWriter_Flush(structuredWriter))
+		fprintf(stderr, "Unable to write output\n");
 }
 
 static void WindowMonitor_SetProcessPriority(void) {
@@ -548,7 +675,82 @@ static void WindowMonitor_SetProcessPriority(void) {
 		fprintf(stderr, "timeBeginPeriod() returned error %u\n", timeBeginPeriodResult);
 }
 
-static int WindowMonitor_MonitorAllWindows(void) {
+static DWORD WindowMonitor_messageThreadId;
+// Single-window mode has no message loop; it checks this after every sample instead.
+static volatile uint64_t WindowMonitor_stopping;
+
+// Ends the message loop (or the sampling loop) on Ctrl+C, so that the latencies get printed and the remaining events written
+// before exiting.
+static BOOL WINAPI WindowMonitor_OnConsoleControl(DWORD controlType) {
+	if (controlType != CTRL_C_EVENT && controlType != CTRL_BREAK_EVENT) return FALSE;
+	WindowInvestigator_Atomic_StoreRelease(&WindowMonitor_stopping, 1);
+	return WindowMonitor_messageThreadId == 0 || PostThreadMessageW(WindowMonitor_messageThreadId, WM_QUIT, 0, 0);
+}
+
+// Only set in incremental mode. WinEvent callbacks have no context, but they are called on the thread that set the hooks,
+// which is the thread that drives the monitor.
+static WindowInvestigator_Monitor* WindowMonitor_incrementalMonitor;
+
+// GetTickCount() only moves every clock interrupt (typically 15.6 ms), so event times can be that much earlier than the
+// actual event. Timestamps have to err on the late side: a notification that looks older than it is can be mistaken for one
+// that was already taken care of.
+#define WindowMonitor_WINEVENT_TIME_MARGIN_NANOSECONDS UINT64_C(32000000)
+
+static const DWORD WindowMonitor_winEventRanges[][2] = {
+	{ EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND },
+	{ EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND },
+	{ EVENT_OBJECT_CREATE, EVENT_OBJECT_REORDER },
+	{ EVENT_OBJECT_STATECHANGE, EVENT_OBJECT_NAMECHANGE },
+	{ EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED },
+};
+#define WindowMonitor_WINEVENT_RANGE_COUNT (sizeof(WindowMonitor_winEventRanges) / sizeof(*WindowMonitor_winEventRanges))
+
+static bool WindowMonitor_GetWindowNotification(DWORD event, WindowInvestigator_WindowNotification* notification) {
+	switch (event) {
+	case EVENT_OBJECT_CREATE: *notification = WindowInvestigator_WindowNotification_CREATE; return true;
+	case EVENT_OBJECT_DESTROY: *notification = WindowInvestigator_WindowNotification_DESTROY; return true;
+	case EVENT_OBJECT_SHOW: *notification = WindowInvestigator_WindowNotification_SHOW; return true;
+	case EVENT_OBJECT_HIDE: *notification = WindowInvestigator_WindowNotification_HIDE; return true;
+	case EVENT_OBJECT_REORDER:
+	case EVENT_SYSTEM_FOREGROUND:
+		*notification = WindowInvestigator_WindowNotification_REORDER;
+		return true;
+	case EVENT_OBJECT_LOCATIONCHANGE:
+	case EVENT_SYSTEM_MINIMIZESTART:
+	case EVENT_SYSTEM_MINIMIZEEND:
+		*notification = WindowInvestigator_WindowNotification_LOCATION;
+		return true;
+	case EVENT_OBJECT_NAMECHANGE: *notification = WindowInvestigator_WindowNotification_NAME; return true;
+	case EVENT_OBJECT_STATECHANGE: *notification = WindowInvestigator_WindowNotification_STATE; return true;
+	case EVENT_OBJECT_CLOAKED:
+	case EVENT_OBJECT_UNCLOAKED:
+		*notification = WindowInvestigator_WindowNotification_CLOAK;
+		return true;
+	}
+	return false;
+}
+
+static void CALLBACK WindowMonitor_OnWinEvent(HWINEVENTHOOK hook, DWORD event, HWND window, LONG objectId, LONG childId, DWORD eventThreadId, DWORD eventTime) {
+	UNREFERENCED_PARAMETER(hook);
+	UNREFERENCED_PARAMETER(eventThreadId);
+
+	// Only top-level windows themselves are of interest, not their children nor the objects within them. A window that is
+	// being destroyed may not have a parent anymore, so destruction is always passed on; the monitor ignores windows it does
+	// not track.
+	if (window == NULL || objectId != OBJID_WINDOW || childId != CHILDID_SELF) return;
+	if (event != EVENT_OBJECT_DESTROY && GetAncestor(window, GA_PARENT) != GetDesktopWindow()) return;
+	WindowInvestigator_WindowNotification notification;
+	if (!WindowMonitor_GetWindowNotification(event, &notification)) return;
+
+	const uint64_t now = WindowInvestigator_GetTimeNanoseconds();
+	const uint64_t age = (uint64_t)(DWORD)(GetTickCount() - eventTime) * 1000000;
+	const uint64_t lateAge = age > WindowMonitor_WINEVENT_TIME_MARGIN_NANOSECONDS ? age - WindowMonitor_WINEVENT_TIME_MARGIN_NANOSECONDS : 0;
+	WindowInvestigator_Monitor_Notify(WindowMonitor_incrementalMonitor, notification, (uintptr_t)window, lateAge < now ? now - lateAge : 0);
+}
+
+// If filter is not empty, only the windows that match it are monitored, and a tick is also requested every period of
+// timerOptions, regardless of the cadence. If dirtySetOptions is not NULL, the monitor is incremental, driven by WinEvents.
+static int WindowMonitor_MonitorAllWindows(WindowMonitor_EventOutput* output, WindowInvestigator_WindowFilter* filter, const WindowInvestigator_PeriodicTimerOptions* timerOptions, const WindowInvestigator_TickCadenceOptions* cadenceOptions, const WindowInvestigator_DirtySetOptions* dirtySetOptions) {
 	WNDCLASSEXW windowClass = { 0 };
 	windowClass.cbSize = sizeof(WNDCLASSEX);
 	windowClass.lpfnWndProc = WindowMonitor_WindowProcedure;
@@ -559,9 +761,56 @@ static int WindowMonitor_MonitorAllWindows(void) {
 		return EXIT_FAILURE;
 	}
 
+	WindowInvestigator_MonitorBackend backend;
+	backend.getNextWindow = WindowMonitor_GetNextWindow;
+	backend.isWindowVisible = WindowMonitor_IsWindowVisible;
+	backend.getWindowInfo = WindowMonitor_GetBackendWindowInfo;
+	backend.context = NULL;
+
 	State state;
-	state.foregroundWindow = NULL;
+	state.window = NULL;
+	state.shellhookMessage = 0;
 	state.lastLog = time(NULL);
+	state.logWindowsAfterTick = false;
+	state.tickRequested = false;
+	state.tickMessageTime = 0;
+	state.requestedTickMessageTime = 0;
+	state.messageToDoneLatencies = WindowInvestigator_Reallocate(NULL, 1, sizeof(*state.messageToDoneLatencies));
+	WindowInvestigator_Histogram_Reset(state.messageToDoneLatencies);
+	state.latencies = WindowInvestigator_Reallocate(NULL, WindowMonitor_LATENCY_COUNT, sizeof(*state.latencies));
+	WindowInvestigator_TickCadence_Init(&state.cadence, cadenceOptions);
+
+	WindowInvestigator_MonitorOptions monitorOptions;
+	WindowInvestigator_Monitor_GetDefaultOptions(&monitorOptions);
+	const DWORD processorCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+	monitorOptions.workerCount = processorCount < 1 ? 1 : processorCount > 8 ? 8 : processorCount;
+	monitorOptions.onTickReady = WindowMonitor_OnTickReady;
+	monitorOptions.onTickReadyContext = &state;
+	const bool filtered = !WindowInvestigator_WindowFilter_IsEmpty(filter);
+	if (filtered) {
+		monitorOptions.filterWindow = WindowMonitor_FilterWindow;
+		monitorOptions.filterWindowContext = filter;
+	}
+	if (dirtySetOptions != NULL) {
+		monitorOptions.incremental = true;
+		monitorOptions.dirtySetOptions = *dirtySetOptions;
+	}
+
+	// Done before the event queue writer thread starts, as the dump and the events share the structured writer. Messages can
+	// be received as early as window creation, since sent messages get dispatched while waiting on other windows.
+	WindowMonitor_DumpTopLevelWindows(output->structuredWriter);
+
+	// Events are written to ETW by the event queue writer thread.
+	WindowInvestigator_EventQueue_Init(&state.eventQueue, WindowMonitor_EVENT_QUEUE_CAPACITY, &state.monitor.strings, WindowMonitor_WriteEvent, output);
+	WindowInvestigator_MonitorSink eventQueueSink;
+	WindowInvestigator_EventQueue_GetSink(&state.eventQueue, &eventQueueSink);
+	WindowInvestigator_RudeWindowSink rudeWindowSink;
+	WindowInvestigator_EventQueue_GetRudeWindowSink(&state.eventQueue, &rudeWindowSink);
+	WindowInvestigator_RudeWindowEngine_Init(&state.rudeWindowEngine, &state.monitor.windows, &rudeWindowSink);
+	WindowMonitor_UpdateMonitorLayout(&state);
+	WindowInvestigator_MonitorSink sink;
+	WindowInvestigator_RudeWindowEngine_GetMonitorSink(&state.rudeWindowEngine, &eventQueueSink, &sink);
+	WindowInvestigator_Monitor_Init(&state.monitor, &backend, &sink, &monitorOptions);
 	const HWND window = CreateWindowW(
 		/*lpClassName=*/L"WindowInvestigator_WindowMonitor",
 		/*lpWindowName=*/L"WindowInvestigator_WindowMonitor",
@@ -601,10 +850,35 @@ static int WindowMonitor_MonitorAllWindows(void) {
 		fprintf(stderr, "RegisterWindowMessageW(\"SHELLHOOK\") failed [0x%x]\n", GetLastError());
 		return EXIT_FAILURE;
 	}
+	state.shellhookMessage = shellhookMessage;
+
+	// Out-of-context hooks are called from the message loop of this thread, just like window messages.
+	HWINEVENTHOOK winEventHooks[WindowMonitor_WINEVENT_RANGE_COUNT] = { NULL };
+	if (monitorOptions.incremental) {
+		WindowMonitor_incrementalMonitor = &state.monitor;
+		for (size_t range = 0; range < WindowMonitor_WINEVENT_RANGE_COUNT; ++range) {
+			winEventHooks[range] = SetWinEventHook(WindowMonitor_winEventRanges[range][0], WindowMonitor_winEventRanges[range][1], NULL, WindowMonitor_OnWinEvent, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+			if (winEventHooks[range] == NULL) {
+				fprintf(stderr, "SetWinEventHook() failed [0x%x]\n", GetLastError());
+				return EXIT_FAILURE;
+			}
+		}
+	}
 
-	WindowMonitor_DumpTopLevelWindows();
+	WindowMonitor_Ticker ticker;
+	ticker.window = window;
+	ticker.timerOptions = *timerOptions;
+	ticker.stopping = 0;
+	if (filtered) WindowInvestigator_Thread_Start(&ticker.thread, WindowMonitor_RunTicker, &ticker);
 
-	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Started", TraceLoggingHexUInt32(shellhookMessage));
+	WindowMonitor_messageThreadId = GetCurrentThreadId();
+	if (!SetConsoleCtrlHandler(WindowMonitor_OnConsoleControl, TRUE))
+		fprintf(stderr, "SetConsoleCtrlHandler() failed [0x%x]\n", GetLastError());
+
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Started", TraceLoggingHexUInt32(shellhookMessage),
+		TraceLoggingUInt64(cadenceOptions->fastPeriodNanoseconds, "FastPeriodNanoseconds"), TraceLoggingUInt64(cadenceOptions->slowPeriodNanoseconds, "SlowPeriodNanoseconds"),
+		TraceLoggingUInt64(cadenceOptions->quietPassThreshold, "QuietPassThreshold"), TraceLoggingBool(monitorOptions.incremental, "Incremental"),
+		TraceLoggingUInt64(monitorOptions.dirtySetOptions.enumerationPeriod, "EnumerationPeriod"), TraceLoggingUInt64(monitorOptions.dirtySetOptions.sweepWindowsPerPass, "SweepWindowsPerPass"));
 
 	for (;;)
 	{
@@ -614,13 +888,44 @@ static int WindowMonitor_MonitorAllWindows(void) {
 			fprintf(stderr, "GetMessage failed [%x]\n", GetLastError());
 			return EXIT_FAILURE;
 		}
-		if (result == 0)
+		if (result == 0) {
+			if (filtered) {
+				WindowInvestigator_Atomic_StoreRelease(&ticker.stopping, 1);
+				WindowInvestigator_Thread_Join(&ticker.thread);
+			}
+			for (size_t range = 0; range < WindowMonitor_WINEVENT_RANGE_COUNT; ++range)
+				if (winEventHooks[range] != NULL) UnhookWinEvent(winEventHooks[range]);
+			if (state.monitor.tickInProgress) WindowInvestigator_Monitor_FinishTick(&state.monitor);
+			// Keep stdout clean for parsers in structured mode.
+			WindowMonitor_PrintLatencies(&state, output->structuredWriter != NULL ? stderr : stdout);
+			WindowInvestigator_EventQueue_Destroy(&state.eventQueue);
 			return EXIT_SUCCESS;
+		}
 		DispatchMessage(&message);
 	}
 }
 
-static int WindowMonitor_MonitorSingleWindow(HWND window) {
+// How often single-window mode reports how precise its timing was.
+#define WindowMonitor_SAMPLER_STATISTICS_INTERVAL_NANOSECONDS UINT64_C(10000000000)
+
+static void WindowMonitor_LogSamplerStatistics(const WindowInvestigator_PeriodicTimer* timer, const WindowInvestigator_Histogram* sampleDurations) {
+	TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "SamplerStatistics",
+		TraceLoggingUInt64(timer->options.periodNanoseconds, "TargetPeriodNanoseconds"),
+		TraceLoggingUInt64(sampleDurations->count, "Samples"),
+		TraceLoggingUInt64(timer->missedDeadlines, "MissedDeadlines"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->period, 0), "PeriodMinNanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->period, 50), "PeriodP50Nanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->period, 99), "PeriodP99Nanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->period, 100), "PeriodMaxNanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->lateness, 50), "LatenessP50Nanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->lateness, 99), "LatenessP99Nanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(timer->lateness, 100), "LatenessMaxNanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(sampleDurations, 50), "SampleDurationP50Nanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(sampleDurations, 99), "SampleDurationP99Nanoseconds"),
+		TraceLoggingUInt64(WindowInvestigator_Histogram_GetPercentile(sampleDurations, 100), "SampleDurationMaxNanoseconds"));
+}
+
+static int WindowMonitor_MonitorSingleWindow(HWND window, const WindowInvestigator_PeriodicTimerOptions* timerOptions, WindowMonitor_EventOutput* output) {
 	if (!IsWindow(window)) {
 		fprintf(stderr, "ERROR: handle 0x%p does not refer to a window", window);
 		return EXIT_FAILURE;
@@ -628,18 +933,71 @@ static int WindowMonitor_MonitorSingleWindow(HWND window) {
 
 	WindowMonitor_SetProcessPriority();
 
-	WindowMonitor_WindowInfo windowInfo = WindowMonitor_GetWindowInfo(window);
-	WindowMonitor_DumpWindow(window, &windowInfo);
+	WindowInvestigator_StringPool strings;
+	WindowInvestigator_StringPool_Init(&strings);
+	WindowInvestigator_WindowStrings windowStrings;
 
-	for (;;) {
+	WindowInvestigator_WindowInfo windowInfo;
+	WindowMonitor_GetWindowInfo(window, WindowInvestigator_WindowField_ALL, &windowInfo, &windowStrings);
+	if (output->structuredWriter != NULL) {
+		WindowInvestigator_StructuredWriter_WriteWindow(output->structuredWriter, "WindowDump", WindowInvestigator_GetTimeNanoseconds(), (uintptr_t)window, 0, WindowInvestigator_WindowField_ALL, &windowInfo, &windowStrings);
+		if (!WindowInvestigator_StructuredWriter_Flush(output->structuredWriter))
+			fprintf(stderr, "Unable to write output\n");
+	}
+	WindowInvestigator_InternWindowStrings(&strings, NULL, WindowInvestigator_WindowField_ALL, &windowStrings, &windowInfo);
+	if (output->structuredWriter == NULL) WindowMonitor_DumpWindow(window, &windowInfo, &strings);
+
+	WindowInvestigator_EventQueue eventQueue;
+	WindowInvestigator_EventQueue_Init(&eventQueue, WindowMonitor_EVENT_QUEUE_CAPACITY, &strings, WindowMonitor_WriteEvent, output);
+
+	// Sleep() alone would make the period anywhere between 1 and 3+ ms depending on timer coalescing.
+	WindowInvestigator_PeriodicTimer timer;
+	WindowInvestigator_PeriodicTimer_Init(&timer, timerOptions);
+	WindowInvestigator_Histogram* const sampleDurations = WindowInvestigator_Reallocate(NULL, 1, sizeof(*sampleDurations));
+	WindowInvestigator_Histogram_Reset(sampleDurations);
+	uint64_t nextStatisticsTime = WindowInvestigator_GetTimeNanoseconds() + WindowMonitor_SAMPLER_STATISTICS_INTERVAL_NANOSECONDS;
+	if (!SetConsoleCtrlHandler(WindowMonitor_OnConsoleControl, TRUE))
+		fprintf(stderr, "SetConsoleCtrlHandler() failed [0x%x]\n", GetLastError());
+	while (WindowInvestigator_Atomic_LoadAcquire(&WindowMonitor_stopping) == 0) {
+		const uint64_t startTime = WindowInvestigator_PeriodicTimer_Wait(&timer);
 		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Start");
-		const WindowMonitor_WindowInfo newWindowInfo = WindowMonitor_GetWindowInfo(window);
+		WindowInvestigator_WindowInfo newWindowInfo;
+		WindowMonitor_GetWindowInfo(window, WindowInvestigator_WindowField_ALL, &newWindowInfo, &windowStrings);
 		TraceLoggingWrite(WindowInvestigator_traceloggingProvider, "Done");
-		WindowMonitor_DiffWindowInfo(window, &windowInfo, &newWindowInfo);
+		WindowInvestigator_Histogram_Record(sampleDurations, WindowInvestigator_GetTimeNanoseconds() - startTime);
+		WindowInvestigator_InternWindowStrings(&strings, &windowInfo, WindowInvestigator_WindowField_ALL, &windowStrings, &newWindowInfo);
+		WindowInvestigator_EventQueue_PushWindowChanged(&eventQueue, (uintptr_t)window, WindowInvestigator_DiffWindowInfo(&windowInfo, &newWindowInfo), &newWindowInfo);
+
+		WindowInvestigator_ReplaceWindowInfo(&strings, &windowInfo, &newWindowInfo);
+
+		if (startTime >= nextStatisticsTime) {
+			WindowMonitor_LogSamplerStatistics(&timer, sampleDurations);
+			WindowInvestigator_PeriodicTimer_ResetStatistics(&timer);
+			WindowInvestigator_Histogram_Reset(sampleDurations);
+			nextStatisticsTime = startTime + WindowMonitor_SAMPLER_STATISTICS_INTERVAL_NANOSECONDS;
+		}
+	}
+
+	// Drains the queue into the output, which the caller then flushes.
+	WindowInvestigator_EventQueue_Destroy(&eventQueue);
+	WindowInvestigator_PeriodicTimer_Destroy(&timer);
+	WindowInvestigator_Free(sampleDurations);
+	WindowInvestigator_ReleaseWindowStrings(&strings, &windowInfo);
+	WindowInvestigator_StringPool_Destroy(&strings);
+	return EXIT_SUCCESS;
+}
 
-		windowInfo = newWindowInfo;
-		Sleep(2);
+// "text" leaves *structured false.
+static bool WindowMonitor_ParseFormat(const wchar_t* value, bool* structured, WindowInvestigator_StructuredFormat* format) {
+	char name[16];
+	size_t length = 0;
+	for (; value[length] != L'\0'; ++length) {
+		if (length == sizeof(name) - 1 || value[length] >= 0x80) return false;
+		name[length] = (char)value[length];
 	}
+	name[length] = '\0';
+	*structured = strcmp(name, "text") != 0;
+	return !*structured || WindowInvestigator_StructuredFormat_Parse(name, format);
 }
 
 int wmain(int argc, const wchar_t* const* const argv, const wchar_t* const* const envp) {
@@ -651,14 +1009,107 @@ int wmain(int argc, const wchar_t* const* const argv, const wchar_t* const* cons
 		return EXIT_FAILURE;
 	}
 
-	if (argc < 2)
-		return WindowMonitor_MonitorAllWindows();
-	else if (argc == 2) {
+	int argumentIndex = 1;
+	const wchar_t* capturePath = NULL;
+	WindowInvestigator_PeriodicTimerOptions timerOptions;
+	WindowInvestigator_PeriodicTimer_GetDefaultOptions(&timerOptions);
+	WindowInvestigator_TickCadenceOptions cadenceOptions;
+	WindowInvestigator_TickCadence_GetDefaultOptions(&cadenceOptions);
+	cadenceOptions.fastPeriodNanoseconds = (uint64_t)USER_TIMER_MINIMUM * 1000000;
+	WindowInvestigator_DirtySetOptions dirtySetOptions;
+	WindowInvestigator_DirtySet_GetDefaultOptions(&dirtySetOptions);
+	bool incremental = false;
+	bool structured = false;
+	WindowInvestigator_StructuredFormat structuredFormat = WindowInvestigator_StructuredFormat_JSON_LINES;
+	WindowInvestigator_WindowFilter filter;
+	WindowInvestigator_WindowFilter_Init(&filter);
+	bool validArguments = true;
+	while (validArguments && argumentIndex + 1 < argc && wcsncmp(argv[argumentIndex], L"--", 2) == 0) {
+		const wchar_t* const name = argv[argumentIndex];
+		const wchar_t* const value = argv[argumentIndex + 1];
+		wchar_t* end;
+		if (wcscmp(name, L"--capture") == 0) capturePath = value;
+		else if (wcscmp(name, L"--period-us") == 0) {
+			timerOptions.periodNanoseconds = wcstoull(value, &end, 0) * 1000;
+			validArguments = *value != L'\0' && *end == L'\0' && timerOptions.periodNanoseconds != 0;
+		}
+		else if (wcscmp(name, L"--spin-us") == 0) {
+			timerOptions.spinNanoseconds = wcstoull(value, &end, 0) * 1000;
+			validArguments = *value != L'\0' && *end == L'\0';
+		}
+		else if (wcscmp(name, L"--quiet-passes") == 0) {
+			cadenceOptions.quietPassThreshold = wcstoull(value, &end, 0);
+			validArguments = *value != L'\0' && *end == L'\0';
+		}
+		else if (wcscmp(name, L"--slow-period-ms") == 0) {
+			cadenceOptions.slowPeriodNanoseconds = wcstoull(value, &end, 0) * 1000000;
+			validArguments = *value != L'\0' && *end == L'\0' && cadenceOptions.slowPeriodNanoseconds >= cadenceOptions.fastPeriodNanoseconds;
+		}
+		else if (wcscmp(name, L"--incremental") == 0) {
+			dirtySetOptions.enumerationPeriod = wcstoull(value, &end, 0);
+			validArguments = *value != L'\0' && *end == L'\0';
+			incremental = true;
+		}
+		else if (wcscmp(name, L"--format") == 0) validArguments = WindowMonitor_ParseFormat(value, &structured, &structuredFormat);
+		else if (wcscmp(name, L"--filter-window") == 0) validArguments = WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, value);
+		else if (wcscmp(name, L"--filter-pid") == 0) validArguments = WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, value);
+		else if (wcscmp(name, L"--filter-image") == 0) validArguments = WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_IMAGE_NAME, value);
+		else if (wcscmp(name, L"--filter-class") == 0) validArguments = WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_CLASS_NAME, value);
+		else validArguments = false;
+		argumentIndex += 2;
+	}
+	WindowInvestigator_WindowFilter_Compile(&filter);
+
+	FILE* captureFile = NULL;
+	WindowInvestigator_CaptureWriter captureWriter;
+	if (validArguments && capturePath != NULL) {
+		const errno_t openResult = _wfopen_s(&captureFile, capturePath, L"wb");
+		if (openResult != 0 || captureFile == NULL) {
+			fprintf(stderr, "Unable to create capture file \"%S\" [%d]\n", capturePath, openResult);
+			return EXIT_FAILURE;
+		}
+		WindowInvestigator_CaptureWriter_Init(&captureWriter, captureFile);
+	}
+
+	WindowInvestigator_StructuredWriter structuredWriter;
+	if (structured) WindowInvestigator_StructuredWriter_Init(&structuredWriter, structuredFormat, stdout);
+	WindowMonitor_EventOutput output;
+	output.captureWriter = captureFile == NULL ? NULL : &captureWriter;
+	output.structuredWriter = structured ? &structuredWriter : NULL;
+
+	int exitCode = -1;
+	if (validArguments && argc == argumentIndex)
+		exitCode = WindowMonitor_MonitorAllWindows(&output, &filter, &timerOptions, &cadenceOptions, incremental ? &dirtySetOptions : NULL);
+	else if (validArguments && argc == argumentIndex + 1 && WindowInvestigator_WindowFilter_IsEmpty(&filter)) {
 		HWND window;
-		if (swscanf_s(argv[1], L"0x%p", &window) == 1)
-			return WindowMonitor_MonitorSingleWindow(window);
+		if (swscanf_s(argv[argumentIndex], L"0x%p", &window) == 1)
+			exitCode = WindowMonitor_MonitorSingleWindow(window, &timerOptions, &output);
+	}
+
+	if (captureFile != NULL) {
+		if (!WindowInvestigator_CaptureWriter_Flush(&captureWriter) || fclose(captureFile) != 0) {
+			fprintf(stderr, "Unable to write capture file\n");
+			exitCode = EXIT_FAILURE;
+		}
+		WindowInvestigator_CaptureWriter_Destroy(&captureWriter);
+	}
+	if (structured) {
+		if (exitCode != -1 && (!WindowInvestigator_StructuredWriter_Flush(&structuredWriter) || fflush(stdout) != 0)) {
+			fprintf(stderr, "Unable to write output\n");
+			exitCode = EXIT_FAILURE;
+		}
+		WindowInvestigator_StructuredWriter_Destroy(&structuredWriter);
 	}
-	
-	fprintf(stderr, "usage: WindowMonitor [<HWND, e.g. 0x0123ABCD>]\n");
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+	if (exitCode != -1) return exitCode;
+
+	fprintf(stderr, "usage: WindowMonitor [--capture <file>] [--period-us <microseconds>] [--spin-us <microseconds>] [--quiet-passes <count>] [--slow-period-ms <milliseconds>] [--incremental <passes>] [--format text|jsonl|csv] [--filter-window <HWNDs>] [--filter-pid <PIDs>] [--filter-image <names>] [--filter-class <patterns>] [<HWND, e.g. 0x0123ABCD>]\n");
 	fprintf(stderr, "If an HWND is specified, monitors that specific window; otherwise, monitors all visible top-level windows.\n");
+	fprintf(stderr, "If any --filter option is specified, only monitors the top-level windows that match any of the filters (comma-separated lists; image names and class names support * and ? wildcards).\n");
+	fprintf(stderr, "In single-window and filtered mode, the windows are sampled every --period-us (default 2000), spinning for the last --spin-us (default 1000) of each period.\n");
+	fprintf(stderr, "If --quiet-passes is specified, the timer that triggers passes slows down to every --slow-period-ms (default 250) after that many passes in a row without any change, and goes back to the fastest rate on the next change or shell hook or appbar message.\n");
+	fprintf(stderr, "If --incremental is specified, passes only re-read the windows that WinEvents report as changed, plus a few windows in turn to catch missed events, and only enumerate windows when WinEvents show they may have appeared, disappeared or moved in the Z-order, or at least every that many passes (0: only then).\n");
+	fprintf(stderr, "If --format is jsonl or csv, the initial window dump and every event are written to stdout as JSON Lines or CSV instead of text (see common/structured_output.h).\n");
+	fprintf(stderr, "If --capture is specified, events are also written to the specified file (see common/capture_file.h).\n");
+	return EXIT_FAILURE;
 }
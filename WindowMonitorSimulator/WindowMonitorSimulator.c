@@ -0,0 +1,1128 @@
+#include "../common/allocation.h"
+#include "../common/capture_file.h"
+#include "../common/clock.h"
+#include "../common/event_queue.h"
+#include "../common/message_script.h"
+#include "../common/monitor.h"
+#include "../common/periodic_timer.h"
+#include "../common/rude_window.h"
+#include "../common/simulated_desktop.h"
+#include "../common/spatial_index.h"
+#include "../common/structured_output.h"
+#include "../common/text_file.h"
+#include "../common/window_filter.h"
+#include "../common/window_record.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	// NULL if not capturing.
+	WindowInvestigator_CaptureWriter* captureWriter;
+
+	uint64_t recordCount;
+	uint64_t recordBytes;
+
+	uint64_t newWindow;
+	uint64_t windowChanged;
+	uint64_t changedFields[WindowInvestigator_WindowField_COUNT];
+	uint64_t windowZOrderChanged;
+	uint64_t windowGone;
+	uint64_t zOrderUpdated;
+	uint64_t keyframe;
+	uint64_t logWindow;
+	uint64_t receivedMessage;
+	uint64_t rudeWindowChanged;
+	uint64_t eventsDropped;
+	uint64_t tickFinished;
+	// As reported by the last EVENTS_DROPPED event.
+	uint64_t reportedDroppedCount;
+} WindowMonitorSimulator_SinkState;
+
+static void WindowMonitorSimulator_Usage(void) {
+	fprintf(stderr, "usage: WindowMonitorSimulator [--windows N] [--ticks N] [--seed N] [--visible-fraction F] [--create-rate F] [--destroy-rate F] [--replace-rate F] [--move-rate F] [--style-flip-rate F] [--text-rate F] [--zorder-rate F] [--fullscreen-rate F] [--log-interval N] [--sampling exhaustive|tiered] [--workers N] [--windows-per-batch N] [--window-latency-us N] [--slow-window-fraction F] [--slow-window-latency-us N] [--event-queue-capacity N] [--event-queue-benchmark N] [--capture FILE] [--message-interval N] [--spatial-index-benchmark N] [--window-table-benchmark N] [--zorder-diff-benchmark N] [--diff-benchmark N] [--format-benchmark N] [--single-window-period-us N] [--message-script FILE] [--spin-us N] [--filter-window LIST] [--filter-pid LIST] [--filter-image LIST] [--filter-class LIST] [--check-allocations 0|1] [--incremental 0|1] [--enumeration-period N] [--sweep-windows N] [--notification-drop-rate F] [--notification-delay-rate F]\n");
+	exit(EXIT_FAILURE);
+}
+
+// Plays the part of the WindowMonitor ETW writer. Runs on the event queue writer thread, if there is one.
+static void WindowMonitorSimulator_OnEvent(void* context, const WindowInvestigator_MonitorEvent* event) {
+	WindowMonitorSimulator_SinkState* const sinkState = context;
+	// Errors are reported at the end of the run.
+	if (sinkState->captureWriter != NULL) WindowInvestigator_CaptureWriter_WriteEvent(sinkState->captureWriter, event);
+	if (event->recordSize != 0 && event->type != WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE && event->type != WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED && event->type != WindowInvestigator_MonitorEvent_EVENTS_DROPPED) {
+		++sinkState->recordCount;
+		sinkState->recordBytes += event->recordSize;
+	}
+	switch (event->type) {
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+		++sinkState->newWindow;
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+		++sinkState->windowChanged;
+		for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field)
+			if (event->fields & WindowInvestigator_WindowField_BIT(field)) ++sinkState->changedFields[field];
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED:
+		++sinkState->windowZOrderChanged;
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+		++sinkState->windowGone;
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT:
+		++sinkState->logWindow;
+		break;
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+		++sinkState->zOrderUpdated;
+		break;
+	case WindowInvestigator_MonitorEvent_KEYFRAME:
+		++sinkState->keyframe;
+		break;
+	case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE:
+		++sinkState->receivedMessage;
+		break;
+	case WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED:
+		++sinkState->rudeWindowChanged;
+		break;
+	case WindowInvestigator_MonitorEvent_EVENTS_DROPPED:
+		++sinkState->eventsDropped;
+		if (!WindowInvestigator_DecodeEventsDropped(event->record, event->recordSize, &sinkState->reportedDroppedCount)) abort();
+		break;
+	case WindowInvestigator_MonitorEvent_TICK_FINISHED:
+		++sinkState->tickFinished;
+		break;
+	}
+}
+
+// Plays the part of the messages that trigger WindowMonitor ticks: mostly shell hook messages about the foreground window,
+// with the occasional ABN_FULLSCREENAPP appbar notification.
+static void WindowMonitorSimulator_PushMessage(WindowInvestigator_EventQueue* eventQueue, const WindowInvestigator_Monitor* monitor, uint64_t messageIndex) {
+	if (messageIndex % 10 == 9) {
+		// ABN_FULLSCREENAPP (2), alternately opening (1) and closing (0).
+		WindowInvestigator_EventQueue_PushReceivedMessage(eventQueue, WindowInvestigator_ReceivedMessage_APPBAR, 0x400, 2, (messageIndex / 10) % 2 == 0);
+		return;
+	}
+	const uintptr_t foregroundWindow = WindowInvestigator_WindowTable_GetZOrderCount(&monitor->windows) == 0 ? 0 :
+		WindowInvestigator_WindowTable_GetWindow(&monitor->windows, WindowInvestigator_WindowTable_GetZOrderSlot(&monitor->windows, 0));
+	// HSHELL_WINDOWACTIVATED (4), with the typical SHELLHOOK message identifier.
+	WindowInvestigator_EventQueue_PushReceivedMessage(eventQueue, WindowInvestigator_ReceivedMessage_SHELL_HOOK, 0xC029, 4, foregroundWindow);
+}
+
+static FILE* WindowMonitorSimulator_OpenFile(const char* path, const char* mode) {
+#ifdef _MSC_VER
+	FILE* file;
+	return fopen_s(&file, path, mode) == 0 ? file : NULL;
+#else
+	return fopen(path, mode);
+#endif
+}
+
+static void WindowMonitorSimulator_FinishCapture(WindowInvestigator_CaptureWriter* captureWriter, const char* capturePath) {
+	const bool flushed = WindowInvestigator_CaptureWriter_Flush(captureWriter);
+	const uint64_t recordsWritten = captureWriter->recordsWritten;
+	const uint64_t bytesWritten = captureWriter->bytesWritten;
+	FILE* const captureFile = captureWriter->file;
+	WindowInvestigator_CaptureWriter_Destroy(captureWriter);
+	if (fclose(captureFile) != 0 || !flushed) {
+		fprintf(stderr, "Unable to write capture file \"%s\"\n", capturePath);
+		exit(EXIT_FAILURE);
+	}
+
+	// Read the capture back, to make sure it is consistent with what was written.
+	FILE* const file = WindowMonitorSimulator_OpenFile(capturePath, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to open capture file \"%s\"\n", capturePath);
+		exit(EXIT_FAILURE);
+	}
+	WindowInvestigator_CaptureReader reader;
+	if (!WindowInvestigator_CaptureReader_Init(&reader, file)) {
+		fprintf(stderr, "Invalid capture file header\n");
+		exit(EXIT_FAILURE);
+	}
+	uint64_t recordsRead = 0;
+	WindowInvestigator_CaptureRecordHeader header;
+	const unsigned char* payload;
+	WindowInvestigator_CaptureReader_Result result;
+	while ((result = WindowInvestigator_CaptureReader_ReadRecord(&reader, &header, &payload)) == WindowInvestigator_CaptureReader_RECORD) {
+		bool valid = true;
+		if (header.type == WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE) {
+			uint64_t wParam, lParam;
+			valid = WindowInvestigator_DecodeReceivedMessage(payload, header.payloadSize, &wParam, &lParam);
+		}
+		else if (header.type == WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED) {
+			uint64_t previousWindow;
+			WindowInvestigator_Rect monitorRect;
+			valid = WindowInvestigator_DecodeRudeWindowChanged(payload, header.payloadSize, &previousWindow, &monitorRect);
+		}
+		else if (header.type == WindowInvestigator_MonitorEvent_EVENTS_DROPPED) {
+			uint64_t droppedCount;
+			valid = WindowInvestigator_DecodeEventsDropped(payload, header.payloadSize, &droppedCount);
+		}
+		else if (header.payloadSize != 0) {
+			uint32_t fields;
+			WindowInvestigator_WindowInfo windowInfo;
+			WindowInvestigator_WindowStrings windowStrings;
+			valid = WindowInvestigator_DecodeWindowRecord(payload, header.payloadSize, &fields, &windowInfo, &windowStrings) == header.payloadSize;
+		}
+		if (!valid) {
+			fprintf(stderr, "Invalid record in capture file\n");
+			exit(EXIT_FAILURE);
+		}
+		++recordsRead;
+	}
+	WindowInvestigator_CaptureReader_Destroy(&reader);
+	fclose(file);
+	if (result != WindowInvestigator_CaptureReader_END || recordsRead != recordsWritten) {
+		fprintf(stderr, "Capture file read back %" PRIu64 " records out of %" PRIu64 " written (result %d)\n", recordsRead, recordsWritten, (int)result);
+		exit(EXIT_FAILURE);
+	}
+	printf("Capture: %" PRIu64 " records, %" PRIu64 " bytes, read back successfully\n", recordsWritten, bytesWritten);
+}
+
+static int WindowMonitorSimulator_CompareUInt64(const void* lhs, const void* rhs) {
+	const uint64_t left = *(const uint64_t*)lhs;
+	const uint64_t right = *(const uint64_t*)rhs;
+	return left < right ? -1 : left > right;
+}
+
+static uint64_t WindowMonitorSimulator_Random(uint64_t* state) {
+	// SplitMix64
+	uint64_t value = (*state += 0x9E3779B97F4A7C15);
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+	return value ^ (value >> 31);
+}
+
+static int32_t WindowMonitorSimulator_RandomCoordinate(uint64_t* randomState, int32_t min, int32_t max) {
+	return min + (int32_t)(WindowMonitorSimulator_Random(randomState) % (uint64_t)(max - min));
+}
+
+// Reference implementations of the spatial index queries, that scan every window in Z-order.
+static uintptr_t WindowMonitorSimulator_FindCoveringWindow(const WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect) {
+	for (size_t zOrder = 0; zOrder < WindowInvestigator_WindowTable_GetZOrderCount(index->windows); ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(index->windows, zOrder);
+		const WindowInvestigator_Rect* const windowRect = WindowInvestigator_SpatialIndex_GetRect(index, WindowInvestigator_WindowTable_GetValue(index->windows, slot));
+		if (windowRect != NULL && windowRect->left <= rect->left && windowRect->top <= rect->top && windowRect->right >= rect->right && windowRect->bottom >= rect->bottom)
+			return WindowInvestigator_WindowTable_GetWindow(index->windows, slot);
+	}
+	return 0;
+}
+
+static bool WindowMonitorSimulator_Intersects(const WindowInvestigator_Rect* lhs, const WindowInvestigator_Rect* rhs) {
+	return lhs->left < rhs->right && rhs->left < lhs->right && lhs->top < rhs->bottom && rhs->top < lhs->bottom;
+}
+
+static uint64_t WindowMonitorSimulator_HashOverlappingWindows(const WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect) {
+	uint64_t hash = 0;
+	for (size_t zOrder = 0; zOrder < WindowInvestigator_WindowTable_GetZOrderCount(index->windows); ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(index->windows, zOrder);
+		const WindowInvestigator_Rect* const windowRect = WindowInvestigator_SpatialIndex_GetRect(index, WindowInvestigator_WindowTable_GetValue(index->windows, slot));
+		if (windowRect != NULL && WindowMonitorSimulator_Intersects(windowRect, rect)) hash += WindowInvestigator_WindowTable_GetWindow(index->windows, slot) * 0x9E3779B97F4A7C15 + 1;
+	}
+	return hash;
+}
+
+static uintptr_t WindowMonitorSimulator_FindTopmostOccluder(const WindowInvestigator_SpatialIndex* index, uintptr_t window) {
+	const size_t windowSlot = WindowInvestigator_WindowTable_Find(index->windows, window);
+	const WindowInvestigator_Rect* const windowRect = WindowInvestigator_SpatialIndex_GetRect(index, WindowInvestigator_WindowTable_GetValue(index->windows, windowSlot));
+	if (windowRect == NULL) return 0;
+	for (size_t zOrder = 0; zOrder < WindowInvestigator_WindowTable_GetZOrder(index->windows, windowSlot); ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(index->windows, zOrder);
+		const WindowInvestigator_Rect* const rect = WindowInvestigator_SpatialIndex_GetRect(index, WindowInvestigator_WindowTable_GetValue(index->windows, slot));
+		if (rect != NULL && WindowMonitorSimulator_Intersects(rect, windowRect)) return WindowInvestigator_WindowTable_GetWindow(index->windows, slot);
+	}
+	return 0;
+}
+
+static void WindowMonitorSimulator_HashOverlappingWindow(void* context, uintptr_t window) {
+	uint64_t* const hash = context;
+	*hash += window * 0x9E3779B97F4A7C15 + 1;
+}
+
+// Runs queryCount queries of each kind against the index, which has been maintained incrementally throughout the run, and
+// checks the results against a scan of every window. Returns the number of mismatches.
+static uint64_t WindowMonitorSimulator_BenchmarkSpatialIndex(WindowInvestigator_SpatialIndex* index, const char* name, uint64_t queryCount, uint64_t seed) {
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(index->windows);
+	if (windowCount == 0) return 0;
+	WindowInvestigator_Rect* const rects = malloc((size_t)queryCount * sizeof(*rects));
+	uintptr_t* const windows = malloc((size_t)queryCount * sizeof(*windows));
+	uint64_t* const indexResults = malloc((size_t)queryCount * sizeof(*indexResults));
+	if (rects == NULL || windows == NULL || indexResults == NULL) abort();
+
+	// Coverage queries are run against every monitor in turn, and against random small rects.
+	uint64_t randomState = seed;
+	const WindowInvestigator_Rect* const monitors = WindowInvestigator_SimulatedDesktop_GetMonitors();
+	for (uint64_t query = 0; query < queryCount; ++query) {
+		const size_t monitor = (size_t)(query % (WindowInvestigator_SimulatedDesktop_MONITOR_COUNT + 1));
+		if (monitor < WindowInvestigator_SimulatedDesktop_MONITOR_COUNT) {
+			rects[query] = monitors[monitor];
+			continue;
+		}
+		rects[query].left = WindowMonitorSimulator_RandomCoordinate(&randomState, index->bounds.left, index->bounds.right);
+		rects[query].top = WindowMonitorSimulator_RandomCoordinate(&randomState, index->bounds.top, index->bounds.bottom);
+		rects[query].right = rects[query].left + 1 + (int32_t)(WindowMonitorSimulator_Random(&randomState) % 100);
+		rects[query].bottom = rects[query].top + 1 + (int32_t)(WindowMonitorSimulator_Random(&randomState) % 100);
+	}
+	uint64_t mismatchCount = 0;
+	uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t query = 0; query < queryCount; ++query)
+		indexResults[query] = WindowInvestigator_SpatialIndex_FindCoveringWindow(index, &rects[query]);
+	const uint64_t coverageDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+	startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t query = 0; query < queryCount; ++query)
+		if (WindowMonitorSimulator_FindCoveringWindow(index, &rects[query]) != indexResults[query]) ++mismatchCount;
+	const uint64_t coverageScanDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+
+	for (uint64_t query = 0; query < queryCount; ++query) {
+		rects[query].left = WindowMonitorSimulator_RandomCoordinate(&randomState, index->bounds.left, index->bounds.right);
+		rects[query].top = WindowMonitorSimulator_RandomCoordinate(&randomState, index->bounds.top, index->bounds.bottom);
+		rects[query].right = rects[query].left + 1 + (int32_t)(WindowMonitorSimulator_Random(&randomState) % 800);
+		rects[query].bottom = rects[query].top + 1 + (int32_t)(WindowMonitorSimulator_Random(&randomState) % 800);
+	}
+	uint64_t overlappingWindowCount = 0;
+	startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t query = 0; query < queryCount; ++query) {
+		indexResults[query] = 0;
+		overlappingWindowCount += WindowInvestigator_SpatialIndex_ForEachOverlappingWindow(index, &rects[query], WindowMonitorSimulator_HashOverlappingWindow, &indexResults[query]);
+	}
+	const uint64_t overlapDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+	startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t query = 0; query < queryCount; ++query)
+		if (WindowMonitorSimulator_HashOverlappingWindows(index, &rects[query]) != indexResults[query]) ++mismatchCount;
+	const uint64_t overlapScanDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+
+	for (uint64_t query = 0; query < queryCount; ++query)
+		windows[query] = WindowInvestigator_WindowTable_GetWindow(index->windows,
+			WindowInvestigator_WindowTable_GetZOrderSlot(index->windows, (size_t)(WindowMonitorSimulator_Random(&randomState) % windowCount)));
+	startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t query = 0; query < queryCount; ++query)
+		indexResults[query] = WindowInvestigator_SpatialIndex_FindTopmostOccluder(index, windows[query]);
+	const uint64_t occluderDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+	startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t query = 0; query < queryCount; ++query)
+		if (WindowMonitorSimulator_FindTopmostOccluder(index, windows[query]) != indexResults[query]) ++mismatchCount;
+	const uint64_t occluderScanDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+
+	size_t indexedWindowCount = 0;
+	for (size_t slot = 0; slot < index->entryCapacity; ++slot)
+		if (index->entries[slot].window != 0) ++indexedWindowCount;
+	printf("Spatial index (%s): %zu windows indexed out of %zu, %zux%zu cells; query (ns, index vs. scan) coverage %" PRIu64 " vs. %" PRIu64 " overlap %" PRIu64 " vs. %" PRIu64 " (%.1f windows) occluder %" PRIu64 " vs. %" PRIu64 "; %" PRIu64 " mismatches\n",
+		name, indexedWindowCount, windowCount, index->columnCount, index->rowCount,
+		coverageDuration / queryCount, coverageScanDuration / queryCount,
+		overlapDuration / queryCount, overlapScanDuration / queryCount, (double)overlappingWindowCount / (double)queryCount,
+		occluderDuration / queryCount, occluderScanDuration / queryCount, mismatchCount);
+
+	free(indexResults);
+	free(windows);
+	free(rects);
+	return mismatchCount;
+}
+
+typedef struct {
+	uint64_t movedCount;
+	uint64_t goneCount;
+} WindowMonitorSimulator_WindowTableBenchmarkState;
+
+static void WindowMonitorSimulator_OnBenchmarkWindowGone(void* context, uintptr_t window, void* value) {
+	(void)window;
+	(void)value;
+	++((WindowMonitorSimulator_WindowTableBenchmarkState*)context)->goneCount;
+}
+
+static void WindowMonitorSimulator_OnBenchmarkZOrderChanged(void* context, uintptr_t window, void* value, size_t previousZOrder, size_t zOrder) {
+	(void)window;
+	(void)value;
+	(void)previousZOrder;
+	(void)zOrder;
+	++((WindowMonitorSimulator_WindowTableBenchmarkState*)context)->movedCount;
+}
+
+// Times passCount passes over window tables of increasing sizes, filled with synthetic window handles independently of the
+// simulated desktop. Before each pass, a random window is brought to the front and another one is replaced with a new window,
+// so every pass reports exactly one move (unless the window was already in front) and one window gone. The cost per window
+// should stay flat as the number of windows grows. Returns the number of passes that did not report what they should have.
+static uint64_t WindowMonitorSimulator_BenchmarkWindowTable(uint64_t passCount, uint64_t seed) {
+	static const size_t windowCounts[] = { 100, 1000, 10000, 100000 };
+	uint64_t randomState = seed;
+	uint64_t mismatchCount = 0;
+	printf("Window table (ns per window per pass):");
+	for (size_t countIndex = 0; countIndex < sizeof(windowCounts) / sizeof(*windowCounts); ++countIndex) {
+		const size_t windowCount = windowCounts[countIndex];
+		uintptr_t* const windows = malloc(windowCount * sizeof(*windows));
+		if (windows == NULL) abort();
+		// Real window handles are multiples of 2 that share their high bits.
+		uintptr_t nextWindow = 0x10000;
+		for (size_t zOrder = 0; zOrder < windowCount; ++zOrder, nextWindow += 2) windows[zOrder] = nextWindow;
+
+		WindowInvestigator_WindowTable table;
+		WindowInvestigator_WindowTable_Init(&table, 0);
+		WindowMonitorSimulator_WindowTableBenchmarkState state;
+		WindowInvestigator_WindowTable_PassCallbacks callbacks;
+		callbacks.onWindowGone = WindowMonitorSimulator_OnBenchmarkWindowGone;
+		callbacks.onZOrderChanged = WindowMonitorSimulator_OnBenchmarkZOrderChanged;
+		callbacks.context = &state;
+		uint64_t duration = 0;
+		for (uint64_t pass = 0; pass <= passCount; ++pass) {
+			bool raised = false;
+			// The first pass discovers every window, and is not measured.
+			if (pass != 0) {
+				const size_t raisedZOrder = (size_t)(WindowMonitorSimulator_Random(&randomState) % windowCount);
+				const uintptr_t raisedWindow = windows[raisedZOrder];
+				memmove(&windows[1], &windows[0], raisedZOrder * sizeof(*windows));
+				windows[0] = raisedWindow;
+				raised = raisedZOrder != 0;
+				windows[1 + (size_t)(WindowMonitorSimulator_Random(&randomState) % (windowCount - 1))] = nextWindow;
+				nextWindow += 2;
+			}
+
+			state.movedCount = state.goneCount = 0;
+			const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+			WindowInvestigator_WindowTable_BeginPass(&table);
+			for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+				WindowInvestigator_WindowTable_VisitResult result;
+				WindowInvestigator_WindowTable_Visit(&table, windows[zOrder], &result);
+			}
+			WindowInvestigator_WindowTable_EndPass(&table, &callbacks);
+			if (pass != 0) {
+				duration += WindowInvestigator_GetTimeNanoseconds() - startTime;
+				if (state.movedCount != (raised ? 1 : 0) || state.goneCount != 1) ++mismatchCount;
+			}
+		}
+		printf(" %zu:%.2f", windowCount, (double)duration / (double)(passCount * windowCount));
+
+		WindowInvestigator_WindowTable_Destroy(&table);
+		free(windows);
+	}
+	printf("; %" PRIu64 " mismatches\n", mismatchCount);
+	return mismatchCount;
+}
+
+// Times passCount Z-order diffs of 1,000 to 10,000 windows for each kind of permutation: a single window raised to the front,
+// a few windows swapped, and a full shuffle. Raising a window must report exactly one move; returns the number of diffs that
+// did not.
+static uint64_t WindowMonitorSimulator_BenchmarkZOrderDiff(uint64_t passCount, uint64_t seed) {
+	static const size_t windowCounts[] = { 1000, 2000, 5000, 10000 };
+	static const char* const permutationNames[] = { "raise", "swaps", "shuffle" };
+	const size_t maxWindowCount = windowCounts[sizeof(windowCounts) / sizeof(*windowCounts) - 1];
+	size_t* const previousZOrders = malloc(maxWindowCount * sizeof(*previousZOrders));
+	bool* const moved = malloc(maxWindowCount * sizeof(*moved));
+	if (previousZOrders == NULL || moved == NULL) abort();
+	WindowInvestigator_ZOrderDiff diff;
+	WindowInvestigator_ZOrderDiff_Init(&diff);
+	uint64_t randomState = seed;
+	uint64_t mismatchCount = 0;
+	printf("Z-order diff (ns per window, mean windows moved):");
+	for (size_t countIndex = 0; countIndex < sizeof(windowCounts) / sizeof(*windowCounts); ++countIndex) {
+		const size_t windowCount = windowCounts[countIndex];
+		for (size_t permutation = 0; permutation < sizeof(permutationNames) / sizeof(*permutationNames); ++permutation) {
+			uint64_t duration = 0;
+			uint64_t movedCount = 0;
+			for (uint64_t pass = 0; pass < passCount; ++pass) {
+				for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) previousZOrders[zOrder] = zOrder;
+				size_t raisedZOrder = 0;
+				if (permutation == 0) {
+					raisedZOrder = (size_t)(WindowMonitorSimulator_Random(&randomState) % windowCount);
+					memmove(&previousZOrders[1], &previousZOrders[0], raisedZOrder * sizeof(*previousZOrders));
+					previousZOrders[0] = raisedZOrder;
+				}
+				else {
+					const size_t swapCount = permutation == 1 ? 10 : windowCount;
+					for (size_t swap = 0; swap < swapCount; ++swap) {
+						const size_t first = permutation == 1 ? (size_t)(WindowMonitorSimulator_Random(&randomState) % windowCount) : windowCount - 1 - swap;
+						const size_t second = (size_t)(WindowMonitorSimulator_Random(&randomState) % (permutation == 1 ? windowCount : first + 1));
+						const size_t previousZOrder = previousZOrders[first];
+						previousZOrders[first] = previousZOrders[second];
+						previousZOrders[second] = previousZOrder;
+					}
+				}
+
+				const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+				const size_t passMovedCount = WindowInvestigator_ZOrderDiff_Compute(&diff, previousZOrders, windowCount, moved);
+				duration += WindowInvestigator_GetTimeNanoseconds() - startTime;
+				movedCount += passMovedCount;
+				if (permutation == 0 && passMovedCount != (raisedZOrder != 0 ? 1 : 0)) ++mismatchCount;
+			}
+			printf(" %zu %s %.2f %.1f;", windowCount, permutationNames[permutation], (double)duration / (double)(passCount * windowCount), (double)movedCount / (double)passCount);
+		}
+	}
+	printf(" %" PRIu64 " mismatches\n", mismatchCount);
+	WindowInvestigator_ZOrderDiff_Destroy(&diff);
+	free(moved);
+	free(previousZOrders);
+	return mismatchCount;
+}
+
+// Diffs the snapshot of every window in the table against a copy in which a tenth of the windows changed, passCount times with
+// each supported kernel, and checks that every kernel agrees with the scalar one. Returns the number of mismatches.
+static uint64_t WindowMonitorSimulator_BenchmarkWindowInfoDiff(const WindowInvestigator_WindowTable* windows, uint64_t passCount, uint64_t seed) {
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(windows);
+	if (windowCount == 0) return 0;
+	WindowInvestigator_WindowInfo* const oldWindowInfos = malloc(windowCount * sizeof(*oldWindowInfos));
+	WindowInvestigator_WindowInfo* const newWindowInfos = malloc(windowCount * sizeof(*newWindowInfos));
+	uint32_t* const expectedChangedFields = malloc(windowCount * sizeof(*expectedChangedFields));
+	uint32_t* const changedFields = malloc(windowCount * sizeof(*changedFields));
+	if (oldWindowInfos == NULL || newWindowInfos == NULL || expectedChangedFields == NULL || changedFields == NULL) abort();
+
+	uint64_t randomState = seed;
+	size_t changedWindowCount = 0;
+	for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+		oldWindowInfos[zOrder] = *(const WindowInvestigator_WindowInfo*)WindowInvestigator_WindowTable_GetValue(windows, WindowInvestigator_WindowTable_GetZOrderSlot(windows, zOrder));
+		newWindowInfos[zOrder] = oldWindowInfos[zOrder];
+		if (WindowMonitorSimulator_Random(&randomState) % 10 != 0) continue;
+		++changedWindowCount;
+		switch (WindowMonitorSimulator_Random(&randomState) % 4) {
+		case 0: ++newWindowInfos[zOrder].windowRect.left; break;
+		case 1: newWindowInfos[zOrder].styles ^= 0x10000000; break;
+		case 2: newWindowInfos[zOrder].isIconic = !newWindowInfos[zOrder].isIconic; break;
+		default: ++newWindowInfos[zOrder].text; break;
+		}
+	}
+
+	uint64_t mismatchCount = 0;
+	printf("Window info diff (ns per window, %zu windows, %zu changed):", windowCount, changedWindowCount);
+	for (int kernel = 0; kernel < WindowInvestigator_WindowInfoDiffKernel_COUNT; ++kernel) {
+		if (!WindowInvestigator_WindowInfoDiffKernel_IsSupported((WindowInvestigator_WindowInfoDiffKernel)kernel)) continue;
+		const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+		for (uint64_t pass = 0; pass < passCount; ++pass)
+			for (size_t zOrder = 0; zOrder < windowCount; ++zOrder)
+				changedFields[zOrder] = WindowInvestigator_DiffWindowInfoWithKernel((WindowInvestigator_WindowInfoDiffKernel)kernel, &oldWindowInfos[zOrder], &newWindowInfos[zOrder]);
+		const uint64_t duration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+		for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+			if (kernel == WindowInvestigator_WindowInfoDiffKernel_SCALAR) expectedChangedFields[zOrder] = changedFields[zOrder];
+			else if (changedFields[zOrder] != expectedChangedFields[zOrder]) ++mismatchCount;
+		}
+		printf(" %s %.2f", WindowInvestigator_WindowInfoDiffKernel_GetName((WindowInvestigator_WindowInfoDiffKernel)kernel), (double)duration / (double)(passCount * windowCount));
+	}
+	printf("; %s is used; %" PRIu64 " mismatches\n", WindowInvestigator_WindowInfoDiffKernel_GetName(WindowInvestigator_WindowInfoDiffKernel_GetBest()), mismatchCount);
+
+	free(changedFields);
+	free(expectedChangedFields);
+	free(newWindowInfos);
+	free(oldWindowInfos);
+	return mismatchCount;
+}
+
+// Formats a snapshot event of every window in the table passCount times in each format. Returns the number of records that
+// were rejected as malformed. The output itself is checked by tests/structured_output_test.c.
+static uint64_t WindowMonitorSimulator_BenchmarkStructuredOutput(const WindowInvestigator_WindowTable* windows, const WindowInvestigator_StringPool* strings, uint64_t passCount) {
+	// Same records as the WINDOW_SNAPSHOT events of a keyframe.
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(windows);
+	unsigned char* const records = malloc(windowCount * WindowInvestigator_WindowRecord_MAX_SIZE + 1);
+	size_t* const recordSizes = malloc(windowCount * sizeof(*recordSizes) + 1);
+	if (records == NULL || recordSizes == NULL) abort();
+	for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(windows, zOrder);
+		recordSizes[zOrder] = WindowInvestigator_EncodeWindowRecord(records + zOrder * WindowInvestigator_WindowRecord_MAX_SIZE, WindowInvestigator_WindowField_ALL, WindowInvestigator_WindowTable_GetValue(windows, slot), strings);
+	}
+
+	uint64_t malformedCount = 0;
+	printf("Structured output (%zu windows):", windowCount);
+	for (int format = 0; format < WindowInvestigator_StructuredFormat_COUNT; ++format) {
+		WindowInvestigator_StructuredWriter writer;
+		WindowInvestigator_StructuredWriter_Init(&writer, (WindowInvestigator_StructuredFormat)format, NULL);
+		uint64_t outputSize = 0;
+		const uint64_t allocationCount = WindowInvestigator_GetAllocationCount();
+		const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+		for (uint64_t pass = 0; pass < passCount; ++pass)
+			for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+				const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(windows, zOrder);
+				const size_t previousBufferSize = writer.bufferSize;
+				if (!WindowInvestigator_StructuredWriter_WriteEvent(&writer, pass, WindowInvestigator_WindowTable_GetWindow(windows, slot), WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT, (uint32_t)zOrder, 0,
+					records + zOrder * WindowInvestigator_WindowRecord_MAX_SIZE, recordSizes[zOrder])) ++malformedCount;
+				// The buffer is emptied whenever it gets full.
+				outputSize += writer.bufferSize > previousBufferSize ? writer.bufferSize - previousBufferSize : writer.bufferSize;
+			}
+		const uint64_t duration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+		const uint64_t eventCount = passCount * windowCount;
+		printf(" %s %.1f ns per event, %.0f MB/s, %" PRIu64 " allocations;", WindowInvestigator_StructuredFormat_GetName((WindowInvestigator_StructuredFormat)format),
+			eventCount == 0 ? 0 : (double)duration / (double)eventCount, duration == 0 ? 0 : (double)outputSize * 1e3 / (double)duration, WindowInvestigator_GetAllocationCount() - allocationCount);
+		WindowInvestigator_StructuredWriter_Destroy(&writer);
+	}
+	printf(" %" PRIu64 " malformed records\n", malformedCount);
+
+	free(recordSizes);
+	free(records);
+	return malformedCount;
+}
+
+static void WindowMonitorSimulator_PrintHistogram(const char* name, const WindowInvestigator_Histogram* histogram) {
+	printf("%s (ns): min %" PRIu64 " mean %" PRIu64 " p50 %" PRIu64 " p99 %" PRIu64 " p99.9 %" PRIu64 " max %" PRIu64 "\n", name,
+		WindowInvestigator_Histogram_GetPercentile(histogram, 0), WindowInvestigator_Histogram_GetMean(histogram),
+		WindowInvestigator_Histogram_GetPercentile(histogram, 50), WindowInvestigator_Histogram_GetPercentile(histogram, 99),
+		WindowInvestigator_Histogram_GetPercentile(histogram, 99.9), WindowInvestigator_Histogram_GetPercentile(histogram, 100));
+}
+
+// Same as WindowMonitor single-window mode: samples the frontmost window every period, and reports how precise the timing
+// was. Unlike monitor ticks, this runs in real time.
+static void WindowMonitorSimulator_MonitorSingleWindow(const WindowInvestigator_MonitorBackend* backend, const WindowInvestigator_PeriodicTimerOptions* timerOptions, uint64_t sampleCount) {
+	const uintptr_t window = backend->getNextWindow(backend->context, 0);
+	WindowInvestigator_WindowInfo windowInfo;
+	memset(&windowInfo, 0, sizeof(windowInfo));
+	WindowInvestigator_WindowStrings windowStrings;
+
+	WindowInvestigator_PeriodicTimer timer;
+	WindowInvestigator_PeriodicTimer_Init(&timer, timerOptions);
+	WindowInvestigator_Histogram* const sampleDurations = malloc(sizeof(*sampleDurations));
+	if (sampleDurations == NULL) abort();
+	WindowInvestigator_Histogram_Reset(sampleDurations);
+	for (uint64_t sample = 0; sample < sampleCount; ++sample) {
+		const uint64_t startTime = WindowInvestigator_PeriodicTimer_Wait(&timer);
+		backend->getWindowInfo(backend->context, window, WindowInvestigator_WindowField_ALL, &windowInfo, &windowStrings);
+		WindowInvestigator_Histogram_Record(sampleDurations, WindowInvestigator_GetTimeNanoseconds() - startTime);
+	}
+
+	printf("Single window: target period %" PRIu64 " ns, spin %" PRIu64 " ns, %" PRIu64 " samples, %" PRIu64 " missed deadlines\n",
+		timer.options.periodNanoseconds, timer.options.spinNanoseconds, sampleCount, timer.missedDeadlines);
+	WindowMonitorSimulator_PrintHistogram("Period", timer.period);
+	WindowMonitorSimulator_PrintHistogram("Lateness", timer.lateness);
+	WindowMonitorSimulator_PrintHistogram("Sample duration", sampleDurations);
+	free(sampleDurations);
+	WindowInvestigator_PeriodicTimer_Destroy(&timer);
+}
+
+// Same as BroadcastShellHookMessage --script, without sending anything: waits for every message of the script at its due time,
+// and reports how late the waits were. Like single-window mode, this runs in real time.
+static int WindowMonitorSimulator_ReplayMessageScript(const char* path, const WindowInvestigator_PeriodicTimerOptions* timerOptions) {
+	FILE* const file = WindowMonitorSimulator_OpenFile(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to open script \"%s\"\n", path);
+		return EXIT_FAILURE;
+	}
+	char* const text = WindowInvestigator_ReadTextFile(file);
+	fclose(file);
+	if (text == NULL) {
+		fprintf(stderr, "Unable to read script \"%s\"\n", path);
+		return EXIT_FAILURE;
+	}
+	WindowInvestigator_MessageScript script;
+	WindowInvestigator_MessageScript_Init(&script);
+	size_t errorLine;
+	const bool parsed = WindowInvestigator_MessageScript_Parse(&script, text, &errorLine);
+	WindowInvestigator_Free(text);
+	if (!parsed) {
+		fprintf(stderr, "Invalid script \"%s\" at line %zu\n", path, errorLine);
+		return EXIT_FAILURE;
+	}
+
+	WindowInvestigator_PeriodicTimer timer;
+	WindowInvestigator_PeriodicTimer_Init(&timer, timerOptions);
+	const uint64_t messageCount = WindowInvestigator_MessageScript_GetMessageCount(&script);
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (uint64_t index = 0; index < messageCount; ++index) {
+		WindowInvestigator_ScriptedMessage message;
+		WindowInvestigator_MessageScript_GetMessage(&script, index, &message);
+		WindowInvestigator_PeriodicTimer_WaitUntil(&timer, startTime + message.offsetNanoseconds);
+	}
+
+	printf("Message script: %" PRIu64 " messages in %.3f s, spin %" PRIu64 " ns\n", messageCount, (double)(WindowInvestigator_GetTimeNanoseconds() - startTime) / 1e9, timer.options.spinNanoseconds);
+	const char* const names[] = { "Lateness (ns)" };
+	const WindowInvestigator_Histogram* const histograms[] = { timer.lateness };
+	WindowInvestigator_Histogram_PrintPercentileTable(stdout, names, histograms, 1);
+	WindowInvestigator_PeriodicTimer_Destroy(&timer);
+	WindowInvestigator_MessageScript_Destroy(&script);
+	return EXIT_SUCCESS;
+}
+
+// Same latencies as WindowMonitor: the phases of a tick, then event emission, then the time between a message and the end of
+// the corresponding tick.
+#define WindowMonitorSimulator_LATENCY_EMISSION WindowInvestigator_MonitorPhase_COUNT
+#define WindowMonitorSimulator_LATENCY_MESSAGE_TO_DONE (WindowInvestigator_MonitorPhase_COUNT + 1)
+#define WindowMonitorSimulator_LATENCY_COUNT (WindowInvestigator_MonitorPhase_COUNT + 2)
+
+// latencies must hold WindowMonitorSimulator_LATENCY_COUNT histograms.
+static void WindowMonitorSimulator_GetLatencies(const WindowInvestigator_Monitor* monitor, const WindowInvestigator_EventQueue* eventQueue, const WindowInvestigator_Histogram* messageToDoneLatencies, WindowInvestigator_Histogram* latencies) {
+	for (size_t latency = 0; latency < WindowMonitorSimulator_LATENCY_COUNT; ++latency)
+		WindowInvestigator_Histogram_Reset(&latencies[latency]);
+	for (int phase = 0; phase < WindowInvestigator_MonitorPhase_COUNT; ++phase)
+		WindowInvestigator_Monitor_GetPhaseDurations(monitor, (WindowInvestigator_MonitorPhase)phase, &latencies[phase]);
+	WindowInvestigator_EventQueue_GetEmissionDurations(eventQueue, &latencies[WindowMonitorSimulator_LATENCY_EMISSION]);
+	WindowInvestigator_Histogram_Merge(&latencies[WindowMonitorSimulator_LATENCY_MESSAGE_TO_DONE], messageToDoneLatencies);
+}
+
+static void WindowMonitorSimulator_PrintLatencies(const WindowInvestigator_Histogram* latencies) {
+	const char* names[WindowMonitorSimulator_LATENCY_COUNT];
+	const WindowInvestigator_Histogram* histograms[WindowMonitorSimulator_LATENCY_COUNT];
+	for (size_t latency = 0; latency < WindowMonitorSimulator_LATENCY_COUNT; ++latency) {
+		names[latency] = latency < WindowInvestigator_MonitorPhase_COUNT ? WindowInvestigator_MonitorPhase_GetName((WindowInvestigator_MonitorPhase)latency) :
+			latency == WindowMonitorSimulator_LATENCY_EMISSION ? "Emission" : "MessageToDone";
+		histograms[latency] = &latencies[latency];
+	}
+	printf("Latencies (ns):\n");
+	WindowInvestigator_Histogram_PrintPercentileTable(stdout, names, histograms, WindowMonitorSimulator_LATENCY_COUNT);
+}
+
+typedef struct {
+	const WindowInvestigator_SimulatedDesktop* desktop;
+	const WindowInvestigator_WindowFilter* filter;
+} WindowMonitorSimulator_FilterContext;
+
+// Same as WindowMonitor filtered mode.
+static bool WindowMonitorSimulator_FilterWindow(void* context, uintptr_t window) {
+	const WindowMonitorSimulator_FilterContext* const filterContext = context;
+	uint32_t processId;
+	const wchar_t* className;
+	if (!WindowInvestigator_SimulatedDesktop_GetWindowIdentity(filterContext->desktop, window, &processId, &className)) return false;
+	return WindowInvestigator_WindowFilter_Matches(filterContext->filter, window, processId, className,
+		WindowInvestigator_WindowFilter_UsesImageName(filterContext->filter) ? WindowInvestigator_SimulatedDesktop_GetImageName(processId) : NULL);
+}
+
+static void WindowMonitorSimulator_AddFilter(WindowInvestigator_WindowFilter* filter, WindowInvestigator_WindowFilterKind kind, const char* list) {
+	const size_t length = strlen(list);
+	wchar_t* const wideList = WindowInvestigator_Reallocate(NULL, length + 1, sizeof(*wideList));
+	for (size_t index = 0; index <= length; ++index)
+		wideList[index] = (wchar_t)(unsigned char)list[index];
+	const bool valid = WindowInvestigator_WindowFilter_Add(filter, kind, wideList);
+	WindowInvestigator_Free(wideList);
+	if (!valid) WindowMonitorSimulator_Usage();
+}
+
+typedef struct {
+	WindowInvestigator_WindowNotification notification;
+	uintptr_t window;
+	uint64_t timestamp;
+	uint64_t dueTick;
+} WindowMonitorSimulator_DelayedNotification;
+
+// Plays the part of the WinEvent hook in incremental mode. Notifications can be dropped, or delayed by a few ticks, in which
+// case they are delivered out of order, with their original timestamp.
+typedef struct {
+	WindowInvestigator_Monitor* monitor;
+	// Separate from the desktop, so that dropping and delaying notifications does not change the simulation itself.
+	uint64_t randomState;
+	double dropRate;
+	double delayRate;
+	uint64_t tick;
+	WindowMonitorSimulator_DelayedNotification* delayed;
+	size_t delayedCount;
+	size_t delayedCapacity;
+
+	uint64_t notificationCount;
+	uint64_t droppedCount;
+	uint64_t delayedTotal;
+} WindowMonitorSimulator_NotificationSource;
+
+static double WindowMonitorSimulator_RandomUnit(uint64_t* state) {
+	return (double)(WindowMonitorSimulator_Random(state) >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+static void WindowMonitorSimulator_OnNotification(void* context, WindowInvestigator_WindowNotification notification, uintptr_t window) {
+	WindowMonitorSimulator_NotificationSource* const source = context;
+	const uint64_t timestamp = WindowInvestigator_GetTimeNanoseconds();
+	++source->notificationCount;
+	if (source->dropRate > 0 && WindowMonitorSimulator_RandomUnit(&source->randomState) < source->dropRate) {
+		++source->droppedCount;
+		return;
+	}
+	if (source->delayRate > 0 && WindowMonitorSimulator_RandomUnit(&source->randomState) < source->delayRate) {
+		if (source->delayedCount == source->delayedCapacity) {
+			source->delayedCapacity = source->delayedCapacity == 0 ? 64 : 2 * source->delayedCapacity;
+			source->delayed = WindowInvestigator_Reallocate(source->delayed, source->delayedCapacity, sizeof(*source->delayed));
+		}
+		WindowMonitorSimulator_DelayedNotification* const delayed = &source->delayed[source->delayedCount++];
+		delayed->notification = notification;
+		delayed->window = window;
+		delayed->timestamp = timestamp;
+		delayed->dueTick = source->tick + 1 + WindowMonitorSimulator_Random(&source->randomState) % 4;
+		++source->delayedTotal;
+		return;
+	}
+	WindowInvestigator_Monitor_Notify(source->monitor, notification, window, timestamp);
+}
+
+// Delivers the delayed notifications that are due, or all of them if flush is set.
+static void WindowMonitorSimulator_DeliverDelayedNotifications(WindowMonitorSimulator_NotificationSource* source, bool flush) {
+	size_t remaining = 0;
+	for (size_t index = 0; index < source->delayedCount; ++index) {
+		const WindowMonitorSimulator_DelayedNotification* const delayed = &source->delayed[index];
+		if (flush || delayed->dueTick <= source->tick)
+			WindowInvestigator_Monitor_Notify(source->monitor, delayed->notification, delayed->window, delayed->timestamp);
+		else
+			source->delayed[remaining++] = *delayed;
+	}
+	source->delayedCount = remaining;
+}
+
+static uint64_t WindowMonitorSimulator_CountWindowEvents(const WindowMonitorSimulator_SinkState* sinkState) {
+	return sinkState->newWindow + sinkState->windowChanged + sinkState->windowZOrderChanged + sinkState->windowGone;
+}
+
+static uint64_t WindowMonitorSimulator_ParseUInt64(const char* string) {
+	char* end;
+	const unsigned long long value = strtoull(string, &end, 0);
+	if (*string == '\0' || *end != '\0') WindowMonitorSimulator_Usage();
+	return value;
+}
+
+static double WindowMonitorSimulator_ParseDouble(const char* string) {
+	char* end;
+	const double value = strtod(string, &end);
+	if (*string == '\0' || *end != '\0' || value < 0) WindowMonitorSimulator_Usage();
+	return value;
+}
+
+int main(int argc, char** argv) {
+	WindowInvestigator_SimulatedDesktopOptions options;
+	WindowInvestigator_SimulatedDesktop_GetDefaultOptions(&options);
+	uint64_t tickCount = 1000;
+	uint64_t logInterval = 0;
+	size_t eventQueueCapacity = 0;
+	uint64_t eventQueueBenchmarkCount = 0;
+	const char* capturePath = NULL;
+	uint64_t messageInterval = 0;
+	uint64_t spatialIndexQueryCount = 0;
+	uint64_t windowTableBenchmarkPassCount = 0;
+	uint64_t zOrderDiffBenchmarkPassCount = 0;
+	uint64_t diffBenchmarkPassCount = 0;
+	uint64_t formatBenchmarkPassCount = 0;
+	WindowInvestigator_PeriodicTimerOptions timerOptions;
+	WindowInvestigator_PeriodicTimer_GetDefaultOptions(&timerOptions);
+	bool singleWindow = false;
+	bool checkAllocations = false;
+	const char* messageScriptPath = NULL;
+	WindowInvestigator_MonitorOptions monitorOptions;
+	WindowInvestigator_Monitor_GetDefaultOptions(&monitorOptions);
+	WindowInvestigator_WindowFilter filter;
+	WindowInvestigator_WindowFilter_Init(&filter);
+	WindowMonitorSimulator_NotificationSource notificationSource;
+	memset(&notificationSource, 0, sizeof(notificationSource));
+	notificationSource.randomState = options.seed ^ UINT64_C(0x5DEECE66D);
+
+	for (int argumentIndex = 1; argumentIndex < argc; argumentIndex += 2) {
+		if (argumentIndex + 1 >= argc) WindowMonitorSimulator_Usage();
+		const char* const name = argv[argumentIndex];
+		const char* const value = argv[argumentIndex + 1];
+		if (strcmp(name, "--windows") == 0) options.initialWindowCount = (size_t)WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--ticks") == 0) tickCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--seed") == 0) options.seed = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--visible-fraction") == 0) options.visibleFraction = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--create-rate") == 0) options.createRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--destroy-rate") == 0) options.destroyRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--replace-rate") == 0) options.replaceRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--move-rate") == 0) options.moveRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--style-flip-rate") == 0) options.styleFlipRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--text-rate") == 0) options.textChangeRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--zorder-rate") == 0) options.zOrderChangeRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--fullscreen-rate") == 0) options.fullscreenRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--log-interval") == 0) logInterval = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--sampling") == 0) {
+			if (strcmp(value, "exhaustive") == 0) WindowInvestigator_SamplingPolicy_InitExhaustive(&monitorOptions.samplingPolicy);
+			else if (strcmp(value, "tiered") == 0) WindowInvestigator_SamplingPolicy_InitTiered(&monitorOptions.samplingPolicy);
+			else WindowMonitorSimulator_Usage();
+		}
+		else if (strcmp(name, "--workers") == 0) monitorOptions.workerCount = (size_t)WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--windows-per-batch") == 0) monitorOptions.windowsPerBatch = (size_t)WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--window-latency-us") == 0) options.windowInfoLatencyNanoseconds = WindowMonitorSimulator_ParseUInt64(value) * 1000;
+		else if (strcmp(name, "--slow-window-fraction") == 0) options.slowWindowFraction = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--slow-window-latency-us") == 0) options.slowWindowInfoLatencyNanoseconds = WindowMonitorSimulator_ParseUInt64(value) * 1000;
+		else if (strcmp(name, "--event-queue-capacity") == 0) eventQueueCapacity = (size_t)WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--event-queue-benchmark") == 0) eventQueueBenchmarkCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--capture") == 0) capturePath = value;
+		else if (strcmp(name, "--message-interval") == 0) messageInterval = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--spatial-index-benchmark") == 0) spatialIndexQueryCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--window-table-benchmark") == 0) windowTableBenchmarkPassCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--zorder-diff-benchmark") == 0) zOrderDiffBenchmarkPassCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--diff-benchmark") == 0) diffBenchmarkPassCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--format-benchmark") == 0) formatBenchmarkPassCount = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--single-window-period-us") == 0) {
+			timerOptions.periodNanoseconds = WindowMonitorSimulator_ParseUInt64(value) * 1000;
+			singleWindow = true;
+		}
+		else if (strcmp(name, "--message-script") == 0) messageScriptPath = value;
+		else if (strcmp(name, "--spin-us") == 0) timerOptions.spinNanoseconds = WindowMonitorSimulator_ParseUInt64(value) * 1000;
+		else if (strcmp(name, "--filter-window") == 0) WindowMonitorSimulator_AddFilter(&filter, WindowInvestigator_WindowFilterKind_WINDOW, value);
+		else if (strcmp(name, "--filter-pid") == 0) WindowMonitorSimulator_AddFilter(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, value);
+		else if (strcmp(name, "--filter-image") == 0) WindowMonitorSimulator_AddFilter(&filter, WindowInvestigator_WindowFilterKind_IMAGE_NAME, value);
+		else if (strcmp(name, "--filter-class") == 0) WindowMonitorSimulator_AddFilter(&filter, WindowInvestigator_WindowFilterKind_CLASS_NAME, value);
+		else if (strcmp(name, "--check-allocations") == 0) checkAllocations = WindowMonitorSimulator_ParseUInt64(value) != 0;
+		else if (strcmp(name, "--incremental") == 0) monitorOptions.incremental = WindowMonitorSimulator_ParseUInt64(value) != 0;
+		else if (strcmp(name, "--enumeration-period") == 0) monitorOptions.dirtySetOptions.enumerationPeriod = WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--sweep-windows") == 0) monitorOptions.dirtySetOptions.sweepWindowsPerPass = (size_t)WindowMonitorSimulator_ParseUInt64(value);
+		else if (strcmp(name, "--notification-drop-rate") == 0) notificationSource.dropRate = WindowMonitorSimulator_ParseDouble(value);
+		else if (strcmp(name, "--notification-delay-rate") == 0) notificationSource.delayRate = WindowMonitorSimulator_ParseDouble(value);
+		else WindowMonitorSimulator_Usage();
+	}
+	if (tickCount == 0 || (singleWindow && timerOptions.periodNanoseconds == 0)) WindowMonitorSimulator_Usage();
+
+	WindowInvestigator_Monitor monitor;
+	if (monitorOptions.incremental) {
+		notificationSource.monitor = &monitor;
+		options.onNotification = WindowMonitorSimulator_OnNotification;
+		options.onNotificationContext = &notificationSource;
+	}
+	WindowInvestigator_SimulatedDesktop desktop;
+	WindowInvestigator_SimulatedDesktop_Init(&desktop, &options);
+
+	WindowInvestigator_MonitorBackend backend;
+	WindowInvestigator_SimulatedDesktop_GetBackend(&desktop, &backend);
+	WindowInvestigator_WindowFilter_Compile(&filter);
+	WindowMonitorSimulator_FilterContext filterContext;
+	filterContext.desktop = &desktop;
+	filterContext.filter = &filter;
+	if (!WindowInvestigator_WindowFilter_IsEmpty(&filter)) {
+		monitorOptions.filterWindow = WindowMonitorSimulator_FilterWindow;
+		monitorOptions.filterWindowContext = &filterContext;
+	}
+
+	if (messageScriptPath != NULL) {
+		const int result = WindowMonitorSimulator_ReplayMessageScript(messageScriptPath, &timerOptions);
+		WindowInvestigator_SimulatedDesktop_Destroy(&desktop);
+		return result;
+	}
+	if (singleWindow) {
+		WindowMonitorSimulator_MonitorSingleWindow(&backend, &timerOptions, tickCount);
+		WindowInvestigator_SimulatedDesktop_Destroy(&desktop);
+		return EXIT_SUCCESS;
+	}
+
+	WindowMonitorSimulator_SinkState sinkState;
+	memset(&sinkState, 0, sizeof(sinkState));
+	WindowInvestigator_CaptureWriter captureWriter;
+	if (capturePath != NULL) {
+		FILE* const captureFile = WindowMonitorSimulator_OpenFile(capturePath, "wb");
+		if (captureFile == NULL) {
+			fprintf(stderr, "Unable to create capture file \"%s\"\n", capturePath);
+			return EXIT_FAILURE;
+		}
+		WindowInvestigator_CaptureWriter_Init(&captureWriter, captureFile);
+		sinkState.captureWriter = &captureWriter;
+	}
+	WindowInvestigator_EventQueue eventQueue;
+	WindowInvestigator_EventQueue_Init(&eventQueue, eventQueueCapacity, &monitor.strings, WindowMonitorSimulator_OnEvent, &sinkState);
+	WindowInvestigator_MonitorSink eventQueueSink;
+	WindowInvestigator_EventQueue_GetSink(&eventQueue, &eventQueueSink);
+	// Same as WindowMonitor: the rude window of each monitor is evaluated after every tick.
+	WindowInvestigator_RudeWindowSink rudeWindowSink;
+	WindowInvestigator_EventQueue_GetRudeWindowSink(&eventQueue, &rudeWindowSink);
+	WindowInvestigator_RudeWindowEngine rudeWindowEngine;
+	WindowInvestigator_RudeWindowEngine_Init(&rudeWindowEngine, &monitor.windows, &rudeWindowSink);
+	WindowInvestigator_RudeWindowEngine_SetMonitors(&rudeWindowEngine, WindowInvestigator_SimulatedDesktop_GetMonitors(), WindowInvestigator_SimulatedDesktop_MONITOR_COUNT);
+	WindowInvestigator_MonitorSink rudeWindowEngineSink;
+	WindowInvestigator_RudeWindowEngine_GetMonitorSink(&rudeWindowEngine, &eventQueueSink, &rudeWindowEngineSink);
+	// The spatial indices are only maintained if they are going to be benchmarked, so that they don't affect tick durations
+	// otherwise.
+	WindowInvestigator_SpatialIndex windowRectIndex;
+	WindowInvestigator_SpatialIndex_Init(&windowRectIndex, &monitor.windows, WindowInvestigator_SpatialIndexRect_WINDOW_RECT, WindowInvestigator_SpatialIndex_DEFAULT_CELL_SIZE);
+	WindowInvestigator_SpatialIndex_SetMonitors(&windowRectIndex, WindowInvestigator_SimulatedDesktop_GetMonitors(), WindowInvestigator_SimulatedDesktop_MONITOR_COUNT);
+	WindowInvestigator_SpatialIndex clientRectIndex;
+	WindowInvestigator_SpatialIndex_Init(&clientRectIndex, &monitor.windows, WindowInvestigator_SpatialIndexRect_CLIENT_RECT_IN_SCREEN_COORDINATES, WindowInvestigator_SpatialIndex_DEFAULT_CELL_SIZE);
+	WindowInvestigator_SpatialIndex_SetMonitors(&clientRectIndex, WindowInvestigator_SimulatedDesktop_GetMonitors(), WindowInvestigator_SimulatedDesktop_MONITOR_COUNT);
+	WindowInvestigator_MonitorSink clientRectIndexSink;
+	WindowInvestigator_SpatialIndex_GetMonitorSink(&clientRectIndex, &rudeWindowEngineSink, &clientRectIndexSink);
+	WindowInvestigator_MonitorSink windowRectIndexSink;
+	WindowInvestigator_SpatialIndex_GetMonitorSink(&windowRectIndex, &clientRectIndexSink, &windowRectIndexSink);
+	WindowInvestigator_Monitor_Init(&monitor, &backend, spatialIndexQueryCount != 0 ? &windowRectIndexSink : &rudeWindowEngineSink, &monitorOptions);
+
+	// The first tick discovers every window, which is not representative of steady state, so it is not measured.
+	WindowInvestigator_Monitor_Tick(&monitor);
+	WindowInvestigator_RudeWindowEngine_Evaluate(&rudeWindowEngine);
+	// Only new windows are reported on the first tick.
+	WindowInvestigator_EventQueue_Flush(&eventQueue);
+	WindowInvestigator_Monitor_ResetPhaseDurations(&monitor);
+	WindowInvestigator_EventQueue_ResetEmissionDurations(&eventQueue);
+	sinkState.recordCount = sinkState.recordBytes = sinkState.newWindow = sinkState.zOrderUpdated = sinkState.rudeWindowChanged = 0;
+
+	if (eventQueueBenchmarkCount != 0) {
+		// Measures how fast events can go through the queue, by logging every window over and over again.
+		const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+		uint64_t queuedCount = 0;
+		while (queuedCount < eventQueueBenchmarkCount) {
+			WindowInvestigator_Monitor_LogWindows(&monitor);
+			queuedCount += WindowInvestigator_WindowTable_GetZOrderCount(&monitor.windows);
+		}
+		const uint64_t queueDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+		const uint64_t highWaterMark = WindowInvestigator_EventQueue_GetHighWaterMark(&eventQueue);
+		const uint64_t droppedCount = WindowInvestigator_EventQueue_GetDroppedCount(&eventQueue);
+		WindowInvestigator_EventQueue_Destroy(&eventQueue);
+		const uint64_t writeDuration = WindowInvestigator_GetTimeNanoseconds() - startTime;
+		printf("Event queue: capacity %zu, %" PRIu64 " records queued (%.0f records/s), %" PRIu64 " written (%.0f records/s), %" PRIu64 " dropped, high-water mark %" PRIu64 "\n",
+			eventQueueCapacity, queuedCount, (double)queuedCount * 1e9 / (double)queueDuration, sinkState.logWindow, (double)sinkState.logWindow * 1e9 / (double)writeDuration, droppedCount, highWaterMark);
+		if (capturePath != NULL) {
+			// Only the records written during the benchmark, i.e. excluding the first tick.
+			const uint64_t captureBytes = sinkState.recordBytes + sinkState.logWindow * WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE;
+			printf("Capture throughput: %.1f MB/s\n", (double)captureBytes * 1e3 / (double)writeDuration);
+			WindowMonitorSimulator_FinishCapture(&captureWriter, capturePath);
+		}
+		WindowInvestigator_SpatialIndex_Destroy(&clientRectIndex);
+		WindowInvestigator_SpatialIndex_Destroy(&windowRectIndex);
+		WindowInvestigator_RudeWindowEngine_Destroy(&rudeWindowEngine);
+		WindowInvestigator_Monitor_Destroy(&monitor);
+		WindowInvestigator_SimulatedDesktop_Destroy(&desktop);
+		return EXIT_SUCCESS;
+	}
+	memset(&desktop.callCounts, 0, sizeof(desktop.callCounts));
+
+	uint64_t* const tickDurations = malloc((size_t)tickCount * sizeof(*tickDurations));
+	WindowInvestigator_Histogram* const messageToDoneLatencies = malloc(sizeof(*messageToDoneLatencies));
+	WindowInvestigator_Histogram* const latencies = malloc(WindowMonitorSimulator_LATENCY_COUNT * sizeof(*latencies));
+	if (tickDurations == NULL || messageToDoneLatencies == NULL || latencies == NULL) abort();
+	WindowInvestigator_Histogram_Reset(messageToDoneLatencies);
+	const uint64_t initialAllocationCount = WindowInvestigator_GetAllocationCount();
+	const WindowInvestigator_MonitorStatistics initialStatistics = monitor.statistics;
+	const uint64_t initialStringBytesInterned = monitor.strings.bytesInterned;
+	const WindowInvestigator_RudeWindowStatistics initialRudeWindowStatistics = rudeWindowEngine.statistics;
+	const uint64_t initialSpatialIndexUpdates = windowRectIndex.statistics.updates + clientRectIndex.statistics.updates;
+	uint64_t totalTickDuration = 0;
+	uint64_t totalRudeWindowDuration = 0;
+	uint64_t maxRudeWindowDuration = 0;
+	// The first half of the run warms up the pools and tables; once they have grown to fit the workload, ticks should not
+	// allocate anymore.
+	uint64_t secondHalfInitialAllocationCount = 0;
+	for (uint64_t tick = 0; tick < tickCount; ++tick) {
+		if (tick == tickCount / 2) secondHalfInitialAllocationCount = WindowInvestigator_GetAllocationCount();
+		notificationSource.tick = tick;
+		WindowInvestigator_SimulatedDesktop_Step(&desktop);
+		WindowMonitorSimulator_DeliverDelayedNotifications(&notificationSource, false);
+
+		// Same as WindowMonitor: make sure the logged snapshots are fully up to date.
+		const bool logWindows = logInterval != 0 && (tick + 1) % logInterval == 0;
+		const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+		const bool message = messageInterval != 0 && tick % messageInterval == 0;
+		if (message) WindowMonitorSimulator_PushMessage(&eventQueue, &monitor, tick / messageInterval);
+		if (logWindows) WindowInvestigator_Monitor_SampleAllFieldsOnNextTick(&monitor);
+		WindowInvestigator_Monitor_Tick(&monitor);
+		const uint64_t rudeWindowStartTime = WindowInvestigator_GetTimeNanoseconds();
+		WindowInvestigator_RudeWindowEngine_Evaluate(&rudeWindowEngine);
+		const uint64_t rudeWindowDuration = WindowInvestigator_GetTimeNanoseconds() - rudeWindowStartTime;
+		totalRudeWindowDuration += rudeWindowDuration;
+		if (rudeWindowDuration > maxRudeWindowDuration) maxRudeWindowDuration = rudeWindowDuration;
+		if (logWindows) WindowInvestigator_Monitor_LogWindows(&monitor);
+		tickDurations[tick] = WindowInvestigator_GetTimeNanoseconds() - startTime;
+		totalTickDuration += tickDurations[tick];
+		if (message) WindowInvestigator_Histogram_Record(messageToDoneLatencies, tickDurations[tick]);
+	}
+	const uint64_t allocationCount = WindowInvestigator_GetAllocationCount() - initialAllocationCount;
+	const uint64_t secondHalfAllocationCount = WindowInvestigator_GetAllocationCount() - secondHalfInitialAllocationCount;
+	const uint64_t windowInfoBytesCopied = monitor.statistics.windowInfoBytesCopied - initialStatistics.windowInfoBytesCopied;
+	const uint64_t stringBytesInterned = monitor.strings.bytesInterned - initialStringBytesInterned;
+	const uint64_t fieldsSampled = monitor.statistics.fieldsSampled - initialStatistics.fieldsSampled;
+	const uint64_t getWindowInfoCalls = monitor.statistics.getWindowInfoCalls - initialStatistics.getWindowInfoCalls;
+	const uint64_t filterWindowCalls = monitor.statistics.filterWindowCalls - initialStatistics.filterWindowCalls;
+	const WindowInvestigator_DirtySetStatistics dirtySetStatistics = monitor.dirtySet.statistics;
+	// Makes sure every event has been counted.
+	WindowInvestigator_EventQueue_Flush(&eventQueue);
+	WindowMonitorSimulator_GetLatencies(&monitor, &eventQueue, messageToDoneLatencies, latencies);
+	// In incremental mode, check that the snapshots are up to date: once every notification that was not dropped has been
+	// delivered and taken care of by a regular tick, a tick that reads every field of every window should not find anything
+	// new. Its events are not included in the counts below.
+	// Changes whose notifications were dropped are only caught up with by the reconciliation policy, so in that case the
+	// desktop is left alone until it has had the time to: until the next periodic enumeration, which finds the windows that
+	// appeared, then enough ticks for the sweep to go through every window once.
+	uint64_t outOfDateCount = 0;
+	const bool reconciles = notificationSource.droppedCount != 0 && monitorOptions.dirtySetOptions.enumerationPeriod != 0 && monitorOptions.dirtySetOptions.sweepWindowsPerPass != 0;
+	uint64_t reconciliationTicks = 0;
+	if (monitorOptions.incremental) {
+		WindowMonitorSimulator_DeliverDelayedNotifications(&notificationSource, true);
+		WindowInvestigator_Monitor_Tick(&monitor);
+		if (reconciles) {
+			const uint64_t enumerations = monitor.dirtySet.statistics.enumerations;
+			while (monitor.dirtySet.statistics.enumerations == enumerations) {
+				WindowInvestigator_Monitor_Tick(&monitor);
+				++reconciliationTicks;
+			}
+			const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(&monitor.windows);
+			const size_t sweepWindowsPerPass = monitorOptions.dirtySetOptions.sweepWindowsPerPass;
+			for (size_t sweepTick = 0; sweepTick < (windowCount + sweepWindowsPerPass - 1) / sweepWindowsPerPass; ++sweepTick) {
+				WindowInvestigator_Monitor_Tick(&monitor);
+				++reconciliationTicks;
+			}
+		}
+		WindowInvestigator_EventQueue_Flush(&eventQueue);
+		const WindowMonitorSimulator_SinkState checkedSinkState = sinkState;
+		WindowInvestigator_Monitor_SampleAllFieldsOnNextTick(&monitor);
+		WindowInvestigator_Monitor_Tick(&monitor);
+		WindowInvestigator_EventQueue_Flush(&eventQueue);
+		outOfDateCount = WindowMonitorSimulator_CountWindowEvents(&sinkState) - WindowMonitorSimulator_CountWindowEvents(&checkedSinkState);
+		// Dropped events are still reported, whichever tick they come from.
+		const uint64_t eventsDropped = sinkState.eventsDropped;
+		const uint64_t reportedDroppedCount = sinkState.reportedDroppedCount;
+		sinkState = checkedSinkState;
+		sinkState.eventsDropped = eventsDropped;
+		sinkState.reportedDroppedCount = reportedDroppedCount;
+	}
+	WindowInvestigator_EventQueue_Destroy(&eventQueue);
+	// Every dropped event must have been reported by the writer thread, so that the capture shows where events are missing.
+	const bool droppedEventsReported = sinkState.reportedDroppedCount == WindowInvestigator_EventQueue_GetDroppedCount(&eventQueue);
+
+	qsort(tickDurations, (size_t)tickCount, sizeof(*tickDurations), WindowMonitorSimulator_CompareUInt64);
+	printf("Ticks: %" PRIu64 " Windows at end: %zu\n", tickCount, desktop.windowCount);
+	printf("Tick duration (ns): mean %" PRIu64 " p50 %" PRIu64 " p99 %" PRIu64 " max %" PRIu64 "\n",
+		totalTickDuration / tickCount, tickDurations[tickCount / 2], tickDurations[tickCount * 99 / 100], tickDurations[tickCount - 1]);
+	WindowMonitorSimulator_PrintLatencies(latencies);
+	printf("Allocations per tick: %.3f (second half of the run: %.3f, %" PRIu64 " allocations)\n", (double)allocationCount / (double)tickCount, (double)secondHalfAllocationCount / (double)(tickCount - tickCount / 2), secondHalfAllocationCount);
+	// Only meaningful for workloads that reach a steady state, i.e. whose window and string counts stop reaching new highs,
+	// such as replacing windows with all of them visible.
+	const bool allocationsFailed = checkAllocations && secondHalfAllocationCount != 0;
+	if (allocationsFailed) printf("Allocations: the second half of the run allocated, expected none\n");
+	printf("Window info size: %zu bytes\n", sizeof(WindowInvestigator_WindowInfo));
+	printf("Bytes copied per tick: backend %.1f window info %.1f strings interned %.1f\n",
+		(double)(getWindowInfoCalls * sizeof(WindowInvestigator_WindowInfo)) / (double)tickCount, (double)windowInfoBytesCopied / (double)tickCount, (double)stringBytesInterned / (double)tickCount);
+	printf("Backend calls per tick: getNextWindow %.1f isWindowVisible %.1f getWindowInfo %.1f\n",
+		(double)desktop.callCounts.getNextWindow / (double)tickCount, (double)desktop.callCounts.isWindowVisible / (double)tickCount, (double)getWindowInfoCalls / (double)tickCount);
+	printf("Field samples per tick: %.1f (per field:", (double)fieldsSampled / (double)tickCount);
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field)
+		printf(" %d:%.1f", field, (double)(monitor.statistics.fieldSamples[field] - initialStatistics.fieldSamples[field]) / (double)tickCount);
+	printf(")\n");
+	printf("Field cost (mean ns per sample):");
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field) {
+		const WindowInvestigator_FieldCost* const cost = &monitor.sampling.costs[field];
+		if (cost->sampleCount != 0) printf(" %d:%" PRIu64, field, cost->nanoseconds / cost->sampleCount);
+	}
+	printf("\n");
+	if (monitorOptions.filterWindow != NULL)
+		printf("Filter: %zu windows monitored, %zu filtered out, %.2f filter calls per tick\n", WindowInvestigator_WindowTable_GetZOrderCount(&monitor.windows),
+			WindowInvestigator_WindowTable_GetZOrderCount(&monitor.filteredOutWindows), (double)filterWindowCalls / (double)tickCount);
+	uint64_t incrementalMismatchCount = 0;
+	if (monitorOptions.incremental) {
+		printf("Incremental: %.1f%% of ticks enumerated, %" PRIu64 " notifications (%" PRIu64 " dropped, %" PRIu64 " delayed), %" PRIu64 " duplicates, %" PRIu64 " stale, %.2f windows swept and %.2f discarded per tick\n",
+			(double)dirtySetStatistics.enumerations * 100 / (double)dirtySetStatistics.passes, notificationSource.notificationCount, notificationSource.droppedCount, notificationSource.delayedTotal,
+			dirtySetStatistics.duplicateNotifications, dirtySetStatistics.staleNotifications,
+			(double)dirtySetStatistics.sweptWindows / (double)dirtySetStatistics.passes, (double)dirtySetStatistics.discardedWindows / (double)dirtySetStatistics.passes);
+		// Without dropped notifications, nothing can be missed, however late or out of order the notifications are. With them,
+		// the reconciliation policy must have caught up by the end of the quiet ticks, unless it was disabled.
+		if (notificationSource.droppedCount == 0 || reconciles) incrementalMismatchCount = outOfDateCount;
+		printf("Incremental: %" PRIu64 " changes found by a final full tick after %" PRIu64 " quiet ticks, %" PRIu64 " mismatches\n", outOfDateCount, reconciliationTicks, incrementalMismatchCount);
+	}
+	if (monitorOptions.workerCount != 0)
+		printf("Workers: %zu (%zu windows per batch, %" PRIu64 " batches stolen)\n", monitorOptions.workerCount, monitorOptions.windowsPerBatch, WindowInvestigator_WorkerPool_GetBatchesStolen(&monitor.workerPool));
+	const uint64_t rudeWindowWalks = rudeWindowEngine.statistics.zOrderWalks - initialRudeWindowStatistics.zOrderWalks;
+	printf("Rude window: evaluation (ns) mean %" PRIu64 " max %" PRIu64 ", %" PRIu64 " Z-order walks (%.1f windows walked per walk), %.2f inputs computed per tick, %" PRIu64 " changes\n",
+		totalRudeWindowDuration / tickCount, maxRudeWindowDuration, rudeWindowWalks,
+		rudeWindowWalks == 0 ? 0.0 : (double)(rudeWindowEngine.statistics.windowsWalked - initialRudeWindowStatistics.windowsWalked) / (double)rudeWindowWalks,
+		(double)(rudeWindowEngine.statistics.inputsComputed - initialRudeWindowStatistics.inputsComputed) / (double)tickCount,
+		rudeWindowEngine.statistics.rudeWindowChanges - initialRudeWindowStatistics.rudeWindowChanges);
+	printf("Events: NewWindow %" PRIu64 " WindowChanged %" PRIu64 " WindowZOrderChanged %" PRIu64 " WindowGone %" PRIu64 " ZOrderUpdated %" PRIu64 " Keyframe %" PRIu64 " LogWindow %" PRIu64 " ReceivedMessage %" PRIu64 " RudeWindowChanged %" PRIu64 " EventsDropped %" PRIu64 " TickFinished %" PRIu64 "\n",
+		sinkState.newWindow, sinkState.windowChanged, sinkState.windowZOrderChanged, sinkState.windowGone, sinkState.zOrderUpdated, sinkState.keyframe, sinkState.logWindow, sinkState.receivedMessage, sinkState.rudeWindowChanged, sinkState.eventsDropped, sinkState.tickFinished);
+	printf("Records: %" PRIu64 " (%.1f bytes per tick, %.1f bytes per record)\n",
+		sinkState.recordCount, (double)sinkState.recordBytes / (double)tickCount, sinkState.recordCount == 0 ? 0.0 : (double)sinkState.recordBytes / (double)sinkState.recordCount);
+	if (eventQueueCapacity != 0)
+		printf("Event queue: capacity %zu, high-water mark %" PRIu64 ", %" PRIu64 " dropped (%" PRIu64 " reported%s)\n", eventQueueCapacity, WindowInvestigator_EventQueue_GetHighWaterMark(&eventQueue),
+			WindowInvestigator_EventQueue_GetDroppedCount(&eventQueue), sinkState.reportedDroppedCount, droppedEventsReported ? "" : ", MISMATCH");
+	printf("Changed fields:");
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field)
+		if (sinkState.changedFields[field] != 0) printf(" %d:%" PRIu64, field, sinkState.changedFields[field]);
+	printf("\n");
+	if (capturePath != NULL) WindowMonitorSimulator_FinishCapture(&captureWriter, capturePath);
+	uint64_t spatialIndexMismatchCount = 0;
+	if (spatialIndexQueryCount != 0) {
+		printf("Spatial index updates per tick: %.2f\n", (double)(windowRectIndex.statistics.updates + clientRectIndex.statistics.updates - initialSpatialIndexUpdates) / (double)tickCount);
+		spatialIndexMismatchCount += WindowMonitorSimulator_BenchmarkSpatialIndex(&windowRectIndex, "window rect", spatialIndexQueryCount, options.seed);
+		spatialIndexMismatchCount += WindowMonitorSimulator_BenchmarkSpatialIndex(&clientRectIndex, "client rect", spatialIndexQueryCount, options.seed);
+	}
+	const uint64_t windowTableMismatchCount = windowTableBenchmarkPassCount != 0 ? WindowMonitorSimulator_BenchmarkWindowTable(windowTableBenchmarkPassCount, options.seed) : 0;
+	const uint64_t zOrderDiffMismatchCount = zOrderDiffBenchmarkPassCount != 0 ? WindowMonitorSimulator_BenchmarkZOrderDiff(zOrderDiffBenchmarkPassCount, options.seed) : 0;
+	const uint64_t diffMismatchCount = diffBenchmarkPassCount != 0 ? WindowMonitorSimulator_BenchmarkWindowInfoDiff(&monitor.windows, diffBenchmarkPassCount, options.seed) : 0;
+	const uint64_t formatMismatchCount = formatBenchmarkPassCount != 0 ? WindowMonitorSimulator_BenchmarkStructuredOutput(&monitor.windows, &monitor.strings, formatBenchmarkPassCount) : 0;
+
+	free(latencies);
+	free(messageToDoneLatencies);
+	free(tickDurations);
+	WindowInvestigator_SpatialIndex_Destroy(&clientRectIndex);
+	WindowInvestigator_SpatialIndex_Destroy(&windowRectIndex);
+	WindowInvestigator_RudeWindowEngine_Destroy(&rudeWindowEngine);
+	WindowInvestigator_Monitor_Destroy(&monitor);
+	WindowInvestigator_SimulatedDesktop_Destroy(&desktop);
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+	WindowInvestigator_Free(notificationSource.delayed);
+	return spatialIndexMismatchCount == 0 && windowTableMismatchCount == 0 && zOrderDiffMismatchCount == 0 && diffMismatchCount == 0 && formatMismatchCount == 0 && incrementalMismatchCount == 0 && droppedEventsReported && !allocationsFailed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
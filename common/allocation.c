@@ -0,0 +1,24 @@
+#include "allocation.h"
+
+#include "atomic.h"
+
+#include <stdlib.h>
+
+// Allocations can happen on worker threads.
+static volatile uint64_t WindowInvestigator_allocationCount;
+
+void* WindowInvestigator_Reallocate(void* pointer, size_t count, size_t size) {
+	if (size != 0 && count > SIZE_MAX / size) abort();
+	void* const newPointer = realloc(pointer, count * size);
+	if (newPointer == NULL) abort();
+	WindowInvestigator_Atomic_Increment(&WindowInvestigator_allocationCount);
+	return newPointer;
+}
+
+void WindowInvestigator_Free(void* pointer) {
+	free(pointer);
+}
+
+uint64_t WindowInvestigator_GetAllocationCount(void) {
+	return WindowInvestigator_Atomic_LoadAcquire(&WindowInvestigator_allocationCount);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heap allocation helpers for the platform-independent code.
+//
+// Allocation failures are not recoverable in WindowInvestigator, so these abort instead of returning NULL. They also count
+// allocations so that tools can report how much heap traffic the monitoring code generates.
+
+// Equivalent to realloc(pointer, count * size), but aborts on overflow or allocation failure.
+void* WindowInvestigator_Reallocate(void* pointer, size_t count, size_t size);
+void WindowInvestigator_Free(void* pointer);
+
+// Number of calls to WindowInvestigator_Reallocate() so far.
+uint64_t WindowInvestigator_GetAllocationCount(void);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+// Minimal portable atomic operations on 64-bit values, for the few places where threads share data without locks.
+
+static inline uint64_t WindowInvestigator_Atomic_LoadAcquire(const volatile uint64_t* value) {
+#ifdef _WIN32
+	return (uint64_t)ReadAcquire64((const volatile LONG64*)value);
+#else
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void WindowInvestigator_Atomic_StoreRelease(volatile uint64_t* value, uint64_t newValue) {
+#ifdef _WIN32
+	WriteRelease64((volatile LONG64*)value, (LONG64)newValue);
+#else
+	__atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline void WindowInvestigator_Atomic_Increment(volatile uint64_t* value) {
+#ifdef _WIN32
+	InterlockedIncrement64((volatile LONG64*)value);
+#else
+	__atomic_add_fetch(value, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void WindowInvestigator_Atomic_Add(volatile uint64_t* value, uint64_t addend) {
+#ifdef _WIN32
+	InterlockedExchangeAdd64((volatile LONG64*)value, (LONG64)addend);
+#else
+	__atomic_add_fetch(value, addend, __ATOMIC_RELAXED);
+#endif
+}
+
+// Atomically replaces value with candidate if candidate is smaller (or larger, for StoreMax).
+static inline void WindowInvestigator_Atomic_StoreMin(volatile uint64_t* value, uint64_t candidate) {
+	uint64_t current = WindowInvestigator_Atomic_LoadAcquire(value);
+	while (candidate < current) {
+#ifdef _WIN32
+		const uint64_t previous = (uint64_t)InterlockedCompareExchange64((volatile LONG64*)value, (LONG64)candidate, (LONG64)current);
+		if (previous == current) return;
+		current = previous;
+#else
+		if (__atomic_compare_exchange_n(value, &current, candidate, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return;
+#endif
+	}
+}
+
+static inline void WindowInvestigator_Atomic_StoreMax(volatile uint64_t* value, uint64_t candidate) {
+	uint64_t current = WindowInvestigator_Atomic_LoadAcquire(value);
+	while (candidate > current) {
+#ifdef _WIN32
+		const uint64_t previous = (uint64_t)InterlockedCompareExchange64((volatile LONG64*)value, (LONG64)candidate, (LONG64)current);
+		if (previous == current) return;
+		current = previous;
+#else
+		if (__atomic_compare_exchange_n(value, &current, candidate, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return;
+#endif
+	}
+}
@@ -0,0 +1,175 @@
+#include "capture_file.h"
+
+#include "allocation.h"
+#include "clock.h"
+
+#include <string.h>
+#include <time.h>
+
+static unsigned char* WindowInvestigator_CaptureFile_WriteUInt32(unsigned char* position, uint32_t value) {
+	for (int byteIndex = 0; byteIndex < 4; ++byteIndex) *position++ = (unsigned char)(value >> (8 * byteIndex));
+	return position;
+}
+
+static unsigned char* WindowInvestigator_CaptureFile_WriteUInt64(unsigned char* position, uint64_t value) {
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, (uint32_t)value);
+	return WindowInvestigator_CaptureFile_WriteUInt32(position, (uint32_t)(value >> 32));
+}
+
+static uint32_t WindowInvestigator_CaptureFile_ReadUInt32(const unsigned char* position) {
+	return (uint32_t)position[0] | ((uint32_t)position[1] << 8) | ((uint32_t)position[2] << 16) | ((uint32_t)position[3] << 24);
+}
+
+static uint64_t WindowInvestigator_CaptureFile_ReadUInt64(const unsigned char* position) {
+	return WindowInvestigator_CaptureFile_ReadUInt32(position) | ((uint64_t)WindowInvestigator_CaptureFile_ReadUInt32(position + 4) << 32);
+}
+
+static uint64_t WindowInvestigator_CaptureFile_GetUnixTimeNanoseconds(void) {
+	struct timespec now;
+	if (timespec_get(&now, TIME_UTC) != TIME_UTC) return 0;
+	return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+void WindowInvestigator_CaptureWriter_Init(WindowInvestigator_CaptureWriter* writer, FILE* file) {
+	WindowInvestigator_CaptureWriter_InitWithStartTime(writer, file, WindowInvestigator_GetTimeNanoseconds(), WindowInvestigator_CaptureFile_GetUnixTimeNanoseconds());
+}
+
+void WindowInvestigator_CaptureWriter_InitWithStartTime(WindowInvestigator_CaptureWriter* writer, FILE* file, uint64_t startTimestamp, uint64_t startUnixTimeNanoseconds) {
+	writer->file = file;
+	writer->buffer = WindowInvestigator_Reallocate(NULL, WindowInvestigator_CaptureWriter_BUFFER_SIZE, 1);
+	writer->lastFlushTimestamp = startTimestamp;
+	writer->bytesWritten = 0;
+	writer->recordsWritten = 0;
+	writer->failed = false;
+
+	// We do our own buffering.
+	setvbuf(file, NULL, _IONBF, 0);
+
+	unsigned char* position = writer->buffer;
+	memcpy(position, WindowInvestigator_CaptureFile_MAGIC, 8);
+	position += 8;
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, WindowInvestigator_CaptureFile_VERSION);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, WindowInvestigator_CaptureFile_HEADER_SIZE);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, WindowInvestigator_WindowField_COUNT);
+	position = WindowInvestigator_CaptureFile_WriteUInt64(position, startTimestamp);
+	position = WindowInvestigator_CaptureFile_WriteUInt64(position, startUnixTimeNanoseconds);
+	writer->bufferSize = (size_t)(position - writer->buffer);
+}
+
+void WindowInvestigator_CaptureWriter_Destroy(WindowInvestigator_CaptureWriter* writer) {
+	WindowInvestigator_Free(writer->buffer);
+}
+
+static bool WindowInvestigator_CaptureWriter_WriteBuffer(WindowInvestigator_CaptureWriter* writer) {
+	if (writer->failed) return false;
+	if (writer->bufferSize != 0 && fwrite(writer->buffer, 1, writer->bufferSize, writer->file) != writer->bufferSize) {
+		writer->failed = true;
+		return false;
+	}
+	writer->bytesWritten += writer->bufferSize;
+	writer->bufferSize = 0;
+	return true;
+}
+
+bool WindowInvestigator_CaptureWriter_WriteEvent(WindowInvestigator_CaptureWriter* writer, const WindowInvestigator_MonitorEvent* event) {
+	if (writer->failed) return false;
+
+	const size_t recordSize = WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE + event->recordSize;
+	if (WindowInvestigator_CaptureWriter_BUFFER_SIZE - writer->bufferSize < recordSize && !WindowInvestigator_CaptureWriter_WriteBuffer(writer)) return false;
+
+	unsigned char* position = writer->buffer + writer->bufferSize;
+	position = WindowInvestigator_CaptureFile_WriteUInt64(position, event->timestamp);
+	position = WindowInvestigator_CaptureFile_WriteUInt64(position, event->window);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, (uint32_t)event->type);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, event->zOrder);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, event->previousZOrder);
+	position = WindowInvestigator_CaptureFile_WriteUInt32(position, event->recordSize);
+	memcpy(position, event->record, event->recordSize);
+	writer->bufferSize += recordSize;
+	++writer->recordsWritten;
+
+	if (event->timestamp - writer->lastFlushTimestamp >= WindowInvestigator_CaptureWriter_FLUSH_INTERVAL_NANOSECONDS) {
+		writer->lastFlushTimestamp = event->timestamp;
+		return WindowInvestigator_CaptureWriter_Flush(writer);
+	}
+	return true;
+}
+
+bool WindowInvestigator_CaptureWriter_Flush(WindowInvestigator_CaptureWriter* writer) {
+	if (!WindowInvestigator_CaptureWriter_WriteBuffer(writer)) return false;
+	if (fflush(writer->file) != 0) {
+		writer->failed = true;
+		return false;
+	}
+	return true;
+}
+
+// Returns false if fewer than size bytes could be read; *readSize is set to the number of bytes actually read.
+static bool WindowInvestigator_CaptureReader_Read(WindowInvestigator_CaptureReader* reader, unsigned char* buffer, size_t size, size_t* readSize) {
+	*readSize = fread(buffer, 1, size, reader->file);
+	return *readSize == size;
+}
+
+// Skips bytes we don't know about.
+static bool WindowInvestigator_CaptureReader_Skip(WindowInvestigator_CaptureReader* reader, size_t size) {
+	for (; size > 0; --size)
+		if (fgetc(reader->file) == EOF) return false;
+	return true;
+}
+
+bool WindowInvestigator_CaptureReader_Init(WindowInvestigator_CaptureReader* reader, FILE* file) {
+	reader->file = file;
+	reader->offset = 0;
+	reader->payload = WindowInvestigator_Reallocate(NULL, WindowInvestigator_WindowRecord_MAX_SIZE, 1);
+	memset(&reader->header, 0, sizeof(reader->header));
+
+	unsigned char header[WindowInvestigator_CaptureFile_HEADER_SIZE];
+	size_t readSize;
+	if (!WindowInvestigator_CaptureReader_Read(reader, header, sizeof(header), &readSize)) return false;
+	if (memcmp(header, WindowInvestigator_CaptureFile_MAGIC, 8) != 0) return false;
+	reader->header.version = WindowInvestigator_CaptureFile_ReadUInt32(header + 8);
+	reader->header.headerSize = WindowInvestigator_CaptureFile_ReadUInt32(header + 12);
+	reader->header.recordHeaderSize = WindowInvestigator_CaptureFile_ReadUInt32(header + 16);
+	reader->header.windowFieldCount = WindowInvestigator_CaptureFile_ReadUInt32(header + 20);
+	reader->header.startTimestamp = WindowInvestigator_CaptureFile_ReadUInt64(header + 24);
+	reader->header.startUnixTimeNanoseconds = WindowInvestigator_CaptureFile_ReadUInt64(header + 32);
+	if (reader->header.version == 0 || reader->header.version > WindowInvestigator_CaptureFile_VERSION) return false;
+	if (reader->header.headerSize < WindowInvestigator_CaptureFile_HEADER_SIZE || reader->header.recordHeaderSize < WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE) return false;
+	reader->offset = reader->header.headerSize;
+	return WindowInvestigator_CaptureReader_Skip(reader, reader->header.headerSize - WindowInvestigator_CaptureFile_HEADER_SIZE);
+}
+
+void WindowInvestigator_CaptureReader_Destroy(WindowInvestigator_CaptureReader* reader) {
+	WindowInvestigator_Free(reader->payload);
+}
+
+WindowInvestigator_CaptureReader_Result WindowInvestigator_CaptureReader_ReadRecord(WindowInvestigator_CaptureReader* reader, WindowInvestigator_CaptureRecordHeader* header, const unsigned char** payload) {
+	unsigned char headerBytes[WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE];
+	size_t readSize;
+	if (!WindowInvestigator_CaptureReader_Read(reader, headerBytes, sizeof(headerBytes), &readSize))
+		return ferror(reader->file) ? WindowInvestigator_CaptureReader_ERROR : readSize == 0 ? WindowInvestigator_CaptureReader_END : WindowInvestigator_CaptureReader_TRUNCATED;
+	header->timestamp = WindowInvestigator_CaptureFile_ReadUInt64(headerBytes);
+	header->window = WindowInvestigator_CaptureFile_ReadUInt64(headerBytes + 8);
+	header->type = WindowInvestigator_CaptureFile_ReadUInt32(headerBytes + 16);
+	header->zOrder = WindowInvestigator_CaptureFile_ReadUInt32(headerBytes + 20);
+	header->previousZOrder = WindowInvestigator_CaptureFile_ReadUInt32(headerBytes + 24);
+	header->payloadSize = WindowInvestigator_CaptureFile_ReadUInt32(headerBytes + 28);
+	if (header->payloadSize > WindowInvestigator_WindowRecord_MAX_SIZE) return WindowInvestigator_CaptureReader_ERROR;
+	if (!WindowInvestigator_CaptureReader_Skip(reader, reader->header.recordHeaderSize - WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE) ||
+		!WindowInvestigator_CaptureReader_Read(reader, reader->payload, header->payloadSize, &readSize))
+		return ferror(reader->file) ? WindowInvestigator_CaptureReader_ERROR : WindowInvestigator_CaptureReader_TRUNCATED;
+	reader->offset += reader->header.recordHeaderSize + header->payloadSize;
+	*payload = reader->payload;
+	return WindowInvestigator_CaptureReader_RECORD;
+}
+
+bool WindowInvestigator_CaptureReader_Seek(WindowInvestigator_CaptureReader* reader, uint64_t offset) {
+#ifdef _WIN32
+	if (_fseeki64(reader->file, (__int64)offset, SEEK_SET) != 0) return false;
+#else
+	if (fseeko(reader->file, (off_t)offset, SEEK_SET) != 0) return false;
+#endif
+	reader->offset = offset;
+	return true;
+}
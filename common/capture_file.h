@@ -0,0 +1,120 @@
+#pragma once
+
+#include "event_queue.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Append-only binary capture of WindowMonitor events, meant for long runs and for analysis on any platform.
+//
+// All integers are little-endian. The file starts with a header:
+//  - Magic: the 8 ASCII characters "WICAPTUR".
+//  - Version (uint32): WindowInvestigator_CaptureFile_VERSION.
+//  - Size of the file header (uint32), including the magic. Readers skip whatever they don't know about.
+//  - Size of each record header (uint32). Readers skip whatever they don't know about.
+//  - Number of window fields (uint32) the writer knew about, i.e. WindowInvestigator_WindowField_COUNT.
+//  - Monotonic timestamp (uint64, nanoseconds) and wall clock time (uint64, nanoseconds since the UNIX epoch) at the start of
+//    the capture, so that record timestamps can be converted to wall clock time.
+//
+// The header is followed by records, one per event. Each record has a fixed-size header:
+//  - Timestamp (uint64): when the event was detected, in nanoseconds, using the same clock as the file header.
+//  - Window handle (uint64).
+//  - Event type (uint32): WindowInvestigator_MonitorEventType.
+//  - Z-order (uint32) and previous Z-order (uint32), for the event types that have them, 0 otherwise. Some event types use
+//    these for other purposes; see WindowInvestigator_MonitorEvent.
+//  - Payload size (uint32).
+// followed by the payload, which is a window record as described in window_record.h (or nothing, for event types that don't
+// carry window properties; or the record described in event_queue.h, for RECEIVED_MESSAGE, RUDE_WINDOW_CHANGED and
+// EVENTS_DROPPED).
+//
+// If the writer could not keep up and events were dropped, an EVENTS_DROPPED record is written where they went missing.
+//
+// Version 1 captures have no TICK_FINISHED records, so where their ticks end can only be inferred (see replay.h). Readers
+// accept every version up to WindowInvestigator_CaptureFile_VERSION.
+//
+// If the writer did not exit cleanly, the file can end in the middle of a record. Everything before that is still valid.
+
+#define WindowInvestigator_CaptureFile_MAGIC "WICAPTUR"
+#define WindowInvestigator_CaptureFile_VERSION 2
+// First version in which every tick that reported anything ends with a TICK_FINISHED record.
+#define WindowInvestigator_CaptureFile_TICK_FINISHED_VERSION 2
+#define WindowInvestigator_CaptureFile_HEADER_SIZE (8 + 4 * 4 + 2 * 8)
+#define WindowInvestigator_CaptureFile_RECORD_HEADER_SIZE (2 * 8 + 4 * 4)
+
+typedef struct {
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t recordHeaderSize;
+	uint32_t windowFieldCount;
+	uint64_t startTimestamp;
+	uint64_t startUnixTimeNanoseconds;
+} WindowInvestigator_CaptureFileHeader;
+
+typedef struct {
+	uint64_t timestamp;
+	uint64_t window;
+	uint32_t type;
+	uint32_t zOrder;
+	uint32_t previousZOrder;
+	uint32_t payloadSize;
+} WindowInvestigator_CaptureRecordHeader;
+
+// Records are accumulated in a large buffer, which is written out when it is full, and on the first event that comes more
+// than WindowInvestigator_CaptureWriter_FLUSH_INTERVAL_NANOSECONDS after the previous write. This keeps the number of
+// write calls low while bounding how much is lost if the process is killed.
+#define WindowInvestigator_CaptureWriter_BUFFER_SIZE (1024 * 1024)
+#define WindowInvestigator_CaptureWriter_FLUSH_INTERVAL_NANOSECONDS UINT64_C(1000000000)
+
+typedef struct {
+	FILE* file;
+	unsigned char* buffer;
+	size_t bufferSize;
+	uint64_t lastFlushTimestamp;
+	uint64_t bytesWritten;
+	uint64_t recordsWritten;
+	// Set on the first I/O error. Nothing is written after that.
+	bool failed;
+} WindowInvestigator_CaptureWriter;
+
+// file must be open for writing in binary mode, and stays owned by the caller. The file header is written immediately (but
+// buffered).
+void WindowInvestigator_CaptureWriter_Init(WindowInvestigator_CaptureWriter* writer, FILE* file);
+// Same, but with the specified start time in the file header instead of the current time, e.g. to rewrite the events of
+// another capture.
+void WindowInvestigator_CaptureWriter_InitWithStartTime(WindowInvestigator_CaptureWriter* writer, FILE* file, uint64_t startTimestamp, uint64_t startUnixTimeNanoseconds);
+// Does not flush.
+void WindowInvestigator_CaptureWriter_Destroy(WindowInvestigator_CaptureWriter* writer);
+
+// These return false if an I/O error occurred, now or previously.
+bool WindowInvestigator_CaptureWriter_WriteEvent(WindowInvestigator_CaptureWriter* writer, const WindowInvestigator_MonitorEvent* event);
+bool WindowInvestigator_CaptureWriter_Flush(WindowInvestigator_CaptureWriter* writer);
+
+typedef enum {
+	WindowInvestigator_CaptureReader_RECORD,
+	WindowInvestigator_CaptureReader_END,
+	// The file ends in the middle of a record.
+	WindowInvestigator_CaptureReader_TRUNCATED,
+	// I/O error, or malformed record.
+	WindowInvestigator_CaptureReader_ERROR,
+} WindowInvestigator_CaptureReader_Result;
+
+typedef struct {
+	FILE* file;
+	WindowInvestigator_CaptureFileHeader header;
+	// Offset of the next record in the file.
+	uint64_t offset;
+	unsigned char* payload;
+} WindowInvestigator_CaptureReader;
+
+// file must be open for reading in binary mode, and stays owned by the caller. Returns false if the file is not a capture
+// file, or uses an unsupported version. WindowInvestigator_CaptureReader_Destroy() must be called in both cases.
+bool WindowInvestigator_CaptureReader_Init(WindowInvestigator_CaptureReader* reader, FILE* file);
+void WindowInvestigator_CaptureReader_Destroy(WindowInvestigator_CaptureReader* reader);
+
+// On success, *payload points to header->payloadSize bytes that stay valid until the next call.
+WindowInvestigator_CaptureReader_Result WindowInvestigator_CaptureReader_ReadRecord(WindowInvestigator_CaptureReader* reader, WindowInvestigator_CaptureRecordHeader* header, const unsigned char** payload);
+// Moves to the record at the specified offset, which must have been obtained from WindowInvestigator_CaptureReader::offset.
+// Returns false on I/O error.
+bool WindowInvestigator_CaptureReader_Seek(WindowInvestigator_CaptureReader* reader, uint64_t offset);
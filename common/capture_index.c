@@ -0,0 +1,439 @@
+#include "capture_index.h"
+
+#include "allocation.h"
+#include "event_queue.h"
+#include "window_record.h"
+
+#include <string.h>
+
+static unsigned char* WindowInvestigator_CaptureIndex_WriteUInt32(unsigned char* position, uint32_t value) {
+	for (int byteIndex = 0; byteIndex < 4; ++byteIndex) *position++ = (unsigned char)(value >> (8 * byteIndex));
+	return position;
+}
+
+static unsigned char* WindowInvestigator_CaptureIndex_WriteUInt64(unsigned char* position, uint64_t value) {
+	position = WindowInvestigator_CaptureIndex_WriteUInt32(position, (uint32_t)value);
+	return WindowInvestigator_CaptureIndex_WriteUInt32(position, (uint32_t)(value >> 32));
+}
+
+static uint32_t WindowInvestigator_CaptureIndex_ReadUInt32(const unsigned char* position) {
+	return (uint32_t)position[0] | ((uint32_t)position[1] << 8) | ((uint32_t)position[2] << 16) | ((uint32_t)position[3] << 24);
+}
+
+static uint64_t WindowInvestigator_CaptureIndex_ReadUInt64(const unsigned char* position) {
+	return WindowInvestigator_CaptureIndex_ReadUInt32(position) | ((uint64_t)WindowInvestigator_CaptureIndex_ReadUInt32(position + 4) << 32);
+}
+
+void WindowInvestigator_CaptureIndex_Init(WindowInvestigator_CaptureIndex* index) {
+	memset(index, 0, sizeof(*index));
+}
+
+void WindowInvestigator_CaptureIndex_Destroy(WindowInvestigator_CaptureIndex* index) {
+	WindowInvestigator_Free(index->entries);
+}
+
+static void WindowInvestigator_CaptureIndex_Add(WindowInvestigator_CaptureIndex* index, const WindowInvestigator_CaptureIndexEntry* entry) {
+	if (index->entryCount == index->entryCapacity) {
+		index->entryCapacity = index->entryCapacity == 0 ? 256 : index->entryCapacity * 2;
+		index->entries = WindowInvestigator_Reallocate(index->entries, index->entryCapacity, sizeof(*index->entries));
+	}
+	index->entries[index->entryCount++] = *entry;
+}
+
+bool WindowInvestigator_CaptureIndex_Build(WindowInvestigator_CaptureIndex* index, WindowInvestigator_CaptureReader* reader) {
+	index->startTimestamp = reader->header.startTimestamp;
+	index->startUnixTimeNanoseconds = reader->header.startUnixTimeNanoseconds;
+	index->entryCount = 0;
+
+	// The keyframe being scanned, and how many of its snapshots we have seen so far.
+	WindowInvestigator_CaptureIndexEntry keyframe = { 0 };
+	bool inKeyframe = false;
+	uint32_t snapshotCount = 0;
+	for (;;) {
+		const uint64_t offset = reader->offset;
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		const WindowInvestigator_CaptureReader_Result result = WindowInvestigator_CaptureReader_ReadRecord(reader, &header, &payload);
+		if (result == WindowInvestigator_CaptureReader_ERROR) return false;
+		if (result != WindowInvestigator_CaptureReader_RECORD) {
+			index->captureSize = offset;
+			return true;
+		}
+
+		if (header.type == WindowInvestigator_MonitorEvent_KEYFRAME) {
+			keyframe.timestamp = header.timestamp;
+			keyframe.offset = offset;
+			keyframe.windowCount = header.zOrder;
+			inKeyframe = true;
+			snapshotCount = 0;
+		}
+		else if (inKeyframe && header.type == WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT && header.zOrder == snapshotCount)
+			++snapshotCount;
+		else
+			inKeyframe = false;
+
+		if (inKeyframe && snapshotCount == keyframe.windowCount) {
+			WindowInvestigator_CaptureIndex_Add(index, &keyframe);
+			inKeyframe = false;
+		}
+	}
+}
+
+bool WindowInvestigator_CaptureIndex_Write(const WindowInvestigator_CaptureIndex* index, FILE* file) {
+	unsigned char header[WindowInvestigator_CaptureIndex_HEADER_SIZE];
+	unsigned char* position = header;
+	memcpy(position, WindowInvestigator_CaptureIndex_MAGIC, 8);
+	position += 8;
+	position = WindowInvestigator_CaptureIndex_WriteUInt32(position, WindowInvestigator_CaptureIndex_VERSION);
+	position = WindowInvestigator_CaptureIndex_WriteUInt32(position, WindowInvestigator_CaptureIndex_ENTRY_SIZE);
+	position = WindowInvestigator_CaptureIndex_WriteUInt64(position, index->startTimestamp);
+	position = WindowInvestigator_CaptureIndex_WriteUInt64(position, index->startUnixTimeNanoseconds);
+	position = WindowInvestigator_CaptureIndex_WriteUInt64(position, index->captureSize);
+	WindowInvestigator_CaptureIndex_WriteUInt64(position, index->entryCount);
+	if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) return false;
+
+	for (size_t entryIndex = 0; entryIndex < index->entryCount; ++entryIndex) {
+		const WindowInvestigator_CaptureIndexEntry* const entry = &index->entries[entryIndex];
+		unsigned char entryBytes[WindowInvestigator_CaptureIndex_ENTRY_SIZE];
+		position = entryBytes;
+		position = WindowInvestigator_CaptureIndex_WriteUInt64(position, entry->timestamp);
+		position = WindowInvestigator_CaptureIndex_WriteUInt64(position, entry->offset);
+		position = WindowInvestigator_CaptureIndex_WriteUInt32(position, entry->windowCount);
+		WindowInvestigator_CaptureIndex_WriteUInt32(position, 0);
+		if (fwrite(entryBytes, 1, sizeof(entryBytes), file) != sizeof(entryBytes)) return false;
+	}
+	return fflush(file) == 0;
+}
+
+bool WindowInvestigator_CaptureIndex_Read(WindowInvestigator_CaptureIndex* index, FILE* file) {
+	unsigned char header[WindowInvestigator_CaptureIndex_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header)) return false;
+	if (memcmp(header, WindowInvestigator_CaptureIndex_MAGIC, 8) != 0) return false;
+	if (WindowInvestigator_CaptureIndex_ReadUInt32(header + 8) != WindowInvestigator_CaptureIndex_VERSION) return false;
+	const uint32_t entrySize = WindowInvestigator_CaptureIndex_ReadUInt32(header + 12);
+	if (entrySize < WindowInvestigator_CaptureIndex_ENTRY_SIZE) return false;
+	index->startTimestamp = WindowInvestigator_CaptureIndex_ReadUInt64(header + 16);
+	index->startUnixTimeNanoseconds = WindowInvestigator_CaptureIndex_ReadUInt64(header + 24);
+	index->captureSize = WindowInvestigator_CaptureIndex_ReadUInt64(header + 32);
+	const uint64_t entryCount = WindowInvestigator_CaptureIndex_ReadUInt64(header + 40);
+
+	index->entryCount = 0;
+	for (uint64_t entryIndex = 0; entryIndex < entryCount; ++entryIndex) {
+		unsigned char entryBytes[WindowInvestigator_CaptureIndex_ENTRY_SIZE];
+		if (fread(entryBytes, 1, sizeof(entryBytes), file) != sizeof(entryBytes)) return false;
+		for (uint32_t extraByte = WindowInvestigator_CaptureIndex_ENTRY_SIZE; extraByte < entrySize; ++extraByte)
+			if (fgetc(file) == EOF) return false;
+		WindowInvestigator_CaptureIndexEntry entry;
+		entry.timestamp = WindowInvestigator_CaptureIndex_ReadUInt64(entryBytes);
+		entry.offset = WindowInvestigator_CaptureIndex_ReadUInt64(entryBytes + 8);
+		entry.windowCount = WindowInvestigator_CaptureIndex_ReadUInt32(entryBytes + 16);
+		WindowInvestigator_CaptureIndex_Add(index, &entry);
+	}
+	return true;
+}
+
+bool WindowInvestigator_CaptureIndex_Matches(const WindowInvestigator_CaptureIndex* index, const WindowInvestigator_CaptureReader* reader) {
+	return index->startTimestamp == reader->header.startTimestamp && index->startUnixTimeNanoseconds == reader->header.startUnixTimeNanoseconds;
+}
+
+size_t WindowInvestigator_CaptureIndex_Find(const WindowInvestigator_CaptureIndex* index, uint64_t timestamp) {
+	// Invariant: entries before begin are not after timestamp; entries at or after end are.
+	size_t begin = 0;
+	size_t end = index->entryCount;
+	while (begin < end) {
+		const size_t middle = begin + (end - begin) / 2;
+		if (index->entries[middle].timestamp <= timestamp) begin = middle + 1;
+		else end = middle;
+	}
+	return begin == 0 ? WindowInvestigator_CaptureIndex_NO_ENTRY : begin - 1;
+}
+
+static void WindowInvestigator_CaptureState_OnWindowGone(void* context, uintptr_t window, void* windowInfo) {
+	(void)window;
+	WindowInvestigator_CaptureState* const state = context;
+	WindowInvestigator_ReleaseWindowStrings(&state->strings, windowInfo);
+}
+
+static void WindowInvestigator_CaptureState_OnZOrderChanged(void* context, uintptr_t window, void* windowInfo, size_t previousZOrder, size_t zOrder) {
+	(void)context; (void)window; (void)windowInfo; (void)previousZOrder; (void)zOrder;
+}
+
+static void WindowInvestigator_CaptureState_EndPass(WindowInvestigator_CaptureState* state) {
+	WindowInvestigator_WindowTable_PassCallbacks passCallbacks;
+	passCallbacks.onWindowGone = WindowInvestigator_CaptureState_OnWindowGone;
+	passCallbacks.onZOrderChanged = WindowInvestigator_CaptureState_OnZOrderChanged;
+	passCallbacks.context = state;
+	WindowInvestigator_WindowTable_EndPass(&state->windows, &passCallbacks);
+}
+
+void WindowInvestigator_CaptureState_Init(WindowInvestigator_CaptureState* state) {
+	memset(state, 0, sizeof(*state));
+	WindowInvestigator_StringPool_Init(&state->strings);
+	WindowInvestigator_WindowTable_Init(&state->windows, sizeof(WindowInvestigator_WindowInfo));
+	state->inconsistent = true;
+}
+
+static void WindowInvestigator_CaptureState_ClearTick(WindowInvestigator_CaptureState* state) {
+	for (size_t placementIndex = 0; placementIndex < state->placementCount; ++placementIndex)
+		if (state->placements[placementIndex].isNewWindow)
+			WindowInvestigator_ReleaseWindowStrings(&state->strings, &state->placements[placementIndex].windowInfo);
+	state->placementCount = 0;
+	state->goneWindowCount = 0;
+}
+
+void WindowInvestigator_CaptureState_Clear(WindowInvestigator_CaptureState* state) {
+	WindowInvestigator_CaptureState_ClearTick(state);
+	WindowInvestigator_WindowTable_BeginPass(&state->windows);
+	WindowInvestigator_CaptureState_EndPass(state);
+	state->timestamp = 0;
+	state->inconsistent = true;
+	state->eventsDropped = false;
+	state->droppedEventCount = 0;
+	state->keyframeWindowCount = 0;
+	state->pendingSnapshots = 0;
+	state->keyframeMismatches = 0;
+}
+
+void WindowInvestigator_CaptureState_Destroy(WindowInvestigator_CaptureState* state) {
+	WindowInvestigator_CaptureState_Clear(state);
+	WindowInvestigator_WindowTable_Destroy(&state->windows);
+	WindowInvestigator_StringPool_Destroy(&state->strings);
+	WindowInvestigator_Free(state->placements);
+	WindowInvestigator_Free(state->goneWindows);
+	WindowInvestigator_Free(state->newZOrder);
+}
+
+// Decodes the record and applies it on top of previousWindowInfo (which can be NULL if the record is a full snapshot). The
+// strings of windowInfo are interned against previousWindowInfo.
+static bool WindowInvestigator_CaptureState_Decode(WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload, const WindowInvestigator_WindowInfo* previousWindowInfo, WindowInvestigator_WindowInfo* windowInfo) {
+	uint32_t fields;
+	WindowInvestigator_WindowInfo decodedWindowInfo;
+	if (WindowInvestigator_DecodeWindowRecord(payload, header->payloadSize, &fields, &decodedWindowInfo, &state->windowStrings) != header->payloadSize) return false;
+	if (previousWindowInfo == NULL) {
+		if (fields != WindowInvestigator_WindowField_ALL) return false;
+		memset(windowInfo, 0, sizeof(*windowInfo));
+	}
+	else *windowInfo = *previousWindowInfo;
+	WindowInvestigator_CopyWindowInfoFields(windowInfo, &decodedWindowInfo, fields);
+	WindowInvestigator_InternWindowStrings(&state->strings, previousWindowInfo, fields, &state->windowStrings, windowInfo);
+	return true;
+}
+
+static void WindowInvestigator_CaptureState_AddPlacement(WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureState_Placement* placement) {
+	if (state->placementCount == state->placementCapacity) {
+		state->placementCapacity = state->placementCapacity == 0 ? 16 : state->placementCapacity * 2;
+		state->placements = WindowInvestigator_Reallocate(state->placements, state->placementCapacity, sizeof(*state->placements));
+	}
+	state->placements[state->placementCount++] = *placement;
+}
+
+static bool WindowInvestigator_CaptureState_IsExcluded(const WindowInvestigator_CaptureState* state, uintptr_t window) {
+	for (size_t placementIndex = 0; placementIndex < state->placementCount; ++placementIndex)
+		if (state->placements[placementIndex].window == window) return true;
+	for (size_t goneWindowIndex = 0; goneWindowIndex < state->goneWindowCount; ++goneWindowIndex)
+		if (state->goneWindows[goneWindowIndex] == window) return true;
+	return false;
+}
+
+static void WindowInvestigator_CaptureState_UpdateZOrder(WindowInvestigator_CaptureState* state, size_t windowCount) {
+	if (windowCount > state->newZOrderCapacity) {
+		state->newZOrderCapacity = windowCount;
+		state->newZOrder = WindowInvestigator_Reallocate(state->newZOrder, windowCount, sizeof(*state->newZOrder));
+	}
+	for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) state->newZOrder[zOrder] = 0;
+
+	for (size_t placementIndex = 0; placementIndex < state->placementCount; ++placementIndex) {
+		const WindowInvestigator_CaptureState_Placement* const placement = &state->placements[placementIndex];
+		if (placement->zOrder >= windowCount || state->newZOrder[placement->zOrder] != 0) state->inconsistent = true;
+		else state->newZOrder[placement->zOrder] = placement->window;
+	}
+
+	// Windows that did not move keep their relative order.
+	size_t zOrder = 0;
+	const size_t previousWindowCount = WindowInvestigator_WindowTable_GetZOrderCount(&state->windows);
+	for (size_t previousZOrder = 0; previousZOrder < previousWindowCount; ++previousZOrder) {
+		const uintptr_t window = WindowInvestigator_WindowTable_GetWindow(&state->windows, WindowInvestigator_WindowTable_GetZOrderSlot(&state->windows, previousZOrder));
+		if (WindowInvestigator_CaptureState_IsExcluded(state, window)) continue;
+		while (zOrder < windowCount && state->newZOrder[zOrder] != 0) ++zOrder;
+		if (zOrder == windowCount) {
+			state->inconsistent = true;
+			break;
+		}
+		state->newZOrder[zOrder] = window;
+	}
+
+	WindowInvestigator_WindowTable_BeginPass(&state->windows);
+	for (zOrder = 0; zOrder < windowCount; ++zOrder) {
+		const uintptr_t window = state->newZOrder[zOrder];
+		if (window == 0) {
+			state->inconsistent = true;
+			continue;
+		}
+		WindowInvestigator_WindowInfo* newWindowInfo = NULL;
+		for (size_t placementIndex = 0; placementIndex < state->placementCount; ++placementIndex) {
+			WindowInvestigator_CaptureState_Placement* const placement = &state->placements[placementIndex];
+			if (placement->window != window || !placement->isNewWindow) continue;
+			newWindowInfo = &placement->windowInfo;
+			// The table takes over the strings.
+			placement->isNewWindow = false;
+			break;
+		}
+		// Windows we don't know anything about (e.g. because events were dropped) are left out.
+		if (newWindowInfo == NULL && WindowInvestigator_WindowTable_Find(&state->windows, window) == WindowInvestigator_WindowTable_NO_SLOT) {
+			state->inconsistent = true;
+			continue;
+		}
+		WindowInvestigator_WindowTable_VisitResult visitResult;
+		const size_t slot = WindowInvestigator_WindowTable_Visit(&state->windows, window, &visitResult);
+		WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(&state->windows, slot);
+		if (visitResult == WindowInvestigator_WindowTable_NEW_WINDOW) *windowInfo = *newWindowInfo;
+		else if (newWindowInfo != NULL) {
+			// The window was already there; keep the latest properties.
+			state->inconsistent = true;
+			WindowInvestigator_ReleaseWindowStrings(&state->strings, windowInfo);
+			*windowInfo = *newWindowInfo;
+		}
+	}
+	WindowInvestigator_CaptureState_EndPass(state);
+	WindowInvestigator_CaptureState_ClearTick(state);
+}
+
+static bool WindowInvestigator_CaptureState_ApplySnapshot(WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload) {
+	if (state->pendingSnapshots == 0 || header->zOrder != state->keyframeWindowCount - state->pendingSnapshots) {
+		// Not part of a keyframe, or out of order.
+		state->inconsistent = true;
+		return true;
+	}
+
+	const size_t existingSlot = WindowInvestigator_WindowTable_Find(&state->windows, (uintptr_t)header->window);
+	const WindowInvestigator_WindowInfo* const previousWindowInfo = existingSlot == WindowInvestigator_WindowTable_NO_SLOT ? NULL : WindowInvestigator_WindowTable_GetValue(&state->windows, existingSlot);
+	WindowInvestigator_WindowInfo windowInfo;
+	if (!WindowInvestigator_CaptureState_Decode(state, header, payload, previousWindowInfo, &windowInfo)) return false;
+	if (previousWindowInfo == NULL || WindowInvestigator_DiffWindowInfo(previousWindowInfo, &windowInfo) != 0 || state->windows.slots[existingSlot].zOrder != header->zOrder)
+		++state->keyframeMismatches;
+
+	WindowInvestigator_WindowTable_VisitResult visitResult;
+	const size_t slot = WindowInvestigator_WindowTable_Visit(&state->windows, (uintptr_t)header->window, &visitResult);
+	WindowInvestigator_WindowInfo* const tableWindowInfo = WindowInvestigator_WindowTable_GetValue(&state->windows, slot);
+	if (visitResult == WindowInvestigator_WindowTable_NEW_WINDOW) *tableWindowInfo = windowInfo;
+	else if (visitResult == WindowInvestigator_WindowTable_EXISTING_WINDOW) WindowInvestigator_ReplaceWindowInfo(&state->strings, tableWindowInfo, &windowInfo);
+	else {
+		state->inconsistent = true;
+		WindowInvestigator_ReleaseWindowStrings(&state->strings, &windowInfo);
+	}
+
+	if (--state->pendingSnapshots == 0) {
+		WindowInvestigator_CaptureState_EndPass(state);
+		state->inconsistent = false;
+		state->eventsDropped = false;
+	}
+	return true;
+}
+
+bool WindowInvestigator_CaptureState_Apply(WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload) {
+	state->timestamp = header->timestamp;
+	const uintptr_t window = (uintptr_t)header->window;
+
+	if (state->pendingSnapshots != 0 && header->type != WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT) {
+		// Incomplete keyframe.
+		WindowInvestigator_CaptureState_EndPass(state);
+		state->pendingSnapshots = 0;
+		state->inconsistent = true;
+	}
+
+	switch (header->type) {
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW: {
+		WindowInvestigator_CaptureState_Placement placement;
+		placement.window = window;
+		placement.zOrder = header->zOrder;
+		placement.isNewWindow = true;
+		if (!WindowInvestigator_CaptureState_Decode(state, header, payload, NULL, &placement.windowInfo)) return false;
+		WindowInvestigator_CaptureState_AddPlacement(state, &placement);
+		return true;
+	}
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED: {
+		const size_t slot = WindowInvestigator_WindowTable_Find(&state->windows, window);
+		if (slot == WindowInvestigator_WindowTable_NO_SLOT) {
+			state->inconsistent = true;
+			return true;
+		}
+		WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(&state->windows, slot);
+		WindowInvestigator_WindowInfo newWindowInfo;
+		if (!WindowInvestigator_CaptureState_Decode(state, header, payload, windowInfo, &newWindowInfo)) return false;
+		WindowInvestigator_ReplaceWindowInfo(&state->strings, windowInfo, &newWindowInfo);
+		return true;
+	}
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED: {
+		if (WindowInvestigator_WindowTable_Find(&state->windows, window) == WindowInvestigator_WindowTable_NO_SLOT) state->inconsistent = true;
+		WindowInvestigator_CaptureState_Placement placement;
+		placement.window = window;
+		placement.zOrder = header->zOrder;
+		placement.isNewWindow = false;
+		WindowInvestigator_CaptureState_AddPlacement(state, &placement);
+		return true;
+	}
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+		if (state->goneWindowCount == state->goneWindowCapacity) {
+			state->goneWindowCapacity = state->goneWindowCapacity == 0 ? 16 : state->goneWindowCapacity * 2;
+			state->goneWindows = WindowInvestigator_Reallocate(state->goneWindows, state->goneWindowCapacity, sizeof(*state->goneWindows));
+		}
+		state->goneWindows[state->goneWindowCount++] = window;
+		return true;
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+		WindowInvestigator_CaptureState_UpdateZOrder(state, header->zOrder);
+		return true;
+	case WindowInvestigator_MonitorEvent_KEYFRAME:
+		// Keyframes are logged between ticks.
+		if (state->placementCount != 0 || state->goneWindowCount != 0) state->inconsistent = true;
+		WindowInvestigator_CaptureState_ClearTick(state);
+		state->keyframeMismatches = 0;
+		state->keyframeWindowCount = header->zOrder;
+		state->pendingSnapshots = header->zOrder;
+		WindowInvestigator_WindowTable_BeginPass(&state->windows);
+		if (state->pendingSnapshots == 0) {
+			WindowInvestigator_CaptureState_EndPass(state);
+			state->inconsistent = false;
+			state->eventsDropped = false;
+		}
+		return true;
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT:
+		return WindowInvestigator_CaptureState_ApplySnapshot(state, header, payload);
+	case WindowInvestigator_MonitorEvent_EVENTS_DROPPED:
+		if (!WindowInvestigator_DecodeEventsDropped(payload, header->payloadSize, &state->droppedEventCount)) return false;
+		state->inconsistent = true;
+		state->eventsDropped = true;
+		return true;
+	}
+	// Unknown event types are ignored, for forward compatibility.
+	return true;
+}
+
+bool WindowInvestigator_CaptureState_Load(WindowInvestigator_CaptureState* state, WindowInvestigator_CaptureReader* reader, const WindowInvestigator_CaptureIndex* index, uint64_t timestamp, uint64_t* recordsApplied) {
+	WindowInvestigator_CaptureState_Clear(state);
+	const size_t entryIndex = WindowInvestigator_CaptureIndex_Find(index, timestamp);
+	if (entryIndex == WindowInvestigator_CaptureIndex_NO_ENTRY) {
+		if (!WindowInvestigator_CaptureReader_Seek(reader, reader->header.headerSize)) return false;
+		// The monitor starts with no windows, so replaying the capture from the start gives the full picture.
+		state->inconsistent = false;
+	}
+	else if (!WindowInvestigator_CaptureReader_Seek(reader, index->entries[entryIndex].offset)) return false;
+
+	uint64_t recordCount = 0;
+	for (;;) {
+		const uint64_t offset = reader->offset;
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		const WindowInvestigator_CaptureReader_Result result = WindowInvestigator_CaptureReader_ReadRecord(reader, &header, &payload);
+		if (result == WindowInvestigator_CaptureReader_ERROR) return false;
+		if (result != WindowInvestigator_CaptureReader_RECORD) break;
+		// A keyframe describes a single point in time, so it is applied as a whole.
+		if (header.timestamp > timestamp && state->pendingSnapshots == 0) {
+			if (!WindowInvestigator_CaptureReader_Seek(reader, offset)) return false;
+			break;
+		}
+		if (!WindowInvestigator_CaptureState_Apply(state, &header, payload)) return false;
+		++recordCount;
+	}
+	if (recordsApplied != NULL) *recordsApplied = recordCount;
+	return true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "capture_file.h"
+#include "string_pool.h"
+#include "window_info.h"
+#include "window_table.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Seek index over a capture file, and reconstruction of the state of the desktop at any point in time.
+//
+// WindowMonitor periodically logs a keyframe: a full snapshot of every window (see WindowInvestigator_MonitorEvent_KEYFRAME).
+// Between keyframes, only changes are logged. The index records the timestamp and file offset of every keyframe, so that the
+// state at a given time can be obtained by loading the last keyframe before that time and applying only the changes that
+// follow, instead of replaying the capture from the start.
+//
+// The index is kept in memory as a sorted array, and can be saved to a sidecar file. All integers are little-endian:
+//  - Magic: the 8 ASCII characters "WICAPIDX".
+//  - Version (uint32): WindowInvestigator_CaptureIndex_VERSION.
+//  - Size of each entry (uint32).
+//  - Start timestamp and start wall clock time (uint64 each), copied from the capture file header, to detect an index that
+//    does not belong to the capture.
+//  - Size of the capture file that was indexed (uint64). If the capture kept growing afterwards, the index is still valid;
+//    it just does not know about later keyframes.
+//  - Number of entries (uint64).
+//  - Entries, in capture order: timestamp (uint64), offset of the KEYFRAME record (uint64), number of windows (uint32),
+//    reserved (uint32).
+
+#define WindowInvestigator_CaptureIndex_MAGIC "WICAPIDX"
+#define WindowInvestigator_CaptureIndex_VERSION 1
+#define WindowInvestigator_CaptureIndex_HEADER_SIZE (8 + 2 * 4 + 4 * 8)
+#define WindowInvestigator_CaptureIndex_ENTRY_SIZE (2 * 8 + 2 * 4)
+
+#define WindowInvestigator_CaptureIndex_NO_ENTRY SIZE_MAX
+
+typedef struct {
+	uint64_t timestamp;
+	uint64_t offset;
+	uint32_t windowCount;
+} WindowInvestigator_CaptureIndexEntry;
+
+typedef struct {
+	uint64_t startTimestamp;
+	uint64_t startUnixTimeNanoseconds;
+	uint64_t captureSize;
+	WindowInvestigator_CaptureIndexEntry* entries;
+	size_t entryCount;
+	size_t entryCapacity;
+} WindowInvestigator_CaptureIndex;
+
+void WindowInvestigator_CaptureIndex_Init(WindowInvestigator_CaptureIndex* index);
+void WindowInvestigator_CaptureIndex_Destroy(WindowInvestigator_CaptureIndex* index);
+
+// Scans the whole capture from the current position of reader, which must be right after the file header. Keyframes that
+// are incomplete (e.g. because events were dropped, or the capture ends in the middle of one) are not indexed.
+// Returns false on I/O error or malformed capture; a truncated last record is not an error.
+bool WindowInvestigator_CaptureIndex_Build(WindowInvestigator_CaptureIndex* index, WindowInvestigator_CaptureReader* reader);
+
+// file must be open in binary mode, and stays owned by the caller. These return false on I/O error; Read() also returns false
+// if the file is not an index file, or uses an unsupported version.
+bool WindowInvestigator_CaptureIndex_Write(const WindowInvestigator_CaptureIndex* index, FILE* file);
+bool WindowInvestigator_CaptureIndex_Read(WindowInvestigator_CaptureIndex* index, FILE* file);
+
+// Returns whether the index was built from the capture that reader is reading.
+bool WindowInvestigator_CaptureIndex_Matches(const WindowInvestigator_CaptureIndex* index, const WindowInvestigator_CaptureReader* reader);
+
+// Returns the last entry whose timestamp is not after the specified timestamp, or WindowInvestigator_CaptureIndex_NO_ENTRY
+// if there is none. O(log n).
+size_t WindowInvestigator_CaptureIndex_Find(const WindowInvestigator_CaptureIndex* index, uint64_t timestamp);
+
+// State of the desktop, rebuilt from capture records.
+//
+// The Z-order is rebuilt at every ZORDER_UPDATED record: windows that appeared or moved during the tick go to the Z-order
+// index they were reported at, and every other window that is still there fills the remaining indices in its previous
+// relative order. Until then, windows that appeared during the tick are not part of the state yet.
+typedef struct {
+	uintptr_t window;
+	size_t zOrder;
+	bool isNewWindow;
+	// Only if isNewWindow.
+	WindowInvestigator_WindowInfo windowInfo;
+} WindowInvestigator_CaptureState_Placement;
+
+typedef struct {
+	WindowInvestigator_StringPool strings;
+	// Values are WindowInvestigator_WindowInfo; string IDs refer to strings.
+	WindowInvestigator_WindowTable windows;
+	// Timestamp of the last record applied.
+	uint64_t timestamp;
+	// Set until a complete keyframe has been applied (unless the capture is replayed from the start), and whenever records
+	// contradict the state (e.g. because events were dropped). Cleared by the next complete keyframe.
+	bool inconsistent;
+	// Set by EVENTS_DROPPED records (along with inconsistent), and cleared by the next complete keyframe: some changes are
+	// known to be missing from the capture, so the state may be wrong even if nothing contradicts it.
+	bool eventsDropped;
+	// Number of dropped events reported by the last EVENTS_DROPPED record applied, i.e. since the start of the capture.
+	uint64_t droppedEventCount;
+	// Number of windows in the keyframe being applied, and how many of them have not been applied yet.
+	size_t keyframeWindowCount;
+	size_t pendingSnapshots;
+	// Number of windows in the keyframe being applied whose snapshot did not match the state (including their Z-order). Reset
+	// by every keyframe. Only meaningful if the state was consistent when the keyframe started.
+	size_t keyframeMismatches;
+
+	// Windows that appeared or moved during the current tick.
+	WindowInvestigator_CaptureState_Placement* placements;
+	size_t placementCount;
+	size_t placementCapacity;
+	// Windows that disappeared during the current tick.
+	uintptr_t* goneWindows;
+	size_t goneWindowCount;
+	size_t goneWindowCapacity;
+	uintptr_t* newZOrder;
+	size_t newZOrderCapacity;
+	WindowInvestigator_WindowStrings windowStrings;
+} WindowInvestigator_CaptureState;
+
+void WindowInvestigator_CaptureState_Init(WindowInvestigator_CaptureState* state);
+void WindowInvestigator_CaptureState_Destroy(WindowInvestigator_CaptureState* state);
+// Forgets every window.
+void WindowInvestigator_CaptureState_Clear(WindowInvestigator_CaptureState* state);
+
+// Applies a capture record. Returns false if the record is malformed.
+bool WindowInvestigator_CaptureState_Apply(WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload);
+
+// Rebuilds the state as of the specified timestamp, using the index to skip to the closest keyframe, then applying every
+// record up to and including that timestamp, as well as the rest of the keyframe that timestamp falls in, if any. If there
+// is no keyframe before the timestamp, the capture is replayed from the start. recordsApplied, if not NULL, is set to the
+// number of records applied. Afterwards, the reader is at the first record that was not applied.
+// Returns false on I/O error or malformed capture.
+bool WindowInvestigator_CaptureState_Load(WindowInvestigator_CaptureState* state, WindowInvestigator_CaptureReader* reader, const WindowInvestigator_CaptureIndex* index, uint64_t timestamp, uint64_t* recordsApplied);
@@ -0,0 +1,36 @@
+#include "clock.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+uint64_t WindowInvestigator_GetTimeNanoseconds(void) {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	const uint64_t ticks = (uint64_t)counter.QuadPart;
+	const uint64_t ticksPerSecond = (uint64_t)frequency.QuadPart;
+	return ticks / ticksPerSecond * UINT64_C(1000000000) + ticks % ticksPerSecond * UINT64_C(1000000000) / ticksPerSecond;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+void WindowInvestigator_SleepNanoseconds(uint64_t nanoseconds) {
+#ifdef _WIN32
+	const uint64_t milliseconds = (nanoseconds + 999999) / 1000000;
+	Sleep(milliseconds > MAXDWORD - 1 ? MAXDWORD - 1 : (DWORD)milliseconds);
+#else
+	struct timespec duration;
+	duration.tv_sec = (time_t)(nanoseconds / UINT64_C(1000000000));
+	duration.tv_nsec = (long)(nanoseconds % UINT64_C(1000000000));
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR) {}
+#endif
+}
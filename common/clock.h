@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+// Monotonic high-resolution clock, in nanoseconds since an arbitrary epoch.
+uint64_t WindowInvestigator_GetTimeNanoseconds(void);
+
+// Blocks the calling thread for at least the specified duration. Precision depends on the platform scheduler.
+void WindowInvestigator_SleepNanoseconds(uint64_t nanoseconds);
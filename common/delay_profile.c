@@ -0,0 +1,358 @@
+#include "delay_profile.h"
+
+#include "allocation.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	const char* name;
+	uint32_t message;
+} WindowInvestigator_DelayProfile_MessageName;
+
+// The messages that are most relevant to window management; others can be specified by number.
+static const WindowInvestigator_DelayProfile_MessageName WindowInvestigator_DelayProfile_messageNames[] = {
+	{ "WM_CREATE", 0x0001 },
+	{ "WM_MOVE", 0x0003 },
+	{ "WM_SIZE", 0x0005 },
+	{ "WM_ACTIVATE", 0x0006 },
+	{ "WM_SETFOCUS", 0x0007 },
+	{ "WM_KILLFOCUS", 0x0008 },
+	{ "WM_SETTEXT", 0x000C },
+	{ "WM_GETTEXT", 0x000D },
+	{ "WM_PAINT", 0x000F },
+	{ "WM_ERASEBKGND", 0x0014 },
+	{ "WM_SHOWWINDOW", 0x0018 },
+	{ "WM_ACTIVATEAPP", 0x001C },
+	{ "WM_SETCURSOR", 0x0020 },
+	{ "WM_MOUSEACTIVATE", 0x0021 },
+	{ "WM_GETMINMAXINFO", 0x0024 },
+	{ "WM_WINDOWPOSCHANGING", 0x0046 },
+	{ "WM_WINDOWPOSCHANGED", 0x0047 },
+	{ "WM_STYLECHANGING", 0x007C },
+	{ "WM_STYLECHANGED", 0x007D },
+	{ "WM_DISPLAYCHANGE", 0x007E },
+	{ "WM_GETICON", 0x007F },
+	{ "WM_NCCREATE", 0x0081 },
+	{ "WM_NCCALCSIZE", 0x0083 },
+	{ "WM_NCHITTEST", 0x0084 },
+	{ "WM_NCPAINT", 0x0085 },
+	{ "WM_NCACTIVATE", 0x0086 },
+	{ "WM_SYSCOMMAND", 0x0112 },
+	{ "WM_TIMER", 0x0113 },
+	{ "WM_ENTERSIZEMOVE", 0x0231 },
+	{ "WM_EXITSIZEMOVE", 0x0232 },
+	{ "WM_DPICHANGED", 0x02E0 },
+};
+
+void WindowInvestigator_DelayProfile_Init(WindowInvestigator_DelayProfile* profile) {
+	memset(profile, 0, sizeof(*profile));
+	profile->seed = 1;
+	WindowInvestigator_DelayProfile_Reset(profile);
+}
+
+static void WindowInvestigator_DelayProfile_Clear(WindowInvestigator_DelayProfile* profile) {
+	for (size_t rule = 0; rule < profile->ruleCount; ++rule)
+		WindowInvestigator_Free(profile->rules[rule].messages);
+	WindowInvestigator_Free(profile->rules);
+	profile->rules = NULL;
+	profile->ruleCount = 0;
+	profile->seed = 1;
+}
+
+void WindowInvestigator_DelayProfile_Destroy(WindowInvestigator_DelayProfile* profile) {
+	WindowInvestigator_DelayProfile_Clear(profile);
+}
+
+// Tokens are separated by spaces and tabs, and a line ends at a newline or at a #.
+typedef struct {
+	const char* start;
+	size_t length;
+} WindowInvestigator_DelayProfile_Token;
+
+static bool WindowInvestigator_DelayProfile_NextToken(const char** cursor, WindowInvestigator_DelayProfile_Token* token) {
+	const char* character = *cursor;
+	while (*character == ' ' || *character == '\t' || *character == '\r') ++character;
+	if (*character == '\0' || *character == '\n' || *character == '#') {
+		*cursor = character;
+		return false;
+	}
+	token->start = character;
+	while (*character != '\0' && *character != '\n' && *character != '#' && *character != ' ' && *character != '\t' && *character != '\r') ++character;
+	token->length = (size_t)(character - token->start);
+	*cursor = character;
+	return true;
+}
+
+static bool WindowInvestigator_DelayProfile_TokenEquals(const WindowInvestigator_DelayProfile_Token* token, const char* string) {
+	return strlen(string) == token->length && memcmp(token->start, string, token->length) == 0;
+}
+
+static bool WindowInvestigator_DelayProfile_ParseDouble(const char* start, size_t length, double* value) {
+	char buffer[64];
+	if (length == 0 || length >= sizeof(buffer)) return false;
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+	char* end;
+	*value = strtod(buffer, &end);
+	return end == buffer + length && isfinite(*value);
+}
+
+// Milliseconds, converted to nanoseconds. Negative values are only accepted if allowNegative is true.
+static bool WindowInvestigator_DelayProfile_ParseMilliseconds(const char** cursor, bool allowNegative, double* nanoseconds) {
+	WindowInvestigator_DelayProfile_Token token;
+	double milliseconds;
+	if (!WindowInvestigator_DelayProfile_NextToken(cursor, &token) || !WindowInvestigator_DelayProfile_ParseDouble(token.start, token.length, &milliseconds)) return false;
+	if (!allowNegative && milliseconds < 0) return false;
+	*nanoseconds = milliseconds * 1e6;
+	return *nanoseconds < 1.8e19;
+}
+
+static bool WindowInvestigator_DelayProfile_ParseTime(const char** cursor, uint64_t* nanoseconds) {
+	double value;
+	if (!WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, false, &value)) return false;
+	*nanoseconds = (uint64_t)value;
+	return true;
+}
+
+static bool WindowInvestigator_DelayProfile_ParseMessage(const char* start, size_t length, uint32_t* message) {
+	for (size_t name = 0; name < sizeof(WindowInvestigator_DelayProfile_messageNames) / sizeof(*WindowInvestigator_DelayProfile_messageNames); ++name) {
+		const char* const messageName = WindowInvestigator_DelayProfile_messageNames[name].name;
+		if (strlen(messageName) != length) continue;
+		size_t index = 0;
+		while (index < length && toupper((unsigned char)start[index]) == messageName[index]) ++index;
+		if (index == length) {
+			*message = WindowInvestigator_DelayProfile_messageNames[name].message;
+			return true;
+		}
+	}
+
+	char buffer[16];
+	if (length == 0 || length >= sizeof(buffer) || !isdigit((unsigned char)start[0])) return false;
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+	char* end;
+	const unsigned long long value = strtoull(buffer, &end, 0);
+	if (end != buffer + length || value > UINT32_MAX) return false;
+	*message = (uint32_t)value;
+	return true;
+}
+
+static bool WindowInvestigator_DelayProfile_ParseMessages(const char** cursor, WindowInvestigator_DelayRule* rule) {
+	WindowInvestigator_DelayProfile_Token token;
+	if (!WindowInvestigator_DelayProfile_NextToken(cursor, &token)) return false;
+	if (WindowInvestigator_DelayProfile_TokenEquals(&token, "*")) return true;
+
+	size_t messageCount = 1;
+	for (size_t index = 0; index < token.length; ++index)
+		if (token.start[index] == ',') ++messageCount;
+	rule->messages = WindowInvestigator_Reallocate(NULL, messageCount, sizeof(*rule->messages));
+	const char* item = token.start;
+	const char* const end = token.start + token.length;
+	for (;;) {
+		const char* itemEnd = item;
+		while (itemEnd != end && *itemEnd != ',') ++itemEnd;
+		if (!WindowInvestigator_DelayProfile_ParseMessage(item, (size_t)(itemEnd - item), &rule->messages[rule->messageCount])) return false;
+		++rule->messageCount;
+		if (itemEnd == end) return true;
+		item = itemEnd + 1;
+	}
+}
+
+static bool WindowInvestigator_DelayProfile_ParseDistribution(const char** cursor, WindowInvestigator_DelayRule* rule) {
+	WindowInvestigator_DelayProfile_Token token;
+	if (!WindowInvestigator_DelayProfile_NextToken(cursor, &token)) return false;
+	if (WindowInvestigator_DelayProfile_TokenEquals(&token, "fixed")) {
+		rule->distribution = WindowInvestigator_DelayDistribution_FIXED;
+		if (!WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, false, &rule->parameters[0])) return false;
+	}
+	else if (WindowInvestigator_DelayProfile_TokenEquals(&token, "uniform")) {
+		rule->distribution = WindowInvestigator_DelayDistribution_UNIFORM;
+		if (!WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, false, &rule->parameters[0]) || !WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, false, &rule->parameters[1]) || rule->parameters[1] < rule->parameters[0]) return false;
+	}
+	else if (WindowInvestigator_DelayProfile_TokenEquals(&token, "normal")) {
+		rule->distribution = WindowInvestigator_DelayDistribution_NORMAL;
+		if (!WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, true, &rule->parameters[0]) || !WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, false, &rule->parameters[1])) return false;
+	}
+	else if (WindowInvestigator_DelayProfile_TokenEquals(&token, "lognormal")) {
+		rule->distribution = WindowInvestigator_DelayDistribution_LOG_NORMAL;
+		if (!WindowInvestigator_DelayProfile_ParseMilliseconds(cursor, false, &rule->parameters[0]) || !WindowInvestigator_DelayProfile_NextToken(cursor, &token) || !WindowInvestigator_DelayProfile_ParseDouble(token.start, token.length, &rule->parameters[1]) || rule->parameters[1] < 0) return false;
+	}
+	else return false;
+
+	rule->maximumNanoseconds = UINT64_MAX;
+	if (!WindowInvestigator_DelayProfile_NextToken(cursor, &token)) return true;
+	return WindowInvestigator_DelayProfile_TokenEquals(&token, "max") && WindowInvestigator_DelayProfile_ParseTime(cursor, &rule->maximumNanoseconds) && !WindowInvestigator_DelayProfile_NextToken(cursor, &token);
+}
+
+// Returns false if the line is malformed. Blank lines are fine.
+static bool WindowInvestigator_DelayProfile_ParseLine(WindowInvestigator_DelayProfile* profile, const char** cursor, size_t line) {
+	WindowInvestigator_DelayProfile_Token token;
+	if (!WindowInvestigator_DelayProfile_NextToken(cursor, &token)) return true;
+
+	if (WindowInvestigator_DelayProfile_TokenEquals(&token, "seed")) {
+		if (!WindowInvestigator_DelayProfile_NextToken(cursor, &token) || !isdigit((unsigned char)token.start[0])) return false;
+		char buffer[32];
+		if (token.length >= sizeof(buffer)) return false;
+		memcpy(buffer, token.start, token.length);
+		buffer[token.length] = '\0';
+		char* end;
+		errno = 0;
+		profile->seed = strtoull(buffer, &end, 0);
+		return end == buffer + token.length && errno != ERANGE && !WindowInvestigator_DelayProfile_NextToken(cursor, &token);
+	}
+
+	WindowInvestigator_DelayRule rule;
+	memset(&rule, 0, sizeof(rule));
+	rule.line = line;
+	if (WindowInvestigator_DelayProfile_TokenEquals(&token, "delay")) rule.kind = WindowInvestigator_DelayRuleKind_DELAY;
+	else if (WindowInvestigator_DelayProfile_TokenEquals(&token, "burst")) {
+		rule.kind = WindowInvestigator_DelayRuleKind_BURST;
+		if (!WindowInvestigator_DelayProfile_ParseTime(cursor, &rule.burstPeriodNanoseconds) || !WindowInvestigator_DelayProfile_ParseTime(cursor, &rule.burstDurationNanoseconds) || rule.burstPeriodNanoseconds == 0 || rule.burstDurationNanoseconds > rule.burstPeriodNanoseconds) return false;
+	}
+	else if (WindowInvestigator_DelayProfile_TokenEquals(&token, "at")) {
+		rule.kind = WindowInvestigator_DelayRuleKind_AT;
+		if (!WindowInvestigator_DelayProfile_ParseTime(cursor, &rule.timeNanoseconds)) return false;
+	}
+	else return false;
+
+	if (!WindowInvestigator_DelayProfile_ParseMessages(cursor, &rule) || !WindowInvestigator_DelayProfile_ParseDistribution(cursor, &rule)) {
+		WindowInvestigator_Free(rule.messages);
+		return false;
+	}
+	profile->rules = WindowInvestigator_Reallocate(profile->rules, profile->ruleCount + 1, sizeof(*profile->rules));
+	profile->rules[profile->ruleCount++] = rule;
+	return true;
+}
+
+bool WindowInvestigator_DelayProfile_Parse(WindowInvestigator_DelayProfile* profile, const char* text, size_t* errorLine) {
+	WindowInvestigator_DelayProfile_Clear(profile);
+	const char* cursor = text;
+	for (size_t line = 1;; ++line) {
+		if (!WindowInvestigator_DelayProfile_ParseLine(profile, &cursor, line)) {
+			WindowInvestigator_DelayProfile_Clear(profile);
+			WindowInvestigator_DelayProfile_Reset(profile);
+			*errorLine = line;
+			return false;
+		}
+		// Skip the comment, if any.
+		while (*cursor != '\0' && *cursor != '\n') ++cursor;
+		if (*cursor == '\0') break;
+		++cursor;
+	}
+	WindowInvestigator_DelayProfile_Reset(profile);
+	return true;
+}
+
+void WindowInvestigator_DelayProfile_SetFixed(WindowInvestigator_DelayProfile* profile, uint32_t message, uint64_t delayNanoseconds) {
+	WindowInvestigator_DelayProfile_Clear(profile);
+	profile->rules = WindowInvestigator_Reallocate(NULL, 1, sizeof(*profile->rules));
+	profile->ruleCount = 1;
+	WindowInvestigator_DelayRule* const rule = &profile->rules[0];
+	memset(rule, 0, sizeof(*rule));
+	rule->kind = WindowInvestigator_DelayRuleKind_DELAY;
+	rule->line = 1;
+	rule->messages = WindowInvestigator_Reallocate(NULL, 1, sizeof(*rule->messages));
+	rule->messages[0] = message;
+	rule->messageCount = 1;
+	rule->distribution = WindowInvestigator_DelayDistribution_FIXED;
+	rule->parameters[0] = (double)delayNanoseconds;
+	rule->maximumNanoseconds = UINT64_MAX;
+	WindowInvestigator_DelayProfile_Reset(profile);
+}
+
+void WindowInvestigator_DelayProfile_Reset(WindowInvestigator_DelayProfile* profile) {
+	profile->randomState = profile->seed;
+	for (size_t rule = 0; rule < profile->ruleCount; ++rule)
+		profile->rules[rule].done = false;
+}
+
+static uint64_t WindowInvestigator_DelayProfile_Random(WindowInvestigator_DelayProfile* profile) {
+	// SplitMix64
+	uint64_t value = (profile->randomState += 0x9E3779B97F4A7C15);
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+	return value ^ (value >> 31);
+}
+
+// In [0, 1).
+static double WindowInvestigator_DelayProfile_RandomUniform(WindowInvestigator_DelayProfile* profile) {
+	return (double)(WindowInvestigator_DelayProfile_Random(profile) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Box-Muller transform.
+static double WindowInvestigator_DelayProfile_RandomStandardNormal(WindowInvestigator_DelayProfile* profile) {
+	const double radius = sqrt(-2 * log(1 - WindowInvestigator_DelayProfile_RandomUniform(profile)));
+	return radius * cos(6.283185307179586 * WindowInvestigator_DelayProfile_RandomUniform(profile));
+}
+
+static uint64_t WindowInvestigator_DelayProfile_Sample(WindowInvestigator_DelayProfile* profile, const WindowInvestigator_DelayRule* rule) {
+	double delay = 0;
+	switch (rule->distribution) {
+	case WindowInvestigator_DelayDistribution_FIXED:
+		delay = rule->parameters[0];
+		break;
+	case WindowInvestigator_DelayDistribution_UNIFORM:
+		delay = rule->parameters[0] + (rule->parameters[1] - rule->parameters[0]) * WindowInvestigator_DelayProfile_RandomUniform(profile);
+		break;
+	case WindowInvestigator_DelayDistribution_NORMAL:
+		delay = rule->parameters[0] + rule->parameters[1] * WindowInvestigator_DelayProfile_RandomStandardNormal(profile);
+		break;
+	case WindowInvestigator_DelayDistribution_LOG_NORMAL:
+		delay = rule->parameters[0] * exp(rule->parameters[1] * WindowInvestigator_DelayProfile_RandomStandardNormal(profile));
+		break;
+	}
+	if (!(delay > 0)) return 0;
+	if (delay >= (double)rule->maximumNanoseconds) return rule->maximumNanoseconds;
+	return (uint64_t)(delay + 0.5);
+}
+
+static bool WindowInvestigator_DelayProfile_Matches(const WindowInvestigator_DelayRule* rule, uint32_t message) {
+	if (rule->messageCount == 0) return true;
+	for (size_t index = 0; index < rule->messageCount; ++index)
+		if (rule->messages[index] == message) return true;
+	return false;
+}
+
+const WindowInvestigator_DelayRule* WindowInvestigator_DelayProfile_GetDelay(WindowInvestigator_DelayProfile* profile, uint32_t message, uint64_t timeNanoseconds, uint64_t* delayNanoseconds) {
+	WindowInvestigator_DelayRule* selectedRule = NULL;
+	for (size_t index = 0; index < profile->ruleCount; ++index) {
+		WindowInvestigator_DelayRule* const rule = &profile->rules[index];
+		if (rule->kind == WindowInvestigator_DelayRuleKind_AT && !rule->done && rule->timeNanoseconds <= timeNanoseconds && WindowInvestigator_DelayProfile_Matches(rule, message) &&
+			(selectedRule == NULL || rule->timeNanoseconds < selectedRule->timeNanoseconds))
+			selectedRule = rule;
+	}
+	if (selectedRule != NULL) selectedRule->done = true;
+
+	for (size_t index = profile->ruleCount; selectedRule == NULL && index > 0; --index) {
+		WindowInvestigator_DelayRule* const rule = &profile->rules[index - 1];
+		if (rule->kind == WindowInvestigator_DelayRuleKind_BURST && timeNanoseconds % rule->burstPeriodNanoseconds < rule->burstDurationNanoseconds && WindowInvestigator_DelayProfile_Matches(rule, message))
+			selectedRule = rule;
+	}
+	for (size_t index = profile->ruleCount; selectedRule == NULL && index > 0; --index) {
+		WindowInvestigator_DelayRule* const rule = &profile->rules[index - 1];
+		if (rule->kind == WindowInvestigator_DelayRuleKind_DELAY && WindowInvestigator_DelayProfile_Matches(rule, message))
+			selectedRule = rule;
+	}
+
+	*delayNanoseconds = selectedRule == NULL ? 0 : WindowInvestigator_DelayProfile_Sample(profile, selectedRule);
+	return selectedRule;
+}
+
+const char* WindowInvestigator_DelayProfile_GetMessageName(uint32_t message) {
+	for (size_t name = 0; name < sizeof(WindowInvestigator_DelayProfile_messageNames) / sizeof(*WindowInvestigator_DelayProfile_messageNames); ++name)
+		if (WindowInvestigator_DelayProfile_messageNames[name].message == message) return WindowInvestigator_DelayProfile_messageNames[name].name;
+	return NULL;
+}
+
+const char* WindowInvestigator_DelayRuleKind_GetName(WindowInvestigator_DelayRuleKind kind) {
+	switch (kind) {
+	case WindowInvestigator_DelayRuleKind_DELAY: return "delay";
+	case WindowInvestigator_DelayRuleKind_BURST: return "burst";
+	case WindowInvestigator_DelayRuleKind_AT: return "at";
+	}
+	return "unknown";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Decides how long DelayedPosWindow stalls on each window message, so that the bursty, variable stalls of real applications
+// (e.g. Firefox) can be reproduced, along with the specific timings that some shell race conditions need.
+//
+// A profile is a text made of one rule per line (# starts a comment). Times and delays are in milliseconds, and can have a
+// fractional part:
+//
+//   seed SEED                                   Seeds the random delays (default 1).
+//   delay MESSAGES DISTRIBUTION                 Delays every one of these messages.
+//   burst PERIOD DURATION MESSAGES DISTRIBUTION Same, but only during the first DURATION of every PERIOD (bursts start at
+//                                               time 0).
+//   at TIME MESSAGES DISTRIBUTION               Delays the first one of these messages that comes at or after TIME, once.
+//
+// MESSAGES is * (any message), or a comma-separated list of message names (e.g. WM_WINDOWPOSCHANGING, see
+// delay_profile.c for the list) or numbers (e.g. 0x46). DISTRIBUTION is one of:
+//
+//   fixed DELAY
+//   uniform MIN MAX
+//   normal MEAN STANDARD_DEVIATION
+//   lognormal MEDIAN SIGMA                      SIGMA is the standard deviation of the logarithm of the delay.
+//
+// optionally followed by max DELAY, which caps the delay. Normal distributions can produce negative delays, which are treated
+// as 0.
+//
+// Time is measured from the start of the profile (i.e. WindowInvestigator_DelayProfile_Reset()). A message is delayed by the
+// earliest pending at rule that matches it, or else by the last burst rule that matches it and is in a burst, or else by the
+// last delay rule that matches it; otherwise it is not delayed.
+//
+// Random delays are drawn from a SplitMix64 generator seeded with the seed, one draw (or two, for normal and log-normal
+// distributions) per delayed message. The same profile thus produces the same delays for the same sequence of messages and
+// times, on every platform (up to the rounding of the C library's log(), exp() and cos()).
+
+typedef enum {
+	WindowInvestigator_DelayRuleKind_DELAY,
+	WindowInvestigator_DelayRuleKind_BURST,
+	WindowInvestigator_DelayRuleKind_AT,
+} WindowInvestigator_DelayRuleKind;
+
+typedef enum {
+	WindowInvestigator_DelayDistribution_FIXED,
+	WindowInvestigator_DelayDistribution_UNIFORM,
+	WindowInvestigator_DelayDistribution_NORMAL,
+	WindowInvestigator_DelayDistribution_LOG_NORMAL,
+} WindowInvestigator_DelayDistribution;
+
+typedef struct {
+	WindowInvestigator_DelayRuleKind kind;
+	// Line of the rule in the profile, starting at 1.
+	size_t line;
+	// Empty means any message.
+	uint32_t* messages;
+	size_t messageCount;
+	WindowInvestigator_DelayDistribution distribution;
+	// In nanoseconds, except for the log-normal SIGMA: fixed uses the first one, the others use both.
+	double parameters[2];
+	// UINT64_MAX if there is no cap.
+	uint64_t maximumNanoseconds;
+	// Burst rules only.
+	uint64_t burstPeriodNanoseconds;
+	uint64_t burstDurationNanoseconds;
+	// At rules only.
+	uint64_t timeNanoseconds;
+	bool done;
+} WindowInvestigator_DelayRule;
+
+typedef struct {
+	uint64_t seed;
+	// In the order of the profile.
+	WindowInvestigator_DelayRule* rules;
+	size_t ruleCount;
+	uint64_t randomState;
+} WindowInvestigator_DelayProfile;
+
+// The profile starts empty, i.e. delaying nothing.
+void WindowInvestigator_DelayProfile_Init(WindowInvestigator_DelayProfile* profile);
+void WindowInvestigator_DelayProfile_Destroy(WindowInvestigator_DelayProfile* profile);
+
+// Replaces the rules with the ones in text, and resets the profile. Returns false, leaving the profile empty, if text is
+// malformed, in which case errorLine is set to the (1-based) line of the error.
+bool WindowInvestigator_DelayProfile_Parse(WindowInvestigator_DelayProfile* profile, const char* text, size_t* errorLine);
+// Replaces the rules with a single rule that delays the message by a fixed amount, and resets the profile.
+void WindowInvestigator_DelayProfile_SetFixed(WindowInvestigator_DelayProfile* profile, uint32_t message, uint64_t delayNanoseconds);
+
+// Rewinds time to 0: reseeds the random delays, and rearms the at rules.
+void WindowInvestigator_DelayProfile_Reset(WindowInvestigator_DelayProfile* profile);
+
+// Returns the rule that applies to the message received at timeNanoseconds since the start of the profile, or NULL if none
+// does, and sets delayNanoseconds accordingly (to 0 if none does). Times must not go backwards.
+const WindowInvestigator_DelayRule* WindowInvestigator_DelayProfile_GetDelay(WindowInvestigator_DelayProfile* profile, uint32_t message, uint64_t timeNanoseconds, uint64_t* delayNanoseconds);
+
+// Returns the name of a message (e.g. "WM_SIZE"), or NULL if it is not in the list of known messages.
+const char* WindowInvestigator_DelayProfile_GetMessageName(uint32_t message);
+const char* WindowInvestigator_DelayRuleKind_GetName(WindowInvestigator_DelayRuleKind kind);
@@ -0,0 +1,296 @@
+#include "dirty_set.h"
+
+#include "allocation.h"
+#include "window_info.h"
+
+#include <string.h>
+
+static const unsigned int WindowInvestigator_DirtySet_initialBucketBits = 6;
+
+const char* WindowInvestigator_WindowNotification_GetName(WindowInvestigator_WindowNotification notification) {
+	switch (notification) {
+	case WindowInvestigator_WindowNotification_CREATE: return "Create";
+	case WindowInvestigator_WindowNotification_DESTROY: return "Destroy";
+	case WindowInvestigator_WindowNotification_SHOW: return "Show";
+	case WindowInvestigator_WindowNotification_HIDE: return "Hide";
+	case WindowInvestigator_WindowNotification_REORDER: return "Reorder";
+	case WindowInvestigator_WindowNotification_LOCATION: return "Location";
+	case WindowInvestigator_WindowNotification_NAME: return "Name";
+	case WindowInvestigator_WindowNotification_STATE: return "State";
+	case WindowInvestigator_WindowNotification_CLOAK: return "Cloak";
+	case WindowInvestigator_WindowNotification_COUNT: break;
+	}
+	return "Unknown";
+}
+
+uint32_t WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification notification) {
+	switch (notification) {
+	// New windows are read in full, and windows that are gone are dropped, so there is nothing to read for these.
+	case WindowInvestigator_WindowNotification_CREATE:
+	case WindowInvestigator_WindowNotification_DESTROY:
+		return 0;
+	case WindowInvestigator_WindowNotification_SHOW:
+	case WindowInvestigator_WindowNotification_HIDE:
+		return WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES) | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE);
+	// Becoming topmost, or moving to another band, also moves the window in the Z-order.
+	case WindowInvestigator_WindowNotification_REORDER:
+		return WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES) | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_BAND);
+	case WindowInvestigator_WindowNotification_LOCATION:
+		return WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC);
+	case WindowInvestigator_WindowNotification_NAME:
+		return WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT);
+	case WindowInvestigator_WindowNotification_STATE:
+		return WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD) |
+			WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC);
+	case WindowInvestigator_WindowNotification_CLOAK:
+		return WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED);
+	case WindowInvestigator_WindowNotification_COUNT: break;
+	}
+	return WindowInvestigator_WindowField_ALL;
+}
+
+bool WindowInvestigator_WindowNotification_IsStructural(WindowInvestigator_WindowNotification notification) {
+	return notification == WindowInvestigator_WindowNotification_CREATE ||
+		notification == WindowInvestigator_WindowNotification_DESTROY ||
+		notification == WindowInvestigator_WindowNotification_SHOW ||
+		notification == WindowInvestigator_WindowNotification_HIDE ||
+		notification == WindowInvestigator_WindowNotification_REORDER;
+}
+
+static size_t WindowInvestigator_DirtySet_GetBucketCount(const WindowInvestigator_DirtySet* set) {
+	return (size_t)1 << set->bucketBits;
+}
+
+static size_t WindowInvestigator_DirtySet_GetHomeBucket(const WindowInvestigator_DirtySet* set, uintptr_t window) {
+	// Fibonacci hashing, as in WindowInvestigator_WindowTable.
+	return (size_t)(((uint64_t)window * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - set->bucketBits));
+}
+
+static void WindowInvestigator_DirtySet_InsertIntoIndex(WindowInvestigator_DirtySet* set, size_t entry) {
+	const size_t bucketMask = WindowInvestigator_DirtySet_GetBucketCount(set) - 1;
+	size_t bucket = WindowInvestigator_DirtySet_GetHomeBucket(set, set->entries[entry].window);
+	while (set->buckets[bucket] != WindowInvestigator_DirtySet_NO_ENTRY)
+		bucket = (bucket + 1) & bucketMask;
+	set->buckets[bucket] = entry;
+}
+
+static void WindowInvestigator_DirtySet_ResizeIndex(WindowInvestigator_DirtySet* set, unsigned int bucketBits) {
+	WindowInvestigator_Free(set->buckets);
+	set->bucketBits = bucketBits;
+	const size_t bucketCount = WindowInvestigator_DirtySet_GetBucketCount(set);
+	set->buckets = WindowInvestigator_Reallocate(NULL, bucketCount, sizeof(*set->buckets));
+	for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+		set->buckets[bucket] = WindowInvestigator_DirtySet_NO_ENTRY;
+	for (size_t entry = 0; entry < set->entryCount; ++entry)
+		if (set->entries[entry].window != 0) WindowInvestigator_DirtySet_InsertIntoIndex(set, entry);
+}
+
+static size_t WindowInvestigator_DirtySet_Find(const WindowInvestigator_DirtySet* set, uintptr_t window) {
+	const size_t bucketMask = WindowInvestigator_DirtySet_GetBucketCount(set) - 1;
+	for (size_t bucket = WindowInvestigator_DirtySet_GetHomeBucket(set, window);; bucket = (bucket + 1) & bucketMask) {
+		const size_t entry = set->buckets[bucket];
+		if (entry == WindowInvestigator_DirtySet_NO_ENTRY || set->entries[entry].window == window) return entry;
+	}
+}
+
+static size_t WindowInvestigator_DirtySet_Insert(WindowInvestigator_DirtySet* set, uintptr_t window) {
+	if ((set->windowCount + 1) * 2 > WindowInvestigator_DirtySet_GetBucketCount(set))
+		WindowInvestigator_DirtySet_ResizeIndex(set, set->bucketBits + 1);
+
+	size_t entry = set->firstFreeEntry;
+	if (entry != WindowInvestigator_DirtySet_NO_ENTRY)
+		set->firstFreeEntry = set->entries[entry].nextFreeEntry;
+	else {
+		if (set->entryCount == set->entryCapacity) {
+			set->entryCapacity = set->entryCapacity == 0 ? 64 : 2 * set->entryCapacity;
+			set->entries = WindowInvestigator_Reallocate(set->entries, set->entryCapacity, sizeof(*set->entries));
+			set->dirtyEntries = WindowInvestigator_Reallocate(set->dirtyEntries, set->entryCapacity, sizeof(*set->dirtyEntries));
+		}
+		entry = set->entryCount++;
+	}
+	++set->windowCount;
+
+	WindowInvestigator_DirtyWindow* const dirtyWindow = &set->entries[entry];
+	memset(dirtyWindow, 0, sizeof(*dirtyWindow));
+	dirtyWindow->window = window;
+	dirtyWindow->dirtyIndex = WindowInvestigator_DirtySet_NO_ENTRY;
+	dirtyWindow->nextFreeEntry = WindowInvestigator_DirtySet_NO_ENTRY;
+	WindowInvestigator_DirtySet_InsertIntoIndex(set, entry);
+	return entry;
+}
+
+static void WindowInvestigator_DirtySet_RemoveFromIndex(WindowInvestigator_DirtySet* set, uintptr_t window) {
+	const size_t bucketMask = WindowInvestigator_DirtySet_GetBucketCount(set) - 1;
+	size_t bucket = WindowInvestigator_DirtySet_GetHomeBucket(set, window);
+	while (set->entries[set->buckets[bucket]].window != window)
+		bucket = (bucket + 1) & bucketMask;
+
+	// Backward shift deletion, as in WindowInvestigator_WindowTable.
+	size_t hole = bucket;
+	for (;;) {
+		bucket = (bucket + 1) & bucketMask;
+		const size_t entry = set->buckets[bucket];
+		if (entry == WindowInvestigator_DirtySet_NO_ENTRY) break;
+		const size_t homeBucket = WindowInvestigator_DirtySet_GetHomeBucket(set, set->entries[entry].window);
+		if (((bucket - homeBucket) & bucketMask) < ((bucket - hole) & bucketMask)) continue;
+		set->buckets[hole] = entry;
+		hole = bucket;
+	}
+	set->buckets[hole] = WindowInvestigator_DirtySet_NO_ENTRY;
+}
+
+// Does not touch the dirty list.
+static void WindowInvestigator_DirtySet_Remove(WindowInvestigator_DirtySet* set, size_t entry) {
+	WindowInvestigator_DirtySet_RemoveFromIndex(set, set->entries[entry].window);
+	set->entries[entry].window = 0;
+	set->entries[entry].nextFreeEntry = set->firstFreeEntry;
+	set->firstFreeEntry = entry;
+	--set->windowCount;
+}
+
+static void WindowInvestigator_DirtySet_SetDirty(WindowInvestigator_DirtySet* set, size_t entry, uint32_t fields, bool structural) {
+	WindowInvestigator_DirtyWindow* const dirtyWindow = &set->entries[entry];
+	if (dirtyWindow->dirtyIndex == WindowInvestigator_DirtySet_NO_ENTRY) {
+		dirtyWindow->dirtyIndex = set->dirtyCount;
+		set->dirtyEntries[set->dirtyCount++] = entry;
+	}
+	dirtyWindow->dirtyFields |= fields;
+	dirtyWindow->structural |= structural;
+}
+
+void WindowInvestigator_DirtySet_GetDefaultOptions(WindowInvestigator_DirtySetOptions* options) {
+	options->enumerationPeriod = 100;
+	options->sweepWindowsPerPass = 4;
+}
+
+void WindowInvestigator_DirtySet_Init(WindowInvestigator_DirtySet* set, const WindowInvestigator_DirtySetOptions* options) {
+	memset(set, 0, sizeof(*set));
+	set->options = *options;
+	set->firstFreeEntry = WindowInvestigator_DirtySet_NO_ENTRY;
+	WindowInvestigator_DirtySet_ResizeIndex(set, WindowInvestigator_DirtySet_initialBucketBits);
+}
+
+void WindowInvestigator_DirtySet_Destroy(WindowInvestigator_DirtySet* set) {
+	WindowInvestigator_Free(set->entries);
+	WindowInvestigator_Free(set->buckets);
+	WindowInvestigator_Free(set->dirtyEntries);
+	memset(set, 0, sizeof(*set));
+}
+
+void WindowInvestigator_DirtySet_Notify(WindowInvestigator_DirtySet* set, WindowInvestigator_WindowNotification notification, uintptr_t window, uint64_t timestamp) {
+	++set->statistics.notifications;
+	uint32_t fields = WindowInvestigator_WindowNotification_GetFields(notification);
+	// The last enumeration already saw the effect of any structural change that happened before it started.
+	bool structural = WindowInvestigator_WindowNotification_IsStructural(notification) && timestamp >= set->enumerationTime;
+
+	size_t entry = WindowInvestigator_DirtySet_Find(set, window);
+	if (entry != WindowInvestigator_DirtySet_NO_ENTRY) {
+		const WindowInvestigator_DirtyWindow* const dirtyWindow = &set->entries[entry];
+		if (dirtyWindow->readTime != 0 && timestamp < dirtyWindow->readTime) fields &= ~dirtyWindow->readFields;
+	}
+	if (fields == 0 && !structural) {
+		++set->statistics.staleNotifications;
+		return;
+	}
+
+	if (entry == WindowInvestigator_DirtySet_NO_ENTRY) entry = WindowInvestigator_DirtySet_Insert(set, window);
+	const WindowInvestigator_DirtyWindow* const dirtyWindow = &set->entries[entry];
+	if (dirtyWindow->dirtyIndex != WindowInvestigator_DirtySet_NO_ENTRY && (fields & ~dirtyWindow->dirtyFields) == 0 && (!structural || dirtyWindow->structural)) {
+		++set->statistics.duplicateNotifications;
+		return;
+	}
+	WindowInvestigator_DirtySet_SetDirty(set, entry, fields, structural);
+}
+
+void WindowInvestigator_DirtySet_MarkDirty(WindowInvestigator_DirtySet* set, uintptr_t window, uint32_t fields) {
+	size_t entry = WindowInvestigator_DirtySet_Find(set, window);
+	if (entry == WindowInvestigator_DirtySet_NO_ENTRY) entry = WindowInvestigator_DirtySet_Insert(set, window);
+	WindowInvestigator_DirtySet_SetDirty(set, entry, fields, false);
+}
+
+void WindowInvestigator_DirtySet_Forget(WindowInvestigator_DirtySet* set, uintptr_t window) {
+	const size_t entry = WindowInvestigator_DirtySet_Find(set, window);
+	if (entry == WindowInvestigator_DirtySet_NO_ENTRY) return;
+	const size_t dirtyIndex = set->entries[entry].dirtyIndex;
+	if (dirtyIndex != WindowInvestigator_DirtySet_NO_ENTRY) {
+		const size_t lastEntry = set->dirtyEntries[--set->dirtyCount];
+		set->dirtyEntries[dirtyIndex] = lastEntry;
+		set->entries[lastEntry].dirtyIndex = dirtyIndex;
+	}
+	WindowInvestigator_DirtySet_Remove(set, entry);
+}
+
+size_t WindowInvestigator_DirtySet_GetSweep(WindowInvestigator_DirtySet* set, size_t windowCount, size_t* first) {
+	*first = 0;
+	if (windowCount == 0) return 0;
+	const size_t count = set->options.sweepWindowsPerPass < windowCount ? set->options.sweepWindowsPerPass : windowCount;
+	*first = set->sweepCursor % windowCount;
+	set->sweepCursor = (*first + count) % windowCount;
+	set->statistics.sweptWindows += count;
+	return count;
+}
+
+bool WindowInvestigator_DirtySet_IsEnumerationDue(const WindowInvestigator_DirtySet* set) {
+	if (set->statistics.enumerations == 0) return true;
+	return set->options.enumerationPeriod != 0 && set->passesSinceEnumeration + 1 >= set->options.enumerationPeriod;
+}
+
+void WindowInvestigator_DirtySet_BeginPass(WindowInvestigator_DirtySet* set, uint64_t time, bool enumerate) {
+	++set->statistics.passes;
+	if (!enumerate) {
+		++set->passesSinceEnumeration;
+		return;
+	}
+	++set->statistics.enumerations;
+	set->passesSinceEnumeration = 0;
+	set->enumerationTime = time;
+}
+
+size_t WindowInvestigator_DirtySet_GetDirtyCount(const WindowInvestigator_DirtySet* set) {
+	return set->dirtyCount;
+}
+
+const WindowInvestigator_DirtyWindow* WindowInvestigator_DirtySet_GetDirtyWindow(const WindowInvestigator_DirtySet* set, size_t index) {
+	return &set->entries[set->dirtyEntries[index]];
+}
+
+uint32_t WindowInvestigator_DirtySet_Take(WindowInvestigator_DirtySet* set, uintptr_t window) {
+	const size_t entry = WindowInvestigator_DirtySet_Find(set, window);
+	if (entry == WindowInvestigator_DirtySet_NO_ENTRY || set->entries[entry].dirtyIndex == WindowInvestigator_DirtySet_NO_ENTRY) return 0;
+	return WindowInvestigator_DirtySet_TakeAt(set, set->entries[entry].dirtyIndex);
+}
+
+uint32_t WindowInvestigator_DirtySet_TakeAt(WindowInvestigator_DirtySet* set, size_t index) {
+	WindowInvestigator_DirtyWindow* const dirtyWindow = &set->entries[set->dirtyEntries[index]];
+	dirtyWindow->taken = true;
+	return dirtyWindow->dirtyFields;
+}
+
+void WindowInvestigator_DirtySet_EndPass(WindowInvestigator_DirtySet* set, uint64_t time) {
+	for (size_t index = 0; index < set->dirtyCount; ++index) {
+		const size_t entry = set->dirtyEntries[index];
+		WindowInvestigator_DirtyWindow* const dirtyWindow = &set->entries[entry];
+		if (!dirtyWindow->taken) {
+			++set->statistics.discardedWindows;
+			WindowInvestigator_DirtySet_Remove(set, entry);
+			continue;
+		}
+		dirtyWindow->readFields = dirtyWindow->dirtyFields;
+		dirtyWindow->readTime = time;
+		dirtyWindow->dirtyFields = 0;
+		dirtyWindow->structural = false;
+		dirtyWindow->taken = false;
+		dirtyWindow->dirtyIndex = WindowInvestigator_DirtySet_NO_ENTRY;
+	}
+	set->dirtyCount = 0;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps track of the windows that changed since they were last read, based on change notifications (e.g. WinEvents on
+// Windows), so that the monitor only needs to re-read those instead of every window on every tick.
+//
+// Notifications cannot be relied upon entirely: they can be dropped (e.g. WinEvents are skipped when the hook thread falls
+// behind), delivered late or out of order, and some changes do not come with any notification at all. To make up for that,
+// a reconciliation policy still enumerates every window every so often, and sweeps through the Z-order a few windows at a
+// time, re-reading them in full regardless of notifications.
+//
+// Each notification is mapped to the window fields it can affect. Notifications are deduplicated: a window that is already
+// dirty only gets the new fields added, and a notification that happened before the window was last read (i.e. one that
+// was delivered late) is dropped if that read covered its fields. Notifications that can affect the Z-order or the set of
+// visible windows are "structural": they make the monitor enumerate windows again, unless they are about a window that is
+// neither tracked nor visible.
+//
+// Timestamps are opaque, as long as notifications and passes use the same clock (see WindowInvestigator_GetTimeNanoseconds()).
+//
+// A pass goes: WindowInvestigator_DirtySet_GetSweep() and WindowInvestigator_DirtySet_MarkDirty() for the windows to sweep,
+// then WindowInvestigator_DirtySet_BeginPass() once the caller has decided whether to enumerate (see
+// WindowInvestigator_DirtySet_IsEnumerationDue()), then WindowInvestigator_DirtySet_Take() or
+// WindowInvestigator_DirtySet_TakeAt() for every dirty window that is read, then WindowInvestigator_DirtySet_EndPass().
+// Windows that are still dirty at that point are not tracked, and are forgotten.
+
+#define WindowInvestigator_DirtySet_NO_ENTRY SIZE_MAX
+
+typedef enum {
+	// The window was created or destroyed.
+	WindowInvestigator_WindowNotification_CREATE,
+	WindowInvestigator_WindowNotification_DESTROY,
+	// The window was shown or hidden.
+	WindowInvestigator_WindowNotification_SHOW,
+	WindowInvestigator_WindowNotification_HIDE,
+	// The window moved in the Z-order, e.g. it was brought to the foreground or made topmost.
+	WindowInvestigator_WindowNotification_REORDER,
+	// The window was moved or resized, including by being minimized, maximized or restored.
+	WindowInvestigator_WindowNotification_LOCATION,
+	// The window text changed.
+	WindowInvestigator_WindowNotification_NAME,
+	// The window styles changed.
+	WindowInvestigator_WindowNotification_STATE,
+	// The window was cloaked or uncloaked.
+	WindowInvestigator_WindowNotification_CLOAK,
+	WindowInvestigator_WindowNotification_COUNT,
+} WindowInvestigator_WindowNotification;
+
+const char* WindowInvestigator_WindowNotification_GetName(WindowInvestigator_WindowNotification notification);
+// Returns the fields (bitmask of WindowInvestigator_WindowField_BIT()) that the notification can affect.
+uint32_t WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification notification);
+bool WindowInvestigator_WindowNotification_IsStructural(WindowInvestigator_WindowNotification notification);
+
+typedef struct {
+	// Windows are enumerated at least once every this many passes, even if no structural notification came in. 0 means only
+	// when notified.
+	uint64_t enumerationPeriod;
+	// Number of windows that are re-read in full on every pass regardless of notifications, going through the Z-order in
+	// turn.
+	size_t sweepWindowsPerPass;
+} WindowInvestigator_DirtySetOptions;
+
+typedef struct {
+	uint64_t notifications;
+	// Notifications about a window that was already dirty for the same fields.
+	uint64_t duplicateNotifications;
+	// Notifications that happened before the window was last read (or enumerated, if structural), and were dropped.
+	uint64_t staleNotifications;
+	uint64_t passes;
+	// Passes that enumerated windows; the others only read the dirty windows.
+	uint64_t enumerations;
+	// Windows marked dirty by the sweep.
+	uint64_t sweptWindows;
+	// Dirty windows that were forgotten at the end of a pass because the caller did not read them.
+	uint64_t discardedWindows;
+} WindowInvestigator_DirtySetStatistics;
+
+typedef struct {
+	uintptr_t window;
+	// Fields that need to be read, as a bitmask of WindowInvestigator_WindowField_BIT().
+	uint32_t dirtyFields;
+	bool structural;
+	bool taken;
+	// Fields that were read by the last pass that read the window, and when that pass started. 0 if never read.
+	uint32_t readFields;
+	uint64_t readTime;
+	// Index in the dirty list, or WindowInvestigator_DirtySet_NO_ENTRY if the window is clean.
+	size_t dirtyIndex;
+	size_t nextFreeEntry;
+} WindowInvestigator_DirtyWindow;
+
+typedef struct {
+	WindowInvestigator_DirtySetOptions options;
+
+	WindowInvestigator_DirtyWindow* entries;
+	size_t entryCount;
+	size_t entryCapacity;
+	size_t firstFreeEntry;
+	size_t windowCount;
+
+	// Linear probing, same as WindowInvestigator_WindowTable. Each bucket holds an entry index, or
+	// WindowInvestigator_DirtySet_NO_ENTRY if empty.
+	size_t* buckets;
+	unsigned int bucketBits;
+
+	// Entry indices of the dirty windows.
+	size_t* dirtyEntries;
+	size_t dirtyCount;
+
+	// Start of the last pass that enumerated windows, or 0 if none did yet.
+	uint64_t enumerationTime;
+	uint64_t passesSinceEnumeration;
+	size_t sweepCursor;
+
+	WindowInvestigator_DirtySetStatistics statistics;
+} WindowInvestigator_DirtySet;
+
+// Enumerates every 100 passes, and sweeps 4 windows per pass.
+void WindowInvestigator_DirtySet_GetDefaultOptions(WindowInvestigator_DirtySetOptions* options);
+
+void WindowInvestigator_DirtySet_Init(WindowInvestigator_DirtySet* set, const WindowInvestigator_DirtySetOptions* options);
+void WindowInvestigator_DirtySet_Destroy(WindowInvestigator_DirtySet* set);
+
+// timestamp is when the change happened, which can be earlier than when the notification is delivered.
+void WindowInvestigator_DirtySet_Notify(WindowInvestigator_DirtySet* set, WindowInvestigator_WindowNotification notification, uintptr_t window, uint64_t timestamp);
+// Makes the window dirty for the specified fields regardless of when it was last read. Does not count as a notification.
+void WindowInvestigator_DirtySet_MarkDirty(WindowInvestigator_DirtySet* set, uintptr_t window, uint32_t fields);
+// Forgets everything about the window, e.g. because it is gone.
+void WindowInvestigator_DirtySet_Forget(WindowInvestigator_DirtySet* set, uintptr_t window);
+
+// Returns the range of Z-order indices to sweep on this pass, among windowCount windows. The range wraps around: windows
+// (*first + index) % windowCount for index < the returned count.
+size_t WindowInvestigator_DirtySet_GetSweep(WindowInvestigator_DirtySet* set, size_t windowCount, size_t* first);
+// Whether the reconciliation policy requires this pass to enumerate windows. The caller can decide to enumerate anyway, e.g.
+// because of a structural notification.
+bool WindowInvestigator_DirtySet_IsEnumerationDue(const WindowInvestigator_DirtySet* set);
+void WindowInvestigator_DirtySet_BeginPass(WindowInvestigator_DirtySet* set, uint64_t time, bool enumerate);
+
+size_t WindowInvestigator_DirtySet_GetDirtyCount(const WindowInvestigator_DirtySet* set);
+// index is less than WindowInvestigator_DirtySet_GetDirtyCount(). The dirty list does not change until
+// WindowInvestigator_DirtySet_EndPass(), except that notifications append to it, and
+// WindowInvestigator_DirtySet_Forget() can move the last window in place of the one it removes.
+const WindowInvestigator_DirtyWindow* WindowInvestigator_DirtySet_GetDirtyWindow(const WindowInvestigator_DirtySet* set, size_t index);
+// Marks the window as read during this pass, and returns the fields to read. Returns 0 if the window is not dirty.
+uint32_t WindowInvestigator_DirtySet_Take(WindowInvestigator_DirtySet* set, uintptr_t window);
+uint32_t WindowInvestigator_DirtySet_TakeAt(WindowInvestigator_DirtySet* set, size_t index);
+// time is the same as for WindowInvestigator_DirtySet_BeginPass(). No notification can come in between the two, as it would
+// be cleared along with the windows that were taken; the windows themselves can be read later, since everything that
+// happens after time is treated as a new change.
+void WindowInvestigator_DirtySet_EndPass(WindowInvestigator_DirtySet* set, uint64_t time);
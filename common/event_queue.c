@@ -0,0 +1,347 @@
+#include "event_queue.h"
+
+#include "allocation.h"
+#include "atomic.h"
+#include "clock.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+static void WindowInvestigator_EventQueue_Emit(WindowInvestigator_EventQueue* queue, const WindowInvestigator_MonitorEvent* event) {
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	queue->onEvent(queue->context, event);
+	WindowInvestigator_Histogram_RecordConcurrent(queue->emissionDurations, WindowInvestigator_GetTimeNanoseconds() - startTime);
+}
+
+// Reports the events that were dropped since the last report, if any, so that readers know that the events that follow do not
+// tell the whole story.
+static void WindowInvestigator_EventQueue_ReportDroppedEvents(WindowInvestigator_EventQueue* queue, uint64_t droppedCount, uint64_t timestamp) {
+	if (droppedCount == queue->reportedDroppedCount) return;
+	queue->reportedDroppedCount = droppedCount;
+	WindowInvestigator_MonitorEvent* const event = queue->droppedEvent;
+	event->timestamp = timestamp;
+	event->droppedCount = droppedCount;
+	for (int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		event->record[byteIndex] = (unsigned char)(droppedCount >> (8 * byteIndex));
+	WindowInvestigator_EventQueue_Emit(queue, event);
+}
+
+static void WindowInvestigator_EventQueue_Write(void* context) {
+	WindowInvestigator_EventQueue* const queue = context;
+	uint64_t lastTimestamp = 0;
+	for (;;) {
+		// Read before draining, so that events queued before Destroy() are not missed.
+		const bool stopping = WindowInvestigator_Atomic_LoadAcquire(&queue->stopping) != 0;
+		for (;;) {
+			const WindowInvestigator_MonitorEvent* const event = WindowInvestigator_RecordRing_BeginRead(&queue->ring);
+			if (event == NULL) break;
+			// The events were dropped right before this one.
+			WindowInvestigator_EventQueue_ReportDroppedEvents(queue, event->droppedCount, event->timestamp);
+			WindowInvestigator_EventQueue_Emit(queue, event);
+			lastTimestamp = event->timestamp;
+			WindowInvestigator_RecordRing_EndRead(&queue->ring);
+		}
+		if (stopping) {
+			// Nothing is queued anymore, so these were dropped after the last event.
+			WindowInvestigator_EventQueue_ReportDroppedEvents(queue, WindowInvestigator_RecordRing_GetDroppedCount(&queue->ring), lastTimestamp);
+			return;
+		}
+		WindowInvestigator_SleepNanoseconds(WindowInvestigator_EventQueue_IDLE_NANOSECONDS);
+	}
+}
+
+void WindowInvestigator_EventQueue_Init(WindowInvestigator_EventQueue* queue, size_t capacity, const WindowInvestigator_StringPool* strings, WindowInvestigator_EventQueue_OnEvent onEvent, void* context) {
+	queue->strings = strings;
+	queue->onEvent = onEvent;
+	queue->context = context;
+	queue->stopping = 0;
+	queue->getTimestamp = NULL;
+	queue->getTimestampContext = NULL;
+	queue->emissionDurations = WindowInvestigator_Reallocate(NULL, 1, sizeof(*queue->emissionDurations));
+	WindowInvestigator_Histogram_Reset(queue->emissionDurations);
+	if (capacity == 0) {
+		queue->synchronousEvent = WindowInvestigator_Reallocate(NULL, 1, sizeof(*queue->synchronousEvent));
+		queue->droppedEvent = NULL;
+		return;
+	}
+	queue->synchronousEvent = NULL;
+	queue->droppedEvent = WindowInvestigator_Reallocate(NULL, 1, sizeof(*queue->droppedEvent));
+	queue->droppedEvent->window = 0;
+	queue->droppedEvent->type = WindowInvestigator_MonitorEvent_EVENTS_DROPPED;
+	queue->droppedEvent->zOrder = 0;
+	queue->droppedEvent->previousZOrder = 0;
+	queue->droppedEvent->fields = 0;
+	queue->droppedEvent->recordSize = WindowInvestigator_EventsDropped_RECORD_SIZE;
+	queue->reportedDroppedCount = 0;
+	WindowInvestigator_RecordRing_Init(&queue->ring, sizeof(WindowInvestigator_MonitorEvent), capacity);
+	WindowInvestigator_Thread_Start(&queue->writer, WindowInvestigator_EventQueue_Write, queue);
+}
+
+void WindowInvestigator_EventQueue_Destroy(WindowInvestigator_EventQueue* queue) {
+	if (queue->synchronousEvent != NULL) WindowInvestigator_Free(queue->synchronousEvent);
+	else {
+		WindowInvestigator_Atomic_StoreRelease(&queue->stopping, 1);
+		WindowInvestigator_Thread_Join(&queue->writer);
+		WindowInvestigator_RecordRing_Destroy(&queue->ring);
+		WindowInvestigator_Free(queue->droppedEvent);
+	}
+	WindowInvestigator_Free(queue->emissionDurations);
+}
+
+void WindowInvestigator_EventQueue_SetClock(WindowInvestigator_EventQueue* queue, uint64_t (*getTimestamp)(void* context), void* context) {
+	queue->getTimestamp = getTimestamp;
+	queue->getTimestampContext = context;
+}
+
+// Returns NULL if the event has to be dropped.
+static WindowInvestigator_MonitorEvent* WindowInvestigator_EventQueue_BeginEvent(WindowInvestigator_EventQueue* queue, WindowInvestigator_MonitorEventType type, uintptr_t window) {
+	WindowInvestigator_MonitorEvent* event;
+	if (queue->synchronousEvent != NULL) {
+		queue->synchronousEvent->droppedCount = 0;
+		event = queue->synchronousEvent;
+	}
+	else {
+		// Read first, so that it does not count this event if it gets dropped.
+		const uint64_t droppedCount = WindowInvestigator_RecordRing_GetDroppedCount(&queue->ring);
+		event = WindowInvestigator_RecordRing_BeginWrite(&queue->ring);
+		if (event == NULL) return NULL;
+		event->droppedCount = droppedCount;
+	}
+	event->timestamp = queue->getTimestamp != NULL ? queue->getTimestamp(queue->getTimestampContext) : WindowInvestigator_GetTimeNanoseconds();
+	event->window = window;
+	event->type = type;
+	event->zOrder = 0;
+	event->previousZOrder = 0;
+	event->fields = 0;
+	event->recordSize = 0;
+	return event;
+}
+
+static void WindowInvestigator_EventQueue_EncodeRecord(WindowInvestigator_EventQueue* queue, WindowInvestigator_MonitorEvent* event, uint32_t fields, const WindowInvestigator_WindowInfo* windowInfo) {
+	event->fields = fields;
+	event->recordSize = (uint32_t)WindowInvestigator_EncodeWindowRecord(event->record, fields, windowInfo, queue->strings);
+}
+
+static void WindowInvestigator_EventQueue_EndEvent(WindowInvestigator_EventQueue* queue) {
+	if (queue->synchronousEvent != NULL) WindowInvestigator_EventQueue_Emit(queue, queue->synchronousEvent);
+	else WindowInvestigator_RecordRing_EndWrite(&queue->ring);
+}
+
+void WindowInvestigator_EventQueue_PushNewWindow(WindowInvestigator_EventQueue* queue, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_NEW_WINDOW, window);
+	if (event == NULL) return;
+	event->zOrder = (uint32_t)zOrder;
+	WindowInvestigator_EventQueue_EncodeRecord(queue, event, WindowInvestigator_WindowField_ALL, windowInfo);
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushWindowChanged(WindowInvestigator_EventQueue* queue, uintptr_t window, uint32_t changedFields, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	if (changedFields == 0) return;
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_WINDOW_CHANGED, window);
+	if (event == NULL) return;
+	WindowInvestigator_EventQueue_EncodeRecord(queue, event, changedFields, newWindowInfo);
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushWindowZOrderChanged(WindowInvestigator_EventQueue* queue, uintptr_t window, size_t previousZOrder, size_t zOrder) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED, window);
+	if (event == NULL) return;
+	event->previousZOrder = (uint32_t)previousZOrder;
+	event->zOrder = (uint32_t)zOrder;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushWindowGone(WindowInvestigator_EventQueue* queue, uintptr_t window) {
+	if (WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_WINDOW_GONE, window) == NULL) return;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushZOrderUpdated(WindowInvestigator_EventQueue* queue, size_t windowCount) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_ZORDER_UPDATED, 0);
+	if (event == NULL) return;
+	event->zOrder = (uint32_t)windowCount;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushTickFinished(WindowInvestigator_EventQueue* queue) {
+	if (WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_TICK_FINISHED, 0) == NULL) return;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushKeyframe(WindowInvestigator_EventQueue* queue, size_t windowCount) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_KEYFRAME, 0);
+	if (event == NULL) return;
+	event->zOrder = (uint32_t)windowCount;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushWindowSnapshot(WindowInvestigator_EventQueue* queue, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT, window);
+	if (event == NULL) return;
+	event->zOrder = (uint32_t)zOrder;
+	WindowInvestigator_EventQueue_EncodeRecord(queue, event, WindowInvestigator_WindowField_ALL, windowInfo);
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushReceivedMessage(WindowInvestigator_EventQueue* queue, WindowInvestigator_ReceivedMessageKind kind, uint32_t message, uint64_t wParam, uint64_t lParam) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE, 0);
+	if (event == NULL) return;
+	event->zOrder = message;
+	event->previousZOrder = (uint32_t)kind;
+	for (int byteIndex = 0; byteIndex < 8; ++byteIndex) {
+		event->record[byteIndex] = (unsigned char)(wParam >> (8 * byteIndex));
+		event->record[8 + byteIndex] = (unsigned char)(lParam >> (8 * byteIndex));
+	}
+	event->recordSize = WindowInvestigator_ReceivedMessage_RECORD_SIZE;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+void WindowInvestigator_EventQueue_PushRudeWindowChanged(WindowInvestigator_EventQueue* queue, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window) {
+	WindowInvestigator_MonitorEvent* const event = WindowInvestigator_EventQueue_BeginEvent(queue, WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED, window);
+	if (event == NULL) return;
+	event->zOrder = (uint32_t)monitor;
+	const uint32_t coordinates[] = { (uint32_t)monitorRect->left, (uint32_t)monitorRect->top, (uint32_t)monitorRect->right, (uint32_t)monitorRect->bottom };
+	for (int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		event->record[byteIndex] = (unsigned char)((uint64_t)previousWindow >> (8 * byteIndex));
+	for (int coordinateIndex = 0; coordinateIndex < 4; ++coordinateIndex)
+		for (int byteIndex = 0; byteIndex < 4; ++byteIndex)
+			event->record[8 + 4 * coordinateIndex + byteIndex] = (unsigned char)(coordinates[coordinateIndex] >> (8 * byteIndex));
+	event->recordSize = WindowInvestigator_RudeWindowChanged_RECORD_SIZE;
+	WindowInvestigator_EventQueue_EndEvent(queue);
+}
+
+const char* WindowInvestigator_MonitorEventType_GetName(WindowInvestigator_MonitorEventType type) {
+	switch (type) {
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW: return "NewWindow";
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED: return "WindowChanged";
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED: return "WindowZOrderChanged";
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE: return "WindowGone";
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT: return "WindowSnapshot";
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED: return "ZOrderUpdated";
+	case WindowInvestigator_MonitorEvent_KEYFRAME: return "Keyframe";
+	case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE: return "ReceivedMessage";
+	case WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED: return "RudeWindowChanged";
+	case WindowInvestigator_MonitorEvent_EVENTS_DROPPED: return "EventsDropped";
+	case WindowInvestigator_MonitorEvent_TICK_FINISHED: return "TickFinished";
+	}
+	return "Unknown";
+}
+
+const char* WindowInvestigator_ReceivedMessageKind_GetName(WindowInvestigator_ReceivedMessageKind kind) {
+	switch (kind) {
+	case WindowInvestigator_ReceivedMessage_SHELL_HOOK: return "ShellHook";
+	case WindowInvestigator_ReceivedMessage_APPBAR: return "Appbar";
+	case WindowInvestigator_ReceivedMessage_COUNT: break;
+	}
+	return "Unknown";
+}
+
+bool WindowInvestigator_DecodeReceivedMessage(const unsigned char* record, size_t recordSize, uint64_t* wParam, uint64_t* lParam) {
+	if (recordSize != WindowInvestigator_ReceivedMessage_RECORD_SIZE) return false;
+	*wParam = *lParam = 0;
+	for (int byteIndex = 0; byteIndex < 8; ++byteIndex) {
+		*wParam |= (uint64_t)record[byteIndex] << (8 * byteIndex);
+		*lParam |= (uint64_t)record[8 + byteIndex] << (8 * byteIndex);
+	}
+	return true;
+}
+
+bool WindowInvestigator_DecodeRudeWindowChanged(const unsigned char* record, size_t recordSize, uint64_t* previousWindow, WindowInvestigator_Rect* monitorRect) {
+	if (recordSize != WindowInvestigator_RudeWindowChanged_RECORD_SIZE) return false;
+	*previousWindow = 0;
+	for (int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		*previousWindow |= (uint64_t)record[byteIndex] << (8 * byteIndex);
+	uint32_t coordinates[4] = { 0 };
+	for (int coordinateIndex = 0; coordinateIndex < 4; ++coordinateIndex)
+		for (int byteIndex = 0; byteIndex < 4; ++byteIndex)
+			coordinates[coordinateIndex] |= (uint32_t)record[8 + 4 * coordinateIndex + byteIndex] << (8 * byteIndex);
+	monitorRect->left = (int32_t)coordinates[0];
+	monitorRect->top = (int32_t)coordinates[1];
+	monitorRect->right = (int32_t)coordinates[2];
+	monitorRect->bottom = (int32_t)coordinates[3];
+	return true;
+}
+
+bool WindowInvestigator_DecodeEventsDropped(const unsigned char* record, size_t recordSize, uint64_t* droppedCount) {
+	if (recordSize != WindowInvestigator_EventsDropped_RECORD_SIZE) return false;
+	*droppedCount = 0;
+	for (int byteIndex = 0; byteIndex < 8; ++byteIndex)
+		*droppedCount |= (uint64_t)record[byteIndex] << (8 * byteIndex);
+	return true;
+}
+
+void WindowInvestigator_EventQueue_Flush(WindowInvestigator_EventQueue* queue) {
+	if (queue->synchronousEvent != NULL) return;
+	while (WindowInvestigator_RecordRing_GetCount(&queue->ring) != 0)
+		WindowInvestigator_SleepNanoseconds(WindowInvestigator_EventQueue_IDLE_NANOSECONDS);
+}
+
+static void WindowInvestigator_EventQueue_OnNewWindow(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_EventQueue_PushNewWindow(context, window, zOrder, windowInfo);
+}
+
+static void WindowInvestigator_EventQueue_OnWindowChanged(void* context, uintptr_t window, uint32_t changedFields, const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	(void)oldWindowInfo;
+	WindowInvestigator_EventQueue_PushWindowChanged(context, window, changedFields, newWindowInfo);
+}
+
+static void WindowInvestigator_EventQueue_OnWindowZOrderChanged(void* context, uintptr_t window, size_t previousZOrder, size_t zOrder) {
+	WindowInvestigator_EventQueue_PushWindowZOrderChanged(context, window, previousZOrder, zOrder);
+}
+
+static void WindowInvestigator_EventQueue_OnWindowGone(void* context, uintptr_t window) {
+	WindowInvestigator_EventQueue_PushWindowGone(context, window);
+}
+
+static void WindowInvestigator_EventQueue_OnZOrderUpdated(void* context, size_t windowCount) {
+	WindowInvestigator_EventQueue_PushZOrderUpdated(context, windowCount);
+}
+
+static void WindowInvestigator_EventQueue_OnTickFinished(void* context) {
+	WindowInvestigator_EventQueue_PushTickFinished(context);
+}
+
+static void WindowInvestigator_EventQueue_OnLogWindowsBegin(void* context, size_t windowCount) {
+	WindowInvestigator_EventQueue_PushKeyframe(context, windowCount);
+}
+
+static void WindowInvestigator_EventQueue_OnLogWindow(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_EventQueue_PushWindowSnapshot(context, window, zOrder, windowInfo);
+}
+
+void WindowInvestigator_EventQueue_GetSink(WindowInvestigator_EventQueue* queue, WindowInvestigator_MonitorSink* sink) {
+	sink->onNewWindow = WindowInvestigator_EventQueue_OnNewWindow;
+	sink->onWindowChanged = WindowInvestigator_EventQueue_OnWindowChanged;
+	sink->onWindowZOrderChanged = WindowInvestigator_EventQueue_OnWindowZOrderChanged;
+	sink->onWindowGone = WindowInvestigator_EventQueue_OnWindowGone;
+	sink->onZOrderUpdated = WindowInvestigator_EventQueue_OnZOrderUpdated;
+	sink->onTickFinished = WindowInvestigator_EventQueue_OnTickFinished;
+	sink->onLogWindowsBegin = WindowInvestigator_EventQueue_OnLogWindowsBegin;
+	sink->onLogWindow = WindowInvestigator_EventQueue_OnLogWindow;
+	sink->context = queue;
+}
+
+static void WindowInvestigator_EventQueue_OnRudeWindowChanged(void* context, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window) {
+	WindowInvestigator_EventQueue_PushRudeWindowChanged(context, monitor, monitorRect, previousWindow, window);
+}
+
+void WindowInvestigator_EventQueue_GetRudeWindowSink(WindowInvestigator_EventQueue* queue, WindowInvestigator_RudeWindowSink* sink) {
+	sink->onRudeWindowChanged = WindowInvestigator_EventQueue_OnRudeWindowChanged;
+	sink->context = queue;
+}
+
+uint64_t WindowInvestigator_EventQueue_GetHighWaterMark(const WindowInvestigator_EventQueue* queue) {
+	return queue->synchronousEvent != NULL ? 0 : WindowInvestigator_RecordRing_GetHighWaterMark(&queue->ring);
+}
+
+uint64_t WindowInvestigator_EventQueue_GetDroppedCount(const WindowInvestigator_EventQueue* queue) {
+	return queue->synchronousEvent != NULL ? 0 : WindowInvestigator_RecordRing_GetDroppedCount(&queue->ring);
+}
+
+void WindowInvestigator_EventQueue_GetEmissionDurations(const WindowInvestigator_EventQueue* queue, WindowInvestigator_Histogram* histogram) {
+	WindowInvestigator_Histogram_Merge(histogram, queue->emissionDurations);
+}
+
+void WindowInvestigator_EventQueue_ResetEmissionDurations(WindowInvestigator_EventQueue* queue) {
+	WindowInvestigator_Histogram_Reset(queue->emissionDurations);
+}
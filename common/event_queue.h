@@ -0,0 +1,169 @@
+#pragma once
+
+#include "histogram.h"
+#include "monitor.h"
+#include "record_ring.h"
+#include "rude_window.h"
+#include "string_pool.h"
+#include "thread.h"
+#include "window_info.h"
+#include "window_record.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Takes event emission off the thread that drives the monitor.
+//
+// Events are turned into self-contained, fixed-size records (strings included) on the monitor thread, and queued in a
+// lock-free ring buffer. A dedicated writer thread drains the ring and hands the events over to the actual output (e.g.
+// ETW). This way, a stall in the output does not delay the next tick; if the writer falls too far behind, events are
+// dropped instead, and counted as such.
+//
+// Because events are emitted some time after they happened, each event carries its own timestamp.
+
+typedef enum {
+	WindowInvestigator_MonitorEvent_NEW_WINDOW,
+	WindowInvestigator_MonitorEvent_WINDOW_CHANGED,
+	WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED,
+	WindowInvestigator_MonitorEvent_WINDOW_GONE,
+	WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT,
+	// See WindowInvestigator_MonitorSink::onZOrderUpdated. Not associated with a window.
+	WindowInvestigator_MonitorEvent_ZORDER_UPDATED,
+	// Start of a full snapshot of every window (a keyframe), which consists of the WINDOW_SNAPSHOT events that immediately
+	// follow. Not associated with a window.
+	WindowInvestigator_MonitorEvent_KEYFRAME,
+	// A message received by WindowMonitor, e.g. a shell hook message. Not associated with a window. Logged so that window
+	// changes can be put in context (e.g. on a timeline) without having to correlate with another trace.
+	WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE,
+	// The rude window of a display monitor changed (see rude_window.h). The window is the new rude window, or 0 if the monitor
+	// is not rude anymore.
+	WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED,
+	// Events were dropped because the writer thread was too far behind (see WindowInvestigator_EventQueue). Written by the
+	// writer thread right before the first event that was queued after them, or when the queue is destroyed. Until the next
+	// complete keyframe, the state rebuilt from the events that follow is uncertain. Not associated with a window.
+	WindowInvestigator_MonitorEvent_EVENTS_DROPPED,
+	// See WindowInvestigator_MonitorSink::onTickFinished. Not associated with a window.
+	WindowInvestigator_MonitorEvent_TICK_FINISHED,
+} WindowInvestigator_MonitorEventType;
+
+// Same names as the WindowMonitor ETW events, e.g. "WindowChanged".
+const char* WindowInvestigator_MonitorEventType_GetName(WindowInvestigator_MonitorEventType type);
+
+// Which registration a received message comes from. The message identifier alone is not enough to tell, as the shell hook
+// message identifier is only known at runtime.
+typedef enum {
+	WindowInvestigator_ReceivedMessage_SHELL_HOOK,
+	WindowInvestigator_ReceivedMessage_APPBAR,
+	WindowInvestigator_ReceivedMessage_COUNT,
+} WindowInvestigator_ReceivedMessageKind;
+
+const char* WindowInvestigator_ReceivedMessageKind_GetName(WindowInvestigator_ReceivedMessageKind kind);
+
+// The record of a RECEIVED_MESSAGE event holds the message parameters: wParam then lParam, as little-endian uint64.
+#define WindowInvestigator_ReceivedMessage_RECORD_SIZE (2 * 8)
+
+// The record of a RUDE_WINDOW_CHANGED event holds the previous rude window of the monitor (uint64), then the monitor rect
+// (left, top, right, bottom, as int32), all little-endian.
+#define WindowInvestigator_RudeWindowChanged_RECORD_SIZE (8 + 4 * 4)
+
+// The record of an EVENTS_DROPPED event holds the number of events dropped since the queue was created (not since the previous
+// EVENTS_DROPPED event), as a little-endian uint64.
+#define WindowInvestigator_EventsDropped_RECORD_SIZE 8
+
+typedef struct {
+	// WindowInvestigator_GetTimeNanoseconds() when the event was queued, unless the queue has its own clock (see
+	// WindowInvestigator_EventQueue_SetClock()).
+	uint64_t timestamp;
+	uint64_t window;
+	WindowInvestigator_MonitorEventType type;
+	// NEW_WINDOW, WINDOW_ZORDER_CHANGED and WINDOW_SNAPSHOT: Z-order index of the window.
+	// ZORDER_UPDATED and KEYFRAME: number of windows.
+	// RECEIVED_MESSAGE: message identifier.
+	// RUDE_WINDOW_CHANGED: monitor index.
+	uint32_t zOrder;
+	// WINDOW_ZORDER_CHANGED: previous Z-order index of the window.
+	// RECEIVED_MESSAGE: WindowInvestigator_ReceivedMessageKind.
+	uint32_t previousZOrder;
+	// Fields in the record (see window_record.h): all fields for NEW_WINDOW and WINDOW_SNAPSHOT, the fields that changed for
+	// WINDOW_CHANGED, none otherwise.
+	uint32_t fields;
+	uint32_t recordSize;
+	// Number of events that had been dropped when this one was queued. Lets the writer thread tell exactly where events went
+	// missing. Not written out.
+	uint64_t droppedCount;
+	unsigned char record[WindowInvestigator_WindowRecord_MAX_SIZE];
+} WindowInvestigator_MonitorEvent;
+
+// Called on the writer thread, in the order the events were queued.
+typedef void (*WindowInvestigator_EventQueue_OnEvent)(void* context, const WindowInvestigator_MonitorEvent* event);
+
+// How long the writer thread sleeps when there is nothing left to write.
+#define WindowInvestigator_EventQueue_IDLE_NANOSECONDS 1000000
+
+typedef struct {
+	WindowInvestigator_RecordRing ring;
+	const WindowInvestigator_StringPool* strings;
+	WindowInvestigator_EventQueue_OnEvent onEvent;
+	void* context;
+	WindowInvestigator_Thread writer;
+	volatile uint64_t stopping;
+	// Only used if there is no writer thread.
+	WindowInvestigator_MonitorEvent* synchronousEvent;
+	// Only used by the writer thread: the EVENTS_DROPPED event, and the number of dropped events it last reported.
+	WindowInvestigator_MonitorEvent* droppedEvent;
+	uint64_t reportedDroppedCount;
+	// NULL to use WindowInvestigator_GetTimeNanoseconds().
+	uint64_t (*getTimestamp)(void* context);
+	void* getTimestampContext;
+	// Updated by the writer thread, read from any thread.
+	WindowInvestigator_Histogram* emissionDurations;
+} WindowInvestigator_EventQueue;
+
+// The queue can hold up to capacity events. If capacity is 0, there is no ring nor writer thread: events are passed to onEvent
+// right away, on the thread that queues them.
+//
+// String IDs in the window snapshots refer to strings, which does not need to be initialized yet.
+void WindowInvestigator_EventQueue_Init(WindowInvestigator_EventQueue* queue, size_t capacity, const WindowInvestigator_StringPool* strings, WindowInvestigator_EventQueue_OnEvent onEvent, void* context);
+// Writes the remaining events, then stops the writer thread.
+void WindowInvestigator_EventQueue_Destroy(WindowInvestigator_EventQueue* queue);
+// Makes events carry the time returned by getTimestamp, called on the thread that queues them, instead of the current time,
+// e.g. so that replayed events keep the timestamps of the capture they come from.
+void WindowInvestigator_EventQueue_SetClock(WindowInvestigator_EventQueue* queue, uint64_t (*getTimestamp)(void* context), void* context);
+
+// These must all be called from the same thread. changedFields can be 0, in which case nothing is queued.
+void WindowInvestigator_EventQueue_PushNewWindow(WindowInvestigator_EventQueue* queue, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo);
+void WindowInvestigator_EventQueue_PushWindowChanged(WindowInvestigator_EventQueue* queue, uintptr_t window, uint32_t changedFields, const WindowInvestigator_WindowInfo* newWindowInfo);
+void WindowInvestigator_EventQueue_PushWindowZOrderChanged(WindowInvestigator_EventQueue* queue, uintptr_t window, size_t previousZOrder, size_t zOrder);
+void WindowInvestigator_EventQueue_PushWindowGone(WindowInvestigator_EventQueue* queue, uintptr_t window);
+void WindowInvestigator_EventQueue_PushZOrderUpdated(WindowInvestigator_EventQueue* queue, size_t windowCount);
+void WindowInvestigator_EventQueue_PushTickFinished(WindowInvestigator_EventQueue* queue);
+void WindowInvestigator_EventQueue_PushKeyframe(WindowInvestigator_EventQueue* queue, size_t windowCount);
+void WindowInvestigator_EventQueue_PushWindowSnapshot(WindowInvestigator_EventQueue* queue, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo);
+void WindowInvestigator_EventQueue_PushReceivedMessage(WindowInvestigator_EventQueue* queue, WindowInvestigator_ReceivedMessageKind kind, uint32_t message, uint64_t wParam, uint64_t lParam);
+
+void WindowInvestigator_EventQueue_PushRudeWindowChanged(WindowInvestigator_EventQueue* queue, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window);
+
+// Extracts the message parameters from the record of a RECEIVED_MESSAGE event. Returns false if the record is malformed.
+bool WindowInvestigator_DecodeReceivedMessage(const unsigned char* record, size_t recordSize, uint64_t* wParam, uint64_t* lParam);
+// Same for the record of a RUDE_WINDOW_CHANGED event.
+bool WindowInvestigator_DecodeRudeWindowChanged(const unsigned char* record, size_t recordSize, uint64_t* previousWindow, WindowInvestigator_Rect* monitorRect);
+// Same for the record of an EVENTS_DROPPED event.
+bool WindowInvestigator_DecodeEventsDropped(const unsigned char* record, size_t recordSize, uint64_t* droppedCount);
+
+// Blocks until every event queued so far has been written. Must be called from the thread that queues events.
+void WindowInvestigator_EventQueue_Flush(WindowInvestigator_EventQueue* queue);
+
+// Fills a monitor sink that queues every event.
+void WindowInvestigator_EventQueue_GetSink(WindowInvestigator_EventQueue* queue, WindowInvestigator_MonitorSink* sink);
+// Same for the events of a WindowInvestigator_RudeWindowEngine.
+void WindowInvestigator_EventQueue_GetRudeWindowSink(WindowInvestigator_EventQueue* queue, WindowInvestigator_RudeWindowSink* sink);
+
+// Largest number of events that were waiting to be written at the same time. Can be called from any thread.
+uint64_t WindowInvestigator_EventQueue_GetHighWaterMark(const WindowInvestigator_EventQueue* queue);
+// Number of events that were dropped because the writer thread was too far behind. Can be called from any thread.
+uint64_t WindowInvestigator_EventQueue_GetDroppedCount(const WindowInvestigator_EventQueue* queue);
+// Adds how long onEvent took for each event, in nanoseconds, to histogram. Can be called from any thread.
+void WindowInvestigator_EventQueue_GetEmissionDurations(const WindowInvestigator_EventQueue* queue, WindowInvestigator_Histogram* histogram);
+// Must not be called while events are being written, e.g. call WindowInvestigator_EventQueue_Flush() first.
+void WindowInvestigator_EventQueue_ResetEmissionDurations(WindowInvestigator_EventQueue* queue);
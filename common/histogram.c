@@ -0,0 +1,96 @@
+#include "histogram.h"
+
+#include "atomic.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+// Returns the index of the most significant bit that is set. value must not be zero.
+static unsigned int WindowInvestigator_Histogram_GetMostSignificantBit(uint64_t value) {
+	unsigned int bit = 0;
+	for (unsigned int shift = 32; shift != 0; shift /= 2)
+		if (value >> shift) {
+			value >>= shift;
+			bit += shift;
+		}
+	return bit;
+}
+
+static size_t WindowInvestigator_Histogram_GetBucket(uint64_t value) {
+	if (value < WindowInvestigator_Histogram_SUB_BUCKET_COUNT) return (size_t)value;
+	// Keep the top WindowInvestigator_Histogram_SUB_BUCKET_BITS bits of the value.
+	const unsigned int shift = WindowInvestigator_Histogram_GetMostSignificantBit(value) - WindowInvestigator_Histogram_SUB_BUCKET_BITS + 1;
+	return (size_t)shift * (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2) + (size_t)(value >> shift);
+}
+
+// Returns the largest value that falls in the specified bucket.
+static uint64_t WindowInvestigator_Histogram_GetBucketEnd(size_t bucket) {
+	if (bucket < WindowInvestigator_Histogram_SUB_BUCKET_COUNT) return bucket;
+	const unsigned int shift = (unsigned int)(bucket / (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2) - 1);
+	const uint64_t mantissa = bucket - (uint64_t)shift * (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2);
+	return ((mantissa + 1) << shift) - 1;
+}
+
+void WindowInvestigator_Histogram_Reset(WindowInvestigator_Histogram* histogram) {
+	memset(histogram, 0, sizeof(*histogram));
+	histogram->min = UINT64_MAX;
+}
+
+void WindowInvestigator_Histogram_Record(WindowInvestigator_Histogram* histogram, uint64_t value) {
+	if (value < histogram->min) histogram->min = value;
+	if (value > histogram->max) histogram->max = value;
+	++histogram->count;
+	histogram->sum += value;
+	++histogram->buckets[WindowInvestigator_Histogram_GetBucket(value)];
+}
+
+void WindowInvestigator_Histogram_RecordConcurrent(WindowInvestigator_Histogram* histogram, uint64_t value) {
+	WindowInvestigator_Atomic_StoreMin(&histogram->min, value);
+	WindowInvestigator_Atomic_StoreMax(&histogram->max, value);
+	WindowInvestigator_Atomic_Increment(&histogram->count);
+	WindowInvestigator_Atomic_Add(&histogram->sum, value);
+	WindowInvestigator_Atomic_Increment(&histogram->buckets[WindowInvestigator_Histogram_GetBucket(value)]);
+}
+
+void WindowInvestigator_Histogram_Merge(WindowInvestigator_Histogram* destination, const WindowInvestigator_Histogram* source) {
+	const uint64_t min = WindowInvestigator_Atomic_LoadAcquire(&source->min);
+	const uint64_t max = WindowInvestigator_Atomic_LoadAcquire(&source->max);
+	if (min < destination->min) destination->min = min;
+	if (max > destination->max) destination->max = max;
+	destination->count += WindowInvestigator_Atomic_LoadAcquire(&source->count);
+	destination->sum += WindowInvestigator_Atomic_LoadAcquire(&source->sum);
+	for (size_t bucket = 0; bucket < WindowInvestigator_Histogram_BUCKET_COUNT; ++bucket)
+		destination->buckets[bucket] += WindowInvestigator_Atomic_LoadAcquire(&source->buckets[bucket]);
+}
+
+uint64_t WindowInvestigator_Histogram_GetPercentile(const WindowInvestigator_Histogram* histogram, double percentile) {
+	if (histogram->count == 0) return 0;
+	const double exactRank = percentile / 100 * (double)histogram->count;
+	uint64_t rank = (uint64_t)exactRank;
+	if ((double)rank < exactRank || rank < 1) ++rank;
+	if (rank > histogram->count) rank = histogram->count;
+	uint64_t cumulativeCount = 0;
+	for (size_t bucket = 0; bucket < WindowInvestigator_Histogram_BUCKET_COUNT; ++bucket) {
+		cumulativeCount += histogram->buckets[bucket];
+		if (cumulativeCount < rank) continue;
+		const uint64_t bucketEnd = WindowInvestigator_Histogram_GetBucketEnd(bucket);
+		return bucketEnd < histogram->max ? bucketEnd : histogram->max;
+	}
+	return histogram->max;
+}
+
+uint64_t WindowInvestigator_Histogram_GetMean(const WindowInvestigator_Histogram* histogram) {
+	return histogram->count == 0 ? 0 : histogram->sum / histogram->count;
+}
+
+void WindowInvestigator_Histogram_PrintPercentileTable(FILE* file, const char* const* names, const WindowInvestigator_Histogram* const* histograms, size_t count) {
+	fprintf(file, "%-16s %10s %10s %10s %10s %10s %10s %10s\n", "", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (size_t index = 0; index < count; ++index) {
+		const WindowInvestigator_Histogram* const histogram = histograms[index];
+		fprintf(file, "%-16s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", names[index],
+			histogram->count, WindowInvestigator_Histogram_GetMean(histogram),
+			WindowInvestigator_Histogram_GetPercentile(histogram, 50), WindowInvestigator_Histogram_GetPercentile(histogram, 90),
+			WindowInvestigator_Histogram_GetPercentile(histogram, 99), WindowInvestigator_Histogram_GetPercentile(histogram, 99.9),
+			WindowInvestigator_Histogram_GetPercentile(histogram, 100));
+	}
+}
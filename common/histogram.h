@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Histogram of non-negative integer values (typically durations in nanoseconds) with log-linear buckets: values below
+// WindowInvestigator_Histogram_SUB_BUCKET_COUNT each get their own bucket, and every power of two above that is split into
+// WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2 buckets of equal width. Percentiles are therefore accurate to within
+// 1 / (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2) of the value, across the whole uint64_t range, with a fixed amount
+// of memory and no allocations.
+//
+// Histograms that are only updated by one thread use WindowInvestigator_Histogram_Record(). Histograms that are updated by
+// several threads, or read by another thread while they are being updated, use WindowInvestigator_Histogram_RecordConcurrent()
+// instead, and are read through WindowInvestigator_Histogram_Merge(). Alternatively, each thread can keep its own histogram,
+// and these can be merged once the threads are idle; this is cheaper if values are recorded often.
+//
+// A histogram takes about 8 KB, so it is best kept off the stack (MSVC /analyze warns about stack frames above 16 KB).
+
+#define WindowInvestigator_Histogram_SUB_BUCKET_BITS 5
+#define WindowInvestigator_Histogram_SUB_BUCKET_COUNT (1 << WindowInvestigator_Histogram_SUB_BUCKET_BITS)
+#define WindowInvestigator_Histogram_BUCKET_COUNT ((64 - WindowInvestigator_Histogram_SUB_BUCKET_BITS + 1) * (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2) + WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2)
+
+typedef struct {
+	uint64_t count;
+	uint64_t sum;
+	// UINT64_MAX and 0 respectively if count is zero.
+	uint64_t min;
+	uint64_t max;
+	uint64_t buckets[WindowInvestigator_Histogram_BUCKET_COUNT];
+} WindowInvestigator_Histogram;
+
+void WindowInvestigator_Histogram_Reset(WindowInvestigator_Histogram* histogram);
+void WindowInvestigator_Histogram_Record(WindowInvestigator_Histogram* histogram, uint64_t value);
+// Same as WindowInvestigator_Histogram_Record(), but can be called concurrently with itself and with
+// WindowInvestigator_Histogram_Merge(). Each counter is updated with a separate atomic operation, so a concurrent reader can
+// see a value that is only partially recorded (e.g. counted but not yet in its bucket), but never a torn counter.
+void WindowInvestigator_Histogram_RecordConcurrent(WindowInvestigator_Histogram* histogram, uint64_t value);
+// Adds the values recorded in source to destination, as if they had been recorded in destination. source can be updated
+// concurrently with WindowInvestigator_Histogram_RecordConcurrent().
+void WindowInvestigator_Histogram_Merge(WindowInvestigator_Histogram* destination, const WindowInvestigator_Histogram* source);
+
+// Returns the smallest value that is greater than or equal to the specified percentage (between 0 and 100) of the recorded
+// values, rounded up to the end of its bucket but never beyond the largest recorded value. Returns 0 if the histogram is empty.
+uint64_t WindowInvestigator_Histogram_GetPercentile(const WindowInvestigator_Histogram* histogram, double percentile);
+uint64_t WindowInvestigator_Histogram_GetMean(const WindowInvestigator_Histogram* histogram);
+
+// Prints one line per histogram with the count, the mean and a few percentiles, preceded by a header line. names are the
+// row labels.
+void WindowInvestigator_Histogram_PrintPercentileTable(FILE* file, const char* const* names, const WindowInvestigator_Histogram* const* histograms, size_t count);
@@ -0,0 +1,156 @@
+#include "message_script.h"
+
+#include "allocation.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Above this, the script is almost certainly a mistake, and would take gigabytes.
+#define WindowInvestigator_MessageScript_MAX_MESSAGES_PER_LOOP (UINT64_C(1) << 24)
+
+void WindowInvestigator_MessageScript_Init(WindowInvestigator_MessageScript* script) {
+	script->messages = NULL;
+	script->messageCount = 0;
+	script->loopCount = 1;
+	script->loopPeriodNanoseconds = 0;
+}
+
+void WindowInvestigator_MessageScript_Destroy(WindowInvestigator_MessageScript* script) {
+	WindowInvestigator_Free(script->messages);
+	WindowInvestigator_MessageScript_Init(script);
+}
+
+// Returns the next token on the line, i.e. up to the next space, tab, newline or #, or NULL if there is none. The token is
+// copied to buffer, so that it can be passed to strtoull() and strtod().
+static const char* WindowInvestigator_MessageScript_NextToken(const char** cursor, char* buffer, size_t bufferSize) {
+	const char* character = *cursor;
+	while (*character == ' ' || *character == '\t' || *character == '\r') ++character;
+	const char* const start = character;
+	while (*character != '\0' && *character != '\n' && *character != '#' && *character != ' ' && *character != '\t' && *character != '\r') ++character;
+	*cursor = character;
+	const size_t length = (size_t)(character - start);
+	if (length == 0) return NULL;
+	// A token that long cannot be valid; replace it with one that does not parse.
+	if (length >= bufferSize) return "?";
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+	return buffer;
+}
+
+static bool WindowInvestigator_MessageScript_ParseUInt64(const char* token, uint64_t* value) {
+	if (token == NULL || !isdigit((unsigned char)token[0])) return false;
+	char* end;
+	errno = 0;
+	*value = strtoull(token, &end, 0);
+	return *end == '\0' && errno != ERANGE;
+}
+
+static bool WindowInvestigator_MessageScript_ParseMilliseconds(const char* token, uint64_t* nanoseconds) {
+	if (token == NULL) return false;
+	char* end;
+	const double milliseconds = strtod(token, &end);
+	if (*end != '\0' || !isfinite(milliseconds) || milliseconds < 0 || milliseconds * 1e6 >= 1.8e19) return false;
+	*nanoseconds = (uint64_t)(milliseconds * 1e6 + 0.5);
+	return true;
+}
+
+static bool WindowInvestigator_MessageScript_IsKeyword(const char* token, const char* keyword) {
+	return token != NULL && strcmp(token, keyword) == 0;
+}
+
+// Returns false if the line is malformed. Blank lines are fine.
+// loopLine is the line of the loop entry, or 0 if there has not been one yet.
+static bool WindowInvestigator_MessageScript_ParseLine(WindowInvestigator_MessageScript* script, const char** cursor, size_t line, size_t* loopLine) {
+	char buffer[64];
+	const char* token = WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer));
+	if (token == NULL) return true;
+
+	if (WindowInvestigator_MessageScript_IsKeyword(token, "loop")) {
+		if (*loopLine != 0 || !WindowInvestigator_MessageScript_ParseUInt64(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), &script->loopCount) || script->loopCount == 0) return false;
+		if (!WindowInvestigator_MessageScript_IsKeyword(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), "every")) return false;
+		if (!WindowInvestigator_MessageScript_ParseMilliseconds(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), &script->loopPeriodNanoseconds)) return false;
+		*loopLine = line;
+		return WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)) == NULL;
+	}
+
+	WindowInvestigator_ScriptedMessage message;
+	message.line = line;
+	if (!WindowInvestigator_MessageScript_ParseMilliseconds(token, &message.offsetNanoseconds)) return false;
+	if (!WindowInvestigator_MessageScript_ParseUInt64(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), &message.wParam)) return false;
+	if (!WindowInvestigator_MessageScript_ParseUInt64(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), &message.lParam)) return false;
+
+	uint64_t repeatCount = 1;
+	uint64_t intervalNanoseconds = 0;
+	token = WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer));
+	if (token != NULL) {
+		if (!WindowInvestigator_MessageScript_IsKeyword(token, "repeat")) return false;
+		if (!WindowInvestigator_MessageScript_ParseUInt64(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), &repeatCount) || repeatCount == 0) return false;
+		if (!WindowInvestigator_MessageScript_IsKeyword(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), "every")) return false;
+		if (!WindowInvestigator_MessageScript_ParseMilliseconds(WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)), &intervalNanoseconds)) return false;
+		if (WindowInvestigator_MessageScript_NextToken(cursor, buffer, sizeof(buffer)) != NULL) return false;
+	}
+	if (repeatCount > WindowInvestigator_MessageScript_MAX_MESSAGES_PER_LOOP - script->messageCount) return false;
+	if (repeatCount > 1 && (UINT64_MAX - message.offsetNanoseconds) / (repeatCount - 1) < intervalNanoseconds) return false;
+
+	script->messages = WindowInvestigator_Reallocate(script->messages, script->messageCount + (size_t)repeatCount, sizeof(*script->messages));
+	for (uint64_t repeat = 0; repeat < repeatCount; ++repeat) {
+		script->messages[script->messageCount] = message;
+		script->messages[script->messageCount].offsetNanoseconds += repeat * intervalNanoseconds;
+		++script->messageCount;
+	}
+	return true;
+}
+
+static int WindowInvestigator_MessageScript_CompareMessages(const void* left, const void* right) {
+	const WindowInvestigator_ScriptedMessage* const leftMessage = left;
+	const WindowInvestigator_ScriptedMessage* const rightMessage = right;
+	if (leftMessage->offsetNanoseconds != rightMessage->offsetNanoseconds) return leftMessage->offsetNanoseconds < rightMessage->offsetNanoseconds ? -1 : 1;
+	// qsort() is not stable, so messages that are due at the same time are explicitly kept in script order.
+	return leftMessage->line < rightMessage->line ? -1 : leftMessage->line > rightMessage->line;
+}
+
+// Whether every loop ends before the next one starts, and the whole script fits in 64-bit nanoseconds.
+static bool WindowInvestigator_MessageScript_CheckLoops(const WindowInvestigator_MessageScript* script) {
+	if (script->messageCount == 0 || script->loopCount == 1) return true;
+	const uint64_t lastOffset = script->messages[script->messageCount - 1].offsetNanoseconds;
+	if (lastOffset > script->loopPeriodNanoseconds || script->loopCount > UINT64_MAX / script->messageCount) return false;
+	return script->loopPeriodNanoseconds == 0 || (UINT64_MAX - lastOffset) / script->loopPeriodNanoseconds >= script->loopCount - 1;
+}
+
+bool WindowInvestigator_MessageScript_Parse(WindowInvestigator_MessageScript* script, const char* text, size_t* errorLine) {
+	WindowInvestigator_MessageScript_Destroy(script);
+	size_t loopLine = 0;
+	const char* cursor = text;
+	for (size_t line = 1;; ++line) {
+		if (!WindowInvestigator_MessageScript_ParseLine(script, &cursor, line, &loopLine)) {
+			WindowInvestigator_MessageScript_Destroy(script);
+			*errorLine = line;
+			return false;
+		}
+		// Skip the comment, if any.
+		while (*cursor != '\0' && *cursor != '\n') ++cursor;
+		if (*cursor == '\0') break;
+		++cursor;
+	}
+
+	if (script->messageCount != 0) qsort(script->messages, script->messageCount, sizeof(*script->messages), WindowInvestigator_MessageScript_CompareMessages);
+	if (!WindowInvestigator_MessageScript_CheckLoops(script)) {
+		WindowInvestigator_MessageScript_Destroy(script);
+		*errorLine = loopLine;
+		return false;
+	}
+	if (script->loopCount == 1) script->loopPeriodNanoseconds = 0;
+	return true;
+}
+
+uint64_t WindowInvestigator_MessageScript_GetMessageCount(const WindowInvestigator_MessageScript* script) {
+	return script->messageCount * script->loopCount;
+}
+
+void WindowInvestigator_MessageScript_GetMessage(const WindowInvestigator_MessageScript* script, uint64_t index, WindowInvestigator_ScriptedMessage* message) {
+	*message = script->messages[index % script->messageCount];
+	message->offsetNanoseconds += index / script->messageCount * script->loopPeriodNanoseconds;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A timed sequence of messages for BroadcastShellHookMessage to send, so that sequences can be reproduced from a single
+// process with precise timing, instead of from a shell loop that launches one process per message.
+//
+// A script is a text made of one entry per line (# starts a comment). Times are in milliseconds, and can have a fractional
+// part:
+//
+//   OFFSET WPARAM LPARAM                        Sends the message OFFSET after the start of the script.
+//   OFFSET WPARAM LPARAM repeat COUNT every INTERVAL
+//                                               Sends the message COUNT times, every INTERVAL, starting at OFFSET.
+//   loop COUNT every PERIOD                     Runs the whole script COUNT times, starting every PERIOD. PERIOD cannot be
+//                                               shorter than the script.
+//
+// WPARAM and LPARAM are decimal, or hexadecimal if prefixed with 0x. Messages that are due at the same time are sent in the
+// order of the script.
+
+typedef struct {
+	// Since the start of the script.
+	uint64_t offsetNanoseconds;
+	uint64_t wParam;
+	uint64_t lParam;
+	// Line of the entry in the script, starting at 1.
+	size_t line;
+} WindowInvestigator_ScriptedMessage;
+
+typedef struct {
+	// Every message of the first loop, in the order they are due, repeats expanded.
+	WindowInvestigator_ScriptedMessage* messages;
+	size_t messageCount;
+	uint64_t loopCount;
+	uint64_t loopPeriodNanoseconds;
+} WindowInvestigator_MessageScript;
+
+// The script starts empty.
+void WindowInvestigator_MessageScript_Init(WindowInvestigator_MessageScript* script);
+void WindowInvestigator_MessageScript_Destroy(WindowInvestigator_MessageScript* script);
+
+// Replaces the script with the one in text. Returns false, leaving the script empty, if text is malformed (or expands to an
+// unreasonable number of messages per loop), in which case errorLine is set to the (1-based) line of the error.
+bool WindowInvestigator_MessageScript_Parse(WindowInvestigator_MessageScript* script, const char* text, size_t* errorLine);
+
+// Total number of messages to send, loops included.
+uint64_t WindowInvestigator_MessageScript_GetMessageCount(const WindowInvestigator_MessageScript* script);
+// index is between 0 and WindowInvestigator_MessageScript_GetMessageCount(). Messages are in the order they are due.
+void WindowInvestigator_MessageScript_GetMessage(const WindowInvestigator_MessageScript* script, uint64_t index, WindowInvestigator_ScriptedMessage* message);
@@ -0,0 +1,456 @@
+#include "monitor.h"
+
+#include "allocation.h"
+#include "clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void WindowInvestigator_Monitor_OnWindowGone(void* context, uintptr_t window, void* windowInfo) {
+	WindowInvestigator_Monitor* const monitor = context;
+	monitor->zOrderUpdated = true;
+	monitor->sink.onWindowGone(monitor->sink.context, window);
+	WindowInvestigator_ReleaseWindowStrings(&monitor->strings, windowInfo);
+	if (monitor->options.incremental) WindowInvestigator_DirtySet_Forget(&monitor->dirtySet, window);
+}
+
+static void WindowInvestigator_Monitor_OnZOrderChanged(void* context, uintptr_t window, void* windowInfo, size_t previousZOrder, size_t zOrder) {
+	(void)windowInfo;
+	WindowInvestigator_Monitor* const monitor = context;
+	monitor->zOrderUpdated = true;
+	monitor->sink.onWindowZOrderChanged(monitor->sink.context, window, previousZOrder, zOrder);
+}
+
+static void WindowInvestigator_Monitor_AddStatistics(WindowInvestigator_MonitorStatistics* statistics, const WindowInvestigator_MonitorStatistics* other) {
+	statistics->windowInfoBytesCopied += other->windowInfoBytesCopied;
+	statistics->getWindowInfoCalls += other->getWindowInfoCalls;
+	statistics->fieldsSampled += other->fieldsSampled;
+	statistics->filterWindowCalls += other->filterWindowCalls;
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field)
+		statistics->fieldSamples[field] += other->fieldSamples[field];
+}
+
+const char* WindowInvestigator_MonitorPhase_GetName(WindowInvestigator_MonitorPhase phase) {
+	switch (phase) {
+	case WindowInvestigator_MonitorPhase_ENUMERATION: return "Enumeration";
+	case WindowInvestigator_MonitorPhase_WINDOW_CAPTURE: return "WindowCapture";
+	case WindowInvestigator_MonitorPhase_DIFF: return "Diff";
+	case WindowInvestigator_MonitorPhase_COUNT: break;
+	}
+	return "Unknown";
+}
+
+void WindowInvestigator_Monitor_GetDefaultOptions(WindowInvestigator_MonitorOptions* options) {
+	WindowInvestigator_SamplingPolicy_InitTiered(&options->samplingPolicy);
+	options->workerCount = 0;
+	options->windowsPerBatch = 8;
+	options->onTickReady = NULL;
+	options->onTickReadyContext = NULL;
+	options->filterWindow = NULL;
+	options->filterWindowContext = NULL;
+	options->incremental = false;
+	WindowInvestigator_DirtySet_GetDefaultOptions(&options->dirtySetOptions);
+}
+
+void WindowInvestigator_Monitor_Init(WindowInvestigator_Monitor* monitor, const WindowInvestigator_MonitorBackend* backend, const WindowInvestigator_MonitorSink* sink, const WindowInvestigator_MonitorOptions* options) {
+	memset(monitor, 0, sizeof(*monitor));
+	monitor->backend = *backend;
+	monitor->sink = *sink;
+	monitor->options = *options;
+	if (monitor->options.windowsPerBatch == 0) monitor->options.windowsPerBatch = 1;
+	WindowInvestigator_WindowTable_Init(&monitor->windows, sizeof(WindowInvestigator_WindowInfo));
+	WindowInvestigator_WindowTable_Init(&monitor->filteredOutWindows, 0);
+	WindowInvestigator_StringPool_Init(&monitor->strings);
+	WindowInvestigator_SamplingScheduler_Init(&monitor->sampling, &options->samplingPolicy);
+	WindowInvestigator_DirtySet_Init(&monitor->dirtySet, &options->dirtySetOptions);
+
+	WindowInvestigator_WorkerPool_Init(&monitor->workerPool, options->workerCount);
+	const size_t workerCount = options->workerCount == 0 ? 1 : options->workerCount;
+	monitor->workers = WindowInvestigator_Reallocate(NULL, workerCount, sizeof(*monitor->workers));
+	memset(monitor->workers, 0, workerCount * sizeof(*monitor->workers));
+	monitor->phaseDurations = WindowInvestigator_Reallocate(NULL, WindowInvestigator_MonitorPhase_COUNT, sizeof(*monitor->phaseDurations));
+	WindowInvestigator_Monitor_ResetPhaseDurations(monitor);
+}
+
+void WindowInvestigator_Monitor_Destroy(WindowInvestigator_Monitor* monitor) {
+	WindowInvestigator_WorkerPool_Destroy(&monitor->workerPool);
+	const size_t workerCount = monitor->options.workerCount == 0 ? 1 : monitor->options.workerCount;
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+		WindowInvestigator_Free(monitor->workers[workerIndex].stringBuffer);
+	WindowInvestigator_Free(monitor->workers);
+	WindowInvestigator_Free(monitor->phaseDurations);
+	WindowInvestigator_Free(monitor->samples);
+	WindowInvestigator_WindowTable_Destroy(&monitor->windows);
+	WindowInvestigator_WindowTable_Destroy(&monitor->filteredOutWindows);
+	WindowInvestigator_StringPool_Destroy(&monitor->strings);
+	WindowInvestigator_DirtySet_Destroy(&monitor->dirtySet);
+}
+
+static void WindowInvestigator_Monitor_GetWindowInfo(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorWorker* worker, uintptr_t window, uint32_t fields, WindowInvestigator_WindowInfo* windowInfo) {
+	monitor->backend.getWindowInfo(monitor->backend.context, window, fields, windowInfo, &worker->windowStrings);
+	++worker->statistics.getWindowInfoCalls;
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field)
+		if (fields & WindowInvestigator_WindowField_BIT(field)) {
+			++worker->statistics.fieldsSampled;
+			++worker->statistics.fieldSamples[field];
+		}
+}
+
+// Samples each field with a separate backend call, and records how long each call took.
+static void WindowInvestigator_Monitor_ProfileWindowInfo(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorWorker* worker, uintptr_t window, WindowInvestigator_WindowInfo* windowInfo) {
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field) {
+		const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+		WindowInvestigator_Monitor_GetWindowInfo(monitor, worker, window, WindowInvestigator_WindowField_BIT(field), windowInfo);
+		worker->costs[field].nanoseconds += WindowInvestigator_GetTimeNanoseconds() - startTime;
+		++worker->costs[field].sampleCount;
+	}
+}
+
+// The string pool cannot be modified by workers, so strings that changed are set aside for the thread that finishes the tick
+// to intern.
+static void WindowInvestigator_Monitor_CheckString(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorWorker* worker, WindowInvestigator_MonitorWindowSample* sample, WindowInvestigator_WindowField field, const WindowInvestigator_StringId* previousId, const WindowInvestigator_CapturedString* capturedString, WindowInvestigator_MonitorPendingString* pendingString) {
+	if (previousId != NULL && WindowInvestigator_StringPool_Equals(&monitor->strings, *previousId, capturedString->string, capturedString->length, capturedString->hash)) return;
+
+	if (worker->stringBufferCapacity - worker->stringBufferLength < capturedString->length) {
+		worker->stringBufferCapacity = worker->stringBufferLength + capturedString->length;
+		if (worker->stringBufferCapacity < 2 * worker->stringBufferLength) worker->stringBufferCapacity = 2 * worker->stringBufferLength;
+		worker->stringBuffer = WindowInvestigator_Reallocate(worker->stringBuffer, worker->stringBufferCapacity, sizeof(*worker->stringBuffer));
+	}
+	memcpy(worker->stringBuffer + worker->stringBufferLength, capturedString->string, capturedString->length * sizeof(*capturedString->string));
+	pendingString->offset = worker->stringBufferLength;
+	pendingString->length = capturedString->length;
+	pendingString->hash = capturedString->hash;
+	worker->stringBufferLength += capturedString->length;
+	sample->pendingStrings |= WindowInvestigator_WindowField_BIT(field);
+}
+
+static void WindowInvestigator_Monitor_CheckStrings(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorWorker* worker, WindowInvestigator_MonitorWindowSample* sample, const WindowInvestigator_WindowInfo* previousWindowInfo, uint32_t fields) {
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		WindowInvestigator_Monitor_CheckString(monitor, worker, sample, WindowInvestigator_WindowField_CLASS_NAME, previousWindowInfo == NULL ? NULL : &previousWindowInfo->className, &worker->windowStrings.className, &sample->pendingClassName);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		WindowInvestigator_Monitor_CheckString(monitor, worker, sample, WindowInvestigator_WindowField_TEXT, previousWindowInfo == NULL ? NULL : &previousWindowInfo->text, &worker->windowStrings.text, &sample->pendingText);
+}
+
+static void WindowInvestigator_Monitor_SampleWindow(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorWorker* worker, WindowInvestigator_MonitorWindowSample* sample) {
+	sample->pendingStrings = 0;
+	sample->changedFields = 0;
+	// Typical of windows that are enumerated in incremental mode without being dirty.
+	if (sample->sampledFields == 0 && !sample->profile && !sample->isNewWindow) return;
+
+	if (sample->isNewWindow) {
+		memset(&sample->windowInfo, 0, sizeof(sample->windowInfo));
+		WindowInvestigator_Monitor_GetWindowInfo(monitor, worker, sample->window, WindowInvestigator_WindowField_ALL, &sample->windowInfo);
+		WindowInvestigator_Monitor_CheckStrings(monitor, worker, sample, NULL, WindowInvestigator_WindowField_ALL);
+		return;
+	}
+
+	// The window table is not modified while workers are running.
+	const WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(&monitor->windows, sample->slot);
+
+	// Fields that are not sampled keep their previous values.
+	sample->windowInfo = *windowInfo;
+	worker->statistics.windowInfoBytesCopied += sizeof(*windowInfo);
+
+	if (sample->profile)
+		WindowInvestigator_Monitor_ProfileWindowInfo(monitor, worker, sample->window, &sample->windowInfo);
+	else
+		WindowInvestigator_Monitor_GetWindowInfo(monitor, worker, sample->window, sample->sampledFields, &sample->windowInfo);
+	WindowInvestigator_Monitor_CheckStrings(monitor, worker, sample, windowInfo, sample->sampledFields);
+	// Pending strings keep their previous IDs for now, so the diff doesn't see them.
+	sample->changedFields = WindowInvestigator_DiffWindowInfo(windowInfo, &sample->windowInfo) | sample->pendingStrings;
+
+	const uint32_t triggeredFields = WindowInvestigator_SamplingScheduler_GetTriggeredFields(&monitor->sampling, sample->changedFields, sample->sampledFields);
+	if (triggeredFields != 0) {
+		WindowInvestigator_Monitor_GetWindowInfo(monitor, worker, sample->window, triggeredFields, &sample->windowInfo);
+		WindowInvestigator_Monitor_CheckStrings(monitor, worker, sample, windowInfo, triggeredFields);
+		sample->changedFields = WindowInvestigator_DiffWindowInfo(windowInfo, &sample->windowInfo) | sample->pendingStrings;
+	}
+}
+
+static void WindowInvestigator_Monitor_SampleWindows(void* context, size_t workerIndex, size_t firstSample, size_t endSample) {
+	WindowInvestigator_Monitor* const monitor = context;
+	WindowInvestigator_MonitorWorker* const worker = &monitor->workers[workerIndex];
+	// The end of one window is the start of the next, which saves a clock read per window.
+	uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+	for (size_t sampleIndex = firstSample; sampleIndex < endSample; ++sampleIndex) {
+		WindowInvestigator_MonitorWindowSample* const sample = &monitor->samples[sampleIndex];
+		sample->workerIndex = workerIndex;
+		WindowInvestigator_Monitor_SampleWindow(monitor, worker, sample);
+		const uint64_t endTime = WindowInvestigator_GetTimeNanoseconds();
+		WindowInvestigator_Histogram_Record(&worker->windowCaptureDurations, endTime - startTime);
+		startTime = endTime;
+	}
+}
+
+static void WindowInvestigator_Monitor_OnSamplesReady(void* context) {
+	const WindowInvestigator_Monitor* const monitor = context;
+	if (monitor->options.onTickReady != NULL) monitor->options.onTickReady(monitor->options.onTickReadyContext);
+}
+
+static WindowInvestigator_StringId WindowInvestigator_Monitor_InternPendingString(WindowInvestigator_Monitor* monitor, const WindowInvestigator_MonitorWorker* worker, const WindowInvestigator_MonitorPendingString* pendingString) {
+	return WindowInvestigator_StringPool_Intern(&monitor->strings, worker->stringBuffer + pendingString->offset, pendingString->length, pendingString->hash);
+}
+
+static WindowInvestigator_MonitorWindowSample* WindowInvestigator_Monitor_AddSample(WindowInvestigator_Monitor* monitor) {
+	if (monitor->sampleCount == monitor->sampleCapacity) {
+		monitor->sampleCapacity = monitor->sampleCapacity == 0 ? 64 : 2 * monitor->sampleCapacity;
+		monitor->samples = WindowInvestigator_Reallocate(monitor->samples, monitor->sampleCapacity, sizeof(*monitor->samples));
+	}
+	return &monitor->samples[monitor->sampleCount++];
+}
+
+static void WindowInvestigator_Monitor_EnumerateWindows(WindowInvestigator_Monitor* monitor, uint64_t tick, bool sampleAllFields, size_t profiledZOrder) {
+	const WindowInvestigator_MonitorBackend* const backend = &monitor->backend;
+	const bool incremental = monitor->options.incremental;
+
+	WindowInvestigator_WindowTable_BeginPass(&monitor->windows);
+	const bool filter = monitor->options.filterWindow != NULL;
+	if (filter) WindowInvestigator_WindowTable_BeginPass(&monitor->filteredOutWindows);
+
+	uintptr_t window = 0;
+	for (;;) {
+		window = backend->getNextWindow(backend->context, window);
+		if (window == 0) break;
+
+		if (!backend->isWindowVisible(backend->context, window)) continue;
+
+		WindowInvestigator_WindowTable_VisitResult visitResult;
+		if (filter && WindowInvestigator_WindowTable_Find(&monitor->windows, window) == WindowInvestigator_WindowTable_NO_SLOT) {
+			bool filteredOut = WindowInvestigator_WindowTable_Find(&monitor->filteredOutWindows, window) != WindowInvestigator_WindowTable_NO_SLOT;
+			if (!filteredOut) {
+				++monitor->statistics.filterWindowCalls;
+				filteredOut = !monitor->options.filterWindow(monitor->options.filterWindowContext, window);
+			}
+			if (filteredOut) {
+				WindowInvestigator_WindowTable_Visit(&monitor->filteredOutWindows, window, &visitResult);
+				if (visitResult == WindowInvestigator_WindowTable_ALREADY_VISITED) {
+					fprintf(stderr, "Window 0x%p already seen!", (void*)window);
+					exit(EXIT_FAILURE);
+				}
+				continue;
+			}
+		}
+
+		const size_t slot = WindowInvestigator_WindowTable_Visit(&monitor->windows, window, &visitResult);
+		if (visitResult == WindowInvestigator_WindowTable_ALREADY_VISITED) {
+			fprintf(stderr, "Window 0x%p already seen!", (void*)window);
+			exit(EXIT_FAILURE);
+		}
+
+		const bool profile = monitor->sampleCount == profiledZOrder;
+		const uint32_t dirtyFields = incremental ? WindowInvestigator_DirtySet_Take(&monitor->dirtySet, window) : 0;
+		WindowInvestigator_MonitorWindowSample* const sample = WindowInvestigator_Monitor_AddSample(monitor);
+		sample->window = window;
+		sample->slot = slot;
+		sample->isNewWindow = visitResult == WindowInvestigator_WindowTable_NEW_WINDOW;
+		sample->profile = profile;
+		if (sample->isNewWindow || sample->profile || sampleAllFields)
+			sample->sampledFields = WindowInvestigator_WindowField_ALL;
+		else
+			sample->sampledFields = incremental ? dirtyFields : WindowInvestigator_SamplingScheduler_GetDueFields(&monitor->sampling, tick, slot);
+	}
+	if (filter) {
+		// Forget the windows that went away, so that the filter is evaluated again if their handle gets reused.
+		WindowInvestigator_WindowTable_PassCallbacks passCallbacks;
+		passCallbacks.onWindowGone = NULL;
+		passCallbacks.onZOrderChanged = NULL;
+		passCallbacks.context = NULL;
+		WindowInvestigator_WindowTable_EndPass(&monitor->filteredOutWindows, &passCallbacks);
+	}
+}
+
+// Marks the next few windows of the Z-order dirty, so that every window eventually gets read in full even if some changes
+// were never notified.
+static void WindowInvestigator_Monitor_SweepWindows(WindowInvestigator_Monitor* monitor) {
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(&monitor->windows);
+	size_t first;
+	const size_t count = WindowInvestigator_DirtySet_GetSweep(&monitor->dirtySet, windowCount, &first);
+	for (size_t index = 0; index < count; ++index) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(&monitor->windows, (first + index) % windowCount);
+		WindowInvestigator_DirtySet_MarkDirty(&monitor->dirtySet, WindowInvestigator_WindowTable_GetWindow(&monitor->windows, slot), WindowInvestigator_WindowField_ALL);
+	}
+}
+
+// Whether the dirty windows show that windows may have appeared, disappeared or moved in the Z-order since the last
+// enumeration, e.g. because of a structural notification, or because a notification about a window that became visible
+// was missed.
+static bool WindowInvestigator_Monitor_IsEnumerationNeeded(const WindowInvestigator_Monitor* monitor) {
+	const WindowInvestigator_MonitorBackend* const backend = &monitor->backend;
+	const size_t dirtyCount = WindowInvestigator_DirtySet_GetDirtyCount(&monitor->dirtySet);
+	for (size_t index = 0; index < dirtyCount; ++index) {
+		const WindowInvestigator_DirtyWindow* const dirtyWindow = WindowInvestigator_DirtySet_GetDirtyWindow(&monitor->dirtySet, index);
+		if (WindowInvestigator_WindowTable_Find(&monitor->windows, dirtyWindow->window) != WindowInvestigator_WindowTable_NO_SLOT) {
+			if (dirtyWindow->structural || !backend->isWindowVisible(backend->context, dirtyWindow->window)) return true;
+		}
+		// Windows that are neither tracked nor visible are of no interest, whatever happened to them.
+		else if (WindowInvestigator_WindowTable_Find(&monitor->filteredOutWindows, dirtyWindow->window) == WindowInvestigator_WindowTable_NO_SLOT && backend->isWindowVisible(backend->context, dirtyWindow->window))
+			return true;
+	}
+	return false;
+}
+
+// Only reads the dirty windows, which are all visible and tracked if the tick does not need to enumerate. The other dirty
+// windows are not taken, so they are forgotten at the end of the pass.
+static void WindowInvestigator_Monitor_AddDirtyWindows(WindowInvestigator_Monitor* monitor, uintptr_t profiledWindow) {
+	const size_t dirtyCount = WindowInvestigator_DirtySet_GetDirtyCount(&monitor->dirtySet);
+	for (size_t index = 0; index < dirtyCount; ++index) {
+		const uintptr_t window = WindowInvestigator_DirtySet_GetDirtyWindow(&monitor->dirtySet, index)->window;
+		const size_t slot = WindowInvestigator_WindowTable_Find(&monitor->windows, window);
+		if (slot == WindowInvestigator_WindowTable_NO_SLOT) continue;
+
+		WindowInvestigator_MonitorWindowSample* const sample = WindowInvestigator_Monitor_AddSample(monitor);
+		sample->window = window;
+		sample->slot = slot;
+		sample->isNewWindow = false;
+		sample->profile = window == profiledWindow;
+		sample->sampledFields = WindowInvestigator_DirtySet_TakeAt(&monitor->dirtySet, index);
+	}
+}
+
+void WindowInvestigator_Monitor_BeginTick(WindowInvestigator_Monitor* monitor) {
+	if (monitor->tickInProgress) abort();
+	monitor->tickInProgress = true;
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+
+	const uint64_t tick = monitor->tick++;
+	const bool sampleAllFields = monitor->sampleAllFieldsOnNextTick;
+	monitor->sampleAllFieldsOnNextTick = false;
+
+	// Cost profiling goes through the windows in Z-order, one window per profiling tick.
+	size_t profiledZOrder = SIZE_MAX;
+	const size_t previousWindowCount = WindowInvestigator_WindowTable_GetZOrderCount(&monitor->windows);
+	if (previousWindowCount != 0 && WindowInvestigator_SamplingScheduler_IsCostProfilingTick(&monitor->sampling, tick))
+		profiledZOrder = (size_t)((tick / monitor->sampling.policy.costProfilingPeriod) % previousWindowCount);
+
+	bool enumerate = true;
+	uintptr_t profiledWindow = 0;
+	if (monitor->options.incremental) {
+		WindowInvestigator_Monitor_SweepWindows(monitor);
+		// Profiling does not require enumerating: the profiled window is picked from the previous Z-order instead.
+		if (profiledZOrder != SIZE_MAX) {
+			profiledWindow = WindowInvestigator_WindowTable_GetWindow(&monitor->windows, WindowInvestigator_WindowTable_GetZOrderSlot(&monitor->windows, profiledZOrder));
+			WindowInvestigator_DirtySet_MarkDirty(&monitor->dirtySet, profiledWindow, WindowInvestigator_WindowField_ALL);
+		}
+		enumerate = sampleAllFields || WindowInvestigator_DirtySet_IsEnumerationDue(&monitor->dirtySet) || WindowInvestigator_Monitor_IsEnumerationNeeded(monitor);
+		WindowInvestigator_DirtySet_BeginPass(&monitor->dirtySet, startTime, enumerate);
+	}
+	monitor->partialTick = !enumerate;
+
+	monitor->sampleCount = 0;
+	if (enumerate)
+		WindowInvestigator_Monitor_EnumerateWindows(monitor, tick, sampleAllFields, profiledZOrder);
+	else
+		WindowInvestigator_Monitor_AddDirtyWindows(monitor, profiledWindow);
+	if (monitor->options.incremental) WindowInvestigator_DirtySet_EndPass(&monitor->dirtySet, startTime);
+
+	const size_t workerCount = monitor->options.workerCount == 0 ? 1 : monitor->options.workerCount;
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+		monitor->workers[workerIndex].stringBufferLength = 0;
+	// Without workers, the windows are sampled within Submit().
+	WindowInvestigator_Histogram_Record(&monitor->phaseDurations[WindowInvestigator_MonitorPhase_ENUMERATION], WindowInvestigator_GetTimeNanoseconds() - startTime);
+	WindowInvestigator_WorkerPool_Submit(&monitor->workerPool, monitor->sampleCount, monitor->options.windowsPerBatch, WindowInvestigator_Monitor_SampleWindows, monitor, WindowInvestigator_Monitor_OnSamplesReady, monitor);
+}
+
+void WindowInvestigator_Monitor_FinishTick(WindowInvestigator_Monitor* monitor) {
+	const WindowInvestigator_MonitorSink* const sink = &monitor->sink;
+	if (!monitor->tickInProgress) abort();
+	WindowInvestigator_WorkerPool_Wait(&monitor->workerPool);
+	const uint64_t startTime = WindowInvestigator_GetTimeNanoseconds();
+
+	bool windowsChanged = false;
+	for (size_t zOrder = 0; zOrder < monitor->sampleCount; ++zOrder) {
+		WindowInvestigator_MonitorWindowSample* const sample = &monitor->samples[zOrder];
+		const WindowInvestigator_MonitorWorker* const worker = &monitor->workers[sample->workerIndex];
+		if (sample->pendingStrings & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+			sample->windowInfo.className = WindowInvestigator_Monitor_InternPendingString(monitor, worker, &sample->pendingClassName);
+		if (sample->pendingStrings & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+			sample->windowInfo.text = WindowInvestigator_Monitor_InternPendingString(monitor, worker, &sample->pendingText);
+
+		WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(&monitor->windows, sample->slot);
+		if (sample->isNewWindow) {
+			*windowInfo = sample->windowInfo;
+			monitor->zOrderUpdated = true;
+			sink->onNewWindow(sink->context, sample->window, zOrder, windowInfo);
+		}
+		else if (sample->changedFields != 0) {
+			windowsChanged = true;
+			sink->onWindowChanged(sink->context, sample->window, sample->changedFields, windowInfo, &sample->windowInfo);
+			WindowInvestigator_ReplaceWindowInfo(&monitor->strings, windowInfo, &sample->windowInfo);
+			monitor->statistics.windowInfoBytesCopied += sizeof(*windowInfo);
+		}
+	}
+
+	const size_t workerCount = monitor->options.workerCount == 0 ? 1 : monitor->options.workerCount;
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex) {
+		WindowInvestigator_MonitorWorker* const worker = &monitor->workers[workerIndex];
+		WindowInvestigator_Monitor_AddStatistics(&monitor->statistics, &worker->statistics);
+		memset(&worker->statistics, 0, sizeof(worker->statistics));
+		for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field) {
+			monitor->sampling.costs[field].sampleCount += worker->costs[field].sampleCount;
+			monitor->sampling.costs[field].nanoseconds += worker->costs[field].nanoseconds;
+		}
+		memset(worker->costs, 0, sizeof(worker->costs));
+	}
+
+	// Z-order changes are only known once the enumeration is complete, because we need to see the whole new order to
+	// determine which windows actually moved. Ticks that did not enumerate leave the Z-order as it was.
+	if (!monitor->partialTick) {
+		WindowInvestigator_WindowTable_PassCallbacks passCallbacks;
+		passCallbacks.onWindowGone = WindowInvestigator_Monitor_OnWindowGone;
+		passCallbacks.onZOrderChanged = WindowInvestigator_Monitor_OnZOrderChanged;
+		passCallbacks.context = monitor;
+		WindowInvestigator_WindowTable_EndPass(&monitor->windows, &passCallbacks);
+	}
+	monitor->lastTickChanged = windowsChanged || monitor->zOrderUpdated;
+	if (monitor->zOrderUpdated) {
+		sink->onZOrderUpdated(sink->context, WindowInvestigator_WindowTable_GetZOrderCount(&monitor->windows));
+		monitor->zOrderUpdated = false;
+	}
+	if (monitor->lastTickChanged) sink->onTickFinished(sink->context);
+
+	WindowInvestigator_Histogram_Record(&monitor->phaseDurations[WindowInvestigator_MonitorPhase_DIFF], WindowInvestigator_GetTimeNanoseconds() - startTime);
+	monitor->tickInProgress = false;
+}
+
+void WindowInvestigator_Monitor_Tick(WindowInvestigator_Monitor* monitor) {
+	WindowInvestigator_Monitor_BeginTick(monitor);
+	WindowInvestigator_Monitor_FinishTick(monitor);
+}
+
+void WindowInvestigator_Monitor_Notify(WindowInvestigator_Monitor* monitor, WindowInvestigator_WindowNotification notification, uintptr_t window, uint64_t timestamp) {
+	if (monitor->options.incremental) WindowInvestigator_DirtySet_Notify(&monitor->dirtySet, notification, window, timestamp);
+}
+
+void WindowInvestigator_Monitor_SampleAllFieldsOnNextTick(WindowInvestigator_Monitor* monitor) {
+	monitor->sampleAllFieldsOnNextTick = true;
+}
+
+void WindowInvestigator_Monitor_LogWindows(const WindowInvestigator_Monitor* monitor) {
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(&monitor->windows);
+	monitor->sink.onLogWindowsBegin(monitor->sink.context, windowCount);
+	for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(&monitor->windows, zOrder);
+		monitor->sink.onLogWindow(monitor->sink.context, WindowInvestigator_WindowTable_GetWindow(&monitor->windows, slot), zOrder, WindowInvestigator_WindowTable_GetValue(&monitor->windows, slot));
+	}
+}
+
+void WindowInvestigator_Monitor_GetPhaseDurations(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorPhase phase, WindowInvestigator_Histogram* histogram) {
+	if (monitor->tickInProgress) abort();
+	if (phase != WindowInvestigator_MonitorPhase_WINDOW_CAPTURE) {
+		WindowInvestigator_Histogram_Merge(histogram, &monitor->phaseDurations[phase]);
+		return;
+	}
+	const size_t workerCount = monitor->options.workerCount == 0 ? 1 : monitor->options.workerCount;
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+		WindowInvestigator_Histogram_Merge(histogram, &monitor->workers[workerIndex].windowCaptureDurations);
+}
+
+void WindowInvestigator_Monitor_ResetPhaseDurations(WindowInvestigator_Monitor* monitor) {
+	if (monitor->tickInProgress) abort();
+	for (int phase = 0; phase < WindowInvestigator_MonitorPhase_COUNT; ++phase)
+		WindowInvestigator_Histogram_Reset(&monitor->phaseDurations[phase]);
+	const size_t workerCount = monitor->options.workerCount == 0 ? 1 : monitor->options.workerCount;
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+		WindowInvestigator_Histogram_Reset(&monitor->workers[workerIndex].windowCaptureDurations);
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "dirty_set.h"
+#include "histogram.h"
+#include "sampling.h"
+#include "string_pool.h"
+#include "window_info.h"
+#include "window_table.h"
+#include "worker_pool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Platform-independent WindowMonitor engine: keeps track of the state of every visible top-level window, and reports
+// differences between successive snapshots.
+//
+// The engine gets its data from a backend (e.g. user32 on Windows, or a simulated desktop) and reports events to a sink (e.g.
+// ETW). Window handles are passed around as opaque integers.
+//
+// Window properties can be collected by a pool of worker threads, so that a window that is slow to respond does not hold up
+// the others, nor the thread that drives the monitor (which in WindowMonitor is also the thread that receives the messages
+// we are trying to timestamp). That thread only enumerates windows and dispatches them to the workers; the results are then
+// merged back in Z-order before changes are reported, so the sink sees the same sequence of events regardless of the number
+// of workers.
+
+// In incremental mode, the engine does not enumerate and read every window on every tick: it relies on change notifications
+// (see WindowInvestigator_Monitor_Notify()) to only re-read the windows that changed, and only enumerates windows when the
+// notifications show that the Z-order or the set of visible windows may have changed. A reconciliation policy makes up for
+// missed notifications; see dirty_set.h.
+
+// getNextWindow and isWindowVisible are only called from the thread that drives the monitor. getWindowInfo is called from
+// worker threads, concurrently, if the monitor has workers.
+typedef struct {
+	// Returns the top-level window that follows the specified window in Z-order, or the frontmost window if window is 0.
+	// Returns 0 if there are no more windows.
+	uintptr_t (*getNextWindow)(void* context, uintptr_t window);
+	bool (*isWindowVisible)(void* context, uintptr_t window);
+	// Fills the fields of windowInfo that are in fields (bitmask of WindowInvestigator_WindowField_BIT()), except the string
+	// IDs, which are set by the engine from windowStrings. The backend should avoid querying anything it doesn't need to fill
+	// these fields; the other fields of windowInfo hold the previous values and must be left alone.
+	void (*getWindowInfo)(void* context, uintptr_t window, uint32_t fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings);
+	void* context;
+} WindowInvestigator_MonitorBackend;
+
+// String IDs in the window snapshots refer to WindowInvestigator_Monitor::strings.
+typedef struct {
+	void (*onNewWindow)(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo);
+	// changedFields is a non-zero bitmask of WindowInvestigator_WindowField_BIT().
+	void (*onWindowChanged)(void* context, uintptr_t window, uint32_t changedFields, const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo);
+	void (*onWindowZOrderChanged)(void* context, uintptr_t window, size_t previousZOrder, size_t zOrder);
+	void (*onWindowGone)(void* context, uintptr_t window);
+	// Called at the end of a tick during which windows appeared, disappeared or moved in the Z-order, after all of these have
+	// been reported. windowCount is the number of windows in the new Z-order. Every window that did not move keeps its
+	// relative order, so this makes it possible to rebuild the complete Z-order from the events.
+	void (*onZOrderUpdated)(void* context, size_t windowCount);
+	// Called at the end of every tick that reported anything else, after everything else, so that consumers that read the
+	// events back (e.g. a capture replay) know where each tick ends without having to guess.
+	void (*onTickFinished)(void* context);
+	// Called by WindowInvestigator_Monitor_LogWindows(), followed by onLogWindow for every window, frontmost first.
+	void (*onLogWindowsBegin)(void* context, size_t windowCount);
+	void (*onLogWindow)(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo);
+	void* context;
+} WindowInvestigator_MonitorSink;
+
+typedef struct {
+	// Bytes of window snapshots written by the engine, i.e. excluding what the backend writes into its output parameters.
+	uint64_t windowInfoBytesCopied;
+	uint64_t getWindowInfoCalls;
+	// Number of fields requested from the backend, summed over all getWindowInfo calls.
+	uint64_t fieldsSampled;
+	// Number of times each field was requested from the backend.
+	uint64_t fieldSamples[WindowInvestigator_WindowField_COUNT];
+	// Calls to WindowInvestigator_MonitorOptions::filterWindow.
+	uint64_t filterWindowCalls;
+} WindowInvestigator_MonitorStatistics;
+
+// Phases of a tick whose durations are recorded by the engine, in nanoseconds.
+typedef enum {
+	// Enumerating windows and dispatching them to the workers, i.e. WindowInvestigator_Monitor_BeginTick(). Once per tick.
+	WindowInvestigator_MonitorPhase_ENUMERATION,
+	// Collecting the properties of one window, including the backend calls and comparing them with the previous values.
+	// Once per window per tick, on the workers.
+	WindowInvestigator_MonitorPhase_WINDOW_CAPTURE,
+	// Merging the results of the workers and reporting the differences to the sink, i.e. WindowInvestigator_Monitor_FinishTick()
+	// once the workers are done. Once per tick.
+	WindowInvestigator_MonitorPhase_DIFF,
+	WindowInvestigator_MonitorPhase_COUNT,
+} WindowInvestigator_MonitorPhase;
+
+const char* WindowInvestigator_MonitorPhase_GetName(WindowInvestigator_MonitorPhase phase);
+
+typedef struct {
+	WindowInvestigator_SamplingPolicy samplingPolicy;
+	// Number of threads that collect window properties. 0 means properties are collected on the thread that calls
+	// WindowInvestigator_Monitor_BeginTick().
+	size_t workerCount;
+	// Number of windows that are handed out to a worker at a time.
+	size_t windowsPerBatch;
+	// If not NULL, called once the tick started by WindowInvestigator_Monitor_BeginTick() can be finished without blocking.
+	// Can be called on a worker thread, or from within WindowInvestigator_Monitor_BeginTick(). Must not call back into the
+	// monitor.
+	void (*onTickReady)(void* context);
+	void* onTickReadyContext;
+	// If not NULL, only the windows for which this returns true are monitored; the others are ignored entirely, and the
+	// Z-order only covers the windows that are monitored. Called right after enumeration, before any property is collected,
+	// on the thread that calls WindowInvestigator_Monitor_BeginTick(). The result is remembered for as long as the window stays
+	// visible, so this is only called once for each window that appears. Must not call back into the monitor.
+	bool (*filterWindow)(void* context, uintptr_t window);
+	void* filterWindowContext;
+	// If true, windows are only read when notified, or when due according to dirtySetOptions, instead of according to the
+	// sampling policy; the policy only decides which fields are triggered by changes in others, and how often windows are
+	// profiled.
+	bool incremental;
+	WindowInvestigator_DirtySetOptions dirtySetOptions;
+} WindowInvestigator_MonitorOptions;
+
+// Properties of a window as collected during the current tick.
+typedef struct {
+	// Offset of the string in the worker string buffer.
+	size_t offset;
+	size_t length;
+	uint64_t hash;
+} WindowInvestigator_MonitorPendingString;
+
+typedef struct {
+	uintptr_t window;
+	size_t slot;
+	bool isNewWindow;
+	bool profile;
+	uint32_t sampledFields;
+
+	// Set by the worker. Strings that changed are not interned until the tick is finished; until then, they are kept in the
+	// string buffer of the worker, and the corresponding string IDs in windowInfo still hold the previous values.
+	size_t workerIndex;
+	WindowInvestigator_WindowInfo windowInfo;
+	uint32_t changedFields;
+	uint32_t pendingStrings;
+	WindowInvestigator_MonitorPendingString pendingClassName;
+	WindowInvestigator_MonitorPendingString pendingText;
+} WindowInvestigator_MonitorWindowSample;
+
+// Per-worker scratch space. Only touched by the worker during a tick.
+typedef struct {
+	WindowInvestigator_WindowStrings windowStrings;
+	wchar_t* stringBuffer;
+	size_t stringBufferLength;
+	size_t stringBufferCapacity;
+	WindowInvestigator_FieldCost costs[WindowInvestigator_WindowField_COUNT];
+	WindowInvestigator_MonitorStatistics statistics;
+	// Not merged into the monitor at the end of each tick, as that would cost more than recording the values in the first
+	// place; see WindowInvestigator_Monitor_GetPhaseDurations().
+	WindowInvestigator_Histogram windowCaptureDurations;
+} WindowInvestigator_MonitorWorker;
+
+typedef struct {
+	WindowInvestigator_MonitorBackend backend;
+	WindowInvestigator_MonitorSink sink;
+	WindowInvestigator_MonitorOptions options;
+	WindowInvestigator_WindowTable windows;
+	// Visible windows that were rejected by WindowInvestigator_MonitorOptions::filterWindow. Holds no values.
+	WindowInvestigator_WindowTable filteredOutWindows;
+	WindowInvestigator_StringPool strings;
+	WindowInvestigator_SamplingScheduler sampling;
+	uint64_t tick;
+	bool sampleAllFieldsOnNextTick;
+	bool tickInProgress;
+	// Set if windows appeared, disappeared or moved during the current tick.
+	bool zOrderUpdated;
+	// Set by WindowInvestigator_Monitor_FinishTick() if the tick reported any change.
+	bool lastTickChanged;
+	// Set if the current tick only reads dirty windows, without enumerating. Only in incremental mode.
+	bool partialTick;
+	// Only used in incremental mode.
+	WindowInvestigator_DirtySet dirtySet;
+
+	WindowInvestigator_WorkerPool workerPool;
+	WindowInvestigator_MonitorWorker* workers;
+	WindowInvestigator_MonitorWindowSample* samples;
+	size_t sampleCount;
+	size_t sampleCapacity;
+
+	WindowInvestigator_MonitorStatistics statistics;
+	// One per phase; WINDOW_CAPTURE is kept by the workers instead.
+	WindowInvestigator_Histogram* phaseDurations;
+} WindowInvestigator_Monitor;
+
+// Samples every tick according to the tiered sampling policy, without worker threads, and not incrementally.
+void WindowInvestigator_Monitor_GetDefaultOptions(WindowInvestigator_MonitorOptions* options);
+
+void WindowInvestigator_Monitor_Init(WindowInvestigator_Monitor* monitor, const WindowInvestigator_MonitorBackend* backend, const WindowInvestigator_MonitorSink* sink, const WindowInvestigator_MonitorOptions* options);
+void WindowInvestigator_Monitor_Destroy(WindowInvestigator_Monitor* monitor);
+
+// Enumerates all visible top-level windows and reports any changes since the previous call.
+void WindowInvestigator_Monitor_Tick(WindowInvestigator_Monitor* monitor);
+// Same as WindowInvestigator_Monitor_Tick(), split in two halves: BeginTick() enumerates the windows and dispatches them to
+// the workers, and FinishTick() waits for the workers and reports changes. No other monitor function can be called in
+// between.
+void WindowInvestigator_Monitor_BeginTick(WindowInvestigator_Monitor* monitor);
+void WindowInvestigator_Monitor_FinishTick(WindowInvestigator_Monitor* monitor);
+// Reports that something happened to a window at the specified time (see WindowInvestigator_GetTimeNanoseconds()). Only
+// used in incremental mode. Can be called while a tick is in progress, but only from the thread that drives the monitor.
+void WindowInvestigator_Monitor_Notify(WindowInvestigator_Monitor* monitor, WindowInvestigator_WindowNotification notification, uintptr_t window, uint64_t timestamp);
+// Makes the next tick sample every field of every window regardless of the sampling policy, e.g. so that the snapshots are
+// fully up to date before they are logged.
+void WindowInvestigator_Monitor_SampleAllFieldsOnNextTick(WindowInvestigator_Monitor* monitor);
+// Reports the full state of every window as of the last tick.
+void WindowInvestigator_Monitor_LogWindows(const WindowInvestigator_Monitor* monitor);
+
+// Adds the durations recorded for the specified phase since WindowInvestigator_Monitor_Init() or
+// WindowInvestigator_Monitor_ResetPhaseDurations() to histogram. Neither can be called while a tick is in progress.
+void WindowInvestigator_Monitor_GetPhaseDurations(const WindowInvestigator_Monitor* monitor, WindowInvestigator_MonitorPhase phase, WindowInvestigator_Histogram* histogram);
+void WindowInvestigator_Monitor_ResetPhaseDurations(WindowInvestigator_Monitor* monitor);
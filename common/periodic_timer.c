@@ -0,0 +1,102 @@
+#include "periodic_timer.h"
+
+#include "allocation.h"
+#include "clock.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <time.h>
+#endif
+
+#ifdef _WIN32
+// Only defined by recent Windows SDKs.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+// Sleeps until approximately the specified time (see WindowInvestigator_GetTimeNanoseconds()).
+static void WindowInvestigator_PeriodicTimer_SleepUntil(WindowInvestigator_PeriodicTimer* timer, uint64_t time) {
+#ifdef _WIN32
+	const uint64_t now = WindowInvestigator_GetTimeNanoseconds();
+	if (time <= now) return;
+	if (timer->waitableTimer == NULL) {
+		WindowInvestigator_SleepNanoseconds(time - now);
+		return;
+	}
+	// Negative means relative, in 100 ns units.
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -(LONGLONG)((time - now) / 100);
+	if (!SetWaitableTimer(timer->waitableTimer, &dueTime, 0, NULL, NULL, FALSE) || WaitForSingleObject(timer->waitableTimer, INFINITE) != WAIT_OBJECT_0)
+		WindowInvestigator_SleepNanoseconds(time - WindowInvestigator_GetTimeNanoseconds());
+#else
+	(void)timer;
+	struct timespec deadline;
+	deadline.tv_sec = (time_t)(time / UINT64_C(1000000000));
+	deadline.tv_nsec = (long)(time % UINT64_C(1000000000));
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+#endif
+}
+
+void WindowInvestigator_PeriodicTimer_GetDefaultOptions(WindowInvestigator_PeriodicTimerOptions* options) {
+	options->periodNanoseconds = 2000000;
+#ifdef _WIN32
+	options->spinNanoseconds = 1000000;
+#else
+	options->spinNanoseconds = 100000;
+#endif
+}
+
+void WindowInvestigator_PeriodicTimer_Init(WindowInvestigator_PeriodicTimer* timer, const WindowInvestigator_PeriodicTimerOptions* options) {
+	timer->options = *options;
+	if (timer->options.periodNanoseconds == 0) timer->options.periodNanoseconds = 1;
+#ifdef _WIN32
+	timer->waitableTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+	timer->deadline = WindowInvestigator_GetTimeNanoseconds() + timer->options.periodNanoseconds;
+	timer->lastWakeupTime = 0;
+	timer->lateness = WindowInvestigator_Reallocate(NULL, 1, sizeof(*timer->lateness));
+	timer->period = WindowInvestigator_Reallocate(NULL, 1, sizeof(*timer->period));
+	WindowInvestigator_PeriodicTimer_ResetStatistics(timer);
+}
+
+void WindowInvestigator_PeriodicTimer_Destroy(WindowInvestigator_PeriodicTimer* timer) {
+#ifdef _WIN32
+	if (timer->waitableTimer != NULL) CloseHandle(timer->waitableTimer);
+#endif
+	WindowInvestigator_Free(timer->lateness);
+	WindowInvestigator_Free(timer->period);
+}
+
+uint64_t WindowInvestigator_PeriodicTimer_WaitUntil(WindowInvestigator_PeriodicTimer* timer, uint64_t deadline) {
+	uint64_t now = WindowInvestigator_GetTimeNanoseconds();
+	if (deadline > now + timer->options.spinNanoseconds) {
+		WindowInvestigator_PeriodicTimer_SleepUntil(timer, deadline - timer->options.spinNanoseconds);
+		now = WindowInvestigator_GetTimeNanoseconds();
+	}
+	while (now < deadline) now = WindowInvestigator_GetTimeNanoseconds();
+	WindowInvestigator_Histogram_Record(timer->lateness, now - deadline);
+	return now;
+}
+
+uint64_t WindowInvestigator_PeriodicTimer_Wait(WindowInvestigator_PeriodicTimer* timer) {
+	const uint64_t period = timer->options.periodNanoseconds;
+	uint64_t now = WindowInvestigator_GetTimeNanoseconds();
+	if (now >= timer->deadline + period) {
+		const uint64_t missedDeadlines = (now - timer->deadline) / period;
+		timer->deadline += missedDeadlines * period;
+		timer->missedDeadlines += missedDeadlines;
+	}
+
+	now = WindowInvestigator_PeriodicTimer_WaitUntil(timer, timer->deadline);
+	if (timer->lastWakeupTime != 0) WindowInvestigator_Histogram_Record(timer->period, now - timer->lastWakeupTime);
+	timer->lastWakeupTime = now;
+	timer->deadline += period;
+	return now;
+}
+
+void WindowInvestigator_PeriodicTimer_ResetStatistics(WindowInvestigator_PeriodicTimer* timer) {
+	WindowInvestigator_Histogram_Reset(timer->lateness);
+	WindowInvestigator_Histogram_Reset(timer->period);
+	timer->missedDeadlines = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "histogram.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <stdint.h>
+
+// Wakes up the calling thread at regular intervals, as precisely as possible, and keeps track of how precise it actually was.
+//
+// OS sleep primitives are only precise to within the scheduler tick (about 1 ms on Windows even after timeBeginPeriod(1), and
+// timer coalescing can make it worse), so the timer sleeps until shortly before each deadline and then spins on the
+// high-resolution clock for the rest of the way. Deadlines are absolute, so that lateness does not accumulate from one period
+// to the next. If a deadline is missed by more than a whole period (e.g. because the work took too long), the missed periods
+// are skipped instead of being caught up in a burst.
+//
+// The sleep is done with clock_nanosleep() on an absolute CLOCK_MONOTONIC deadline, or on Windows with a high-resolution
+// waitable timer if the system supports it (Windows 10 1803 or later), falling back to Sleep() otherwise.
+
+typedef struct {
+	uint64_t periodNanoseconds;
+	// How long before each deadline to stop sleeping and start spinning. 0 means never spin.
+	uint64_t spinNanoseconds;
+} WindowInvestigator_PeriodicTimerOptions;
+
+typedef struct {
+	WindowInvestigator_PeriodicTimerOptions options;
+#ifdef _WIN32
+	// NULL if high-resolution waitable timers are not supported.
+	HANDLE waitableTimer;
+#endif
+	uint64_t deadline;
+	// 0 before the first wakeup.
+	uint64_t lastWakeupTime;
+
+	// Statistics, until the next call to WindowInvestigator_PeriodicTimer_ResetStatistics().
+	// Time between each deadline and the corresponding wakeup, in nanoseconds.
+	WindowInvestigator_Histogram* lateness;
+	// Time between consecutive wakeups, in nanoseconds.
+	WindowInvestigator_Histogram* period;
+	// Number of deadlines that were skipped because the previous one was missed by more than a whole period.
+	uint64_t missedDeadlines;
+} WindowInvestigator_PeriodicTimer;
+
+// 2 ms, spinning for the last 1 ms on Windows and the last 100 us elsewhere.
+void WindowInvestigator_PeriodicTimer_GetDefaultOptions(WindowInvestigator_PeriodicTimerOptions* options);
+
+// The first deadline is one period from now.
+void WindowInvestigator_PeriodicTimer_Init(WindowInvestigator_PeriodicTimer* timer, const WindowInvestigator_PeriodicTimerOptions* options);
+void WindowInvestigator_PeriodicTimer_Destroy(WindowInvestigator_PeriodicTimer* timer);
+
+// Blocks until the next deadline, and returns the time at which the thread woke up (see WindowInvestigator_GetTimeNanoseconds()).
+uint64_t WindowInvestigator_PeriodicTimer_Wait(WindowInvestigator_PeriodicTimer* timer);
+// Same, but for an arbitrary deadline (e.g. to pace events that are not evenly spaced). Does not affect the periodic deadlines,
+// nor the period statistics; lateness is recorded as usual. Returns immediately if the deadline has already passed.
+uint64_t WindowInvestigator_PeriodicTimer_WaitUntil(WindowInvestigator_PeriodicTimer* timer, uint64_t deadline);
+
+void WindowInvestigator_PeriodicTimer_ResetStatistics(WindowInvestigator_PeriodicTimer* timer);
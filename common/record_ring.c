@@ -0,0 +1,58 @@
+#include "record_ring.h"
+
+#include "allocation.h"
+#include "atomic.h"
+
+#include <string.h>
+
+void WindowInvestigator_RecordRing_Init(WindowInvestigator_RecordRing* ring, size_t slotSize, size_t capacity) {
+	memset(ring, 0, sizeof(*ring));
+	ring->capacity = 1;
+	while (ring->capacity < capacity) ring->capacity *= 2;
+	ring->slotSize = slotSize;
+	ring->slots = WindowInvestigator_Reallocate(NULL, ring->capacity, slotSize);
+}
+
+void WindowInvestigator_RecordRing_Destroy(WindowInvestigator_RecordRing* ring) {
+	WindowInvestigator_Free(ring->slots);
+}
+
+void* WindowInvestigator_RecordRing_BeginWrite(WindowInvestigator_RecordRing* ring) {
+	const uint64_t head = ring->head;
+	if (head - WindowInvestigator_Atomic_LoadAcquire(&ring->tail) >= ring->capacity) {
+		WindowInvestigator_Atomic_StoreRelease(&ring->dropped, ring->dropped + 1);
+		return NULL;
+	}
+	return ring->slots + (size_t)(head & (ring->capacity - 1)) * ring->slotSize;
+}
+
+void WindowInvestigator_RecordRing_EndWrite(WindowInvestigator_RecordRing* ring) {
+	const uint64_t head = ring->head + 1;
+	// The consumer can make progress between this load and the publication of the record below, so this can overestimate the
+	// occupancy by the few records consumed in between.
+	const uint64_t occupancy = head - WindowInvestigator_Atomic_LoadAcquire(&ring->tail);
+	if (occupancy > ring->highWaterMark) WindowInvestigator_Atomic_StoreRelease(&ring->highWaterMark, occupancy);
+	WindowInvestigator_Atomic_StoreRelease(&ring->head, head);
+}
+
+const void* WindowInvestigator_RecordRing_BeginRead(WindowInvestigator_RecordRing* ring) {
+	const uint64_t tail = ring->tail;
+	if (WindowInvestigator_Atomic_LoadAcquire(&ring->head) == tail) return NULL;
+	return ring->slots + (size_t)(tail & (ring->capacity - 1)) * ring->slotSize;
+}
+
+void WindowInvestigator_RecordRing_EndRead(WindowInvestigator_RecordRing* ring) {
+	WindowInvestigator_Atomic_StoreRelease(&ring->tail, ring->tail + 1);
+}
+
+uint64_t WindowInvestigator_RecordRing_GetCount(const WindowInvestigator_RecordRing* ring) {
+	return ring->head - WindowInvestigator_Atomic_LoadAcquire(&ring->tail);
+}
+
+uint64_t WindowInvestigator_RecordRing_GetHighWaterMark(const WindowInvestigator_RecordRing* ring) {
+	return WindowInvestigator_Atomic_LoadAcquire(&ring->highWaterMark);
+}
+
+uint64_t WindowInvestigator_RecordRing_GetDroppedCount(const WindowInvestigator_RecordRing* ring) {
+	return WindowInvestigator_Atomic_LoadAcquire(&ring->dropped);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded lock-free ring buffer of fixed-size records, for exactly one producer thread and one consumer thread.
+//
+// The producer never blocks: if the ring is full, the record is dropped and counted. Records are written and read in place,
+// so that a record is never copied between the ring and the caller.
+
+// Assumed size of a cache line. The producer and consumer positions are kept on separate cache lines so that the two threads
+// do not keep stealing each other's line.
+#define WindowInvestigator_RecordRing_CACHE_LINE_SIZE 64
+
+typedef struct {
+	unsigned char* slots;
+	size_t slotSize;
+	// Power of two.
+	size_t capacity;
+	unsigned char padding0[WindowInvestigator_RecordRing_CACHE_LINE_SIZE];
+
+	// Written by the producer only. head is the number of records written so far.
+	volatile uint64_t head;
+	volatile uint64_t highWaterMark;
+	volatile uint64_t dropped;
+	unsigned char padding1[WindowInvestigator_RecordRing_CACHE_LINE_SIZE - 3 * sizeof(uint64_t)];
+
+	// Written by the consumer only. tail is the number of records read so far.
+	volatile uint64_t tail;
+	unsigned char padding2[WindowInvestigator_RecordRing_CACHE_LINE_SIZE - sizeof(uint64_t)];
+} WindowInvestigator_RecordRing;
+
+// capacity is rounded up to a power of two.
+void WindowInvestigator_RecordRing_Init(WindowInvestigator_RecordRing* ring, size_t slotSize, size_t capacity);
+void WindowInvestigator_RecordRing_Destroy(WindowInvestigator_RecordRing* ring);
+
+// Producer side. Returns the slot to write the next record into, or NULL if the ring is full, in which case the record counts
+// as dropped. The record becomes visible to the consumer once WindowInvestigator_RecordRing_EndWrite() is called.
+void* WindowInvestigator_RecordRing_BeginWrite(WindowInvestigator_RecordRing* ring);
+void WindowInvestigator_RecordRing_EndWrite(WindowInvestigator_RecordRing* ring);
+
+// Consumer side. Returns the oldest record, or NULL if the ring is empty. The slot is handed back to the producer once
+// WindowInvestigator_RecordRing_EndRead() is called.
+const void* WindowInvestigator_RecordRing_BeginRead(WindowInvestigator_RecordRing* ring);
+void WindowInvestigator_RecordRing_EndRead(WindowInvestigator_RecordRing* ring);
+
+// Producer side. Number of records that have been written but not read yet.
+uint64_t WindowInvestigator_RecordRing_GetCount(const WindowInvestigator_RecordRing* ring);
+
+// These can be called from any thread.
+// Largest number of records that were ever waiting in the ring at the same time.
+uint64_t WindowInvestigator_RecordRing_GetHighWaterMark(const WindowInvestigator_RecordRing* ring);
+// Number of records that were dropped because the ring was full.
+uint64_t WindowInvestigator_RecordRing_GetDroppedCount(const WindowInvestigator_RecordRing* ring);
@@ -0,0 +1,436 @@
+#include "replay.h"
+
+#include "allocation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Events in the order they were recorded or replayed, since the events were last lined up.
+typedef struct {
+	WindowInvestigator_CaptureRecordHeader* headers;
+	size_t* payloadOffsets;
+	size_t count;
+	size_t capacity;
+	unsigned char* payloads;
+	size_t payloadSize;
+	size_t payloadCapacity;
+} WindowInvestigator_ReplayEvents;
+
+static void WindowInvestigator_ReplayEvents_Destroy(WindowInvestigator_ReplayEvents* events) {
+	WindowInvestigator_Free(events->headers);
+	WindowInvestigator_Free(events->payloadOffsets);
+	WindowInvestigator_Free(events->payloads);
+}
+
+static void WindowInvestigator_ReplayEvents_Push(WindowInvestigator_ReplayEvents* events, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload) {
+	if (events->count == events->capacity) {
+		events->capacity = events->capacity == 0 ? 256 : events->capacity * 2;
+		events->headers = WindowInvestigator_Reallocate(events->headers, events->capacity, sizeof(*events->headers));
+		events->payloadOffsets = WindowInvestigator_Reallocate(events->payloadOffsets, events->capacity, sizeof(*events->payloadOffsets));
+	}
+	if (events->payloadCapacity - events->payloadSize < header->payloadSize) {
+		while (events->payloadCapacity - events->payloadSize < header->payloadSize)
+			events->payloadCapacity = events->payloadCapacity == 0 ? 65536 : events->payloadCapacity * 2;
+		events->payloads = WindowInvestigator_Reallocate(events->payloads, events->payloadCapacity, 1);
+	}
+	events->headers[events->count] = *header;
+	events->payloadOffsets[events->count] = events->payloadSize;
+	++events->count;
+	if (header->payloadSize != 0) memcpy(events->payloads + events->payloadSize, payload, header->payloadSize);
+	events->payloadSize += header->payloadSize;
+}
+
+static void WindowInvestigator_ReplayEvents_Clear(WindowInvestigator_ReplayEvents* events) {
+	events->count = 0;
+	events->payloadSize = 0;
+}
+
+// Timestamps aside.
+static bool WindowInvestigator_ReplayEvents_Equal(const WindowInvestigator_ReplayEvents* left, size_t leftIndex, const WindowInvestigator_ReplayEvents* right, size_t rightIndex) {
+	const WindowInvestigator_CaptureRecordHeader* const leftHeader = &left->headers[leftIndex];
+	const WindowInvestigator_CaptureRecordHeader* const rightHeader = &right->headers[rightIndex];
+	return leftHeader->window == rightHeader->window && leftHeader->type == rightHeader->type && leftHeader->zOrder == rightHeader->zOrder &&
+		leftHeader->previousZOrder == rightHeader->previousZOrder && leftHeader->payloadSize == rightHeader->payloadSize &&
+		memcmp(left->payloads + left->payloadOffsets[leftIndex], right->payloads + right->payloadOffsets[rightIndex], leftHeader->payloadSize) == 0;
+}
+
+// Parts of a tick, in the order WindowInvestigator_Monitor_FinishTick() reports them.
+typedef enum {
+	// Not in a tick.
+	WindowInvestigator_ReplayPhase_NONE,
+	// NEW_WINDOW and WINDOW_CHANGED, in the new Z-order.
+	WindowInvestigator_ReplayPhase_WINDOWS,
+	WindowInvestigator_ReplayPhase_GONE,
+	WindowInvestigator_ReplayPhase_ZORDER_CHANGED,
+	WindowInvestigator_ReplayPhase_ZORDER_UPDATED,
+	WindowInvestigator_ReplayPhase_TICK_FINISHED,
+} WindowInvestigator_ReplayPhase;
+
+#define WindowInvestigator_Replayer_NO_ZORDER SIZE_MAX
+
+typedef struct {
+	WindowInvestigator_EventQueue_OnEvent onEvent;
+	void* context;
+	WindowInvestigator_ReplayStatistics* statistics;
+	uint64_t tickGapNanoseconds;
+	// Set if the capture ends every tick with TICK_FINISHED. Otherwise, tick boundaries are inferred (see replay.h).
+	bool tickFinishedRecords;
+
+	WindowInvestigator_CaptureState state;
+	WindowInvestigator_Monitor monitor;
+	WindowInvestigator_EventQueue eventQueue;
+	bool recomputeRudeWindows;
+	WindowInvestigator_RudeWindowEngine rudeWindowEngine;
+	// Given to replayed events.
+	uint64_t timestamp;
+
+	// Number of records read since the last tick.
+	size_t tickRecordCount;
+	WindowInvestigator_ReplayPhase phase;
+	// Windows reported during the current phase. Holds no values.
+	WindowInvestigator_WindowTable phaseWindows;
+	// During WindowInvestigator_ReplayPhase_WINDOWS: Z-order index of the last window reported as new, or
+	// WindowInvestigator_Replayer_NO_ZORDER. Changed windows cannot be checked the same way, as their index in the new Z-order
+	// is not known until the end of the tick.
+	size_t lastNewWindowZOrder;
+	// Set if windows appeared, disappeared or moved during the tick, in which case the tick ends with ZORDER_UPDATED.
+	bool zOrderUpdatePending;
+	// Rude window changes are evaluated after every tick, but only once the recorded changes have been read.
+	bool evaluationPending;
+	// Set by EVENTS_DROPPED records, and cleared once the monitor caught up with the next complete keyframe.
+	bool uncertain;
+	// Replayed events are discarded while the monitor catches up.
+	bool discardingEvents;
+
+	WindowInvestigator_ReplayEvents recordedEvents;
+	WindowInvestigator_ReplayEvents replayedEvents;
+} WindowInvestigator_Replayer;
+
+static uintptr_t WindowInvestigator_Replayer_GetNextWindow(void* context, uintptr_t window) {
+	const WindowInvestigator_WindowTable* const windows = &((const WindowInvestigator_Replayer*)context)->state.windows;
+	size_t zOrder = 0;
+	if (window != 0) {
+		const size_t slot = WindowInvestigator_WindowTable_Find(windows, window);
+		if (slot == WindowInvestigator_WindowTable_NO_SLOT) return 0;
+		zOrder = WindowInvestigator_WindowTable_GetZOrder(windows, slot);
+		if (zOrder == WindowInvestigator_ZOrderDiff_NEW_WINDOW) return 0;
+		++zOrder;
+	}
+	return zOrder < WindowInvestigator_WindowTable_GetZOrderCount(windows) ? WindowInvestigator_WindowTable_GetWindow(windows, WindowInvestigator_WindowTable_GetZOrderSlot(windows, zOrder)) : 0;
+}
+
+static bool WindowInvestigator_Replayer_IsWindowVisible(void* context, uintptr_t window) {
+	(void)context;
+	(void)window;
+	return true;
+}
+
+// The pool already knows the length and hash of the string, which are what WindowInvestigator_FinishCapturedString() would
+// compute.
+static void WindowInvestigator_Replayer_CaptureString(WindowInvestigator_CapturedString* capturedString, const WindowInvestigator_StringPool* strings, WindowInvestigator_StringId id) {
+	const WindowInvestigator_StringPool_Entry* const entry = &strings->entries[id];
+	const size_t capacity = sizeof(capturedString->string) / sizeof(*capturedString->string);
+	if (entry->length >= capacity) abort();
+	memcpy(capturedString->string, entry->string, entry->length * sizeof(*entry->string));
+	capturedString->string[entry->length] = 0;
+	capturedString->length = entry->length;
+	capturedString->hash = entry->hash;
+}
+
+// Only reads the state, which is not modified during a tick, so this can be called from the workers.
+static void WindowInvestigator_Replayer_GetWindowInfo(void* context, uintptr_t window, uint32_t fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings) {
+	const WindowInvestigator_CaptureState* const state = &((const WindowInvestigator_Replayer*)context)->state;
+	const size_t slot = WindowInvestigator_WindowTable_Find(&state->windows, window);
+	if (slot == WindowInvestigator_WindowTable_NO_SLOT) abort();
+	const WindowInvestigator_WindowInfo* const recordedWindowInfo = WindowInvestigator_WindowTable_GetValue(&state->windows, slot);
+
+	// String IDs are set by the engine.
+	WindowInvestigator_CopyWindowInfoFields(windowInfo, recordedWindowInfo, fields & ~(WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME) | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT)));
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		WindowInvestigator_Replayer_CaptureString(&windowStrings->className, &state->strings, recordedWindowInfo->className);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		WindowInvestigator_Replayer_CaptureString(&windowStrings->text, &state->strings, recordedWindowInfo->text);
+}
+
+static uint64_t WindowInvestigator_Replayer_GetTimestamp(void* context) {
+	return ((const WindowInvestigator_Replayer*)context)->timestamp;
+}
+
+static void WindowInvestigator_Replayer_OnEvent(void* context, const WindowInvestigator_MonitorEvent* event) {
+	WindowInvestigator_Replayer* const replayer = context;
+	if (replayer->discardingEvents) return;
+	++replayer->statistics->eventsReplayed;
+	// Not recorded, so not lined up either.
+	if (event->type == WindowInvestigator_MonitorEvent_TICK_FINISHED && !replayer->tickFinishedRecords) {
+		replayer->onEvent(replayer->context, event);
+		return;
+	}
+	WindowInvestigator_CaptureRecordHeader header;
+	header.timestamp = event->timestamp;
+	header.window = event->window;
+	header.type = (uint32_t)event->type;
+	header.zOrder = event->zOrder;
+	header.previousZOrder = event->previousZOrder;
+	header.payloadSize = event->recordSize;
+	WindowInvestigator_ReplayEvents_Push(&replayer->replayedEvents, &header, event->record);
+	replayer->onEvent(replayer->context, event);
+}
+
+static void WindowInvestigator_Replayer_OnRudeWindowChanged(void* context, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window) {
+	WindowInvestigator_Replayer* const replayer = context;
+	WindowInvestigator_EventQueue_PushRudeWindowChanged(&replayer->eventQueue, monitor, monitorRect, previousWindow, window);
+}
+
+static void WindowInvestigator_Replayer_RecordMismatch(WindowInvestigator_Replayer* replayer, uint64_t timestamp) {
+	if (replayer->uncertain) ++replayer->statistics->uncertainEvents;
+	else if (replayer->statistics->mismatchedEvents++ == 0) replayer->statistics->firstMismatchTimestamp = timestamp;
+}
+
+// Compares the events recorded and replayed since the last call.
+static void WindowInvestigator_Replayer_LineUpEvents(WindowInvestigator_Replayer* replayer) {
+	const WindowInvestigator_ReplayEvents* const recordedEvents = &replayer->recordedEvents;
+	const WindowInvestigator_ReplayEvents* const replayedEvents = &replayer->replayedEvents;
+	const size_t count = recordedEvents->count > replayedEvents->count ? recordedEvents->count : replayedEvents->count;
+	for (size_t index = 0; index < count; ++index) {
+		if (index >= recordedEvents->count) WindowInvestigator_Replayer_RecordMismatch(replayer, replayer->timestamp);
+		else if (index >= replayedEvents->count || !WindowInvestigator_ReplayEvents_Equal(recordedEvents, index, replayedEvents, index))
+			WindowInvestigator_Replayer_RecordMismatch(replayer, recordedEvents->headers[index].timestamp);
+	}
+	WindowInvestigator_ReplayEvents_Clear(&replayer->recordedEvents);
+	WindowInvestigator_ReplayEvents_Clear(&replayer->replayedEvents);
+}
+
+static void WindowInvestigator_Replayer_SetPhase(WindowInvestigator_Replayer* replayer, WindowInvestigator_ReplayPhase phase) {
+	if (phase == replayer->phase) return;
+	replayer->phase = phase;
+	WindowInvestigator_WindowTable_PassCallbacks passCallbacks = { 0 };
+	WindowInvestigator_WindowTable_EndPass(&replayer->phaseWindows, &passCallbacks);
+	WindowInvestigator_WindowTable_BeginPass(&replayer->phaseWindows);
+	replayer->lastNewWindowZOrder = WindowInvestigator_Replayer_NO_ZORDER;
+}
+
+// Replays the tick that the records read since the last tick belong to, if any.
+static void WindowInvestigator_Replayer_Tick(WindowInvestigator_Replayer* replayer) {
+	WindowInvestigator_Replayer_SetPhase(replayer, WindowInvestigator_ReplayPhase_NONE);
+	replayer->zOrderUpdatePending = false;
+	if (replayer->tickRecordCount == 0) return;
+	WindowInvestigator_Monitor_Tick(&replayer->monitor);
+	++replayer->statistics->ticks;
+	replayer->tickRecordCount = 0;
+	replayer->evaluationPending = replayer->recomputeRudeWindows;
+	WindowInvestigator_Replayer_LineUpEvents(replayer);
+}
+
+static void WindowInvestigator_Replayer_EvaluateRudeWindows(WindowInvestigator_Replayer* replayer) {
+	WindowInvestigator_RudeWindowEngine_Evaluate(&replayer->rudeWindowEngine);
+	replayer->evaluationPending = false;
+	WindowInvestigator_Replayer_LineUpEvents(replayer);
+}
+
+// Called when a keyframe ends. If it was complete after events were dropped, it filled in what was lost; the monitor is
+// brought up to date with it silently, as WindowMonitor never saw the changes that it would report.
+static void WindowInvestigator_Replayer_EndKeyframe(WindowInvestigator_Replayer* replayer) {
+	WindowInvestigator_Replayer_LineUpEvents(replayer);
+	if (!replayer->uncertain || replayer->state.inconsistent) return;
+	replayer->discardingEvents = true;
+	WindowInvestigator_Monitor_Tick(&replayer->monitor);
+	if (replayer->recomputeRudeWindows) WindowInvestigator_RudeWindowEngine_Evaluate(&replayer->rudeWindowEngine);
+	replayer->discardingEvents = false;
+	replayer->uncertain = false;
+}
+
+static WindowInvestigator_ReplayPhase WindowInvestigator_Replayer_GetPhase(uint32_t type) {
+	switch (type) {
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+		return WindowInvestigator_ReplayPhase_WINDOWS;
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+		return WindowInvestigator_ReplayPhase_GONE;
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED:
+		return WindowInvestigator_ReplayPhase_ZORDER_CHANGED;
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+		return WindowInvestigator_ReplayPhase_ZORDER_UPDATED;
+	case WindowInvestigator_MonitorEvent_TICK_FINISHED:
+		return WindowInvestigator_ReplayPhase_TICK_FINISHED;
+	}
+	return WindowInvestigator_ReplayPhase_NONE;
+}
+
+// Returns whether the record can belong to the same tick as the records read since the last tick. Records it as part of the
+// tick if so.
+static bool WindowInvestigator_Replayer_ContinueTick(WindowInvestigator_Replayer* replayer, const WindowInvestigator_CaptureRecordHeader* header) {
+	const WindowInvestigator_ReplayPhase phase = WindowInvestigator_Replayer_GetPhase(header->type);
+	if (phase == WindowInvestigator_ReplayPhase_NONE || phase < replayer->phase) return false;
+	if (!replayer->tickFinishedRecords && replayer->tickRecordCount != 0 && phase == replayer->phase && !replayer->zOrderUpdatePending &&
+		header->timestamp - replayer->timestamp > replayer->tickGapNanoseconds) return false;
+	WindowInvestigator_Replayer_SetPhase(replayer, phase);
+	if (phase == WindowInvestigator_ReplayPhase_ZORDER_UPDATED || phase == WindowInvestigator_ReplayPhase_TICK_FINISHED) return true;
+
+	WindowInvestigator_WindowTable_VisitResult visitResult;
+	WindowInvestigator_WindowTable_Visit(&replayer->phaseWindows, (uintptr_t)header->window, &visitResult);
+	if (visitResult == WindowInvestigator_WindowTable_ALREADY_VISITED) return false;
+
+	if (header->type == WindowInvestigator_MonitorEvent_NEW_WINDOW) {
+		if (replayer->lastNewWindowZOrder != WindowInvestigator_Replayer_NO_ZORDER && header->zOrder <= replayer->lastNewWindowZOrder) return false;
+		replayer->lastNewWindowZOrder = header->zOrder;
+	}
+	return true;
+}
+
+static bool WindowInvestigator_Replayer_ProcessRecord(WindowInvestigator_Replayer* replayer, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload) {
+	// The events might have been dropped from the tick being read, so it is uncertain already.
+	if (header->type == WindowInvestigator_MonitorEvent_EVENTS_DROPPED) replayer->uncertain = true;
+	// The tick has to be replayed before the record is applied to the state.
+	if (!WindowInvestigator_Replayer_ContinueTick(replayer, header)) {
+		WindowInvestigator_Replayer_Tick(replayer);
+		WindowInvestigator_Replayer_ContinueTick(replayer, header);
+	}
+	if (replayer->evaluationPending && header->type != WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED)
+		WindowInvestigator_Replayer_EvaluateRudeWindows(replayer);
+
+	if (!WindowInvestigator_CaptureState_Apply(&replayer->state, header, payload)) return false;
+	replayer->timestamp = header->timestamp;
+	// Not replayed, so not lined up either.
+	if (header->type != WindowInvestigator_MonitorEvent_EVENTS_DROPPED) WindowInvestigator_ReplayEvents_Push(&replayer->recordedEvents, header, payload);
+
+	switch (header->type) {
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+		++replayer->tickRecordCount;
+		break;
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED:
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+		++replayer->tickRecordCount;
+		replayer->zOrderUpdatePending = true;
+		break;
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+		++replayer->tickRecordCount;
+		if (!replayer->tickFinishedRecords) WindowInvestigator_Replayer_Tick(replayer);
+		break;
+	case WindowInvestigator_MonitorEvent_TICK_FINISHED:
+		++replayer->tickRecordCount;
+		WindowInvestigator_Replayer_Tick(replayer);
+		break;
+	case WindowInvestigator_MonitorEvent_KEYFRAME:
+		// The monitor is up to date, as keyframes are logged between ticks.
+		WindowInvestigator_Monitor_LogWindows(&replayer->monitor);
+		if (replayer->state.pendingSnapshots == 0) WindowInvestigator_Replayer_EndKeyframe(replayer);
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT:
+		if (replayer->state.pendingSnapshots == 0) WindowInvestigator_Replayer_EndKeyframe(replayer);
+		break;
+	case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE: {
+		uint64_t wParam, lParam;
+		if (!WindowInvestigator_DecodeReceivedMessage(payload, header->payloadSize, &wParam, &lParam)) return false;
+		WindowInvestigator_EventQueue_PushReceivedMessage(&replayer->eventQueue, (WindowInvestigator_ReceivedMessageKind)header->previousZOrder, header->zOrder, wParam, lParam);
+		WindowInvestigator_Replayer_LineUpEvents(replayer);
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED: {
+		// Recomputed changes are lined up once evaluated.
+		if (replayer->recomputeRudeWindows) break;
+		uint64_t previousWindow;
+		WindowInvestigator_Rect monitorRect;
+		if (!WindowInvestigator_DecodeRudeWindowChanged(payload, header->payloadSize, &previousWindow, &monitorRect)) return false;
+		WindowInvestigator_EventQueue_PushRudeWindowChanged(&replayer->eventQueue, header->zOrder, &monitorRect, (uintptr_t)previousWindow, (uintptr_t)header->window);
+		WindowInvestigator_Replayer_LineUpEvents(replayer);
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_EVENTS_DROPPED:
+		replayer->statistics->droppedEventCount = replayer->state.droppedEventCount;
+		break;
+	default:
+		// Not replayed.
+		WindowInvestigator_Replayer_LineUpEvents(replayer);
+	}
+	return true;
+}
+
+void WindowInvestigator_Replay_GetDefaultOptions(WindowInvestigator_ReplayOptions* options) {
+	// Emitting an event takes well under a microsecond, while enumerating the windows takes tens of microseconds even on a
+	// small simulated desktop, and more on a real one.
+	options->tickGapNanoseconds = 20000;
+	options->workerCount = 0;
+	options->monitors = NULL;
+	options->monitorCount = 0;
+}
+
+bool WindowInvestigator_Replay(WindowInvestigator_CaptureReader* reader, const WindowInvestigator_ReplayOptions* options, WindowInvestigator_EventQueue_OnEvent onEvent, void* context, WindowInvestigator_ReplayStatistics* statistics) {
+	memset(statistics, 0, sizeof(*statistics));
+
+	// Too large for the stack.
+	WindowInvestigator_Replayer* const replayer = WindowInvestigator_Reallocate(NULL, 1, sizeof(*replayer));
+	memset(replayer, 0, sizeof(*replayer));
+	replayer->onEvent = onEvent;
+	replayer->context = context;
+	replayer->statistics = statistics;
+	replayer->tickGapNanoseconds = options->tickGapNanoseconds;
+	replayer->tickFinishedRecords = reader->header.version >= WindowInvestigator_CaptureFile_TICK_FINISHED_VERSION;
+	WindowInvestigator_CaptureState_Init(&replayer->state);
+	// Replayed from the start.
+	replayer->state.inconsistent = false;
+	replayer->timestamp = reader->header.startTimestamp;
+	WindowInvestigator_WindowTable_Init(&replayer->phaseWindows, 0);
+	WindowInvestigator_WindowTable_BeginPass(&replayer->phaseWindows);
+	replayer->phase = WindowInvestigator_ReplayPhase_NONE;
+	replayer->lastNewWindowZOrder = WindowInvestigator_Replayer_NO_ZORDER;
+
+	WindowInvestigator_MonitorBackend backend;
+	backend.getNextWindow = WindowInvestigator_Replayer_GetNextWindow;
+	backend.isWindowVisible = WindowInvestigator_Replayer_IsWindowVisible;
+	backend.getWindowInfo = WindowInvestigator_Replayer_GetWindowInfo;
+	backend.context = replayer;
+
+	WindowInvestigator_MonitorOptions monitorOptions;
+	WindowInvestigator_Monitor_GetDefaultOptions(&monitorOptions);
+	// The recorded state only changes when WindowMonitor saw it change, so sampling everything is what reproduces it.
+	WindowInvestigator_SamplingPolicy_InitExhaustive(&monitorOptions.samplingPolicy);
+	monitorOptions.samplingPolicy.costProfilingPeriod = 0;
+	monitorOptions.workerCount = options->workerCount;
+
+	WindowInvestigator_EventQueue_Init(&replayer->eventQueue, 0, &replayer->monitor.strings, WindowInvestigator_Replayer_OnEvent, replayer);
+	WindowInvestigator_EventQueue_SetClock(&replayer->eventQueue, WindowInvestigator_Replayer_GetTimestamp, replayer);
+	WindowInvestigator_MonitorSink eventQueueSink;
+	WindowInvestigator_EventQueue_GetSink(&replayer->eventQueue, &eventQueueSink);
+	WindowInvestigator_MonitorSink sink = eventQueueSink;
+	replayer->recomputeRudeWindows = options->monitorCount != 0;
+	if (replayer->recomputeRudeWindows) {
+		WindowInvestigator_RudeWindowSink rudeWindowSink;
+		rudeWindowSink.onRudeWindowChanged = WindowInvestigator_Replayer_OnRudeWindowChanged;
+		rudeWindowSink.context = replayer;
+		WindowInvestigator_RudeWindowEngine_Init(&replayer->rudeWindowEngine, &replayer->monitor.windows, &rudeWindowSink);
+		WindowInvestigator_RudeWindowEngine_SetMonitors(&replayer->rudeWindowEngine, options->monitors, options->monitorCount);
+		WindowInvestigator_RudeWindowEngine_GetMonitorSink(&replayer->rudeWindowEngine, &eventQueueSink, &sink);
+	}
+	WindowInvestigator_Monitor_Init(&replayer->monitor, &backend, &sink, &monitorOptions);
+
+	bool success = true;
+	WindowInvestigator_CaptureReader_Result result;
+	for (;;) {
+		WindowInvestigator_CaptureRecordHeader header;
+		const unsigned char* payload;
+		result = WindowInvestigator_CaptureReader_ReadRecord(reader, &header, &payload);
+		if (result != WindowInvestigator_CaptureReader_RECORD) break;
+		++statistics->recordsRead;
+		if (!WindowInvestigator_Replayer_ProcessRecord(replayer, &header, payload)) {
+			success = false;
+			break;
+		}
+	}
+	if (result == WindowInvestigator_CaptureReader_ERROR) success = false;
+	statistics->truncated = result == WindowInvestigator_CaptureReader_TRUNCATED;
+	if (success) {
+		WindowInvestigator_Replayer_Tick(replayer);
+		if (replayer->evaluationPending) WindowInvestigator_Replayer_EvaluateRudeWindows(replayer);
+	}
+
+	if (replayer->recomputeRudeWindows) WindowInvestigator_RudeWindowEngine_Destroy(&replayer->rudeWindowEngine);
+	WindowInvestigator_Monitor_Destroy(&replayer->monitor);
+	WindowInvestigator_EventQueue_Destroy(&replayer->eventQueue);
+	WindowInvestigator_WindowTable_Destroy(&replayer->phaseWindows);
+	WindowInvestigator_CaptureState_Destroy(&replayer->state);
+	WindowInvestigator_ReplayEvents_Destroy(&replayer->recordedEvents);
+	WindowInvestigator_ReplayEvents_Destroy(&replayer->replayedEvents);
+	WindowInvestigator_Free(replayer);
+	return success;
+}
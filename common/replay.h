@@ -0,0 +1,78 @@
+#pragma once
+
+#include "capture_file.h"
+#include "capture_index.h"
+#include "event_queue.h"
+#include "monitor.h"
+#include "rude_window.h"
+#include "window_info.h"
+#include "window_table.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Replays a capture through the monitor engine as fast as the CPU allows, to check changes to the diff logic (and to anything
+// derived from it) against real captures, and to measure its throughput.
+//
+// The desktop is rebuilt from the capture records (see WindowInvestigator_CaptureState) and serves as the backend of a
+// monitor, which is ticked wherever WindowMonitor ticked. The monitor reports to an event queue, as in WindowMonitor, so the
+// replayed events are exactly what WindowMonitor would have written. Received messages are passed through; keyframes are
+// replaced with the monitor's own (see WindowInvestigator_Monitor_LogWindows()); rude window changes are recomputed by a rude
+// window engine if monitors are specified, and passed through otherwise.
+//
+// Nothing depends on the clock or on thread scheduling: replayed events carry the timestamp of the record that triggered
+// them, and the monitor samples every field on every tick. Replaying the same capture always produces the same events. And
+// since WindowMonitor went through the same code to produce the capture, the replayed events should be the recorded ones;
+// they are compared as the replay goes, so that any difference shows up as a mismatch.
+//
+// Every tick that reported anything ends with a TICK_FINISHED record, which is where the tick is replayed. Version 1 captures
+// (see capture_file.h) have no such records, so their tick boundaries are inferred instead. The monitor reports all the events
+// of a tick at once, in a set order (see WindowInvestigator_Monitor_FinishTick()), while consecutive ticks are separated by at
+// least one enumeration of the windows. So a tick ends at ZORDER_UPDATED, before the records that WindowMonitor writes between
+// ticks (received messages, rude window changes and keyframes), before any record that cannot belong to the same tick as the
+// ones before it (a window reported twice, a window change reported after a Z-order change, or new windows that go back in
+// Z-order), and, unless the tick is waiting for its ZORDER_UPDATED, before any new or changed window that comes more than a
+// given time after the previous one. Consecutive ticks that are less than that time apart are replayed as one, and a tick
+// during which WindowMonitor was preempted for longer than that can be replayed as two; either only makes a difference to the
+// replayed events if the Z-order changed, which shows up as a mismatch. The replayed TICK_FINISHED events are still passed on
+// for these captures, but not compared.
+//
+// EVENTS_DROPPED records are not replayed, as the replay itself never drops events.
+
+typedef struct {
+	// Records of the same tick are assumed never to be further apart than this (see above). Only used for version 1 captures.
+	uint64_t tickGapNanoseconds;
+	// See WindowInvestigator_MonitorOptions::workerCount. Does not change the replayed events.
+	size_t workerCount;
+	// If monitorCount is not 0, rude window changes are recomputed for these monitors instead of being passed through.
+	const WindowInvestigator_Rect* monitors;
+	size_t monitorCount;
+} WindowInvestigator_ReplayOptions;
+
+typedef struct {
+	uint64_t recordsRead;
+	uint64_t ticks;
+	uint64_t eventsReplayed;
+	// Number of positions at which the recorded and replayed events differ (timestamps aside), including events that were
+	// only recorded or only replayed. Events are lined up again after every tick, and after every record that is replayed on
+	// its own (e.g. received messages).
+	uint64_t mismatchedEvents;
+	// Timestamp of the recorded event at the first mismatch (or of the last record read, if there is no such event). Only
+	// meaningful if mismatchedEvents is not 0.
+	uint64_t firstMismatchTimestamp;
+	// Number of dropped events reported by EVENTS_DROPPED records. Until the next complete keyframe after such a record (and
+	// the tick that brings the monitor up to date with it), the state is uncertain: differences are counted in uncertainEvents
+	// instead of mismatchedEvents, as the replayed events cannot be expected to match.
+	uint64_t droppedEventCount;
+	uint64_t uncertainEvents;
+	// The capture ends in the middle of a record.
+	bool truncated;
+} WindowInvestigator_ReplayStatistics;
+
+// 20 microseconds between ticks (for version 1 captures), no workers, and rude window changes passed through.
+void WindowInvestigator_Replay_GetDefaultOptions(WindowInvestigator_ReplayOptions* options);
+
+// Replays every record from the current position of reader, which must be right after the file header. onEvent is called for
+// every replayed event, in order, on the calling thread. Returns false on I/O error or malformed capture.
+bool WindowInvestigator_Replay(WindowInvestigator_CaptureReader* reader, const WindowInvestigator_ReplayOptions* options, WindowInvestigator_EventQueue_OnEvent onEvent, void* context, WindowInvestigator_ReplayStatistics* statistics);
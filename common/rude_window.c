@@ -0,0 +1,204 @@
+#include "rude_window.h"
+
+#include "allocation.h"
+
+#include <string.h>
+
+// Same values as the Windows SDK definitions.
+#define WindowInvestigator_RudeWindowEngine_WS_EX_TOPMOST 0x00000008
+#define WindowInvestigator_RudeWindowEngine_ZBID_DESKTOP 1
+
+static bool WindowInvestigator_RudeWindowEngine_IsRelevant(const WindowInvestigator_WindowInfo* windowInfo) {
+	return windowInfo->isWindow && windowInfo->isVisible && !windowInfo->isIconic && windowInfo->dwmIsCloaked == 0 &&
+		windowInfo->band == WindowInvestigator_RudeWindowEngine_ZBID_DESKTOP &&
+		(windowInfo->extendedStyles & WindowInvestigator_RudeWindowEngine_WS_EX_TOPMOST) == 0;
+}
+
+static bool WindowInvestigator_RudeWindowEngine_IsValidDesktopFullscreenWindow(const WindowInvestigator_WindowInfo* windowInfo) {
+	return (windowInfo->isShellManagedWindow || windowInfo->hasTreatAsDesktopFullscreenProperty) &&
+		!windowInfo->hasNonRudeHWNDProperty && !windowInfo->hasNonRudeAddedByRudeWindowFixerProperty && !windowInfo->hasLivePreviewWindowProperty;
+}
+
+static bool WindowInvestigator_RudeWindowEngine_Intersects(const WindowInvestigator_Rect* lhs, const WindowInvestigator_Rect* rhs) {
+	return lhs->left < rhs->right && rhs->left < lhs->right && lhs->top < rhs->bottom && rhs->top < lhs->bottom;
+}
+
+static bool WindowInvestigator_RudeWindowEngine_Contains(const WindowInvestigator_Rect* outer, const WindowInvestigator_Rect* inner) {
+	return outer->left <= inner->left && outer->top <= inner->top && outer->right >= inner->right && outer->bottom >= inner->bottom;
+}
+
+static uint32_t WindowInvestigator_RudeWindowEngine_GetAllMonitors(const WindowInvestigator_RudeWindowEngine* engine) {
+	return engine->monitorCount == WindowInvestigator_RudeWindowEngine_MAX_MONITORS ? UINT32_MAX : ((uint32_t)1 << engine->monitorCount) - 1;
+}
+
+// Returns the inputs of the window in the specified slot, computing them if they are not cached.
+static const WindowInvestigator_RudeWindowInputs* WindowInvestigator_RudeWindowEngine_GetInputs(WindowInvestigator_RudeWindowEngine* engine, size_t slot, bool recompute) {
+	if (slot >= engine->inputCapacity) {
+		size_t newCapacity = engine->inputCapacity == 0 ? 64 : engine->inputCapacity * 2;
+		while (newCapacity <= slot) newCapacity *= 2;
+		engine->inputs = WindowInvestigator_Reallocate(engine->inputs, newCapacity, sizeof(*engine->inputs));
+		memset(engine->inputs + engine->inputCapacity, 0, (newCapacity - engine->inputCapacity) * sizeof(*engine->inputs));
+		engine->inputCapacity = newCapacity;
+	}
+
+	WindowInvestigator_RudeWindowInputs* const inputs = &engine->inputs[slot];
+	const uint32_t generation = WindowInvestigator_WindowTable_GetGeneration(engine->windows, slot);
+	if (!recompute && inputs->generation == generation) return inputs;
+
+	++engine->statistics.inputsComputed;
+	const WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(engine->windows, slot);
+	inputs->generation = generation;
+	inputs->relevantMonitors = 0;
+	inputs->coveredMonitors = 0;
+	if (!WindowInvestigator_RudeWindowEngine_IsRelevant(windowInfo)) return inputs;
+	const bool isValidDesktopFullscreenWindow = WindowInvestigator_RudeWindowEngine_IsValidDesktopFullscreenWindow(windowInfo);
+	for (size_t monitor = 0; monitor < engine->monitorCount; ++monitor) {
+		if (!WindowInvestigator_RudeWindowEngine_Intersects(&windowInfo->windowRect, &engine->monitors[monitor])) continue;
+		inputs->relevantMonitors |= (uint32_t)1 << monitor;
+		if (isValidDesktopFullscreenWindow && WindowInvestigator_RudeWindowEngine_Contains(&windowInfo->windowRect, &engine->monitors[monitor]))
+			inputs->coveredMonitors |= (uint32_t)1 << monitor;
+	}
+	return inputs;
+}
+
+void WindowInvestigator_RudeWindowEngine_Init(WindowInvestigator_RudeWindowEngine* engine, const WindowInvestigator_WindowTable* windows, const WindowInvestigator_RudeWindowSink* sink) {
+	memset(engine, 0, sizeof(*engine));
+	engine->windows = windows;
+	engine->sink = *sink;
+}
+
+void WindowInvestigator_RudeWindowEngine_Destroy(WindowInvestigator_RudeWindowEngine* engine) {
+	WindowInvestigator_Free(engine->inputs);
+	WindowInvestigator_Free(engine->dirtyWindows);
+}
+
+void WindowInvestigator_RudeWindowEngine_SetMonitors(WindowInvestigator_RudeWindowEngine* engine, const WindowInvestigator_Rect* monitors, size_t monitorCount) {
+	if (monitorCount > WindowInvestigator_RudeWindowEngine_MAX_MONITORS) monitorCount = WindowInvestigator_RudeWindowEngine_MAX_MONITORS;
+	if (monitorCount == engine->monitorCount && memcmp(monitors, engine->monitors, monitorCount * sizeof(*monitors)) == 0) return;
+
+	if (monitorCount != 0) memcpy(engine->monitors, monitors, monitorCount * sizeof(*monitors));
+	for (size_t monitor = monitorCount; monitor < engine->monitorCount; ++monitor)
+		engine->rudeWindows[monitor] = 0;
+	engine->monitorCount = monitorCount;
+	WindowInvestigator_RudeWindowEngine_MarkAllWindowsChanged(engine);
+}
+
+void WindowInvestigator_RudeWindowEngine_MarkWindowChanged(WindowInvestigator_RudeWindowEngine* engine, uintptr_t window, uint32_t changedFields) {
+	if ((changedFields & WindowInvestigator_RudeWindowEngine_FIELDS) == 0) return;
+	if (engine->dirtyWindowCount == engine->dirtyWindowCapacity) {
+		engine->dirtyWindowCapacity = engine->dirtyWindowCapacity == 0 ? 64 : engine->dirtyWindowCapacity * 2;
+		engine->dirtyWindows = WindowInvestigator_Reallocate(engine->dirtyWindows, engine->dirtyWindowCapacity, sizeof(*engine->dirtyWindows));
+	}
+	engine->dirtyWindows[engine->dirtyWindowCount++] = window;
+}
+
+void WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(WindowInvestigator_RudeWindowEngine* engine) {
+	engine->zOrderChanged = true;
+}
+
+void WindowInvestigator_RudeWindowEngine_MarkAllWindowsChanged(WindowInvestigator_RudeWindowEngine* engine) {
+	// The Z-order walk recomputes whatever it needs.
+	if (engine->inputCapacity != 0) memset(engine->inputs, 0, engine->inputCapacity * sizeof(*engine->inputs));
+	engine->dirtyWindowCount = 0;
+	engine->zOrderChanged = true;
+}
+
+void WindowInvestigator_RudeWindowEngine_Evaluate(WindowInvestigator_RudeWindowEngine* engine) {
+	++engine->statistics.evaluations;
+
+	// A change to a window only matters if it changes what the window contributes.
+	bool walk = engine->zOrderChanged;
+	for (size_t dirtyWindowIndex = 0; dirtyWindowIndex < engine->dirtyWindowCount; ++dirtyWindowIndex) {
+		const uintptr_t window = engine->dirtyWindows[dirtyWindowIndex];
+		const size_t slot = WindowInvestigator_WindowTable_Find(engine->windows, window);
+		if (slot == WindowInvestigator_WindowTable_NO_SLOT) continue;
+		WindowInvestigator_RudeWindowInputs previousInputs = { 0 };
+		if (slot < engine->inputCapacity) previousInputs = engine->inputs[slot];
+		const WindowInvestigator_RudeWindowInputs* const inputs = WindowInvestigator_RudeWindowEngine_GetInputs(engine, slot, /*recompute=*/true);
+		if (previousInputs.generation != inputs->generation || previousInputs.relevantMonitors != inputs->relevantMonitors || previousInputs.coveredMonitors != inputs->coveredMonitors)
+			walk = true;
+	}
+	engine->dirtyWindowCount = 0;
+	engine->zOrderChanged = false;
+	if (!walk) return;
+
+	++engine->statistics.zOrderWalks;
+	uintptr_t rudeWindows[WindowInvestigator_RudeWindowEngine_MAX_MONITORS] = { 0 };
+	uint32_t unresolvedMonitors = WindowInvestigator_RudeWindowEngine_GetAllMonitors(engine);
+	const size_t windowCount = WindowInvestigator_WindowTable_GetZOrderCount(engine->windows);
+	for (size_t zOrder = 0; zOrder < windowCount && unresolvedMonitors != 0; ++zOrder) {
+		++engine->statistics.windowsWalked;
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(engine->windows, zOrder);
+		const uintptr_t window = WindowInvestigator_WindowTable_GetWindow(engine->windows, slot);
+		const WindowInvestigator_RudeWindowInputs* const inputs = WindowInvestigator_RudeWindowEngine_GetInputs(engine, slot, /*recompute=*/false);
+		const uint32_t resolvedMonitors = inputs->relevantMonitors & unresolvedMonitors;
+		if (resolvedMonitors == 0) continue;
+		for (size_t monitor = 0; monitor < engine->monitorCount; ++monitor)
+			if (resolvedMonitors & inputs->coveredMonitors & ((uint32_t)1 << monitor)) rudeWindows[monitor] = window;
+		unresolvedMonitors &= ~resolvedMonitors;
+	}
+
+	for (size_t monitor = 0; monitor < engine->monitorCount; ++monitor) {
+		if (rudeWindows[monitor] == engine->rudeWindows[monitor]) continue;
+		const uintptr_t previousWindow = engine->rudeWindows[monitor];
+		engine->rudeWindows[monitor] = rudeWindows[monitor];
+		++engine->statistics.rudeWindowChanges;
+		engine->sink.onRudeWindowChanged(engine->sink.context, monitor, &engine->monitors[monitor], previousWindow, rudeWindows[monitor]);
+	}
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnNewWindow(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	WindowInvestigator_RudeWindowEngine_MarkWindowChanged(engine, window, WindowInvestigator_WindowField_ALL);
+	engine->nextSink.onNewWindow(engine->nextSink.context, window, zOrder, windowInfo);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnWindowChanged(void* context, uintptr_t window, uint32_t changedFields, const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	WindowInvestigator_RudeWindowEngine_MarkWindowChanged(engine, window, changedFields);
+	engine->nextSink.onWindowChanged(engine->nextSink.context, window, changedFields, oldWindowInfo, newWindowInfo);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnWindowZOrderChanged(void* context, uintptr_t window, size_t previousZOrder, size_t zOrder) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	engine->nextSink.onWindowZOrderChanged(engine->nextSink.context, window, previousZOrder, zOrder);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnWindowGone(void* context, uintptr_t window) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	engine->nextSink.onWindowGone(engine->nextSink.context, window);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnZOrderUpdated(void* context, size_t windowCount) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(engine);
+	engine->nextSink.onZOrderUpdated(engine->nextSink.context, windowCount);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnTickFinished(void* context) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	engine->nextSink.onTickFinished(engine->nextSink.context);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnLogWindowsBegin(void* context, size_t windowCount) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	engine->nextSink.onLogWindowsBegin(engine->nextSink.context, windowCount);
+}
+
+static void WindowInvestigator_RudeWindowEngine_OnLogWindow(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_RudeWindowEngine* const engine = context;
+	engine->nextSink.onLogWindow(engine->nextSink.context, window, zOrder, windowInfo);
+}
+
+void WindowInvestigator_RudeWindowEngine_GetMonitorSink(WindowInvestigator_RudeWindowEngine* engine, const WindowInvestigator_MonitorSink* next, WindowInvestigator_MonitorSink* sink) {
+	engine->nextSink = *next;
+	sink->onNewWindow = WindowInvestigator_RudeWindowEngine_OnNewWindow;
+	sink->onWindowChanged = WindowInvestigator_RudeWindowEngine_OnWindowChanged;
+	sink->onWindowZOrderChanged = WindowInvestigator_RudeWindowEngine_OnWindowZOrderChanged;
+	sink->onWindowGone = WindowInvestigator_RudeWindowEngine_OnWindowGone;
+	sink->onZOrderUpdated = WindowInvestigator_RudeWindowEngine_OnZOrderUpdated;
+	sink->onTickFinished = WindowInvestigator_RudeWindowEngine_OnTickFinished;
+	sink->onLogWindowsBegin = WindowInvestigator_RudeWindowEngine_OnLogWindowsBegin;
+	sink->onLogWindow = WindowInvestigator_RudeWindowEngine_OnLogWindow;
+	sink->context = engine;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "monitor.h"
+#include "window_info.h"
+#include "window_table.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Computes, for every display monitor, which window (if any) makes the monitor "rude", i.e. which window the Rude Window
+// Manager would consider to be a fullscreen application on that monitor. This is what ABN_FULLSCREENAPP notifications are
+// supposed to reflect, so comparing the two shows when the shell got it wrong.
+//
+// This is a model built from the RudeWindowWin32Functions that WindowInvestigator_WindowInfo mirrors, not a reimplementation
+// of the actual Rude Window Manager logic. A monitor is rude if the frontmost window that is relevant on that monitor is a
+// valid desktop fullscreen window that covers the whole monitor, where:
+//  - A window is relevant on a monitor if it is a window (IsWindow()), is visible (IsWindowVisible()), is not minimized
+//    (IsWindowMinimized()), is not cloaked (IsWindowCloaked()), is in the desktop band but not always on top
+//    (IsWindowAlwaysOnTopDesktop()), and its window rect intersects the monitor (IsWindowOnMonitor()).
+//  - A window is a valid desktop fullscreen window (IsValidDesktopFullscreenWindow()) if it is shell managed or has the
+//    TreatAsDesktopFullscreen property, and has none of the NonRudeHWND, NonRudeHWND-added-by-RudeWindowFixer and
+//    LivePreviewWindow properties.
+//  - A window covers a monitor if its window rect (GetWindowRectForFullscreenCheck()) contains the monitor rect.
+//
+// Evaluation is incremental, so that it can run after every tick. What each window contributes (on which monitors it is
+// relevant, and which ones it covers) is cached, and only recomputed for windows whose relevant fields changed. The Z-order is
+// only walked if one of these changed, or if the Z-order itself changed; and the walk stops as soon as every monitor has found
+// its frontmost relevant window, which is usually within the first few windows.
+
+// Monitors are tracked as bits in a uint32_t.
+#define WindowInvestigator_RudeWindowEngine_MAX_MONITORS 32
+
+// Fields of WindowInvestigator_WindowInfo that the verdict depends on, as a bitmask of WindowInvestigator_WindowField_BIT().
+#define WindowInvestigator_RudeWindowEngine_FIELDS ( \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_BAND) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_WINDOW) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE))
+
+typedef struct {
+	// Called from WindowInvestigator_RudeWindowEngine_Evaluate(). window is 0 if the monitor is not rude anymore.
+	void (*onRudeWindowChanged)(void* context, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window);
+	void* context;
+} WindowInvestigator_RudeWindowSink;
+
+// What a window contributes to the verdict, as bitmasks of monitor indices.
+typedef struct {
+	// Generation of the slot (see window_table.h) the inputs were computed for, so that they are not mistaken for the inputs of
+	// a later window in the same slot, even one with the same window handle. 0 if not computed yet.
+	uint32_t generation;
+	uint32_t relevantMonitors;
+	// Always a subset of relevantMonitors.
+	uint32_t coveredMonitors;
+} WindowInvestigator_RudeWindowInputs;
+
+typedef struct {
+	uint64_t evaluations;
+	// Number of times the inputs of a window were computed.
+	uint64_t inputsComputed;
+	uint64_t zOrderWalks;
+	// Number of windows visited by Z-order walks, summed over all walks.
+	uint64_t windowsWalked;
+	// Number of times the rude window of a monitor changed.
+	uint64_t rudeWindowChanges;
+} WindowInvestigator_RudeWindowStatistics;
+
+typedef struct {
+	// Values are WindowInvestigator_WindowInfo.
+	const WindowInvestigator_WindowTable* windows;
+	WindowInvestigator_RudeWindowSink sink;
+
+	WindowInvestigator_Rect monitors[WindowInvestigator_RudeWindowEngine_MAX_MONITORS];
+	size_t monitorCount;
+	// Current verdict for each monitor; 0 if the monitor is not rude.
+	uintptr_t rudeWindows[WindowInvestigator_RudeWindowEngine_MAX_MONITORS];
+
+	// Indexed by slot in windows.
+	WindowInvestigator_RudeWindowInputs* inputs;
+	size_t inputCapacity;
+
+	// Windows whose relevant fields changed since the last evaluation. Can contain duplicates.
+	uintptr_t* dirtyWindows;
+	size_t dirtyWindowCount;
+	size_t dirtyWindowCapacity;
+	bool zOrderChanged;
+
+	// Only used by WindowInvestigator_RudeWindowEngine_GetMonitorSink().
+	WindowInvestigator_MonitorSink nextSink;
+
+	WindowInvestigator_RudeWindowStatistics statistics;
+} WindowInvestigator_RudeWindowEngine;
+
+// windows is the table of a WindowInvestigator_Monitor or WindowInvestigator_CaptureState, whose values are
+// WindowInvestigator_WindowInfo. It must outlive the engine. There are no monitors until
+// WindowInvestigator_RudeWindowEngine_SetMonitors() is called.
+void WindowInvestigator_RudeWindowEngine_Init(WindowInvestigator_RudeWindowEngine* engine, const WindowInvestigator_WindowTable* windows, const WindowInvestigator_RudeWindowSink* sink);
+void WindowInvestigator_RudeWindowEngine_Destroy(WindowInvestigator_RudeWindowEngine* engine);
+
+// Monitors beyond WindowInvestigator_RudeWindowEngine_MAX_MONITORS are ignored. Monitors are identified by their index: if the
+// layout changed, every window is reevaluated on the next evaluation, and the new verdict of each monitor is compared to the
+// previous verdict of the monitor that had the same index.
+void WindowInvestigator_RudeWindowEngine_SetMonitors(WindowInvestigator_RudeWindowEngine* engine, const WindowInvestigator_Rect* monitors, size_t monitorCount);
+
+// Tell the engine what changed in the window table since the last evaluation. New windows must be reported as changed, with
+// all fields. Windows that are gone don't need to be reported, as long as the Z-order is.
+void WindowInvestigator_RudeWindowEngine_MarkWindowChanged(WindowInvestigator_RudeWindowEngine* engine, uintptr_t window, uint32_t changedFields);
+void WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(WindowInvestigator_RudeWindowEngine* engine);
+// Forgets everything that was cached, e.g. because the window table was rebuilt from scratch.
+void WindowInvestigator_RudeWindowEngine_MarkAllWindowsChanged(WindowInvestigator_RudeWindowEngine* engine);
+
+// Brings the verdict up to date with the window table, and calls the sink for every monitor whose rude window changed.
+void WindowInvestigator_RudeWindowEngine_Evaluate(WindowInvestigator_RudeWindowEngine* engine);
+
+// Fills a monitor sink that passes every event on to next, and marks the engine accordingly. The engine still has to be
+// evaluated after every tick.
+void WindowInvestigator_RudeWindowEngine_GetMonitorSink(WindowInvestigator_RudeWindowEngine* engine, const WindowInvestigator_MonitorSink* next, WindowInvestigator_MonitorSink* sink);
@@ -0,0 +1,103 @@
+#include "sampling.h"
+
+#include <string.h>
+
+static void WindowInvestigator_SamplingPolicy_Set(WindowInvestigator_SamplingPolicy* policy, WindowInvestigator_WindowField field, uint32_t period, uint32_t triggerFields) {
+	policy->fields[field].period = period;
+	policy->fields[field].triggerFields = triggerFields;
+}
+
+void WindowInvestigator_SamplingPolicy_InitExhaustive(WindowInvestigator_SamplingPolicy* policy) {
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field)
+		WindowInvestigator_SamplingPolicy_Set(policy, field, 1, 0);
+	policy->costProfilingPeriod = 0;
+}
+
+void WindowInvestigator_SamplingPolicy_InitTiered(WindowInvestigator_SamplingPolicy* policy) {
+	const uint32_t styles = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES);
+	const uint32_t extendedStyles = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES);
+	const uint32_t windowRect = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT);
+
+	WindowInvestigator_SamplingPolicy_InitExhaustive(policy);
+
+	// Fixed for the lifetime of a window.
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_PROCESS_ID, 0, 0);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_THREAD_ID, 0, 0);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_CLASS_NAME, 0, 0);
+
+	// Placement changes along with maximize/minimize (styles) and moves (window rect).
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD, 8, styles | windowRect);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION, 8, styles | windowRect);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION, 8, styles | windowRect);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION, 8, styles | windowRect);
+
+	// Shell window type, band and window properties are typically set once when the window is set up, along with its styles.
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW, 16, styles | extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW, 16, styles | extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_OVERPANNING, 16, styles | extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_BAND, 16, extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY, 16, styles | extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY, 16, styles | extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY, 16, styles | extendedStyles);
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY, 16, styles | extendedStyles);
+
+	// Requires a round trip to DWM.
+	WindowInvestigator_SamplingPolicy_Set(policy, WindowInvestigator_WindowField_DWM_IS_CLOAKED, 4, styles);
+
+	policy->costProfilingPeriod = 16;
+}
+
+static void WindowInvestigator_SamplingScheduler_AddPeriodicField(WindowInvestigator_SamplingScheduler* scheduler, uint32_t period, WindowInvestigator_WindowField field) {
+	size_t groupIndex = 0;
+	while (groupIndex < scheduler->periodGroupCount && scheduler->periodGroups[groupIndex].period != period) ++groupIndex;
+	if (groupIndex == scheduler->periodGroupCount) {
+		scheduler->periodGroups[groupIndex].period = period;
+		++scheduler->periodGroupCount;
+	}
+	scheduler->periodGroups[groupIndex].fields |= WindowInvestigator_WindowField_BIT(field);
+}
+
+void WindowInvestigator_SamplingScheduler_Init(WindowInvestigator_SamplingScheduler* scheduler, const WindowInvestigator_SamplingPolicy* policy) {
+	memset(scheduler, 0, sizeof(*scheduler));
+	scheduler->policy = *policy;
+	for (int field = 0; field < WindowInvestigator_WindowField_COUNT; ++field) {
+		const WindowInvestigator_FieldSamplingPolicy* const fieldPolicy = &policy->fields[field];
+		if (fieldPolicy->period == 1)
+			scheduler->everyTickFields |= WindowInvestigator_WindowField_BIT(field);
+		else {
+			if (fieldPolicy->period != 0) WindowInvestigator_SamplingScheduler_AddPeriodicField(scheduler, fieldPolicy->period, field);
+			if (fieldPolicy->triggerFields != 0) scheduler->triggeredFields |= WindowInvestigator_WindowField_BIT(field);
+		}
+	}
+}
+
+uint32_t WindowInvestigator_SamplingScheduler_GetDueFields(const WindowInvestigator_SamplingScheduler* scheduler, uint64_t tick, size_t windowIndex) {
+	uint32_t fields = scheduler->everyTickFields;
+	for (size_t groupIndex = 0; groupIndex < scheduler->periodGroupCount; ++groupIndex) {
+		const WindowInvestigator_SamplingPeriodGroup* const group = &scheduler->periodGroups[groupIndex];
+		if ((tick + windowIndex) % group->period == 0) fields |= group->fields;
+	}
+	return fields;
+}
+
+uint32_t WindowInvestigator_SamplingScheduler_GetTriggeredFields(const WindowInvestigator_SamplingScheduler* scheduler, uint32_t changedFields, uint32_t sampledFields) {
+	if (changedFields == 0) return 0;
+
+	uint32_t fields = 0;
+	for (uint32_t remaining = scheduler->triggeredFields & ~sampledFields; remaining != 0; remaining &= remaining - 1) {
+		int field = 0;
+		while (!(remaining & WindowInvestigator_WindowField_BIT(field))) ++field;
+		if (scheduler->policy.fields[field].triggerFields & changedFields)
+			fields |= WindowInvestigator_WindowField_BIT(field);
+	}
+	return fields;
+}
+
+bool WindowInvestigator_SamplingScheduler_IsCostProfilingTick(const WindowInvestigator_SamplingScheduler* scheduler, uint64_t tick) {
+	return scheduler->policy.costProfilingPeriod != 0 && tick % scheduler->policy.costProfilingPeriod == 0;
+}
+
+void WindowInvestigator_SamplingScheduler_RecordCost(WindowInvestigator_SamplingScheduler* scheduler, WindowInvestigator_WindowField field, uint64_t nanoseconds) {
+	++scheduler->costs[field].sampleCount;
+	scheduler->costs[field].nanoseconds += nanoseconds;
+}
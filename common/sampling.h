@@ -0,0 +1,65 @@
+#pragma once
+
+#include "window_info.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Decides which window properties need to be sampled on a given tick.
+//
+// Properties differ widely in how expensive they are to query and in how often they change, so each field gets its own
+// policy: it can be sampled every N ticks (staggered across windows so that the cost is spread evenly), and/or whenever one
+// of a set of cheaper "trigger" fields is seen to change. All fields are always sampled when a window first appears.
+//
+// The scheduler also keeps track of how much each field costs to sample, so that policies can be tuned from real data.
+
+typedef struct {
+	// Sample the field every period ticks. 1 means every tick; 0 means never periodically.
+	uint32_t period;
+	// Also sample the field as soon as any of these fields (bitmask of WindowInvestigator_WindowField_BIT()) changed.
+	uint32_t triggerFields;
+} WindowInvestigator_FieldSamplingPolicy;
+
+typedef struct {
+	WindowInvestigator_FieldSamplingPolicy fields[WindowInvestigator_WindowField_COUNT];
+	// Every costProfilingPeriod ticks, one window gets every field sampled separately to measure the cost of each field.
+	// 0 disables cost profiling.
+	uint32_t costProfilingPeriod;
+} WindowInvestigator_SamplingPolicy;
+
+// Samples every field on every tick.
+void WindowInvestigator_SamplingPolicy_InitExhaustive(WindowInvestigator_SamplingPolicy* policy);
+// Samples cheap or volatile fields on every tick, and the rest on a slower cadence or when a related field changes.
+void WindowInvestigator_SamplingPolicy_InitTiered(WindowInvestigator_SamplingPolicy* policy);
+
+typedef struct {
+	uint64_t sampleCount;
+	uint64_t nanoseconds;
+} WindowInvestigator_FieldCost;
+
+// Fields that share the same sampling period.
+typedef struct {
+	uint32_t period;
+	uint32_t fields;
+} WindowInvestigator_SamplingPeriodGroup;
+
+typedef struct {
+	WindowInvestigator_SamplingPolicy policy;
+	uint32_t everyTickFields;
+	WindowInvestigator_SamplingPeriodGroup periodGroups[WindowInvestigator_WindowField_COUNT];
+	size_t periodGroupCount;
+	uint32_t triggeredFields;
+	WindowInvestigator_FieldCost costs[WindowInvestigator_WindowField_COUNT];
+} WindowInvestigator_SamplingScheduler;
+
+void WindowInvestigator_SamplingScheduler_Init(WindowInvestigator_SamplingScheduler* scheduler, const WindowInvestigator_SamplingPolicy* policy);
+
+// Returns the fields that are due on the specified tick for the specified window. windowIndex is any number that is stable
+// for the lifetime of the window; it is used to stagger periodic sampling.
+uint32_t WindowInvestigator_SamplingScheduler_GetDueFields(const WindowInvestigator_SamplingScheduler* scheduler, uint64_t tick, size_t windowIndex);
+// Returns the fields that were not sampled yet but need to be because one of their trigger fields changed.
+uint32_t WindowInvestigator_SamplingScheduler_GetTriggeredFields(const WindowInvestigator_SamplingScheduler* scheduler, uint32_t changedFields, uint32_t sampledFields);
+
+bool WindowInvestigator_SamplingScheduler_IsCostProfilingTick(const WindowInvestigator_SamplingScheduler* scheduler, uint64_t tick);
+void WindowInvestigator_SamplingScheduler_RecordCost(WindowInvestigator_SamplingScheduler* scheduler, WindowInvestigator_WindowField field, uint64_t nanoseconds);
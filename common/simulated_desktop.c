@@ -0,0 +1,430 @@
+#include "simulated_desktop.h"
+
+#include "allocation.h"
+#include "clock.h"
+
+#include <string.h>
+
+#define WindowInvestigator_SimulatedDesktop_NO_SLOT SIZE_MAX
+#define WindowInvestigator_SimulatedDesktop_MAX_WINDOWS 0x10000
+
+// Styles that the simulation flips around. Values are the same as the Windows SDK definitions.
+#define WindowInvestigator_SimulatedDesktop_WS_MINIMIZE 0x20000000
+#define WindowInvestigator_SimulatedDesktop_WS_VISIBLE 0x10000000
+#define WindowInvestigator_SimulatedDesktop_WS_MAXIMIZE 0x01000000
+#define WindowInvestigator_SimulatedDesktop_WS_OVERLAPPEDWINDOW 0x00CF0000
+#define WindowInvestigator_SimulatedDesktop_WS_EX_TOPMOST 0x00000008
+#define WindowInvestigator_SimulatedDesktop_SW_SHOWNORMAL 1
+#define WindowInvestigator_SimulatedDesktop_SW_SHOWMINIMIZED 2
+#define WindowInvestigator_SimulatedDesktop_SW_SHOWMAXIMIZED 3
+#define WindowInvestigator_SimulatedDesktop_DWM_CLOAKED_SHELL 2
+#define WindowInvestigator_SimulatedDesktop_ZBID_DESKTOP 1
+
+static const WindowInvestigator_Rect WindowInvestigator_SimulatedDesktop_monitors[WindowInvestigator_SimulatedDesktop_MONITOR_COUNT] = {
+	{ 0, 0, 2560, 1440 },
+	{ 2560, 0, 4480, 1080 },
+	{ -1920, 0, 0, 1200 },
+	{ 0, -1440, 2560, 0 },
+};
+
+// Bounding box of the simulated monitors.
+#define WindowInvestigator_SimulatedDesktop_DESKTOP_LEFT -1920
+#define WindowInvestigator_SimulatedDesktop_DESKTOP_TOP -1440
+#define WindowInvestigator_SimulatedDesktop_DESKTOP_WIDTH 6400
+#define WindowInvestigator_SimulatedDesktop_DESKTOP_HEIGHT 2880
+
+static const wchar_t* const WindowInvestigator_SimulatedDesktop_classNames[] = {
+	L"Chrome_WidgetWin_1",
+	L"MozillaWindowClass",
+	L"CASCADIA_HOSTING_WINDOW_CLASS",
+	L"ApplicationFrameWindow",
+	L"Windows.UI.Core.CoreWindow",
+	L"Notepad",
+	L"tooltips_class32",
+	L"WorkerW",
+};
+
+static const wchar_t* const WindowInvestigator_SimulatedDesktop_imageNames[] = {
+	L"C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe",
+	L"C:\\Program Files\\Mozilla Firefox\\firefox.exe",
+	L"C:\\Program Files\\WindowsApps\\Microsoft.WindowsTerminal\\WindowsTerminal.exe",
+	L"C:\\Windows\\explorer.exe",
+	L"C:\\Windows\\System32\\notepad.exe",
+	L"C:\\Games\\Game\\Game.exe",
+	L"C:\\Users\\User\\AppData\\Local\\Programs\\Microsoft VS Code\\Code.exe",
+	L"C:\\Windows\\SystemApps\\ShellExperienceHost.exe",
+};
+
+static uint64_t WindowInvestigator_SimulatedDesktop_Random(WindowInvestigator_SimulatedDesktop* desktop) {
+	// SplitMix64
+	uint64_t z = (desktop->randomState += UINT64_C(0x9E3779B97F4A7C15));
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+static double WindowInvestigator_SimulatedDesktop_RandomUnit(WindowInvestigator_SimulatedDesktop* desktop) {
+	return (double)(WindowInvestigator_SimulatedDesktop_Random(desktop) >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+static uint32_t WindowInvestigator_SimulatedDesktop_RandomBelow(WindowInvestigator_SimulatedDesktop* desktop, uint32_t bound) {
+	return (uint32_t)(WindowInvestigator_SimulatedDesktop_Random(desktop) % bound);
+}
+
+static size_t WindowInvestigator_SimulatedDesktop_GetEventCount(WindowInvestigator_SimulatedDesktop* desktop, double rate) {
+	if (rate <= 0) return 0;
+	const size_t count = (size_t)rate;
+	return count + (WindowInvestigator_SimulatedDesktop_RandomUnit(desktop) < rate - (double)count ? 1 : 0);
+}
+
+static void WindowInvestigator_SimulatedDesktop_FormatText(wchar_t* text, size_t size, const wchar_t* prefix, uint64_t number) {
+	size_t length = 0;
+	for (; prefix[length] != 0 && length < size - 1; ++length)
+		text[length] = prefix[length];
+
+	wchar_t digits[20];
+	size_t digitCount = 0;
+	do {
+		digits[digitCount++] = (wchar_t)(L'0' + number % 10);
+		number /= 10;
+	} while (number != 0);
+	while (digitCount > 0 && length < size - 1)
+		text[length++] = digits[--digitCount];
+
+	text[length] = 0;
+}
+
+static uintptr_t WindowInvestigator_SimulatedDesktop_GetHandle(const WindowInvestigator_SimulatedDesktop* desktop, size_t slot) {
+	return ((uintptr_t)desktop->windows[slot].generation << 16) | slot;
+}
+
+static WindowInvestigator_SimulatedWindow* WindowInvestigator_SimulatedDesktop_GetWindow(const WindowInvestigator_SimulatedDesktop* desktop, uintptr_t handle) {
+	const size_t slot = handle & 0xFFFF;
+	if (slot >= desktop->windowSlotCount) return NULL;
+	WindowInvestigator_SimulatedWindow* const window = &desktop->windows[slot];
+	if (window->generation == 0 || window->generation != handle >> 16) return NULL;
+	return window;
+}
+
+static void WindowInvestigator_SimulatedDesktop_Notify(const WindowInvestigator_SimulatedDesktop* desktop, WindowInvestigator_WindowNotification notification, size_t slot) {
+	if (desktop->options.onNotification != NULL)
+		desktop->options.onNotification(desktop->options.onNotificationContext, notification, WindowInvestigator_SimulatedDesktop_GetHandle(desktop, slot));
+}
+
+static void WindowInvestigator_SimulatedDesktop_InsertIntoZOrder(WindowInvestigator_SimulatedDesktop* desktop, size_t slot, size_t zOrder) {
+	memmove(desktop->zOrder + zOrder + 1, desktop->zOrder + zOrder, (desktop->windowCount - zOrder) * sizeof(*desktop->zOrder));
+	desktop->zOrder[zOrder] = slot;
+	++desktop->windowCount;
+	for (size_t index = zOrder; index < desktop->windowCount; ++index)
+		desktop->windows[desktop->zOrder[index]].zOrder = index;
+}
+
+static void WindowInvestigator_SimulatedDesktop_RemoveFromZOrder(WindowInvestigator_SimulatedDesktop* desktop, size_t zOrder) {
+	--desktop->windowCount;
+	memmove(desktop->zOrder + zOrder, desktop->zOrder + zOrder + 1, (desktop->windowCount - zOrder) * sizeof(*desktop->zOrder));
+	for (size_t index = zOrder; index < desktop->windowCount; ++index)
+		desktop->windows[desktop->zOrder[index]].zOrder = index;
+}
+
+static void WindowInvestigator_SimulatedDesktop_SetRect(WindowInvestigator_WindowInfo* info, int32_t left, int32_t top, int32_t width, int32_t height) {
+	info->windowRect.left = left;
+	info->windowRect.top = top;
+	info->windowRect.right = left + width;
+	info->windowRect.bottom = top + height;
+	// Simulate a standard caption and border.
+	info->clientRect.left = 0;
+	info->clientRect.top = 0;
+	info->clientRect.right = width - 16;
+	info->clientRect.bottom = height - 39;
+	info->clientRectInScreenCoordinates.left = left + 8;
+	info->clientRectInScreenCoordinates.top = top + 31;
+	info->clientRectInScreenCoordinates.right = info->clientRectInScreenCoordinates.left + info->clientRect.right;
+	info->clientRectInScreenCoordinates.bottom = info->clientRectInScreenCoordinates.top + info->clientRect.bottom;
+	info->placement.normalPosition = info->windowRect;
+}
+
+static void WindowInvestigator_SimulatedDesktop_SetRandomRect(WindowInvestigator_SimulatedDesktop* desktop, WindowInvestigator_WindowInfo* info) {
+	WindowInvestigator_SimulatedDesktop_SetRect(info,
+		WindowInvestigator_SimulatedDesktop_DESKTOP_LEFT - 200 + (int32_t)WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, WindowInvestigator_SimulatedDesktop_DESKTOP_WIDTH),
+		WindowInvestigator_SimulatedDesktop_DESKTOP_TOP - 100 + (int32_t)WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, WindowInvestigator_SimulatedDesktop_DESKTOP_HEIGHT),
+		200 + (int32_t)WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, 1600), 100 + (int32_t)WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, 900));
+}
+
+static void WindowInvestigator_SimulatedDesktop_CreateWindow(WindowInvestigator_SimulatedDesktop* desktop, size_t zOrder) {
+	if (desktop->windowCount == WindowInvestigator_SimulatedDesktop_MAX_WINDOWS) return;
+
+	size_t slot = desktop->firstFreeWindowSlot;
+	if (slot != WindowInvestigator_SimulatedDesktop_NO_SLOT)
+		desktop->firstFreeWindowSlot = desktop->windows[slot].nextFreeSlot;
+	else {
+		if (desktop->windowSlotCount == desktop->windowSlotCapacity) {
+			desktop->windowSlotCapacity = desktop->windowSlotCapacity == 0 ? 64 : desktop->windowSlotCapacity * 2;
+			desktop->windows = WindowInvestigator_Reallocate(desktop->windows, desktop->windowSlotCapacity, sizeof(*desktop->windows));
+			desktop->zOrder = WindowInvestigator_Reallocate(desktop->zOrder, desktop->windowSlotCapacity, sizeof(*desktop->zOrder));
+		}
+		slot = desktop->windowSlotCount++;
+	}
+
+	WindowInvestigator_SimulatedWindow* const window = &desktop->windows[slot];
+	window->generation = desktop->nextGeneration;
+	desktop->nextGeneration = desktop->nextGeneration % 0x7FFF + 1;
+	window->nextFreeSlot = WindowInvestigator_SimulatedDesktop_NO_SLOT;
+	window->windowInfoLatencyNanoseconds = desktop->options.windowInfoLatencyNanoseconds;
+	// Only draw if needed so that enabling slow windows does not change the rest of the simulation.
+	if (desktop->options.slowWindowFraction > 0 && WindowInvestigator_SimulatedDesktop_RandomUnit(desktop) < desktop->options.slowWindowFraction)
+		window->windowInfoLatencyNanoseconds = desktop->options.slowWindowInfoLatencyNanoseconds;
+
+	WindowInvestigator_WindowInfo* const info = &window->info;
+	memset(info, 0, sizeof(*info));
+	info->processId = 1000 + 4 * WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, 256);
+	info->threadId = info->processId + 4;
+
+	const size_t classNameCount = sizeof(WindowInvestigator_SimulatedDesktop_classNames) / sizeof(*WindowInvestigator_SimulatedDesktop_classNames);
+	window->className = WindowInvestigator_SimulatedDesktop_classNames[WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, (uint32_t)classNameCount)];
+	WindowInvestigator_SimulatedDesktop_FormatText(window->text, sizeof(window->text) / sizeof(*window->text), L"Simulated window ", desktop->nextTextId++);
+
+	info->isVisible = WindowInvestigator_SimulatedDesktop_RandomUnit(desktop) < desktop->options.visibleFraction;
+	info->styles = WindowInvestigator_SimulatedDesktop_WS_OVERLAPPEDWINDOW | (info->isVisible ? WindowInvestigator_SimulatedDesktop_WS_VISIBLE : 0);
+	WindowInvestigator_SimulatedDesktop_SetRandomRect(desktop, info);
+	info->placement.showCmd = WindowInvestigator_SimulatedDesktop_SW_SHOWNORMAL;
+	info->placement.minPosition.x = info->placement.minPosition.y = -1;
+	info->placement.maxPosition.x = info->placement.maxPosition.y = -1;
+	info->isShellManagedWindow = true;
+	info->band = WindowInvestigator_SimulatedDesktop_ZBID_DESKTOP;
+	info->isWindow = true;
+
+	WindowInvestigator_SimulatedDesktop_InsertIntoZOrder(desktop, slot, zOrder);
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_CREATE, slot);
+	if (info->isVisible) WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_SHOW, slot);
+}
+
+static void WindowInvestigator_SimulatedDesktop_DestroyWindow(WindowInvestigator_SimulatedDesktop* desktop, size_t zOrder) {
+	const size_t slot = desktop->zOrder[zOrder];
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_DESTROY, slot);
+	WindowInvestigator_SimulatedDesktop_RemoveFromZOrder(desktop, zOrder);
+	desktop->windows[slot].generation = 0;
+	desktop->windows[slot].nextFreeSlot = desktop->firstFreeWindowSlot;
+	desktop->firstFreeWindowSlot = slot;
+}
+
+// Returns a slot.
+static size_t WindowInvestigator_SimulatedDesktop_PickWindow(WindowInvestigator_SimulatedDesktop* desktop) {
+	return desktop->zOrder[WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, (uint32_t)desktop->windowCount)];
+}
+
+static void WindowInvestigator_SimulatedDesktop_MoveWindow(WindowInvestigator_SimulatedDesktop* desktop) {
+	const size_t slot = WindowInvestigator_SimulatedDesktop_PickWindow(desktop);
+	WindowInvestigator_WindowInfo* const info = &desktop->windows[slot].info;
+	WindowInvestigator_SimulatedDesktop_SetRect(info,
+		info->windowRect.left + (int32_t)WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, 41) - 20,
+		info->windowRect.top + (int32_t)WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, 41) - 20,
+		info->windowRect.right - info->windowRect.left, info->windowRect.bottom - info->windowRect.top);
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_LOCATION, slot);
+}
+
+static void WindowInvestigator_SimulatedDesktop_FlipStyle(WindowInvestigator_SimulatedDesktop* desktop) {
+	const size_t slot = WindowInvestigator_SimulatedDesktop_PickWindow(desktop);
+	WindowInvestigator_WindowInfo* const info = &desktop->windows[slot].info;
+	WindowInvestigator_WindowNotification notification;
+	switch (WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, 5)) {
+	// Like on Windows, minimizing, maximizing and restoring are location changes.
+	case 0:
+		info->styles ^= WindowInvestigator_SimulatedDesktop_WS_MAXIMIZE;
+		info->placement.showCmd = info->styles & WindowInvestigator_SimulatedDesktop_WS_MAXIMIZE ? WindowInvestigator_SimulatedDesktop_SW_SHOWMAXIMIZED : WindowInvestigator_SimulatedDesktop_SW_SHOWNORMAL;
+		notification = WindowInvestigator_WindowNotification_LOCATION;
+		break;
+	case 1:
+		info->styles ^= WindowInvestigator_SimulatedDesktop_WS_MINIMIZE;
+		info->isIconic = (info->styles & WindowInvestigator_SimulatedDesktop_WS_MINIMIZE) != 0;
+		info->placement.showCmd = info->isIconic ? WindowInvestigator_SimulatedDesktop_SW_SHOWMINIMIZED : WindowInvestigator_SimulatedDesktop_SW_SHOWNORMAL;
+		notification = WindowInvestigator_WindowNotification_LOCATION;
+		break;
+	case 2:
+		info->styles ^= WindowInvestigator_SimulatedDesktop_WS_VISIBLE;
+		info->isVisible = (info->styles & WindowInvestigator_SimulatedDesktop_WS_VISIBLE) != 0;
+		notification = info->isVisible ? WindowInvestigator_WindowNotification_SHOW : WindowInvestigator_WindowNotification_HIDE;
+		break;
+	case 3:
+		info->extendedStyles ^= WindowInvestigator_SimulatedDesktop_WS_EX_TOPMOST;
+		notification = WindowInvestigator_WindowNotification_REORDER;
+		break;
+	default:
+		info->dwmIsCloaked = info->dwmIsCloaked == 0 ? WindowInvestigator_SimulatedDesktop_DWM_CLOAKED_SHELL : 0;
+		notification = WindowInvestigator_WindowNotification_CLOAK;
+		break;
+	}
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, notification, slot);
+}
+
+// Fullscreen windows cover a whole monitor, and are brought to the front, like games and video players typically do.
+static void WindowInvestigator_SimulatedDesktop_ToggleFullscreen(WindowInvestigator_SimulatedDesktop* desktop) {
+	const size_t zOrder = WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, (uint32_t)desktop->windowCount);
+	const size_t slot = desktop->zOrder[zOrder];
+	WindowInvestigator_WindowInfo* const info = &desktop->windows[slot].info;
+	for (size_t monitor = 0; monitor < WindowInvestigator_SimulatedDesktop_MONITOR_COUNT; ++monitor)
+		if (memcmp(&info->windowRect, &WindowInvestigator_SimulatedDesktop_monitors[monitor], sizeof(info->windowRect)) == 0) {
+			WindowInvestigator_SimulatedDesktop_SetRandomRect(desktop, info);
+			WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_LOCATION, slot);
+			return;
+		}
+
+	const WindowInvestigator_Rect* const monitorRect = &WindowInvestigator_SimulatedDesktop_monitors[WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, WindowInvestigator_SimulatedDesktop_MONITOR_COUNT)];
+	WindowInvestigator_SimulatedDesktop_SetRect(info, monitorRect->left, monitorRect->top, monitorRect->right - monitorRect->left, monitorRect->bottom - monitorRect->top);
+	WindowInvestigator_SimulatedDesktop_RemoveFromZOrder(desktop, zOrder);
+	WindowInvestigator_SimulatedDesktop_InsertIntoZOrder(desktop, slot, 0);
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_LOCATION, slot);
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_REORDER, slot);
+}
+
+static void WindowInvestigator_SimulatedDesktop_ChangeText(WindowInvestigator_SimulatedDesktop* desktop) {
+	const size_t slot = WindowInvestigator_SimulatedDesktop_PickWindow(desktop);
+	WindowInvestigator_SimulatedWindow* const window = &desktop->windows[slot];
+	WindowInvestigator_SimulatedDesktop_FormatText(window->text, sizeof(window->text) / sizeof(*window->text), L"Simulated window ", desktop->nextTextId++);
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_NAME, slot);
+}
+
+static void WindowInvestigator_SimulatedDesktop_RaiseWindow(WindowInvestigator_SimulatedDesktop* desktop) {
+	const size_t zOrder = WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, (uint32_t)desktop->windowCount);
+	const size_t slot = desktop->zOrder[zOrder];
+	WindowInvestigator_SimulatedDesktop_RemoveFromZOrder(desktop, zOrder);
+	WindowInvestigator_SimulatedDesktop_InsertIntoZOrder(desktop, slot, 0);
+	WindowInvestigator_SimulatedDesktop_Notify(desktop, WindowInvestigator_WindowNotification_REORDER, slot);
+}
+
+void WindowInvestigator_SimulatedDesktop_GetDefaultOptions(WindowInvestigator_SimulatedDesktopOptions* options) {
+	options->seed = 1;
+	options->initialWindowCount = 500;
+	options->visibleFraction = 0.5;
+	options->createRate = 0.05;
+	options->destroyRate = 0.05;
+	options->replaceRate = 0;
+	options->moveRate = 0.5;
+	options->styleFlipRate = 0.1;
+	options->textChangeRate = 0.5;
+	options->zOrderChangeRate = 0.1;
+	options->fullscreenRate = 0;
+	options->windowInfoLatencyNanoseconds = 0;
+	options->slowWindowFraction = 0;
+	options->slowWindowInfoLatencyNanoseconds = 0;
+	options->onNotification = NULL;
+	options->onNotificationContext = NULL;
+}
+
+void WindowInvestigator_SimulatedDesktop_Init(WindowInvestigator_SimulatedDesktop* desktop, const WindowInvestigator_SimulatedDesktopOptions* options) {
+	memset(desktop, 0, sizeof(*desktop));
+	desktop->options = *options;
+	desktop->randomState = options->seed;
+	desktop->firstFreeWindowSlot = WindowInvestigator_SimulatedDesktop_NO_SLOT;
+	desktop->nextGeneration = 1;
+
+	desktop->options.onNotification = NULL;
+	for (size_t index = 0; index < options->initialWindowCount; ++index)
+		WindowInvestigator_SimulatedDesktop_CreateWindow(desktop, desktop->windowCount);
+	desktop->options.onNotification = options->onNotification;
+}
+
+void WindowInvestigator_SimulatedDesktop_Destroy(WindowInvestigator_SimulatedDesktop* desktop) {
+	WindowInvestigator_Free(desktop->windows);
+	WindowInvestigator_Free(desktop->zOrder);
+	memset(desktop, 0, sizeof(*desktop));
+}
+
+void WindowInvestigator_SimulatedDesktop_Step(WindowInvestigator_SimulatedDesktop* desktop) {
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.destroyRate); count > 0 && desktop->windowCount > 0; --count)
+		WindowInvestigator_SimulatedDesktop_DestroyWindow(desktop, WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, (uint32_t)desktop->windowCount));
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.createRate); count > 0; --count)
+		WindowInvestigator_SimulatedDesktop_CreateWindow(desktop, 0);
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.replaceRate); count > 0 && desktop->windowCount > 0; --count) {
+		WindowInvestigator_SimulatedDesktop_DestroyWindow(desktop, WindowInvestigator_SimulatedDesktop_RandomBelow(desktop, (uint32_t)desktop->windowCount));
+		WindowInvestigator_SimulatedDesktop_CreateWindow(desktop, 0);
+	}
+
+	if (desktop->windowCount == 0) return;
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.moveRate); count > 0; --count)
+		WindowInvestigator_SimulatedDesktop_MoveWindow(desktop);
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.styleFlipRate); count > 0; --count)
+		WindowInvestigator_SimulatedDesktop_FlipStyle(desktop);
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.textChangeRate); count > 0; --count)
+		WindowInvestigator_SimulatedDesktop_ChangeText(desktop);
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.zOrderChangeRate); count > 0; --count)
+		WindowInvestigator_SimulatedDesktop_RaiseWindow(desktop);
+	for (size_t count = WindowInvestigator_SimulatedDesktop_GetEventCount(desktop, desktop->options.fullscreenRate); count > 0; --count)
+		WindowInvestigator_SimulatedDesktop_ToggleFullscreen(desktop);
+}
+
+const WindowInvestigator_Rect* WindowInvestigator_SimulatedDesktop_GetMonitors(void) {
+	return WindowInvestigator_SimulatedDesktop_monitors;
+}
+
+static uintptr_t WindowInvestigator_SimulatedDesktop_GetNextWindow(void* context, uintptr_t handle) {
+	WindowInvestigator_SimulatedDesktop* const desktop = context;
+	++desktop->callCounts.getNextWindow;
+
+	size_t zOrder = 0;
+	if (handle != 0) {
+		const WindowInvestigator_SimulatedWindow* const window = WindowInvestigator_SimulatedDesktop_GetWindow(desktop, handle);
+		if (window == NULL) return 0;
+		zOrder = window->zOrder + 1;
+	}
+	return zOrder < desktop->windowCount ? WindowInvestigator_SimulatedDesktop_GetHandle(desktop, desktop->zOrder[zOrder]) : 0;
+}
+
+static bool WindowInvestigator_SimulatedDesktop_IsWindowVisible(void* context, uintptr_t handle) {
+	WindowInvestigator_SimulatedDesktop* const desktop = context;
+	++desktop->callCounts.isWindowVisible;
+
+	const WindowInvestigator_SimulatedWindow* const window = WindowInvestigator_SimulatedDesktop_GetWindow(desktop, handle);
+	return window != NULL && window->info.isVisible;
+}
+
+static void WindowInvestigator_SimulatedDesktop_CaptureString(WindowInvestigator_CapturedString* capturedString, const wchar_t* string) {
+	const size_t capacity = sizeof(capturedString->string) / sizeof(*capturedString->string);
+	size_t length = 0;
+	for (; string[length] != 0 && length < capacity - 1; ++length)
+		capturedString->string[length] = string[length];
+	WindowInvestigator_FinishCapturedString(capturedString, length);
+}
+
+static void WindowInvestigator_SimulatedDesktop_GetWindowInfo(void* context, uintptr_t handle, uint32_t fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings) {
+	const WindowInvestigator_SimulatedDesktop* const desktop = context;
+	// String IDs are set by the engine.
+	const uint32_t nonStringFields = fields & ~(WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME) | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT));
+
+	const WindowInvestigator_SimulatedWindow* const window = WindowInvestigator_SimulatedDesktop_GetWindow(desktop, handle);
+	if (window == NULL) {
+		WindowInvestigator_WindowInfo emptyWindowInfo;
+		memset(&emptyWindowInfo, 0, sizeof(emptyWindowInfo));
+		WindowInvestigator_CopyWindowInfoFields(windowInfo, &emptyWindowInfo, nonStringFields);
+		WindowInvestigator_FinishCapturedString(&windowStrings->className, 0);
+		WindowInvestigator_FinishCapturedString(&windowStrings->text, 0);
+		return;
+	}
+
+	if (window->windowInfoLatencyNanoseconds != 0) WindowInvestigator_SleepNanoseconds(window->windowInfoLatencyNanoseconds);
+
+	WindowInvestigator_CopyWindowInfoFields(windowInfo, &window->info, nonStringFields);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		WindowInvestigator_SimulatedDesktop_CaptureString(&windowStrings->className, window->className);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		WindowInvestigator_SimulatedDesktop_CaptureString(&windowStrings->text, window->text);
+}
+
+bool WindowInvestigator_SimulatedDesktop_GetWindowIdentity(const WindowInvestigator_SimulatedDesktop* desktop, uintptr_t handle, uint32_t* processId, const wchar_t** className) {
+	const WindowInvestigator_SimulatedWindow* const window = WindowInvestigator_SimulatedDesktop_GetWindow(desktop, handle);
+	if (window == NULL) return false;
+	*processId = window->info.processId;
+	*className = window->className;
+	return true;
+}
+
+const wchar_t* WindowInvestigator_SimulatedDesktop_GetImageName(uint32_t processId) {
+	const size_t imageNameCount = sizeof(WindowInvestigator_SimulatedDesktop_imageNames) / sizeof(*WindowInvestigator_SimulatedDesktop_imageNames);
+	return WindowInvestigator_SimulatedDesktop_imageNames[(processId / 4) % imageNameCount];
+}
+
+void WindowInvestigator_SimulatedDesktop_GetBackend(WindowInvestigator_SimulatedDesktop* desktop, WindowInvestigator_MonitorBackend* backend) {
+	backend->getNextWindow = WindowInvestigator_SimulatedDesktop_GetNextWindow;
+	backend->isWindowVisible = WindowInvestigator_SimulatedDesktop_IsWindowVisible;
+	backend->getWindowInfo = WindowInvestigator_SimulatedDesktop_GetWindowInfo;
+	backend->context = desktop;
+}
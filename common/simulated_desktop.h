@@ -0,0 +1,112 @@
+#pragma once
+
+#include "monitor.h"
+#include "window_info.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WindowInvestigator_SimulatedDesktop_MONITOR_COUNT 4
+
+// Deterministic simulated desktop that can be used as a WindowMonitor backend on any platform.
+//
+// Every call to WindowInvestigator_SimulatedDesktop_Step() applies a pseudo-random (but reproducible for a given seed) set of
+// changes to the desktop: window creation and destruction, moves, style flips, title changes and Z-order churn. This makes it
+// possible to profile the monitoring engine at desktop sizes that are hard to reproduce on real hardware.
+//
+// Window handles follow the same general scheme as real HWNDs: the low 16 bits are an index that gets reused, and the high
+// bits are a uniqueness counter. This means at most 65536 windows can exist at the same time.
+//
+// The desktop spans WindowInvestigator_SimulatedDesktop_MONITOR_COUNT monitors of different sizes, arranged around
+// the primary monitor; see WindowInvestigator_SimulatedDesktop_GetMonitors().
+//
+// The getWindowInfo backend function does not modify the desktop, so it can be called concurrently, as long as
+// WindowInvestigator_SimulatedDesktop_Step() is not called at the same time.
+
+typedef struct {
+	uint64_t seed;
+	size_t initialWindowCount;
+	// Fraction of windows that are visible. Real desktops have many invisible top-level windows, which WindowMonitor has to
+	// skip.
+	double visibleFraction;
+
+	// Average number of events of each kind per step. The fractional part is applied probabilistically.
+	double createRate;
+	double destroyRate;
+	// Windows destroyed and immediately replaced with a new window, like tooltips, menus and toasts come and go. Unlike with
+	// independent create and destroy rates, the number of windows does not drift.
+	double replaceRate;
+	double moveRate;
+	double styleFlipRate;
+	double textChangeRate;
+	double zOrderChangeRate;
+	// Windows that go fullscreen on one of the simulated monitors, or come back from fullscreen.
+	double fullscreenRate;
+
+	// How long getWindowInfo takes to return, to simulate the cost of querying window properties. A fraction of windows are
+	// "slow", e.g. because their owner is busy or DWM is slow to respond.
+	uint64_t windowInfoLatencyNanoseconds;
+	double slowWindowFraction;
+	uint64_t slowWindowInfoLatencyNanoseconds;
+
+	// If not NULL, called for every change made by WindowInvestigator_SimulatedDesktop_Step(), like WinEvents would be on
+	// Windows (e.g. a move is a LOCATION notification), including changes to invisible windows. Windows that exist from the
+	// start are not notified. Called from within WindowInvestigator_SimulatedDesktop_Step(), after the change was made.
+	void (*onNotification)(void* context, WindowInvestigator_WindowNotification notification, uintptr_t window);
+	void* onNotificationContext;
+} WindowInvestigator_SimulatedDesktopOptions;
+
+typedef struct {
+	// 0 if the slot is free.
+	uint32_t generation;
+	size_t zOrder;
+	uint64_t windowInfoLatencyNanoseconds;
+	size_t nextFreeSlot;
+	// String IDs are unused; strings are stored separately.
+	WindowInvestigator_WindowInfo info;
+	const wchar_t* className;
+	wchar_t text[32];
+} WindowInvestigator_SimulatedWindow;
+
+// getWindowInfo calls are not counted here because they can happen concurrently; see WindowInvestigator_MonitorStatistics.
+typedef struct {
+	uint64_t getNextWindow;
+	uint64_t isWindowVisible;
+} WindowInvestigator_SimulatedDesktopCallCounts;
+
+typedef struct {
+	WindowInvestigator_SimulatedDesktopOptions options;
+	uint64_t randomState;
+
+	WindowInvestigator_SimulatedWindow* windows;
+	size_t windowSlotCount;
+	size_t windowSlotCapacity;
+	size_t firstFreeWindowSlot;
+	uint32_t nextGeneration;
+
+	// Slot indices, frontmost window first.
+	size_t* zOrder;
+	size_t windowCount;
+
+	uint64_t nextTextId;
+	WindowInvestigator_SimulatedDesktopCallCounts callCounts;
+} WindowInvestigator_SimulatedDesktop;
+
+void WindowInvestigator_SimulatedDesktop_GetDefaultOptions(WindowInvestigator_SimulatedDesktopOptions* options);
+
+void WindowInvestigator_SimulatedDesktop_Init(WindowInvestigator_SimulatedDesktop* desktop, const WindowInvestigator_SimulatedDesktopOptions* options);
+void WindowInvestigator_SimulatedDesktop_Destroy(WindowInvestigator_SimulatedDesktop* desktop);
+
+void WindowInvestigator_SimulatedDesktop_Step(WindowInvestigator_SimulatedDesktop* desktop);
+
+// Returns the rects of the simulated monitors. There are always WindowInvestigator_SimulatedDesktop_MONITOR_COUNT of them.
+const WindowInvestigator_Rect* WindowInvestigator_SimulatedDesktop_GetMonitors(void);
+
+// What WindowMonitor gets from GetWindowThreadProcessId() and GetClassNameW() to evaluate window filters (see
+// window_filter.h). Returns false if the window does not exist.
+bool WindowInvestigator_SimulatedDesktop_GetWindowIdentity(const WindowInvestigator_SimulatedDesktop* desktop, uintptr_t window, uint32_t* processId, const wchar_t** className);
+// Full path of the image of a simulated process. Process IDs are spread over a handful of well-known applications.
+const wchar_t* WindowInvestigator_SimulatedDesktop_GetImageName(uint32_t processId);
+
+void WindowInvestigator_SimulatedDesktop_GetBackend(WindowInvestigator_SimulatedDesktop* desktop, WindowInvestigator_MonitorBackend* backend);
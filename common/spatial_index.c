@@ -0,0 +1,328 @@
+#include "spatial_index.h"
+
+#include "allocation.h"
+
+#include <string.h>
+
+static bool WindowInvestigator_SpatialIndex_IsEmpty(const WindowInvestigator_Rect* rect) {
+	return rect->left >= rect->right || rect->top >= rect->bottom;
+}
+
+static bool WindowInvestigator_SpatialIndex_Intersects(const WindowInvestigator_Rect* lhs, const WindowInvestigator_Rect* rhs) {
+	return lhs->left < rhs->right && rhs->left < lhs->right && lhs->top < rhs->bottom && rhs->top < lhs->bottom;
+}
+
+static bool WindowInvestigator_SpatialIndex_Contains(const WindowInvestigator_Rect* outer, const WindowInvestigator_Rect* inner) {
+	return outer->left <= inner->left && outer->top <= inner->top && outer->right >= inner->right && outer->bottom >= inner->bottom;
+}
+
+// Returns the cell that contains the specified coordinate along one axis, clamped to the grid.
+static size_t WindowInvestigator_SpatialIndex_GetCell(int32_t coordinate, int32_t origin, int32_t cellSize, size_t cellCount) {
+	if (coordinate <= origin) return 0;
+	const size_t cell = (size_t)(((int64_t)coordinate - origin) / cellSize);
+	return cell < cellCount ? cell : cellCount - 1;
+}
+
+// Lays out cells of cellSize along an axis of the specified length, stretching them if there would be too many.
+static void WindowInvestigator_SpatialIndex_LayOutAxis(int64_t length, int32_t cellSize, int32_t* actualCellSize, size_t* cellCount) {
+	int64_t count = (length + cellSize - 1) / cellSize;
+	if (count < 1) count = 1;
+	if (count > WindowInvestigator_SpatialIndex_MAX_CELLS_PER_AXIS) {
+		count = WindowInvestigator_SpatialIndex_MAX_CELLS_PER_AXIS;
+		*actualCellSize = (int32_t)((length + count - 1) / count);
+	}
+	else *actualCellSize = cellSize;
+	*cellCount = (size_t)count;
+}
+
+static WindowInvestigator_SpatialIndexCell* WindowInvestigator_SpatialIndex_GetGridCell(const WindowInvestigator_SpatialIndex* index, size_t column, size_t row) {
+	return &index->cells[row * index->columnCount + column];
+}
+
+static void WindowInvestigator_SpatialIndex_GetCellRange(const WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect, size_t* firstColumn, size_t* firstRow, size_t* lastColumn, size_t* lastRow) {
+	*firstColumn = WindowInvestigator_SpatialIndex_GetCell(rect->left, index->bounds.left, index->cellWidth, index->columnCount);
+	*firstRow = WindowInvestigator_SpatialIndex_GetCell(rect->top, index->bounds.top, index->cellHeight, index->rowCount);
+	*lastColumn = WindowInvestigator_SpatialIndex_GetCell(rect->right - 1, index->bounds.left, index->cellWidth, index->columnCount);
+	*lastRow = WindowInvestigator_SpatialIndex_GetCell(rect->bottom - 1, index->bounds.top, index->cellHeight, index->rowCount);
+}
+
+static void WindowInvestigator_SpatialIndex_AddToCells(WindowInvestigator_SpatialIndex* index, size_t slot) {
+	WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+	WindowInvestigator_SpatialIndex_GetCellRange(index, &entry->rect, &entry->firstColumn, &entry->firstRow, &entry->lastColumn, &entry->lastRow);
+	for (size_t row = entry->firstRow; row <= entry->lastRow; ++row)
+		for (size_t column = entry->firstColumn; column <= entry->lastColumn; ++column) {
+			WindowInvestigator_SpatialIndexCell* const cell = WindowInvestigator_SpatialIndex_GetGridCell(index, column, row);
+			if (cell->slotCount == cell->slotCapacity) {
+				cell->slotCapacity = cell->slotCapacity == 0 ? 8 : cell->slotCapacity * 2;
+				cell->slots = WindowInvestigator_Reallocate(cell->slots, cell->slotCapacity, sizeof(*cell->slots));
+			}
+			cell->slots[cell->slotCount++] = slot;
+			++index->statistics.cellInsertions;
+		}
+}
+
+static void WindowInvestigator_SpatialIndex_RemoveFromCells(WindowInvestigator_SpatialIndex* index, size_t slot) {
+	const WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+	for (size_t row = entry->firstRow; row <= entry->lastRow; ++row)
+		for (size_t column = entry->firstColumn; column <= entry->lastColumn; ++column) {
+			WindowInvestigator_SpatialIndexCell* const cell = WindowInvestigator_SpatialIndex_GetGridCell(index, column, row);
+			// Cells are small, and order within a cell does not matter.
+			for (size_t cellSlotIndex = 0; cellSlotIndex < cell->slotCount; ++cellSlotIndex) {
+				if (cell->slots[cellSlotIndex] != slot) continue;
+				cell->slots[cellSlotIndex] = cell->slots[--cell->slotCount];
+				break;
+			}
+		}
+}
+
+// Starts a new query, so that every window is tested at most once.
+static uint32_t WindowInvestigator_SpatialIndex_BeginQuery(WindowInvestigator_SpatialIndex* index) {
+	++index->statistics.queries;
+	if (++index->query == 0) {
+		for (size_t slot = 0; slot < index->entryCapacity; ++slot)
+			index->entries[slot].query = 0;
+		index->query = 1;
+	}
+	return index->query;
+}
+
+// Returns false if the window in the slot was already tested during this query.
+static bool WindowInvestigator_SpatialIndex_Test(WindowInvestigator_SpatialIndex* index, size_t slot, uint32_t query) {
+	WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+	if (entry->query == query) return false;
+	entry->query = query;
+	++index->statistics.candidatesTested;
+	return true;
+}
+
+void WindowInvestigator_SpatialIndex_Init(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_WindowTable* windows, WindowInvestigator_SpatialIndexRect rect, int32_t cellSize) {
+	memset(index, 0, sizeof(*index));
+	index->windows = windows;
+	index->rect = rect;
+	index->cellSize = cellSize;
+	WindowInvestigator_SpatialIndex_SetMonitors(index, NULL, 0);
+}
+
+void WindowInvestigator_SpatialIndex_Destroy(WindowInvestigator_SpatialIndex* index) {
+	for (size_t cellIndex = 0; cellIndex < index->cellCapacity; ++cellIndex)
+		WindowInvestigator_Free(index->cells[cellIndex].slots);
+	WindowInvestigator_Free(index->cells);
+	WindowInvestigator_Free(index->entries);
+}
+
+void WindowInvestigator_SpatialIndex_SetMonitors(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* monitors, size_t monitorCount) {
+	WindowInvestigator_Rect bounds = { 0 };
+	for (size_t monitor = 0; monitor < monitorCount; ++monitor) {
+		const WindowInvestigator_Rect* const monitorRect = &monitors[monitor];
+		if (monitor == 0 || monitorRect->left < bounds.left) bounds.left = monitorRect->left;
+		if (monitor == 0 || monitorRect->top < bounds.top) bounds.top = monitorRect->top;
+		if (monitor == 0 || monitorRect->right > bounds.right) bounds.right = monitorRect->right;
+		if (monitor == 0 || monitorRect->bottom > bounds.bottom) bounds.bottom = monitorRect->bottom;
+	}
+	index->bounds = bounds;
+	WindowInvestigator_SpatialIndex_LayOutAxis((int64_t)bounds.right - bounds.left, index->cellSize, &index->cellWidth, &index->columnCount);
+	WindowInvestigator_SpatialIndex_LayOutAxis((int64_t)bounds.bottom - bounds.top, index->cellSize, &index->cellHeight, &index->rowCount);
+
+	const size_t cellCount = index->columnCount * index->rowCount;
+	if (cellCount > index->cellCapacity) {
+		index->cells = WindowInvestigator_Reallocate(index->cells, cellCount, sizeof(*index->cells));
+		memset(index->cells + index->cellCapacity, 0, (cellCount - index->cellCapacity) * sizeof(*index->cells));
+		index->cellCapacity = cellCount;
+	}
+	for (size_t cellIndex = 0; cellIndex < index->cellCapacity; ++cellIndex)
+		index->cells[cellIndex].slotCount = 0;
+	for (size_t slot = 0; slot < index->entryCapacity; ++slot)
+		if (index->entries[slot].window != 0) WindowInvestigator_SpatialIndex_AddToCells(index, slot);
+}
+
+const WindowInvestigator_Rect* WindowInvestigator_SpatialIndex_GetRect(const WindowInvestigator_SpatialIndex* index, const WindowInvestigator_WindowInfo* windowInfo) {
+	if (!windowInfo->isVisible || windowInfo->isIconic || windowInfo->dwmIsCloaked != 0) return NULL;
+	const WindowInvestigator_Rect* const rect = index->rect == WindowInvestigator_SpatialIndexRect_WINDOW_RECT ? &windowInfo->windowRect : &windowInfo->clientRectInScreenCoordinates;
+	return WindowInvestigator_SpatialIndex_IsEmpty(rect) ? NULL : rect;
+}
+
+void WindowInvestigator_SpatialIndex_UpdateWindow(WindowInvestigator_SpatialIndex* index, uintptr_t window, const WindowInvestigator_WindowInfo* windowInfo) {
+	const size_t slot = WindowInvestigator_WindowTable_Find(index->windows, window);
+	if (slot == WindowInvestigator_WindowTable_NO_SLOT) return;
+	if (slot >= index->entryCapacity) {
+		size_t newCapacity = index->entryCapacity == 0 ? 64 : index->entryCapacity * 2;
+		while (newCapacity <= slot) newCapacity *= 2;
+		index->entries = WindowInvestigator_Reallocate(index->entries, newCapacity, sizeof(*index->entries));
+		memset(index->entries + index->entryCapacity, 0, (newCapacity - index->entryCapacity) * sizeof(*index->entries));
+		index->entryCapacity = newCapacity;
+	}
+
+	WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+	const uint32_t generation = WindowInvestigator_WindowTable_GetGeneration(index->windows, slot);
+	const WindowInvestigator_Rect* const rect = WindowInvestigator_SpatialIndex_GetRect(index, windowInfo);
+	if (rect == NULL ? entry->window == 0 : entry->window != 0 && entry->generation == generation && memcmp(rect, &entry->rect, sizeof(*rect)) == 0) return;
+
+	// The entry can also belong to a window that used to be in the same slot.
+	++index->statistics.updates;
+	if (entry->window != 0) WindowInvestigator_SpatialIndex_RemoveFromCells(index, slot);
+	entry->window = 0;
+	if (rect == NULL) return;
+	entry->window = window;
+	entry->generation = generation;
+	entry->rect = *rect;
+	WindowInvestigator_SpatialIndex_AddToCells(index, slot);
+}
+
+void WindowInvestigator_SpatialIndex_RemoveWindow(WindowInvestigator_SpatialIndex* index, uintptr_t window) {
+	const size_t slot = WindowInvestigator_WindowTable_Find(index->windows, window);
+	if (slot == WindowInvestigator_WindowTable_NO_SLOT || slot >= index->entryCapacity || index->entries[slot].window == 0 || index->entries[slot].generation != WindowInvestigator_WindowTable_GetGeneration(index->windows, slot)) return;
+	++index->statistics.updates;
+	WindowInvestigator_SpatialIndex_RemoveFromCells(index, slot);
+	index->entries[slot].window = 0;
+}
+
+uintptr_t WindowInvestigator_SpatialIndex_FindCoveringWindow(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect) {
+	const uint32_t query = WindowInvestigator_SpatialIndex_BeginQuery(index);
+	if (WindowInvestigator_SpatialIndex_IsEmpty(rect)) return 0;
+
+	// A window that contains rect is listed in the cells of all four corners of rect, so the smallest of these will do.
+	size_t firstColumn, firstRow, lastColumn, lastRow;
+	WindowInvestigator_SpatialIndex_GetCellRange(index, rect, &firstColumn, &firstRow, &lastColumn, &lastRow);
+	const WindowInvestigator_SpatialIndexCell* cell = WindowInvestigator_SpatialIndex_GetGridCell(index, firstColumn, firstRow);
+	const WindowInvestigator_SpatialIndexCell* const corners[] = {
+		WindowInvestigator_SpatialIndex_GetGridCell(index, lastColumn, firstRow),
+		WindowInvestigator_SpatialIndex_GetGridCell(index, firstColumn, lastRow),
+		WindowInvestigator_SpatialIndex_GetGridCell(index, lastColumn, lastRow),
+	};
+	for (size_t corner = 0; corner < sizeof(corners) / sizeof(*corners); ++corner)
+		if (corners[corner]->slotCount < cell->slotCount) cell = corners[corner];
+	uintptr_t coveringWindow = 0;
+	size_t coveringZOrder = SIZE_MAX;
+	for (size_t cellSlotIndex = 0; cellSlotIndex < cell->slotCount; ++cellSlotIndex) {
+		const size_t slot = cell->slots[cellSlotIndex];
+		if (!WindowInvestigator_SpatialIndex_Test(index, slot, query)) continue;
+		const WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+		if (!WindowInvestigator_SpatialIndex_Contains(&entry->rect, rect)) continue;
+		const size_t zOrder = WindowInvestigator_WindowTable_GetZOrder(index->windows, slot);
+		if (coveringWindow != 0 && zOrder >= coveringZOrder) continue;
+		coveringWindow = entry->window;
+		coveringZOrder = zOrder;
+	}
+	return coveringWindow;
+}
+
+size_t WindowInvestigator_SpatialIndex_ForEachOverlappingWindow(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect, void (*callback)(void* context, uintptr_t window), void* context) {
+	const uint32_t query = WindowInvestigator_SpatialIndex_BeginQuery(index);
+	if (WindowInvestigator_SpatialIndex_IsEmpty(rect)) return 0;
+
+	size_t firstColumn, firstRow, lastColumn, lastRow;
+	WindowInvestigator_SpatialIndex_GetCellRange(index, rect, &firstColumn, &firstRow, &lastColumn, &lastRow);
+	size_t windowCount = 0;
+	for (size_t row = firstRow; row <= lastRow; ++row)
+		for (size_t column = firstColumn; column <= lastColumn; ++column) {
+			const WindowInvestigator_SpatialIndexCell* const cell = WindowInvestigator_SpatialIndex_GetGridCell(index, column, row);
+			for (size_t cellSlotIndex = 0; cellSlotIndex < cell->slotCount; ++cellSlotIndex) {
+				const size_t slot = cell->slots[cellSlotIndex];
+				if (!WindowInvestigator_SpatialIndex_Test(index, slot, query)) continue;
+				const WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+				if (!WindowInvestigator_SpatialIndex_Intersects(&entry->rect, rect)) continue;
+				++windowCount;
+				if (callback != NULL) callback(context, entry->window);
+			}
+		}
+	return windowCount;
+}
+
+uintptr_t WindowInvestigator_SpatialIndex_FindTopmostOccluder(WindowInvestigator_SpatialIndex* index, uintptr_t window) {
+	const uint32_t query = WindowInvestigator_SpatialIndex_BeginQuery(index);
+	const size_t windowSlot = WindowInvestigator_WindowTable_Find(index->windows, window);
+	if (windowSlot == WindowInvestigator_WindowTable_NO_SLOT || windowSlot >= index->entryCapacity || index->entries[windowSlot].window == 0 || index->entries[windowSlot].generation != WindowInvestigator_WindowTable_GetGeneration(index->windows, windowSlot)) return 0;
+	const WindowInvestigator_SpatialIndexEntry* const windowEntry = &index->entries[windowSlot];
+	const size_t windowZOrder = WindowInvestigator_WindowTable_GetZOrder(index->windows, windowSlot);
+
+	// On a crowded desktop, the occluder is usually one of the first few windows in Z-order, in which case walking the Z-order
+	// is much cheaper than going through every window that shares a cell with this one. So walk the Z-order first, but give
+	// up after as many windows as there are in these cells, which bounds the cost to twice the cheapest of the two.
+	size_t candidateCount = 0;
+	for (size_t row = windowEntry->firstRow; row <= windowEntry->lastRow; ++row)
+		for (size_t column = windowEntry->firstColumn; column <= windowEntry->lastColumn; ++column)
+			candidateCount += WindowInvestigator_SpatialIndex_GetGridCell(index, column, row)->slotCount;
+	const size_t walkLength = windowZOrder < candidateCount ? windowZOrder : candidateCount;
+	for (size_t zOrder = 0; zOrder < walkLength; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(index->windows, zOrder);
+		if (slot >= index->entryCapacity) continue;
+		++index->statistics.candidatesTested;
+		const WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+		if (entry->window != 0 && WindowInvestigator_SpatialIndex_Intersects(&entry->rect, &windowEntry->rect)) return entry->window;
+	}
+	if (walkLength == windowZOrder) return 0;
+
+	uintptr_t occluder = 0;
+	size_t occluderZOrder = SIZE_MAX;
+	for (size_t row = windowEntry->firstRow; row <= windowEntry->lastRow; ++row)
+		for (size_t column = windowEntry->firstColumn; column <= windowEntry->lastColumn; ++column) {
+			const WindowInvestigator_SpatialIndexCell* const cell = WindowInvestigator_SpatialIndex_GetGridCell(index, column, row);
+			for (size_t cellSlotIndex = 0; cellSlotIndex < cell->slotCount; ++cellSlotIndex) {
+				const size_t slot = cell->slots[cellSlotIndex];
+				if (slot == windowSlot || !WindowInvestigator_SpatialIndex_Test(index, slot, query)) continue;
+				const size_t zOrder = WindowInvestigator_WindowTable_GetZOrder(index->windows, slot);
+				if (zOrder >= windowZOrder || zOrder >= occluderZOrder) continue;
+				const WindowInvestigator_SpatialIndexEntry* const entry = &index->entries[slot];
+				if (!WindowInvestigator_SpatialIndex_Intersects(&entry->rect, &windowEntry->rect)) continue;
+				occluder = entry->window;
+				occluderZOrder = zOrder;
+			}
+		}
+	return occluder;
+}
+
+static void WindowInvestigator_SpatialIndex_OnNewWindow(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	WindowInvestigator_SpatialIndex_UpdateWindow(index, window, windowInfo);
+	index->nextSink.onNewWindow(index->nextSink.context, window, zOrder, windowInfo);
+}
+
+static void WindowInvestigator_SpatialIndex_OnWindowChanged(void* context, uintptr_t window, uint32_t changedFields, const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	if (changedFields & WindowInvestigator_SpatialIndex_FIELDS) WindowInvestigator_SpatialIndex_UpdateWindow(index, window, newWindowInfo);
+	index->nextSink.onWindowChanged(index->nextSink.context, window, changedFields, oldWindowInfo, newWindowInfo);
+}
+
+static void WindowInvestigator_SpatialIndex_OnWindowZOrderChanged(void* context, uintptr_t window, size_t previousZOrder, size_t zOrder) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	index->nextSink.onWindowZOrderChanged(index->nextSink.context, window, previousZOrder, zOrder);
+}
+
+static void WindowInvestigator_SpatialIndex_OnWindowGone(void* context, uintptr_t window) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	WindowInvestigator_SpatialIndex_RemoveWindow(index, window);
+	index->nextSink.onWindowGone(index->nextSink.context, window);
+}
+
+static void WindowInvestigator_SpatialIndex_OnZOrderUpdated(void* context, size_t windowCount) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	index->nextSink.onZOrderUpdated(index->nextSink.context, windowCount);
+}
+
+static void WindowInvestigator_SpatialIndex_OnTickFinished(void* context) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	index->nextSink.onTickFinished(index->nextSink.context);
+}
+
+static void WindowInvestigator_SpatialIndex_OnLogWindowsBegin(void* context, size_t windowCount) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	index->nextSink.onLogWindowsBegin(index->nextSink.context, windowCount);
+}
+
+static void WindowInvestigator_SpatialIndex_OnLogWindow(void* context, uintptr_t window, size_t zOrder, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_SpatialIndex* const index = context;
+	index->nextSink.onLogWindow(index->nextSink.context, window, zOrder, windowInfo);
+}
+
+void WindowInvestigator_SpatialIndex_GetMonitorSink(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_MonitorSink* next, WindowInvestigator_MonitorSink* sink) {
+	index->nextSink = *next;
+	sink->onNewWindow = WindowInvestigator_SpatialIndex_OnNewWindow;
+	sink->onWindowChanged = WindowInvestigator_SpatialIndex_OnWindowChanged;
+	sink->onWindowZOrderChanged = WindowInvestigator_SpatialIndex_OnWindowZOrderChanged;
+	sink->onWindowGone = WindowInvestigator_SpatialIndex_OnWindowGone;
+	sink->onZOrderUpdated = WindowInvestigator_SpatialIndex_OnZOrderUpdated;
+	sink->onTickFinished = WindowInvestigator_SpatialIndex_OnTickFinished;
+	sink->onLogWindowsBegin = WindowInvestigator_SpatialIndex_OnLogWindowsBegin;
+	sink->onLogWindow = WindowInvestigator_SpatialIndex_OnLogWindow;
+	sink->context = index;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "monitor.h"
+#include "window_info.h"
+#include "window_table.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Spatial index over the rects of the windows in a window table, to answer coverage ("does any window cover this monitor
+// entirely?"), overlap ("which windows overlap this one?") and occlusion ("which window is in front of this one?") queries
+// without scanning every window.
+//
+// The index is a uniform grid spanning the bounding box of the display monitors. Every window is listed in each cell that its
+// rect intersects; rects that extend beyond the grid are clamped to the border cells, which preserves intersections. A query
+// then only needs to test the windows listed in the cells that its rect intersects. Coverage queries are even cheaper: a
+// window that contains a rect is necessarily listed in the cell of its top-left corner, so only that cell is looked at.
+//
+// The index is maintained incrementally from window changes: a window only moves between cells if its rect or its visibility
+// changes. Only windows that can be seen are indexed, i.e. windows that are visible, not minimized and not cloaked, and whose
+// rect is not empty. "Frontmost" refers to the Z-order of the table as of its last completed pass.
+
+// Cells are square, unless the grid would have more than WindowInvestigator_SpatialIndex_MAX_CELLS_PER_AXIS cells along one
+// axis, in which case they are stretched along that axis.
+#define WindowInvestigator_SpatialIndex_DEFAULT_CELL_SIZE 256
+#define WindowInvestigator_SpatialIndex_MAX_CELLS_PER_AXIS 256
+
+typedef enum {
+	WindowInvestigator_SpatialIndexRect_WINDOW_RECT,
+	WindowInvestigator_SpatialIndexRect_CLIENT_RECT_IN_SCREEN_COORDINATES,
+} WindowInvestigator_SpatialIndexRect;
+
+// Fields of WindowInvestigator_WindowInfo that the index depends on, as a bitmask of WindowInvestigator_WindowField_BIT().
+#define WindowInvestigator_SpatialIndex_FIELDS ( \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC) | \
+	WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE))
+
+typedef struct {
+	// 0 if the slot is not indexed.
+	uintptr_t window;
+	// Generation of the slot (see window_table.h) when the window was indexed. The entry can still belong to a window that used
+	// to be in the slot, until that slot is updated.
+	uint32_t generation;
+	WindowInvestigator_Rect rect;
+	// Range of cells the window is listed in, inclusive.
+	size_t firstColumn;
+	size_t firstRow;
+	size_t lastColumn;
+	size_t lastRow;
+	// Last query that tested the window, so that windows listed in several cells are only tested once per query.
+	uint32_t query;
+} WindowInvestigator_SpatialIndexEntry;
+
+typedef struct {
+	// Slots in the window table.
+	size_t* slots;
+	size_t slotCount;
+	size_t slotCapacity;
+} WindowInvestigator_SpatialIndexCell;
+
+typedef struct {
+	// Number of times a window was added to, moved within, or removed from the index.
+	uint64_t updates;
+	// Number of times a window was listed in a cell.
+	uint64_t cellInsertions;
+	uint64_t queries;
+	// Number of windows whose rect was tested by queries, summed over all queries.
+	uint64_t candidatesTested;
+} WindowInvestigator_SpatialIndexStatistics;
+
+typedef struct {
+	// Values are WindowInvestigator_WindowInfo.
+	const WindowInvestigator_WindowTable* windows;
+	WindowInvestigator_SpatialIndexRect rect;
+	int32_t cellSize;
+
+	// Bounding box of the monitors.
+	WindowInvestigator_Rect bounds;
+	int32_t cellWidth;
+	int32_t cellHeight;
+	size_t columnCount;
+	size_t rowCount;
+	// columnCount * rowCount cells, row by row. Cells beyond that are unused, but keep their allocations.
+	WindowInvestigator_SpatialIndexCell* cells;
+	size_t cellCapacity;
+
+	// Indexed by slot in windows.
+	WindowInvestigator_SpatialIndexEntry* entries;
+	size_t entryCapacity;
+	uint32_t query;
+
+	// Only used by WindowInvestigator_SpatialIndex_GetMonitorSink().
+	WindowInvestigator_MonitorSink nextSink;
+
+	WindowInvestigator_SpatialIndexStatistics statistics;
+} WindowInvestigator_SpatialIndex;
+
+// windows is the table of a WindowInvestigator_Monitor or WindowInvestigator_CaptureState, whose values are
+// WindowInvestigator_WindowInfo. It must outlive the index. The grid is a single cell until
+// WindowInvestigator_SpatialIndex_SetMonitors() is called.
+void WindowInvestigator_SpatialIndex_Init(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_WindowTable* windows, WindowInvestigator_SpatialIndexRect rect, int32_t cellSize);
+void WindowInvestigator_SpatialIndex_Destroy(WindowInvestigator_SpatialIndex* index);
+
+// Lays out the grid over the bounding box of the monitors. Every window that is already indexed is listed again.
+void WindowInvestigator_SpatialIndex_SetMonitors(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* monitors, size_t monitorCount);
+
+// Returns the rect of windowInfo that the index uses, or NULL if a window with these properties would not be indexed.
+const WindowInvestigator_Rect* WindowInvestigator_SpatialIndex_GetRect(const WindowInvestigator_SpatialIndex* index, const WindowInvestigator_WindowInfo* windowInfo);
+
+// Brings the entry of window up to date with windowInfo. The window must be in the table.
+void WindowInvestigator_SpatialIndex_UpdateWindow(WindowInvestigator_SpatialIndex* index, uintptr_t window, const WindowInvestigator_WindowInfo* windowInfo);
+// Must be called before the window is removed from the table.
+void WindowInvestigator_SpatialIndex_RemoveWindow(WindowInvestigator_SpatialIndex* index, uintptr_t window);
+
+// Returns the frontmost window whose rect contains rect, or 0 if there is none.
+uintptr_t WindowInvestigator_SpatialIndex_FindCoveringWindow(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect);
+// Calls callback for every window whose rect intersects rect, in no particular order, and returns the number of such windows.
+// callback can be NULL.
+size_t WindowInvestigator_SpatialIndex_ForEachOverlappingWindow(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_Rect* rect, void (*callback)(void* context, uintptr_t window), void* context);
+// Returns the frontmost window that is in front of window and whose rect intersects the rect of window, or 0 if there is none
+// or if window is not indexed.
+uintptr_t WindowInvestigator_SpatialIndex_FindTopmostOccluder(WindowInvestigator_SpatialIndex* index, uintptr_t window);
+
+// Fills a monitor sink that passes every event on to next, and keeps the index up to date.
+void WindowInvestigator_SpatialIndex_GetMonitorSink(WindowInvestigator_SpatialIndex* index, const WindowInvestigator_MonitorSink* next, WindowInvestigator_MonitorSink* sink);
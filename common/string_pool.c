@@ -0,0 +1,201 @@
+#include "string_pool.h"
+
+#include "allocation.h"
+
+#include <string.h>
+
+#define WindowInvestigator_StringPool_NO_ENTRY UINT32_MAX
+
+static const unsigned int WindowInvestigator_StringPool_initialBucketBits = 6;
+
+static uint64_t WindowInvestigator_StringPool_Mix(uint64_t hash, uint64_t word) {
+	hash ^= word;
+	hash *= UINT64_C(0x9FB21C651E98DF25);
+	return hash ^ (hash >> 47);
+}
+
+uint64_t WindowInvestigator_HashString(const wchar_t* string, size_t length) {
+	// Consumes the string 8 bytes at a time, which is 4 characters with a 16-bit wchar_t (Windows) or 2 with a 32-bit wchar_t.
+	const unsigned char* bytes = (const unsigned char*)string;
+	size_t byteCount = length * sizeof(*string);
+	uint64_t hash = WindowInvestigator_StringPool_Mix(UINT64_C(0xCBF29CE484222325), (uint64_t)length);
+	for (; byteCount >= sizeof(uint64_t); bytes += sizeof(uint64_t), byteCount -= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		hash = WindowInvestigator_StringPool_Mix(hash, word);
+	}
+	if (byteCount > 0) {
+		uint64_t word = 0;
+		memcpy(&word, bytes, byteCount);
+		hash = WindowInvestigator_StringPool_Mix(hash, word);
+	}
+
+	// Final avalanche (MurmurHash3 fmix64) so that the high bits used by Fibonacci hashing depend on every input bit.
+	hash ^= hash >> 33;
+	hash *= UINT64_C(0xFF51AFD7ED558CCD);
+	hash ^= hash >> 33;
+	hash *= UINT64_C(0xC4CEB9FE1A85EC53);
+	return hash ^ (hash >> 33);
+}
+
+// Smallest buffer size that fits length characters and the null terminator.
+static size_t WindowInvestigator_StringPool_GetCapacity(size_t length) {
+	size_t capacity = (size_t)1 << WindowInvestigator_StringPool_MIN_CAPACITY_BITS;
+	while (capacity < length + 1) capacity *= 2;
+	return capacity;
+}
+
+static unsigned int WindowInvestigator_StringPool_GetSizeClass(size_t capacity) {
+	unsigned int sizeClass = 0;
+	while (sizeClass < WindowInvestigator_StringPool_SIZE_CLASS_COUNT - 1 && capacity > ((size_t)1 << (WindowInvestigator_StringPool_MIN_CAPACITY_BITS + sizeClass)))
+		++sizeClass;
+	return sizeClass;
+}
+
+// Takes a free entry, preferably one whose buffer fits the string without waste, then one whose buffer fits it anyway, then
+// any. Returns WindowInvestigator_StringPool_NO_ENTRY if there are no free entries.
+static WindowInvestigator_StringId WindowInvestigator_StringPool_TakeFreeEntry(WindowInvestigator_StringPool* pool, size_t capacity) {
+	const unsigned int sizeClass = WindowInvestigator_StringPool_GetSizeClass(capacity);
+	unsigned int freeSizeClass = WindowInvestigator_StringPool_SIZE_CLASS_COUNT;
+	for (unsigned int candidate = sizeClass; candidate < WindowInvestigator_StringPool_SIZE_CLASS_COUNT; ++candidate) {
+		const WindowInvestigator_StringId id = pool->firstFreeEntries[candidate];
+		// Only entries of the last size class can be too small for their class.
+		if (id == WindowInvestigator_StringPool_NO_ENTRY || pool->entries[id].capacity < capacity) continue;
+		freeSizeClass = candidate;
+		break;
+	}
+	for (unsigned int candidate = sizeClass + 1; freeSizeClass == WindowInvestigator_StringPool_SIZE_CLASS_COUNT && candidate-- > 0;)
+		if (pool->firstFreeEntries[candidate] != WindowInvestigator_StringPool_NO_ENTRY) freeSizeClass = candidate;
+	if (freeSizeClass == WindowInvestigator_StringPool_SIZE_CLASS_COUNT) return WindowInvestigator_StringPool_NO_ENTRY;
+
+	const WindowInvestigator_StringId id = pool->firstFreeEntries[freeSizeClass];
+	pool->firstFreeEntries[freeSizeClass] = pool->entries[id].nextFreeEntry;
+	return id;
+}
+
+static size_t WindowInvestigator_StringPool_GetBucketCount(const WindowInvestigator_StringPool* pool) {
+	return (size_t)1 << pool->bucketBits;
+}
+
+static size_t WindowInvestigator_StringPool_GetHomeBucket(const WindowInvestigator_StringPool* pool, uint64_t hash) {
+	return (size_t)((hash * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - pool->bucketBits));
+}
+
+static void WindowInvestigator_StringPool_InsertIntoIndex(WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id) {
+	const size_t bucketMask = WindowInvestigator_StringPool_GetBucketCount(pool) - 1;
+	size_t bucket = WindowInvestigator_StringPool_GetHomeBucket(pool, pool->entries[id].hash);
+	while (pool->buckets[bucket] != WindowInvestigator_StringPool_NO_ENTRY)
+		bucket = (bucket + 1) & bucketMask;
+	pool->buckets[bucket] = id;
+}
+
+static void WindowInvestigator_StringPool_ResizeIndex(WindowInvestigator_StringPool* pool, unsigned int bucketBits) {
+	WindowInvestigator_Free(pool->buckets);
+	pool->bucketBits = bucketBits;
+	const size_t bucketCount = WindowInvestigator_StringPool_GetBucketCount(pool);
+	pool->buckets = WindowInvestigator_Reallocate(NULL, bucketCount, sizeof(*pool->buckets));
+	for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+		pool->buckets[bucket] = WindowInvestigator_StringPool_NO_ENTRY;
+
+	for (WindowInvestigator_StringId id = 0; id < pool->entryCount; ++id)
+		if (pool->entries[id].referenceCount != 0)
+			WindowInvestigator_StringPool_InsertIntoIndex(pool, id);
+}
+
+static void WindowInvestigator_StringPool_RemoveFromIndex(WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id) {
+	const size_t bucketMask = WindowInvestigator_StringPool_GetBucketCount(pool) - 1;
+	size_t bucket = WindowInvestigator_StringPool_GetHomeBucket(pool, pool->entries[id].hash);
+	while (pool->buckets[bucket] != id)
+		bucket = (bucket + 1) & bucketMask;
+
+	// Backward shift deletion, same as the window table.
+	size_t hole = bucket;
+	for (;;) {
+		bucket = (bucket + 1) & bucketMask;
+		const WindowInvestigator_StringId other = pool->buckets[bucket];
+		if (other == WindowInvestigator_StringPool_NO_ENTRY) break;
+		const size_t homeBucket = WindowInvestigator_StringPool_GetHomeBucket(pool, pool->entries[other].hash);
+		if (((bucket - homeBucket) & bucketMask) < ((bucket - hole) & bucketMask)) continue;
+		pool->buckets[hole] = other;
+		hole = bucket;
+	}
+	pool->buckets[hole] = WindowInvestigator_StringPool_NO_ENTRY;
+}
+
+void WindowInvestigator_StringPool_Init(WindowInvestigator_StringPool* pool) {
+	memset(pool, 0, sizeof(*pool));
+	for (unsigned int sizeClass = 0; sizeClass < WindowInvestigator_StringPool_SIZE_CLASS_COUNT; ++sizeClass)
+		pool->firstFreeEntries[sizeClass] = WindowInvestigator_StringPool_NO_ENTRY;
+	WindowInvestigator_StringPool_ResizeIndex(pool, WindowInvestigator_StringPool_initialBucketBits);
+}
+
+void WindowInvestigator_StringPool_Destroy(WindowInvestigator_StringPool* pool) {
+	for (WindowInvestigator_StringId id = 0; id < pool->entryCount; ++id)
+		WindowInvestigator_Free(pool->entries[id].string);
+	WindowInvestigator_Free(pool->entries);
+	WindowInvestigator_Free(pool->buckets);
+	memset(pool, 0, sizeof(*pool));
+}
+
+WindowInvestigator_StringId WindowInvestigator_StringPool_Intern(WindowInvestigator_StringPool* pool, const wchar_t* string, size_t length, uint64_t hash) {
+	const size_t bucketMask = WindowInvestigator_StringPool_GetBucketCount(pool) - 1;
+	for (size_t bucket = WindowInvestigator_StringPool_GetHomeBucket(pool, hash);; bucket = (bucket + 1) & bucketMask) {
+		const WindowInvestigator_StringId id = pool->buckets[bucket];
+		if (id == WindowInvestigator_StringPool_NO_ENTRY) break;
+		if (WindowInvestigator_StringPool_Equals(pool, id, string, length, hash)) {
+			++pool->entries[id].referenceCount;
+			return id;
+		}
+	}
+
+	if ((pool->stringCount + 1) * 2 > WindowInvestigator_StringPool_GetBucketCount(pool))
+		WindowInvestigator_StringPool_ResizeIndex(pool, pool->bucketBits + 1);
+
+	const size_t capacity = WindowInvestigator_StringPool_GetCapacity(length);
+	WindowInvestigator_StringId id = WindowInvestigator_StringPool_TakeFreeEntry(pool, capacity);
+	if (id == WindowInvestigator_StringPool_NO_ENTRY) {
+		if (pool->entryCount == pool->entryCapacity) {
+			pool->entryCapacity = pool->entryCapacity == 0 ? 32 : pool->entryCapacity * 2;
+			pool->entries = WindowInvestigator_Reallocate(pool->entries, pool->entryCapacity, sizeof(*pool->entries));
+		}
+		id = pool->entryCount++;
+		pool->entries[id].string = NULL;
+		pool->entries[id].capacity = 0;
+	}
+
+	WindowInvestigator_StringPool_Entry* const entry = &pool->entries[id];
+	if (entry->capacity < capacity) {
+		entry->capacity = capacity;
+		entry->string = WindowInvestigator_Reallocate(entry->string, entry->capacity, sizeof(*entry->string));
+	}
+	wmemcpy(entry->string, string, length);
+	entry->string[length] = 0;
+	entry->length = length;
+	entry->hash = hash;
+	entry->referenceCount = 1;
+	entry->nextFreeEntry = WindowInvestigator_StringPool_NO_ENTRY;
+	++pool->stringCount;
+	pool->bytesInterned += (length + 1) * sizeof(*entry->string);
+	WindowInvestigator_StringPool_InsertIntoIndex(pool, id);
+	return id;
+}
+
+void WindowInvestigator_StringPool_Release(WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id) {
+	WindowInvestigator_StringPool_Entry* const entry = &pool->entries[id];
+	if (--entry->referenceCount != 0) return;
+
+	WindowInvestigator_StringPool_RemoveFromIndex(pool, id);
+	const unsigned int sizeClass = WindowInvestigator_StringPool_GetSizeClass(entry->capacity);
+	entry->nextFreeEntry = pool->firstFreeEntries[sizeClass];
+	pool->firstFreeEntries[sizeClass] = id;
+	--pool->stringCount;
+}
+
+const wchar_t* WindowInvestigator_StringPool_Get(const WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id) {
+	return pool->entries[id].string;
+}
+
+bool WindowInvestigator_StringPool_Equals(const WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id, const wchar_t* string, size_t length, uint64_t hash) {
+	const WindowInvestigator_StringPool_Entry* const entry = &pool->entries[id];
+	return entry->hash == hash && entry->length == length && wmemcmp(entry->string, string, length) == 0;
+}
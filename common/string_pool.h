@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+// Pool of interned, reference-counted wide strings.
+//
+// Window class names and titles are heavily shared between windows and rarely change, so storing them once and referring to
+// them by ID keeps window snapshots small and cheap to copy. Two IDs from the same pool are equal if and only if the strings
+// are equal.
+
+typedef uint32_t WindowInvestigator_StringId;
+
+// Buffers are allocated in powers of two, starting at 2^WindowInvestigator_StringPool_MIN_CAPACITY_BITS characters, and free
+// entries are sorted by buffer size, one free list per power of two (the last one also takes anything larger). An entry
+// whose buffer is large enough is thus found in constant time whenever there is one, so that once the pool has seen as many
+// strings of each size as it ever holds at once, interning stops allocating altogether, however many strings come and go.
+#define WindowInvestigator_StringPool_MIN_CAPACITY_BITS 4
+#define WindowInvestigator_StringPool_SIZE_CLASS_COUNT 24
+
+typedef struct {
+	wchar_t* string;
+	size_t length;
+	// In characters, including the null terminator. The buffer is kept when the entry is freed so that it can be reused.
+	// 0 (no buffer) or a power of two.
+	size_t capacity;
+	uint64_t hash;
+	// 0 if the entry is free.
+	uint32_t referenceCount;
+	WindowInvestigator_StringId nextFreeEntry;
+} WindowInvestigator_StringPool_Entry;
+
+typedef struct {
+	WindowInvestigator_StringPool_Entry* entries;
+	uint32_t entryCount;
+	uint32_t entryCapacity;
+	// Indexed by size class, see WindowInvestigator_StringPool_SIZE_CLASS_COUNT.
+	WindowInvestigator_StringId firstFreeEntries[WindowInvestigator_StringPool_SIZE_CLASS_COUNT];
+	uint32_t stringCount;
+
+	// Linear probing. Each bucket holds a string ID, or WindowInvestigator_StringPool_NO_ENTRY if empty.
+	WindowInvestigator_StringId* buckets;
+	unsigned int bucketBits;
+
+	// Total number of bytes of string data copied into the pool so far.
+	uint64_t bytesInterned;
+} WindowInvestigator_StringPool;
+
+void WindowInvestigator_StringPool_Init(WindowInvestigator_StringPool* pool);
+void WindowInvestigator_StringPool_Destroy(WindowInvestigator_StringPool* pool);
+
+// Fast non-cryptographic 64-bit hash of the first length characters of string. Strings of different lengths hash
+// differently even if one is a prefix of the other.
+uint64_t WindowInvestigator_HashString(const wchar_t* string, size_t length);
+
+// Returns the ID of the specified string, adding it to the pool if necessary. The caller owns one reference to the returned ID.
+// hash must be WindowInvestigator_HashString(string, length).
+WindowInvestigator_StringId WindowInvestigator_StringPool_Intern(WindowInvestigator_StringPool* pool, const wchar_t* string, size_t length, uint64_t hash);
+void WindowInvestigator_StringPool_Release(WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id);
+
+const wchar_t* WindowInvestigator_StringPool_Get(const WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id);
+// Length and hash are compared first; the characters are only compared if both match, to rule out hash collisions.
+bool WindowInvestigator_StringPool_Equals(const WindowInvestigator_StringPool* pool, WindowInvestigator_StringId id, const wchar_t* string, size_t length, uint64_t hash);
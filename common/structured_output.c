@@ -0,0 +1,444 @@
+#include "structured_output.h"
+
+#include "allocation.h"
+#include "window_record.h"
+
+#include <string.h>
+
+// In output order.
+typedef enum {
+	WindowInvestigator_StructuredColumn_TIMESTAMP,
+	WindowInvestigator_StructuredColumn_EVENT,
+	WindowInvestigator_StructuredColumn_WINDOW,
+	WindowInvestigator_StructuredColumn_ZORDER,
+	WindowInvestigator_StructuredColumn_PREVIOUS_ZORDER,
+	WindowInvestigator_StructuredColumn_WINDOW_COUNT,
+	WindowInvestigator_StructuredColumn_FIELDS,
+	WindowInvestigator_StructuredColumn_PROCESS_ID,
+	WindowInvestigator_StructuredColumn_THREAD_ID,
+	WindowInvestigator_StructuredColumn_CLASS_NAME,
+	WindowInvestigator_StructuredColumn_EXTENDED_STYLES,
+	WindowInvestigator_StructuredColumn_STYLES,
+	WindowInvestigator_StructuredColumn_WINDOW_RECT_LEFT,
+	WindowInvestigator_StructuredColumn_CLIENT_RECT_LEFT = WindowInvestigator_StructuredColumn_WINDOW_RECT_LEFT + 4,
+	WindowInvestigator_StructuredColumn_CLIENT_RECT_IN_SCREEN_COORDINATES_LEFT = WindowInvestigator_StructuredColumn_CLIENT_RECT_LEFT + 4,
+	WindowInvestigator_StructuredColumn_PLACEMENT_SHOW_CMD = WindowInvestigator_StructuredColumn_CLIENT_RECT_IN_SCREEN_COORDINATES_LEFT + 4,
+	WindowInvestigator_StructuredColumn_PLACEMENT_MIN_POSITION_X,
+	WindowInvestigator_StructuredColumn_PLACEMENT_MAX_POSITION_X = WindowInvestigator_StructuredColumn_PLACEMENT_MIN_POSITION_X + 2,
+	WindowInvestigator_StructuredColumn_PLACEMENT_NORMAL_POSITION_LEFT = WindowInvestigator_StructuredColumn_PLACEMENT_MAX_POSITION_X + 2,
+	WindowInvestigator_StructuredColumn_TEXT = WindowInvestigator_StructuredColumn_PLACEMENT_NORMAL_POSITION_LEFT + 4,
+	WindowInvestigator_StructuredColumn_IS_SHELL_MANAGED_WINDOW,
+	WindowInvestigator_StructuredColumn_IS_SHELL_FRAME_WINDOW,
+	WindowInvestigator_StructuredColumn_OVERPANNING,
+	WindowInvestigator_StructuredColumn_BAND,
+	WindowInvestigator_StructuredColumn_HAS_NON_RUDE_HWND_PROPERTY,
+	WindowInvestigator_StructuredColumn_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY,
+	WindowInvestigator_StructuredColumn_HAS_LIVE_PREVIEW_WINDOW_PROPERTY,
+	WindowInvestigator_StructuredColumn_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY,
+	WindowInvestigator_StructuredColumn_IS_WINDOW,
+	WindowInvestigator_StructuredColumn_DWM_IS_CLOAKED,
+	WindowInvestigator_StructuredColumn_IS_ICONIC,
+	WindowInvestigator_StructuredColumn_IS_VISIBLE,
+	WindowInvestigator_StructuredColumn_MESSAGE_KIND,
+	WindowInvestigator_StructuredColumn_MESSAGE,
+	WindowInvestigator_StructuredColumn_WPARAM,
+	WindowInvestigator_StructuredColumn_LPARAM,
+	WindowInvestigator_StructuredColumn_MONITOR,
+	WindowInvestigator_StructuredColumn_MONITOR_RECT_LEFT,
+	WindowInvestigator_StructuredColumn_PREVIOUS_WINDOW = WindowInvestigator_StructuredColumn_MONITOR_RECT_LEFT + 4,
+	WindowInvestigator_StructuredColumn_DROPPED_COUNT,
+	WindowInvestigator_StructuredColumn_COUNT,
+} WindowInvestigator_StructuredColumn;
+
+// Indexed by WindowInvestigator_StructuredColumn.
+static const char* const WindowInvestigator_StructuredColumn_names[WindowInvestigator_StructuredColumn_COUNT] = {
+	"timestamp", "event", "window", "zOrder", "previousZOrder", "windowCount", "fields",
+	"processId", "threadId", "className", "extendedStyles", "styles",
+	"windowRectLeft", "windowRectTop", "windowRectRight", "windowRectBottom",
+	"clientRectLeft", "clientRectTop", "clientRectRight", "clientRectBottom",
+	"clientRectInScreenCoordinatesLeft", "clientRectInScreenCoordinatesTop", "clientRectInScreenCoordinatesRight", "clientRectInScreenCoordinatesBottom",
+	"placementShowCmd", "placementMinPositionX", "placementMinPositionY", "placementMaxPositionX", "placementMaxPositionY",
+	"placementNormalPositionLeft", "placementNormalPositionTop", "placementNormalPositionRight", "placementNormalPositionBottom",
+	"text", "isShellManagedWindow", "isShellFrameWindow", "overpanning", "band",
+	"hasNonRudeHWNDProperty", "hasNonRudeAddedByRudeWindowFixerProperty", "hasLivePreviewWindowProperty", "hasTreatAsDesktopFullscreenProperty",
+	"isWindow", "dwmIsCloaked", "isIconic", "isVisible",
+	"messageKind", "message", "wParam", "lParam",
+	"monitor", "monitorRectLeft", "monitorRectTop", "monitorRectRight", "monitorRectBottom", "previousWindow",
+	"droppedCount",
+};
+
+static const char WindowInvestigator_StructuredWriter_hexDigits[] = "0123456789ABCDEF";
+
+const char* WindowInvestigator_StructuredFormat_GetName(WindowInvestigator_StructuredFormat format) {
+	switch (format) {
+	case WindowInvestigator_StructuredFormat_JSON_LINES: return "jsonl";
+	case WindowInvestigator_StructuredFormat_CSV: return "csv";
+	case WindowInvestigator_StructuredFormat_COUNT: break;
+	}
+	return "unknown";
+}
+
+bool WindowInvestigator_StructuredFormat_Parse(const char* name, WindowInvestigator_StructuredFormat* format) {
+	for (int candidate = 0; candidate < WindowInvestigator_StructuredFormat_COUNT; ++candidate) {
+		if (strcmp(name, WindowInvestigator_StructuredFormat_GetName((WindowInvestigator_StructuredFormat)candidate)) != 0) continue;
+		*format = (WindowInvestigator_StructuredFormat)candidate;
+		return true;
+	}
+	return false;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteText(char* position, const char* text) {
+	const size_t length = strlen(text);
+	memcpy(position, text, length);
+	return position + length;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteUInt64(char* position, uint64_t value) {
+	char digits[20];
+	size_t digitCount = 0;
+	do {
+		digits[digitCount++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	while (digitCount != 0) *position++ = digits[--digitCount];
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteInt32(char* position, int32_t value) {
+	if (value >= 0) return WindowInvestigator_StructuredWriter_WriteUInt64(position, (uint64_t)value);
+	*position++ = '-';
+	return WindowInvestigator_StructuredWriter_WriteUInt64(position, (uint64_t)-(int64_t)value);
+}
+
+// Writes at least minimumDigitCount digits (at least 1).
+static char* WindowInvestigator_StructuredWriter_WriteHex(char* position, uint64_t value, int minimumDigitCount) {
+	int digitCount = minimumDigitCount;
+	while (digitCount < 16 && (value >> (4 * digitCount)) != 0) ++digitCount;
+	*position++ = '0';
+	*position++ = 'x';
+	for (int digit = digitCount - 1; digit >= 0; --digit)
+		*position++ = WindowInvestigator_StructuredWriter_hexDigits[(value >> (4 * digit)) & 0xF];
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteCodePoint(char* position, uint32_t codePoint) {
+	if (codePoint < 0x800) {
+		*position++ = (char)(0xC0 | (codePoint >> 6));
+	}
+	else if (codePoint < 0x10000) {
+		*position++ = (char)(0xE0 | (codePoint >> 12));
+		*position++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+	}
+	else {
+		*position++ = (char)(0xF0 | (codePoint >> 18));
+		*position++ = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+		*position++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+	}
+	*position++ = (char)(0x80 | (codePoint & 0x3F));
+	return position;
+}
+
+// Only called for ASCII characters.
+static char* WindowInvestigator_StructuredWriter_WriteJsonCharacter(char* position, uint32_t character) {
+	switch (character) {
+	case '"': *position++ = '\\'; *position++ = '"'; return position;
+	case '\\': *position++ = '\\'; *position++ = '\\'; return position;
+	case '\b': *position++ = '\\'; *position++ = 'b'; return position;
+	case '\f': *position++ = '\\'; *position++ = 'f'; return position;
+	case '\n': *position++ = '\\'; *position++ = 'n'; return position;
+	case '\r': *position++ = '\\'; *position++ = 'r'; return position;
+	case '\t': *position++ = '\\'; *position++ = 't'; return position;
+	}
+	if (character >= 0x20) {
+		*position++ = (char)character;
+		return position;
+	}
+	*position++ = '\\';
+	*position++ = 'u';
+	*position++ = '0';
+	*position++ = '0';
+	*position++ = WindowInvestigator_StructuredWriter_hexDigits[character >> 4];
+	*position++ = WindowInvestigator_StructuredWriter_hexDigits[character & 0xF];
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteString(const WindowInvestigator_StructuredWriter* writer, char* position, const wchar_t* string, size_t length) {
+	const bool json = writer->format == WindowInvestigator_StructuredFormat_JSON_LINES;
+	*position++ = '"';
+	for (size_t index = 0; index < length; ++index) {
+		uint32_t codePoint = (uint32_t)string[index];
+		if (codePoint < 0x80) {
+			if (json) position = WindowInvestigator_StructuredWriter_WriteJsonCharacter(position, codePoint);
+			else {
+				// RFC 4180: quotes are escaped by doubling them; everything else, including line breaks, is kept as is.
+				if (codePoint == '"') *position++ = '"';
+				*position++ = (char)codePoint;
+			}
+			continue;
+		}
+		if (codePoint >= 0xD800 && codePoint < 0xDC00 && index + 1 < length && (uint32_t)string[index + 1] >= 0xDC00 && (uint32_t)string[index + 1] < 0xE000) {
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + ((uint32_t)string[index + 1] - 0xDC00);
+			++index;
+		}
+		else if ((codePoint >= 0xD800 && codePoint < 0xE000) || codePoint > 0x10FFFF)
+			codePoint = 0xFFFD;
+		position = WindowInvestigator_StructuredWriter_WriteCodePoint(position, codePoint);
+	}
+	*position++ = '"';
+	return position;
+}
+
+// Columns must be written in increasing order.
+static char* WindowInvestigator_StructuredWriter_BeginColumn(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column) {
+	if (writer->format == WindowInvestigator_StructuredFormat_CSV) {
+		for (; writer->column < (size_t)column; ++writer->column) *position++ = ',';
+		return position;
+	}
+	*position++ = writer->column++ == 0 ? '{' : ',';
+	*position++ = '"';
+	position = WindowInvestigator_StructuredWriter_WriteText(position, WindowInvestigator_StructuredColumn_names[column]);
+	*position++ = '"';
+	*position++ = ':';
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteUInt64Column(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column, uint64_t value) {
+	position = WindowInvestigator_StructuredWriter_BeginColumn(writer, position, column);
+	return WindowInvestigator_StructuredWriter_WriteUInt64(position, value);
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteInt32Column(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column, int32_t value) {
+	position = WindowInvestigator_StructuredWriter_BeginColumn(writer, position, column);
+	return WindowInvestigator_StructuredWriter_WriteInt32(position, value);
+}
+
+// JSON has no hexadecimal numbers, so these are strings in JSON.
+static char* WindowInvestigator_StructuredWriter_WriteHexColumn(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column, uint64_t value, int minimumDigitCount) {
+	const bool json = writer->format == WindowInvestigator_StructuredFormat_JSON_LINES;
+	position = WindowInvestigator_StructuredWriter_BeginColumn(writer, position, column);
+	if (json) *position++ = '"';
+	position = WindowInvestigator_StructuredWriter_WriteHex(position, value, minimumDigitCount);
+	if (json) *position++ = '"';
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteBoolColumn(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column, bool value) {
+	position = WindowInvestigator_StructuredWriter_BeginColumn(writer, position, column);
+	return WindowInvestigator_StructuredWriter_WriteText(position, value ? "true" : "false");
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteStringColumn(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column, const WindowInvestigator_CapturedString* string) {
+	position = WindowInvestigator_StructuredWriter_BeginColumn(writer, position, column);
+	return WindowInvestigator_StructuredWriter_WriteString(writer, position, string->string, string->length);
+}
+
+// name must not need escaping.
+static char* WindowInvestigator_StructuredWriter_WriteNameColumn(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn column, const char* name) {
+	position = WindowInvestigator_StructuredWriter_BeginColumn(writer, position, column);
+	*position++ = '"';
+	position = WindowInvestigator_StructuredWriter_WriteText(position, name);
+	*position++ = '"';
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteRectColumns(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn leftColumn, const WindowInvestigator_Rect* rect) {
+	position = WindowInvestigator_StructuredWriter_WriteInt32Column(writer, position, leftColumn, rect->left);
+	position = WindowInvestigator_StructuredWriter_WriteInt32Column(writer, position, (WindowInvestigator_StructuredColumn)(leftColumn + 1), rect->top);
+	position = WindowInvestigator_StructuredWriter_WriteInt32Column(writer, position, (WindowInvestigator_StructuredColumn)(leftColumn + 2), rect->right);
+	return WindowInvestigator_StructuredWriter_WriteInt32Column(writer, position, (WindowInvestigator_StructuredColumn)(leftColumn + 3), rect->bottom);
+}
+
+static char* WindowInvestigator_StructuredWriter_WritePointColumns(WindowInvestigator_StructuredWriter* writer, char* position, WindowInvestigator_StructuredColumn xColumn, const WindowInvestigator_Point* point) {
+	position = WindowInvestigator_StructuredWriter_WriteInt32Column(writer, position, xColumn, point->x);
+	return WindowInvestigator_StructuredWriter_WriteInt32Column(writer, position, (WindowInvestigator_StructuredColumn)(xColumn + 1), point->y);
+}
+
+static bool WindowInvestigator_StructuredWriter_HasField(uint32_t fields, WindowInvestigator_WindowField field) {
+	return (fields & WindowInvestigator_WindowField_BIT(field)) != 0;
+}
+
+static char* WindowInvestigator_StructuredWriter_WriteWindowFields(WindowInvestigator_StructuredWriter* writer, char* position, uint32_t fields, const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowStrings* windowStrings) {
+	position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_FIELDS, fields, 8);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_PROCESS_ID))
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_PROCESS_ID, windowInfo->processId);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_THREAD_ID))
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_THREAD_ID, windowInfo->threadId);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_CLASS_NAME))
+		position = WindowInvestigator_StructuredWriter_WriteStringColumn(writer, position, WindowInvestigator_StructuredColumn_CLASS_NAME, &windowStrings->className);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_EXTENDED_STYLES))
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_EXTENDED_STYLES, windowInfo->extendedStyles, 8);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_STYLES))
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_STYLES, windowInfo->styles, 8);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_WINDOW_RECT))
+		position = WindowInvestigator_StructuredWriter_WriteRectColumns(writer, position, WindowInvestigator_StructuredColumn_WINDOW_RECT_LEFT, &windowInfo->windowRect);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_CLIENT_RECT))
+		position = WindowInvestigator_StructuredWriter_WriteRectColumns(writer, position, WindowInvestigator_StructuredColumn_CLIENT_RECT_LEFT, &windowInfo->clientRect);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES))
+		position = WindowInvestigator_StructuredWriter_WriteRectColumns(writer, position, WindowInvestigator_StructuredColumn_CLIENT_RECT_IN_SCREEN_COORDINATES_LEFT, &windowInfo->clientRectInScreenCoordinates);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD))
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_PLACEMENT_SHOW_CMD, windowInfo->placement.showCmd);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION))
+		position = WindowInvestigator_StructuredWriter_WritePointColumns(writer, position, WindowInvestigator_StructuredColumn_PLACEMENT_MIN_POSITION_X, &windowInfo->placement.minPosition);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION))
+		position = WindowInvestigator_StructuredWriter_WritePointColumns(writer, position, WindowInvestigator_StructuredColumn_PLACEMENT_MAX_POSITION_X, &windowInfo->placement.maxPosition);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION))
+		position = WindowInvestigator_StructuredWriter_WriteRectColumns(writer, position, WindowInvestigator_StructuredColumn_PLACEMENT_NORMAL_POSITION_LEFT, &windowInfo->placement.normalPosition);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_TEXT))
+		position = WindowInvestigator_StructuredWriter_WriteStringColumn(writer, position, WindowInvestigator_StructuredColumn_TEXT, &windowStrings->text);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_IS_SHELL_MANAGED_WINDOW, windowInfo->isShellManagedWindow);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_IS_SHELL_FRAME_WINDOW, windowInfo->isShellFrameWindow);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_OVERPANNING))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_OVERPANNING, windowInfo->overpanning);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_BAND))
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_BAND, windowInfo->band);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_HAS_NON_RUDE_HWND_PROPERTY, windowInfo->hasNonRudeHWNDProperty);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY, windowInfo->hasNonRudeAddedByRudeWindowFixerProperty);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_HAS_LIVE_PREVIEW_WINDOW_PROPERTY, windowInfo->hasLivePreviewWindowProperty);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY, windowInfo->hasTreatAsDesktopFullscreenProperty);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_IS_WINDOW))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_IS_WINDOW, windowInfo->isWindow);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_DWM_IS_CLOAKED))
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_DWM_IS_CLOAKED, windowInfo->dwmIsCloaked, 8);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_IS_ICONIC))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_IS_ICONIC, windowInfo->isIconic);
+	if (WindowInvestigator_StructuredWriter_HasField(fields, WindowInvestigator_WindowField_IS_VISIBLE))
+		position = WindowInvestigator_StructuredWriter_WriteBoolColumn(writer, position, WindowInvestigator_StructuredColumn_IS_VISIBLE, windowInfo->isVisible);
+	return position;
+}
+
+static char* WindowInvestigator_StructuredWriter_BeginLine(WindowInvestigator_StructuredWriter* writer, uint64_t timestamp, const char* event) {
+	char* position = writer->buffer + writer->bufferSize;
+	writer->column = 0;
+	position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_TIMESTAMP, timestamp);
+	return WindowInvestigator_StructuredWriter_WriteNameColumn(writer, position, WindowInvestigator_StructuredColumn_EVENT, event);
+}
+
+static void WindowInvestigator_StructuredWriter_EndLine(WindowInvestigator_StructuredWriter* writer, char* position) {
+	if (writer->format == WindowInvestigator_StructuredFormat_CSV)
+		for (; writer->column < (size_t)WindowInvestigator_StructuredColumn_COUNT - 1; ++writer->column) *position++ = ',';
+	else
+		*position++ = '}';
+	*position++ = '\n';
+	writer->bufferSize = (size_t)(position - writer->buffer);
+	++writer->linesWritten;
+	if (writer->bufferSize > WindowInvestigator_StructuredWriter_BUFFER_SIZE - WindowInvestigator_StructuredWriter_MAX_LINE_SIZE)
+		WindowInvestigator_StructuredWriter_Flush(writer);
+}
+
+void WindowInvestigator_StructuredWriter_Init(WindowInvestigator_StructuredWriter* writer, WindowInvestigator_StructuredFormat format, FILE* file) {
+	writer->format = format;
+	writer->file = file;
+	writer->buffer = WindowInvestigator_Reallocate(NULL, WindowInvestigator_StructuredWriter_BUFFER_SIZE, 1);
+	writer->bufferSize = 0;
+	writer->column = 0;
+	writer->linesWritten = 0;
+	writer->bytesWritten = 0;
+	writer->failed = false;
+
+	if (format != WindowInvestigator_StructuredFormat_CSV) return;
+	char* position = writer->buffer;
+	for (int column = 0; column < WindowInvestigator_StructuredColumn_COUNT; ++column) {
+		if (column != 0) *position++ = ',';
+		position = WindowInvestigator_StructuredWriter_WriteText(position, WindowInvestigator_StructuredColumn_names[column]);
+	}
+	*position++ = '\n';
+	writer->bufferSize = (size_t)(position - writer->buffer);
+}
+
+void WindowInvestigator_StructuredWriter_Destroy(WindowInvestigator_StructuredWriter* writer) {
+	WindowInvestigator_Free(writer->buffer);
+}
+
+void WindowInvestigator_StructuredWriter_WriteWindow(WindowInvestigator_StructuredWriter* writer, const char* event, uint64_t timestamp, uint64_t window, uint32_t zOrder, uint32_t fields, const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowStrings* windowStrings) {
+	char* position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+	position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_WINDOW, window, 1);
+	position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_ZORDER, zOrder);
+	position = WindowInvestigator_StructuredWriter_WriteWindowFields(writer, position, fields, windowInfo, windowStrings);
+	WindowInvestigator_StructuredWriter_EndLine(writer, position);
+}
+
+bool WindowInvestigator_StructuredWriter_WriteEvent(WindowInvestigator_StructuredWriter* writer, uint64_t timestamp, uint64_t window, WindowInvestigator_MonitorEventType type, uint32_t zOrder, uint32_t previousZOrder, const unsigned char* record, size_t recordSize) {
+	const char* const event = WindowInvestigator_MonitorEventType_GetName(type);
+	char* position;
+	switch (type) {
+	case WindowInvestigator_MonitorEvent_NEW_WINDOW:
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED:
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT: {
+		uint32_t fields;
+		WindowInvestigator_WindowInfo windowInfo;
+		WindowInvestigator_WindowStrings windowStrings;
+		if (WindowInvestigator_DecodeWindowRecord(record, recordSize, &fields, &windowInfo, &windowStrings) != recordSize) return false;
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_WINDOW, window, 1);
+		if (type != WindowInvestigator_MonitorEvent_WINDOW_CHANGED)
+			position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_ZORDER, zOrder);
+		position = WindowInvestigator_StructuredWriter_WriteWindowFields(writer, position, fields, &windowInfo, &windowStrings);
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED:
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_WINDOW, window, 1);
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_ZORDER, zOrder);
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_PREVIOUS_ZORDER, previousZOrder);
+		break;
+	case WindowInvestigator_MonitorEvent_WINDOW_GONE:
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_WINDOW, window, 1);
+		break;
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+	case WindowInvestigator_MonitorEvent_KEYFRAME:
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_WINDOW_COUNT, zOrder);
+		break;
+	case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE: {
+		uint64_t wParam, lParam;
+		if (previousZOrder >= WindowInvestigator_ReceivedMessage_COUNT || !WindowInvestigator_DecodeReceivedMessage(record, recordSize, &wParam, &lParam)) return false;
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteNameColumn(writer, position, WindowInvestigator_StructuredColumn_MESSAGE_KIND, WindowInvestigator_ReceivedMessageKind_GetName((WindowInvestigator_ReceivedMessageKind)previousZOrder));
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_MESSAGE, zOrder, 4);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_WPARAM, wParam, 1);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_LPARAM, lParam, 1);
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED: {
+		uint64_t previousWindow;
+		WindowInvestigator_Rect monitorRect;
+		if (!WindowInvestigator_DecodeRudeWindowChanged(record, recordSize, &previousWindow, &monitorRect)) return false;
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_WINDOW, window, 1);
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_MONITOR, zOrder);
+		position = WindowInvestigator_StructuredWriter_WriteRectColumns(writer, position, WindowInvestigator_StructuredColumn_MONITOR_RECT_LEFT, &monitorRect);
+		position = WindowInvestigator_StructuredWriter_WriteHexColumn(writer, position, WindowInvestigator_StructuredColumn_PREVIOUS_WINDOW, previousWindow, 1);
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_EVENTS_DROPPED: {
+		uint64_t droppedCount;
+		if (!WindowInvestigator_DecodeEventsDropped(record, recordSize, &droppedCount)) return false;
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		position = WindowInvestigator_StructuredWriter_WriteUInt64Column(writer, position, WindowInvestigator_StructuredColumn_DROPPED_COUNT, droppedCount);
+		break;
+	}
+	case WindowInvestigator_MonitorEvent_TICK_FINISHED:
+		position = WindowInvestigator_StructuredWriter_BeginLine(writer, timestamp, event);
+		break;
+	default:
+		return false;
+	}
+	WindowInvestigator_StructuredWriter_EndLine(writer, position);
+	return true;
+}
+
+bool WindowInvestigator_StructuredWriter_Flush(WindowInvestigator_StructuredWriter* writer) {
+	if (writer->file != NULL && !writer->failed && writer->bufferSize != 0) {
+		if (fwrite(writer->buffer, 1, writer->bufferSize, writer->file) != writer->bufferSize) writer->failed = true;
+		else writer->bytesWritten += writer->bufferSize;
+	}
+	writer->bufferSize = 0;
+	return !writer->failed;
+}
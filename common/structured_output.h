@@ -0,0 +1,85 @@
+#pragma once
+
+#include "event_queue.h"
+#include "window_info.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Machine-readable text output of window snapshots and monitor events, one line per event, meant to be consumed by scripts
+// instead of scraping the human-oriented dumps.
+//
+// Two formats are supported:
+//  - JSON Lines: one JSON object per line. Only the columns that apply to the event are present.
+//  - CSV (RFC 4180): a header line, then one line per event with every column; the columns that do not apply to the event
+//    are empty.
+//
+// Both formats use the same columns:
+//  - timestamp: in nanoseconds, using the clock of the event (see WindowInvestigator_MonitorEvent::timestamp).
+//  - event: WindowInvestigator_MonitorEventType_GetName(), or another name for lines that do not come from an event (e.g.
+//    WindowDump).
+//  - window, zOrder, previousZOrder, windowCount: as in WindowInvestigator_MonitorEvent.
+//  - fields: the fields present on the line, as a bitmask of WindowInvestigator_WindowField_BIT(). For WindowChanged, these
+//    are the fields that changed.
+//  - One column per WindowInvestigator_WindowInfo field, rects and points being split into one column per coordinate, e.g.
+//    windowRectLeft, placementMinPositionX.
+//  - messageKind, message, wParam, lParam: for ReceivedMessage.
+//  - monitor, monitorRectLeft..monitorRectBottom, previousWindow: for RudeWindowChanged.
+//  - droppedCount: for EventsDropped.
+//
+// Integers are written in decimal, except handles, styles, bitmasks and message parameters, which are written in hexadecimal
+// with a 0x prefix (as strings, in JSON). Booleans are true or false. Strings are converted from UTF-16 (or UTF-32, depending
+// on wchar_t) to UTF-8, with unpaired surrogates replaced by U+FFFD, and are always quoted.
+//
+// Lines are formatted straight into a reusable buffer, without going through stdio or allocating anything, so that the output
+// is cheap to produce even for large desktops, and does not depend on the locale.
+
+// Upper bound on the size of a line, including the CSV header line. Strings are at most 1023 characters, each of which takes
+// at most 6 bytes once escaped.
+#define WindowInvestigator_StructuredWriter_MAX_LINE_SIZE 16384
+#define WindowInvestigator_StructuredWriter_BUFFER_SIZE (4 * WindowInvestigator_StructuredWriter_MAX_LINE_SIZE)
+
+typedef enum {
+	WindowInvestigator_StructuredFormat_JSON_LINES,
+	WindowInvestigator_StructuredFormat_CSV,
+	WindowInvestigator_StructuredFormat_COUNT,
+} WindowInvestigator_StructuredFormat;
+
+// "jsonl" or "csv".
+const char* WindowInvestigator_StructuredFormat_GetName(WindowInvestigator_StructuredFormat format);
+// Returns false if name is not one of the above.
+bool WindowInvestigator_StructuredFormat_Parse(const char* name, WindowInvestigator_StructuredFormat* format);
+
+typedef struct {
+	WindowInvestigator_StructuredFormat format;
+	// NULL if lines are only kept in the buffer (see WindowInvestigator_StructuredWriter_Init()).
+	FILE* file;
+	char* buffer;
+	size_t bufferSize;
+	// Within the line being written: CSV separators written so far, or JSON members written so far.
+	size_t column;
+	uint64_t linesWritten;
+	uint64_t bytesWritten;
+	// Set on the first I/O error. Nothing is written after that.
+	bool failed;
+} WindowInvestigator_StructuredWriter;
+
+// file stays owned by the caller. Lines are accumulated in a buffer, which is written out when it gets full and on
+// WindowInvestigator_StructuredWriter_Flush(). If file is NULL, lines are discarded instead of being written out, so that
+// the caller can read them from the buffer in the meantime (e.g. for testing or benchmarking).
+//
+// The CSV header line is written immediately (but buffered).
+void WindowInvestigator_StructuredWriter_Init(WindowInvestigator_StructuredWriter* writer, WindowInvestigator_StructuredFormat format, FILE* file);
+// Does not flush.
+void WindowInvestigator_StructuredWriter_Destroy(WindowInvestigator_StructuredWriter* writer);
+
+// Writes a line for a window that does not come from an event, e.g. a dump of the windows on startup. fields is a bitmask of
+// WindowInvestigator_WindowField_BIT(); the strings are taken from windowStrings, not from the string IDs in windowInfo.
+void WindowInvestigator_StructuredWriter_WriteWindow(WindowInvestigator_StructuredWriter* writer, const char* event, uint64_t timestamp, uint64_t window, uint32_t zOrder, uint32_t fields, const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowStrings* windowStrings);
+// Writes a line for an event, with the record as described in WindowInvestigator_MonitorEvent (or in a capture file). Returns
+// false, without writing anything, if the record is malformed.
+bool WindowInvestigator_StructuredWriter_WriteEvent(WindowInvestigator_StructuredWriter* writer, uint64_t timestamp, uint64_t window, WindowInvestigator_MonitorEventType type, uint32_t zOrder, uint32_t previousZOrder, const unsigned char* record, size_t recordSize);
+// Returns false if an I/O error occurred, now or previously.
+bool WindowInvestigator_StructuredWriter_Flush(WindowInvestigator_StructuredWriter* writer);
@@ -0,0 +1,24 @@
+#include "text_file.h"
+
+#include "allocation.h"
+
+char* WindowInvestigator_ReadTextFile(FILE* file) {
+	size_t capacity = 4096;
+	char* text = WindowInvestigator_Reallocate(NULL, capacity, sizeof(*text));
+	size_t size = 0;
+	for (;;) {
+		// Leaves room for the terminator.
+		const size_t requestedSize = capacity - 1 - size;
+		const size_t readSize = fread(text + size, 1, requestedSize, file);
+		size += readSize;
+		if (readSize < requestedSize) break;
+		capacity *= 2;
+		text = WindowInvestigator_Reallocate(text, capacity, sizeof(*text));
+	}
+	if (ferror(file) != 0) {
+		WindowInvestigator_Free(text);
+		return NULL;
+	}
+	text[size] = '\0';
+	return text;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdio.h>
+
+// Reads the rest of file, which must be open for reading in binary mode and stays owned by the caller, into a
+// null-terminated buffer, for the text parsers (e.g. delay_profile.h, message_script.h) which work on whole texts. The buffer
+// must be freed with WindowInvestigator_Free(). Returns NULL on read error.
+char* WindowInvestigator_ReadTextFile(FILE* file);
@@ -0,0 +1,101 @@
+#include "thread.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+static DWORD WINAPI WindowInvestigator_Thread_Run(LPVOID parameter) {
+	WindowInvestigator_Thread* const thread = parameter;
+	thread->function(thread->context);
+	return 0;
+}
+#else
+static void* WindowInvestigator_Thread_Run(void* parameter) {
+	WindowInvestigator_Thread* const thread = parameter;
+	thread->function(thread->context);
+	return NULL;
+}
+#endif
+
+void WindowInvestigator_Thread_Start(WindowInvestigator_Thread* thread, void (*function)(void* context), void* context) {
+	thread->function = function;
+	thread->context = context;
+#ifdef _WIN32
+	thread->handle = CreateThread(NULL, 0, WindowInvestigator_Thread_Run, thread, 0, NULL);
+	if (thread->handle == NULL) abort();
+#else
+	if (pthread_create(&thread->handle, NULL, WindowInvestigator_Thread_Run, thread) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_Thread_Join(WindowInvestigator_Thread* thread) {
+#ifdef _WIN32
+	if (WaitForSingleObject(thread->handle, INFINITE) != WAIT_OBJECT_0) abort();
+	CloseHandle(thread->handle);
+#else
+	if (pthread_join(thread->handle, NULL) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_Mutex_Init(WindowInvestigator_Mutex* mutex) {
+#ifdef _WIN32
+	InitializeSRWLock(&mutex->lock);
+#else
+	if (pthread_mutex_init(&mutex->mutex, NULL) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_Mutex_Destroy(WindowInvestigator_Mutex* mutex) {
+#ifdef _WIN32
+	(void)mutex;
+#else
+	pthread_mutex_destroy(&mutex->mutex);
+#endif
+}
+
+void WindowInvestigator_Mutex_Lock(WindowInvestigator_Mutex* mutex) {
+#ifdef _WIN32
+	AcquireSRWLockExclusive(&mutex->lock);
+#else
+	if (pthread_mutex_lock(&mutex->mutex) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_Mutex_Unlock(WindowInvestigator_Mutex* mutex) {
+#ifdef _WIN32
+	ReleaseSRWLockExclusive(&mutex->lock);
+#else
+	if (pthread_mutex_unlock(&mutex->mutex) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_ConditionVariable_Init(WindowInvestigator_ConditionVariable* conditionVariable) {
+#ifdef _WIN32
+	InitializeConditionVariable(&conditionVariable->conditionVariable);
+#else
+	if (pthread_cond_init(&conditionVariable->conditionVariable, NULL) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_ConditionVariable_Destroy(WindowInvestigator_ConditionVariable* conditionVariable) {
+#ifdef _WIN32
+	(void)conditionVariable;
+#else
+	pthread_cond_destroy(&conditionVariable->conditionVariable);
+#endif
+}
+
+void WindowInvestigator_ConditionVariable_Wait(WindowInvestigator_ConditionVariable* conditionVariable, WindowInvestigator_Mutex* mutex) {
+#ifdef _WIN32
+	if (!SleepConditionVariableSRW(&conditionVariable->conditionVariable, &mutex->lock, INFINITE, 0)) abort();
+#else
+	if (pthread_cond_wait(&conditionVariable->conditionVariable, &mutex->mutex) != 0) abort();
+#endif
+}
+
+void WindowInvestigator_ConditionVariable_WakeAll(WindowInvestigator_ConditionVariable* conditionVariable) {
+#ifdef _WIN32
+	WakeAllConditionVariable(&conditionVariable->conditionVariable);
+#else
+	if (pthread_cond_broadcast(&conditionVariable->conditionVariable) != 0) abort();
+#endif
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Minimal portable threading primitives: Win32 threads, SRW locks and condition variables on Windows, pthreads elsewhere.
+//
+// Failures are not recoverable, so these abort instead of returning errors.
+
+typedef struct {
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	void (*function)(void* context);
+	void* context;
+} WindowInvestigator_Thread;
+
+// thread must stay at the same address until WindowInvestigator_Thread_Join() returns.
+void WindowInvestigator_Thread_Start(WindowInvestigator_Thread* thread, void (*function)(void* context), void* context);
+void WindowInvestigator_Thread_Join(WindowInvestigator_Thread* thread);
+
+typedef struct {
+#ifdef _WIN32
+	SRWLOCK lock;
+#else
+	pthread_mutex_t mutex;
+#endif
+} WindowInvestigator_Mutex;
+
+void WindowInvestigator_Mutex_Init(WindowInvestigator_Mutex* mutex);
+void WindowInvestigator_Mutex_Destroy(WindowInvestigator_Mutex* mutex);
+void WindowInvestigator_Mutex_Lock(WindowInvestigator_Mutex* mutex);
+void WindowInvestigator_Mutex_Unlock(WindowInvestigator_Mutex* mutex);
+
+typedef struct {
+#ifdef _WIN32
+	CONDITION_VARIABLE conditionVariable;
+#else
+	pthread_cond_t conditionVariable;
+#endif
+} WindowInvestigator_ConditionVariable;
+
+void WindowInvestigator_ConditionVariable_Init(WindowInvestigator_ConditionVariable* conditionVariable);
+void WindowInvestigator_ConditionVariable_Destroy(WindowInvestigator_ConditionVariable* conditionVariable);
+// mutex must be locked. Can wake up spuriously.
+void WindowInvestigator_ConditionVariable_Wait(WindowInvestigator_ConditionVariable* conditionVariable, WindowInvestigator_Mutex* mutex);
+void WindowInvestigator_ConditionVariable_WakeAll(WindowInvestigator_ConditionVariable* conditionVariable);
@@ -0,0 +1,52 @@
+#include "tick_cadence.h"
+
+#include <string.h>
+
+void WindowInvestigator_TickCadence_GetDefaultOptions(WindowInvestigator_TickCadenceOptions* options) {
+	options->fastPeriodNanoseconds = UINT64_C(10000000);
+	options->slowPeriodNanoseconds = UINT64_C(250000000);
+	options->quietPassThreshold = 0;
+}
+
+void WindowInvestigator_TickCadence_Init(WindowInvestigator_TickCadence* cadence, const WindowInvestigator_TickCadenceOptions* options) {
+	memset(cadence, 0, sizeof(*cadence));
+	cadence->options = *options;
+	cadence->level = WindowInvestigator_TickCadenceLevel_FAST;
+	cadence->periodNanoseconds = options->fastPeriodNanoseconds;
+}
+
+// Returns true if the period changed.
+static bool WindowInvestigator_TickCadence_SetLevel(WindowInvestigator_TickCadence* cadence, WindowInvestigator_TickCadenceLevel level) {
+	if (level == cadence->level) return false;
+	cadence->level = level;
+	++cadence->switches[level];
+	const uint64_t periodNanoseconds = level == WindowInvestigator_TickCadenceLevel_FAST ? cadence->options.fastPeriodNanoseconds : cadence->options.slowPeriodNanoseconds;
+	const bool periodChanged = periodNanoseconds != cadence->periodNanoseconds;
+	cadence->periodNanoseconds = periodNanoseconds;
+	return periodChanged;
+}
+
+bool WindowInvestigator_TickCadence_OnPass(WindowInvestigator_TickCadence* cadence, bool changed) {
+	++cadence->passes[cadence->level];
+	if (changed) {
+		cadence->quietPasses = 0;
+		return WindowInvestigator_TickCadence_SetLevel(cadence, WindowInvestigator_TickCadenceLevel_FAST);
+	}
+	++cadence->quietPasses;
+	if (cadence->options.quietPassThreshold == 0 || cadence->quietPasses < cadence->options.quietPassThreshold) return false;
+	return WindowInvestigator_TickCadence_SetLevel(cadence, WindowInvestigator_TickCadenceLevel_SLOW);
+}
+
+bool WindowInvestigator_TickCadence_OnActivity(WindowInvestigator_TickCadence* cadence) {
+	cadence->quietPasses = 0;
+	return WindowInvestigator_TickCadence_SetLevel(cadence, WindowInvestigator_TickCadenceLevel_FAST);
+}
+
+const char* WindowInvestigator_TickCadenceLevel_GetName(WindowInvestigator_TickCadenceLevel level) {
+	switch (level) {
+	case WindowInvestigator_TickCadenceLevel_FAST: return "Fast";
+	case WindowInvestigator_TickCadenceLevel_SLOW: return "Slow";
+	case WindowInvestigator_TickCadenceLevel_COUNT: break;
+	}
+	return "Unknown";
+}
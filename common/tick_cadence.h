@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decides how often WindowMonitor's timer triggers a pass, so that it does not keep enumerating and diffing every window at
+// the fastest rate while the desktop is idle (e.g. overnight).
+//
+// The cadence starts fast. After a number of passes in a row during which nothing changed, it drops to a slower period; it
+// goes back to the fast period as soon as a pass reports a change, or a message shows activity (e.g. a shell hook or appbar
+// message). Passes that are triggered by messages still happen immediately regardless of the cadence, so the cadence only
+// affects how quickly changes that come without any message are noticed.
+//
+// The controller does not keep time: the caller rearms its timer whenever the period changes, which makes it possible to run
+// the controller in simulated time (see CaptureTool cadence).
+
+typedef struct {
+	uint64_t fastPeriodNanoseconds;
+	uint64_t slowPeriodNanoseconds;
+	// Number of passes in a row without any change after which the period drops to slowPeriodNanoseconds. 0 means never, i.e.
+	// the period is always fastPeriodNanoseconds.
+	uint64_t quietPassThreshold;
+} WindowInvestigator_TickCadenceOptions;
+
+typedef enum {
+	WindowInvestigator_TickCadenceLevel_FAST,
+	WindowInvestigator_TickCadenceLevel_SLOW,
+	WindowInvestigator_TickCadenceLevel_COUNT,
+} WindowInvestigator_TickCadenceLevel;
+
+typedef struct {
+	WindowInvestigator_TickCadenceOptions options;
+	WindowInvestigator_TickCadenceLevel level;
+	uint64_t periodNanoseconds;
+	// Passes in a row during which nothing changed.
+	uint64_t quietPasses;
+
+	// Statistics since WindowInvestigator_TickCadence_Init().
+	// Passes that started at each level.
+	uint64_t passes[WindowInvestigator_TickCadenceLevel_COUNT];
+	// Number of times the cadence switched to each level.
+	uint64_t switches[WindowInvestigator_TickCadenceLevel_COUNT];
+} WindowInvestigator_TickCadence;
+
+// 10 ms (USER_TIMER_MINIMUM), slowing down to 250 ms; quietPassThreshold is 0, i.e. the cadence never slows down.
+void WindowInvestigator_TickCadence_GetDefaultOptions(WindowInvestigator_TickCadenceOptions* options);
+
+// The cadence starts fast.
+void WindowInvestigator_TickCadence_Init(WindowInvestigator_TickCadence* cadence, const WindowInvestigator_TickCadenceOptions* options);
+
+// To be called at the end of every pass, whether it was triggered by the timer or by a message. changed is whether the pass
+// reported any change. Returns true if the period changed, in which case the timer must be rearmed with
+// WindowInvestigator_TickCadence::periodNanoseconds.
+bool WindowInvestigator_TickCadence_OnPass(WindowInvestigator_TickCadence* cadence, bool changed);
+// To be called when something other than a pass shows activity, e.g. a shell hook or appbar message. Returns true if the
+// period changed, as above.
+bool WindowInvestigator_TickCadence_OnActivity(WindowInvestigator_TickCadence* cadence);
+
+const char* WindowInvestigator_TickCadenceLevel_GetName(WindowInvestigator_TickCadenceLevel level);
@@ -0,0 +1,459 @@
+#include "timeline.h"
+
+#include "allocation.h"
+#include "event_queue.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define WindowInvestigator_Timeline_MARGIN 4
+#define WindowInvestigator_Timeline_HEADER_HEIGHT 48
+#define WindowInvestigator_Timeline_LABEL_HEIGHT 11
+#define WindowInvestigator_Timeline_TRACK_HEIGHT 5
+#define WindowInvestigator_Timeline_LANE_GAP 4
+#define WindowInvestigator_Timeline_LANE_HEIGHT (WindowInvestigator_Timeline_LABEL_HEIGHT + WindowInvestigator_TimelineTrack_COUNT * WindowInvestigator_Timeline_TRACK_HEIGHT + WindowInvestigator_Timeline_LANE_GAP)
+// Changes that are closer than this, in pixels, are aggregated.
+#define WindowInvestigator_Timeline_MIN_SEGMENT_WIDTH 3
+// Minimum distance between two time axis ticks, in pixels.
+#define WindowInvestigator_Timeline_TICK_SPACING 100
+// Maximum number of characters of window text shown in lane labels.
+#define WindowInvestigator_Timeline_MAX_LABEL_TEXT_LENGTH 48
+
+static void WindowInvestigator_Timeline_Printf(WindowInvestigator_Timeline* timeline, const char* format, ...) {
+	va_list arguments;
+	va_start(arguments, format);
+	if (vfprintf(timeline->output, format, arguments) < 0) timeline->failed = true;
+	va_end(arguments);
+}
+
+static void WindowInvestigator_Timeline_WriteCodePoint(WindowInvestigator_Timeline* timeline, uint32_t codePoint) {
+	switch (codePoint) {
+	case '<': WindowInvestigator_Timeline_Printf(timeline, "&lt;"); return;
+	case '>': WindowInvestigator_Timeline_Printf(timeline, "&gt;"); return;
+	case '&': WindowInvestigator_Timeline_Printf(timeline, "&amp;"); return;
+	case '"': WindowInvestigator_Timeline_Printf(timeline, "&quot;"); return;
+	}
+	// Control characters are not allowed in XML 1.0, except for whitespace.
+	if ((codePoint < 0x20 && codePoint != '\n' && codePoint != '\t') || (codePoint >= 0xD800 && codePoint < 0xE000) || codePoint > 0x10FFFF) codePoint = 0xFFFD;
+	char utf8[4];
+	size_t length;
+	if (codePoint < 0x80) {
+		utf8[0] = (char)codePoint;
+		length = 1;
+	}
+	else if (codePoint < 0x800) {
+		utf8[0] = (char)(0xC0 | (codePoint >> 6));
+		utf8[1] = (char)(0x80 | (codePoint & 0x3F));
+		length = 2;
+	}
+	else if (codePoint < 0x10000) {
+		utf8[0] = (char)(0xE0 | (codePoint >> 12));
+		utf8[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		utf8[2] = (char)(0x80 | (codePoint & 0x3F));
+		length = 3;
+	}
+	else {
+		utf8[0] = (char)(0xF0 | (codePoint >> 18));
+		utf8[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+		utf8[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		utf8[3] = (char)(0x80 | (codePoint & 0x3F));
+		length = 4;
+	}
+	if (fwrite(utf8, 1, length, timeline->output) != length) timeline->failed = true;
+}
+
+static void WindowInvestigator_Timeline_WriteEscapedString(WindowInvestigator_Timeline* timeline, const char* string) {
+	for (; *string != '\0'; ++string) WindowInvestigator_Timeline_WriteCodePoint(timeline, (unsigned char)*string);
+}
+
+// wchar_t is UTF-16 on Windows, and UTF-32 on most other platforms.
+static void WindowInvestigator_Timeline_WriteEscapedWideString(WindowInvestigator_Timeline* timeline, const wchar_t* string, size_t maxLength) {
+	for (size_t length = 0; *string != L'\0'; ++string, ++length) {
+		if (length == maxLength) {
+			WindowInvestigator_Timeline_WriteCodePoint(timeline, 0x2026);
+			return;
+		}
+		uint32_t codePoint = (uint32_t)*string;
+		if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint < 0xDC00 && string[1] >= 0xDC00 && string[1] < 0xE000) {
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + ((uint32_t)string[1] - 0xDC00);
+			++string;
+		}
+		WindowInvestigator_Timeline_WriteCodePoint(timeline, codePoint);
+	}
+}
+
+static size_t WindowInvestigator_Timeline_GetPixel(const WindowInvestigator_Timeline* timeline, uint64_t timestamp) {
+	const WindowInvestigator_TimelineOptions* const options = &timeline->options;
+	if (timestamp <= options->startTimestamp) return 0;
+	if (timestamp >= options->endTimestamp) return options->width;
+	return (size_t)((double)(timestamp - options->startTimestamp) * (double)options->width / (double)(options->endTimestamp - options->startTimestamp));
+}
+
+static size_t WindowInvestigator_Timeline_GetTrackY(size_t lane, WindowInvestigator_TimelineTrack track) {
+	return WindowInvestigator_Timeline_HEADER_HEIGHT + lane * WindowInvestigator_Timeline_LANE_HEIGHT + WindowInvestigator_Timeline_LABEL_HEIGHT + (size_t)track * WindowInvestigator_Timeline_TRACK_HEIGHT;
+}
+
+static bool WindowInvestigator_Timeline_RectEquals(const WindowInvestigator_Rect* left, const WindowInvestigator_Rect* right) {
+	return left->left == right->left && left->top == right->top && left->right == right->right && left->bottom == right->bottom;
+}
+
+static bool WindowInvestigator_Timeline_TrackEquals(WindowInvestigator_TimelineTrack track, const WindowInvestigator_TimelineLane* lane, const WindowInvestigator_WindowInfo* windowInfo, size_t zOrder) {
+	const WindowInvestigator_WindowInfo* const laneWindowInfo = &lane->windowInfo;
+	switch (track) {
+	case WindowInvestigator_TimelineTrack_Z_ORDER: return lane->zOrder == zOrder;
+	case WindowInvestigator_TimelineTrack_VISIBILITY: return laneWindowInfo->isVisible == windowInfo->isVisible && laneWindowInfo->isIconic == windowInfo->isIconic;
+	case WindowInvestigator_TimelineTrack_CLOAK: return laneWindowInfo->dwmIsCloaked == windowInfo->dwmIsCloaked;
+	case WindowInvestigator_TimelineTrack_BAND: return laneWindowInfo->band == windowInfo->band;
+	case WindowInvestigator_TimelineTrack_STYLES: return laneWindowInfo->styles == windowInfo->styles && laneWindowInfo->extendedStyles == windowInfo->extendedStyles;
+	case WindowInvestigator_TimelineTrack_RECT: return WindowInvestigator_Timeline_RectEquals(&laneWindowInfo->windowRect, &windowInfo->windowRect);
+	case WindowInvestigator_TimelineTrack_COUNT: break;
+	}
+	return true;
+}
+
+static void WindowInvestigator_Timeline_DescribeTrack(WindowInvestigator_TimelineTrack track, const WindowInvestigator_TimelineLane* lane, char* buffer, size_t bufferSize) {
+	const WindowInvestigator_WindowInfo* const windowInfo = &lane->windowInfo;
+	const WindowInvestigator_Rect* const rect = &windowInfo->windowRect;
+	switch (track) {
+	case WindowInvestigator_TimelineTrack_Z_ORDER:
+		snprintf(buffer, bufferSize, "Z-order %zu", lane->zOrder);
+		return;
+	case WindowInvestigator_TimelineTrack_VISIBILITY:
+		snprintf(buffer, bufferSize, "%s%s", windowInfo->isVisible ? "Visible" : "Not visible", windowInfo->isIconic ? ", minimized" : "");
+		return;
+	case WindowInvestigator_TimelineTrack_CLOAK:
+		snprintf(buffer, bufferSize, "Cloaked 0x%" PRIx32, windowInfo->dwmIsCloaked);
+		return;
+	case WindowInvestigator_TimelineTrack_BAND:
+		snprintf(buffer, bufferSize, "Band %" PRIu32, windowInfo->band);
+		return;
+	case WindowInvestigator_TimelineTrack_STYLES:
+		snprintf(buffer, bufferSize, "Styles 0x%08" PRIx32 ", extended styles 0x%08" PRIx32, windowInfo->styles, windowInfo->extendedStyles);
+		return;
+	case WindowInvestigator_TimelineTrack_RECT:
+		snprintf(buffer, bufferSize, "Window rect (%" PRId32 ", %" PRId32 ")-(%" PRId32 ", %" PRId32 ")", rect->left, rect->top, rect->right, rect->bottom);
+		return;
+	case WindowInvestigator_TimelineTrack_COUNT:
+		break;
+	}
+	buffer[0] = '\0';
+}
+
+// Arbitrary but stable color for a value, so that segments with the same value look the same.
+static unsigned int WindowInvestigator_Timeline_GetHue(uint64_t value) {
+	value ^= value >> 33;
+	value *= UINT64_C(0xFF51AFD7ED558CCD);
+	value ^= value >> 33;
+	return (unsigned int)(value % 360);
+}
+
+static void WindowInvestigator_Timeline_WriteTrackColor(WindowInvestigator_Timeline* timeline, WindowInvestigator_TimelineTrack track, const WindowInvestigator_TimelineLane* lane) {
+	const WindowInvestigator_WindowInfo* const windowInfo = &lane->windowInfo;
+	const WindowInvestigator_Rect* const rect = &windowInfo->windowRect;
+	switch (track) {
+	case WindowInvestigator_TimelineTrack_Z_ORDER: {
+		// Darker is closer to the top.
+		const size_t lightness = 25 + (lane->zOrder < 30 ? lane->zOrder * 2 : 60);
+		WindowInvestigator_Timeline_Printf(timeline, "hsl(210,50%%,%zu%%)", lightness);
+		return;
+	}
+	case WindowInvestigator_TimelineTrack_VISIBILITY:
+		WindowInvestigator_Timeline_Printf(timeline, !windowInfo->isVisible ? "#bdbdbd" : windowInfo->isIconic ? "#ffb300" : "#43a047");
+		return;
+	case WindowInvestigator_TimelineTrack_CLOAK:
+		if (windowInfo->dwmIsCloaked == 0) WindowInvestigator_Timeline_Printf(timeline, "#e0e0e0");
+		else WindowInvestigator_Timeline_Printf(timeline, "hsl(%u,60%%,45%%)", WindowInvestigator_Timeline_GetHue(windowInfo->dwmIsCloaked));
+		return;
+	case WindowInvestigator_TimelineTrack_BAND:
+		// Band 1 (ZBID_DESKTOP) is what most windows are in.
+		if (windowInfo->band == 1) WindowInvestigator_Timeline_Printf(timeline, "#e0e0e0");
+		else WindowInvestigator_Timeline_Printf(timeline, "hsl(%u,60%%,45%%)", WindowInvestigator_Timeline_GetHue(windowInfo->band));
+		return;
+	case WindowInvestigator_TimelineTrack_STYLES:
+		WindowInvestigator_Timeline_Printf(timeline, "hsl(%u,55%%,60%%)", WindowInvestigator_Timeline_GetHue(windowInfo->styles | ((uint64_t)windowInfo->extendedStyles << 32)));
+		return;
+	case WindowInvestigator_TimelineTrack_RECT:
+		WindowInvestigator_Timeline_Printf(timeline, "hsl(%u,55%%,60%%)", WindowInvestigator_Timeline_GetHue(
+			((uint64_t)(uint32_t)rect->left << 48) ^ ((uint64_t)(uint32_t)rect->top << 32) ^ ((uint64_t)(uint32_t)rect->right << 16) ^ (uint32_t)rect->bottom));
+		return;
+	case WindowInvestigator_TimelineTrack_COUNT:
+		break;
+	}
+}
+
+static void WindowInvestigator_Timeline_WriteSegment(WindowInvestigator_Timeline* timeline, const WindowInvestigator_TimelineLane* lane, WindowInvestigator_TimelineTrack track, size_t start, size_t end) {
+	if (start >= end) return;
+	char description[128];
+	WindowInvestigator_Timeline_DescribeTrack(track, lane, description, sizeof(description));
+	WindowInvestigator_Timeline_Printf(timeline, "<rect x=\"%zu\" y=\"%zu\" width=\"%zu\" height=\"%d\" fill=\"",
+		WindowInvestigator_Timeline_MARGIN + start, WindowInvestigator_Timeline_GetTrackY(lane->lane, track), end - start, WindowInvestigator_Timeline_TRACK_HEIGHT);
+	WindowInvestigator_Timeline_WriteTrackColor(timeline, track, lane);
+	WindowInvestigator_Timeline_Printf(timeline, "\"><title>%s</title></rect>\n", description);
+	++timeline->segmentCount;
+}
+
+// Writes out the current segment of the track (including its busy region, if any), which ends at the specified pixel column.
+static void WindowInvestigator_Timeline_EndSegment(WindowInvestigator_Timeline* timeline, const WindowInvestigator_TimelineLane* lane, WindowInvestigator_TimelineTrack track, size_t end) {
+	size_t start = lane->segmentStart[track];
+	if (lane->changeCount[track] != 0) {
+		size_t busyEnd = lane->lastChangePixel[track] + 1;
+		// Can happen if the window is gone right after the last change.
+		if (busyEnd > end && end > start) busyEnd = end;
+		WindowInvestigator_Timeline_Printf(timeline, "<rect x=\"%zu\" y=\"%zu\" width=\"%zu\" height=\"%d\" class=\"b\"><title>%" PRIu32 " change%s</title></rect>\n",
+			WindowInvestigator_Timeline_MARGIN + start, WindowInvestigator_Timeline_GetTrackY(lane->lane, track), busyEnd - start, WindowInvestigator_Timeline_TRACK_HEIGHT,
+			lane->changeCount[track], lane->changeCount[track] == 1 ? "" : "s");
+		timeline->aggregatedChangeCount += lane->changeCount[track];
+		start = busyEnd;
+	}
+	WindowInvestigator_Timeline_WriteSegment(timeline, lane, track, start, end);
+}
+
+static void WindowInvestigator_Timeline_UpdateLane(WindowInvestigator_Timeline* timeline, WindowInvestigator_TimelineLane* lane, const WindowInvestigator_WindowInfo* windowInfo, size_t zOrder, size_t pixel) {
+	for (int track = 0; track < WindowInvestigator_TimelineTrack_COUNT; ++track) {
+		if (WindowInvestigator_Timeline_TrackEquals(track, lane, windowInfo, zOrder)) continue;
+		const size_t previousChangePixel = lane->changeCount[track] != 0 ? lane->lastChangePixel[track] : lane->segmentStart[track];
+		if (pixel >= previousChangePixel + WindowInvestigator_Timeline_MIN_SEGMENT_WIDTH) {
+			WindowInvestigator_Timeline_EndSegment(timeline, lane, track, pixel);
+			lane->segmentStart[track] = pixel;
+			lane->changeCount[track] = 0;
+		}
+		else {
+			++lane->changeCount[track];
+			lane->lastChangePixel[track] = pixel;
+		}
+	}
+	lane->windowInfo = *windowInfo;
+	lane->zOrder = zOrder;
+}
+
+static void WindowInvestigator_Timeline_OpenLane(WindowInvestigator_Timeline* timeline, WindowInvestigator_TimelineLane* lane, const WindowInvestigator_CaptureState* state, uintptr_t window, const WindowInvestigator_WindowInfo* windowInfo, size_t zOrder, size_t pixel) {
+	lane->lane = timeline->freeLaneCount != 0 ? timeline->freeLanes[--timeline->freeLaneCount] : timeline->laneCount++;
+	lane->windowStart = pixel;
+	lane->windowInfo = *windowInfo;
+	lane->zOrder = zOrder;
+	for (int track = 0; track < WindowInvestigator_TimelineTrack_COUNT; ++track) {
+		lane->segmentStart[track] = pixel;
+		lane->changeCount[track] = 0;
+	}
+	++timeline->windowCount;
+
+	WindowInvestigator_Timeline_Printf(timeline, "<text x=\"%zu\" y=\"%zu\">0x%" PRIxPTR " ",
+		WindowInvestigator_Timeline_MARGIN + pixel, WindowInvestigator_Timeline_GetTrackY(lane->lane, 0) - 2, window);
+	WindowInvestigator_Timeline_WriteEscapedWideString(timeline, WindowInvestigator_StringPool_Get(&state->strings, windowInfo->className), SIZE_MAX);
+	WindowInvestigator_Timeline_Printf(timeline, " \"");
+	WindowInvestigator_Timeline_WriteEscapedWideString(timeline, WindowInvestigator_StringPool_Get(&state->strings, windowInfo->text), WindowInvestigator_Timeline_MAX_LABEL_TEXT_LENGTH);
+	WindowInvestigator_Timeline_Printf(timeline, "\" (PID %" PRIu32 ")</text>\n", windowInfo->processId);
+}
+
+static void WindowInvestigator_Timeline_CloseLane(void* context, uintptr_t window, void* value) {
+	(void)window;
+	WindowInvestigator_Timeline* const timeline = context;
+	WindowInvestigator_TimelineLane* const lane = value;
+	for (int track = 0; track < WindowInvestigator_TimelineTrack_COUNT; ++track)
+		WindowInvestigator_Timeline_EndSegment(timeline, lane, track, timeline->closePixel);
+
+	if (timeline->freeLaneCount == timeline->freeLaneCapacity) {
+		timeline->freeLaneCapacity = timeline->freeLaneCapacity == 0 ? 64 : timeline->freeLaneCapacity * 2;
+		timeline->freeLanes = WindowInvestigator_Reallocate(timeline->freeLanes, timeline->freeLaneCapacity, sizeof(*timeline->freeLanes));
+	}
+	timeline->freeLanes[timeline->freeLaneCount++] = lane->lane;
+}
+
+static void WindowInvestigator_Timeline_OnZOrderChanged(void* context, uintptr_t window, void* value, size_t previousZOrder, size_t zOrder) {
+	(void)context; (void)window; (void)value; (void)previousZOrder; (void)zOrder;
+}
+
+// Brings every lane up to date with the state: opens lanes for new windows, closes lanes of windows that are gone, and
+// updates the rest.
+static void WindowInvestigator_Timeline_UpdateAllLanes(WindowInvestigator_Timeline* timeline, const WindowInvestigator_CaptureState* state, size_t pixel) {
+	WindowInvestigator_WindowTable_BeginPass(&timeline->lanes);
+	const size_t windowCount = state == NULL ? 0 : WindowInvestigator_WindowTable_GetZOrderCount(&state->windows);
+	for (size_t zOrder = 0; zOrder < windowCount; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(&state->windows, zOrder);
+		const uintptr_t window = WindowInvestigator_WindowTable_GetWindow(&state->windows, slot);
+		const WindowInvestigator_WindowInfo* const windowInfo = WindowInvestigator_WindowTable_GetValue(&state->windows, slot);
+		WindowInvestigator_WindowTable_VisitResult visitResult;
+		WindowInvestigator_TimelineLane* const lane = WindowInvestigator_WindowTable_GetValue(&timeline->lanes, WindowInvestigator_WindowTable_Visit(&timeline->lanes, window, &visitResult));
+		if (visitResult == WindowInvestigator_WindowTable_NEW_WINDOW) WindowInvestigator_Timeline_OpenLane(timeline, lane, state, window, windowInfo, zOrder, pixel);
+		else if (visitResult == WindowInvestigator_WindowTable_EXISTING_WINDOW) WindowInvestigator_Timeline_UpdateLane(timeline, lane, windowInfo, zOrder, pixel);
+	}
+	WindowInvestigator_WindowTable_PassCallbacks passCallbacks;
+	passCallbacks.onWindowGone = WindowInvestigator_Timeline_CloseLane;
+	passCallbacks.onZOrderChanged = WindowInvestigator_Timeline_OnZOrderChanged;
+	passCallbacks.context = timeline;
+	timeline->closePixel = pixel;
+	WindowInvestigator_WindowTable_EndPass(&timeline->lanes, &passCallbacks);
+}
+
+static const char* WindowInvestigator_Timeline_GetShellHookCodeName(uint64_t code) {
+	switch (code) {
+	case 1: return "HSHELL_WINDOWCREATED";
+	case 2: return "HSHELL_WINDOWDESTROYED";
+	case 3: return "HSHELL_ACTIVATESHELLWINDOW";
+	case 4: return "HSHELL_WINDOWACTIVATED";
+	case 5: return "HSHELL_GETMINRECT";
+	case 6: return "HSHELL_REDRAW";
+	case 7: return "HSHELL_TASKMAN";
+	case 8: return "HSHELL_LANGUAGE";
+	case 9: return "HSHELL_SYSMENU";
+	case 10: return "HSHELL_ENDTASK";
+	case 11: return "HSHELL_ACCESSIBILITYSTATE";
+	case 12: return "HSHELL_APPCOMMAND";
+	case 13: return "HSHELL_WINDOWREPLACED";
+	case 14: return "HSHELL_WINDOWREPLACING";
+	case 16: return "HSHELL_MONITORCHANGED";
+	case 0x8004: return "HSHELL_RUDEAPPACTIVATED";
+	case 0x8006: return "HSHELL_FLASH";
+	}
+	return NULL;
+}
+
+static const char* WindowInvestigator_Timeline_GetAppBarNotificationName(uint64_t notification) {
+	switch (notification) {
+	case 0: return "ABN_STATECHANGE";
+	case 1: return "ABN_POSCHANGED";
+	case 2: return "ABN_FULLSCREENAPP";
+	case 3: return "ABN_WINDOWARRANGE";
+	}
+	return NULL;
+}
+
+static void WindowInvestigator_Timeline_WriteMarker(WindowInvestigator_Timeline* timeline, WindowInvestigator_ReceivedMessageKind kind) {
+	WindowInvestigator_TimelineMarker* const marker = &timeline->markers[kind];
+	if (marker->pixel == SIZE_MAX) return;
+	WindowInvestigator_Timeline_Printf(timeline, "<line x1=\"%zu.5\" y1=\"%d\" x2=\"%zu.5\" y2=\"100%%\" class=\"%s\"><title>",
+		WindowInvestigator_Timeline_MARGIN + marker->pixel, WindowInvestigator_Timeline_HEADER_HEIGHT - 6, WindowInvestigator_Timeline_MARGIN + marker->pixel,
+		kind == WindowInvestigator_ReceivedMessage_APPBAR ? "a" : "s");
+	if (marker->count > 1) WindowInvestigator_Timeline_Printf(timeline, "%" PRIu64 " messages:\n", marker->count);
+	WindowInvestigator_Timeline_WriteEscapedString(timeline, marker->title);
+	WindowInvestigator_Timeline_Printf(timeline, "</title></line>\n");
+	++timeline->markerCount;
+	timeline->aggregatedMessageCount += marker->count - 1;
+	marker->pixel = SIZE_MAX;
+}
+
+static void WindowInvestigator_Timeline_OnReceivedMessage(WindowInvestigator_Timeline* timeline, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload, size_t pixel) {
+	uint64_t wParam, lParam;
+	if (header->previousZOrder >= WindowInvestigator_ReceivedMessage_COUNT || !WindowInvestigator_DecodeReceivedMessage(payload, header->payloadSize, &wParam, &lParam)) return;
+	const WindowInvestigator_ReceivedMessageKind kind = (WindowInvestigator_ReceivedMessageKind)header->previousZOrder;
+	WindowInvestigator_TimelineMarker* const marker = &timeline->markers[kind];
+	if (marker->pixel != pixel) {
+		WindowInvestigator_Timeline_WriteMarker(timeline, kind);
+		marker->pixel = pixel;
+		marker->count = 0;
+		marker->titleLength = 0;
+		marker->title[0] = '\0';
+	}
+	++marker->count;
+
+	char description[128];
+	const char* const name = kind == WindowInvestigator_ReceivedMessage_APPBAR ? WindowInvestigator_Timeline_GetAppBarNotificationName(wParam) : WindowInvestigator_Timeline_GetShellHookCodeName(wParam);
+	if (name != NULL) snprintf(description, sizeof(description), "%s (lParam 0x%" PRIx64 ")\n", name, lParam);
+	else snprintf(description, sizeof(description), "%s 0x%" PRIx64 " (lParam 0x%" PRIx64 ")\n", kind == WindowInvestigator_ReceivedMessage_APPBAR ? "Appbar message" : "Shell hook message", wParam, lParam);
+	// Past a certain point, only the number of messages is shown.
+	const size_t descriptionLength = strlen(description);
+	if (marker->titleLength + descriptionLength + 4 >= sizeof(marker->title)) {
+		if (marker->titleLength + 4 < sizeof(marker->title) && (marker->titleLength < 4 || strcmp(marker->title + marker->titleLength - 4, "...\n") != 0)) {
+			memcpy(marker->title + marker->titleLength, "...\n", 5);
+			marker->titleLength += 4;
+		}
+		return;
+	}
+	memcpy(marker->title + marker->titleLength, description, descriptionLength + 1);
+	marker->titleLength += descriptionLength;
+}
+
+// Returns the number of decimals needed to print multiples of interval (in nanoseconds) as seconds.
+static int WindowInvestigator_Timeline_GetDecimals(uint64_t interval) {
+	int decimals = 0;
+	for (uint64_t unit = UINT64_C(1000000000); unit > interval && decimals < 9; unit /= 10) ++decimals;
+	return decimals;
+}
+
+static void WindowInvestigator_Timeline_WriteTimeAxis(WindowInvestigator_Timeline* timeline) {
+	const WindowInvestigator_TimelineOptions* const options = &timeline->options;
+	const uint64_t duration = options->endTimestamp - options->startTimestamp;
+	// Smallest 1/2/5 multiple of a power of ten that keeps ticks far enough apart.
+	const double minimumInterval = (double)duration * WindowInvestigator_Timeline_TICK_SPACING / (double)options->width;
+	uint64_t interval = 1;
+	for (uint64_t powerOfTen = 1; (double)interval < minimumInterval; powerOfTen *= 10) {
+		if ((double)powerOfTen >= minimumInterval) interval = powerOfTen;
+		else if ((double)(2 * powerOfTen) >= minimumInterval) interval = 2 * powerOfTen;
+		else if ((double)(5 * powerOfTen) >= minimumInterval) interval = 5 * powerOfTen;
+		else interval = 10 * powerOfTen;
+	}
+	const int decimals = WindowInvestigator_Timeline_GetDecimals(interval);
+
+	const uint64_t start = options->startTimestamp - options->captureStartTimestamp;
+	for (uint64_t tick = (start + interval - 1) / interval * interval; tick <= start + duration; tick += interval) {
+		const size_t x = WindowInvestigator_Timeline_MARGIN + WindowInvestigator_Timeline_GetPixel(timeline, options->captureStartTimestamp + tick);
+		WindowInvestigator_Timeline_Printf(timeline, "<line x1=\"%zu.5\" y1=\"%d\" x2=\"%zu.5\" y2=\"100%%\" class=\"t\"/><text x=\"%zu\" y=\"%d\">%.*f s</text>\n",
+			x, WindowInvestigator_Timeline_HEADER_HEIGHT - 6, x, x + 2, WindowInvestigator_Timeline_HEADER_HEIGHT - 8, decimals, (double)tick / 1e9);
+	}
+}
+
+void WindowInvestigator_Timeline_Init(WindowInvestigator_Timeline* timeline, FILE* output, const WindowInvestigator_TimelineOptions* options, const WindowInvestigator_CaptureState* state) {
+	memset(timeline, 0, sizeof(*timeline));
+	timeline->output = output;
+	timeline->options = *options;
+	if (timeline->options.width == 0) timeline->options.width = 1;
+	if (timeline->options.endTimestamp <= timeline->options.startTimestamp) timeline->options.endTimestamp = timeline->options.startTimestamp + 1;
+	WindowInvestigator_WindowTable_Init(&timeline->lanes, sizeof(WindowInvestigator_TimelineLane));
+	for (int kind = 0; kind < WindowInvestigator_ReceivedMessage_COUNT; ++kind) timeline->markers[kind].pixel = SIZE_MAX;
+
+	if (timeline->options.html) WindowInvestigator_Timeline_Printf(timeline, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>WindowInvestigator timeline</title></head><body>\n");
+	else WindowInvestigator_Timeline_Printf(timeline, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	WindowInvestigator_Timeline_Printf(timeline, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%zu\" height=\"", timeline->options.width + 2 * WindowInvestigator_Timeline_MARGIN);
+	if (fflush(output) != 0 || fgetpos(output, &timeline->heightPosition) != 0) timeline->failed = true;
+	// Placeholder, filled in by WindowInvestigator_Timeline_Finish().
+	WindowInvestigator_Timeline_Printf(timeline, "%010d\">\n", 0);
+	WindowInvestigator_Timeline_Printf(timeline, "<style>text{font:9px sans-serif;white-space:pre}.h{font-size:12px}.b{fill:#000}.t{stroke:#e0e0e0}.s{stroke:#1e88e5;stroke-opacity:0.4}.a{stroke:#e53935}</style>\n");
+	WindowInvestigator_Timeline_Printf(timeline, "<text x=\"%d\" y=\"14\" class=\"h\">WindowInvestigator timeline. Tracks, top to bottom: Z-order (darker is closer to the top), visibility (green: visible, orange: minimized), cloak, band, styles, window rect. Black: too many changes to show at this zoom level. Blue lines: shell hook messages. Red lines: appbar messages. Hover for details.</text>\n",
+		WindowInvestigator_Timeline_MARGIN);
+	WindowInvestigator_Timeline_WriteTimeAxis(timeline);
+
+	WindowInvestigator_Timeline_UpdateAllLanes(timeline, state, 0);
+}
+
+void WindowInvestigator_Timeline_OnRecord(WindowInvestigator_Timeline* timeline, const WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload) {
+	const size_t pixel = WindowInvestigator_Timeline_GetPixel(timeline, header->timestamp);
+	switch (header->type) {
+	case WindowInvestigator_MonitorEvent_WINDOW_CHANGED: {
+		const size_t laneSlot = WindowInvestigator_WindowTable_Find(&timeline->lanes, (uintptr_t)header->window);
+		const size_t slot = WindowInvestigator_WindowTable_Find(&state->windows, (uintptr_t)header->window);
+		if (laneSlot == WindowInvestigator_WindowTable_NO_SLOT || slot == WindowInvestigator_WindowTable_NO_SLOT) return;
+		WindowInvestigator_TimelineLane* const lane = WindowInvestigator_WindowTable_GetValue(&timeline->lanes, laneSlot);
+		WindowInvestigator_Timeline_UpdateLane(timeline, lane, WindowInvestigator_WindowTable_GetValue(&state->windows, slot), lane->zOrder, pixel);
+		return;
+	}
+	case WindowInvestigator_MonitorEvent_ZORDER_UPDATED:
+		WindowInvestigator_Timeline_UpdateAllLanes(timeline, state, pixel);
+		return;
+	case WindowInvestigator_MonitorEvent_KEYFRAME:
+	case WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT:
+		// Normally, keyframes do not change anything, but they do fill in whatever was lost if events were dropped.
+		if (state->pendingSnapshots == 0) WindowInvestigator_Timeline_UpdateAllLanes(timeline, state, pixel);
+		return;
+	case WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE:
+		WindowInvestigator_Timeline_OnReceivedMessage(timeline, header, payload, pixel);
+		return;
+	}
+}
+
+bool WindowInvestigator_Timeline_Finish(WindowInvestigator_Timeline* timeline) {
+	for (int kind = 0; kind < WindowInvestigator_ReceivedMessage_COUNT; ++kind) WindowInvestigator_Timeline_WriteMarker(timeline, kind);
+	WindowInvestigator_Timeline_UpdateAllLanes(timeline, NULL, timeline->options.width);
+	WindowInvestigator_Timeline_Printf(timeline, "</svg>\n");
+	if (timeline->options.html) WindowInvestigator_Timeline_Printf(timeline, "</body></html>\n");
+
+	if (fflush(timeline->output) != 0 || fsetpos(timeline->output, &timeline->heightPosition) != 0) return false;
+	WindowInvestigator_Timeline_Printf(timeline, "%010zu", WindowInvestigator_Timeline_HEADER_HEIGHT + timeline->laneCount * WindowInvestigator_Timeline_LANE_HEIGHT);
+	if (fflush(timeline->output) != 0) return false;
+	return !timeline->failed;
+}
+
+void WindowInvestigator_Timeline_Destroy(WindowInvestigator_Timeline* timeline) {
+	WindowInvestigator_WindowTable_Destroy(&timeline->lanes);
+	WindowInvestigator_Free(timeline->freeLanes);
+}
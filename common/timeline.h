@@ -0,0 +1,111 @@
+#pragma once
+
+#include "capture_file.h"
+#include "capture_index.h"
+#include "window_info.h"
+#include "window_table.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Renders capture records as an SVG timeline, similar to the one in the README (firefox-timeline.png).
+//
+// Each window gets a swimlane, made of one track per property of interest (see WindowInvestigator_TimelineTrack). Every time
+// a property changes, a new segment starts on the corresponding track; segments are colored according to their value, and
+// their tooltip shows the value. Received messages (e.g. shell hook messages, ABN_FULLSCREENAPP) are shown as vertical
+// markers across all lanes.
+//
+// The timeline is rendered in a single pass over the capture: segments are written out as soon as they end, and lanes are
+// reused once their window is gone. Memory usage therefore only depends on the number of windows that exist at the same
+// time, not on the length of the capture.
+//
+// The output is bounded by the width of the timeline, regardless of how many events there are: when changes are only a few
+// pixels apart (i.e. when zoomed out), they are aggregated into a single "busy" region whose tooltip tells how many changes
+// it stands for. Likewise, messages that fall within the same pixel column are aggregated into a single marker.
+
+typedef enum {
+	WindowInvestigator_TimelineTrack_Z_ORDER,
+	WindowInvestigator_TimelineTrack_VISIBILITY,
+	WindowInvestigator_TimelineTrack_CLOAK,
+	WindowInvestigator_TimelineTrack_BAND,
+	WindowInvestigator_TimelineTrack_STYLES,
+	WindowInvestigator_TimelineTrack_RECT,
+	WindowInvestigator_TimelineTrack_COUNT,
+} WindowInvestigator_TimelineTrack;
+
+typedef struct {
+	// Time range to render, using the capture clock.
+	uint64_t startTimestamp;
+	uint64_t endTimestamp;
+	// Timestamp at the start of the capture, so that the time axis can be labeled in seconds since the start of the capture.
+	uint64_t captureStartTimestamp;
+	// Width of the time axis, in pixels.
+	size_t width;
+	// Wrap the SVG in an HTML page.
+	bool html;
+} WindowInvestigator_TimelineOptions;
+
+typedef struct {
+	size_t lane;
+	// Pixel column where the window appeared.
+	size_t windowStart;
+	// Values that the current segment of each track is drawn with. String IDs are not valid.
+	WindowInvestigator_WindowInfo windowInfo;
+	size_t zOrder;
+	// Pixel column where the current segment of each track started.
+	size_t segmentStart[WindowInvestigator_TimelineTrack_COUNT];
+	// Changes that came too soon after the previous one to be shown separately. If there are any, the current segment starts
+	// with a busy region that ends at lastChangePixel, and the values only apply from there on.
+	uint32_t changeCount[WindowInvestigator_TimelineTrack_COUNT];
+	size_t lastChangePixel[WindowInvestigator_TimelineTrack_COUNT];
+} WindowInvestigator_TimelineLane;
+
+#define WindowInvestigator_TimelineMarker_TITLE_SIZE 512
+
+// Messages of one kind that fall within the same pixel column.
+typedef struct {
+	// Pixel column, or SIZE_MAX if there is no pending marker.
+	size_t pixel;
+	uint64_t count;
+	char title[WindowInvestigator_TimelineMarker_TITLE_SIZE];
+	size_t titleLength;
+} WindowInvestigator_TimelineMarker;
+
+typedef struct {
+	FILE* output;
+	WindowInvestigator_TimelineOptions options;
+	bool failed;
+	// Where the height of the SVG is written, so that it can be filled in once the number of lanes is known.
+	fpos_t heightPosition;
+
+	// Values are WindowInvestigator_TimelineLane.
+	WindowInvestigator_WindowTable lanes;
+	size_t laneCount;
+	size_t* freeLanes;
+	size_t freeLaneCount;
+	size_t freeLaneCapacity;
+
+	// Indexed by WindowInvestigator_ReceivedMessageKind.
+	WindowInvestigator_TimelineMarker markers[WindowInvestigator_ReceivedMessage_COUNT];
+	// Pixel column at which windows that are gone are closed. Only valid during a pass over the lanes.
+	size_t closePixel;
+
+	// Statistics.
+	uint64_t windowCount;
+	uint64_t segmentCount;
+	uint64_t aggregatedChangeCount;
+	uint64_t markerCount;
+	uint64_t aggregatedMessageCount;
+} WindowInvestigator_Timeline;
+
+// Starts rendering into output, which must be seekable and stays owned by the caller. Windows that exist in state (as of
+// options->startTimestamp) are rendered from the start of the timeline.
+void WindowInvestigator_Timeline_Init(WindowInvestigator_Timeline* timeline, FILE* output, const WindowInvestigator_TimelineOptions* options, const WindowInvestigator_CaptureState* state);
+// Must be called after the record has been applied to state (see WindowInvestigator_CaptureState_Apply()), for every record
+// in the time range, in capture order.
+void WindowInvestigator_Timeline_OnRecord(WindowInvestigator_Timeline* timeline, const WindowInvestigator_CaptureState* state, const WindowInvestigator_CaptureRecordHeader* header, const unsigned char* payload);
+// Finishes the timeline at options->endTimestamp. Returns false if the output could not be written.
+bool WindowInvestigator_Timeline_Finish(WindowInvestigator_Timeline* timeline);
+void WindowInvestigator_Timeline_Destroy(WindowInvestigator_Timeline* timeline);
@@ -0,0 +1,193 @@
+#include "window_filter.h"
+
+#include "allocation.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+void WindowInvestigator_WindowFilter_Init(WindowInvestigator_WindowFilter* filter) {
+	memset(filter, 0, sizeof(*filter));
+}
+
+static void WindowInvestigator_WindowFilter_FreePatterns(wchar_t** patterns, size_t patternCount) {
+	for (size_t pattern = 0; pattern < patternCount; ++pattern)
+		WindowInvestigator_Free(patterns[pattern]);
+	WindowInvestigator_Free(patterns);
+}
+
+void WindowInvestigator_WindowFilter_Destroy(WindowInvestigator_WindowFilter* filter) {
+	WindowInvestigator_Free(filter->windows);
+	WindowInvestigator_Free(filter->processIds);
+	WindowInvestigator_WindowFilter_FreePatterns(filter->imageNamePatterns, filter->imageNamePatternCount);
+	WindowInvestigator_WindowFilter_FreePatterns(filter->classNamePatterns, filter->classNamePatternCount);
+	memset(filter, 0, sizeof(*filter));
+}
+
+// Returns the length of the list item that starts at item, i.e. up to the next comma or the end of the list.
+static size_t WindowInvestigator_WindowFilter_GetItemLength(const wchar_t* item) {
+	size_t length = 0;
+	while (item[length] != L'\0' && item[length] != L',') ++length;
+	return length;
+}
+
+static bool WindowInvestigator_WindowFilter_ParseNumber(const wchar_t* item, size_t length, uint64_t maximum, uint64_t* value) {
+	if (length == 0 || item[0] == L'-' || item[0] == L'+' || iswspace((wint_t)item[0])) return false;
+	wchar_t* end;
+	// wcstoull() saturates numbers that do not fit, which would otherwise pass for ULLONG_MAX.
+	errno = 0;
+	const unsigned long long number = wcstoull(item, &end, 0);
+	if (end != item + length || errno == ERANGE || number > maximum) return false;
+	*value = number;
+	return true;
+}
+
+static wchar_t* WindowInvestigator_WindowFilter_CopyPattern(const wchar_t* item, size_t length) {
+	wchar_t* const pattern = WindowInvestigator_Reallocate(NULL, length + 1, sizeof(*pattern));
+	for (size_t index = 0; index < length; ++index)
+		pattern[index] = (wchar_t)towlower((wint_t)item[index]);
+	pattern[length] = L'\0';
+	return pattern;
+}
+
+bool WindowInvestigator_WindowFilter_Add(WindowInvestigator_WindowFilter* filter, WindowInvestigator_WindowFilterKind kind, const wchar_t* list) {
+	if (filter->compiled) abort();
+
+	// Validate everything first, so that nothing is added if the list is malformed.
+	size_t itemCount = 0;
+	for (const wchar_t* item = list;; ++item) {
+		const size_t length = WindowInvestigator_WindowFilter_GetItemLength(item);
+		uint64_t value;
+		if (length == 0) return false;
+		if (kind == WindowInvestigator_WindowFilterKind_WINDOW && !WindowInvestigator_WindowFilter_ParseNumber(item, length, UINTPTR_MAX, &value)) return false;
+		if (kind == WindowInvestigator_WindowFilterKind_PROCESS_ID && !WindowInvestigator_WindowFilter_ParseNumber(item, length, UINT32_MAX, &value)) return false;
+		++itemCount;
+		item += length;
+		if (*item == L'\0') break;
+	}
+
+	switch (kind) {
+	case WindowInvestigator_WindowFilterKind_WINDOW:
+		filter->windows = WindowInvestigator_Reallocate(filter->windows, filter->windowCount + itemCount, sizeof(*filter->windows));
+		break;
+	case WindowInvestigator_WindowFilterKind_PROCESS_ID:
+		filter->processIds = WindowInvestigator_Reallocate(filter->processIds, filter->processIdCount + itemCount, sizeof(*filter->processIds));
+		break;
+	case WindowInvestigator_WindowFilterKind_IMAGE_NAME:
+		filter->imageNamePatterns = WindowInvestigator_Reallocate(filter->imageNamePatterns, filter->imageNamePatternCount + itemCount, sizeof(*filter->imageNamePatterns));
+		break;
+	case WindowInvestigator_WindowFilterKind_CLASS_NAME:
+		filter->classNamePatterns = WindowInvestigator_Reallocate(filter->classNamePatterns, filter->classNamePatternCount + itemCount, sizeof(*filter->classNamePatterns));
+		break;
+	}
+	for (const wchar_t* item = list;; ++item) {
+		const size_t length = WindowInvestigator_WindowFilter_GetItemLength(item);
+		uint64_t value = 0;
+		switch (kind) {
+		case WindowInvestigator_WindowFilterKind_WINDOW:
+			WindowInvestigator_WindowFilter_ParseNumber(item, length, UINTPTR_MAX, &value);
+			filter->windows[filter->windowCount++] = (uintptr_t)value;
+			break;
+		case WindowInvestigator_WindowFilterKind_PROCESS_ID:
+			WindowInvestigator_WindowFilter_ParseNumber(item, length, UINT32_MAX, &value);
+			filter->processIds[filter->processIdCount++] = (uint32_t)value;
+			break;
+		case WindowInvestigator_WindowFilterKind_IMAGE_NAME:
+			filter->imageNamePatterns[filter->imageNamePatternCount++] = WindowInvestigator_WindowFilter_CopyPattern(item, length);
+			break;
+		case WindowInvestigator_WindowFilterKind_CLASS_NAME:
+			filter->classNamePatterns[filter->classNamePatternCount++] = WindowInvestigator_WindowFilter_CopyPattern(item, length);
+			break;
+		}
+		item += length;
+		if (*item == L'\0') break;
+	}
+	return true;
+}
+
+static int WindowInvestigator_WindowFilter_CompareWindows(const void* left, const void* right) {
+	const uintptr_t leftWindow = *(const uintptr_t*)left;
+	const uintptr_t rightWindow = *(const uintptr_t*)right;
+	return leftWindow < rightWindow ? -1 : leftWindow > rightWindow;
+}
+
+static int WindowInvestigator_WindowFilter_CompareProcessIds(const void* left, const void* right) {
+	const uint32_t leftProcessId = *(const uint32_t*)left;
+	const uint32_t rightProcessId = *(const uint32_t*)right;
+	return leftProcessId < rightProcessId ? -1 : leftProcessId > rightProcessId;
+}
+
+void WindowInvestigator_WindowFilter_Compile(WindowInvestigator_WindowFilter* filter) {
+	if (filter->windowCount != 0) {
+		qsort(filter->windows, filter->windowCount, sizeof(*filter->windows), WindowInvestigator_WindowFilter_CompareWindows);
+		size_t uniqueCount = 1;
+		for (size_t index = 1; index < filter->windowCount; ++index)
+			if (filter->windows[index] != filter->windows[uniqueCount - 1]) filter->windows[uniqueCount++] = filter->windows[index];
+		filter->windowCount = uniqueCount;
+	}
+	if (filter->processIdCount != 0) {
+		qsort(filter->processIds, filter->processIdCount, sizeof(*filter->processIds), WindowInvestigator_WindowFilter_CompareProcessIds);
+		size_t uniqueCount = 1;
+		for (size_t index = 1; index < filter->processIdCount; ++index)
+			if (filter->processIds[index] != filter->processIds[uniqueCount - 1]) filter->processIds[uniqueCount++] = filter->processIds[index];
+		filter->processIdCount = uniqueCount;
+	}
+	filter->compiled = true;
+}
+
+bool WindowInvestigator_WindowFilter_IsEmpty(const WindowInvestigator_WindowFilter* filter) {
+	return filter->windowCount == 0 && filter->processIdCount == 0 && filter->imageNamePatternCount == 0 && filter->classNamePatternCount == 0;
+}
+
+bool WindowInvestigator_WindowFilter_UsesClassName(const WindowInvestigator_WindowFilter* filter) {
+	return filter->classNamePatternCount != 0;
+}
+
+bool WindowInvestigator_WindowFilter_UsesImageName(const WindowInvestigator_WindowFilter* filter) {
+	return filter->imageNamePatternCount != 0;
+}
+
+// pattern is lowercase; string is compared case-insensitively. On a mismatch after a *, only the last * is backtracked, which
+// is enough because everything before it has already matched.
+static bool WindowInvestigator_WindowFilter_MatchPattern(const wchar_t* pattern, const wchar_t* string) {
+	const wchar_t* starPattern = NULL;
+	const wchar_t* starString = NULL;
+	while (*string != L'\0') {
+		if (*pattern == L'*') {
+			starPattern = ++pattern;
+			starString = string;
+		}
+		else if (*pattern != L'\0' && (*pattern == L'?' || *pattern == (wchar_t)towlower((wint_t)*string))) {
+			++pattern;
+			++string;
+		}
+		else if (starPattern != NULL) {
+			pattern = starPattern;
+			string = ++starString;
+		}
+		else return false;
+	}
+	while (*pattern == L'*') ++pattern;
+	return *pattern == L'\0';
+}
+
+static bool WindowInvestigator_WindowFilter_MatchAnyPattern(wchar_t* const* patterns, size_t patternCount, const wchar_t* string) {
+	for (size_t pattern = 0; pattern < patternCount; ++pattern)
+		if (WindowInvestigator_WindowFilter_MatchPattern(patterns[pattern], string)) return true;
+	return false;
+}
+
+bool WindowInvestigator_WindowFilter_Matches(const WindowInvestigator_WindowFilter* filter, uintptr_t window, uint32_t processId, const wchar_t* className, const wchar_t* imageName) {
+	if (!filter->compiled) abort();
+	if (filter->windowCount != 0 && bsearch(&window, filter->windows, filter->windowCount, sizeof(*filter->windows), WindowInvestigator_WindowFilter_CompareWindows) != NULL) return true;
+	if (filter->processIdCount != 0 && bsearch(&processId, filter->processIds, filter->processIdCount, sizeof(*filter->processIds), WindowInvestigator_WindowFilter_CompareProcessIds) != NULL) return true;
+	if (className != NULL && WindowInvestigator_WindowFilter_MatchAnyPattern(filter->classNamePatterns, filter->classNamePatternCount, className)) return true;
+	if (imageName != NULL && filter->imageNamePatternCount != 0) {
+		const wchar_t* fileName = imageName;
+		for (const wchar_t* character = imageName; *character != L'\0'; ++character)
+			if (*character == L'\\' || *character == L'/') fileName = character + 1;
+		if (WindowInvestigator_WindowFilter_MatchAnyPattern(filter->imageNamePatterns, filter->imageNamePatternCount, fileName)) return true;
+	}
+	return false;
+}
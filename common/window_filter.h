@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+// Selects the windows to monitor when only a few applications are of interest (e.g. a game or a browser), so that the rest of
+// the desktop does not have to be sampled.
+//
+// A window matches the filter if it matches any of its criteria: its handle is in the window set, its process ID is in the
+// process ID set, the file name of its process image matches one of the image name patterns, or its class name matches one
+// of the class name patterns. Patterns are case-insensitive and support the * (any sequence) and ? (any character)
+// wildcards.
+//
+// None of these properties change during the lifetime of a window, so the filter only needs to be evaluated once per window.
+
+typedef enum {
+	WindowInvestigator_WindowFilterKind_WINDOW,
+	WindowInvestigator_WindowFilterKind_PROCESS_ID,
+	WindowInvestigator_WindowFilterKind_IMAGE_NAME,
+	WindowInvestigator_WindowFilterKind_CLASS_NAME,
+} WindowInvestigator_WindowFilterKind;
+
+typedef struct {
+	// Sorted and deduplicated by WindowInvestigator_WindowFilter_Compile(), so that they can be binary searched.
+	uintptr_t* windows;
+	size_t windowCount;
+	uint32_t* processIds;
+	size_t processIdCount;
+	// Lowercase.
+	wchar_t** imageNamePatterns;
+	size_t imageNamePatternCount;
+	wchar_t** classNamePatterns;
+	size_t classNamePatternCount;
+	bool compiled;
+} WindowInvestigator_WindowFilter;
+
+// The filter starts empty, i.e. matching no windows.
+void WindowInvestigator_WindowFilter_Init(WindowInvestigator_WindowFilter* filter);
+void WindowInvestigator_WindowFilter_Destroy(WindowInvestigator_WindowFilter* filter);
+
+// Adds a comma-separated list of criteria of the specified kind, e.g. L"0x1234,0x5678" for windows, L"1234,5678" for process
+// IDs (decimal or 0x-prefixed hexadecimal), L"chrome.exe,firefox.exe" for image names or L"Chrome_WidgetWin_*" for class
+// names. Returns false, adding nothing, if the list is malformed. Cannot be called once the filter is compiled.
+bool WindowInvestigator_WindowFilter_Add(WindowInvestigator_WindowFilter* filter, WindowInvestigator_WindowFilterKind kind, const wchar_t* list);
+// Must be called after the last WindowInvestigator_WindowFilter_Add() and before WindowInvestigator_WindowFilter_Matches().
+void WindowInvestigator_WindowFilter_Compile(WindowInvestigator_WindowFilter* filter);
+
+bool WindowInvestigator_WindowFilter_IsEmpty(const WindowInvestigator_WindowFilter* filter);
+// Whether WindowInvestigator_WindowFilter_Matches() needs the class name and image name, respectively. Looking up the image
+// name of a process is relatively expensive.
+bool WindowInvestigator_WindowFilter_UsesClassName(const WindowInvestigator_WindowFilter* filter);
+bool WindowInvestigator_WindowFilter_UsesImageName(const WindowInvestigator_WindowFilter* filter);
+
+// className and imageName are null-terminated, and can be NULL if the filter does not use them or if they are unknown.
+// imageName can be a full path, in which case only the file name is matched.
+bool WindowInvestigator_WindowFilter_Matches(const WindowInvestigator_WindowFilter* filter, uintptr_t window, uint32_t processId, const wchar_t* className, const wchar_t* imageName);
@@ -0,0 +1,381 @@
+#include "window_info.h"
+
+#include "atomic.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WindowInvestigator_WindowInfoDiff_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only let intrinsics be used in functions compiled for the corresponding instruction set. MSVC lets any
+// function use them.
+#ifdef __GNUC__
+#define WindowInvestigator_WindowInfoDiff_TARGET(instructionSet) __attribute__((target(instructionSet)))
+#else
+#define WindowInvestigator_WindowInfoDiff_TARGET(instructionSet)
+#endif
+
+static bool WindowInvestigator_EqualRect(const WindowInvestigator_Rect* lhs, const WindowInvestigator_Rect* rhs) {
+	return lhs->left == rhs->left && lhs->top == rhs->top && lhs->right == rhs->right && lhs->bottom == rhs->bottom;
+}
+
+static bool WindowInvestigator_EqualPoint(const WindowInvestigator_Point* lhs, const WindowInvestigator_Point* rhs) {
+	return lhs->x == rhs->x && lhs->y == rhs->y;
+}
+
+static uint32_t WindowInvestigator_DiffWindowInfo_Scalar(const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	uint32_t changedFields = 0;
+
+	if (oldWindowInfo->processId != newWindowInfo->processId)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PROCESS_ID);
+	if (oldWindowInfo->threadId != newWindowInfo->threadId)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_THREAD_ID);
+	if (oldWindowInfo->className != newWindowInfo->className)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME);
+	if (oldWindowInfo->extendedStyles != newWindowInfo->extendedStyles)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES);
+	if (oldWindowInfo->styles != newWindowInfo->styles)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES);
+	if (!WindowInvestigator_EqualRect(&oldWindowInfo->windowRect, &newWindowInfo->windowRect))
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT);
+	if (!WindowInvestigator_EqualRect(&oldWindowInfo->clientRect, &newWindowInfo->clientRect))
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT);
+	if (!WindowInvestigator_EqualRect(&oldWindowInfo->clientRectInScreenCoordinates, &newWindowInfo->clientRectInScreenCoordinates))
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES);
+	if (oldWindowInfo->placement.showCmd != newWindowInfo->placement.showCmd)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD);
+	if (!WindowInvestigator_EqualPoint(&oldWindowInfo->placement.minPosition, &newWindowInfo->placement.minPosition))
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION);
+	if (!WindowInvestigator_EqualPoint(&oldWindowInfo->placement.maxPosition, &newWindowInfo->placement.maxPosition))
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION);
+	if (!WindowInvestigator_EqualRect(&oldWindowInfo->placement.normalPosition, &newWindowInfo->placement.normalPosition))
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION);
+	if (oldWindowInfo->text != newWindowInfo->text)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT);
+	if (oldWindowInfo->isShellManagedWindow != newWindowInfo->isShellManagedWindow)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW);
+	if (oldWindowInfo->isShellFrameWindow != newWindowInfo->isShellFrameWindow)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW);
+	if (oldWindowInfo->overpanning != newWindowInfo->overpanning)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_OVERPANNING);
+	if (oldWindowInfo->band != newWindowInfo->band)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_BAND);
+	if (oldWindowInfo->hasNonRudeHWNDProperty != newWindowInfo->hasNonRudeHWNDProperty)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY);
+	if (oldWindowInfo->hasNonRudeAddedByRudeWindowFixerProperty != newWindowInfo->hasNonRudeAddedByRudeWindowFixerProperty)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY);
+	if (oldWindowInfo->hasLivePreviewWindowProperty != newWindowInfo->hasLivePreviewWindowProperty)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY);
+	if (oldWindowInfo->hasTreatAsDesktopFullscreenProperty != newWindowInfo->hasTreatAsDesktopFullscreenProperty)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY);
+	if (oldWindowInfo->isWindow != newWindowInfo->isWindow)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_WINDOW);
+	if (oldWindowInfo->dwmIsCloaked != newWindowInfo->dwmIsCloaked)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED);
+	if (oldWindowInfo->isIconic != newWindowInfo->isIconic)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC);
+	if (oldWindowInfo->isVisible != newWindowInfo->isVisible)
+		changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE);
+
+	return changedFields;
+}
+
+#ifdef WindowInvestigator_WindowInfoDiff_X86
+
+// The vector kernels compare snapshots as raw bytes, and map the bytes that differ back to fields with this table. Padding
+// bytes map to WindowInvestigator_WindowField_COUNT, whose bit is dropped, so that garbage in them never shows up as a change.
+#define WindowInvestigator_WindowInfoDiff_PADDING WindowInvestigator_WindowField_COUNT
+#define WindowInvestigator_WindowInfoDiff_BYTES_4(field) field, field, field, field
+#define WindowInvestigator_WindowInfoDiff_BYTES_8(field) WindowInvestigator_WindowInfoDiff_BYTES_4(field), WindowInvestigator_WindowInfoDiff_BYTES_4(field)
+#define WindowInvestigator_WindowInfoDiff_BYTES_16(field) WindowInvestigator_WindowInfoDiff_BYTES_8(field), WindowInvestigator_WindowInfoDiff_BYTES_8(field)
+static const unsigned char WindowInvestigator_windowInfoByteFields[] = {
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_PROCESS_ID),
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_THREAD_ID),
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_CLASS_NAME),
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_EXTENDED_STYLES),
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_STYLES),
+	WindowInvestigator_WindowInfoDiff_BYTES_16(WindowInvestigator_WindowField_WINDOW_RECT),
+	WindowInvestigator_WindowInfoDiff_BYTES_16(WindowInvestigator_WindowField_CLIENT_RECT),
+	WindowInvestigator_WindowInfoDiff_BYTES_16(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES),
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD),
+	WindowInvestigator_WindowInfoDiff_BYTES_8(WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION),
+	WindowInvestigator_WindowInfoDiff_BYTES_8(WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION),
+	WindowInvestigator_WindowInfoDiff_BYTES_16(WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION),
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_TEXT),
+	WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW,
+	WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW,
+	WindowInvestigator_WindowField_OVERPANNING,
+	WindowInvestigator_WindowInfoDiff_PADDING,
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_BAND),
+	WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY,
+	WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY,
+	WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY,
+	WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY,
+	WindowInvestigator_WindowField_IS_WINDOW,
+	WindowInvestigator_WindowInfoDiff_PADDING,
+	WindowInvestigator_WindowInfoDiff_PADDING,
+	WindowInvestigator_WindowInfoDiff_PADDING,
+	WindowInvestigator_WindowInfoDiff_BYTES_4(WindowInvestigator_WindowField_DWM_IS_CLOAKED),
+	WindowInvestigator_WindowField_IS_ICONIC,
+	WindowInvestigator_WindowField_IS_VISIBLE,
+	WindowInvestigator_WindowInfoDiff_PADDING,
+	WindowInvestigator_WindowInfoDiff_PADDING,
+};
+
+// Fails to compile if the table above does not match the layout of WindowInvestigator_WindowInfo anymore.
+#define WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(name, condition) typedef char WindowInvestigator_WindowInfoDiff_##name[(condition) ? 1 : -1]
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(Size, sizeof(WindowInvestigator_windowInfoByteFields) == sizeof(WindowInvestigator_WindowInfo));
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(Placement, offsetof(WindowInvestigator_WindowInfo, placement) == 68 && sizeof(WindowInvestigator_WindowPlacement) == 36);
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(Text, offsetof(WindowInvestigator_WindowInfo, text) == 104);
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(Overpanning, offsetof(WindowInvestigator_WindowInfo, overpanning) == 110);
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(Band, offsetof(WindowInvestigator_WindowInfo, band) == 112);
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(IsWindow, offsetof(WindowInvestigator_WindowInfo, isWindow) == 120);
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(DwmIsCloaked, offsetof(WindowInvestigator_WindowInfo, dwmIsCloaked) == 124);
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(IsVisible, offsetof(WindowInvestigator_WindowInfo, isVisible) == 129);
+
+// Bit n of word n / 32 is set if byte n differs. Covers the whole snapshot.
+#define WindowInvestigator_WindowInfoDiff_WORD_COUNT ((sizeof(WindowInvestigator_WindowInfo) + 31) / 32)
+
+static unsigned int WindowInvestigator_WindowInfoDiff_CountTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctz(value);
+#endif
+}
+
+static uint32_t WindowInvestigator_WindowInfoDiff_GetChangedFields(const uint32_t differentBytes[WindowInvestigator_WindowInfoDiff_WORD_COUNT]) {
+	uint32_t changedFields = 0;
+	for (size_t word = 0; word < WindowInvestigator_WindowInfoDiff_WORD_COUNT; ++word)
+		for (uint32_t bytes = differentBytes[word]; bytes != 0; bytes &= bytes - 1)
+			changedFields |= WindowInvestigator_WindowField_BIT(WindowInvestigator_windowInfoByteFields[word * 32 + WindowInvestigator_WindowInfoDiff_CountTrailingZeros(bytes)]);
+	return changedFields & WindowInvestigator_WindowField_ALL;
+}
+
+// Both vector kernels stop at the same byte, past which there is not enough left to fill a vector.
+#define WindowInvestigator_WindowInfoDiff_VECTOR_BYTES (sizeof(WindowInvestigator_WindowInfo) / 32 * 32)
+WindowInvestigator_WindowInfoDiff_CHECK_LAYOUT(Tail, sizeof(WindowInvestigator_WindowInfo) - WindowInvestigator_WindowInfoDiff_VECTOR_BYTES == sizeof(uint32_t));
+
+// Compares the bytes past the vectors at once. Padding bytes that differ only cost a trip through the slow path, which drops
+// them.
+static bool WindowInvestigator_WindowInfoDiff_EqualTail(const unsigned char* oldBytes, const unsigned char* newBytes) {
+	uint32_t oldTail;
+	uint32_t newTail;
+	memcpy(&oldTail, oldBytes + WindowInvestigator_WindowInfoDiff_VECTOR_BYTES, sizeof(oldTail));
+	memcpy(&newTail, newBytes + WindowInvestigator_WindowInfoDiff_VECTOR_BYTES, sizeof(newTail));
+	return oldTail == newTail;
+}
+
+static void WindowInvestigator_WindowInfoDiff_CompareTail(const unsigned char* oldBytes, const unsigned char* newBytes, uint32_t differentBytes[WindowInvestigator_WindowInfoDiff_WORD_COUNT]) {
+	for (size_t byte = WindowInvestigator_WindowInfoDiff_VECTOR_BYTES; byte < sizeof(WindowInvestigator_WindowInfo); ++byte)
+		if (oldBytes[byte] != newBytes[byte]) differentBytes[byte / 32] |= (uint32_t)1 << (byte % 32);
+}
+
+// Most snapshots do not change from one tick to the next, so the vector kernels first check whether any byte differs at all,
+// which takes one compare per vector, and only work out which bytes differ if some do.
+
+WindowInvestigator_WindowInfoDiff_TARGET("sse2")
+static uint32_t WindowInvestigator_DiffWindowInfo_SSE2(const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	const unsigned char* const oldBytes = (const unsigned char*)oldWindowInfo;
+	const unsigned char* const newBytes = (const unsigned char*)newWindowInfo;
+	const size_t vectorBytes = WindowInvestigator_WindowInfoDiff_VECTOR_BYTES;
+	__m128i equal = _mm_set1_epi8(-1);
+	for (size_t byte = 0; byte < vectorBytes; byte += 16)
+		equal = _mm_and_si128(equal, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(oldBytes + byte)), _mm_loadu_si128((const __m128i*)(newBytes + byte))));
+	if (_mm_movemask_epi8(equal) == 0xFFFF && WindowInvestigator_WindowInfoDiff_EqualTail(oldBytes, newBytes)) return 0;
+
+	uint32_t differentBytes[WindowInvestigator_WindowInfoDiff_WORD_COUNT] = { 0 };
+	for (size_t byte = 0; byte < vectorBytes; byte += 16) {
+		const __m128i equalBytes = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(oldBytes + byte)), _mm_loadu_si128((const __m128i*)(newBytes + byte)));
+		differentBytes[byte / 32] |= (~(uint32_t)_mm_movemask_epi8(equalBytes) & 0xFFFF) << (byte % 32);
+	}
+	WindowInvestigator_WindowInfoDiff_CompareTail(oldBytes, newBytes, differentBytes);
+	return WindowInvestigator_WindowInfoDiff_GetChangedFields(differentBytes);
+}
+
+WindowInvestigator_WindowInfoDiff_TARGET("avx2")
+static uint32_t WindowInvestigator_DiffWindowInfo_AVX2(const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	const unsigned char* const oldBytes = (const unsigned char*)oldWindowInfo;
+	const unsigned char* const newBytes = (const unsigned char*)newWindowInfo;
+	const size_t vectorBytes = WindowInvestigator_WindowInfoDiff_VECTOR_BYTES;
+	__m256i equal = _mm256_set1_epi8(-1);
+	for (size_t byte = 0; byte < vectorBytes; byte += 32)
+		equal = _mm256_and_si256(equal, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(oldBytes + byte)), _mm256_loadu_si256((const __m256i*)(newBytes + byte))));
+	if (_mm256_movemask_epi8(equal) == -1 && WindowInvestigator_WindowInfoDiff_EqualTail(oldBytes, newBytes)) return 0;
+
+	uint32_t differentBytes[WindowInvestigator_WindowInfoDiff_WORD_COUNT] = { 0 };
+	for (size_t byte = 0; byte < vectorBytes; byte += 32) {
+		const __m256i equalBytes = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(oldBytes + byte)), _mm256_loadu_si256((const __m256i*)(newBytes + byte)));
+		differentBytes[byte / 32] = ~(uint32_t)_mm256_movemask_epi8(equalBytes);
+	}
+	WindowInvestigator_WindowInfoDiff_CompareTail(oldBytes, newBytes, differentBytes);
+	return WindowInvestigator_WindowInfoDiff_GetChangedFields(differentBytes);
+}
+
+#endif
+
+bool WindowInvestigator_WindowInfoDiffKernel_IsSupported(WindowInvestigator_WindowInfoDiffKernel kernel) {
+	switch (kernel) {
+	case WindowInvestigator_WindowInfoDiffKernel_SCALAR:
+		return true;
+#ifdef WindowInvestigator_WindowInfoDiff_X86
+#ifdef _MSC_VER
+	case WindowInvestigator_WindowInfoDiffKernel_SSE2: {
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 1);
+		return (cpuInfo[3] & (1 << 26)) != 0;
+	}
+	case WindowInvestigator_WindowInfoDiffKernel_AVX2: {
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 0);
+		if (cpuInfo[0] < 7) return false;
+		__cpuid(cpuInfo, 1);
+		// The OS must also save the AVX registers on context switches (OSXSAVE, then XCR0 bits 1 and 2).
+		const int osxsaveAndAvx = (1 << 27) | (1 << 28);
+		if ((cpuInfo[2] & osxsaveAndAvx) != osxsaveAndAvx || (_xgetbv(0) & 6) != 6) return false;
+		__cpuidex(cpuInfo, 7, 0);
+		return (cpuInfo[1] & (1 << 5)) != 0;
+	}
+#else
+	case WindowInvestigator_WindowInfoDiffKernel_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case WindowInvestigator_WindowInfoDiffKernel_AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+#endif
+	default:
+		return false;
+	}
+}
+
+WindowInvestigator_WindowInfoDiffKernel WindowInvestigator_WindowInfoDiffKernel_GetBest(void) {
+	// Detecting CPU features is too slow to do on every diff. Stored plus one, so that 0 means not detected yet; threads that
+	// race to detect them store the same value.
+	static volatile uint64_t bestKernel;
+	uint64_t kernel = WindowInvestigator_Atomic_LoadAcquire(&bestKernel);
+	if (kernel == 0) {
+		kernel = WindowInvestigator_WindowInfoDiffKernel_SCALAR + 1;
+		for (int candidate = WindowInvestigator_WindowInfoDiffKernel_COUNT - 1; candidate > WindowInvestigator_WindowInfoDiffKernel_SCALAR; --candidate)
+			if (WindowInvestigator_WindowInfoDiffKernel_IsSupported((WindowInvestigator_WindowInfoDiffKernel)candidate)) {
+				kernel = (uint64_t)candidate + 1;
+				break;
+			}
+		WindowInvestigator_Atomic_StoreRelease(&bestKernel, kernel);
+	}
+	return (WindowInvestigator_WindowInfoDiffKernel)(kernel - 1);
+}
+
+const char* WindowInvestigator_WindowInfoDiffKernel_GetName(WindowInvestigator_WindowInfoDiffKernel kernel) {
+	switch (kernel) {
+	case WindowInvestigator_WindowInfoDiffKernel_SCALAR: return "scalar";
+	case WindowInvestigator_WindowInfoDiffKernel_SSE2: return "SSE2";
+	case WindowInvestigator_WindowInfoDiffKernel_AVX2: return "AVX2";
+	default: return "?";
+	}
+}
+
+uint32_t WindowInvestigator_DiffWindowInfoWithKernel(WindowInvestigator_WindowInfoDiffKernel kernel, const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	switch (kernel) {
+#ifdef WindowInvestigator_WindowInfoDiff_X86
+	case WindowInvestigator_WindowInfoDiffKernel_SSE2: return WindowInvestigator_DiffWindowInfo_SSE2(oldWindowInfo, newWindowInfo);
+	case WindowInvestigator_WindowInfoDiffKernel_AVX2: return WindowInvestigator_DiffWindowInfo_AVX2(oldWindowInfo, newWindowInfo);
+#endif
+	default: return WindowInvestigator_DiffWindowInfo_Scalar(oldWindowInfo, newWindowInfo);
+	}
+}
+
+uint32_t WindowInvestigator_DiffWindowInfo(const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	return WindowInvestigator_DiffWindowInfoWithKernel(WindowInvestigator_WindowInfoDiffKernel_GetBest(), oldWindowInfo, newWindowInfo);
+}
+
+void WindowInvestigator_CopyWindowInfoFields(WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowInfo* source, uint32_t fields) {
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PROCESS_ID))
+		windowInfo->processId = source->processId;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_THREAD_ID))
+		windowInfo->threadId = source->threadId;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		windowInfo->className = source->className;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES))
+		windowInfo->extendedStyles = source->extendedStyles;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES))
+		windowInfo->styles = source->styles;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT))
+		windowInfo->windowRect = source->windowRect;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT))
+		windowInfo->clientRect = source->clientRect;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES))
+		windowInfo->clientRectInScreenCoordinates = source->clientRectInScreenCoordinates;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD))
+		windowInfo->placement.showCmd = source->placement.showCmd;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION))
+		windowInfo->placement.minPosition = source->placement.minPosition;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION))
+		windowInfo->placement.maxPosition = source->placement.maxPosition;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION))
+		windowInfo->placement.normalPosition = source->placement.normalPosition;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		windowInfo->text = source->text;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW))
+		windowInfo->isShellManagedWindow = source->isShellManagedWindow;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW))
+		windowInfo->isShellFrameWindow = source->isShellFrameWindow;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_OVERPANNING))
+		windowInfo->overpanning = source->overpanning;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_BAND))
+		windowInfo->band = source->band;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY))
+		windowInfo->hasNonRudeHWNDProperty = source->hasNonRudeHWNDProperty;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY))
+		windowInfo->hasNonRudeAddedByRudeWindowFixerProperty = source->hasNonRudeAddedByRudeWindowFixerProperty;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY))
+		windowInfo->hasLivePreviewWindowProperty = source->hasLivePreviewWindowProperty;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY))
+		windowInfo->hasTreatAsDesktopFullscreenProperty = source->hasTreatAsDesktopFullscreenProperty;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_WINDOW))
+		windowInfo->isWindow = source->isWindow;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED))
+		windowInfo->dwmIsCloaked = source->dwmIsCloaked;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC))
+		windowInfo->isIconic = source->isIconic;
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE))
+		windowInfo->isVisible = source->isVisible;
+}
+
+void WindowInvestigator_FinishCapturedString(WindowInvestigator_CapturedString* capturedString, size_t length) {
+	const size_t capacity = sizeof(capturedString->string) / sizeof(*capturedString->string);
+	if (length >= capacity) length = capacity - 1;
+	capturedString->string[length] = 0;
+	capturedString->length = length;
+	capturedString->hash = WindowInvestigator_HashString(capturedString->string, length);
+}
+
+static WindowInvestigator_StringId WindowInvestigator_InternWindowString(WindowInvestigator_StringPool* pool, const WindowInvestigator_StringId* previousId, const WindowInvestigator_CapturedString* capturedString) {
+	if (previousId != NULL && WindowInvestigator_StringPool_Equals(pool, *previousId, capturedString->string, capturedString->length, capturedString->hash)) return *previousId;
+	return WindowInvestigator_StringPool_Intern(pool, capturedString->string, capturedString->length, capturedString->hash);
+}
+
+void WindowInvestigator_InternWindowStrings(WindowInvestigator_StringPool* pool, const WindowInvestigator_WindowInfo* previousWindowInfo, uint32_t fields, const WindowInvestigator_WindowStrings* windowStrings, WindowInvestigator_WindowInfo* windowInfo) {
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		windowInfo->className = WindowInvestigator_InternWindowString(pool, previousWindowInfo == NULL ? NULL : &previousWindowInfo->className, &windowStrings->className);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		windowInfo->text = WindowInvestigator_InternWindowString(pool, previousWindowInfo == NULL ? NULL : &previousWindowInfo->text, &windowStrings->text);
+}
+
+void WindowInvestigator_ReleaseWindowStrings(WindowInvestigator_StringPool* pool, const WindowInvestigator_WindowInfo* windowInfo) {
+	WindowInvestigator_StringPool_Release(pool, windowInfo->className);
+	WindowInvestigator_StringPool_Release(pool, windowInfo->text);
+}
+
+void WindowInvestigator_ReplaceWindowInfo(WindowInvestigator_StringPool* pool, WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowInfo* newWindowInfo) {
+	if (windowInfo->className != newWindowInfo->className) WindowInvestigator_StringPool_Release(pool, windowInfo->className);
+	if (windowInfo->text != newWindowInfo->text) WindowInvestigator_StringPool_Release(pool, windowInfo->text);
+	*windowInfo = *newWindowInfo;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "string_pool.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wchar.h>
+
+// Platform-independent snapshot of the properties of a top-level window, as seen by the Rude Window Manager.
+//
+// Snapshots are taken and compared on every tick for every window, so they are kept small: strings are stored as IDs in a
+// WindowInvestigator_StringPool, and the raw strings are only ever read into a single WindowInvestigator_WindowStrings
+// scratch buffer.
+
+typedef struct {
+	int32_t left;
+	int32_t top;
+	int32_t right;
+	int32_t bottom;
+} WindowInvestigator_Rect;
+
+typedef struct {
+	int32_t x;
+	int32_t y;
+} WindowInvestigator_Point;
+
+typedef struct {
+	uint32_t showCmd;
+	WindowInvestigator_Point minPosition;
+	WindowInvestigator_Point maxPosition;
+	WindowInvestigator_Rect normalPosition;
+} WindowInvestigator_WindowPlacement;
+
+typedef struct {
+	uint32_t processId;
+	uint32_t threadId;
+
+	// RudeWindowWin32Functions::GetClassNameW()
+	WindowInvestigator_StringId className;
+
+	// RudeWindowWin32Functions::GetExStyleFromWindow()
+	uint32_t extendedStyles;
+
+	// RudeWindowWin32Functions::GetStyleFromWindow()
+	uint32_t styles;
+
+	// RudeWindowWin32Functions::GetWindowRectForFullscreenCheck()
+	WindowInvestigator_Rect windowRect;
+	WindowInvestigator_Rect clientRect;
+	WindowInvestigator_Rect clientRectInScreenCoordinates;
+	// This one is not part of RudeWindowWin32Functions, but included nonetheless because its output might be interesting.
+	WindowInvestigator_WindowPlacement placement;
+
+	// RudeWindowWin32Functions::InternalGetWindowText()
+	WindowInvestigator_StringId text;
+
+	// RudeWindowWin32Functions::IsAppWindow()
+	bool isShellManagedWindow;
+	bool isShellFrameWindow;
+
+	// TODO: RudeWindowWin32Functions::IsHolographic() missing - the logic is not as trivial as the others
+
+	// RudeWindowWin32Functions::IsOverpanning()
+	bool overpanning;
+
+	// RudeWindowWin32Functions::IsValidDesktopFullscreenWindow() (also isShellManagedWindow)
+	uint32_t band;
+	bool hasNonRudeHWNDProperty;
+	bool hasNonRudeAddedByRudeWindowFixerProperty;
+	bool hasLivePreviewWindowProperty;
+	bool hasTreatAsDesktopFullscreenProperty;
+
+	// RudeWindowWin32Functions::IsWindow()
+	bool isWindow;
+
+	//  RudeWindowWin32Functions::IsWindowAlwaysOnTopDesktop() uses GetStyleFromWindow() and GetWindowBand()
+
+	// RudeWindowWin32Functions::IsWindowCloaked()
+	uint32_t dwmIsCloaked;
+
+	// RudeWindowWin32Functions::IsWindowMinimized()
+	bool isIconic;
+
+	// RudeWindowWin32Functions::IsWindowOnMonitor() missing as it's relative to a monitor - though windowRect might be enough to deduce its value
+
+	// RudeWindowWin32Functions::IsWindowRelatedForFullscreen() missing because it takes a pair of windows
+
+	// RudeWindowWin32Functions::IsWindowVisible()
+	bool isVisible;
+
+	// RudeWindowWin32Functions::MonitorFromWindow() missing
+} WindowInvestigator_WindowInfo;
+
+// A string as read from the system, before it is interned.
+typedef struct {
+	wchar_t string[1024];
+	// Set by WindowInvestigator_FinishCapturedString().
+	size_t length;
+	uint64_t hash;
+} WindowInvestigator_CapturedString;
+
+// Raw strings of a window, as read from the system.
+typedef struct {
+	WindowInvestigator_CapturedString className;
+	WindowInvestigator_CapturedString text;
+} WindowInvestigator_WindowStrings;
+
+// Must be called by the producer once the first length characters of capturedString->string have been written. Computes
+// the hash, which makes comparing the captured string against the previous value cheap in the common case where they differ.
+void WindowInvestigator_FinishCapturedString(WindowInvestigator_CapturedString* capturedString, size_t length);
+
+// Identifies a field (or group of fields that are always reported together) of WindowInvestigator_WindowInfo.
+typedef enum {
+	WindowInvestigator_WindowField_PROCESS_ID,
+	WindowInvestigator_WindowField_THREAD_ID,
+	WindowInvestigator_WindowField_CLASS_NAME,
+	WindowInvestigator_WindowField_EXTENDED_STYLES,
+	WindowInvestigator_WindowField_STYLES,
+	WindowInvestigator_WindowField_WINDOW_RECT,
+	WindowInvestigator_WindowField_CLIENT_RECT,
+	WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES,
+	WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD,
+	WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION,
+	WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION,
+	WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION,
+	WindowInvestigator_WindowField_TEXT,
+	WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW,
+	WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW,
+	WindowInvestigator_WindowField_OVERPANNING,
+	WindowInvestigator_WindowField_BAND,
+	WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY,
+	WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY,
+	WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY,
+	WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY,
+	WindowInvestigator_WindowField_IS_WINDOW,
+	WindowInvestigator_WindowField_DWM_IS_CLOAKED,
+	WindowInvestigator_WindowField_IS_ICONIC,
+	WindowInvestigator_WindowField_IS_VISIBLE,
+	WindowInvestigator_WindowField_COUNT,
+} WindowInvestigator_WindowField;
+
+#define WindowInvestigator_WindowField_BIT(field) ((uint32_t)1 << (field))
+#define WindowInvestigator_WindowField_ALL (WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_COUNT) - 1)
+
+// Ways of diffing two snapshots, which all give the same result. The vector kernels compare whole snapshots a vector at a time,
+// so that the common case where nothing changed costs a handful of instructions, and only map the bytes that differ back to
+// fields if there are any.
+typedef enum {
+	// Compares field by field.
+	WindowInvestigator_WindowInfoDiffKernel_SCALAR,
+	WindowInvestigator_WindowInfoDiffKernel_SSE2,
+	WindowInvestigator_WindowInfoDiffKernel_AVX2,
+	WindowInvestigator_WindowInfoDiffKernel_COUNT,
+} WindowInvestigator_WindowInfoDiffKernel;
+
+// Whether the kernel is built in (vector kernels are only built for x86 and x64) and the CPU supports it.
+bool WindowInvestigator_WindowInfoDiffKernel_IsSupported(WindowInvestigator_WindowInfoDiffKernel kernel);
+// The fastest supported kernel, which is what WindowInvestigator_DiffWindowInfo() uses. Detected on first use.
+WindowInvestigator_WindowInfoDiffKernel WindowInvestigator_WindowInfoDiffKernel_GetBest(void);
+const char* WindowInvestigator_WindowInfoDiffKernel_GetName(WindowInvestigator_WindowInfoDiffKernel kernel);
+
+// Returns the set of fields that differ between the two snapshots, as a bitmask of WindowInvestigator_WindowField_BIT().
+uint32_t WindowInvestigator_DiffWindowInfo(const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo);
+// Same, using the specified kernel, which must be supported.
+uint32_t WindowInvestigator_DiffWindowInfoWithKernel(WindowInvestigator_WindowInfoDiffKernel kernel, const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo);
+
+// Copies the specified fields (bitmask of WindowInvestigator_WindowField_BIT()) from source to windowInfo.
+void WindowInvestigator_CopyWindowInfoFields(WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowInfo* source, uint32_t fields);
+
+// Sets the string IDs of windowInfo from the specified raw strings. Only strings whose field is in fields (bitmask of
+// WindowInvestigator_WindowField_BIT()) are considered; the other string IDs in windowInfo are left untouched.
+//
+// If previousWindowInfo is not NULL, strings that did not change reuse the IDs from previousWindowInfo without taking a new
+// reference; this avoids a string pool lookup for strings that did not change. Strings that did change get a new reference.
+void WindowInvestigator_InternWindowStrings(WindowInvestigator_StringPool* pool, const WindowInvestigator_WindowInfo* previousWindowInfo, uint32_t fields, const WindowInvestigator_WindowStrings* windowStrings, WindowInvestigator_WindowInfo* windowInfo);
+// Releases the string references held by the specified snapshot.
+void WindowInvestigator_ReleaseWindowStrings(WindowInvestigator_StringPool* pool, const WindowInvestigator_WindowInfo* windowInfo);
+// Replaces windowInfo with newWindowInfo, which must have been interned against windowInfo. Releases the strings that
+// windowInfo no longer uses.
+void WindowInvestigator_ReplaceWindowInfo(WindowInvestigator_StringPool* pool, WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowInfo* newWindowInfo);
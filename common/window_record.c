@@ -0,0 +1,262 @@
+#include "window_record.h"
+
+typedef struct {
+	unsigned char* position;
+} WindowInvestigator_WindowRecord_Writer;
+
+typedef struct {
+	const unsigned char* position;
+	const unsigned char* end;
+	bool malformed;
+} WindowInvestigator_WindowRecord_Reader;
+
+static void WindowInvestigator_WindowRecord_WriteUInt8(WindowInvestigator_WindowRecord_Writer* writer, uint8_t value) {
+	*writer->position++ = value;
+}
+
+static void WindowInvestigator_WindowRecord_WriteUInt16(WindowInvestigator_WindowRecord_Writer* writer, uint16_t value) {
+	WindowInvestigator_WindowRecord_WriteUInt8(writer, (uint8_t)value);
+	WindowInvestigator_WindowRecord_WriteUInt8(writer, (uint8_t)(value >> 8));
+}
+
+static void WindowInvestigator_WindowRecord_WriteUInt32(WindowInvestigator_WindowRecord_Writer* writer, uint32_t value) {
+	WindowInvestigator_WindowRecord_WriteUInt16(writer, (uint16_t)value);
+	WindowInvestigator_WindowRecord_WriteUInt16(writer, (uint16_t)(value >> 16));
+}
+
+static void WindowInvestigator_WindowRecord_WriteInt32(WindowInvestigator_WindowRecord_Writer* writer, int32_t value) {
+	WindowInvestigator_WindowRecord_WriteUInt32(writer, (uint32_t)value);
+}
+
+static void WindowInvestigator_WindowRecord_WriteRect(WindowInvestigator_WindowRecord_Writer* writer, const WindowInvestigator_Rect* rect) {
+	WindowInvestigator_WindowRecord_WriteInt32(writer, rect->left);
+	WindowInvestigator_WindowRecord_WriteInt32(writer, rect->top);
+	WindowInvestigator_WindowRecord_WriteInt32(writer, rect->right);
+	WindowInvestigator_WindowRecord_WriteInt32(writer, rect->bottom);
+}
+
+static void WindowInvestigator_WindowRecord_WritePoint(WindowInvestigator_WindowRecord_Writer* writer, const WindowInvestigator_Point* point) {
+	WindowInvestigator_WindowRecord_WriteInt32(writer, point->x);
+	WindowInvestigator_WindowRecord_WriteInt32(writer, point->y);
+}
+
+static void WindowInvestigator_WindowRecord_WriteBool(WindowInvestigator_WindowRecord_Writer* writer, bool value) {
+	WindowInvestigator_WindowRecord_WriteUInt8(writer, value ? 1 : 0);
+}
+
+static void WindowInvestigator_WindowRecord_WriteString(WindowInvestigator_WindowRecord_Writer* writer, const wchar_t* string) {
+	unsigned char* const lengthPosition = writer->position;
+	writer->position += 2;
+	uint16_t length = 0;
+	for (; *string != 0; ++string) {
+#if WCHAR_MAX > 0xFFFF
+		const uint32_t codePoint = (uint32_t)*string;
+		if (codePoint >= 0x10000 && codePoint <= 0x10FFFF) {
+			WindowInvestigator_WindowRecord_WriteUInt16(writer, (uint16_t)(0xD800 + ((codePoint - 0x10000) >> 10)));
+			WindowInvestigator_WindowRecord_WriteUInt16(writer, (uint16_t)(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+			length += 2;
+			continue;
+		}
+#endif
+		WindowInvestigator_WindowRecord_WriteUInt16(writer, (uint16_t)*string);
+		++length;
+	}
+	lengthPosition[0] = (unsigned char)length;
+	lengthPosition[1] = (unsigned char)(length >> 8);
+}
+
+static const unsigned char* WindowInvestigator_WindowRecord_Read(WindowInvestigator_WindowRecord_Reader* reader, size_t size) {
+	if ((size_t)(reader->end - reader->position) < size) {
+		reader->malformed = true;
+		reader->position = reader->end;
+		return NULL;
+	}
+	const unsigned char* const data = reader->position;
+	reader->position += size;
+	return data;
+}
+
+static uint8_t WindowInvestigator_WindowRecord_ReadUInt8(WindowInvestigator_WindowRecord_Reader* reader) {
+	const unsigned char* const data = WindowInvestigator_WindowRecord_Read(reader, 1);
+	return data == NULL ? 0 : data[0];
+}
+
+static uint16_t WindowInvestigator_WindowRecord_ReadUInt16(WindowInvestigator_WindowRecord_Reader* reader) {
+	const unsigned char* const data = WindowInvestigator_WindowRecord_Read(reader, 2);
+	return data == NULL ? 0 : (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t WindowInvestigator_WindowRecord_ReadUInt32(WindowInvestigator_WindowRecord_Reader* reader) {
+	const uint32_t low = WindowInvestigator_WindowRecord_ReadUInt16(reader);
+	return low | ((uint32_t)WindowInvestigator_WindowRecord_ReadUInt16(reader) << 16);
+}
+
+static int32_t WindowInvestigator_WindowRecord_ReadInt32(WindowInvestigator_WindowRecord_Reader* reader) {
+	return (int32_t)WindowInvestigator_WindowRecord_ReadUInt32(reader);
+}
+
+static void WindowInvestigator_WindowRecord_ReadRect(WindowInvestigator_WindowRecord_Reader* reader, WindowInvestigator_Rect* rect) {
+	rect->left = WindowInvestigator_WindowRecord_ReadInt32(reader);
+	rect->top = WindowInvestigator_WindowRecord_ReadInt32(reader);
+	rect->right = WindowInvestigator_WindowRecord_ReadInt32(reader);
+	rect->bottom = WindowInvestigator_WindowRecord_ReadInt32(reader);
+}
+
+static void WindowInvestigator_WindowRecord_ReadPoint(WindowInvestigator_WindowRecord_Reader* reader, WindowInvestigator_Point* point) {
+	point->x = WindowInvestigator_WindowRecord_ReadInt32(reader);
+	point->y = WindowInvestigator_WindowRecord_ReadInt32(reader);
+}
+
+static bool WindowInvestigator_WindowRecord_ReadBool(WindowInvestigator_WindowRecord_Reader* reader) {
+	const uint8_t value = WindowInvestigator_WindowRecord_ReadUInt8(reader);
+	if (value > 1) reader->malformed = true;
+	return value != 0;
+}
+
+static void WindowInvestigator_WindowRecord_ReadString(WindowInvestigator_WindowRecord_Reader* reader, WindowInvestigator_CapturedString* capturedString) {
+	const size_t capacity = sizeof(capturedString->string) / sizeof(*capturedString->string);
+	const uint16_t codeUnitCount = WindowInvestigator_WindowRecord_ReadUInt16(reader);
+	size_t length = 0;
+	for (uint16_t codeUnitIndex = 0; codeUnitIndex < codeUnitCount && !reader->malformed; ++codeUnitIndex) {
+		uint32_t codePoint = WindowInvestigator_WindowRecord_ReadUInt16(reader);
+#if WCHAR_MAX > 0xFFFF
+		// Unpaired surrogates are kept as is.
+		if (codePoint >= 0xD800 && codePoint < 0xDC00 && codeUnitIndex + 1 < codeUnitCount && reader->end - reader->position >= 2) {
+			const uint32_t lowSurrogate = (uint32_t)(reader->position[0] | (reader->position[1] << 8));
+			if (lowSurrogate >= 0xDC00 && lowSurrogate < 0xE000) {
+				reader->position += 2;
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+				++codeUnitIndex;
+			}
+		}
+#endif
+		if (length == capacity - 1) {
+			reader->malformed = true;
+			break;
+		}
+		capturedString->string[length++] = (wchar_t)codePoint;
+	}
+	WindowInvestigator_FinishCapturedString(capturedString, length);
+}
+
+size_t WindowInvestigator_EncodeWindowRecord(unsigned char* buffer, uint32_t fields, const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_StringPool* strings) {
+	WindowInvestigator_WindowRecord_Writer writer;
+	writer.position = buffer;
+
+	WindowInvestigator_WindowRecord_WriteUInt32(&writer, fields);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PROCESS_ID))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->processId);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_THREAD_ID))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->threadId);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		WindowInvestigator_WindowRecord_WriteString(&writer, WindowInvestigator_StringPool_Get(strings, windowInfo->className));
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->extendedStyles);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->styles);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT))
+		WindowInvestigator_WindowRecord_WriteRect(&writer, &windowInfo->windowRect);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT))
+		WindowInvestigator_WindowRecord_WriteRect(&writer, &windowInfo->clientRect);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES))
+		WindowInvestigator_WindowRecord_WriteRect(&writer, &windowInfo->clientRectInScreenCoordinates);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->placement.showCmd);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION))
+		WindowInvestigator_WindowRecord_WritePoint(&writer, &windowInfo->placement.minPosition);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION))
+		WindowInvestigator_WindowRecord_WritePoint(&writer, &windowInfo->placement.maxPosition);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION))
+		WindowInvestigator_WindowRecord_WriteRect(&writer, &windowInfo->placement.normalPosition);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		WindowInvestigator_WindowRecord_WriteString(&writer, WindowInvestigator_StringPool_Get(strings, windowInfo->text));
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->isShellManagedWindow);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->isShellFrameWindow);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_OVERPANNING))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->overpanning);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_BAND))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->band);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->hasNonRudeHWNDProperty);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->hasNonRudeAddedByRudeWindowFixerProperty);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->hasLivePreviewWindowProperty);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->hasTreatAsDesktopFullscreenProperty);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_WINDOW))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->isWindow);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED))
+		WindowInvestigator_WindowRecord_WriteUInt32(&writer, windowInfo->dwmIsCloaked);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->isIconic);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE))
+		WindowInvestigator_WindowRecord_WriteBool(&writer, windowInfo->isVisible);
+
+	return (size_t)(writer.position - buffer);
+}
+
+size_t WindowInvestigator_DecodeWindowRecord(const unsigned char* buffer, size_t size, uint32_t* fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings) {
+	WindowInvestigator_WindowRecord_Reader reader;
+	reader.position = buffer;
+	reader.end = buffer + size;
+	reader.malformed = false;
+
+	*fields = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if ((*fields & ~WindowInvestigator_WindowField_ALL) != 0) return 0;
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PROCESS_ID))
+		windowInfo->processId = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_THREAD_ID))
+		windowInfo->threadId = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME))
+		WindowInvestigator_WindowRecord_ReadString(&reader, &windowStrings->className);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES))
+		windowInfo->extendedStyles = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_STYLES))
+		windowInfo->styles = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT))
+		WindowInvestigator_WindowRecord_ReadRect(&reader, &windowInfo->windowRect);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT))
+		WindowInvestigator_WindowRecord_ReadRect(&reader, &windowInfo->clientRect);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLIENT_RECT_IN_SCREEN_COORDINATES))
+		WindowInvestigator_WindowRecord_ReadRect(&reader, &windowInfo->clientRectInScreenCoordinates);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_SHOW_CMD))
+		windowInfo->placement.showCmd = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MIN_POSITION))
+		WindowInvestigator_WindowRecord_ReadPoint(&reader, &windowInfo->placement.minPosition);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_MAX_POSITION))
+		WindowInvestigator_WindowRecord_ReadPoint(&reader, &windowInfo->placement.maxPosition);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_PLACEMENT_NORMAL_POSITION))
+		WindowInvestigator_WindowRecord_ReadRect(&reader, &windowInfo->placement.normalPosition);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT))
+		WindowInvestigator_WindowRecord_ReadString(&reader, &windowStrings->text);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW))
+		windowInfo->isShellManagedWindow = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_SHELL_FRAME_WINDOW))
+		windowInfo->isShellFrameWindow = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_OVERPANNING))
+		windowInfo->overpanning = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_BAND))
+		windowInfo->band = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY))
+		windowInfo->hasNonRudeHWNDProperty = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY))
+		windowInfo->hasNonRudeAddedByRudeWindowFixerProperty = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY))
+		windowInfo->hasLivePreviewWindowProperty = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY))
+		windowInfo->hasTreatAsDesktopFullscreenProperty = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_WINDOW))
+		windowInfo->isWindow = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_DWM_IS_CLOAKED))
+		windowInfo->dwmIsCloaked = WindowInvestigator_WindowRecord_ReadUInt32(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC))
+		windowInfo->isIconic = WindowInvestigator_WindowRecord_ReadBool(&reader);
+	if (*fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE))
+		windowInfo->isVisible = WindowInvestigator_WindowRecord_ReadBool(&reader);
+
+	if (reader.malformed) return 0;
+	return (size_t)(reader.position - buffer);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "string_pool.h"
+#include "window_info.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact binary encoding of a window snapshot, or of the subset of its fields that changed.
+//
+// A record is a little-endian uint32 bitmask of WindowInvestigator_WindowField_BIT(), followed by the value of each field
+// whose bit is set, in WindowInvestigator_WindowField order:
+//  - Process ID, thread ID, styles, extended styles, show command, band and cloaked state: uint32.
+//  - Rectangles: left, top, right, bottom as int32.
+//  - Points: x, y as int32.
+//  - Booleans: uint8, 0 or 1.
+//  - Strings: uint16 length in UTF-16 code units, followed by the UTF-16LE code units (no terminator).
+//
+// A record with every bit set is a full snapshot; it is self-contained. A record with only some bits set describes a change
+// and needs to be applied on top of the previous state of the window.
+
+// Upper bound on the size of a record. Strings are at most 1023 characters, which can take up to 2046 UTF-16 code units if
+// wchar_t is 32-bit.
+#define WindowInvestigator_WindowRecord_MAX_SIZE (4 + 7 * 4 + 4 * 16 + 2 * 8 + 10 + 2 * (2 + 2 * 2046))
+
+// Encodes the specified fields of windowInfo into buffer, which must be at least WindowInvestigator_WindowRecord_MAX_SIZE bytes.
+// Returns the size of the record.
+size_t WindowInvestigator_EncodeWindowRecord(unsigned char* buffer, uint32_t fields, const WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_StringPool* strings);
+
+// Decodes a record. Only the fields present in the record are written to windowInfo; the string ID fields are never written,
+// strings go into windowStrings instead.
+// Returns the size of the record, or 0 if the record is truncated or malformed.
+size_t WindowInvestigator_DecodeWindowRecord(const unsigned char* buffer, size_t size, uint32_t* fields, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowStrings* windowStrings);
@@ -0,0 +1,212 @@
+#include "window_table.h"
+
+#include "allocation.h"
+
+#include <string.h>
+
+static const unsigned int WindowInvestigator_WindowTable_initialBucketBits = 6;
+
+static size_t WindowInvestigator_WindowTable_GetBucketCount(const WindowInvestigator_WindowTable* table) {
+	return (size_t)1 << table->bucketBits;
+}
+
+static size_t WindowInvestigator_WindowTable_GetHomeBucket(const WindowInvestigator_WindowTable* table, uintptr_t window) {
+	// Fibonacci hashing. Window handles tend to share their low bits, so we take the high bits of the product instead.
+	return (size_t)(((uint64_t)window * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - table->bucketBits));
+}
+
+static void WindowInvestigator_WindowTable_InsertIntoIndex(WindowInvestigator_WindowTable* table, size_t slot) {
+	const size_t bucketMask = WindowInvestigator_WindowTable_GetBucketCount(table) - 1;
+	size_t bucket = WindowInvestigator_WindowTable_GetHomeBucket(table, table->slots[slot].window);
+	while (table->buckets[bucket] != WindowInvestigator_WindowTable_NO_SLOT)
+		bucket = (bucket + 1) & bucketMask;
+	table->buckets[bucket] = slot;
+}
+
+static void WindowInvestigator_WindowTable_ResizeIndex(WindowInvestigator_WindowTable* table, unsigned int bucketBits) {
+	WindowInvestigator_Free(table->buckets);
+	table->bucketBits = bucketBits;
+	const size_t bucketCount = WindowInvestigator_WindowTable_GetBucketCount(table);
+	table->buckets = WindowInvestigator_Reallocate(NULL, bucketCount, sizeof(*table->buckets));
+	for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+		table->buckets[bucket] = WindowInvestigator_WindowTable_NO_SLOT;
+
+	for (size_t zOrder = 0; zOrder < table->previousZOrderCount; ++zOrder)
+		if (table->slots[table->previousZOrder[zOrder]].visitedPass != table->pass)
+			WindowInvestigator_WindowTable_InsertIntoIndex(table, table->previousZOrder[zOrder]);
+	for (size_t zOrder = 0; zOrder < table->zOrderCount; ++zOrder)
+		WindowInvestigator_WindowTable_InsertIntoIndex(table, table->zOrder[zOrder]);
+}
+
+static void WindowInvestigator_WindowTable_RemoveFromIndex(WindowInvestigator_WindowTable* table, uintptr_t window) {
+	const size_t bucketMask = WindowInvestigator_WindowTable_GetBucketCount(table) - 1;
+	size_t bucket = WindowInvestigator_WindowTable_GetHomeBucket(table, window);
+	while (table->slots[table->buckets[bucket]].window != window)
+		bucket = (bucket + 1) & bucketMask;
+
+	// Backward shift deletion: move subsequent entries of the probe sequence into the hole, so that we don't need tombstones.
+	size_t hole = bucket;
+	for (;;) {
+		bucket = (bucket + 1) & bucketMask;
+		const size_t slot = table->buckets[bucket];
+		if (slot == WindowInvestigator_WindowTable_NO_SLOT) break;
+		const size_t homeBucket = WindowInvestigator_WindowTable_GetHomeBucket(table, table->slots[slot].window);
+		if (((bucket - homeBucket) & bucketMask) < ((bucket - hole) & bucketMask)) continue;
+		table->buckets[hole] = slot;
+		hole = bucket;
+	}
+	table->buckets[hole] = WindowInvestigator_WindowTable_NO_SLOT;
+}
+
+static size_t WindowInvestigator_WindowTable_Insert(WindowInvestigator_WindowTable* table, uintptr_t window) {
+	if ((table->windowCount + 1) * 2 > WindowInvestigator_WindowTable_GetBucketCount(table))
+		WindowInvestigator_WindowTable_ResizeIndex(table, table->bucketBits + 1);
+
+	size_t slot = table->firstFreeSlot;
+	if (slot != WindowInvestigator_WindowTable_NO_SLOT)
+		table->firstFreeSlot = table->slots[slot].nextFreeSlot;
+	else {
+		if (table->slotCount == table->slotCapacity) {
+			table->slotCapacity = table->slotCapacity == 0 ? 32 : table->slotCapacity * 2;
+			table->slots = WindowInvestigator_Reallocate(table->slots, table->slotCapacity, sizeof(*table->slots));
+			if (table->valueSize != 0) table->values = WindowInvestigator_Reallocate(table->values, table->slotCapacity, table->valueSize);
+			table->zOrder = WindowInvestigator_Reallocate(table->zOrder, table->slotCapacity, sizeof(*table->zOrder));
+			table->previousZOrder = WindowInvestigator_Reallocate(table->previousZOrder, table->slotCapacity, sizeof(*table->previousZOrder));
+			table->zOrderDiffInput = WindowInvestigator_Reallocate(table->zOrderDiffInput, table->slotCapacity, sizeof(*table->zOrderDiffInput));
+			table->zOrderDiffMoved = WindowInvestigator_Reallocate(table->zOrderDiffMoved, table->slotCapacity, sizeof(*table->zOrderDiffMoved));
+		}
+		slot = table->slotCount++;
+		table->slots[slot].generation = 1;
+	}
+
+	table->slots[slot].window = window;
+	table->slots[slot].visitedPass = table->pass - 1;
+	table->slots[slot].zOrder = WindowInvestigator_ZOrderDiff_NEW_WINDOW;
+	table->slots[slot].nextFreeSlot = WindowInvestigator_WindowTable_NO_SLOT;
+	++table->windowCount;
+	WindowInvestigator_WindowTable_InsertIntoIndex(table, slot);
+	return slot;
+}
+
+static void WindowInvestigator_WindowTable_Remove(WindowInvestigator_WindowTable* table, size_t slot) {
+	WindowInvestigator_WindowTable_RemoveFromIndex(table, table->slots[slot].window);
+	// Invalidates every handle to the window right away, rather than when the slot is reused.
+	if (++table->slots[slot].generation == 0) table->slots[slot].generation = 1;
+	table->slots[slot].nextFreeSlot = table->firstFreeSlot;
+	table->firstFreeSlot = slot;
+	--table->windowCount;
+}
+
+void WindowInvestigator_WindowTable_Init(WindowInvestigator_WindowTable* table, size_t valueSize) {
+	memset(table, 0, sizeof(*table));
+	table->valueSize = valueSize;
+	table->firstFreeSlot = WindowInvestigator_WindowTable_NO_SLOT;
+	WindowInvestigator_ZOrderDiff_Init(&table->zOrderDiff);
+	WindowInvestigator_WindowTable_ResizeIndex(table, WindowInvestigator_WindowTable_initialBucketBits);
+}
+
+void WindowInvestigator_WindowTable_Destroy(WindowInvestigator_WindowTable* table) {
+	WindowInvestigator_Free(table->slots);
+	WindowInvestigator_Free(table->values);
+	WindowInvestigator_Free(table->buckets);
+	WindowInvestigator_Free(table->zOrder);
+	WindowInvestigator_Free(table->previousZOrder);
+	WindowInvestigator_Free(table->zOrderDiffInput);
+	WindowInvestigator_Free(table->zOrderDiffMoved);
+	WindowInvestigator_ZOrderDiff_Destroy(&table->zOrderDiff);
+	memset(table, 0, sizeof(*table));
+}
+
+size_t WindowInvestigator_WindowTable_Find(const WindowInvestigator_WindowTable* table, uintptr_t window) {
+	const size_t bucketMask = WindowInvestigator_WindowTable_GetBucketCount(table) - 1;
+	for (size_t bucket = WindowInvestigator_WindowTable_GetHomeBucket(table, window);; bucket = (bucket + 1) & bucketMask) {
+		const size_t slot = table->buckets[bucket];
+		if (slot == WindowInvestigator_WindowTable_NO_SLOT || table->slots[slot].window == window) return slot;
+	}
+}
+
+uintptr_t WindowInvestigator_WindowTable_GetWindow(const WindowInvestigator_WindowTable* table, size_t slot) {
+	return table->slots[slot].window;
+}
+
+void* WindowInvestigator_WindowTable_GetValue(const WindowInvestigator_WindowTable* table, size_t slot) {
+	return table->values + slot * table->valueSize;
+}
+
+uint32_t WindowInvestigator_WindowTable_GetGeneration(const WindowInvestigator_WindowTable* table, size_t slot) {
+	return table->slots[slot].generation;
+}
+
+WindowInvestigator_WindowTable_Handle WindowInvestigator_WindowTable_GetHandle(const WindowInvestigator_WindowTable* table, size_t slot) {
+	WindowInvestigator_WindowTable_Handle handle;
+	handle.slot = slot;
+	handle.generation = table->slots[slot].generation;
+	return handle;
+}
+
+size_t WindowInvestigator_WindowTable_Resolve(const WindowInvestigator_WindowTable* table, WindowInvestigator_WindowTable_Handle handle) {
+	// Free slots have moved on to the next generation already, so they never match.
+	return handle.slot < table->slotCount && table->slots[handle.slot].generation == handle.generation ? handle.slot : WindowInvestigator_WindowTable_NO_SLOT;
+}
+
+void WindowInvestigator_WindowTable_BeginPass(WindowInvestigator_WindowTable* table) {
+	++table->pass;
+	table->zOrderCount = 0;
+}
+
+size_t WindowInvestigator_WindowTable_Visit(WindowInvestigator_WindowTable* table, uintptr_t window, WindowInvestigator_WindowTable_VisitResult* result) {
+	size_t slot = WindowInvestigator_WindowTable_Find(table, window);
+	if (slot == WindowInvestigator_WindowTable_NO_SLOT) {
+		slot = WindowInvestigator_WindowTable_Insert(table, window);
+		*result = WindowInvestigator_WindowTable_NEW_WINDOW;
+	}
+	else if (table->slots[slot].visitedPass == table->pass) {
+		*result = WindowInvestigator_WindowTable_ALREADY_VISITED;
+		return slot;
+	}
+	else *result = WindowInvestigator_WindowTable_EXISTING_WINDOW;
+
+	table->slots[slot].visitedPass = table->pass;
+	table->zOrder[table->zOrderCount++] = slot;
+	return slot;
+}
+
+void WindowInvestigator_WindowTable_EndPass(WindowInvestigator_WindowTable* table, const WindowInvestigator_WindowTable_PassCallbacks* callbacks) {
+	for (size_t zOrder = 0; zOrder < table->previousZOrderCount; ++zOrder) {
+		const size_t slot = table->previousZOrder[zOrder];
+		if (table->slots[slot].visitedPass == table->pass) continue;
+		if (callbacks->onWindowGone != NULL) callbacks->onWindowGone(callbacks->context, table->slots[slot].window, WindowInvestigator_WindowTable_GetValue(table, slot));
+		WindowInvestigator_WindowTable_Remove(table, slot);
+	}
+
+	if (callbacks->onZOrderChanged != NULL) {
+		for (size_t zOrder = 0; zOrder < table->zOrderCount; ++zOrder)
+			table->zOrderDiffInput[zOrder] = table->slots[table->zOrder[zOrder]].zOrder;
+		if (WindowInvestigator_ZOrderDiff_Compute(&table->zOrderDiff, table->zOrderDiffInput, table->zOrderCount, table->zOrderDiffMoved) > 0)
+			for (size_t zOrder = 0; zOrder < table->zOrderCount; ++zOrder) {
+				if (!table->zOrderDiffMoved[zOrder]) continue;
+				const size_t slot = table->zOrder[zOrder];
+				callbacks->onZOrderChanged(callbacks->context, table->slots[slot].window, WindowInvestigator_WindowTable_GetValue(table, slot), table->slots[slot].zOrder, zOrder);
+			}
+	}
+	for (size_t zOrder = 0; zOrder < table->zOrderCount; ++zOrder)
+		table->slots[table->zOrder[zOrder]].zOrder = zOrder;
+
+	size_t* const previousZOrder = table->previousZOrder;
+	table->previousZOrder = table->zOrder;
+	table->previousZOrderCount = table->zOrderCount;
+	table->zOrder = previousZOrder;
+	table->zOrderCount = 0;
+}
+
+size_t WindowInvestigator_WindowTable_GetZOrderCount(const WindowInvestigator_WindowTable* table) {
+	return table->previousZOrderCount;
+}
+
+size_t WindowInvestigator_WindowTable_GetZOrderSlot(const WindowInvestigator_WindowTable* table, size_t zOrder) {
+	return table->previousZOrder[zOrder];
+}
+
+size_t WindowInvestigator_WindowTable_GetZOrder(const WindowInvestigator_WindowTable* table, size_t slot) {
+	return table->slots[slot].zOrder;
+}
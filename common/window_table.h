@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "zorder_diff.h"
+
+// Table of tracked top-level windows, keyed by window handle.
+//
+// Values live in contiguous slots whose index stays stable for as long as the window is tracked. Window handles are mapped to
+// slots through an open-addressing hash index, so that lookup, insertion and removal are O(1) regardless of the number of
+// windows. Z-order is kept as a separate ordered view over the slots, which is rebuilt on every pass.
+//
+// Slots are recycled once their window is gone, and window handles can be recycled too, so neither identifies a window on its
+// own for longer than a pass. Every slot has a generation that changes whenever its window is removed; state that is kept per
+// slot outside the table (or across passes) should be tagged with the generation, or held as a
+// WindowInvestigator_WindowTable_Handle, so that it cannot be mistaken for state about a later window.
+//
+// A pass mirrors a single enumeration of the top-level windows: call WindowInvestigator_WindowTable_BeginPass(), then
+// WindowInvestigator_WindowTable_Visit() for each window in Z-order, then WindowInvestigator_WindowTable_EndPass() to drop
+// the windows that were not visited and report the windows that moved in the Z-order.
+
+#define WindowInvestigator_WindowTable_NO_SLOT SIZE_MAX
+
+typedef enum {
+	// The window was there on the previous pass.
+	WindowInvestigator_WindowTable_EXISTING_WINDOW,
+	// The window was not there on the previous pass. Its value is uninitialized.
+	WindowInvestigator_WindowTable_NEW_WINDOW,
+	// The window was already visited during this pass. The Z-order view is left untouched.
+	WindowInvestigator_WindowTable_ALREADY_VISITED,
+} WindowInvestigator_WindowTable_VisitResult;
+
+typedef struct {
+	uintptr_t window;
+	// Never 0, so that 0 can be used to mean "no window".
+	uint32_t generation;
+	uint32_t visitedPass;
+	// Index in the Z-order view of the last completed pass, or WindowInvestigator_ZOrderDiff_NEW_WINDOW.
+	size_t zOrder;
+	size_t nextFreeSlot;
+} WindowInvestigator_WindowTable_Slot;
+
+typedef struct {
+	size_t slot;
+	uint32_t generation;
+} WindowInvestigator_WindowTable_Handle;
+
+typedef struct {
+	void (*onWindowGone)(void* context, uintptr_t window, void* value);
+	void (*onZOrderChanged)(void* context, uintptr_t window, void* value, size_t previousZOrder, size_t zOrder);
+	void* context;
+} WindowInvestigator_WindowTable_PassCallbacks;
+
+typedef struct {
+	size_t valueSize;
+
+	WindowInvestigator_WindowTable_Slot* slots;
+	unsigned char* values;
+	size_t slotCount;
+	size_t slotCapacity;
+	size_t firstFreeSlot;
+	size_t windowCount;
+
+	// Linear probing. Each bucket holds a slot index, or WindowInvestigator_WindowTable_NO_SLOT if empty.
+	size_t* buckets;
+	unsigned int bucketBits;
+
+	uint32_t pass;
+	size_t* zOrder;
+	size_t zOrderCount;
+	size_t* previousZOrder;
+	size_t previousZOrderCount;
+
+	WindowInvestigator_ZOrderDiff zOrderDiff;
+	size_t* zOrderDiffInput;
+	bool* zOrderDiffMoved;
+} WindowInvestigator_WindowTable;
+
+// valueSize can be 0, in which case the table only keeps track of the windows themselves.
+void WindowInvestigator_WindowTable_Init(WindowInvestigator_WindowTable* table, size_t valueSize);
+void WindowInvestigator_WindowTable_Destroy(WindowInvestigator_WindowTable* table);
+
+size_t WindowInvestigator_WindowTable_Find(const WindowInvestigator_WindowTable* table, uintptr_t window);
+uintptr_t WindowInvestigator_WindowTable_GetWindow(const WindowInvestigator_WindowTable* table, size_t slot);
+void* WindowInvestigator_WindowTable_GetValue(const WindowInvestigator_WindowTable* table, size_t slot);
+uint32_t WindowInvestigator_WindowTable_GetGeneration(const WindowInvestigator_WindowTable* table, size_t slot);
+
+WindowInvestigator_WindowTable_Handle WindowInvestigator_WindowTable_GetHandle(const WindowInvestigator_WindowTable* table, size_t slot);
+// Returns the slot of the window the handle was taken from, or WindowInvestigator_WindowTable_NO_SLOT if that window is gone
+// (even if its slot, or its window handle, is now used by another window). A generation only wraps around after 2^32 - 1
+// windows went through the same slot.
+size_t WindowInvestigator_WindowTable_Resolve(const WindowInvestigator_WindowTable* table, WindowInvestigator_WindowTable_Handle handle);
+
+void WindowInvestigator_WindowTable_BeginPass(WindowInvestigator_WindowTable* table);
+size_t WindowInvestigator_WindowTable_Visit(WindowInvestigator_WindowTable* table, uintptr_t window, WindowInvestigator_WindowTable_VisitResult* result);
+// Calls onWindowGone for every window that was not visited during the pass, in their previous Z-order, then removes them.
+// Then calls onZOrderChanged, in the new Z-order, for the minimal set of windows that moved (see zorder_diff.h). Either
+// callback can be NULL; if onZOrderChanged is, the windows that moved are not computed at all.
+void WindowInvestigator_WindowTable_EndPass(WindowInvestigator_WindowTable* table, const WindowInvestigator_WindowTable_PassCallbacks* callbacks);
+
+// Z-order view as of the last completed pass, frontmost window first.
+size_t WindowInvestigator_WindowTable_GetZOrderCount(const WindowInvestigator_WindowTable* table);
+size_t WindowInvestigator_WindowTable_GetZOrderSlot(const WindowInvestigator_WindowTable* table, size_t zOrder);
+// Inverse of WindowInvestigator_WindowTable_GetZOrderSlot(). Returns WindowInvestigator_ZOrderDiff_NEW_WINDOW for windows that
+// were added during the current pass.
+size_t WindowInvestigator_WindowTable_GetZOrder(const WindowInvestigator_WindowTable* table, size_t slot);
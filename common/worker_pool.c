@@ -0,0 +1,170 @@
+#include "worker_pool.h"
+
+#include "allocation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool WindowInvestigator_Worker_TakeOwnBatch(WindowInvestigator_Worker* worker, size_t* batch) {
+	WindowInvestigator_Mutex_Lock(&worker->mutex);
+	const bool found = worker->nextBatch < worker->endBatch;
+	if (found) *batch = worker->nextBatch++;
+	WindowInvestigator_Mutex_Unlock(&worker->mutex);
+	return found;
+}
+
+static bool WindowInvestigator_Worker_StealBatches(WindowInvestigator_Worker* worker) {
+	WindowInvestigator_WorkerPool* const pool = worker->pool;
+	for (size_t offset = 1; offset < pool->workerCount; ++offset) {
+		WindowInvestigator_Worker* const victim = &pool->workers[(worker->index + offset) % pool->workerCount];
+
+		WindowInvestigator_Mutex_Lock(&victim->mutex);
+		const size_t available = victim->endBatch - victim->nextBatch;
+		const size_t stolenCount = (available + 1) / 2;
+		victim->endBatch -= stolenCount;
+		const size_t firstStolenBatch = victim->endBatch;
+		WindowInvestigator_Mutex_Unlock(&victim->mutex);
+
+		if (stolenCount == 0) continue;
+
+		// Other workers might try to steal from our (empty) range in the meantime, but that's harmless.
+		WindowInvestigator_Mutex_Lock(&worker->mutex);
+		worker->nextBatch = firstStolenBatch;
+		worker->endBatch = firstStolenBatch + stolenCount;
+		WindowInvestigator_Mutex_Unlock(&worker->mutex);
+		worker->batchesStolen += stolenCount;
+		return true;
+	}
+	return false;
+}
+
+static void WindowInvestigator_WorkerPool_FinishBatch(WindowInvestigator_WorkerPool* pool) {
+	WindowInvestigator_Mutex_Lock(&pool->mutex);
+	if (--pool->remainingBatches == 0) {
+		WindowInvestigator_ConditionVariable_WakeAll(&pool->workDone);
+		if (pool->onDone != NULL) pool->onDone(pool->onDoneContext);
+	}
+	WindowInvestigator_Mutex_Unlock(&pool->mutex);
+}
+
+static void WindowInvestigator_WorkerPool_RunBatch(WindowInvestigator_WorkerPool* pool, size_t workerIndex, size_t batch) {
+	// The job parameters are written before the batches are queued, and we got the batch from a queue, so they are up to date.
+	const size_t firstItem = batch * pool->batchSize;
+	const size_t remainingItems = pool->itemCount - firstItem;
+	pool->function(pool->context, workerIndex, firstItem, firstItem + (remainingItems < pool->batchSize ? remainingItems : pool->batchSize));
+}
+
+static void WindowInvestigator_Worker_Run(void* context) {
+	WindowInvestigator_Worker* const worker = context;
+	WindowInvestigator_WorkerPool* const pool = worker->pool;
+
+	uint64_t generation = 0;
+	for (;;) {
+		WindowInvestigator_Mutex_Lock(&pool->mutex);
+		while (pool->generation == generation && !pool->stopping)
+			WindowInvestigator_ConditionVariable_Wait(&pool->workAvailable, &pool->mutex);
+		generation = pool->generation;
+		const bool stopping = pool->stopping;
+		WindowInvestigator_Mutex_Unlock(&pool->mutex);
+		if (stopping) return;
+
+		for (;;) {
+			size_t batch;
+			if (!WindowInvestigator_Worker_TakeOwnBatch(worker, &batch)) {
+				if (!WindowInvestigator_Worker_StealBatches(worker)) break;
+				continue;
+			}
+			WindowInvestigator_WorkerPool_RunBatch(pool, worker->index, batch);
+			WindowInvestigator_WorkerPool_FinishBatch(pool);
+		}
+	}
+}
+
+void WindowInvestigator_WorkerPool_Init(WindowInvestigator_WorkerPool* pool, size_t workerCount) {
+	memset(pool, 0, sizeof(*pool));
+	WindowInvestigator_Mutex_Init(&pool->mutex);
+	WindowInvestigator_ConditionVariable_Init(&pool->workAvailable);
+	WindowInvestigator_ConditionVariable_Init(&pool->workDone);
+
+	pool->workerCount = workerCount;
+	if (workerCount == 0) return;
+	pool->workers = WindowInvestigator_Reallocate(NULL, workerCount, sizeof(*pool->workers));
+	memset(pool->workers, 0, workerCount * sizeof(*pool->workers));
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex) {
+		WindowInvestigator_Worker* const worker = &pool->workers[workerIndex];
+		worker->pool = pool;
+		worker->index = workerIndex;
+		WindowInvestigator_Mutex_Init(&worker->mutex);
+	}
+	for (size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+		WindowInvestigator_Thread_Start(&pool->workers[workerIndex].thread, WindowInvestigator_Worker_Run, &pool->workers[workerIndex]);
+}
+
+void WindowInvestigator_WorkerPool_Destroy(WindowInvestigator_WorkerPool* pool) {
+	WindowInvestigator_WorkerPool_Wait(pool);
+
+	WindowInvestigator_Mutex_Lock(&pool->mutex);
+	pool->stopping = true;
+	WindowInvestigator_ConditionVariable_WakeAll(&pool->workAvailable);
+	WindowInvestigator_Mutex_Unlock(&pool->mutex);
+
+	for (size_t workerIndex = 0; workerIndex < pool->workerCount; ++workerIndex) {
+		WindowInvestigator_Thread_Join(&pool->workers[workerIndex].thread);
+		WindowInvestigator_Mutex_Destroy(&pool->workers[workerIndex].mutex);
+	}
+	WindowInvestigator_Free(pool->workers);
+
+	WindowInvestigator_ConditionVariable_Destroy(&pool->workDone);
+	WindowInvestigator_ConditionVariable_Destroy(&pool->workAvailable);
+	WindowInvestigator_Mutex_Destroy(&pool->mutex);
+}
+
+void WindowInvestigator_WorkerPool_Submit(WindowInvestigator_WorkerPool* pool, size_t itemCount, size_t batchSize, WindowInvestigator_WorkerPool_Function function, void* context, void (*onDone)(void* context), void* onDoneContext) {
+	if (batchSize == 0) abort();
+	const size_t batchCount = (itemCount + batchSize - 1) / batchSize;
+
+	WindowInvestigator_Mutex_Lock(&pool->mutex);
+	if (pool->remainingBatches != 0) abort();
+	pool->function = function;
+	pool->context = context;
+	pool->itemCount = itemCount;
+	pool->batchSize = batchSize;
+	pool->onDone = onDone;
+	pool->onDoneContext = onDoneContext;
+	if (batchCount == 0 || pool->workerCount == 0) {
+		WindowInvestigator_Mutex_Unlock(&pool->mutex);
+		for (size_t batch = 0; batch < batchCount; ++batch)
+			WindowInvestigator_WorkerPool_RunBatch(pool, 0, batch);
+		if (onDone != NULL) onDone(onDoneContext);
+		return;
+	}
+	pool->remainingBatches = batchCount;
+	WindowInvestigator_Mutex_Unlock(&pool->mutex);
+
+	for (size_t workerIndex = 0; workerIndex < pool->workerCount; ++workerIndex) {
+		WindowInvestigator_Worker* const worker = &pool->workers[workerIndex];
+		WindowInvestigator_Mutex_Lock(&worker->mutex);
+		worker->nextBatch = workerIndex * batchCount / pool->workerCount;
+		worker->endBatch = (workerIndex + 1) * batchCount / pool->workerCount;
+		WindowInvestigator_Mutex_Unlock(&worker->mutex);
+	}
+
+	WindowInvestigator_Mutex_Lock(&pool->mutex);
+	++pool->generation;
+	WindowInvestigator_ConditionVariable_WakeAll(&pool->workAvailable);
+	WindowInvestigator_Mutex_Unlock(&pool->mutex);
+}
+
+void WindowInvestigator_WorkerPool_Wait(WindowInvestigator_WorkerPool* pool) {
+	WindowInvestigator_Mutex_Lock(&pool->mutex);
+	while (pool->remainingBatches != 0)
+		WindowInvestigator_ConditionVariable_Wait(&pool->workDone, &pool->mutex);
+	WindowInvestigator_Mutex_Unlock(&pool->mutex);
+}
+
+uint64_t WindowInvestigator_WorkerPool_GetBatchesStolen(const WindowInvestigator_WorkerPool* pool) {
+	uint64_t batchesStolen = 0;
+	for (size_t workerIndex = 0; workerIndex < pool->workerCount; ++workerIndex)
+		batchesStolen += pool->workers[workerIndex].batchesStolen;
+	return batchesStolen;
+}
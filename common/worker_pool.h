@@ -0,0 +1,65 @@
+#pragma once
+
+#include "thread.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed pool of worker threads that process a range of items in batches, with work stealing.
+//
+// When a job is submitted, its batches are split into equal contiguous ranges, one per worker. Each worker takes batches from
+// the front of its own range; once that is exhausted, it steals half of the remaining batches from the back of the range of
+// another worker. This keeps all workers busy even when some items take much longer than others, e.g. because the window
+// they refer to is slow to respond.
+
+// Processes items [firstItem, endItem). workerIndex identifies the calling worker, and can be used to index per-worker
+// scratch space.
+typedef void (*WindowInvestigator_WorkerPool_Function)(void* context, size_t workerIndex, size_t firstItem, size_t endItem);
+
+struct WindowInvestigator_WorkerPool;
+
+typedef struct {
+	struct WindowInvestigator_WorkerPool* pool;
+	size_t index;
+	WindowInvestigator_Thread thread;
+	WindowInvestigator_Mutex mutex;
+	// Batches [nextBatch, endBatch) are queued on this worker.
+	size_t nextBatch;
+	size_t endBatch;
+	uint64_t batchesStolen;
+} WindowInvestigator_Worker;
+
+typedef struct WindowInvestigator_WorkerPool {
+	WindowInvestigator_Worker* workers;
+	size_t workerCount;
+
+	WindowInvestigator_Mutex mutex;
+	WindowInvestigator_ConditionVariable workAvailable;
+	WindowInvestigator_ConditionVariable workDone;
+	uint64_t generation;
+	bool stopping;
+
+	WindowInvestigator_WorkerPool_Function function;
+	void* context;
+	size_t itemCount;
+	size_t batchSize;
+	size_t remainingBatches;
+	void (*onDone)(void* context);
+	void* onDoneContext;
+} WindowInvestigator_WorkerPool;
+
+// If workerCount is 0, no threads are created, and jobs are run on the thread that submits them.
+void WindowInvestigator_WorkerPool_Init(WindowInvestigator_WorkerPool* pool, size_t workerCount);
+void WindowInvestigator_WorkerPool_Destroy(WindowInvestigator_WorkerPool* pool);
+
+// Starts processing itemCount items, batchSize items at a time. The previous job must have been waited for.
+//
+// If onDone is not NULL, it is called once all items have been processed, on whatever thread processed the last batch. It is
+// called with the pool lock held, so it must be quick and must not call back into the pool.
+void WindowInvestigator_WorkerPool_Submit(WindowInvestigator_WorkerPool* pool, size_t itemCount, size_t batchSize, WindowInvestigator_WorkerPool_Function function, void* context, void (*onDone)(void* context), void* onDoneContext);
+// Blocks until all the items of the current job have been processed.
+void WindowInvestigator_WorkerPool_Wait(WindowInvestigator_WorkerPool* pool);
+
+// Total number of batches that were stolen so far. Must not be called while a job is running.
+uint64_t WindowInvestigator_WorkerPool_GetBatchesStolen(const WindowInvestigator_WorkerPool* pool);
@@ -0,0 +1,66 @@
+#include "zorder_diff.h"
+
+#include "allocation.h"
+
+#include <string.h>
+
+#define WindowInvestigator_ZOrderDiff_NO_PREDECESSOR SIZE_MAX
+
+static void WindowInvestigator_ZOrderDiff_Reserve(WindowInvestigator_ZOrderDiff* diff, size_t count) {
+	if (count <= diff->capacity) return;
+
+	size_t capacity = diff->capacity == 0 ? 32 : diff->capacity;
+	while (capacity < count) capacity *= 2;
+
+	WindowInvestigator_Free(diff->tails);
+	WindowInvestigator_Free(diff->predecessors);
+	diff->tails = WindowInvestigator_Reallocate(NULL, capacity, sizeof(*diff->tails));
+	diff->predecessors = WindowInvestigator_Reallocate(NULL, capacity, sizeof(*diff->predecessors));
+	diff->capacity = capacity;
+}
+
+void WindowInvestigator_ZOrderDiff_Init(WindowInvestigator_ZOrderDiff* diff) {
+	memset(diff, 0, sizeof(*diff));
+}
+
+void WindowInvestigator_ZOrderDiff_Destroy(WindowInvestigator_ZOrderDiff* diff) {
+	WindowInvestigator_Free(diff->tails);
+	WindowInvestigator_Free(diff->predecessors);
+	memset(diff, 0, sizeof(*diff));
+}
+
+size_t WindowInvestigator_ZOrderDiff_Compute(WindowInvestigator_ZOrderDiff* diff, const size_t* previousZOrders, size_t count, bool* moved) {
+	WindowInvestigator_ZOrderDiff_Reserve(diff, count);
+
+	// Patience sorting: tails[k] is the index of the window that ends the increasing subsequence of length k + 1 with the
+	// smallest possible previous Z-order index.
+	size_t length = 0;
+	for (size_t index = 0; index < count; ++index) {
+		const size_t previousZOrder = previousZOrders[index];
+		if (previousZOrder == WindowInvestigator_ZOrderDiff_NEW_WINDOW) continue;
+
+		size_t low = 0;
+		size_t high = length;
+		while (low < high) {
+			const size_t middle = low + (high - low) / 2;
+			if (previousZOrders[diff->tails[middle]] < previousZOrder) low = middle + 1;
+			else high = middle;
+		}
+
+		diff->predecessors[index] = low > 0 ? diff->tails[low - 1] : WindowInvestigator_ZOrderDiff_NO_PREDECESSOR;
+		diff->tails[low] = index;
+		if (low == length) ++length;
+	}
+
+	size_t movedCount = 0;
+	for (size_t index = 0; index < count; ++index) {
+		moved[index] = previousZOrders[index] != WindowInvestigator_ZOrderDiff_NEW_WINDOW;
+		if (moved[index]) ++movedCount;
+	}
+	if (length > 0)
+		for (size_t index = diff->tails[length - 1]; index != WindowInvestigator_ZOrderDiff_NO_PREDECESSOR; index = diff->predecessors[index]) {
+			moved[index] = false;
+			--movedCount;
+		}
+	return movedCount;
+}
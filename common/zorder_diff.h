@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Computes the minimal set of windows that need to be moved to go from one Z-order to another.
+//
+// The windows that did not move are the longest subsequence of the new Z-order whose previous Z-order indices are increasing;
+// every other window that was already there must have moved. For example, if a single window is brought to the front, only
+// that window is reported as moved, even though the index of every window that was in front of it changed.
+
+#define WindowInvestigator_ZOrderDiff_NEW_WINDOW SIZE_MAX
+
+typedef struct {
+	size_t* tails;
+	size_t* predecessors;
+	size_t capacity;
+} WindowInvestigator_ZOrderDiff;
+
+void WindowInvestigator_ZOrderDiff_Init(WindowInvestigator_ZOrderDiff* diff);
+void WindowInvestigator_ZOrderDiff_Destroy(WindowInvestigator_ZOrderDiff* diff);
+
+// previousZOrders[i] is the previous Z-order index of the window that is now at index i, or
+// WindowInvestigator_ZOrderDiff_NEW_WINDOW if the window was not there before. Previous indices must be distinct.
+// Sets moved[i] to whether the window at index i moved. New windows are never considered to have moved.
+// Returns the number of windows that moved. Runs in O(n log n).
+size_t WindowInvestigator_ZOrderDiff_Compute(WindowInvestigator_ZOrderDiff* diff, const size_t* previousZOrders, size_t count, bool* moved);
@@ -0,0 +1,284 @@
+#include "../common/delay_profile.h"
+
+#include "test.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Checks delay profile parsing (including the line reported for malformed profiles), which rule applies to a message (at,
+// then burst, then delay), that resetting the profile replays the same delays, and that the random delays follow their
+// distributions.
+
+#define DelayProfileTest_WM_MOVE 0x0003
+#define DelayProfileTest_WM_SIZE 0x0005
+#define DelayProfileTest_WM_WINDOWPOSCHANGING 0x0046
+#define DelayProfileTest_WM_WINDOWPOSCHANGED 0x0047
+#define DelayProfileTest_SAMPLE_COUNT 200000
+
+static void DelayProfileTest_Parse(WindowInvestigator_DelayProfile* profile, const char* text) {
+	size_t errorLine = 0;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DelayProfile_Parse(profile, text, &errorLine));
+}
+
+static void DelayProfileTest_CheckParse(void) {
+	WindowInvestigator_DelayProfile profile;
+	WindowInvestigator_DelayProfile_Init(&profile);
+	DelayProfileTest_Parse(&profile,
+		"# Comment\r\n"
+		"\n"
+		"seed 0x2A\n"
+		"  delay\t*  fixed 1.5   # Trailing comment\n"
+		"burst 100 20 wm_windowposchanging,0x47,70 uniform 2 3 max 2.5\r\n"
+		"at 1000 WM_SIZE normal -1 0.5\n"
+		"delay 5 lognormal 4 0.25");
+	WindowInvestigator_Test_CHECK(profile.seed == 42);
+	WindowInvestigator_Test_CHECK(profile.ruleCount == 4);
+
+	const WindowInvestigator_DelayRule* rule = &profile.rules[0];
+	WindowInvestigator_Test_CHECK(rule->kind == WindowInvestigator_DelayRuleKind_DELAY && rule->line == 4 && rule->messageCount == 0);
+	WindowInvestigator_Test_CHECK(rule->distribution == WindowInvestigator_DelayDistribution_FIXED && rule->parameters[0] == 1.5e6);
+	WindowInvestigator_Test_CHECK(rule->maximumNanoseconds == UINT64_MAX);
+
+	rule = &profile.rules[1];
+	WindowInvestigator_Test_CHECK(rule->kind == WindowInvestigator_DelayRuleKind_BURST && rule->line == 5);
+	WindowInvestigator_Test_CHECK(rule->burstPeriodNanoseconds == 100000000 && rule->burstDurationNanoseconds == 20000000);
+	WindowInvestigator_Test_CHECK(rule->messageCount == 3 && rule->messages[0] == DelayProfileTest_WM_WINDOWPOSCHANGING && rule->messages[1] == DelayProfileTest_WM_WINDOWPOSCHANGED && rule->messages[2] == 70);
+	WindowInvestigator_Test_CHECK(rule->distribution == WindowInvestigator_DelayDistribution_UNIFORM && rule->parameters[0] == 2e6 && rule->parameters[1] == 3e6);
+	WindowInvestigator_Test_CHECK(rule->maximumNanoseconds == 2500000);
+
+	rule = &profile.rules[2];
+	WindowInvestigator_Test_CHECK(rule->kind == WindowInvestigator_DelayRuleKind_AT && rule->line == 6 && rule->timeNanoseconds == 1000000000);
+	WindowInvestigator_Test_CHECK(rule->messageCount == 1 && rule->messages[0] == DelayProfileTest_WM_SIZE);
+	WindowInvestigator_Test_CHECK(rule->distribution == WindowInvestigator_DelayDistribution_NORMAL && rule->parameters[0] == -1e6 && rule->parameters[1] == 0.5e6);
+
+	rule = &profile.rules[3];
+	WindowInvestigator_Test_CHECK(rule->kind == WindowInvestigator_DelayRuleKind_DELAY && rule->line == 7);
+	WindowInvestigator_Test_CHECK(rule->messageCount == 1 && rule->messages[0] == DelayProfileTest_WM_SIZE);
+	WindowInvestigator_Test_CHECK(rule->distribution == WindowInvestigator_DelayDistribution_LOG_NORMAL && rule->parameters[0] == 4e6 && rule->parameters[1] == 0.25);
+
+	WindowInvestigator_Test_CHECK(strcmp(WindowInvestigator_DelayProfile_GetMessageName(DelayProfileTest_WM_WINDOWPOSCHANGING), "WM_WINDOWPOSCHANGING") == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DelayProfile_GetMessageName(0x7FFF) == NULL);
+
+	// An empty profile delays nothing.
+	DelayProfileTest_Parse(&profile, "");
+	WindowInvestigator_Test_CHECK(profile.ruleCount == 0 && profile.seed == 1);
+	uint64_t delay = 1;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DelayProfile_GetDelay(&profile, DelayProfileTest_WM_SIZE, 0, &delay) == NULL && delay == 0);
+
+	WindowInvestigator_DelayProfile_Destroy(&profile);
+}
+
+static void DelayProfileTest_CheckErrors(void) {
+	static const struct {
+		const char* text;
+		size_t line;
+	} errors[] = {
+		{ "frobnicate * fixed 1", 1 },
+		{ "delay * fixed 1\n\ndelay *", 3 },
+		{ "delay * fixed", 1 },
+		{ "delay * fixed -1", 1 },
+		{ "delay * fixed 1ms", 1 },
+		{ "delay * fixed nan", 1 },
+		{ "delay * fixed 1e30", 1 },
+		{ "delay * fixed 1 extra", 1 },
+		{ "delay * fixed 1 max", 1 },
+		{ "delay * fixed 1 max 2 extra", 1 },
+		{ "delay * uniform 3 2", 1 },
+		{ "delay * normal 1 -1", 1 },
+		{ "delay * lognormal 1 -0.5", 1 },
+		{ "delay * gamma 1 2", 1 },
+		{ "delay WM_BOGUS fixed 1", 1 },
+		{ "delay WM_SIZE,,WM_MOVE fixed 1", 1 },
+		{ "delay 0x100000000 fixed 1", 1 },
+		{ "burst 0 0 * fixed 1", 1 },
+		{ "burst 10 20 * fixed 1", 1 },
+		{ "burst 10 * fixed 1", 1 },
+		{ "at -1 * fixed 1", 1 },
+		{ "# Comment\nseed\n", 2 },
+		{ "seed x", 1 },
+		{ "seed 99999999999999999999999", 1 },
+		{ "seed 1 2", 1 },
+	};
+
+	WindowInvestigator_DelayProfile profile;
+	WindowInvestigator_DelayProfile_Init(&profile);
+	for (size_t index = 0; index < sizeof(errors) / sizeof(*errors); ++index) {
+		DelayProfileTest_Parse(&profile, "seed 5\ndelay * fixed 1");
+		size_t errorLine = 0;
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_DelayProfile_Parse(&profile, errors[index].text, &errorLine));
+		WindowInvestigator_Test_CHECK(errorLine == errors[index].line);
+		// The profile is left empty.
+		WindowInvestigator_Test_CHECK(profile.ruleCount == 0 && profile.seed == 1);
+	}
+	WindowInvestigator_DelayProfile_Destroy(&profile);
+}
+
+static uint64_t DelayProfileTest_GetDelay(WindowInvestigator_DelayProfile* profile, uint32_t message, uint64_t timeMilliseconds, size_t expectedLine) {
+	uint64_t delay;
+	const WindowInvestigator_DelayRule* const rule = WindowInvestigator_DelayProfile_GetDelay(profile, message, timeMilliseconds * 1000000, &delay);
+	WindowInvestigator_Test_CHECK(expectedLine == 0 ? rule == NULL && delay == 0 : rule != NULL && rule->line == expectedLine);
+	return delay;
+}
+
+static void DelayProfileTest_CheckPrecedence(void) {
+	WindowInvestigator_DelayProfile profile;
+	WindowInvestigator_DelayProfile_Init(&profile);
+	DelayProfileTest_Parse(&profile,
+		"delay * fixed 1\n"
+		"delay WM_SIZE fixed 2\n"
+		"burst 100 10 * fixed 3\n"
+		"burst 50 5 WM_SIZE fixed 4\n"
+		"at 200 WM_SIZE fixed 5\n"
+		"at 150 * fixed 6\n"
+		"at 300 WM_MOVE fixed 7\n");
+
+	for (int pass = 0; pass < 2; ++pass) {
+		// The last matching delay rule wins.
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_WINDOWPOSCHANGING, 20, 1) == 1000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 20, 2) == 2000000);
+		// Burst rules take precedence during their bursts, last matching one first.
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_WINDOWPOSCHANGING, 100, 3) == 3000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 100, 4) == 4000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 109, 3) == 3000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 110, 2) == 2000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_WINDOWPOSCHANGING, 110, 1) == 1000000);
+		// At rules take precedence over everything once their time has come, earliest time first regardless of their order
+		// in the profile, and only fire once.
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 250, 6) == 6000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 260, 5) == 5000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 270, 2) == 2000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_WINDOWPOSCHANGING, 400, 3) == 3000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_MOVE, 400, 7) == 7000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_MOVE, 400, 3) == 3000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_SIZE, 400, 4) == 4000000);
+		WindowInvestigator_Test_CHECK(DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_MOVE, 420, 1) == 1000000);
+		// Resetting rearms the at rules.
+		WindowInvestigator_DelayProfile_Reset(&profile);
+	}
+
+	DelayProfileTest_Parse(&profile, "delay WM_SIZE fixed 1");
+	DelayProfileTest_GetDelay(&profile, DelayProfileTest_WM_MOVE, 0, 0);
+	WindowInvestigator_DelayProfile_Destroy(&profile);
+}
+
+static void DelayProfileTest_CheckReproducible(void) {
+	static uint64_t delays[1000];
+	WindowInvestigator_DelayProfile profile;
+	WindowInvestigator_DelayProfile_Init(&profile);
+	DelayProfileTest_Parse(&profile,
+		"seed 7\n"
+		"delay * uniform 0 10\n"
+		"burst 10 3 WM_SIZE,WM_MOVE normal 5 2\n"
+		"at 500 * lognormal 3 1\n");
+
+	for (int pass = 0; pass < 3; ++pass) {
+		uint64_t random = 1;
+		uint64_t time = 0;
+		bool different = false;
+		for (size_t index = 0; index < sizeof(delays) / sizeof(*delays); ++index) {
+			time += WindowInvestigator_Test_Random(&random) % 2000000;
+			uint64_t delay;
+			WindowInvestigator_DelayProfile_GetDelay(&profile, (uint32_t)WindowInvestigator_Test_RandomIndex(&random, 8), time, &delay);
+			if (pass == 0) delays[index] = delay;
+			else if (pass == 1) WindowInvestigator_Test_CHECK(delay == delays[index]);
+			else if (delay != delays[index]) different = true;
+		}
+		WindowInvestigator_Test_CHECK(pass != 2 || different);
+		// The last pass uses another seed.
+		if (pass == 1) profile.seed = 8;
+		WindowInvestigator_DelayProfile_Reset(&profile);
+	}
+	WindowInvestigator_DelayProfile_Destroy(&profile);
+}
+
+typedef struct {
+	double mean;
+	double standardDeviation;
+	double median;
+	uint64_t min;
+	uint64_t max;
+	size_t zeroCount;
+} DelayProfileTest_Moments;
+
+static int DelayProfileTest_CompareUInt64(const void* left, const void* right) {
+	const uint64_t leftValue = *(const uint64_t*)left;
+	const uint64_t rightValue = *(const uint64_t*)right;
+	return leftValue < rightValue ? -1 : leftValue > rightValue;
+}
+
+// Samples the delay of a profile made of the specified single rule. If logarithm is true, the mean and standard deviation
+// are those of the logarithm of the (nonzero) delays.
+static void DelayProfileTest_Sample(const char* text, bool logarithm, DelayProfileTest_Moments* moments) {
+	static uint64_t delays[DelayProfileTest_SAMPLE_COUNT];
+	WindowInvestigator_DelayProfile profile;
+	WindowInvestigator_DelayProfile_Init(&profile);
+	DelayProfileTest_Parse(&profile, text);
+	double sum = 0;
+	double squareSum = 0;
+	moments->zeroCount = 0;
+	for (size_t index = 0; index < DelayProfileTest_SAMPLE_COUNT; ++index) {
+		WindowInvestigator_DelayProfile_GetDelay(&profile, DelayProfileTest_WM_SIZE, index, &delays[index]);
+		if (delays[index] == 0) ++moments->zeroCount;
+		const double value = logarithm ? (delays[index] == 0 ? 0 : log((double)delays[index])) : (double)delays[index];
+		sum += value;
+		squareSum += value * value;
+	}
+	WindowInvestigator_DelayProfile_Destroy(&profile);
+
+	moments->mean = sum / DelayProfileTest_SAMPLE_COUNT;
+	moments->standardDeviation = sqrt(squareSum / DelayProfileTest_SAMPLE_COUNT - moments->mean * moments->mean);
+	qsort(delays, DelayProfileTest_SAMPLE_COUNT, sizeof(*delays), DelayProfileTest_CompareUInt64);
+	moments->median = (double)delays[DelayProfileTest_SAMPLE_COUNT / 2];
+	moments->min = delays[0];
+	moments->max = delays[DelayProfileTest_SAMPLE_COUNT - 1];
+}
+
+static bool DelayProfileTest_IsClose(double value, double expected, double tolerance) {
+	return fabs(value - expected) <= tolerance * fabs(expected);
+}
+
+static void DelayProfileTest_CheckDistributions(void) {
+	DelayProfileTest_Moments moments;
+
+	DelayProfileTest_Sample("delay * fixed 2.5", false, &moments);
+	WindowInvestigator_Test_CHECK(moments.min == 2500000 && moments.max == 2500000);
+
+	// Uniform: mean (MIN + MAX) / 2, standard deviation (MAX - MIN) / sqrt(12).
+	DelayProfileTest_Sample("delay * uniform 2 10", false, &moments);
+	WindowInvestigator_Test_CHECK(moments.min >= 2000000 && moments.max <= 10000000);
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.mean, 6e6, 0.01));
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.standardDeviation, 8e6 / sqrt(12), 0.01));
+
+	DelayProfileTest_Sample("delay * normal 20 3", false, &moments);
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.mean, 20e6, 0.01));
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.standardDeviation, 3e6, 0.02));
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.median, 20e6, 0.01));
+
+	// Negative delays become 0: half of them for a mean of 0.
+	DelayProfileTest_Sample("delay * normal 0 1", false, &moments);
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose((double)moments.zeroCount, DelayProfileTest_SAMPLE_COUNT / 2, 0.02));
+
+	// Log-normal: the logarithm is normal, with a mean of log(MEDIAN) and a standard deviation of SIGMA.
+	DelayProfileTest_Sample("delay * lognormal 4 0.5", true, &moments);
+	WindowInvestigator_Test_CHECK(moments.zeroCount == 0);
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.median, 4e6, 0.02));
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.mean, log(4e6), 0.001));
+	WindowInvestigator_Test_CHECK(DelayProfileTest_IsClose(moments.standardDeviation, 0.5, 0.02));
+
+	// The cap applies to every distribution; with a heavy tail, a good fraction of the delays hit it.
+	DelayProfileTest_Sample("delay * lognormal 4 2 max 8", false, &moments);
+	WindowInvestigator_Test_CHECK(moments.max == 8000000);
+	DelayProfileTest_Sample("delay * uniform 2 10 max 5", false, &moments);
+	WindowInvestigator_Test_CHECK(moments.max == 5000000 && DelayProfileTest_IsClose(moments.median, 5e6, 0.001));
+}
+
+int main(void) {
+	DelayProfileTest_CheckParse();
+	DelayProfileTest_CheckErrors();
+	DelayProfileTest_CheckPrecedence();
+	DelayProfileTest_CheckReproducible();
+	DelayProfileTest_CheckDistributions();
+	printf("Delay profiles OK\n");
+	return EXIT_SUCCESS;
+}
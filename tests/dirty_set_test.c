@@ -0,0 +1,445 @@
+#include "../common/dirty_set.h"
+#include "../common/window_info.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// Checks the dirty set one rule at a time (coalescing, late notifications, structural notifications, forgetting dirty windows,
+// the sweep and the enumeration period), then against a straightforward model over a long random sequence of notifications
+// and passes, with enough windows coming and going to exercise the index.
+
+#define DirtySetTest_MODEL_WINDOWS 3000
+#define DirtySetTest_MODEL_PASSES 20000
+
+static const WindowInvestigator_DirtySetOptions DirtySetTest_options = { 3, 4 };
+
+static uintptr_t DirtySetTest_GetWindow(size_t index) {
+	// Window handles share their low bits, and 0 is not a window. The high bits are scrambled, as consecutive handles would
+	// hardly ever collide in the index.
+	return ((uintptr_t)(index * 2654435761u % 4093) << 20) | (0x10000 + 4 * (uintptr_t)index);
+}
+
+static size_t DirtySetTest_GetIndex(uintptr_t window) {
+	return ((window & 0xFFFFF) - 0x10000) / 4;
+}
+
+static const WindowInvestigator_DirtyWindow* DirtySetTest_FindDirty(const WindowInvestigator_DirtySet* set, uintptr_t window) {
+	for (size_t index = 0; index < WindowInvestigator_DirtySet_GetDirtyCount(set); ++index) {
+		const WindowInvestigator_DirtyWindow* const dirtyWindow = WindowInvestigator_DirtySet_GetDirtyWindow(set, index);
+		if (dirtyWindow->window == window) return dirtyWindow;
+	}
+	return NULL;
+}
+
+// Takes every dirty window, and ends the pass.
+static void DirtySetTest_ReadAll(WindowInvestigator_DirtySet* set, uint64_t time, bool enumerate) {
+	WindowInvestigator_DirtySet_BeginPass(set, time, enumerate);
+	for (size_t index = 0; index < WindowInvestigator_DirtySet_GetDirtyCount(set); ++index) WindowInvestigator_DirtySet_TakeAt(set, index);
+	WindowInvestigator_DirtySet_EndPass(set, time);
+}
+
+static void DirtySetTest_CheckCoalescing(void) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	const uintptr_t window = DirtySetTest_GetWindow(0);
+	const uint32_t locationFields = WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_LOCATION);
+	const uint32_t nameFields = WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_NAME);
+
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, window, 10);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, window, 11);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(set.statistics.duplicateNotifications == 1);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, window, 12);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(set.statistics.duplicateNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == (locationFields | nameFields));
+	// STATE only adds EXTENDED_STYLES to what LOCATION already covers.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_STATE, window, 13);
+	WindowInvestigator_Test_CHECK(set.statistics.duplicateNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == (locationFields | nameFields | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES)));
+	// Sweeping a dirty window adds to it, without counting as a notification.
+	WindowInvestigator_DirtySet_MarkDirty(&set, window, WindowInvestigator_WindowField_ALL);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(set.statistics.notifications == 4);
+
+	WindowInvestigator_DirtySet_BeginPass(&set, 20, true);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_Take(&set, window) == WindowInvestigator_WindowField_ALL);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_Take(&set, DirtySetTest_GetWindow(1)) == 0);
+	WindowInvestigator_DirtySet_EndPass(&set, 20);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 0);
+	WindowInvestigator_Test_CHECK(set.statistics.discardedWindows == 0);
+	WindowInvestigator_DirtySet_Destroy(&set);
+}
+
+static void DirtySetTest_CheckLateNotifications(void) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	const uintptr_t window = DirtySetTest_GetWindow(0);
+	const uint32_t locationFields = WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_LOCATION);
+
+	// Never read: a notification is never stale, however old.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, window, 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	DirtySetTest_ReadAll(&set, 100, true);
+
+	// Changes that happened before the read, to fields that it covered.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, window, 99);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 0);
+	// Before the read, but only partly covered: only the fields that were not read are dirty.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_STATE, window, 50);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES));
+	// At or after the read: a new change.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, window, 100);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == (locationFields | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES)));
+
+	// Only the fields of the last read count: LOCATION was not read at 200, so a late one is not stale anymore.
+	DirtySetTest_ReadAll(&set, 150, false);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, window, 160);
+	DirtySetTest_ReadAll(&set, 200, false);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, window, 170);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 2);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, window, 140);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 2);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == locationFields);
+	WindowInvestigator_DirtySet_Destroy(&set);
+}
+
+static void DirtySetTest_CheckStructural(void) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	const uintptr_t window = DirtySetTest_GetWindow(0);
+	const uintptr_t otherWindow = DirtySetTest_GetWindow(1);
+	DirtySetTest_ReadAll(&set, 100, true);
+
+	// A new window has no fields to read, but needs an enumeration.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_CREATE, window, 100);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->structural);
+	// The last enumeration already saw structural changes from before it started.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_CREATE, otherWindow, 99);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	// ... but not necessarily their fields, for a window that was never read.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_SHOW, otherWindow, 99);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 2);
+	const WindowInvestigator_DirtyWindow* shownWindow = DirtySetTest_FindDirty(&set, otherWindow);
+	WindowInvestigator_Test_CHECK(shownWindow != NULL && !shownWindow->structural);
+	WindowInvestigator_Test_CHECK(shownWindow->dirtyFields == WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_SHOW));
+	// The same fields, structural this time: not a duplicate.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_HIDE, otherWindow, 101);
+	shownWindow = DirtySetTest_FindDirty(&set, otherWindow);
+	WindowInvestigator_Test_CHECK(shownWindow->structural);
+	WindowInvestigator_Test_CHECK(set.statistics.duplicateNotifications == 0);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_SHOW, otherWindow, 102);
+	WindowInvestigator_Test_CHECK(set.statistics.duplicateNotifications == 1);
+	// Non-structural notifications never make a window structural.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(2), 103);
+	WindowInvestigator_Test_CHECK(!DirtySetTest_FindDirty(&set, DirtySetTest_GetWindow(2))->structural);
+	WindowInvestigator_DirtySet_MarkDirty(&set, DirtySetTest_GetWindow(3), WindowInvestigator_WindowField_ALL);
+	WindowInvestigator_Test_CHECK(!DirtySetTest_FindDirty(&set, DirtySetTest_GetWindow(3))->structural);
+
+	// Reading clears the structural flag. A structural notification from when the last enumeration started on is never stale,
+	// even for fields that were read.
+	DirtySetTest_ReadAll(&set, 200, true);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_REORDER, DirtySetTest_GetWindow(3), 150);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 0);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_REORDER, DirtySetTest_GetWindow(3), 200);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->structural);
+	WindowInvestigator_DirtySet_Destroy(&set);
+}
+
+static void DirtySetTest_CheckForget(void) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	for (size_t index = 0; index < 4; ++index)
+		WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(index), 10);
+	DirtySetTest_ReadAll(&set, 20, true);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(0), 30);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, DirtySetTest_GetWindow(1), 30);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_CLOAK, DirtySetTest_GetWindow(2), 30);
+
+	// The last dirty window moves in place of the forgotten one, and keeps its fields.
+	WindowInvestigator_DirtySet_BeginPass(&set, 40, false);
+	WindowInvestigator_DirtySet_Forget(&set, DirtySetTest_GetWindow(0));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 2);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->window == DirtySetTest_GetWindow(2));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->dirtyFields == WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_CLOAK));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 1)->window == DirtySetTest_GetWindow(1));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_Take(&set, DirtySetTest_GetWindow(0)) == 0);
+	// Forgetting a clean window, or an unknown one, leaves the dirty list alone.
+	WindowInvestigator_DirtySet_Forget(&set, DirtySetTest_GetWindow(3));
+	WindowInvestigator_DirtySet_Forget(&set, DirtySetTest_GetWindow(4));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 2);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_Take(&set, DirtySetTest_GetWindow(2)) != 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_Take(&set, DirtySetTest_GetWindow(1)) != 0);
+	WindowInvestigator_DirtySet_EndPass(&set, 40);
+	WindowInvestigator_Test_CHECK(set.statistics.discardedWindows == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 0);
+
+	// Forgotten windows start over: late notifications are not stale anymore.
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(0), 15);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(3), 15);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_LOCATION, DirtySetTest_GetWindow(1), 35);
+	WindowInvestigator_Test_CHECK(set.statistics.staleNotifications == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 2);
+
+	// So do windows that were dirty but not read by the pass.
+	WindowInvestigator_DirtySet_BeginPass(&set, 50, false);
+	WindowInvestigator_DirtySet_Take(&set, DirtySetTest_GetWindow(3));
+	WindowInvestigator_DirtySet_EndPass(&set, 50);
+	WindowInvestigator_Test_CHECK(set.statistics.discardedWindows == 1);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(0), 16);
+	WindowInvestigator_DirtySet_Notify(&set, WindowInvestigator_WindowNotification_NAME, DirtySetTest_GetWindow(3), 16);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(&set) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyWindow(&set, 0)->window == DirtySetTest_GetWindow(0));
+	WindowInvestigator_DirtySet_Destroy(&set);
+}
+
+static void DirtySetTest_CheckSweep(void) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	size_t first;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 0, &first) == 0);
+
+	// Every window is swept once every ceil(10 / 4) passes, wrapping around.
+	static const size_t expectedFirsts[] = { 0, 4, 8, 2, 6, 0 };
+	for (size_t pass = 0; pass < sizeof(expectedFirsts) / sizeof(*expectedFirsts); ++pass) {
+		WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 10, &first) == 4);
+		WindowInvestigator_Test_CHECK(first == expectedFirsts[pass]);
+	}
+	WindowInvestigator_Test_CHECK(set.statistics.sweptWindows == 24);
+
+	// The Z-order shrinks under the cursor (now at 4).
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 3, &first) == 3);
+	WindowInvestigator_Test_CHECK(first == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 3, &first) == 3);
+	WindowInvestigator_Test_CHECK(first == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 7, &first) == 4);
+	WindowInvestigator_Test_CHECK(first == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 7, &first) == 4);
+	WindowInvestigator_Test_CHECK(first == 5);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 0, &first) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetSweep(&set, 7, &first) == 4);
+	WindowInvestigator_Test_CHECK(first == 2);
+	WindowInvestigator_DirtySet_Destroy(&set);
+
+	// Whatever the counts, a run of ceil(windowCount / sweepWindowsPerPass) passes covers every window.
+	for (size_t perPass = 1; perPass <= 9; ++perPass)
+		for (size_t windowCount = 1; windowCount <= 40; ++windowCount) {
+			const WindowInvestigator_DirtySetOptions options = { 0, perPass };
+			WindowInvestigator_DirtySet_Init(&set, &options);
+			for (size_t offset = 0; offset < windowCount; ++offset) {
+				bool swept[40] = { false };
+				for (size_t pass = 0; pass < (windowCount + perPass - 1) / perPass; ++pass) {
+					const size_t count = WindowInvestigator_DirtySet_GetSweep(&set, windowCount, &first);
+					for (size_t index = 0; index < count; ++index) swept[(first + index) % windowCount] = true;
+				}
+				for (size_t index = 0; index < windowCount; ++index) WindowInvestigator_Test_CHECK(swept[index]);
+				// Moves the cursor along for the next run.
+				WindowInvestigator_DirtySet_GetSweep(&set, windowCount, &first);
+			}
+			WindowInvestigator_DirtySet_Destroy(&set);
+		}
+}
+
+static void DirtySetTest_CheckEnumerationPeriod(void) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	// The first pass always enumerates, however many passes did not.
+	for (uint64_t pass = 1; pass <= 5; ++pass) {
+		WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_IsEnumerationDue(&set));
+		WindowInvestigator_DirtySet_BeginPass(&set, pass, false);
+		WindowInvestigator_DirtySet_EndPass(&set, pass);
+	}
+	// Then one pass in 3 does, counting from the last one that enumerated, for whatever reason.
+	static const bool expectedDue[] = { true, false, false, true, false, false, true };
+	for (size_t index = 0; index < sizeof(expectedDue) / sizeof(*expectedDue); ++index) {
+		const uint64_t time = 10 + index;
+		WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_IsEnumerationDue(&set) == expectedDue[index]);
+		WindowInvestigator_DirtySet_BeginPass(&set, time, expectedDue[index]);
+		WindowInvestigator_DirtySet_EndPass(&set, time);
+	}
+	WindowInvestigator_DirtySet_BeginPass(&set, 20, false);
+	WindowInvestigator_DirtySet_BeginPass(&set, 21, true);
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_DirtySet_IsEnumerationDue(&set));
+	WindowInvestigator_Test_CHECK(set.statistics.passes == 14);
+	WindowInvestigator_Test_CHECK(set.statistics.enumerations == 4);
+	WindowInvestigator_DirtySet_Destroy(&set);
+
+	// Period 0: only the first pass.
+	const WindowInvestigator_DirtySetOptions options = { 0, 4 };
+	WindowInvestigator_DirtySet_Init(&set, &options);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_IsEnumerationDue(&set));
+	WindowInvestigator_DirtySet_BeginPass(&set, 1, true);
+	for (uint64_t pass = 2; pass < 1000; ++pass) {
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_DirtySet_IsEnumerationDue(&set));
+		WindowInvestigator_DirtySet_BeginPass(&set, pass, false);
+	}
+	WindowInvestigator_DirtySet_Destroy(&set);
+}
+
+typedef struct {
+	bool tracked;
+	bool dirty;
+	bool structural;
+	bool taken;
+	uint32_t dirtyFields;
+	uint32_t readFields;
+	uint64_t readTime;
+} DirtySetTest_ModelWindow;
+
+typedef struct {
+	DirtySetTest_ModelWindow windows[DirtySetTest_MODEL_WINDOWS];
+	uint64_t enumerationTime;
+	uint64_t duplicateNotifications;
+	uint64_t staleNotifications;
+	uint64_t discardedWindows;
+} DirtySetTest_Model;
+
+static DirtySetTest_Model DirtySetTest_model;
+
+static void DirtySetTest_ModelSetDirty(DirtySetTest_ModelWindow* window, uint32_t fields, bool structural) {
+	if (!window->tracked) memset(window, 0, sizeof(*window));
+	window->tracked = true;
+	window->dirty = true;
+	window->dirtyFields |= fields;
+	window->structural |= structural;
+}
+
+static void DirtySetTest_ModelNotify(DirtySetTest_Model* model, WindowInvestigator_WindowNotification notification, size_t index, uint64_t timestamp) {
+	DirtySetTest_ModelWindow* const window = &model->windows[index];
+	uint32_t fields = WindowInvestigator_WindowNotification_GetFields(notification);
+	const bool structural = WindowInvestigator_WindowNotification_IsStructural(notification) && timestamp >= model->enumerationTime;
+	if (window->tracked && window->readTime != 0 && timestamp < window->readTime) fields &= ~window->readFields;
+	if (fields == 0 && !structural) ++model->staleNotifications;
+	else if (window->tracked && window->dirty && (fields & ~window->dirtyFields) == 0 && (!structural || window->structural)) ++model->duplicateNotifications;
+	else DirtySetTest_ModelSetDirty(window, fields, structural);
+}
+
+static void DirtySetTest_CheckModel(const WindowInvestigator_DirtySet* set, const DirtySetTest_Model* model) {
+	size_t dirtyCount = 0;
+	for (size_t index = 0; index < DirtySetTest_MODEL_WINDOWS; ++index) dirtyCount += model->windows[index].tracked && model->windows[index].dirty;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_GetDirtyCount(set) == dirtyCount);
+	for (size_t dirtyIndex = 0; dirtyIndex < dirtyCount; ++dirtyIndex) {
+		const WindowInvestigator_DirtyWindow* const dirtyWindow = WindowInvestigator_DirtySet_GetDirtyWindow(set, dirtyIndex);
+		const size_t index = DirtySetTest_GetIndex(dirtyWindow->window);
+		WindowInvestigator_Test_CHECK(index < DirtySetTest_MODEL_WINDOWS && dirtyWindow->window == DirtySetTest_GetWindow(index));
+		const DirtySetTest_ModelWindow* const window = &model->windows[index];
+		WindowInvestigator_Test_CHECK(window->tracked && window->dirty);
+		WindowInvestigator_Test_CHECK(dirtyWindow->dirtyFields == window->dirtyFields);
+		WindowInvestigator_Test_CHECK(dirtyWindow->structural == window->structural);
+		WindowInvestigator_Test_CHECK(dirtyWindow->dirtyIndex == dirtyIndex);
+	}
+	WindowInvestigator_Test_CHECK(set->statistics.duplicateNotifications == model->duplicateNotifications);
+	WindowInvestigator_Test_CHECK(set->statistics.staleNotifications == model->staleNotifications);
+	WindowInvestigator_Test_CHECK(set->statistics.discardedWindows == model->discardedWindows);
+}
+
+// Notifications are delivered up to a few passes late, windows are forgotten at random (including in the middle of a pass), and
+// passes read a random subset of the dirty windows. The set of active windows drifts over time, so that the index grows and
+// entries get reused.
+static void DirtySetTest_CheckAgainstModel(uint64_t* random) {
+	WindowInvestigator_DirtySet set;
+	WindowInvestigator_DirtySet_Init(&set, &DirtySetTest_options);
+	DirtySetTest_Model* const model = &DirtySetTest_model;
+	memset(model, 0, sizeof(*model));
+
+	uint64_t time = 1000;
+	for (int pass = 0; pass < DirtySetTest_MODEL_PASSES; ++pass) {
+		const size_t activeWindows = 1 + (size_t)pass * DirtySetTest_MODEL_WINDOWS / DirtySetTest_MODEL_PASSES;
+		const size_t activeFirst = (size_t)pass % (DirtySetTest_MODEL_WINDOWS - activeWindows + 1);
+		const size_t notificationCount = WindowInvestigator_Test_RandomIndex(random, 32);
+		for (size_t notification = 0; notification < notificationCount; ++notification) {
+			const size_t index = activeFirst + WindowInvestigator_Test_RandomIndex(random, activeWindows);
+			const uint64_t timestamp = time - WindowInvestigator_Test_RandomIndex(random, 40);
+			switch (WindowInvestigator_Test_RandomIndex(random, 16)) {
+			case 0:
+				WindowInvestigator_DirtySet_Forget(&set, DirtySetTest_GetWindow(index));
+				model->windows[index].tracked = false;
+				break;
+			case 1:
+				WindowInvestigator_DirtySet_MarkDirty(&set, DirtySetTest_GetWindow(index), WindowInvestigator_WindowField_ALL);
+				DirtySetTest_ModelSetDirty(&model->windows[index], WindowInvestigator_WindowField_ALL, false);
+				break;
+			default: {
+				const WindowInvestigator_WindowNotification windowNotification = (WindowInvestigator_WindowNotification)WindowInvestigator_Test_RandomIndex(random, WindowInvestigator_WindowNotification_COUNT);
+				WindowInvestigator_DirtySet_Notify(&set, windowNotification, DirtySetTest_GetWindow(index), timestamp);
+				DirtySetTest_ModelNotify(model, windowNotification, index, timestamp);
+			}
+			}
+		}
+		DirtySetTest_CheckModel(&set, model);
+
+		time += 10;
+		const bool enumerate = WindowInvestigator_DirtySet_IsEnumerationDue(&set) || WindowInvestigator_Test_RandomIndex(random, 8) == 0;
+		WindowInvestigator_DirtySet_BeginPass(&set, time, enumerate);
+		if (enumerate) model->enumerationTime = time;
+		// Reads most of the dirty windows, in dirty list order or by handle, and forgets a few of them along the way.
+		const size_t dirtyCount = WindowInvestigator_DirtySet_GetDirtyCount(&set);
+		for (size_t dirtyIndex = 0; dirtyIndex < dirtyCount && dirtyIndex < WindowInvestigator_DirtySet_GetDirtyCount(&set); ++dirtyIndex) {
+			const uintptr_t window = WindowInvestigator_DirtySet_GetDirtyWindow(&set, dirtyIndex)->window;
+			const size_t index = DirtySetTest_GetIndex(window);
+			switch (WindowInvestigator_Test_RandomIndex(random, 16)) {
+			case 0: break;
+			case 1:
+				WindowInvestigator_DirtySet_Forget(&set, window);
+				model->windows[index].tracked = false;
+				break;
+			case 2: case 3: case 4: case 5:
+				WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_Take(&set, window) == model->windows[index].dirtyFields);
+				model->windows[index].taken = true;
+				break;
+			default:
+				WindowInvestigator_Test_CHECK(WindowInvestigator_DirtySet_TakeAt(&set, dirtyIndex) == model->windows[index].dirtyFields);
+				model->windows[index].taken = true;
+			}
+		}
+		WindowInvestigator_DirtySet_EndPass(&set, time);
+		for (size_t index = 0; index < DirtySetTest_MODEL_WINDOWS; ++index) {
+			DirtySetTest_ModelWindow* const window = &model->windows[index];
+			if (!window->tracked || !window->dirty) continue;
+			if (!window->taken) {
+				window->tracked = false;
+				++model->discardedWindows;
+				continue;
+			}
+			window->readFields = window->dirtyFields;
+			window->readTime = time;
+			window->dirtyFields = 0;
+			window->structural = false;
+			window->dirty = false;
+			window->taken = false;
+		}
+		DirtySetTest_CheckModel(&set, model);
+	}
+	WindowInvestigator_Test_CHECK(set.statistics.passes == DirtySetTest_MODEL_PASSES);
+	printf("Model: %llu notifications, %llu duplicate, %llu stale, %llu discarded windows\n", (unsigned long long)set.statistics.notifications, (unsigned long long)set.statistics.duplicateNotifications, (unsigned long long)set.statistics.staleNotifications, (unsigned long long)set.statistics.discardedWindows);
+	WindowInvestigator_DirtySet_Destroy(&set);
+}
+
+int main(void) {
+	// Spot checks of the notification mapping that the rest relies on.
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_CREATE) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowNotification_IsStructural(WindowInvestigator_WindowNotification_CREATE));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowNotification_IsStructural(WindowInvestigator_WindowNotification_NAME));
+	WindowInvestigator_Test_CHECK((WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_STATE) & ~WindowInvestigator_WindowNotification_GetFields(WindowInvestigator_WindowNotification_LOCATION)) == WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_EXTENDED_STYLES));
+
+	DirtySetTest_CheckCoalescing();
+	DirtySetTest_CheckLateNotifications();
+	DirtySetTest_CheckStructural();
+	DirtySetTest_CheckForget();
+	DirtySetTest_CheckSweep();
+	DirtySetTest_CheckEnumerationPeriod();
+
+	uint64_t random = 1;
+	DirtySetTest_CheckAgainstModel(&random);
+	return EXIT_SUCCESS;
+}
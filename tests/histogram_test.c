@@ -0,0 +1,162 @@
+#include "../common/histogram.h"
+#include "../common/atomic.h"
+#include "../common/thread.h"
+
+#include "test.h"
+
+#include <string.h>
+
+// Checks histogram percentiles against the exact values, read from the sorted list of recorded values, for a few
+// distributions spanning the whole uint64_t range; and checks that values recorded concurrently from several threads while
+// another thread keeps merging the histogram all end up counted, exactly as if they had been recorded by a single thread.
+
+#define HistogramTest_MAX_VALUES 100000
+#define HistogramTest_THREAD_COUNT 4
+#define HistogramTest_VALUES_PER_THREAD 200000
+
+static int HistogramTest_CompareUInt64(const void* left, const void* right) {
+	const uint64_t leftValue = *(const uint64_t*)left;
+	const uint64_t rightValue = *(const uint64_t*)right;
+	return leftValue < rightValue ? -1 : leftValue > rightValue;
+}
+
+static uint64_t HistogramTest_GenerateValue(uint64_t* random, int distribution) {
+	switch (distribution) {
+	// Small values, which have a bucket each.
+	case 0: return WindowInvestigator_Test_Random(random) % 40;
+	// Typical durations.
+	case 1: return 1000 + WindowInvestigator_Test_Random(random) % 1000000;
+	// Log-uniform over the whole range.
+	case 2: return WindowInvestigator_Test_Random(random) >> WindowInvestigator_Test_RandomIndex(random, 64);
+	// A single value.
+	default: return 123456789;
+	}
+}
+
+// values must be sorted.
+static void HistogramTest_CheckPercentile(const WindowInvestigator_Histogram* histogram, const uint64_t* values, size_t count, double percentile) {
+	const double exactRank = percentile / 100 * (double)count;
+	size_t rank = (size_t)exactRank;
+	if ((double)rank < exactRank || rank < 1) ++rank;
+	if (rank > count) rank = count;
+	const uint64_t exact = values[rank - 1];
+	const uint64_t approximate = WindowInvestigator_Histogram_GetPercentile(histogram, percentile);
+	// Rounded up to the end of the bucket, which is at most 1 / (SUB_BUCKET_COUNT / 2) of the value wide.
+	WindowInvestigator_Test_CHECK(approximate >= exact);
+	WindowInvestigator_Test_CHECK(approximate <= values[count - 1]);
+	WindowInvestigator_Test_CHECK(approximate - exact <= exact / (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2));
+	if (exact < WindowInvestigator_Histogram_SUB_BUCKET_COUNT) WindowInvestigator_Test_CHECK(approximate == exact);
+}
+
+static void HistogramTest_CheckPercentiles(uint64_t* random) {
+	static uint64_t values[HistogramTest_MAX_VALUES];
+	static WindowInvestigator_Histogram histogram;
+	static const double percentiles[] = { 0, 0.1, 1, 10, 50, 90, 99, 99.9, 99.99, 100 };
+	size_t caseCount = 0;
+	for (int distribution = 0; distribution < 4; ++distribution) {
+		for (size_t count = 1; count <= HistogramTest_MAX_VALUES; count *= 10) {
+			WindowInvestigator_Histogram_Reset(&histogram);
+			uint64_t sum = 0;
+			for (size_t index = 0; index < count; ++index) {
+				values[index] = HistogramTest_GenerateValue(random, distribution);
+				sum += values[index];
+				WindowInvestigator_Histogram_Record(&histogram, values[index]);
+			}
+			qsort(values, count, sizeof(*values), HistogramTest_CompareUInt64);
+
+			WindowInvestigator_Test_CHECK(histogram.count == count);
+			WindowInvestigator_Test_CHECK(histogram.sum == sum);
+			WindowInvestigator_Test_CHECK(histogram.min == values[0]);
+			WindowInvestigator_Test_CHECK(histogram.max == values[count - 1]);
+			WindowInvestigator_Test_CHECK(WindowInvestigator_Histogram_GetPercentile(&histogram, 0) <= values[0] + values[0] / (WindowInvestigator_Histogram_SUB_BUCKET_COUNT / 2));
+			WindowInvestigator_Test_CHECK(WindowInvestigator_Histogram_GetPercentile(&histogram, 100) == values[count - 1]);
+			for (size_t index = 0; index < sizeof(percentiles) / sizeof(*percentiles); ++index)
+				HistogramTest_CheckPercentile(&histogram, values, count, percentiles[index]);
+			for (int iteration = 0; iteration < 100; ++iteration)
+				HistogramTest_CheckPercentile(&histogram, values, count, (double)WindowInvestigator_Test_RandomIndex(random, 100001) / 1000);
+			++caseCount;
+		}
+	}
+
+	WindowInvestigator_Histogram_Reset(&histogram);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_Histogram_GetPercentile(&histogram, 50) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_Histogram_GetMean(&histogram) == 0);
+	WindowInvestigator_Histogram_Record(&histogram, UINT64_MAX);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_Histogram_GetPercentile(&histogram, 50) == UINT64_MAX);
+
+	printf("%zu percentile cases OK\n", caseCount);
+}
+
+typedef struct {
+	WindowInvestigator_Thread thread;
+	WindowInvestigator_Histogram* shared;
+	uint64_t seed;
+	volatile uint64_t* finishedCount;
+} HistogramTest_Recorder;
+
+static void HistogramTest_Record(void* context) {
+	HistogramTest_Recorder* const recorder = context;
+	uint64_t random = recorder->seed;
+	for (int index = 0; index < HistogramTest_VALUES_PER_THREAD; ++index)
+		WindowInvestigator_Histogram_RecordConcurrent(recorder->shared, HistogramTest_GenerateValue(&random, index % 3));
+	WindowInvestigator_Atomic_Increment(recorder->finishedCount);
+}
+
+static void HistogramTest_CheckConcurrent(void) {
+	static WindowInvestigator_Histogram shared;
+	static WindowInvestigator_Histogram expected;
+	static WindowInvestigator_Histogram snapshot;
+	static WindowInvestigator_Histogram previousSnapshot;
+	WindowInvestigator_Histogram_Reset(&shared);
+	WindowInvestigator_Histogram_Reset(&previousSnapshot);
+
+	volatile uint64_t finishedCount = 0;
+	HistogramTest_Recorder recorders[HistogramTest_THREAD_COUNT];
+	for (size_t index = 0; index < HistogramTest_THREAD_COUNT; ++index) {
+		recorders[index].shared = &shared;
+		recorders[index].seed = index + 1;
+		recorders[index].finishedCount = &finishedCount;
+		WindowInvestigator_Thread_Start(&recorders[index].thread, HistogramTest_Record, &recorders[index]);
+	}
+	// Counters only ever go up, so every snapshot must be at least the previous one.
+	size_t snapshotCount = 0;
+	while (WindowInvestigator_Atomic_LoadAcquire(&finishedCount) < HistogramTest_THREAD_COUNT) {
+		WindowInvestigator_Histogram_Reset(&snapshot);
+		WindowInvestigator_Histogram_Merge(&snapshot, &shared);
+		WindowInvestigator_Test_CHECK(snapshot.count >= previousSnapshot.count);
+		WindowInvestigator_Test_CHECK(snapshot.count <= (uint64_t)HistogramTest_THREAD_COUNT * HistogramTest_VALUES_PER_THREAD);
+		WindowInvestigator_Test_CHECK(snapshot.max >= previousSnapshot.max);
+		WindowInvestigator_Test_CHECK(snapshot.min <= previousSnapshot.min);
+		for (size_t bucket = 0; bucket < WindowInvestigator_Histogram_BUCKET_COUNT; ++bucket)
+			WindowInvestigator_Test_CHECK(snapshot.buckets[bucket] >= previousSnapshot.buckets[bucket]);
+		previousSnapshot = snapshot;
+		++snapshotCount;
+	}
+	for (size_t index = 0; index < HistogramTest_THREAD_COUNT; ++index) WindowInvestigator_Thread_Join(&recorders[index].thread);
+
+	WindowInvestigator_Histogram_Reset(&expected);
+	for (size_t index = 0; index < HistogramTest_THREAD_COUNT; ++index) {
+		uint64_t random = recorders[index].seed;
+		for (int value = 0; value < HistogramTest_VALUES_PER_THREAD; ++value)
+			WindowInvestigator_Histogram_Record(&expected, HistogramTest_GenerateValue(&random, value % 3));
+	}
+	WindowInvestigator_Test_CHECK(memcmp(&shared, &expected, sizeof(expected)) == 0);
+
+	// Merging into a histogram that already has values adds them up.
+	WindowInvestigator_Histogram_Reset(&snapshot);
+	WindowInvestigator_Histogram_Merge(&snapshot, &shared);
+	WindowInvestigator_Histogram_Merge(&snapshot, &expected);
+	WindowInvestigator_Test_CHECK(snapshot.count == 2 * expected.count && snapshot.sum == 2 * expected.sum);
+	WindowInvestigator_Test_CHECK(snapshot.min == expected.min && snapshot.max == expected.max);
+	for (size_t bucket = 0; bucket < WindowInvestigator_Histogram_BUCKET_COUNT; ++bucket)
+		WindowInvestigator_Test_CHECK(snapshot.buckets[bucket] == 2 * expected.buckets[bucket]);
+
+	printf("%d concurrent values OK (%zu merges while recording)\n", HistogramTest_THREAD_COUNT * HistogramTest_VALUES_PER_THREAD, snapshotCount);
+}
+
+int main(void) {
+	uint64_t random = 1;
+	HistogramTest_CheckPercentiles(&random);
+	HistogramTest_CheckConcurrent();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#include "../common/message_script.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// Checks message script parsing (including the line reported for malformed scripts), against a straightforward expansion of
+// randomized scripts: messages must come out in the order they are due, messages due at the same time in the order of the
+// script, with repeats and loops expanded.
+
+#define MessageScriptTest_MAX_ENTRIES 20
+#define MessageScriptTest_MAX_REPEATS 5
+#define MessageScriptTest_MAX_MESSAGES (MessageScriptTest_MAX_ENTRIES * MessageScriptTest_MAX_REPEATS)
+
+static void MessageScriptTest_Parse(WindowInvestigator_MessageScript* script, const char* text) {
+	size_t errorLine = 0;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_MessageScript_Parse(script, text, &errorLine));
+}
+
+static void MessageScriptTest_CheckMessage(const WindowInvestigator_MessageScript* script, uint64_t index, uint64_t offsetNanoseconds, uint64_t wParam, uint64_t lParam, size_t line) {
+	WindowInvestigator_ScriptedMessage message;
+	WindowInvestigator_MessageScript_GetMessage(script, index, &message);
+	WindowInvestigator_Test_CHECK(message.offsetNanoseconds == offsetNanoseconds);
+	WindowInvestigator_Test_CHECK(message.wParam == wParam && message.lParam == lParam && message.line == line);
+}
+
+static void MessageScriptTest_CheckParse(void) {
+	WindowInvestigator_MessageScript script;
+	WindowInvestigator_MessageScript_Init(&script);
+
+	// The example from the README.
+	MessageScriptTest_Parse(&script,
+		"# Add a full screen window, then remove it 100 ms later.\n"
+		"0   0x35 0x4242\n"
+		"100 0x36 0x4242\n"
+		"# Then hammer the Rude Window Manager with 50 recalculations, 2 ms apart.\n"
+		"200 0x16 0x0 repeat 50 every 2\n"
+		"# Do all of the above 10 times, once per second.\n"
+		"loop 10 every 1000\n");
+	WindowInvestigator_Test_CHECK(script.messageCount == 52 && script.loopCount == 10 && script.loopPeriodNanoseconds == 1000000000);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_MessageScript_GetMessageCount(&script) == 520);
+	MessageScriptTest_CheckMessage(&script, 0, 0, 0x35, 0x4242, 2);
+	MessageScriptTest_CheckMessage(&script, 1, 100000000, 0x36, 0x4242, 3);
+	MessageScriptTest_CheckMessage(&script, 2, 200000000, 0x16, 0, 5);
+	MessageScriptTest_CheckMessage(&script, 51, 298000000, 0x16, 0, 5);
+	MessageScriptTest_CheckMessage(&script, 52, 1000000000, 0x35, 0x4242, 2);
+	MessageScriptTest_CheckMessage(&script, 519, 9298000000, 0x16, 0, 5);
+
+	// Ties are sent in script order, even across repeats; fractional milliseconds, CRLF and full 64-bit parameters.
+	MessageScriptTest_Parse(&script,
+		"10 1 0\r\n"
+		"5 2 0 # Comment\r\n"
+		"\t10   3   0\r\n"
+		"5 4 0 repeat 2 every 5\r\n"
+		"0.0015 0xFFFFFFFFFFFFFFFF 18446744073709551615");
+	WindowInvestigator_Test_CHECK(script.messageCount == 6 && script.loopCount == 1 && script.loopPeriodNanoseconds == 0);
+	MessageScriptTest_CheckMessage(&script, 0, 1500, UINT64_MAX, UINT64_MAX, 5);
+	MessageScriptTest_CheckMessage(&script, 1, 5000000, 2, 0, 2);
+	MessageScriptTest_CheckMessage(&script, 2, 5000000, 4, 0, 4);
+	MessageScriptTest_CheckMessage(&script, 3, 10000000, 1, 0, 1);
+	MessageScriptTest_CheckMessage(&script, 4, 10000000, 3, 0, 3);
+	MessageScriptTest_CheckMessage(&script, 5, 10000000, 4, 0, 4);
+
+	// A loop period can be as short as the script, and a single loop ignores its period.
+	MessageScriptTest_Parse(&script, "loop 3 every 10\n0 1 1\n10 2 2");
+	MessageScriptTest_CheckMessage(&script, 2, 10000000, 1, 1, 2);
+	MessageScriptTest_Parse(&script, "0 1 1\n50 2 2\nloop 1 every 10");
+	WindowInvestigator_Test_CHECK(script.loopPeriodNanoseconds == 0 && WindowInvestigator_MessageScript_GetMessageCount(&script) == 2);
+
+	MessageScriptTest_Parse(&script, "# Nothing to send\n\n");
+	WindowInvestigator_Test_CHECK(WindowInvestigator_MessageScript_GetMessageCount(&script) == 0);
+
+	WindowInvestigator_MessageScript_Destroy(&script);
+}
+
+static void MessageScriptTest_CheckErrors(void) {
+	static const struct {
+		const char* text;
+		size_t line;
+	} errors[] = {
+		{ "0 1", 1 },
+		{ "0 1 2\n\nhello 1 2", 3 },
+		{ "-1 1 2", 1 },
+		{ "nan 1 2", 1 },
+		{ "1e14 1 2", 1 },
+		{ "0 -1 2", 1 },
+		{ "0 1 0x10000000000000000", 1 },
+		{ "0 1 2 3", 1 },
+		{ "0 1 2 repeat", 1 },
+		{ "0 1 2 repeat 0 every 1", 1 },
+		{ "0 1 2 repeat 2 each 1", 1 },
+		{ "0 1 2 repeat 2 every", 1 },
+		{ "0 1 2 repeat 2 every 1 extra", 1 },
+		{ "0 1 2 repeat 16777217 every 0", 1 },
+		{ "0 1 2 repeat 1000000 every 1e12", 1 },
+		{ "0 1 2 00000000000000000000000000000000000000000000000000000000000000000000001", 1 },
+		{ "loop 0 every 10\n0 1 2", 1 },
+		{ "loop 2\n0 1 2", 1 },
+		{ "loop 2 every 10 extra\n0 1 2", 1 },
+		{ "loop 2 every 10\n0 1 2\nloop 2 every 10", 3 },
+		// The period is checked once the whole script is known, and reported on the loop line.
+		{ "0 1 2\nloop 2 every 10\n11 1 2", 2 },
+		{ "0 1 2\nloop 18446744073709551615 every 1000", 2 },
+	};
+
+	WindowInvestigator_MessageScript script;
+	WindowInvestigator_MessageScript_Init(&script);
+	for (size_t index = 0; index < sizeof(errors) / sizeof(*errors); ++index) {
+		MessageScriptTest_Parse(&script, "0 1 2\nloop 2 every 10");
+		size_t errorLine = 0;
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_MessageScript_Parse(&script, errors[index].text, &errorLine));
+		WindowInvestigator_Test_CHECK(errorLine == errors[index].line);
+		// The script is left empty.
+		WindowInvestigator_Test_CHECK(WindowInvestigator_MessageScript_GetMessageCount(&script) == 0 && script.messages == NULL);
+	}
+	WindowInvestigator_MessageScript_Destroy(&script);
+}
+
+typedef struct {
+	uint64_t offsetNanoseconds;
+	uint64_t wParam;
+	size_t line;
+} MessageScriptTest_Message;
+
+// Offsets are whole milliseconds in a small range, so that many messages are due at the same time.
+static void MessageScriptTest_CheckRandomScripts(void) {
+	static char text[MessageScriptTest_MAX_ENTRIES * 64 + 64];
+	static MessageScriptTest_Message expected[MessageScriptTest_MAX_MESSAGES];
+	uint64_t random = 1;
+	WindowInvestigator_MessageScript script;
+	WindowInvestigator_MessageScript_Init(&script);
+	for (int iteration = 0; iteration < 5000; ++iteration) {
+		const size_t entryCount = WindowInvestigator_Test_RandomIndex(&random, MessageScriptTest_MAX_ENTRIES + 1);
+		const bool loop = WindowInvestigator_Test_Random(&random) % 2 == 0;
+		size_t length = 0;
+		size_t expectedCount = 0;
+		uint64_t lastOffset = 0;
+		for (size_t entry = 0; entry < entryCount; ++entry) {
+			const uint64_t offset = WindowInvestigator_Test_RandomIndex(&random, 20);
+			const uint64_t wParam = WindowInvestigator_Test_Random(&random);
+			const uint64_t repeatCount = 1 + WindowInvestigator_Test_RandomIndex(&random, MessageScriptTest_MAX_REPEATS);
+			const uint64_t interval = WindowInvestigator_Test_RandomIndex(&random, 4);
+			length += (size_t)sprintf(text + length, "%u 0x%llx %zu", (unsigned)offset, (unsigned long long)wParam, entry);
+			if (repeatCount > 1 || WindowInvestigator_Test_Random(&random) % 2 == 0)
+				length += (size_t)sprintf(text + length, " repeat %u every %u", (unsigned)repeatCount, (unsigned)interval);
+			length += (size_t)sprintf(text + length, "\n");
+			// Insert in order of offset, after the messages due at the same time: since entries are in script order, this
+			// is the order of the script.
+			for (uint64_t repeat = 0; repeat < repeatCount; ++repeat) {
+				const uint64_t offsetNanoseconds = (offset + repeat * interval) * 1000000;
+				size_t position = expectedCount;
+				while (position > 0 && expected[position - 1].offsetNanoseconds > offsetNanoseconds) {
+					expected[position] = expected[position - 1];
+					--position;
+				}
+				expected[position].offsetNanoseconds = offsetNanoseconds;
+				expected[position].wParam = wParam;
+				expected[position].line = entry + 1;
+				++expectedCount;
+				if (offsetNanoseconds > lastOffset) lastOffset = offsetNanoseconds;
+			}
+		}
+		const uint64_t loopCount = loop ? 1 + WindowInvestigator_Test_RandomIndex(&random, 3) : 1;
+		const uint64_t loopPeriodNanoseconds = loop ? lastOffset + WindowInvestigator_Test_RandomIndex(&random, 3) * 1000000 : 0;
+		text[length] = '\0';
+		if (loop) sprintf(text + length, "loop %u every %u\n", (unsigned)loopCount, (unsigned)(loopPeriodNanoseconds / 1000000));
+
+		MessageScriptTest_Parse(&script, text);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_MessageScript_GetMessageCount(&script) == expectedCount * loopCount);
+		for (uint64_t index = 0; index < expectedCount * loopCount; ++index) {
+			const MessageScriptTest_Message* const message = &expected[index % expectedCount];
+			// The loop line is last, so it does not shift the entry lines.
+			MessageScriptTest_CheckMessage(&script, index, message->offsetNanoseconds + (loopCount == 1 ? 0 : index / expectedCount * loopPeriodNanoseconds), message->wParam, message->line - 1, message->line);
+		}
+	}
+	WindowInvestigator_MessageScript_Destroy(&script);
+}
+
+int main(void) {
+	MessageScriptTest_CheckParse();
+	MessageScriptTest_CheckErrors();
+	MessageScriptTest_CheckRandomScripts();
+	printf("Message scripts OK\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+#include "../common/record_ring.h"
+#include "../common/atomic.h"
+#include "../common/thread.h"
+
+#include "test.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sched.h>
+#endif
+
+// Checks the single-producer, single-consumer ring: a producer thread writes numbered records into a ring small enough to
+// wrap around all the time and to fill up, while a consumer thread reads them at an uneven pace. Every record that is not
+// dropped must be received exactly once, in order and intact, and the dropped count must account for all the others. When
+// the ring is full, the producer usually waits for the consumer instead of dropping the record, so that both outcomes are
+// common even on a single CPU.
+
+#define RecordRingTest_CAPACITY 16
+#define RecordRingTest_RECORD_COUNT 1000000
+
+typedef struct {
+	uint64_t sequence;
+	// Derived from the sequence number, to detect records that are read before they are completely written.
+	uint64_t check[3];
+} RecordRingTest_Record;
+
+typedef struct {
+	WindowInvestigator_RecordRing ring;
+	// Set by the producer for each record that the ring refused, and by the consumer for each record it received.
+	bool* dropped;
+	bool* received;
+	volatile uint64_t producerDone;
+	uint64_t receivedCount;
+	uint64_t maxHighWaterMark;
+} RecordRingTest_State;
+
+static uint64_t RecordRingTest_GetCheck(uint64_t sequence, size_t index) {
+	return (sequence + index + 1) * UINT64_C(0x9E3779B97F4A7C15);
+}
+
+static void RecordRingTest_Yield(void) {
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+// Spins for a random number of iterations, so that the two threads take turns being the faster one.
+static void RecordRingTest_Stall(uint64_t* random) {
+	if (WindowInvestigator_Test_Random(random) % 64 != 0) return;
+	const size_t iterations = WindowInvestigator_Test_RandomIndex(random, 2000);
+	for (volatile size_t iteration = 0; iteration < iterations; ++iteration) {}
+}
+
+static void RecordRingTest_Produce(void* context) {
+	RecordRingTest_State* const state = context;
+	uint64_t random = 1;
+	for (uint64_t sequence = 0; sequence < RecordRingTest_RECORD_COUNT; ++sequence) {
+		while (WindowInvestigator_RecordRing_GetCount(&state->ring) == state->ring.capacity && WindowInvestigator_Test_Random(&random) % 8 != 0)
+			RecordRingTest_Yield();
+		RecordRingTest_Record* const record = WindowInvestigator_RecordRing_BeginWrite(&state->ring);
+		if (record == NULL) {
+			state->dropped[sequence] = true;
+		}
+		else {
+			record->sequence = sequence;
+			for (size_t index = 0; index < 3; ++index) record->check[index] = RecordRingTest_GetCheck(sequence, index);
+			WindowInvestigator_RecordRing_EndWrite(&state->ring);
+		}
+		const uint64_t highWaterMark = WindowInvestigator_RecordRing_GetHighWaterMark(&state->ring);
+		WindowInvestigator_Test_CHECK(highWaterMark <= state->ring.capacity);
+		if (highWaterMark > state->maxHighWaterMark) state->maxHighWaterMark = highWaterMark;
+		RecordRingTest_Stall(&random);
+	}
+	WindowInvestigator_Atomic_StoreRelease(&state->producerDone, 1);
+}
+
+static void RecordRingTest_Consume(void* context) {
+	RecordRingTest_State* const state = context;
+	uint64_t random = 2;
+	uint64_t nextSequence = 0;
+	for (;;) {
+		// Read the flag first: once it is set, every record has been published, so an empty ring means we are done.
+		const bool producerDone = WindowInvestigator_Atomic_LoadAcquire(&state->producerDone) != 0;
+		const RecordRingTest_Record* const record = WindowInvestigator_RecordRing_BeginRead(&state->ring);
+		if (record == NULL) {
+			if (producerDone) break;
+			RecordRingTest_Yield();
+			continue;
+		}
+		WindowInvestigator_Test_CHECK(record->sequence >= nextSequence && record->sequence < RecordRingTest_RECORD_COUNT);
+		for (size_t index = 0; index < 3; ++index) WindowInvestigator_Test_CHECK(record->check[index] == RecordRingTest_GetCheck(record->sequence, index));
+		state->received[record->sequence] = true;
+		nextSequence = record->sequence + 1;
+		++state->receivedCount;
+		WindowInvestigator_RecordRing_EndRead(&state->ring);
+		RecordRingTest_Stall(&random);
+	}
+}
+
+static void RecordRingTest_CheckConcurrent(void) {
+	static RecordRingTest_State state;
+	memset(&state, 0, sizeof(state));
+	WindowInvestigator_RecordRing_Init(&state.ring, sizeof(RecordRingTest_Record), RecordRingTest_CAPACITY);
+	state.dropped = calloc(RecordRingTest_RECORD_COUNT, sizeof(*state.dropped));
+	state.received = calloc(RecordRingTest_RECORD_COUNT, sizeof(*state.received));
+	WindowInvestigator_Test_CHECK(state.dropped != NULL && state.received != NULL);
+
+	WindowInvestigator_Thread producer;
+	WindowInvestigator_Thread consumer;
+	WindowInvestigator_Thread_Start(&consumer, RecordRingTest_Consume, &state);
+	WindowInvestigator_Thread_Start(&producer, RecordRingTest_Produce, &state);
+	WindowInvestigator_Thread_Join(&producer);
+	WindowInvestigator_Thread_Join(&consumer);
+
+	// Every record was either dropped or received, never both, and never received twice (sequence numbers strictly increase).
+	uint64_t droppedCount = 0;
+	for (uint64_t sequence = 0; sequence < RecordRingTest_RECORD_COUNT; ++sequence) {
+		WindowInvestigator_Test_CHECK(state.dropped[sequence] != state.received[sequence]);
+		if (state.dropped[sequence]) ++droppedCount;
+	}
+	WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetDroppedCount(&state.ring) == droppedCount);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetDroppedCount(&state.ring) + state.receivedCount == RecordRingTest_RECORD_COUNT);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetCount(&state.ring) == 0);
+	WindowInvestigator_Test_CHECK(state.maxHighWaterMark <= RecordRingTest_CAPACITY);
+
+	printf("%d records: %" PRIu64 " received, %" PRIu64 " dropped, high-water mark %" PRIu64 " of %d\n",
+		RecordRingTest_RECORD_COUNT, state.receivedCount, droppedCount, state.maxHighWaterMark, RecordRingTest_CAPACITY);
+	free(state.dropped);
+	free(state.received);
+	WindowInvestigator_RecordRing_Destroy(&state.ring);
+}
+
+// Single-threaded: the capacity is rounded up, a full ring refuses records without overwriting the oldest ones, and reading
+// makes room again.
+static void RecordRingTest_CheckFull(void) {
+	WindowInvestigator_RecordRing ring;
+	WindowInvestigator_RecordRing_Init(&ring, sizeof(uint64_t), 5);
+	WindowInvestigator_Test_CHECK(ring.capacity == 8);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_BeginRead(&ring) == NULL);
+
+	for (uint64_t round = 0; round < 3; ++round) {
+		for (uint64_t index = 0; index < 8; ++index) {
+			uint64_t* const slot = WindowInvestigator_RecordRing_BeginWrite(&ring);
+			WindowInvestigator_Test_CHECK(slot != NULL);
+			*slot = round * 100 + index;
+			WindowInvestigator_RecordRing_EndWrite(&ring);
+		}
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetCount(&ring) == 8);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_BeginWrite(&ring) == NULL);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_BeginWrite(&ring) == NULL);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetDroppedCount(&ring) == (round + 1) * 2);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetHighWaterMark(&ring) == 8);
+
+		// Read all but the last one, then the last one after the ring wrapped around.
+		for (uint64_t index = 0; index < 7; ++index) {
+			const uint64_t* const slot = WindowInvestigator_RecordRing_BeginRead(&ring);
+			WindowInvestigator_Test_CHECK(slot != NULL && *slot == round * 100 + index);
+			WindowInvestigator_RecordRing_EndRead(&ring);
+		}
+		const uint64_t* const slot = WindowInvestigator_RecordRing_BeginRead(&ring);
+		WindowInvestigator_Test_CHECK(slot != NULL && *slot == round * 100 + 7);
+		WindowInvestigator_RecordRing_EndRead(&ring);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_BeginRead(&ring) == NULL);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_RecordRing_GetCount(&ring) == 0);
+	}
+	WindowInvestigator_RecordRing_Destroy(&ring);
+}
+
+int main(void) {
+	RecordRingTest_CheckFull();
+	RecordRingTest_CheckConcurrent();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,338 @@
+#include "../common/rude_window.h"
+
+#include "test.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Checks the incremental rude window engine against a from-scratch evaluation: random windows are added, removed, moved and
+// changed, one field at a time, over a few table passes between evaluations, and the engine is told about the changes the way
+// WindowMonitor tells it. After every evaluation, the verdict of every monitor must be the one obtained by walking the whole
+// Z-order and recomputing every window, and the sink must have been told about exactly the monitors whose verdict changed.
+//
+// Window handles are drawn from a small pool, so handles (and table slots) are reused all the time, including a window going
+// away and coming back with the same handle in the same slot, with different properties (the case that slot generations are
+// there for).
+
+#define RudeWindowTest_MAX_WINDOWS 64
+#define RudeWindowTest_HANDLE_COUNT 48
+#define RudeWindowTest_STEPS 20000
+
+// Same values as the Windows SDK definitions.
+#define RudeWindowTest_WS_EX_TOPMOST 0x00000008
+#define RudeWindowTest_ZBID_DESKTOP 1
+#define RudeWindowTest_ZBID_UIACCESS 2
+
+// Two layouts, so that switching between them changes both the rects and the number of monitors. Neighbouring monitors share
+// an edge.
+static const WindowInvestigator_Rect RudeWindowTest_layouts[2][3] = {
+	{ { 0, 0, 1920, 1080 }, { 1920, 0, 3840, 1080 }, { -1280, 0, 0, 1024 } },
+	{ { 0, 0, 2560, 1440 }, { 2560, 0, 3640, 1920 } },
+};
+static const size_t RudeWindowTest_layoutMonitorCounts[2] = { 3, 2 };
+
+typedef struct {
+	// Model of the desktop, frontmost window first.
+	uintptr_t windows[RudeWindowTest_MAX_WINDOWS];
+	WindowInvestigator_WindowInfo windowInfos[RudeWindowTest_MAX_WINDOWS];
+	size_t windowCount;
+	size_t layout;
+
+	WindowInvestigator_WindowTable table;
+	WindowInvestigator_RudeWindowEngine engine;
+	// What the sink was told, per monitor.
+	uintptr_t reportedWindows[WindowInvestigator_RudeWindowEngine_MAX_MONITORS];
+	uint64_t reportedChanges;
+} RudeWindowTest_State;
+
+static void RudeWindowTest_OnRudeWindowChanged(void* context, size_t monitor, const WindowInvestigator_Rect* monitorRect, uintptr_t previousWindow, uintptr_t window) {
+	RudeWindowTest_State* const state = context;
+	WindowInvestigator_Test_CHECK(monitor < RudeWindowTest_layoutMonitorCounts[state->layout]);
+	WindowInvestigator_Test_CHECK(memcmp(monitorRect, &RudeWindowTest_layouts[state->layout][monitor], sizeof(*monitorRect)) == 0);
+	WindowInvestigator_Test_CHECK(previousWindow == state->reportedWindows[monitor]);
+	WindowInvestigator_Test_CHECK(window != previousWindow);
+	state->reportedWindows[monitor] = window;
+	++state->reportedChanges;
+}
+
+// A rect that is interesting for the current layout: exactly a monitor, a maximized window that overhangs it, a window that is
+// slightly too small, one that spans two monitors, one that only touches a monitor edge, or an empty one.
+static WindowInvestigator_Rect RudeWindowTest_GetRandomRect(const RudeWindowTest_State* state, uint64_t* random) {
+	const size_t monitorCount = RudeWindowTest_layoutMonitorCounts[state->layout];
+	const WindowInvestigator_Rect* const monitor = &RudeWindowTest_layouts[state->layout][WindowInvestigator_Test_RandomIndex(random, monitorCount)];
+	WindowInvestigator_Rect rect = *monitor;
+	switch (WindowInvestigator_Test_RandomIndex(random, 6)) {
+	case 0:
+		break;
+	case 1:
+		rect.left -= 8;
+		rect.top -= 8;
+		rect.right += 8;
+		rect.bottom += 8;
+		break;
+	case 2:
+		rect.bottom -= 40;
+		break;
+	case 3: {
+		const WindowInvestigator_Rect* const other = &RudeWindowTest_layouts[state->layout][WindowInvestigator_Test_RandomIndex(random, monitorCount)];
+		if (other->left < rect.left) rect.left = other->left;
+		if (other->top < rect.top) rect.top = other->top;
+		if (other->right > rect.right) rect.right = other->right;
+		if (other->bottom > rect.bottom) rect.bottom = other->bottom;
+		break;
+	}
+	case 4:
+		rect.left = rect.right;
+		rect.right += 300;
+		break;
+	default:
+		rect.right = rect.left;
+		rect.bottom = rect.top;
+	}
+	return rect;
+}
+
+// Most windows are relevant and fullscreen-capable, so that verdicts change often; each property can still go the other way.
+static void RudeWindowTest_SetRandomField(const RudeWindowTest_State* state, WindowInvestigator_WindowInfo* windowInfo, WindowInvestigator_WindowField field, uint64_t* random) {
+	const bool usual = WindowInvestigator_Test_Random(random) % 4 != 0;
+	switch (field) {
+	case WindowInvestigator_WindowField_EXTENDED_STYLES: windowInfo->extendedStyles = usual ? 0 : RudeWindowTest_WS_EX_TOPMOST; break;
+	case WindowInvestigator_WindowField_STYLES: windowInfo->styles = (uint32_t)WindowInvestigator_Test_Random(random); break;
+	case WindowInvestigator_WindowField_WINDOW_RECT: windowInfo->windowRect = RudeWindowTest_GetRandomRect(state, random); break;
+	case WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW: windowInfo->isShellManagedWindow = usual; break;
+	case WindowInvestigator_WindowField_BAND: windowInfo->band = usual ? RudeWindowTest_ZBID_DESKTOP : RudeWindowTest_ZBID_UIACCESS; break;
+	case WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY: windowInfo->hasNonRudeHWNDProperty = !usual; break;
+	case WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY: windowInfo->hasNonRudeAddedByRudeWindowFixerProperty = !usual; break;
+	case WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY: windowInfo->hasLivePreviewWindowProperty = !usual; break;
+	case WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY: windowInfo->hasTreatAsDesktopFullscreenProperty = !usual; break;
+	case WindowInvestigator_WindowField_IS_WINDOW: windowInfo->isWindow = usual; break;
+	case WindowInvestigator_WindowField_DWM_IS_CLOAKED: windowInfo->dwmIsCloaked = usual ? 0 : 2; break;
+	case WindowInvestigator_WindowField_IS_ICONIC: windowInfo->isIconic = !usual; break;
+	case WindowInvestigator_WindowField_IS_VISIBLE: windowInfo->isVisible = usual; break;
+	default: WindowInvestigator_Test_CHECK(false);
+	}
+}
+
+// The fields that RudeWindowTest_SetRandomField() knows about: every field the verdict depends on, and one it does not.
+static const WindowInvestigator_WindowField RudeWindowTest_fields[] = {
+	WindowInvestigator_WindowField_EXTENDED_STYLES, WindowInvestigator_WindowField_STYLES, WindowInvestigator_WindowField_WINDOW_RECT,
+	WindowInvestigator_WindowField_IS_SHELL_MANAGED_WINDOW, WindowInvestigator_WindowField_BAND, WindowInvestigator_WindowField_HAS_NON_RUDE_HWND_PROPERTY,
+	WindowInvestigator_WindowField_HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY, WindowInvestigator_WindowField_HAS_LIVE_PREVIEW_WINDOW_PROPERTY,
+	WindowInvestigator_WindowField_HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY, WindowInvestigator_WindowField_IS_WINDOW, WindowInvestigator_WindowField_DWM_IS_CLOAKED,
+	WindowInvestigator_WindowField_IS_ICONIC, WindowInvestigator_WindowField_IS_VISIBLE,
+};
+#define RudeWindowTest_FIELD_COUNT (sizeof(RudeWindowTest_fields) / sizeof(*RudeWindowTest_fields))
+
+static void RudeWindowTest_GetRandomWindowInfo(const RudeWindowTest_State* state, WindowInvestigator_WindowInfo* windowInfo, uint64_t* random) {
+	memset(windowInfo, 0, sizeof(*windowInfo));
+	for (size_t fieldIndex = 0; fieldIndex < RudeWindowTest_FIELD_COUNT; ++fieldIndex)
+		RudeWindowTest_SetRandomField(state, windowInfo, RudeWindowTest_fields[fieldIndex], random);
+}
+
+static size_t RudeWindowTest_IndexOf(const RudeWindowTest_State* state, uintptr_t window) {
+	for (size_t index = 0; index < state->windowCount; ++index)
+		if (state->windows[index] == window) return index;
+	return SIZE_MAX;
+}
+
+static void RudeWindowTest_Insert(RudeWindowTest_State* state, size_t index, uintptr_t window, const WindowInvestigator_WindowInfo* windowInfo) {
+	memmove(&state->windows[index + 1], &state->windows[index], (state->windowCount - index) * sizeof(*state->windows));
+	memmove(&state->windowInfos[index + 1], &state->windowInfos[index], (state->windowCount - index) * sizeof(*state->windowInfos));
+	state->windows[index] = window;
+	state->windowInfos[index] = *windowInfo;
+	++state->windowCount;
+}
+
+static void RudeWindowTest_Remove(RudeWindowTest_State* state, size_t index, WindowInvestigator_WindowInfo* windowInfo) {
+	if (windowInfo != NULL) *windowInfo = state->windowInfos[index];
+	--state->windowCount;
+	memmove(&state->windows[index], &state->windows[index + 1], (state->windowCount - index) * sizeof(*state->windows));
+	memmove(&state->windowInfos[index], &state->windowInfos[index + 1], (state->windowCount - index) * sizeof(*state->windowInfos));
+}
+
+// Mirrors the model into the table, as a monitor pass would.
+static void RudeWindowTest_RunPass(RudeWindowTest_State* state) {
+	WindowInvestigator_WindowTable_BeginPass(&state->table);
+	for (size_t index = 0; index < state->windowCount; ++index) {
+		WindowInvestigator_WindowTable_VisitResult visitResult;
+		const size_t slot = WindowInvestigator_WindowTable_Visit(&state->table, state->windows[index], &visitResult);
+		WindowInvestigator_Test_CHECK(visitResult != WindowInvestigator_WindowTable_ALREADY_VISITED);
+		*(WindowInvestigator_WindowInfo*)WindowInvestigator_WindowTable_GetValue(&state->table, slot) = state->windowInfos[index];
+	}
+	const WindowInvestigator_WindowTable_PassCallbacks passCallbacks = { 0 };
+	WindowInvestigator_WindowTable_EndPass(&state->table, &passCallbacks);
+}
+
+// The verdict of a monitor, straight from the definition in rude_window.h.
+static uintptr_t RudeWindowTest_GetRudeWindow(const RudeWindowTest_State* state, const WindowInvestigator_Rect* monitor) {
+	for (size_t index = 0; index < state->windowCount; ++index) {
+		const WindowInvestigator_WindowInfo* const windowInfo = &state->windowInfos[index];
+		const WindowInvestigator_Rect* const rect = &windowInfo->windowRect;
+		const bool relevant = windowInfo->isWindow && windowInfo->isVisible && !windowInfo->isIconic && windowInfo->dwmIsCloaked == 0 &&
+			windowInfo->band == RudeWindowTest_ZBID_DESKTOP && (windowInfo->extendedStyles & RudeWindowTest_WS_EX_TOPMOST) == 0 &&
+			rect->left < monitor->right && monitor->left < rect->right && rect->top < monitor->bottom && monitor->top < rect->bottom;
+		if (!relevant) continue;
+		const bool valid = (windowInfo->isShellManagedWindow || windowInfo->hasTreatAsDesktopFullscreenProperty) &&
+			!windowInfo->hasNonRudeHWNDProperty && !windowInfo->hasNonRudeAddedByRudeWindowFixerProperty && !windowInfo->hasLivePreviewWindowProperty;
+		const bool covers = rect->left <= monitor->left && rect->top <= monitor->top && rect->right >= monitor->right && rect->bottom >= monitor->bottom;
+		return valid && covers ? state->windows[index] : 0;
+	}
+	return 0;
+}
+
+static void RudeWindowTest_Evaluate(RudeWindowTest_State* state) {
+	WindowInvestigator_RudeWindowEngine_Evaluate(&state->engine);
+	const size_t monitorCount = RudeWindowTest_layoutMonitorCounts[state->layout];
+	WindowInvestigator_Test_CHECK(state->engine.monitorCount == monitorCount);
+	for (size_t monitor = 0; monitor < monitorCount; ++monitor) {
+		const uintptr_t rudeWindow = RudeWindowTest_GetRudeWindow(state, &RudeWindowTest_layouts[state->layout][monitor]);
+		WindowInvestigator_Test_CHECK(state->engine.rudeWindows[monitor] == rudeWindow);
+		WindowInvestigator_Test_CHECK(state->reportedWindows[monitor] == rudeWindow);
+	}
+}
+
+static void RudeWindowTest_Init(RudeWindowTest_State* state) {
+	memset(state, 0, sizeof(*state));
+	WindowInvestigator_WindowTable_Init(&state->table, sizeof(WindowInvestigator_WindowInfo));
+	WindowInvestigator_RudeWindowSink sink;
+	sink.onRudeWindowChanged = RudeWindowTest_OnRudeWindowChanged;
+	sink.context = state;
+	WindowInvestigator_RudeWindowEngine_Init(&state->engine, &state->table, &sink);
+	WindowInvestigator_RudeWindowEngine_SetMonitors(&state->engine, RudeWindowTest_layouts[0], RudeWindowTest_layoutMonitorCounts[0]);
+}
+
+static void RudeWindowTest_Destroy(RudeWindowTest_State* state) {
+	WindowInvestigator_RudeWindowEngine_Destroy(&state->engine);
+	WindowInvestigator_WindowTable_Destroy(&state->table);
+}
+
+static void RudeWindowTest_CheckRandom(void) {
+	static RudeWindowTest_State state;
+	RudeWindowTest_Init(&state);
+	uint64_t random = 1;
+	// Windows that went away during the previous pass, to come back with the same handle during the next one.
+	uintptr_t returningWindows[RudeWindowTest_MAX_WINDOWS];
+	size_t returningWindowCount = 0;
+
+	for (uint64_t step = 0; step < RudeWindowTest_STEPS; ++step) {
+		const size_t passCount = 1 + WindowInvestigator_Test_RandomIndex(&random, 3);
+		for (size_t pass = 0; pass < passCount; ++pass) {
+			bool zOrderChanged = false;
+			for (size_t returning = 0; returning < returningWindowCount; ++returning) {
+				if (RudeWindowTest_IndexOf(&state, returningWindows[returning]) != SIZE_MAX || state.windowCount == RudeWindowTest_MAX_WINDOWS) continue;
+				WindowInvestigator_WindowInfo windowInfo;
+				RudeWindowTest_GetRandomWindowInfo(&state, &windowInfo, &random);
+				RudeWindowTest_Insert(&state, WindowInvestigator_Test_RandomIndex(&random, state.windowCount + 1), returningWindows[returning], &windowInfo);
+				WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&state.engine, returningWindows[returning], WindowInvestigator_WindowField_ALL);
+				zOrderChanged = true;
+			}
+			returningWindowCount = 0;
+
+			const size_t changeCount = WindowInvestigator_Test_RandomIndex(&random, 4);
+			for (size_t change = 0; change < changeCount; ++change) {
+				const size_t operation = WindowInvestigator_Test_RandomIndex(&random, 10);
+				if (operation <= 4 && state.windowCount != 0) {
+					// Change a single field.
+					const size_t index = WindowInvestigator_Test_RandomIndex(&random, state.windowCount);
+					const WindowInvestigator_WindowField field = RudeWindowTest_fields[WindowInvestigator_Test_RandomIndex(&random, RudeWindowTest_FIELD_COUNT)];
+					const WindowInvestigator_WindowInfo previousWindowInfo = state.windowInfos[index];
+					RudeWindowTest_SetRandomField(&state, &state.windowInfos[index], field, &random);
+					const uint32_t changedFields = WindowInvestigator_DiffWindowInfo(&previousWindowInfo, &state.windowInfos[index]);
+					if (changedFields != 0) WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&state.engine, state.windows[index], changedFields);
+				}
+				else if (operation <= 6 && state.windowCount < RudeWindowTest_MAX_WINDOWS) {
+					const uintptr_t window = 0x10000 + 0x10 * WindowInvestigator_Test_RandomIndex(&random, RudeWindowTest_HANDLE_COUNT);
+					if (RudeWindowTest_IndexOf(&state, window) != SIZE_MAX) continue;
+					WindowInvestigator_WindowInfo windowInfo;
+					RudeWindowTest_GetRandomWindowInfo(&state, &windowInfo, &random);
+					RudeWindowTest_Insert(&state, WindowInvestigator_Test_RandomIndex(&random, state.windowCount + 1), window, &windowInfo);
+					WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&state.engine, window, WindowInvestigator_WindowField_ALL);
+					zOrderChanged = true;
+				}
+				else if (operation == 7 && state.windowCount != 0) {
+					const size_t index = WindowInvestigator_Test_RandomIndex(&random, state.windowCount);
+					// Half of the time, the handle comes back right away.
+					if (WindowInvestigator_Test_Random(&random) % 2 == 0) returningWindows[returningWindowCount++] = state.windows[index];
+					RudeWindowTest_Remove(&state, index, NULL);
+					zOrderChanged = true;
+				}
+				else if (operation == 8 && state.windowCount != 0) {
+					WindowInvestigator_WindowInfo windowInfo;
+					const uintptr_t window = state.windows[WindowInvestigator_Test_RandomIndex(&random, state.windowCount)];
+					RudeWindowTest_Remove(&state, RudeWindowTest_IndexOf(&state, window), &windowInfo);
+					RudeWindowTest_Insert(&state, WindowInvestigator_Test_RandomIndex(&random, state.windowCount + 1), window, &windowInfo);
+					zOrderChanged = true;
+				}
+				else if (operation == 9 && WindowInvestigator_Test_Random(&random) % 16 == 0) {
+					state.layout ^= 1;
+					WindowInvestigator_RudeWindowEngine_SetMonitors(&state.engine, RudeWindowTest_layouts[state.layout], RudeWindowTest_layoutMonitorCounts[state.layout]);
+					// Monitors that went away are not rude anymore, without the sink being told.
+					for (size_t monitor = RudeWindowTest_layoutMonitorCounts[state.layout]; monitor < WindowInvestigator_RudeWindowEngine_MAX_MONITORS; ++monitor)
+						state.reportedWindows[monitor] = 0;
+				}
+			}
+			RudeWindowTest_RunPass(&state);
+			if (zOrderChanged) WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(&state.engine);
+		}
+		RudeWindowTest_Evaluate(&state);
+	}
+	printf("%d steps: %" PRIu64 " rude window changes, %" PRIu64 " Z-order walks, %" PRIu64 " inputs computed\n",
+		RudeWindowTest_STEPS, state.reportedChanges, state.engine.statistics.zOrderWalks, state.engine.statistics.inputsComputed);
+	WindowInvestigator_Test_CHECK(state.reportedChanges == state.engine.statistics.rudeWindowChanges);
+	RudeWindowTest_Destroy(&state);
+}
+
+// A fullscreen window goes away, and its handle comes back in the same slot as a window that is not fullscreen, in front of
+// another fullscreen window: the cached inputs of the slot must not be taken for those of the new window.
+static void RudeWindowTest_CheckSlotReuse(void) {
+	static RudeWindowTest_State state;
+	RudeWindowTest_Init(&state);
+	uint64_t random = 2;
+	WindowInvestigator_WindowInfo fullscreenWindowInfo;
+	RudeWindowTest_GetRandomWindowInfo(&state, &fullscreenWindowInfo, &random);
+	fullscreenWindowInfo.extendedStyles = 0;
+	fullscreenWindowInfo.windowRect = RudeWindowTest_layouts[0][0];
+	fullscreenWindowInfo.isShellManagedWindow = true;
+	fullscreenWindowInfo.band = RudeWindowTest_ZBID_DESKTOP;
+	fullscreenWindowInfo.hasNonRudeHWNDProperty = false;
+	fullscreenWindowInfo.hasNonRudeAddedByRudeWindowFixerProperty = false;
+	fullscreenWindowInfo.hasLivePreviewWindowProperty = false;
+	fullscreenWindowInfo.isWindow = true;
+	fullscreenWindowInfo.dwmIsCloaked = 0;
+	fullscreenWindowInfo.isIconic = false;
+	fullscreenWindowInfo.isVisible = true;
+
+	RudeWindowTest_Insert(&state, 0, 0x100, &fullscreenWindowInfo);
+	RudeWindowTest_Insert(&state, 1, 0x200, &fullscreenWindowInfo);
+	RudeWindowTest_RunPass(&state);
+	WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&state.engine, 0x100, WindowInvestigator_WindowField_ALL);
+	WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&state.engine, 0x200, WindowInvestigator_WindowField_ALL);
+	WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(&state.engine);
+	RudeWindowTest_Evaluate(&state);
+	WindowInvestigator_Test_CHECK(state.engine.rudeWindows[0] == 0x100);
+	const size_t slot = WindowInvestigator_WindowTable_Find(&state.table, 0x100);
+	const uint32_t generation = WindowInvestigator_WindowTable_GetGeneration(&state.table, slot);
+
+	// Gone for a pass, then back, before the next evaluation.
+	RudeWindowTest_Remove(&state, 0, NULL);
+	RudeWindowTest_RunPass(&state);
+	WindowInvestigator_WindowInfo windowInfo = fullscreenWindowInfo;
+	windowInfo.hasNonRudeHWNDProperty = true;
+	RudeWindowTest_Insert(&state, 0, 0x100, &windowInfo);
+	RudeWindowTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_Find(&state.table, 0x100) == slot);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_GetGeneration(&state.table, slot) != generation);
+	WindowInvestigator_RudeWindowEngine_MarkWindowChanged(&state.engine, 0x100, WindowInvestigator_WindowField_ALL);
+	WindowInvestigator_RudeWindowEngine_MarkZOrderChanged(&state.engine);
+	RudeWindowTest_Evaluate(&state);
+	// 0x100 is still in front, and still relevant, but not fullscreen anymore.
+	WindowInvestigator_Test_CHECK(state.engine.rudeWindows[0] == 0);
+	RudeWindowTest_Destroy(&state);
+}
+
+int main(void) {
+	RudeWindowTest_CheckSlotReuse();
+	RudeWindowTest_CheckRandom();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,334 @@
+#include "../common/spatial_index.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// Checks the spatial index on small hand-built desktops whose answers are known: rects that only touch along an edge do not
+// intersect, windows that span several cells or monitors (or extend beyond the grid) are found from every cell they cover,
+// moving, hiding and removing a window updates every query, and the topmost occluder is the frontmost window strictly in front,
+// whether it is found by walking the Z-order or by going through the cells.
+//
+// Cells are 100 pixels wide, so that rects can be placed exactly on and around cell boundaries.
+
+#define SpatialIndexTest_CELL_SIZE 100
+#define SpatialIndexTest_MAX_WINDOWS 32
+
+typedef struct {
+	// Model of the desktop, frontmost window first.
+	uintptr_t windows[SpatialIndexTest_MAX_WINDOWS];
+	WindowInvestigator_WindowInfo windowInfos[SpatialIndexTest_MAX_WINDOWS];
+	size_t windowCount;
+
+	WindowInvestigator_WindowTable table;
+	WindowInvestigator_SpatialIndex index;
+} SpatialIndexTest_State;
+
+static void SpatialIndexTest_OnWindowGone(void* context, uintptr_t window, void* value) {
+	(void)value;
+	SpatialIndexTest_State* const state = context;
+	WindowInvestigator_SpatialIndex_RemoveWindow(&state->index, window);
+}
+
+static void SpatialIndexTest_Init(SpatialIndexTest_State* state, const WindowInvestigator_Rect* monitors, size_t monitorCount) {
+	memset(state, 0, sizeof(*state));
+	WindowInvestigator_WindowTable_Init(&state->table, sizeof(WindowInvestigator_WindowInfo));
+	WindowInvestigator_SpatialIndex_Init(&state->index, &state->table, WindowInvestigator_SpatialIndexRect_WINDOW_RECT, SpatialIndexTest_CELL_SIZE);
+	WindowInvestigator_SpatialIndex_SetMonitors(&state->index, monitors, monitorCount);
+}
+
+static void SpatialIndexTest_Destroy(SpatialIndexTest_State* state) {
+	WindowInvestigator_SpatialIndex_Destroy(&state->index);
+	WindowInvestigator_WindowTable_Destroy(&state->table);
+}
+
+static size_t SpatialIndexTest_IndexOf(const SpatialIndexTest_State* state, uintptr_t window) {
+	for (size_t index = 0; index < state->windowCount; ++index)
+		if (state->windows[index] == window) return index;
+	WindowInvestigator_Test_CHECK(false);
+	return SIZE_MAX;
+}
+
+// Adds a visible window behind all the others.
+static WindowInvestigator_WindowInfo* SpatialIndexTest_Add(SpatialIndexTest_State* state, uintptr_t window, int32_t left, int32_t top, int32_t right, int32_t bottom) {
+	WindowInvestigator_Test_CHECK(state->windowCount < SpatialIndexTest_MAX_WINDOWS);
+	WindowInvestigator_WindowInfo* const windowInfo = &state->windowInfos[state->windowCount];
+	memset(windowInfo, 0, sizeof(*windowInfo));
+	windowInfo->isWindow = true;
+	windowInfo->isVisible = true;
+	windowInfo->windowRect.left = left;
+	windowInfo->windowRect.top = top;
+	windowInfo->windowRect.right = right;
+	windowInfo->windowRect.bottom = bottom;
+	state->windows[state->windowCount++] = window;
+	return windowInfo;
+}
+
+static void SpatialIndexTest_Remove(SpatialIndexTest_State* state, uintptr_t window) {
+	const size_t index = SpatialIndexTest_IndexOf(state, window);
+	--state->windowCount;
+	memmove(&state->windows[index], &state->windows[index + 1], (state->windowCount - index) * sizeof(*state->windows));
+	memmove(&state->windowInfos[index], &state->windowInfos[index + 1], (state->windowCount - index) * sizeof(*state->windowInfos));
+}
+
+// Mirrors the model into the table and the index, as the monitor sink of the index would.
+static void SpatialIndexTest_RunPass(SpatialIndexTest_State* state) {
+	WindowInvestigator_WindowTable_BeginPass(&state->table);
+	for (size_t index = 0; index < state->windowCount; ++index) {
+		WindowInvestigator_WindowTable_VisitResult visitResult;
+		const size_t slot = WindowInvestigator_WindowTable_Visit(&state->table, state->windows[index], &visitResult);
+		*(WindowInvestigator_WindowInfo*)WindowInvestigator_WindowTable_GetValue(&state->table, slot) = state->windowInfos[index];
+	}
+	WindowInvestigator_WindowTable_PassCallbacks passCallbacks = { 0 };
+	passCallbacks.onWindowGone = SpatialIndexTest_OnWindowGone;
+	passCallbacks.context = state;
+	WindowInvestigator_WindowTable_EndPass(&state->table, &passCallbacks);
+	for (size_t index = 0; index < state->windowCount; ++index)
+		WindowInvestigator_SpatialIndex_UpdateWindow(&state->index, state->windows[index], &state->windowInfos[index]);
+}
+
+typedef struct {
+	uintptr_t windows[SpatialIndexTest_MAX_WINDOWS];
+	size_t windowCount;
+} SpatialIndexTest_Overlapping;
+
+static void SpatialIndexTest_OnOverlappingWindow(void* context, uintptr_t window) {
+	SpatialIndexTest_Overlapping* const overlapping = context;
+	for (size_t index = 0; index < overlapping->windowCount; ++index) WindowInvestigator_Test_CHECK(overlapping->windows[index] != window);
+	WindowInvestigator_Test_CHECK(overlapping->windowCount < SpatialIndexTest_MAX_WINDOWS);
+	overlapping->windows[overlapping->windowCount++] = window;
+}
+
+// Returns a bitmask of the windows that overlap the rect, where window n is bit n.
+static uint32_t SpatialIndexTest_GetOverlapping(SpatialIndexTest_State* state, int32_t left, int32_t top, int32_t right, int32_t bottom) {
+	const WindowInvestigator_Rect rect = { left, top, right, bottom };
+	SpatialIndexTest_Overlapping overlapping = { { 0 }, 0 };
+	const size_t windowCount = WindowInvestigator_SpatialIndex_ForEachOverlappingWindow(&state->index, &rect, SpatialIndexTest_OnOverlappingWindow, &overlapping);
+	WindowInvestigator_Test_CHECK(windowCount == overlapping.windowCount);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_ForEachOverlappingWindow(&state->index, &rect, NULL, NULL) == windowCount);
+	uint32_t windows = 0;
+	for (size_t index = 0; index < overlapping.windowCount; ++index) {
+		WindowInvestigator_Test_CHECK(overlapping.windows[index] < 32);
+		windows |= (uint32_t)1 << overlapping.windows[index];
+	}
+	return windows;
+}
+
+static uintptr_t SpatialIndexTest_GetCovering(SpatialIndexTest_State* state, int32_t left, int32_t top, int32_t right, int32_t bottom) {
+	const WindowInvestigator_Rect rect = { left, top, right, bottom };
+	return WindowInvestigator_SpatialIndex_FindCoveringWindow(&state->index, &rect);
+}
+
+#define SpatialIndexTest_BIT(window) ((uint32_t)1 << (window))
+
+// Rects are half-open: windows that share an edge, including along a cell boundary, do not overlap or occlude each other.
+static void SpatialIndexTest_CheckEdges(void) {
+	static SpatialIndexTest_State state;
+	const WindowInvestigator_Rect monitor = { 0, 0, 1000, 1000 };
+	SpatialIndexTest_Init(&state, &monitor, 1);
+	SpatialIndexTest_Add(&state, 1, 0, 0, 100, 100);
+	SpatialIndexTest_Add(&state, 2, 100, 0, 200, 100);
+	SpatialIndexTest_Add(&state, 3, 0, 100, 100, 200);
+	SpatialIndexTest_Add(&state, 4, 150, 150, 250, 250);
+	// Same, within a single cell.
+	SpatialIndexTest_Add(&state, 5, 310, 310, 350, 350);
+	SpatialIndexTest_Add(&state, 6, 350, 310, 390, 350);
+	SpatialIndexTest_RunPass(&state);
+
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 100, 100) == SpatialIndexTest_BIT(1));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 99, 99, 101, 101) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(2) | SpatialIndexTest_BIT(3)));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 100, 100, 150, 150) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 100, 100, 151, 151) == SpatialIndexTest_BIT(4));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 250, 0, 300, 1000) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 310, 310, 350, 350) == SpatialIndexTest_BIT(5));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 350, 350, 390, 390) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 349, 349, 351, 351) == (SpatialIndexTest_BIT(5) | SpatialIndexTest_BIT(6)));
+	// Empty rects overlap nothing.
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 50, 50, 50, 60) == 0);
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 3) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 4) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 6) == 0);
+
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 0, 0, 100, 100) == 1);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 0, 0, 101, 100) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 100, 0, 200, 100) == 2);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 0, 0, 0, 0) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 310, 310, 351, 350) == 0);
+	SpatialIndexTest_Destroy(&state);
+}
+
+// Two monitors of different heights, side by side; windows span cells and monitors, or extend beyond the grid.
+static void SpatialIndexTest_CheckSpanning(void) {
+	static SpatialIndexTest_State state;
+	const WindowInvestigator_Rect monitors[] = { { 0, 0, 1000, 1000 }, { 1000, 0, 2000, 800 } };
+	SpatialIndexTest_Init(&state, monitors, 2);
+	WindowInvestigator_Test_CHECK(state.index.columnCount == 20 && state.index.rowCount == 10);
+	// Across both monitors.
+	SpatialIndexTest_Add(&state, 1, 950, 420, 1050, 580);
+	// Maximized on the second monitor, overhanging it by 8 pixels, which is beyond the grid on three sides.
+	SpatialIndexTest_Add(&state, 2, 992, -8, 2008, 808);
+	// Mostly off the grid, above and to the left.
+	SpatialIndexTest_Add(&state, 3, -500, -500, 50, 50);
+	// Covers the whole desktop.
+	SpatialIndexTest_Add(&state, 4, -10, -10, 2010, 1010);
+	SpatialIndexTest_RunPass(&state);
+
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 960, 850, 970, 860) == SpatialIndexTest_BIT(4));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 960, 430, 970, 440) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(4)));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 1040, 570, 1100, 600) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(2) | SpatialIndexTest_BIT(4)));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 1999, 799, 2000, 800) == (SpatialIndexTest_BIT(2) | SpatialIndexTest_BIT(4)));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 10, 10) == (SpatialIndexTest_BIT(3) | SpatialIndexTest_BIT(4)));
+	// Entirely beyond the grid: clamped to the border cells, but still tested against the actual rects.
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, -400, -400, -300, -300) == SpatialIndexTest_BIT(3));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 2005, 1005, 3000, 3000) == SpatialIndexTest_BIT(4));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 2010, 0, 3000, 3000) == 0);
+
+	// The frontmost covering window wins, wherever the corners of the rect fall.
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 1000, 0, 2000, 800) == 2);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 0, 0, 1000, 1000) == 4);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 960, 430, 1040, 570) == 1);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, -400, -400, 40, 40) == 3);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, -400, -400, 60, 40) == 0);
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 4) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 1) == 0);
+
+	// A new layout lists every window again.
+	const WindowInvestigator_Rect newMonitors[] = { { 0, 0, 3000, 2000 } };
+	WindowInvestigator_SpatialIndex_SetMonitors(&state.index, newMonitors, 1);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 1040, 570, 1100, 600) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(2) | SpatialIndexTest_BIT(4)));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 2005, 1005, 3000, 3000) == SpatialIndexTest_BIT(4));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 1000, 0, 2000, 800) == 2);
+	SpatialIndexTest_Destroy(&state);
+}
+
+// Moving, hiding, minimizing, cloaking and removing windows, and bringing them back.
+static void SpatialIndexTest_CheckUpdates(void) {
+	static SpatialIndexTest_State state;
+	const WindowInvestigator_Rect monitor = { 0, 0, 1000, 1000 };
+	SpatialIndexTest_Init(&state, &monitor, 1);
+	SpatialIndexTest_Add(&state, 1, 0, 0, 300, 300);
+	SpatialIndexTest_Add(&state, 2, 200, 200, 500, 500);
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 250, 250, 260, 260) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(2)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 1);
+
+	// Move 1 to the other corner: it is gone from all the cells it used to be listed in.
+	state.windowInfos[SpatialIndexTest_IndexOf(&state, 1)].windowRect = (WindowInvestigator_Rect){ 700, 700, 1000, 1000 };
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 200, 200) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 250, 250, 260, 260) == SpatialIndexTest_BIT(2));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 900, 900, 910, 910) == SpatialIndexTest_BIT(1));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 0, 0, 300, 300) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 700, 700, 1000, 1000) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 0);
+
+	// Move it back, then hide, minimize, cloak and empty it in turn.
+	state.windowInfos[SpatialIndexTest_IndexOf(&state, 1)].windowRect = (WindowInvestigator_Rect){ 0, 0, 300, 300 };
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 1);
+	for (int property = 0; property < 4; ++property) {
+		WindowInvestigator_WindowInfo* const windowInfo = &state.windowInfos[SpatialIndexTest_IndexOf(&state, 1)];
+		const WindowInvestigator_WindowInfo shownWindowInfo = *windowInfo;
+		if (property == 0) windowInfo->isVisible = false;
+		if (property == 1) windowInfo->isIconic = true;
+		if (property == 2) windowInfo->dwmIsCloaked = 2;
+		if (property == 3) windowInfo->windowRect.right = windowInfo->windowRect.left;
+		SpatialIndexTest_RunPass(&state);
+		WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 1000, 1000) == SpatialIndexTest_BIT(2));
+		WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 0, 0, 300, 300) == 0);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 0);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 1) == 0);
+		*windowInfo = shownWindowInfo;
+		SpatialIndexTest_RunPass(&state);
+		WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 1000, 1000) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(2)));
+		WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 1);
+	}
+
+	// Removing a window takes it out of the index, and its slot can go to a window with the same handle elsewhere.
+	SpatialIndexTest_Remove(&state, 1);
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 1000, 1000) == SpatialIndexTest_BIT(2));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 1) == 0);
+	SpatialIndexTest_Add(&state, 1, 600, 0, 1000, 100);
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 300, 300) == SpatialIndexTest_BIT(2));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetOverlapping(&state, 0, 0, 1000, 1000) == (SpatialIndexTest_BIT(1) | SpatialIndexTest_BIT(2)));
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 600, 0, 1000, 100) == 1);
+
+	// Updates that do not change the rect or the visibility leave the cells alone.
+	const uint64_t updates = state.index.statistics.updates;
+	state.windowInfos[SpatialIndexTest_IndexOf(&state, 2)].styles ^= 1;
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(state.index.statistics.updates == updates);
+	SpatialIndexTest_Destroy(&state);
+}
+
+// The topmost occluder of a window is the frontmost window strictly in front of it: neither the window itself nor a window
+// behind it with the same rect. Both ways of finding it are used: walking the Z-order when few windows are in front, and going
+// through the cells of the window when many windows are in front but elsewhere.
+static void SpatialIndexTest_CheckOccluders(void) {
+	static SpatialIndexTest_State state;
+	const WindowInvestigator_Rect monitor = { 0, 0, 1000, 1000 };
+	SpatialIndexTest_Init(&state, &monitor, 1);
+	SpatialIndexTest_Add(&state, 1, 400, 400, 600, 600);
+	SpatialIndexTest_Add(&state, 2, 400, 400, 600, 600);
+	SpatialIndexTest_Add(&state, 3, 400, 400, 600, 600);
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 1) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 3) == 1);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 0x1234) == 0);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 400, 400, 600, 600) == 1);
+
+	// Bring 3 to the front (the rects are all the same): the Z-order of the last pass is what counts.
+	state.windows[0] = 3;
+	state.windows[1] = 1;
+	state.windows[2] = 2;
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 3) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 1) == 3);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 2) == 3);
+	WindowInvestigator_Test_CHECK(SpatialIndexTest_GetCovering(&state, 400, 400, 600, 600) == 3);
+	SpatialIndexTest_Destroy(&state);
+
+	// Many small windows in front, all far from the last two, so that going through the cells is cheaper than the Z-order walk.
+	SpatialIndexTest_Init(&state, &monitor, 1);
+	for (uintptr_t window = 1; window <= 16; ++window) {
+		const int32_t left = (int32_t)(window - 1) % 4 * 100;
+		const int32_t top = (int32_t)(window - 1) / 4 * 100;
+		SpatialIndexTest_Add(&state, window, left, top, left + 50, top + 50);
+	}
+	// 18 overlaps 17 and, on its other side, the hidden 20 and 19 behind it.
+	SpatialIndexTest_Add(&state, 17, 700, 700, 850, 850);
+	SpatialIndexTest_Add(&state, 18, 800, 800, 900, 900);
+	SpatialIndexTest_Add(&state, 19, 850, 850, 950, 950);
+	SpatialIndexTest_Add(&state, 20, 800, 800, 900, 900)->isVisible = false;
+	SpatialIndexTest_RunPass(&state);
+	const uint64_t candidatesTested = state.index.statistics.candidatesTested;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 18) == 17);
+	WindowInvestigator_Test_CHECK(state.index.statistics.candidatesTested - candidatesTested < 16);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 19) == 18);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 17) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 20) == 0);
+	// A window in front and in the same cells is found by the Z-order walk, even if there is another one further back.
+	state.windowInfos[SpatialIndexTest_IndexOf(&state, 2)].windowRect = (WindowInvestigator_Rect){ 890, 890, 990, 990 };
+	SpatialIndexTest_RunPass(&state);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 18) == 2);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 19) == 2);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_SpatialIndex_FindTopmostOccluder(&state.index, 17) == 0);
+	SpatialIndexTest_Destroy(&state);
+}
+
+int main(void) {
+	SpatialIndexTest_CheckEdges();
+	SpatialIndexTest_CheckSpanning();
+	SpatialIndexTest_CheckUpdates();
+	SpatialIndexTest_CheckOccluders();
+	return EXIT_SUCCESS;
+}
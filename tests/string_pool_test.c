@@ -0,0 +1,109 @@
+#include "../common/string_pool.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+// Checks the string pool against a plain array of strings and reference counts. The pool takes the hash from the caller, so
+// hash collisions can be forced: most strings are interned with one of a handful of hashes, which makes every probe sequence
+// run through strings that only differ by their characters (or only by their length), and exercises removal from the middle
+// of long probe sequences.
+
+#define StringPoolTest_STRING_COUNT 400
+#define StringPoolTest_MAX_LENGTH 40
+#define StringPoolTest_OPERATIONS 200000
+
+typedef struct {
+	wchar_t string[StringPoolTest_MAX_LENGTH + 1];
+	size_t length;
+	uint64_t hash;
+	uint32_t referenceCount;
+	WindowInvestigator_StringId id;
+} StringPoolTest_String;
+
+static StringPoolTest_String StringPoolTest_strings[StringPoolTest_STRING_COUNT];
+
+// Strings are distinct, but many of them are prefixes of one another, or differ by a single character.
+static void StringPoolTest_InitStrings(uint64_t* random) {
+	for (size_t index = 0; index < StringPoolTest_STRING_COUNT; ++index) {
+		StringPoolTest_String* const string = &StringPoolTest_strings[index];
+		string->length = index % (StringPoolTest_MAX_LENGTH + 1);
+		for (size_t character = 0; character < string->length; ++character) string->string[character] = L'a';
+		string->string[string->length] = L'\0';
+		// The strings of a given length are told apart by their last character (the empty string only appears once).
+		if (string->length > 0) string->string[string->length - 1] = (wchar_t)(L'a' + index / (StringPoolTest_MAX_LENGTH + 1));
+		else if (index != 0) string->length = SIZE_MAX;
+		// Half of the strings share one of 4 hashes; the rest get their real hash.
+		string->hash = WindowInvestigator_Test_Random(random) % 2 == 0 ? WindowInvestigator_Test_Random(random) % 4 : WindowInvestigator_HashString(string->string, string->length == SIZE_MAX ? 0 : string->length);
+	}
+}
+
+static void StringPoolTest_CheckPool(const WindowInvestigator_StringPool* pool) {
+	uint32_t stringCount = 0;
+	for (size_t index = 0; index < StringPoolTest_STRING_COUNT; ++index) {
+		const StringPoolTest_String* const string = &StringPoolTest_strings[index];
+		if (string->referenceCount == 0) continue;
+		++stringCount;
+		WindowInvestigator_Test_CHECK(wcscmp(WindowInvestigator_StringPool_Get(pool, string->id), string->string) == 0);
+		WindowInvestigator_Test_CHECK(pool->entries[string->id].referenceCount == string->referenceCount);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_StringPool_Equals(pool, string->id, string->string, string->length, string->hash));
+		for (size_t otherIndex = 0; otherIndex < StringPoolTest_STRING_COUNT; ++otherIndex) {
+			const StringPoolTest_String* const other = &StringPoolTest_strings[otherIndex];
+			if (other == string || other->length == SIZE_MAX) continue;
+			if (other->referenceCount != 0) WindowInvestigator_Test_CHECK(other->id != string->id);
+			// Same hash, and even same length: only the characters tell them apart.
+			WindowInvestigator_Test_CHECK(!WindowInvestigator_StringPool_Equals(pool, string->id, other->string, other->length, string->hash));
+		}
+	}
+	WindowInvestigator_Test_CHECK(pool->stringCount == stringCount);
+}
+
+static void StringPoolTest_CheckHash(void) {
+	// Prefixes, and strings that only differ past the first 8 bytes or in their last byte, hash differently.
+	static const wchar_t string[] = L"abcdefghijklmnopq";
+	for (size_t length = 0; length < 16; ++length)
+		WindowInvestigator_Test_CHECK(WindowInvestigator_HashString(string, length) != WindowInvestigator_HashString(string, length + 1));
+	wchar_t other[sizeof(string) / sizeof(*string)];
+	memcpy(other, string, sizeof(string));
+	for (size_t index = 0; index < 16; ++index) {
+		other[index] ^= 1;
+		WindowInvestigator_Test_CHECK(WindowInvestigator_HashString(string, 16) != WindowInvestigator_HashString(other, 16));
+		other[index] ^= 1;
+	}
+	// Only the first length characters count.
+	other[16] = L'z';
+	WindowInvestigator_Test_CHECK(WindowInvestigator_HashString(string, 16) == WindowInvestigator_HashString(other, 16));
+}
+
+int main(void) {
+	uint64_t random = 1;
+	StringPoolTest_CheckHash();
+	StringPoolTest_InitStrings(&random);
+
+	WindowInvestigator_StringPool pool;
+	WindowInvestigator_StringPool_Init(&pool);
+	for (int operation = 0; operation < StringPoolTest_OPERATIONS; ++operation) {
+		StringPoolTest_String* const string = &StringPoolTest_strings[WindowInvestigator_Test_RandomIndex(&random, StringPoolTest_STRING_COUNT)];
+		if (string->length == SIZE_MAX) continue;
+		// Grow towards holding most strings at once, then shrink, a few times over.
+		const bool growing = (operation / 20000) % 2 == 0;
+		if (string->referenceCount != 0 && WindowInvestigator_Test_Random(&random) % 4 < (growing ? 1u : 3u)) {
+			WindowInvestigator_StringPool_Release(&pool, string->id);
+			--string->referenceCount;
+		}
+		else {
+			const WindowInvestigator_StringId id = WindowInvestigator_StringPool_Intern(&pool, string->string, string->length, string->hash);
+			if (string->referenceCount != 0) WindowInvestigator_Test_CHECK(id == string->id);
+			string->id = id;
+			++string->referenceCount;
+		}
+		if (operation % 1000 == 0) StringPoolTest_CheckPool(&pool);
+	}
+	StringPoolTest_CheckPool(&pool);
+	WindowInvestigator_StringPool_Destroy(&pool);
+
+	printf("%d operations OK\n", StringPoolTest_OPERATIONS);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "../common/structured_output.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+// Checks the structured output against hand-written lines whose output is known in advance: every kind of event and column,
+// string escaping in both formats (including CSV fields with embedded commas, quotes and line breaks), non-ASCII text, unpaired
+// surrogates, negative coordinates and empty columns. Also checks that malformed records are rejected without writing
+// anything, and that lines make it to the file on flush.
+
+#define StructuredOutputTest_CSV_HEADER \
+	"timestamp,event,window,zOrder,previousZOrder,windowCount,fields,processId,threadId,className,extendedStyles,styles," \
+	"windowRectLeft,windowRectTop,windowRectRight,windowRectBottom,clientRectLeft,clientRectTop,clientRectRight,clientRectBottom," \
+	"clientRectInScreenCoordinatesLeft,clientRectInScreenCoordinatesTop,clientRectInScreenCoordinatesRight,clientRectInScreenCoordinatesBottom," \
+	"placementShowCmd,placementMinPositionX,placementMinPositionY,placementMaxPositionX,placementMaxPositionY," \
+	"placementNormalPositionLeft,placementNormalPositionTop,placementNormalPositionRight,placementNormalPositionBottom," \
+	"text,isShellManagedWindow,isShellFrameWindow,overpanning,band," \
+	"hasNonRudeHWNDProperty,hasNonRudeAddedByRudeWindowFixerProperty,hasLivePreviewWindowProperty,hasTreatAsDesktopFullscreenProperty," \
+	"isWindow,dwmIsCloaked,isIconic,isVisible,messageKind,message,wParam,lParam," \
+	"monitor,monitorRectLeft,monitorRectTop,monitorRectRight,monitorRectBottom,previousWindow,droppedCount\n"
+
+static WindowInvestigator_WindowInfo StructuredOutputTest_windowInfo;
+static WindowInvestigator_WindowStrings StructuredOutputTest_windowStrings;
+
+static const unsigned char StructuredOutputTest_messageRecord[WindowInvestigator_ReceivedMessage_RECORD_SIZE] = { 0x04, 0, 0, 0, 0, 0, 0, 0, 0x56, 0x34, 0x12, 0, 0, 0, 0, 0 };
+// Previous window 0x2B, monitor rect { -1920, 0, 0, 1200 }.
+static const unsigned char StructuredOutputTest_rudeWindowRecord[WindowInvestigator_RudeWindowChanged_RECORD_SIZE] = {
+	0x2B, 0, 0, 0, 0, 0, 0, 0, 0x80, 0xF8, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0, 0, 0xB0, 0x04, 0, 0,
+};
+// 0x123456789 events dropped.
+static const unsigned char StructuredOutputTest_eventsDroppedRecord[WindowInvestigator_EventsDropped_RECORD_SIZE] = { 0x89, 0x67, 0x45, 0x23, 0x01, 0, 0, 0 };
+
+// Checks that the buffered output is exactly expected, then discards it.
+static void StructuredOutputTest_Check(WindowInvestigator_StructuredWriter* writer, const char* expected) {
+	const size_t expectedSize = strlen(expected);
+	const bool matches = writer->bufferSize == expectedSize && memcmp(writer->buffer, expected, expectedSize) == 0;
+	if (!matches) fprintf(stderr, "Structured output mismatch:\nexpected: %sactual:   %.*s", expected, (int)writer->bufferSize, writer->buffer);
+	WindowInvestigator_Test_CHECK(matches);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_Flush(writer));
+	WindowInvestigator_Test_CHECK(writer->bufferSize == 0);
+}
+
+static void StructuredOutputTest_SetCapturedString(WindowInvestigator_CapturedString* capturedString, const wchar_t* string, size_t length) {
+	memcpy(capturedString->string, string, length * sizeof(*string));
+	WindowInvestigator_FinishCapturedString(capturedString, length);
+}
+
+static void StructuredOutputTest_InitWindow(void) {
+	WindowInvestigator_WindowInfo* const windowInfo = &StructuredOutputTest_windowInfo;
+	memset(windowInfo, 0, sizeof(*windowInfo));
+	windowInfo->processId = 1234;
+	windowInfo->threadId = 5678;
+	windowInfo->extendedStyles = 0x00200100;
+	windowInfo->styles = 0x94CF0000;
+	windowInfo->windowRect = (WindowInvestigator_Rect){ -8, -8, 2568, 1408 };
+	windowInfo->clientRect = (WindowInvestigator_Rect){ 0, 0, 2560, 1369 };
+	windowInfo->clientRectInScreenCoordinates = (WindowInvestigator_Rect){ 0, 31, 2560, 1400 };
+	windowInfo->placement.showCmd = 3;
+	windowInfo->placement.minPosition = (WindowInvestigator_Point){ -32000, -32000 };
+	windowInfo->placement.maxPosition = (WindowInvestigator_Point){ -1, -1 };
+	windowInfo->placement.normalPosition = (WindowInvestigator_Rect){ 100, 200, 900, 800 };
+	windowInfo->isShellManagedWindow = true;
+	windowInfo->band = 1;
+	windowInfo->hasNonRudeHWNDProperty = true;
+	windowInfo->isWindow = true;
+	windowInfo->dwmIsCloaked = 2;
+	windowInfo->isVisible = true;
+
+	const wchar_t className[] = L"My \"Class\", v2\\";
+	StructuredOutputTest_SetCapturedString(&StructuredOutputTest_windowStrings.className, className, sizeof(className) / sizeof(*className) - 1);
+	// "Café €", tab, "1", line feed, U+1F600, an unpaired high surrogate, U+0001.
+	const wchar_t text[] = {
+		L'C', L'a', L'f', (wchar_t)0xE9, L' ', (wchar_t)0x20AC, L'\t', L'1', L'\n',
+#if WCHAR_MAX > 0xFFFF
+		(wchar_t)0x1F600,
+#else
+		(wchar_t)0xD83D, (wchar_t)0xDE00,
+#endif
+		(wchar_t)0xD800, (wchar_t)0x01,
+	};
+	StructuredOutputTest_SetCapturedString(&StructuredOutputTest_windowStrings.text, text, sizeof(text) / sizeof(*text));
+}
+
+static void StructuredOutputTest_CheckJsonLines(void) {
+	WindowInvestigator_StructuredWriter writer;
+	WindowInvestigator_StructuredWriter_Init(&writer, WindowInvestigator_StructuredFormat_JSON_LINES, NULL);
+	StructuredOutputTest_Check(&writer, "");
+	WindowInvestigator_StructuredWriter_WriteWindow(&writer, "WindowDump", 42, 0x1A2B3C, 7, WindowInvestigator_WindowField_ALL, &StructuredOutputTest_windowInfo, &StructuredOutputTest_windowStrings);
+	StructuredOutputTest_Check(&writer,
+		"{\"timestamp\":42,\"event\":\"WindowDump\",\"window\":\"0x1A2B3C\",\"zOrder\":7,\"fields\":\"0x01FFFFFF\",\"processId\":1234,\"threadId\":5678,"
+		"\"className\":\"My \\\"Class\\\", v2\\\\\",\"extendedStyles\":\"0x00200100\",\"styles\":\"0x94CF0000\","
+		"\"windowRectLeft\":-8,\"windowRectTop\":-8,\"windowRectRight\":2568,\"windowRectBottom\":1408,"
+		"\"clientRectLeft\":0,\"clientRectTop\":0,\"clientRectRight\":2560,\"clientRectBottom\":1369,"
+		"\"clientRectInScreenCoordinatesLeft\":0,\"clientRectInScreenCoordinatesTop\":31,\"clientRectInScreenCoordinatesRight\":2560,\"clientRectInScreenCoordinatesBottom\":1400,"
+		"\"placementShowCmd\":3,\"placementMinPositionX\":-32000,\"placementMinPositionY\":-32000,\"placementMaxPositionX\":-1,\"placementMaxPositionY\":-1,"
+		"\"placementNormalPositionLeft\":100,\"placementNormalPositionTop\":200,\"placementNormalPositionRight\":900,\"placementNormalPositionBottom\":800,"
+		"\"text\":\"Caf\xC3\xA9 \xE2\x82\xAC\\t1\\n\xF0\x9F\x98\x80\xEF\xBF\xBD\\u0001\",\"isShellManagedWindow\":true,\"isShellFrameWindow\":false,\"overpanning\":false,\"band\":1,"
+		"\"hasNonRudeHWNDProperty\":true,\"hasNonRudeAddedByRudeWindowFixerProperty\":false,\"hasLivePreviewWindowProperty\":false,\"hasTreatAsDesktopFullscreenProperty\":false,"
+		"\"isWindow\":true,\"dwmIsCloaked\":\"0x00000002\",\"isIconic\":false,\"isVisible\":true}\n");
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 43, 0x1A2B3C, WindowInvestigator_MonitorEvent_WINDOW_ZORDER_CHANGED, 0, 7, NULL, 0));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 44, 0, WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE, 0xC029, WindowInvestigator_ReceivedMessage_SHELL_HOOK, StructuredOutputTest_messageRecord, sizeof(StructuredOutputTest_messageRecord)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 45, 0x3C, WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED, 2, 0, StructuredOutputTest_rudeWindowRecord, sizeof(StructuredOutputTest_rudeWindowRecord)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 46, 0, WindowInvestigator_MonitorEvent_EVENTS_DROPPED, 0, 0, StructuredOutputTest_eventsDroppedRecord, sizeof(StructuredOutputTest_eventsDroppedRecord)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 47, 0, WindowInvestigator_MonitorEvent_TICK_FINISHED, 0, 0, NULL, 0));
+	StructuredOutputTest_Check(&writer,
+		"{\"timestamp\":43,\"event\":\"WindowZOrderChanged\",\"window\":\"0x1A2B3C\",\"zOrder\":0,\"previousZOrder\":7}\n"
+		"{\"timestamp\":44,\"event\":\"ReceivedMessage\",\"messageKind\":\"ShellHook\",\"message\":\"0xC029\",\"wParam\":\"0x4\",\"lParam\":\"0x123456\"}\n"
+		"{\"timestamp\":45,\"event\":\"RudeWindowChanged\",\"window\":\"0x3C\",\"monitor\":2,\"monitorRectLeft\":-1920,\"monitorRectTop\":0,\"monitorRectRight\":0,\"monitorRectBottom\":1200,\"previousWindow\":\"0x2B\"}\n"
+		"{\"timestamp\":46,\"event\":\"EventsDropped\",\"droppedCount\":4886718345}\n"
+		"{\"timestamp\":47,\"event\":\"TickFinished\"}\n");
+	WindowInvestigator_StructuredWriter_Destroy(&writer);
+}
+
+static void StructuredOutputTest_CheckCsv(void) {
+	WindowInvestigator_StructuredWriter writer;
+	WindowInvestigator_StructuredWriter_Init(&writer, WindowInvestigator_StructuredFormat_CSV, NULL);
+	StructuredOutputTest_Check(&writer, StructuredOutputTest_CSV_HEADER);
+	WindowInvestigator_StructuredWriter_WriteWindow(&writer, "WindowDump", 42, 0x1A2B3C, 7, WindowInvestigator_WindowField_ALL, &StructuredOutputTest_windowInfo, &StructuredOutputTest_windowStrings);
+	StructuredOutputTest_Check(&writer,
+		"42,\"WindowDump\",0x1A2B3C,7,,,0x01FFFFFF,1234,5678,\"My \"\"Class\"\", v2\\\",0x00200100,0x94CF0000,"
+		"-8,-8,2568,1408,0,0,2560,1369,0,31,2560,1400,3,-32000,-32000,-1,-1,100,200,900,800,"
+		"\"Caf\xC3\xA9 \xE2\x82\xAC\t1\n\xF0\x9F\x98\x80\xEF\xBF\xBD\x01\",true,false,false,1,true,false,false,false,true,0x00000002,false,true,,,,,,,,,,,\n");
+	const uint32_t partialFields = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_WINDOW_RECT) | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_ICONIC);
+	WindowInvestigator_StructuredWriter_WriteWindow(&writer, "WindowChanged", 45, 0x1A2B3C, 7, partialFields, &StructuredOutputTest_windowInfo, &StructuredOutputTest_windowStrings);
+	StructuredOutputTest_Check(&writer,
+		"45,\"WindowChanged\",0x1A2B3C,7,,,0x00800020,,,,,,-8,-8,2568,1408,,,,,,,,,,,,,,,,,,,,,,,,,,,,,false,,,,,,,,,,,,\n");
+
+	// A line that a naive reader would split in the middle: strings made of nothing but separators, quotes and line breaks.
+	WindowInvestigator_WindowStrings windowStrings;
+	const wchar_t className[] = L",\"\r\n,";
+	StructuredOutputTest_SetCapturedString(&windowStrings.className, className, sizeof(className) / sizeof(*className) - 1);
+	const wchar_t text[] = L"a,b\r\nc\n\"d\",";
+	StructuredOutputTest_SetCapturedString(&windowStrings.text, text, sizeof(text) / sizeof(*text) - 1);
+	const uint32_t stringFields = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME) | WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT);
+	WindowInvestigator_StructuredWriter_WriteWindow(&writer, "WindowChanged", 46, 0x1A2B3C, 7, stringFields, &StructuredOutputTest_windowInfo, &windowStrings);
+	StructuredOutputTest_Check(&writer,
+		"46,\"WindowChanged\",0x1A2B3C,7,,,0x00001004,,,\",\"\"\r\n,\",,,,,,,,,,,,,,,,,,,,,,,,\"a,b\r\nc\n\"\"d\"\",\",,,,,,,,,,,,,,,,,,,,,,,\n");
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 47, 0, WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE, 0xC029, WindowInvestigator_ReceivedMessage_SHELL_HOOK, StructuredOutputTest_messageRecord, sizeof(StructuredOutputTest_messageRecord)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 48, 0x3C, WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED, 2, 0, StructuredOutputTest_rudeWindowRecord, sizeof(StructuredOutputTest_rudeWindowRecord)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 49, 0, WindowInvestigator_MonitorEvent_EVENTS_DROPPED, 0, 0, StructuredOutputTest_eventsDroppedRecord, sizeof(StructuredOutputTest_eventsDroppedRecord)));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 50, 0, WindowInvestigator_MonitorEvent_TICK_FINISHED, 0, 0, NULL, 0));
+	StructuredOutputTest_Check(&writer,
+		"47,\"ReceivedMessage\",,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,\"ShellHook\",0xC029,0x4,0x123456,,,,,,,\n"
+		"48,\"RudeWindowChanged\",0x3C,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,2,-1920,0,0,1200,0x2B,\n"
+		"49,\"EventsDropped\",,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,4886718345\n"
+		"50,\"TickFinished\",,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,\n");
+	WindowInvestigator_StructuredWriter_Destroy(&writer);
+}
+
+// Records of the wrong size, or with out-of-range values, write nothing.
+static void StructuredOutputTest_CheckMalformed(void) {
+	for (int format = 0; format < WindowInvestigator_StructuredFormat_COUNT; ++format) {
+		WindowInvestigator_StructuredWriter writer;
+		WindowInvestigator_StructuredWriter_Init(&writer, (WindowInvestigator_StructuredFormat)format, NULL);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_Flush(&writer));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredWriter_WriteEvent(&writer, 1, 0, WindowInvestigator_MonitorEvent_EVENTS_DROPPED, 0, 0, StructuredOutputTest_eventsDroppedRecord, sizeof(StructuredOutputTest_eventsDroppedRecord) - 1));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredWriter_WriteEvent(&writer, 1, 0x3C, WindowInvestigator_MonitorEvent_RUDE_WINDOW_CHANGED, 2, 0, StructuredOutputTest_rudeWindowRecord, sizeof(StructuredOutputTest_rudeWindowRecord) - 1));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredWriter_WriteEvent(&writer, 1, 0, WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE, 0xC029, WindowInvestigator_ReceivedMessage_SHELL_HOOK, StructuredOutputTest_messageRecord, sizeof(StructuredOutputTest_messageRecord) - 1));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredWriter_WriteEvent(&writer, 1, 0, WindowInvestigator_MonitorEvent_RECEIVED_MESSAGE, 0xC029, WindowInvestigator_ReceivedMessage_COUNT, StructuredOutputTest_messageRecord, sizeof(StructuredOutputTest_messageRecord)));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredWriter_WriteEvent(&writer, 1, 0x1A2B3C, WindowInvestigator_MonitorEvent_WINDOW_SNAPSHOT, 0, 0, StructuredOutputTest_messageRecord, 1));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredWriter_WriteEvent(&writer, 1, 0, (WindowInvestigator_MonitorEventType)(WindowInvestigator_MonitorEvent_TICK_FINISHED + 1), 0, 0, NULL, 0));
+		StructuredOutputTest_Check(&writer, "");
+		WindowInvestigator_Test_CHECK(writer.linesWritten == 0);
+		WindowInvestigator_StructuredWriter_Destroy(&writer);
+	}
+}
+
+// Lines are kept in the buffer until flushed, then written out as is.
+static void StructuredOutputTest_CheckFile(void) {
+	static const char expected[] = "{\"timestamp\":47,\"event\":\"TickFinished\"}\n";
+	FILE* const file = tmpfile();
+	WindowInvestigator_Test_CHECK(file != NULL);
+	WindowInvestigator_StructuredWriter writer;
+	WindowInvestigator_StructuredWriter_Init(&writer, WindowInvestigator_StructuredFormat_JSON_LINES, file);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_WriteEvent(&writer, 47, 0, WindowInvestigator_MonitorEvent_TICK_FINISHED, 0, 0, NULL, 0));
+	WindowInvestigator_Test_CHECK(writer.linesWritten == 1 && writer.bytesWritten == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredWriter_Flush(&writer));
+	WindowInvestigator_Test_CHECK(writer.bytesWritten == sizeof(expected) - 1);
+	WindowInvestigator_StructuredWriter_Destroy(&writer);
+
+	char contents[sizeof(expected)];
+	rewind(file);
+	WindowInvestigator_Test_CHECK(fread(contents, 1, sizeof(contents), file) == sizeof(expected) - 1);
+	WindowInvestigator_Test_CHECK(memcmp(contents, expected, sizeof(expected) - 1) == 0);
+	fclose(file);
+}
+
+int main(void) {
+	for (int format = 0; format < WindowInvestigator_StructuredFormat_COUNT; ++format) {
+		WindowInvestigator_StructuredFormat parsedFormat;
+		WindowInvestigator_Test_CHECK(WindowInvestigator_StructuredFormat_Parse(WindowInvestigator_StructuredFormat_GetName((WindowInvestigator_StructuredFormat)format), &parsedFormat));
+		WindowInvestigator_Test_CHECK(parsedFormat == (WindowInvestigator_StructuredFormat)format);
+	}
+	WindowInvestigator_StructuredFormat parsedFormat;
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_StructuredFormat_Parse("json", &parsedFormat));
+
+	StructuredOutputTest_InitWindow();
+	StructuredOutputTest_CheckJsonLines();
+	StructuredOutputTest_CheckCsv();
+	StructuredOutputTest_CheckMalformed();
+	StructuredOutputTest_CheckFile();
+	return EXIT_SUCCESS;
+}
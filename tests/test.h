@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Shared helpers for the unit tests of the portable libraries in common/. Each test is a standalone program that stops at the
+// first failed check, and exits with a failure status so that CTest reports it.
+
+#define WindowInvestigator_Test_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			exit(EXIT_FAILURE); \
+		} \
+	} while (0)
+
+// SplitMix64, same as the simulated desktop, so that failures are reproducible.
+static inline uint64_t WindowInvestigator_Test_Random(uint64_t* state) {
+	uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+// Uniform in [0, count). count must not be 0.
+static inline size_t WindowInvestigator_Test_RandomIndex(uint64_t* state, size_t count) {
+	return (size_t)(WindowInvestigator_Test_Random(state) % count);
+}
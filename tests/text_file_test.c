@@ -0,0 +1,50 @@
+#include "../common/text_file.h"
+
+#include "../common/allocation.h"
+
+#include "test.h"
+
+#include <string.h>
+
+// Checks that whole files come back byte for byte and null-terminated, at sizes around the initial buffer size and its
+// doublings, and that reading starts from the current position.
+
+static void TextFileTest_Check(size_t size, uint64_t* randomState) {
+	char* const expected = WindowInvestigator_Reallocate(NULL, size + 1, 1);
+	// Printable, so that a stray terminator in the middle would show up as a short string.
+	for (size_t index = 0; index < size; ++index) expected[index] = (char)(' ' + WindowInvestigator_Test_RandomIndex(randomState, 95));
+	expected[size] = '\0';
+	FILE* const file = tmpfile();
+	WindowInvestigator_Test_CHECK(file != NULL);
+	WindowInvestigator_Test_CHECK(fwrite(expected, 1, size, file) == size);
+
+	rewind(file);
+	char* text = WindowInvestigator_ReadTextFile(file);
+	WindowInvestigator_Test_CHECK(text != NULL);
+	WindowInvestigator_Test_CHECK(strlen(text) == size && memcmp(text, expected, size) == 0);
+	WindowInvestigator_Free(text);
+
+	// Nothing left to read.
+	text = WindowInvestigator_ReadTextFile(file);
+	WindowInvestigator_Test_CHECK(text != NULL && text[0] == '\0');
+	WindowInvestigator_Free(text);
+
+	if (size != 0) {
+		const size_t offset = WindowInvestigator_Test_RandomIndex(randomState, size);
+		WindowInvestigator_Test_CHECK(fseek(file, (long)offset, SEEK_SET) == 0);
+		text = WindowInvestigator_ReadTextFile(file);
+		WindowInvestigator_Test_CHECK(text != NULL && strcmp(text, expected + offset) == 0);
+		WindowInvestigator_Free(text);
+	}
+
+	fclose(file);
+	WindowInvestigator_Free(expected);
+}
+
+int main(void) {
+	uint64_t randomState = 1;
+	const size_t sizes[] = { 0, 1, 4094, 4095, 4096, 4097, 8190, 8191, 8192, 100000 };
+	for (size_t index = 0; index < sizeof(sizes) / sizeof(*sizes); ++index) TextFileTest_Check(sizes[index], &randomState);
+	for (int iteration = 0; iteration < 20; ++iteration) TextFileTest_Check(WindowInvestigator_Test_RandomIndex(&randomState, 50000), &randomState);
+	return EXIT_SUCCESS;
+}
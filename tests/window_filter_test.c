@@ -0,0 +1,155 @@
+#include "../common/window_filter.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+
+// Checks the parsing of filter lists (malformed lists are rejected as a whole, including numbers that are out of range), the
+// deduplication of windows and process IDs, and the matching of patterns: * and ? wildcards with backtracking, case folding,
+// and image names given as full paths.
+
+static size_t WindowFilterTest_GetCount(const WindowInvestigator_WindowFilter* filter) {
+	return filter->windowCount + filter->processIdCount + filter->imageNamePatternCount + filter->classNamePatternCount;
+}
+
+static void WindowFilterTest_CheckMalformed(void) {
+	static const wchar_t* const malformedLists[] = {
+		L"", L",", L"1,", L",1", L"1,,2", L"-1", L"+1", L" 1", L"1 ", L"0x", L"1x", L"abc", L"0x1FFFFFFFFFFFFFFFFF", L"99999999999999999999999",
+	};
+	WindowInvestigator_WindowFilter filter;
+	WindowInvestigator_WindowFilter_Init(&filter);
+	// Some valid items first, to check that a malformed list adds nothing, not even its valid items.
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, L"0x10"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, L"20"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_CLASS_NAME, L"a"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_GetCount(&filter) == 3);
+	for (size_t index = 0; index < sizeof(malformedLists) / sizeof(*malformedLists); ++index) {
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, malformedLists[index]));
+		WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, malformedLists[index]));
+	}
+	// Patterns can be anything, but not empty.
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_CLASS_NAME, L""));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_CLASS_NAME, L"a,,b"));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_IMAGE_NAME, L"a.exe,"));
+	// Process IDs are 32-bit.
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, L"1,4294967296"));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, L"0x100000000"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_GetCount(&filter) == 3);
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, L"4294967295,0xFFFFFFFF"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, sizeof(uintptr_t) == 8 ? L"0xFFFFFFFFFFFFFFFF" : L"0xFFFFFFFF"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_GetCount(&filter) == 6);
+	WindowInvestigator_WindowFilter_Compile(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, 0, UINT32_MAX, NULL, NULL));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, UINTPTR_MAX, 0, NULL, NULL));
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+}
+
+static void WindowFilterTest_CheckDeduplication(void) {
+	WindowInvestigator_WindowFilter filter;
+	WindowInvestigator_WindowFilter_Init(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_IsEmpty(&filter));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, L"0x30,0x10,0x20,0x10"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, L"16,48,0x30"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_PROCESS_ID, L"7,7,7,0x7,3"));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_IsEmpty(&filter));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_UsesClassName(&filter));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_UsesImageName(&filter));
+	WindowInvestigator_WindowFilter_Compile(&filter);
+
+	WindowInvestigator_Test_CHECK(filter.windowCount == 3);
+	WindowInvestigator_Test_CHECK(filter.windows[0] == 0x10 && filter.windows[1] == 0x20 && filter.windows[2] == 0x30);
+	WindowInvestigator_Test_CHECK(filter.processIdCount == 2);
+	WindowInvestigator_Test_CHECK(filter.processIds[0] == 3 && filter.processIds[1] == 7);
+	for (uintptr_t window = 0; window < 0x40; ++window)
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, window, 0, NULL, NULL) == (window == 0x10 || window == 0x20 || window == 0x30));
+	for (uint32_t processId = 0; processId < 10; ++processId)
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, 0, processId, NULL, NULL) == (processId == 3 || processId == 7));
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+
+	// A filter with a single duplicated window.
+	WindowInvestigator_WindowFilter_Init(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_WINDOW, L"5,5"));
+	WindowInvestigator_WindowFilter_Compile(&filter);
+	WindowInvestigator_Test_CHECK(filter.windowCount == 1 && filter.windows[0] == 5);
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+}
+
+static bool WindowFilterTest_MatchesClassName(const wchar_t* pattern, const wchar_t* className) {
+	WindowInvestigator_WindowFilter filter;
+	WindowInvestigator_WindowFilter_Init(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_CLASS_NAME, pattern));
+	WindowInvestigator_WindowFilter_Compile(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_UsesClassName(&filter));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_UsesImageName(&filter));
+	const bool matches = WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, className, NULL);
+	// Class name patterns are never matched against the image name.
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, className));
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+	return matches;
+}
+
+static void WindowFilterTest_CheckPatterns(void) {
+	// Backtracking: the first b that matches is not the right one.
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"a*b*c", L"aXbYbZc"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"a*b*c", L"abc"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"a*b*c", L"abcbc"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"a*b*c", L"aXbYbZ"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"a*b*c", L"acb"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"a*b*c", L"XaXbXc"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"*ab", L"aaab"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"*ab", L"aaba"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"**", L""));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"*", L"anything"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"?", L""));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"a?c", L"abc"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"a?c", L"ac"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"a?c", L"abbc"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"*?c", L"c"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"*?c", L"bc"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"abc", L"ab"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"ab", L"abc"));
+
+	// Case folding, in both directions.
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"Chrome_WidgetWin_*", L"chrome_widgetwin_1"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"Chrome_WidgetWin_*", L"CHROME_WIDGETWIN_0"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"chrome_widgetwin_?", L"Chrome_WidgetWin_2"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"Chrome_WidgetWin_?", L"Chrome_WidgetWin_10"));
+
+	// Any of several patterns.
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"Notepad,Chrome_*", L"chrome_widgetwin_1"));
+	WindowInvestigator_Test_CHECK(WindowFilterTest_MatchesClassName(L"Notepad,Chrome_*", L"NOTEPAD"));
+	WindowInvestigator_Test_CHECK(!WindowFilterTest_MatchesClassName(L"Notepad,Chrome_*", L"Notepad++"));
+}
+
+static void WindowFilterTest_CheckImageNames(void) {
+	WindowInvestigator_WindowFilter filter;
+	WindowInvestigator_WindowFilter_Init(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Add(&filter, WindowInvestigator_WindowFilterKind_IMAGE_NAME, L"Chrome.exe,*game*.exe"));
+	WindowInvestigator_WindowFilter_Compile(&filter);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_UsesImageName(&filter));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_UsesClassName(&filter));
+
+	// Only the file name is matched, whatever the separator.
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"chrome.exe"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"C:\\Program Files\\Google\\Chrome\\Application\\CHROME.EXE"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"\\Device\\HarddiskVolume3\\chrome.exe"));
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"C:/Games/MyGame/bin/mygame64.exe"));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"C:\\chrome.exe\\updater.exe"));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"C:\\games\\launcher.exe"));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"C:\\Chrome\\"));
+	// The * does not reach into the directories.
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, L"C:\\game\\x.exe"));
+	// Image name patterns are never matched against the class name, and an unknown image name matches nothing.
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, L"chrome.exe", NULL));
+	WindowInvestigator_Test_CHECK(!WindowInvestigator_WindowFilter_Matches(&filter, 0, 0, NULL, NULL));
+	WindowInvestigator_WindowFilter_Destroy(&filter);
+}
+
+int main(void) {
+	WindowFilterTest_CheckMalformed();
+	WindowFilterTest_CheckDeduplication();
+	WindowFilterTest_CheckPatterns();
+	WindowFilterTest_CheckImageNames();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+#include "../common/window_info.h"
+
+#include "test.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Checks every supported diff kernel against the field list below, which is laid out independently of the kernels: random
+// pairs of snapshots where a random subset of fields differs, and single changes to each byte of each field (or to each flag).
+// The vector kernels compare raw bytes, so the padding of both snapshots is filled with different garbage, which must never
+// show up as a change; single changes are also checked with identical padding, which is when the kernels take their fast path.
+
+#define WindowInfoTest_RANDOM_PAIRS 100000
+
+typedef struct {
+	WindowInvestigator_WindowField field;
+	size_t offset;
+	size_t size;
+	bool isFlag;
+} WindowInfoTest_Field;
+
+#define WindowInfoTest_FIELD(field, member) { WindowInvestigator_WindowField_##field, offsetof(WindowInvestigator_WindowInfo, member), sizeof(((WindowInvestigator_WindowInfo*)NULL)->member), false }
+#define WindowInfoTest_FLAG(field, member) { WindowInvestigator_WindowField_##field, offsetof(WindowInvestigator_WindowInfo, member), sizeof(bool), true }
+
+static const WindowInfoTest_Field WindowInfoTest_fields[] = {
+	WindowInfoTest_FIELD(PROCESS_ID, processId),
+	WindowInfoTest_FIELD(THREAD_ID, threadId),
+	WindowInfoTest_FIELD(CLASS_NAME, className),
+	WindowInfoTest_FIELD(EXTENDED_STYLES, extendedStyles),
+	WindowInfoTest_FIELD(STYLES, styles),
+	WindowInfoTest_FIELD(WINDOW_RECT, windowRect),
+	WindowInfoTest_FIELD(CLIENT_RECT, clientRect),
+	WindowInfoTest_FIELD(CLIENT_RECT_IN_SCREEN_COORDINATES, clientRectInScreenCoordinates),
+	WindowInfoTest_FIELD(PLACEMENT_SHOW_CMD, placement.showCmd),
+	WindowInfoTest_FIELD(PLACEMENT_MIN_POSITION, placement.minPosition),
+	WindowInfoTest_FIELD(PLACEMENT_MAX_POSITION, placement.maxPosition),
+	WindowInfoTest_FIELD(PLACEMENT_NORMAL_POSITION, placement.normalPosition),
+	WindowInfoTest_FIELD(TEXT, text),
+	WindowInfoTest_FLAG(IS_SHELL_MANAGED_WINDOW, isShellManagedWindow),
+	WindowInfoTest_FLAG(IS_SHELL_FRAME_WINDOW, isShellFrameWindow),
+	WindowInfoTest_FLAG(OVERPANNING, overpanning),
+	WindowInfoTest_FIELD(BAND, band),
+	WindowInfoTest_FLAG(HAS_NON_RUDE_HWND_PROPERTY, hasNonRudeHWNDProperty),
+	WindowInfoTest_FLAG(HAS_NON_RUDE_ADDED_BY_RUDE_WINDOW_FIXER_PROPERTY, hasNonRudeAddedByRudeWindowFixerProperty),
+	WindowInfoTest_FLAG(HAS_LIVE_PREVIEW_WINDOW_PROPERTY, hasLivePreviewWindowProperty),
+	WindowInfoTest_FLAG(HAS_TREAT_AS_DESKTOP_FULLSCREEN_PROPERTY, hasTreatAsDesktopFullscreenProperty),
+	WindowInfoTest_FLAG(IS_WINDOW, isWindow),
+	WindowInfoTest_FIELD(DWM_IS_CLOAKED, dwmIsCloaked),
+	WindowInfoTest_FLAG(IS_ICONIC, isIconic),
+	WindowInfoTest_FLAG(IS_VISIBLE, isVisible),
+};
+
+#define WindowInfoTest_FIELD_COUNT (sizeof(WindowInfoTest_fields) / sizeof(*WindowInfoTest_fields))
+
+// Fills the whole snapshot, padding included, with garbage. Flags are then set to valid values, as any other value would not be
+// a bool.
+static void WindowInfoTest_FillGarbage(WindowInvestigator_WindowInfo* windowInfo, uint64_t* random) {
+	unsigned char* const bytes = (unsigned char*)windowInfo;
+	for (size_t byte = 0; byte < sizeof(*windowInfo); ++byte) bytes[byte] = (unsigned char)WindowInvestigator_Test_Random(random);
+	for (size_t index = 0; index < WindowInfoTest_FIELD_COUNT; ++index)
+		if (WindowInfoTest_fields[index].isFlag) bytes[WindowInfoTest_fields[index].offset] = (unsigned char)(WindowInvestigator_Test_Random(random) % 2);
+}
+
+static void WindowInfoTest_CopyField(WindowInvestigator_WindowInfo* windowInfo, const WindowInvestigator_WindowInfo* source, const WindowInfoTest_Field* field) {
+	memcpy((unsigned char*)windowInfo + field->offset, (const unsigned char*)source + field->offset, field->size);
+}
+
+static void WindowInfoTest_CheckDiff(const WindowInvestigator_WindowInfo* oldWindowInfo, const WindowInvestigator_WindowInfo* newWindowInfo, uint32_t expectedFields) {
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DiffWindowInfo(oldWindowInfo, newWindowInfo) == expectedFields);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DiffWindowInfo(newWindowInfo, oldWindowInfo) == expectedFields);
+	for (int kernel = 0; kernel < WindowInvestigator_WindowInfoDiffKernel_COUNT; ++kernel) {
+		if (!WindowInvestigator_WindowInfoDiffKernel_IsSupported((WindowInvestigator_WindowInfoDiffKernel)kernel)) continue;
+		WindowInvestigator_Test_CHECK(WindowInvestigator_DiffWindowInfoWithKernel((WindowInvestigator_WindowInfoDiffKernel)kernel, oldWindowInfo, newWindowInfo) == expectedFields);
+	}
+}
+
+// Each field of the new snapshot either comes from the old one or stays random (flags get toggled, as there are only two
+// values). The padding of the two snapshots differs.
+static void WindowInfoTest_CheckRandomPairs(uint64_t* random) {
+	for (int pair = 0; pair < WindowInfoTest_RANDOM_PAIRS; ++pair) {
+		WindowInvestigator_WindowInfo oldWindowInfo, newWindowInfo;
+		WindowInfoTest_FillGarbage(&oldWindowInfo, random);
+		WindowInfoTest_FillGarbage(&newWindowInfo, random);
+		// Mostly quiet pairs, as on a real desktop, but also pairs where everything changed.
+		const uint64_t changeOdds = WindowInvestigator_Test_Random(random) % 4 == 0 ? 2 : 16;
+		uint32_t expectedFields = 0;
+		for (size_t index = 0; index < WindowInfoTest_FIELD_COUNT; ++index) {
+			const WindowInfoTest_Field* const field = &WindowInfoTest_fields[index];
+			WindowInfoTest_CopyField(&newWindowInfo, &oldWindowInfo, field);
+			if (WindowInvestigator_Test_Random(random) % changeOdds != 0) continue;
+			unsigned char* const bytes = (unsigned char*)&newWindowInfo + field->offset;
+			if (field->isFlag) bytes[0] ^= 1;
+			else bytes[WindowInvestigator_Test_RandomIndex(random, field->size)] ^= (unsigned char)(1 + WindowInvestigator_Test_RandomIndex(random, 255));
+			expectedFields |= WindowInvestigator_WindowField_BIT(field->field);
+		}
+		WindowInfoTest_CheckDiff(&oldWindowInfo, &newWindowInfo, expectedFields);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_DiffWindowInfoWithKernel(WindowInvestigator_WindowInfoDiffKernel_SCALAR, &oldWindowInfo, &oldWindowInfo) == 0);
+	}
+}
+
+// Every byte of every field, and every flag, on its own, so that each byte of the layout is known to map to its field.
+static void WindowInfoTest_CheckSingleChanges(uint64_t* random) {
+	for (size_t index = 0; index < WindowInfoTest_FIELD_COUNT; ++index) {
+		const WindowInfoTest_Field* const field = &WindowInfoTest_fields[index];
+		for (size_t byte = 0; byte < field->size; ++byte) {
+			WindowInvestigator_WindowInfo oldWindowInfo, newWindowInfo;
+			WindowInfoTest_FillGarbage(&oldWindowInfo, random);
+			WindowInfoTest_FillGarbage(&newWindowInfo, random);
+			for (size_t otherIndex = 0; otherIndex < WindowInfoTest_FIELD_COUNT; ++otherIndex) WindowInfoTest_CopyField(&newWindowInfo, &oldWindowInfo, &WindowInfoTest_fields[otherIndex]);
+			// Padding only.
+			WindowInfoTest_CheckDiff(&oldWindowInfo, &newWindowInfo, 0);
+
+			unsigned char* const bytes = (unsigned char*)&newWindowInfo + field->offset;
+			if (field->isFlag) bytes[0] ^= 1;
+			else bytes[byte] ^= (unsigned char)(1 + WindowInvestigator_Test_RandomIndex(random, 255));
+			WindowInfoTest_CheckDiff(&oldWindowInfo, &newWindowInfo, WindowInvestigator_WindowField_BIT(field->field));
+
+			// Same, with the same padding, so that the vector kernels cannot rely on differing padding to take their slow path.
+			memcpy(&newWindowInfo, &oldWindowInfo, sizeof(newWindowInfo));
+			WindowInfoTest_CheckDiff(&oldWindowInfo, &newWindowInfo, 0);
+			if (field->isFlag) bytes[0] ^= 1;
+			else bytes[byte] ^= (unsigned char)(1 + WindowInvestigator_Test_RandomIndex(random, 255));
+			WindowInfoTest_CheckDiff(&oldWindowInfo, &newWindowInfo, WindowInvestigator_WindowField_BIT(field->field));
+		}
+	}
+}
+
+int main(void) {
+	// Every field is listed, once.
+	uint32_t listedFields = 0;
+	for (size_t index = 0; index < WindowInfoTest_FIELD_COUNT; ++index) {
+		WindowInvestigator_Test_CHECK((listedFields & WindowInvestigator_WindowField_BIT(WindowInfoTest_fields[index].field)) == 0);
+		listedFields |= WindowInvestigator_WindowField_BIT(WindowInfoTest_fields[index].field);
+	}
+	WindowInvestigator_Test_CHECK(listedFields == WindowInvestigator_WindowField_ALL);
+
+	uint64_t random = 1;
+	WindowInfoTest_CheckSingleChanges(&random);
+	WindowInfoTest_CheckRandomPairs(&random);
+
+	printf("Kernels checked:");
+	for (int kernel = 0; kernel < WindowInvestigator_WindowInfoDiffKernel_COUNT; ++kernel)
+		if (WindowInvestigator_WindowInfoDiffKernel_IsSupported((WindowInvestigator_WindowInfoDiffKernel)kernel))
+			printf(" %s", WindowInvestigator_WindowInfoDiffKernel_GetName((WindowInvestigator_WindowInfoDiffKernel)kernel));
+	printf("\n");
+	return EXIT_SUCCESS;
+}
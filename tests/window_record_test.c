@@ -0,0 +1,195 @@
+#include "../common/window_record.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+// Round-trips randomized snapshots through the capture record encoding: every field mask, from a single field to all of them,
+// must decode to the same fields and the same strings (including characters outside the Basic Multilingual Plane, which are
+// stored as surrogate pairs), must leave the fields that are not in the record untouched, and must be rejected when the
+// buffer is cut short anywhere.
+
+#define WindowRecordTest_ITERATIONS 20000
+
+static void WindowRecordTest_AppendCodePoint(WindowInvestigator_CapturedString* capturedString, size_t* length, uint32_t codePoint) {
+#if WCHAR_MAX > 0xFFFF
+	capturedString->string[(*length)++] = (wchar_t)codePoint;
+#else
+	if (codePoint >= 0x10000) {
+		capturedString->string[(*length)++] = (wchar_t)(0xD800 + ((codePoint - 0x10000) >> 10));
+		codePoint = 0xDC00 + ((codePoint - 0x10000) & 0x3FF);
+	}
+	capturedString->string[(*length)++] = (wchar_t)codePoint;
+#endif
+}
+
+// Mostly short strings, sometimes up to the capacity of the scratch buffer, with a mix of ASCII, other BMP characters,
+// non-BMP characters and unpaired low surrogates (which are kept as is).
+static void WindowRecordTest_GenerateString(uint64_t* random, WindowInvestigator_CapturedString* capturedString) {
+	const size_t capacity = sizeof(capturedString->string) / sizeof(*capturedString->string);
+	const size_t maxLength = WindowInvestigator_Test_Random(random) % 8 == 0 ? capacity - 1 : 40;
+	const size_t targetLength = WindowInvestigator_Test_RandomIndex(random, maxLength + 1);
+	size_t length = 0;
+	while (length + 2 <= targetLength) {
+		uint32_t codePoint;
+		switch (WindowInvestigator_Test_Random(random) % 8) {
+		case 0: codePoint = 0x100 + (uint32_t)WindowInvestigator_Test_RandomIndex(random, 0xD800 - 0x100); break;
+		case 1: codePoint = 0x10000 + (uint32_t)WindowInvestigator_Test_RandomIndex(random, 0x110000 - 0x10000); break;
+		case 2: codePoint = 0xDC00 + (uint32_t)WindowInvestigator_Test_RandomIndex(random, 0x400); break;
+		default: codePoint = 0x20 + (uint32_t)WindowInvestigator_Test_RandomIndex(random, 0x7F - 0x20); break;
+		}
+		WindowRecordTest_AppendCodePoint(capturedString, &length, codePoint);
+	}
+	WindowInvestigator_FinishCapturedString(capturedString, length);
+}
+
+static int32_t WindowRecordTest_RandomInt32(uint64_t* random) {
+	return (int32_t)(uint32_t)WindowInvestigator_Test_Random(random);
+}
+
+static void WindowRecordTest_GenerateRect(uint64_t* random, WindowInvestigator_Rect* rect) {
+	rect->left = WindowRecordTest_RandomInt32(random);
+	rect->top = WindowRecordTest_RandomInt32(random);
+	rect->right = WindowRecordTest_RandomInt32(random);
+	rect->bottom = WindowRecordTest_RandomInt32(random);
+}
+
+static bool WindowRecordTest_RandomBool(uint64_t* random) {
+	return WindowInvestigator_Test_Random(random) % 2 == 0;
+}
+
+static void WindowRecordTest_GenerateWindowInfo(uint64_t* random, WindowInvestigator_StringPool* pool, WindowInvestigator_WindowStrings* windowStrings, WindowInvestigator_WindowInfo* windowInfo) {
+	memset(windowInfo, 0, sizeof(*windowInfo));
+	windowInfo->processId = (uint32_t)WindowInvestigator_Test_Random(random);
+	windowInfo->threadId = (uint32_t)WindowInvestigator_Test_Random(random);
+	windowInfo->extendedStyles = (uint32_t)WindowInvestigator_Test_Random(random);
+	windowInfo->styles = (uint32_t)WindowInvestigator_Test_Random(random);
+	WindowRecordTest_GenerateRect(random, &windowInfo->windowRect);
+	WindowRecordTest_GenerateRect(random, &windowInfo->clientRect);
+	WindowRecordTest_GenerateRect(random, &windowInfo->clientRectInScreenCoordinates);
+	windowInfo->placement.showCmd = (uint32_t)WindowInvestigator_Test_Random(random);
+	windowInfo->placement.minPosition.x = WindowRecordTest_RandomInt32(random);
+	windowInfo->placement.minPosition.y = WindowRecordTest_RandomInt32(random);
+	windowInfo->placement.maxPosition.x = WindowRecordTest_RandomInt32(random);
+	windowInfo->placement.maxPosition.y = WindowRecordTest_RandomInt32(random);
+	WindowRecordTest_GenerateRect(random, &windowInfo->placement.normalPosition);
+	windowInfo->isShellManagedWindow = WindowRecordTest_RandomBool(random);
+	windowInfo->isShellFrameWindow = WindowRecordTest_RandomBool(random);
+	windowInfo->overpanning = WindowRecordTest_RandomBool(random);
+	windowInfo->band = (uint32_t)WindowInvestigator_Test_Random(random);
+	windowInfo->hasNonRudeHWNDProperty = WindowRecordTest_RandomBool(random);
+	windowInfo->hasNonRudeAddedByRudeWindowFixerProperty = WindowRecordTest_RandomBool(random);
+	windowInfo->hasLivePreviewWindowProperty = WindowRecordTest_RandomBool(random);
+	windowInfo->hasTreatAsDesktopFullscreenProperty = WindowRecordTest_RandomBool(random);
+	windowInfo->isWindow = WindowRecordTest_RandomBool(random);
+	windowInfo->dwmIsCloaked = (uint32_t)WindowInvestigator_Test_Random(random);
+	windowInfo->isIconic = WindowRecordTest_RandomBool(random);
+	windowInfo->isVisible = WindowRecordTest_RandomBool(random);
+
+	WindowRecordTest_GenerateString(random, &windowStrings->className);
+	WindowRecordTest_GenerateString(random, &windowStrings->text);
+	WindowInvestigator_InternWindowStrings(pool, NULL, WindowInvestigator_WindowField_ALL, windowStrings, windowInfo);
+}
+
+// A single field, all of them, none, or a random subset.
+static uint32_t WindowRecordTest_GenerateFields(uint64_t* random) {
+	switch (WindowInvestigator_Test_Random(random) % 8) {
+	case 0: return WindowInvestigator_WindowField_BIT(WindowInvestigator_Test_RandomIndex(random, WindowInvestigator_WindowField_COUNT));
+	case 1: return WindowInvestigator_WindowField_ALL;
+	case 2: return 0;
+	default: return (uint32_t)WindowInvestigator_Test_Random(random) & WindowInvestigator_WindowField_ALL;
+	}
+}
+
+static void WindowRecordTest_CheckRoundTrip(uint64_t* random, WindowInvestigator_StringPool* pool, const WindowInvestigator_WindowInfo* windowInfo, uint32_t fields) {
+	static unsigned char buffer[WindowInvestigator_WindowRecord_MAX_SIZE + 16];
+	static WindowInvestigator_WindowStrings decodedStrings;
+	const size_t size = WindowInvestigator_EncodeWindowRecord(buffer, fields, windowInfo, pool);
+	WindowInvestigator_Test_CHECK(size > 0 && size <= WindowInvestigator_WindowRecord_MAX_SIZE);
+
+	// Fields that are not in the record must keep whatever the decoder was given.
+	WindowInvestigator_WindowInfo expected;
+	memset(&expected, 0xA5, sizeof(expected));
+	WindowInvestigator_CopyWindowInfoFields(&expected, windowInfo, fields);
+	WindowInvestigator_WindowInfo decoded;
+	memset(&decoded, 0xA5, sizeof(decoded));
+	uint32_t decodedFields = 0;
+	// Trailing bytes belong to the next record.
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DecodeWindowRecord(buffer, size + WindowInvestigator_Test_RandomIndex(random, 16), &decodedFields, &decoded, &decodedStrings) == size);
+	WindowInvestigator_Test_CHECK(decodedFields == fields);
+
+	// Interning against the original reuses its string IDs, without taking a reference, only if the strings are equal.
+	WindowInvestigator_InternWindowStrings(pool, windowInfo, fields, &decodedStrings, &decoded);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DiffWindowInfo(&expected, &decoded) == 0);
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_CLASS_NAME)) {
+		WindowInvestigator_Test_CHECK(wcscmp(decodedStrings.className.string, WindowInvestigator_StringPool_Get(pool, windowInfo->className)) == 0);
+		WindowInvestigator_Test_CHECK(decodedStrings.className.length == wcslen(decodedStrings.className.string));
+	}
+	if (fields & WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT)) {
+		WindowInvestigator_Test_CHECK(wcscmp(decodedStrings.text.string, WindowInvestigator_StringPool_Get(pool, windowInfo->text)) == 0);
+		WindowInvestigator_Test_CHECK(decodedStrings.text.length == wcslen(decodedStrings.text.string));
+	}
+
+	// Every prefix is truncated; check all of them for small records, and a sample for large ones.
+	const size_t step = size < 256 ? 1 : 1 + WindowInvestigator_Test_RandomIndex(random, 64);
+	for (size_t truncatedSize = 0; truncatedSize < size; truncatedSize += step)
+		WindowInvestigator_Test_CHECK(WindowInvestigator_DecodeWindowRecord(buffer, truncatedSize, &decodedFields, &decoded, &decodedStrings) == 0);
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DecodeWindowRecord(buffer, size - 1, &decodedFields, &decoded, &decodedStrings) == 0);
+}
+
+static void WindowRecordTest_CheckMalformed(void) {
+	static WindowInvestigator_WindowStrings windowStrings;
+	WindowInvestigator_WindowInfo windowInfo;
+	uint32_t fields;
+
+	// Unknown fields.
+	unsigned char unknownField[] = { 0, 0, 0, 0x80 };
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DecodeWindowRecord(unknownField, sizeof(unknownField), &fields, &windowInfo, &windowStrings) == 0);
+
+	// Booleans other than 0 and 1.
+	const uint32_t isVisible = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_IS_VISIBLE);
+	unsigned char boolean[] = { (unsigned char)isVisible, (unsigned char)(isVisible >> 8), (unsigned char)(isVisible >> 16), (unsigned char)(isVisible >> 24), 1 };
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DecodeWindowRecord(boolean, sizeof(boolean), &fields, &windowInfo, &windowStrings) == sizeof(boolean));
+	WindowInvestigator_Test_CHECK(fields == isVisible && windowInfo.isVisible);
+	boolean[4] = 2;
+	WindowInvestigator_Test_CHECK(WindowInvestigator_DecodeWindowRecord(boolean, sizeof(boolean), &fields, &windowInfo, &windowStrings) == 0);
+
+	// Strings longer than the scratch buffer.
+	const uint32_t text = WindowInvestigator_WindowField_BIT(WindowInvestigator_WindowField_TEXT);
+	const size_t capacity = sizeof(windowStrings.text.string) / sizeof(*windowStrings.text.string);
+	static unsigned char longString[4 + 2 + 2 * 1024];
+	memset(longString, 'a', sizeof(longString));
+	longString[0] = (unsigned char)text;
+	longString[1] = (unsigned char)(text >> 8);
+	longString[2] = (unsigned char)(text >> 16);
+	longString[3] = (unsigned char)(text >> 24);
+	for (size_t length = capacity - 1; length <= capacity; ++length) {
+		for (size_t index = 0; index < length; ++index) longString[6 + 2 * index + 1] = 0;
+		longString[4] = (unsigned char)length;
+		longString[5] = (unsigned char)(length >> 8);
+		const size_t size = WindowInvestigator_DecodeWindowRecord(longString, 6 + 2 * length, &fields, &windowInfo, &windowStrings);
+		WindowInvestigator_Test_CHECK(length < capacity ? size == 6 + 2 * length && windowStrings.text.length == length : size == 0);
+	}
+}
+
+int main(void) {
+	uint64_t random = 1;
+	WindowRecordTest_CheckMalformed();
+
+	static WindowInvestigator_WindowStrings windowStrings;
+	WindowInvestigator_StringPool pool;
+	WindowInvestigator_StringPool_Init(&pool);
+	for (int iteration = 0; iteration < WindowRecordTest_ITERATIONS; ++iteration) {
+		WindowInvestigator_WindowInfo windowInfo;
+		WindowRecordTest_GenerateWindowInfo(&random, &pool, &windowStrings, &windowInfo);
+		WindowRecordTest_CheckRoundTrip(&random, &pool, &windowInfo, WindowRecordTest_GenerateFields(&random));
+		WindowInvestigator_ReleaseWindowStrings(&pool, &windowInfo);
+	}
+	WindowInvestigator_Test_CHECK(pool.stringCount == 0);
+	WindowInvestigator_StringPool_Destroy(&pool);
+
+	printf("%d records OK\n", WindowRecordTest_ITERATIONS);
+	return EXIT_SUCCESS;
+}
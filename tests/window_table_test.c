@@ -0,0 +1,287 @@
+#include "../common/window_table.h"
+
+#include "test.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Checks the window table against the linked list that WindowMonitor used before it: the list was kept in Z-order, and every
+// pass walked it alongside the enumeration, pulling each window forward to its new position (or inserting it if it was not
+// found further down), then dropped whatever was left at the end.
+//
+// Both must agree on which windows are new and which are gone, and in what order. They are not expected to agree on which
+// windows moved: the list reported every window it had to pull forward, whereas the table reports the minimal set, so the
+// table must report at most as many moves as the list, and the windows it does not report must have kept their relative
+// order.
+
+#define WindowTableTest_MAX_WINDOWS 512
+#define WindowTableTest_HANDLE_COUNT 2048
+#define WindowTableTest_PASSES 2000
+
+typedef struct {
+	uintptr_t windows[WindowTableTest_MAX_WINDOWS];
+	size_t count;
+} WindowTableTest_Order;
+
+typedef struct {
+	uintptr_t goneWindows[WindowTableTest_MAX_WINDOWS];
+	size_t goneCount;
+	uintptr_t movedWindows[WindowTableTest_MAX_WINDOWS];
+	size_t movedPreviousZOrders[WindowTableTest_MAX_WINDOWS];
+	size_t movedZOrders[WindowTableTest_MAX_WINDOWS];
+	size_t movedCount;
+} WindowTableTest_Events;
+
+static void WindowTableTest_OnWindowGone(void* context, uintptr_t window, void* value) {
+	WindowTableTest_Events* const events = context;
+	WindowInvestigator_Test_CHECK(*(const uintptr_t*)value == window);
+	events->goneWindows[events->goneCount++] = window;
+}
+
+static void WindowTableTest_OnZOrderChanged(void* context, uintptr_t window, void* value, size_t previousZOrder, size_t zOrder) {
+	WindowTableTest_Events* const events = context;
+	WindowInvestigator_Test_CHECK(*(const uintptr_t*)value == window);
+	events->movedWindows[events->movedCount] = window;
+	events->movedPreviousZOrders[events->movedCount] = previousZOrder;
+	events->movedZOrders[events->movedCount] = zOrder;
+	++events->movedCount;
+}
+
+static size_t WindowTableTest_IndexOf(const WindowTableTest_Order* order, uintptr_t window) {
+	for (size_t index = 0; index < order->count; ++index)
+		if (order->windows[index] == window) return index;
+	return SIZE_MAX;
+}
+
+// Runs a pass of the old linked list over list, which becomes the new order. Reports new windows through isNew (indexed by
+// new Z-order), gone windows in the order the list dropped them, and returns the number of windows it pulled forward.
+static size_t WindowTableTest_RunLinkedListPass(WindowTableTest_Order* list, const WindowTableTest_Order* order, bool* isNew, WindowTableTest_Order* gone) {
+	size_t pulledForward = 0;
+	for (size_t zOrder = 0; zOrder < order->count; ++zOrder) {
+		const uintptr_t window = order->windows[zOrder];
+		isNew[zOrder] = false;
+		if (zOrder < list->count && list->windows[zOrder] == window) continue;
+
+		size_t existing = SIZE_MAX;
+		for (size_t index = zOrder; index < list->count; ++index)
+			if (list->windows[index] == window) existing = index;
+		if (existing == SIZE_MAX) {
+			isNew[zOrder] = true;
+			existing = list->count++;
+		}
+		else ++pulledForward;
+		memmove(&list->windows[zOrder + 1], &list->windows[zOrder], (existing - zOrder) * sizeof(*list->windows));
+		list->windows[zOrder] = window;
+	}
+
+	gone->count = 0;
+	for (size_t index = order->count; index < list->count; ++index)
+		gone->windows[gone->count++] = list->windows[index];
+	list->count = order->count;
+	return pulledForward;
+}
+
+// Real window handles are multiples of 2 or 4 that share their high bits; so are these.
+static uintptr_t WindowTableTest_GetHandle(size_t index) {
+	return (uintptr_t)0x10000 + (uintptr_t)index * 4;
+}
+
+static size_t WindowTableTest_GetHandleIndex(uintptr_t window) {
+	return (size_t)((window - 0x10000) / 4);
+}
+
+// Generation-checked handles taken when each window appeared, kept after the window is gone until its window handle comes
+// back, so that stale handles are checked while their slot goes to other windows.
+typedef struct {
+	WindowInvestigator_WindowTable_Handle handles[WindowTableTest_HANDLE_COUNT];
+	bool taken[WindowTableTest_HANDLE_COUNT];
+	bool live[WindowTableTest_HANDLE_COUNT];
+	// Number of times a stale handle was checked while its slot held another window.
+	uint64_t reusedSlotChecks;
+} WindowTableTest_Handles;
+
+static WindowTableTest_Handles WindowTableTest_handles;
+
+static void WindowTableTest_CheckHandles(const WindowInvestigator_WindowTable* table, const WindowTableTest_Order* order, const bool* isNew) {
+	WindowTableTest_Handles* const handles = &WindowTableTest_handles;
+	for (size_t index = 0; index < WindowTableTest_HANDLE_COUNT; ++index) handles->live[index] = false;
+	for (size_t zOrder = 0; zOrder < order->count; ++zOrder) {
+		const size_t index = WindowTableTest_GetHandleIndex(order->windows[zOrder]);
+		const size_t slot = WindowInvestigator_WindowTable_Find(table, order->windows[zOrder]);
+		handles->live[index] = true;
+		if (!isNew[zOrder]) continue;
+		// The window handle is back, but the window is a different one.
+		if (handles->taken[index]) {
+			WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_Resolve(table, handles->handles[index]) == WindowInvestigator_WindowTable_NO_SLOT);
+			WindowInvestigator_Test_CHECK(handles->handles[index].slot != slot || handles->handles[index].generation != WindowInvestigator_WindowTable_GetGeneration(table, slot));
+		}
+		handles->handles[index] = WindowInvestigator_WindowTable_GetHandle(table, slot);
+		handles->taken[index] = true;
+	}
+	for (size_t index = 0; index < WindowTableTest_HANDLE_COUNT; ++index) {
+		if (!handles->taken[index]) continue;
+		const WindowInvestigator_WindowTable_Handle handle = handles->handles[index];
+		const size_t slot = WindowInvestigator_WindowTable_Resolve(table, handle);
+		if (handles->live[index]) {
+			WindowInvestigator_Test_CHECK(slot == handle.slot);
+			WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_GetWindow(table, slot) == WindowTableTest_GetHandle(index));
+			continue;
+		}
+		WindowInvestigator_Test_CHECK(slot == WindowInvestigator_WindowTable_NO_SLOT);
+		if (handle.slot < table->slotCount && WindowInvestigator_WindowTable_Find(table, WindowInvestigator_WindowTable_GetWindow(table, handle.slot)) == handle.slot)
+			++handles->reusedSlotChecks;
+	}
+}
+
+// Derives the next order from the previous one: a few windows are removed, moved or added (possibly reusing a handle that
+// was just removed), and every so often the order is shuffled entirely or the desktop is emptied.
+static void WindowTableTest_Mutate(uint64_t* random, WindowTableTest_Order* order) {
+	const uint64_t kind = WindowInvestigator_Test_Random(random) % 100;
+	if (kind == 0) {
+		order->count = 0;
+		return;
+	}
+	if (kind < 3) {
+		for (size_t index = order->count; index > 1; --index) {
+			const size_t other = WindowInvestigator_Test_RandomIndex(random, index);
+			const uintptr_t window = order->windows[index - 1];
+			order->windows[index - 1] = order->windows[other];
+			order->windows[other] = window;
+		}
+		return;
+	}
+
+	const size_t changeCount = WindowInvestigator_Test_RandomIndex(random, 8);
+	for (size_t change = 0; change < changeCount; ++change) {
+		const uint64_t operation = WindowInvestigator_Test_Random(random) % 3;
+		if (operation == 0 && order->count > 0) {
+			const size_t index = WindowInvestigator_Test_RandomIndex(random, order->count);
+			memmove(&order->windows[index], &order->windows[index + 1], (order->count - index - 1) * sizeof(*order->windows));
+			--order->count;
+		}
+		else if (operation == 1 && order->count > 1) {
+			const size_t from = WindowInvestigator_Test_RandomIndex(random, order->count);
+			const uintptr_t window = order->windows[from];
+			memmove(&order->windows[from], &order->windows[from + 1], (order->count - from - 1) * sizeof(*order->windows));
+			const size_t to = WindowInvestigator_Test_RandomIndex(random, order->count);
+			memmove(&order->windows[to + 1], &order->windows[to], (order->count - 1 - to) * sizeof(*order->windows));
+			order->windows[to] = window;
+		}
+		else if (order->count < WindowTableTest_MAX_WINDOWS) {
+			// Handles are drawn from a small pool, so they get recycled regularly.
+			uintptr_t window;
+			do window = WindowTableTest_GetHandle(WindowInvestigator_Test_RandomIndex(random, WindowTableTest_HANDLE_COUNT));
+			while (WindowTableTest_IndexOf(order, window) != SIZE_MAX);
+			const size_t to = WindowInvestigator_Test_RandomIndex(random, order->count + 1);
+			memmove(&order->windows[to + 1], &order->windows[to], (order->count - to) * sizeof(*order->windows));
+			order->windows[to] = window;
+			++order->count;
+		}
+	}
+}
+
+static void WindowTableTest_CheckPass(WindowInvestigator_WindowTable* table, WindowTableTest_Order* list, const WindowTableTest_Order* previousOrder, const WindowTableTest_Order* order) {
+	static bool isNew[WindowTableTest_MAX_WINDOWS];
+	static WindowTableTest_Order gone;
+	static WindowTableTest_Events events;
+	static WindowInvestigator_WindowTable_Handle handles[WindowTableTest_MAX_WINDOWS];
+	const size_t pulledForward = WindowTableTest_RunLinkedListPass(list, order, isNew, &gone);
+
+	for (size_t zOrder = 0; zOrder < previousOrder->count; ++zOrder)
+		handles[zOrder] = WindowInvestigator_WindowTable_GetHandle(table, WindowInvestigator_WindowTable_Find(table, previousOrder->windows[zOrder]));
+
+	WindowInvestigator_WindowTable_BeginPass(table);
+	for (size_t zOrder = 0; zOrder < order->count; ++zOrder) {
+		const uintptr_t window = order->windows[zOrder];
+		WindowInvestigator_WindowTable_VisitResult result;
+		const size_t slot = WindowInvestigator_WindowTable_Visit(table, window, &result);
+		WindowInvestigator_Test_CHECK(result == (isNew[zOrder] ? WindowInvestigator_WindowTable_NEW_WINDOW : WindowInvestigator_WindowTable_EXISTING_WINDOW));
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_GetWindow(table, slot) == window);
+		uintptr_t* const value = WindowInvestigator_WindowTable_GetValue(table, slot);
+		if (isNew[zOrder]) *value = window;
+		else WindowInvestigator_Test_CHECK(*value == window);
+
+		// Visiting the same window twice in a pass must not disturb anything.
+		if (zOrder % 7 == 0) {
+			WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_Visit(table, window, &result) == slot);
+			WindowInvestigator_Test_CHECK(result == WindowInvestigator_WindowTable_ALREADY_VISITED);
+		}
+	}
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_Find(table, (uintptr_t)1) == WindowInvestigator_WindowTable_NO_SLOT);
+
+	events.goneCount = 0;
+	events.movedCount = 0;
+	WindowInvestigator_WindowTable_PassCallbacks callbacks;
+	callbacks.onWindowGone = WindowTableTest_OnWindowGone;
+	callbacks.onZOrderChanged = WindowTableTest_OnZOrderChanged;
+	callbacks.context = &events;
+	WindowInvestigator_WindowTable_EndPass(table, &callbacks);
+
+	WindowInvestigator_Test_CHECK(events.goneCount == gone.count);
+	for (size_t index = 0; index < gone.count; ++index) {
+		WindowInvestigator_Test_CHECK(events.goneWindows[index] == gone.windows[index]);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_Find(table, gone.windows[index]) == WindowInvestigator_WindowTable_NO_SLOT);
+	}
+
+	// Handles to gone windows must not resolve anymore, even if the handle or the slot was reused.
+	for (size_t zOrder = 0; zOrder < previousOrder->count; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_Resolve(table, handles[zOrder]);
+		if (WindowTableTest_IndexOf(order, previousOrder->windows[zOrder]) == SIZE_MAX) WindowInvestigator_Test_CHECK(slot == WindowInvestigator_WindowTable_NO_SLOT);
+		else WindowInvestigator_Test_CHECK(slot == handles[zOrder].slot);
+	}
+
+	WindowInvestigator_Test_CHECK(events.movedCount <= pulledForward);
+	for (size_t index = 0; index < events.movedCount; ++index) {
+		WindowInvestigator_Test_CHECK(order->windows[events.movedZOrders[index]] == events.movedWindows[index]);
+		WindowInvestigator_Test_CHECK(previousOrder->windows[events.movedPreviousZOrders[index]] == events.movedWindows[index]);
+		WindowInvestigator_Test_CHECK(index == 0 || events.movedZOrders[index - 1] < events.movedZOrders[index]);
+	}
+	size_t lastUnmovedPreviousZOrder = SIZE_MAX;
+	size_t nextMoved = 0;
+	for (size_t zOrder = 0; zOrder < order->count; ++zOrder) {
+		if (nextMoved < events.movedCount && events.movedZOrders[nextMoved] == zOrder) {
+			++nextMoved;
+			continue;
+		}
+		if (isNew[zOrder]) continue;
+		const size_t previousZOrder = WindowTableTest_IndexOf(previousOrder, order->windows[zOrder]);
+		WindowInvestigator_Test_CHECK(lastUnmovedPreviousZOrder == SIZE_MAX || previousZOrder > lastUnmovedPreviousZOrder);
+		lastUnmovedPreviousZOrder = previousZOrder;
+	}
+
+	WindowTableTest_CheckHandles(table, order, isNew);
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_GetZOrderCount(table) == order->count);
+	WindowInvestigator_Test_CHECK(table->windowCount == order->count);
+	for (size_t zOrder = 0; zOrder < order->count; ++zOrder) {
+		const size_t slot = WindowInvestigator_WindowTable_GetZOrderSlot(table, zOrder);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_GetWindow(table, slot) == order->windows[zOrder]);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_GetZOrder(table, slot) == zOrder);
+		WindowInvestigator_Test_CHECK(WindowInvestigator_WindowTable_Find(table, order->windows[zOrder]) == slot);
+	}
+}
+
+int main(void) {
+	static WindowTableTest_Order list;
+	static WindowTableTest_Order orders[2];
+	uint64_t random = 1;
+
+	WindowInvestigator_WindowTable table;
+	WindowInvestigator_WindowTable_Init(&table, sizeof(uintptr_t));
+	for (size_t pass = 0; pass < WindowTableTest_PASSES; ++pass) {
+		const WindowTableTest_Order* const previousOrder = &orders[pass % 2];
+		WindowTableTest_Order* const order = &orders[(pass + 1) % 2];
+		*order = *previousOrder;
+		// Grow the desktop quickly at first, so that the hash index gets resized a few times.
+		const size_t mutationCount = pass < 50 ? 20 : 1;
+		for (size_t mutation = 0; mutation < mutationCount; ++mutation) WindowTableTest_Mutate(&random, order);
+		WindowTableTest_CheckPass(&table, &list, previousOrder, order);
+	}
+	WindowInvestigator_WindowTable_Destroy(&table);
+	// Otherwise, stale handles were only ever checked against empty slots.
+	WindowInvestigator_Test_CHECK(WindowTableTest_handles.reusedSlotChecks != 0);
+
+	printf("%d passes OK (%" PRIu64 " stale handle checks on reused slots)\n", WindowTableTest_PASSES, WindowTableTest_handles.reusedSlotChecks);
+	return EXIT_SUCCESS;
+}
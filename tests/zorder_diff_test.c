@@ -0,0 +1,136 @@
+#include "../common/zorder_diff.h"
+
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// Checks the Z-order diff against brute force: on small Z-orders, every subset of the windows that were already there is tried
+// to find the largest one that kept its relative order; on larger ones, the length of the longest increasing subsequence is
+// computed with the quadratic dynamic programming algorithm instead. Either way, the windows reported as not moved must be in
+// increasing previous order, and there must be no more of them than the brute force found.
+
+#define ZOrderDiffTest_EXHAUSTIVE_MAX_WINDOWS 12
+#define ZOrderDiffTest_MAX_WINDOWS 300
+
+static size_t ZOrderDiffTest_GetExhaustiveKeptCount(const size_t* previousZOrders, size_t count) {
+	size_t best = 0;
+	for (uint32_t subset = 0; subset < (UINT32_C(1) << count); ++subset) {
+		size_t keptCount = 0;
+		size_t last = 0;
+		bool increasing = true;
+		for (size_t index = 0; index < count && increasing; ++index) {
+			if ((subset & (UINT32_C(1) << index)) == 0) continue;
+			if (previousZOrders[index] == WindowInvestigator_ZOrderDiff_NEW_WINDOW) increasing = false;
+			else if (keptCount > 0 && previousZOrders[index] <= last) increasing = false;
+			last = previousZOrders[index];
+			++keptCount;
+		}
+		if (increasing && keptCount > best) best = keptCount;
+	}
+	return best;
+}
+
+static size_t ZOrderDiffTest_GetQuadraticKeptCount(const size_t* previousZOrders, size_t count) {
+	static size_t lengths[ZOrderDiffTest_MAX_WINDOWS];
+	size_t best = 0;
+	for (size_t index = 0; index < count; ++index) {
+		lengths[index] = 0;
+		if (previousZOrders[index] == WindowInvestigator_ZOrderDiff_NEW_WINDOW) continue;
+		lengths[index] = 1;
+		for (size_t before = 0; before < index; ++before)
+			if (lengths[before] != 0 && previousZOrders[before] < previousZOrders[index] && lengths[before] + 1 > lengths[index])
+				lengths[index] = lengths[before] + 1;
+		if (lengths[index] > best) best = lengths[index];
+	}
+	return best;
+}
+
+// Builds a Z-order of count windows out of previousCount: some of the previous windows are dropped, some new ones inserted,
+// and the rest are shuffled to a varying degree, from a single window moving to a full shuffle.
+static size_t ZOrderDiffTest_Generate(uint64_t* random, size_t previousCount, size_t* previousZOrders) {
+	size_t count = 0;
+	for (size_t previousZOrder = 0; previousZOrder < previousCount; ++previousZOrder) {
+		if (WindowInvestigator_Test_Random(random) % 8 == 0) continue;
+		previousZOrders[count++] = previousZOrder;
+	}
+	const size_t newCount = WindowInvestigator_Test_RandomIndex(random, 3);
+	for (size_t newWindow = 0; newWindow < newCount; ++newWindow) {
+		const size_t at = WindowInvestigator_Test_RandomIndex(random, count + 1);
+		memmove(&previousZOrders[at + 1], &previousZOrders[at], (count - at) * sizeof(*previousZOrders));
+		previousZOrders[at] = WindowInvestigator_ZOrderDiff_NEW_WINDOW;
+		++count;
+	}
+	if (count < 2) return count;
+
+	const size_t swapCount = WindowInvestigator_Test_Random(random) % 4 == 0 ? count : WindowInvestigator_Test_RandomIndex(random, 4);
+	for (size_t swap = 0; swap < swapCount; ++swap) {
+		const size_t first = WindowInvestigator_Test_RandomIndex(random, count);
+		const size_t second = WindowInvestigator_Test_RandomIndex(random, count);
+		const size_t previousZOrder = previousZOrders[first];
+		previousZOrders[first] = previousZOrders[second];
+		previousZOrders[second] = previousZOrder;
+	}
+	return count;
+}
+
+static void ZOrderDiffTest_Check(WindowInvestigator_ZOrderDiff* diff, const size_t* previousZOrders, size_t count, size_t expectedKeptCount) {
+	static bool moved[ZOrderDiffTest_MAX_WINDOWS + 1];
+	// Canary, to catch writes past the end.
+	moved[count] = true;
+	const size_t movedCount = WindowInvestigator_ZOrderDiff_Compute(diff, previousZOrders, count, moved);
+	WindowInvestigator_Test_CHECK(moved[count]);
+
+	size_t existingCount = 0;
+	size_t reportedMovedCount = 0;
+	size_t keptCount = 0;
+	size_t last = 0;
+	for (size_t index = 0; index < count; ++index) {
+		if (previousZOrders[index] == WindowInvestigator_ZOrderDiff_NEW_WINDOW) {
+			WindowInvestigator_Test_CHECK(!moved[index]);
+			continue;
+		}
+		++existingCount;
+		if (moved[index]) {
+			++reportedMovedCount;
+			continue;
+		}
+		WindowInvestigator_Test_CHECK(keptCount == 0 || previousZOrders[index] > last);
+		last = previousZOrders[index];
+		++keptCount;
+	}
+	WindowInvestigator_Test_CHECK(reportedMovedCount == movedCount);
+	WindowInvestigator_Test_CHECK(keptCount == expectedKeptCount);
+	WindowInvestigator_Test_CHECK(movedCount == existingCount - expectedKeptCount);
+}
+
+int main(void) {
+	static size_t previousZOrders[ZOrderDiffTest_MAX_WINDOWS];
+	uint64_t random = 1;
+	WindowInvestigator_ZOrderDiff diff;
+	WindowInvestigator_ZOrderDiff_Init(&diff);
+
+	WindowInvestigator_Test_CHECK(WindowInvestigator_ZOrderDiff_Compute(&diff, previousZOrders, 0, NULL) == 0);
+
+	// A single window brought to the front is the only one that moved, even though every window in front of it changed index.
+	for (size_t zOrder = 0; zOrder < 10; ++zOrder) previousZOrders[zOrder] = zOrder == 0 ? 7 : zOrder <= 7 ? zOrder - 1 : zOrder;
+	ZOrderDiffTest_Check(&diff, previousZOrders, 10, 9);
+
+	size_t caseCount = 0;
+	for (int iteration = 0; iteration < 20000; ++iteration) {
+		const size_t previousCount = WindowInvestigator_Test_RandomIndex(&random, ZOrderDiffTest_EXHAUSTIVE_MAX_WINDOWS - 1);
+		const size_t count = ZOrderDiffTest_Generate(&random, previousCount, previousZOrders);
+		ZOrderDiffTest_Check(&diff, previousZOrders, count, ZOrderDiffTest_GetExhaustiveKeptCount(previousZOrders, count));
+		++caseCount;
+	}
+	for (int iteration = 0; iteration < 2000; ++iteration) {
+		const size_t previousCount = WindowInvestigator_Test_RandomIndex(&random, ZOrderDiffTest_MAX_WINDOWS - 2);
+		const size_t count = ZOrderDiffTest_Generate(&random, previousCount, previousZOrders);
+		ZOrderDiffTest_Check(&diff, previousZOrders, count, ZOrderDiffTest_GetQuadraticKeptCount(previousZOrders, count));
+		++caseCount;
+	}
+
+	WindowInvestigator_ZOrderDiff_Destroy(&diff);
+	printf("%zu Z-orders OK\n", caseCount);
+	return EXIT_SUCCESS;
+}